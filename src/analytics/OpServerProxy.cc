@@ -109,6 +109,11 @@ class OpServerProxy::OpServerImpl {
         };
 
         static const int kActivityCheckPeriod_ = 60;
+        // UVE attribute updates are held for up to kUVEBatchWindowMsec_ to
+        // be sent in one batch, repeated updates of an attribute within
+        // the window are coalesced
+        static const int kUVEBatchWindowMsec_ = 10;
+        static const size_t kUVEBatchMaxUpdates_ = 256;
 
         const unsigned int partitions_;
 
@@ -163,6 +168,8 @@ class OpServerProxy::OpServerImpl {
                 rinfo_.set_conn_call_disconnected(0);
                 rinfo_.set_conn_call_succeeded(0);
                 rinfo_.set_conn_call_failed(0);
+                rinfo_.set_update_coalesced(0);
+                rinfo_.set_update_batches(0);
             }
 
             void RedisUveUpdate() {
@@ -174,6 +181,17 @@ class OpServerProxy::OpServerImpl {
             void RedisUveUpdateNoConn() {
                 rinfo_.set_update_no_conn(rinfo_.get_update_no_conn()+1);
             }
+            void RedisUveUpdateCoalesced() {
+                rinfo_.set_update_coalesced(rinfo_.get_update_coalesced()+1);
+            }
+            void RedisUveUpdateBatch(size_t count) {
+                rinfo_.set_update_batches(rinfo_.get_update_batches()+1);
+                rinfo_.set_update_succeeded(rinfo_.get_update_succeeded()+
+                                            count);
+            }
+            void RedisUveUpdateBatchFail(size_t count) {
+                rinfo_.set_update_failed(rinfo_.get_update_failed()+count);
+            }
             void RedisUveDelete() {
                 rinfo_.set_delete_succeeded(rinfo_.get_delete_succeeded()+1);
             }
@@ -215,6 +233,7 @@ class OpServerProxy::OpServerImpl {
         void ToOpsConnUpPostProcess() {
             processor_cb_proc_fn = boost::bind(&OpServerImpl::processorCallbackProcess, this, _1, _2, _3);
             to_ops_conn_.get()->SetClientAsyncCmdCb(processor_cb_proc_fn);
+            RedisProcessorExec::LoadScripts(to_ops_conn_.get());
 
             string module = Sandesh::module();
             string source = Sandesh::source();
@@ -367,12 +386,19 @@ class OpServerProxy::OpServerImpl {
 
             if (reply == NULL) {
                 LOG(DEBUG, "NULL Reply...\n");
+                // Pending requests are completed without a reply when
+                // the connection goes down
+                if (rpi) {
+                    rpi->ProcessCallback(reply);
+                }
                 return;
             }
             // If redis returns error for async request, then perhaps it
             // is busy executing a script and it has reached the maximum
-            // execution time limit.
-            assert(reply->type != REDIS_REPLY_ERROR);
+            // execution time limit. Scripts that redis does not have are
+            // sent again by the request.
+            assert(reply->type != REDIS_REPLY_ERROR ||
+                   (rpi && RedisScript::NoScript(reply)));
 
             if (rpi) {
                 rpi->ProcessCallback(reply);
@@ -481,6 +507,51 @@ class OpServerProxy::OpServerImpl {
             return true;
         }
 
+        // Queues a UVE attribute update, returns false if the update could
+        // not be sent
+        bool UVEUpdate(const RedisUVEUpdate &update) {
+            tbb::mutex::scoped_lock lock(uve_batch_mutex_);
+            if (uve_batch_.Add(update)) {
+                redis_uve_.RedisUveUpdateCoalesced();
+            }
+            if (uve_batch_.size() >= kUVEBatchMaxUpdates_) {
+                return FlushUVEBatchLocked();
+            }
+            return true;
+        }
+
+        // Sends the pending UVE attribute updates, and then the UVE
+        // notifications that were held back for them
+        bool FlushUVEBatch() {
+            tbb::mutex::scoped_lock lock(uve_batch_mutex_);
+            return FlushUVEBatchLocked();
+        }
+
+        // Drops the pending UVE attribute updates from a generator
+        void DeleteUVEBatch(const string &source, const string &node_type,
+                            const string &module, const string &instance_id) {
+            tbb::mutex::scoped_lock lock(uve_batch_mutex_);
+            uve_batch_.RemoveGenerator(source, node_type, module, instance_id);
+        }
+
+        // Publishes a UVE notification, after the pending UVE attribute
+        // updates are sent, so that consumers of the notification read
+        // the updated UVE
+        void UVENotifPub(unsigned int pt, const string &skey,
+                         const string &gen, const string &value) {
+            tbb::mutex::scoped_lock lock(uve_batch_mutex_);
+            if (uve_batch_.empty()) {
+                KafkaPub(pt, skey, gen, value);
+                return;
+            }
+            uve_notifs_.push_back(UVENotification(pt, skey, gen, value));
+        }
+
+        bool UVEBatchTimer() {
+            FlushUVEBatch();
+            return true;
+        }
+
         const string get_redis_password() {
             return redis_password_;
         }
@@ -508,7 +579,11 @@ class OpServerProxy::OpServerImpl {
             kafka_timer_(TimerManager::CreateTimer(*evm->io_service(),
                          "Kafka Timer", 
                          TaskScheduler::GetInstance()->GetTaskId(
-                         "Kafka Timer"))) {
+                         "Kafka Timer"))),
+            uve_batch_timer_(TimerManager::CreateTimer(*evm->io_service(),
+                         "UVE Batch Timer",
+                         TaskScheduler::GetInstance()->GetTaskId(
+                         "UVE Batch Timer"))) {
             to_ops_conn_.reset(new RedisAsyncConnection(evm_, 
                 redis_uve_ip, redis_uve_port, 
                 boost::bind(&OpServerProxy::OpServerImpl::ToOpsConnUp, this),
@@ -530,6 +605,8 @@ class OpServerProxy::OpServerImpl {
 
             kafka_timer_->Start(1000,
                 boost::bind(&OpServerImpl::KafkaTimer, this), NULL);
+            uve_batch_timer_->Start(kUVEBatchWindowMsec_,
+                boost::bind(&OpServerImpl::UVEBatchTimer, this), NULL);
             if (brokers.empty()) return;
             assert(StartKafka());
         }
@@ -573,6 +650,9 @@ class OpServerProxy::OpServerImpl {
         }
 
         void Shutdown() {
+            TimerManager::DeleteTimer(uve_batch_timer_);
+            uve_batch_timer_ = NULL;
+            FlushUVEBatch();
             TimerManager::DeleteTimer(kafka_timer_);
             kafka_timer_ = NULL;
             StopKafka();
@@ -580,6 +660,7 @@ class OpServerProxy::OpServerImpl {
 
         ~OpServerImpl() {
             assert(kafka_timer_ == NULL);
+            assert(uve_batch_timer_ == NULL);
         }
 
         RedisInfo redis_uve_;
@@ -604,6 +685,46 @@ class OpServerProxy::OpServerImpl {
         bool redis_up_;
         uint16_t kafka_count_;
         Timer *kafka_timer_;
+
+        struct UVENotification {
+            UVENotification(unsigned int pt, const string &skey,
+                            const string &gen, const string &value) :
+                pt(pt), skey(skey), gen(gen), value(value) {
+            }
+            unsigned int pt;
+            string skey;
+            string gen;
+            string value;
+        };
+
+        bool FlushUVEBatchLocked() {
+            if (uve_batch_.empty()) {
+                return true;
+            }
+            std::vector<RedisUVEUpdate> updates;
+            uve_batch_.Swap(&updates);
+            bool ret = false;
+            shared_ptr<RedisAsyncConnection> prac = to_ops_conn();
+            if (prac) {
+                ret = RedisProcessorExec::UVEUpdateBatch(prac.get(), NULL,
+                                                         updates);
+            }
+            ret ? redis_uve_.RedisUveUpdateBatch(updates.size()) :
+                redis_uve_.RedisUveUpdateBatchFail(updates.size());
+            for (std::vector<UVENotification>::const_iterator it =
+                 uve_notifs_.begin(); it != uve_notifs_.end(); ++it) {
+                KafkaPub(it->pt, it->skey, it->gen, it->value);
+            }
+            uve_notifs_.clear();
+            return ret;
+        }
+
+        // Protects the pending UVE attribute updates and notifications,
+        // they are sent with the mutex held to keep their order
+        tbb::mutex uve_batch_mutex_;
+        RedisUVEBatch uve_batch_;
+        std::vector<UVENotification> uve_notifs_;
+        Timer *uve_batch_timer_;
 };
 
 OpServerProxy::OpServerProxy(EventManager *evm, VizCollector *collector,
@@ -711,7 +832,7 @@ OpServerProxy::UVENotif(const std::string &type,
     dd.Accept(writer);
     string jsonline(sb.GetString());
 
-    impl_->KafkaPub(pt, kstr.c_str(), genstr, jsonline);
+    impl_->UVENotifPub(pt, kstr, genstr, jsonline);
 
     return true;
 }
@@ -745,15 +866,19 @@ OpServerProxy::UVEUpdate(const std::string &type, const std::string &attr,
         pt = partdesc.first + (djb_hash(key.c_str(), key.size()) % partdesc.second);
     }
 
-    bool ret = RedisProcessorExec::UVEUpdate(prac.get(), NULL, type, attr,
-            source, node_type, module, instance_id, key, message,
-            seq, agg, ts, pt, is_alarm);
-    if (ret) {
-        impl_->redis_uve_.RedisUveUpdate();
-    } else {
-        impl_->redis_uve_.RedisUveUpdateFail();
-    }
-    return ret;
+    RedisUVEUpdate update;
+    update.type = type;
+    update.attr = attr;
+    update.source = source;
+    update.node_type = node_type;
+    update.module = module;
+    update.instance_id = instance_id;
+    update.key = key;
+    update.message = message;
+    update.seq = seq;
+    update.part = pt;
+    update.is_alarm = is_alarm;
+    return impl_->UVEUpdate(update);
 }
 
 bool
@@ -769,6 +894,8 @@ OpServerProxy::UVEDelete(const std::string &type,
         return false;
     }
 
+    // The delete must follow the pending updates of the UVE
+    impl_->FlushUVEBatch();
     bool ret = RedisProcessorExec::UVEDelete(prac.get(), NULL, type, source, 
             node_type, module, instance_id, key, seq, is_alarm);
     ret ? impl_->redis_uve_.RedisUveDelete() : impl_->redis_uve_.RedisUveDeleteFail(); 
@@ -785,6 +912,7 @@ OpServerProxy::GetSeq(const string &source, const string &node_type,
 
     if (!impl_->to_ops_conn()) return false;
 
+    impl_->FlushUVEBatch();
     return RedisProcessorExec::SyncGetSeq(impl_->redis_uve_.GetIp(),
             impl_->redis_uve_.GetPort(), impl_->get_redis_password(),
             source, node_type, module, instance_id, seqReply);
@@ -796,6 +924,7 @@ OpServerProxy::DeleteUVEs(const string &source, const string &module,
 
     shared_ptr<RedisAsyncConnection> prac = impl_->to_ops_conn();
     if  (!(prac && prac->IsConnUp())) return false;
+    impl_->DeleteUVEBatch(source, node_type, module, instance_id);
     bool ret =  RedisProcessorExec::SyncDeleteUVEs(impl_->redis_uve_.GetIp(),
             impl_->redis_uve_.GetPort(), impl_->get_redis_password(), source,
             node_type, module, instance_id);
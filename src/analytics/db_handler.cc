@@ -496,7 +496,7 @@ void DbHandler::MessageTableOnlyInsert(const VizMsg *vmsgp) {
     }
 
     columns.push_back(new GenDb::NewCol(g_viz_constants.DATA,
-        vmsgp->msg->ExtractMessage(), ttl));
+        vmsgp->fields().xml, ttl));
 
     if (!dbif_->Db_AddColumn(col_list)) {
         DB_LOG(ERROR, "Addition of message: " << message_type <<
@@ -529,10 +529,7 @@ void DbHandler::MessageTableInsert(const VizMsg *vmsgp) {
     std::string s;
 
     if (stype == SandeshType::SYSTEM) {
-        const SandeshXMLMessage *sxmsg =
-            static_cast<const SandeshXMLMessage *>(vmsgp->msg);
-        const pugi::xml_node &parent(sxmsg->GetMessageNode());
-        s = LineParser::GetXmlString(parent);
+        s = vmsgp->fields().keyword_doc;
     } else if (!vmsgp->keyword_doc_.empty()) {
         s = std::string(vmsgp->keyword_doc_);
     }
@@ -7,7 +7,10 @@
 #include "base/string_util.h"
 #include "redis_processor_vizd.h"
 #include "redis_connection.h"
+#include <stdio.h>
 #include <boost/assign/list_of.hpp>
+#include <boost/bind.hpp>
+#include <boost/uuid/sha1.hpp>
 #include "hiredis/hiredis.h"
 #include "hiredis/boostasio.hpp"
 
@@ -16,6 +19,7 @@
 #include "uveupdate_lua.cpp"
 #include "uvedelete_lua.cpp"
 #include "flushuves_lua.cpp"
+#include "uvebatch_lua.cpp"
 
 using std::string;
 using std::vector;
@@ -24,6 +28,178 @@ using std::map;
 using std::make_pair;
 using boost::assign::list_of;
 
+RedisScript::RedisScript(const unsigned char *text, unsigned int len)
+    : text_(reinterpret_cast<const char *>(text), len) {
+    boost::uuids::detail::sha1 sha1;
+    sha1.process_bytes(text_.data(), text_.size());
+    unsigned int digest[5];
+    sha1.get_digest(digest);
+    char hex[41];
+    for (int i = 0; i < 5; i++) {
+        snprintf(hex + i * 8, 9, "%08x", digest[i]);
+    }
+    sha_.assign(hex, 40);
+}
+
+bool RedisScript::NoScript(const redisReply *reply) {
+    return reply->type == REDIS_REPLY_ERROR &&
+        strncmp(reply->str, "NOSCRIPT", strlen("NOSCRIPT")) == 0;
+}
+
+//
+// An EVALSHA call of a script, owns itself until the reply is processed.
+// The reply is passed on to the parent processor, if any.
+//
+class RedisScriptCall : public RedisProcessorIf {
+public:
+    RedisScriptCall(RedisAsyncConnection *rac, RedisProcessorIf *parent,
+                    const RedisScript &script, vector<string> *args)
+        : rac_(rac), parent_(parent), script_(script), reloaded_(false) {
+        args_.swap(*args);
+    }
+
+    virtual bool RedisSend() {
+        return rac_->RedisAsyncArgCmd(this, args_);
+    }
+
+    virtual void ProcessCallback(redisReply *reply) {
+        if (reply && !reloaded_ && RedisScript::NoScript(reply)) {
+            // Send the script text, hiredis calls back with the
+            // connection locked, so the command is sent from the
+            // event manager
+            reloaded_ = true;
+            args_[0] = "EVAL";
+            args_[1] = script_.text();
+            rac_->GetEVM()->io_service()->post(
+                boost::bind(&RedisScriptCall::Resend, this));
+            return;
+        }
+        if (reply && parent_) {
+            parent_->ProcessCallback(reply);
+        }
+        delete this;
+    }
+
+    virtual void FinalResult() {
+    }
+
+    virtual std::string Key() {
+        return args_[1];
+    }
+
+private:
+    void Resend() {
+        if (!RedisSend()) {
+            delete this;
+        }
+    }
+
+    RedisAsyncConnection *rac_;
+    RedisProcessorIf *parent_;
+    const RedisScript &script_;
+    vector<string> args_;
+    bool reloaded_;
+};
+
+static bool ScriptCall(RedisAsyncConnection * rac, RedisProcessorIf *rpi,
+                       const RedisScript &script, vector<string> *args) {
+    RedisScriptCall *call = new RedisScriptCall(rac, rpi, script, args);
+    if (!call->RedisSend()) {
+        delete call;
+        return false;
+    }
+    return true;
+}
+
+const RedisScript &RedisProcessorExec::UVEUpdateScript() {
+    static const RedisScript script(uveupdate_lua, uveupdate_lua_len);
+    return script;
+}
+
+const RedisScript &RedisProcessorExec::UVEBatchScript() {
+    static const RedisScript script(uvebatch_lua, uvebatch_lua_len);
+    return script;
+}
+
+static const RedisScript &UVEDeleteScript() {
+    static const RedisScript script(uvedelete_lua, uvedelete_lua_len);
+    return script;
+}
+
+bool
+RedisProcessorExec::LoadScripts(RedisAsyncConnection * rac) {
+    const RedisScript *scripts[] = {
+        &UVEUpdateScript(), &UVEBatchScript(), &UVEDeleteScript()
+    };
+    bool ret = true;
+    for (size_t i = 0; i < sizeof(scripts) / sizeof(scripts[0]); i++) {
+        ret &= rac->RedisAsyncArgCmd(NULL,
+            list_of(string("SCRIPT"))("LOAD")(scripts[i]->text()));
+    }
+    return ret;
+}
+
+void
+RedisProcessorExec::UVEUpdateArgs(const RedisUVEUpdate &update,
+                                  vector<string> *args) {
+    const string &key = update.key;
+    size_t sep = key.find(":");
+    string table = key.substr(0, sep);
+    const string table_index(update.is_alarm ? "ALARM_TABLE:" : "TABLE:");
+    const string origin_index(update.is_alarm ? "ALARM_ORIGINS:" :
+                              "ORIGINS:");
+    const string sm(update.source + ":" + update.node_type + ":" +
+                    update.module + ":" + update.instance_id);
+
+    args->clear();
+    args->reserve(20);
+    args->push_back("EVALSHA");
+    args->push_back(UVEUpdateScript().sha());
+    args->push_back("5");
+    args->push_back("TYPES:" + sm);
+    args->push_back(origin_index + key);
+    args->push_back(table_index + table);
+    args->push_back("UVES:" + sm + ":" + update.type);
+    args->push_back("VALUES:" + key + ":" + sm + ":" + update.type);
+    args->push_back(update.source);
+    args->push_back(update.node_type);
+    args->push_back(update.module);
+    args->push_back(update.instance_id);
+    args->push_back(update.type);
+    args->push_back(update.attr);
+    args->push_back(key);
+    args->push_back(integerToString(update.seq));
+    args->push_back(update.message);
+    args->push_back(integerToString(REDIS_DB_UVE));
+    args->push_back(integerToString(update.part));
+    args->push_back(integerToString(update.is_alarm));
+}
+
+void
+RedisProcessorExec::UVEUpdateBatchArgs(const vector<RedisUVEUpdate> &updates,
+                                       vector<string> *args) {
+    args->clear();
+    args->reserve(4 + updates.size() * 11);
+    args->push_back("EVALSHA");
+    args->push_back(UVEBatchScript().sha());
+    args->push_back("0");
+    args->push_back(integerToString(REDIS_DB_UVE));
+    for (vector<RedisUVEUpdate>::const_iterator it = updates.begin();
+         it != updates.end(); ++it) {
+        args->push_back(it->source);
+        args->push_back(it->node_type);
+        args->push_back(it->module);
+        args->push_back(it->instance_id);
+        args->push_back(it->type);
+        args->push_back(it->attr);
+        args->push_back(it->key);
+        args->push_back(integerToString(it->seq));
+        args->push_back(it->message);
+        args->push_back(integerToString(it->part));
+        args->push_back(integerToString(it->is_alarm));
+    }
+}
+
 bool
 RedisProcessorExec::UVEUpdate(RedisAsyncConnection * rac, RedisProcessorIf *rpi,
                        const std::string &type, const std::string &attr,
@@ -34,33 +210,30 @@ RedisProcessorExec::UVEUpdate(RedisAsyncConnection * rac, RedisProcessorIf *rpi,
                        int32_t seq, const std::string &agg,
                        int64_t ts, unsigned int part,
                        bool is_alarm) {
-    
-    bool ret = false;
-    size_t sep = key.find(":");
-    string table = key.substr(0, sep);
-    std::ostringstream seqstr;
-    seqstr << seq;
-    std::ostringstream tsstr;
-    tsstr << "{\"ts\":" << ts << "}";
-    const std::string table_index(is_alarm ? "ALARM_TABLE:" : "TABLE:");
-    const std::string origin_index(is_alarm ? "ALARM_ORIGINS:" : "ORIGINS:");
+    RedisUVEUpdate update;
+    update.type = type;
+    update.attr = attr;
+    update.source = source;
+    update.node_type = node_type;
+    update.module = module;
+    update.instance_id = instance_id;
+    update.key = key;
+    update.message = msg;
+    update.seq = seq;
+    update.part = part;
+    update.is_alarm = is_alarm;
+
+    vector<string> args;
+    UVEUpdateArgs(update, &args);
+    return ScriptCall(rac, rpi, UVEUpdateScript(), &args);
+}
 
-    {
-        string lua_scr(reinterpret_cast<char *>(uveupdate_lua), uveupdate_lua_len);
-        ret = rac->RedisAsyncArgCmd(rpi,
-            list_of(string("EVAL"))(lua_scr)("5")(
-                string("TYPES:") + source + ":" + node_type + ":" + module + ":" + instance_id)(
-                origin_index + key)(
-                table_index + table)(
-                string("UVES:") + source + ":" + node_type + ":" + module +
-                ":" + instance_id + ":" + type)(
-                string("VALUES:") + key + ":" + source + ":" + node_type + 
-                ":" + module + ":" + instance_id + ":" + type)(
-                source)(node_type)(module)(instance_id)(type)(attr)(key)
-                (seqstr.str())(msg)(integerToString(REDIS_DB_UVE))
-                (integerToString(part))(integerToString(is_alarm)));
-    }
-    return ret;
+bool
+RedisProcessorExec::UVEUpdateBatch(RedisAsyncConnection * rac,
+        RedisProcessorIf *rpi, const vector<RedisUVEUpdate> &updates) {
+    vector<string> args;
+    UVEUpdateBatchArgs(updates, &args);
+    return ScriptCall(rac, rpi, UVEBatchScript(), &args);
 }
 
 bool
@@ -78,9 +251,7 @@ RedisProcessorExec::UVEDelete(RedisAsyncConnection * rac, RedisProcessorIf *rpi,
     const std::string table_index(is_alarm ? "ALARM_TABLE:" : "TABLE:");
     const std::string origin_index(is_alarm ? "ALARM_ORIGINS:" : "ORIGINS:");
 
-    string lua_scr(reinterpret_cast<char *>(uvedelete_lua), uvedelete_lua_len);
-    return rac->RedisAsyncArgCmd(rpi,
-        list_of(string("EVAL"))(lua_scr)("6")(
+    vector<string> args = list_of(string("EVALSHA"))(UVEDeleteScript().sha())("6")(
             string("DEL:") + key + ":" + source + ":" + node_type + ":" +
             module + ":" + instance_id + ":" + type + ":" + seqstr.str())(
             string("VALUES:") + key + ":" + source + ":" + node_type + ":" + 
@@ -91,8 +262,8 @@ RedisProcessorExec::UVEDelete(RedisAsyncConnection * rac, RedisProcessorIf *rpi,
             table_index + table)(
             string("DELETED"))(
             source)(node_type)(module)(instance_id)(type)(key)(
-            integerToString(REDIS_DB_UVE))(integerToString(is_alarm)));
-
+            integerToString(REDIS_DB_UVE))(integerToString(is_alarm));
+    return ScriptCall(rac, rpi, UVEDeleteScript(), &args);
 }
 
 
@@ -290,3 +461,62 @@ void RedisProcessorIf::ChildResult(const string& key, void * childRes) {
         FinalResult(); 
     }
 }
+
+bool RedisUVEBatch::Add(const RedisUVEUpdate &update) {
+    std::pair<map<string, size_t>::iterator, bool> ret =
+        index_.insert(make_pair(Id(update), updates_.size()));
+    if (ret.second) {
+        updates_.push_back(update);
+        return false;
+    }
+    RedisUVEUpdate &pending(updates_[ret.first->second]);
+    pending.message = update.message;
+    pending.seq = update.seq;
+    pending.part = update.part;
+    return true;
+}
+
+size_t RedisUVEBatch::RemoveGenerator(const string &source,
+        const string &node_type, const string &module,
+        const string &instance_id) {
+    vector<RedisUVEUpdate> updates;
+    updates.swap(updates_);
+    index_.clear();
+    size_t removed = 0;
+    for (vector<RedisUVEUpdate>::iterator it = updates.begin();
+         it != updates.end(); ++it) {
+        if (it->source == source && it->node_type == node_type &&
+            it->module == module && it->instance_id == instance_id) {
+            removed++;
+            continue;
+        }
+        index_.insert(make_pair(Id(*it), updates_.size()));
+        updates_.push_back(RedisUVEUpdate());
+        std::swap(updates_.back(), *it);
+    }
+    return removed;
+}
+
+void RedisUVEBatch::Swap(vector<RedisUVEUpdate> *updates) {
+    updates->clear();
+    updates->swap(updates_);
+    index_.clear();
+}
+
+// Attribute of a UVE from a generator, the fields can not contain NUL
+string RedisUVEBatch::Id(const RedisUVEUpdate &update) {
+    string id;
+    id.reserve(update.source.size() + update.node_type.size() +
+               update.module.size() + update.instance_id.size() +
+               update.type.size() + update.key.size() + update.attr.size() +
+               8);
+    id.append(update.source).push_back('\0');
+    id.append(update.node_type).push_back('\0');
+    id.append(update.module).push_back('\0');
+    id.append(update.instance_id).push_back('\0');
+    id.append(update.type).push_back('\0');
+    id.append(update.key).push_back('\0');
+    id.append(update.attr).push_back('\0');
+    id.push_back(update.is_alarm ? '1' : '0');
+    return id;
+}
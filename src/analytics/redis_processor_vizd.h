@@ -15,6 +15,76 @@
 class RedisAsyncConnection; 
 class RedisProcessorIf;
 
+//
+// A lua script that async commands run with EVALSHA. The scripts are
+// cached on the redis server with SCRIPT LOAD when the connection comes
+// up, a call that fails with NOSCRIPT (redis restarted or the script
+// cache was flushed) is sent again once with EVAL, which caches the
+// script again.
+//
+class RedisScript {
+public:
+    RedisScript(const unsigned char *text, unsigned int len);
+
+    const std::string &text() const { return text_; }
+    // Hex encoded SHA1 digest of the text
+    const std::string &sha() const { return sha_; }
+
+    // Whether redis failed a call because it does not have the script
+    static bool NoScript(const redisReply *reply);
+
+private:
+    std::string text_;
+    std::string sha_;
+};
+
+// Arguments of an update of a UVE attribute
+struct RedisUVEUpdate {
+    RedisUVEUpdate() : seq(0), part(0), is_alarm(false) {}
+
+    std::string type;
+    std::string attr;
+    std::string source;
+    std::string node_type;
+    std::string module;
+    std::string instance_id;
+    std::string key;
+    std::string message;
+    int32_t seq;
+    unsigned int part;
+    bool is_alarm;
+};
+
+//
+// UVE attribute updates waiting to be sent to redis in a batch. An update
+// of an attribute that is already pending replaces the pending update in
+// place, only the latest value of the attribute is sent.
+//
+class RedisUVEBatch {
+public:
+    RedisUVEBatch() {}
+
+    // Returns true if the update replaced a pending one
+    bool Add(const RedisUVEUpdate &update);
+    // Drops the pending updates from a generator, returns their count
+    size_t RemoveGenerator(const std::string &source,
+                           const std::string &node_type,
+                           const std::string &module,
+                           const std::string &instance_id);
+    // Moves the pending updates to updates, in the order they were added
+    void Swap(std::vector<RedisUVEUpdate> *updates);
+
+    size_t size() const { return updates_.size(); }
+    bool empty() const { return updates_.empty(); }
+
+private:
+    static std::string Id(const RedisUVEUpdate &update);
+
+    std::vector<RedisUVEUpdate> updates_;
+    // Index of the pending update of an attribute in updates_
+    std::map<std::string, size_t> index_;
+};
+
 class RedisProcessorExec {
 public:
     static bool
@@ -27,6 +97,11 @@ public:
                        int64_t ts, unsigned int part,
                        bool is_alarm);
 
+    // Applies updates with a single call of uvebatch.lua
+    static bool
+    UVEUpdateBatch(RedisAsyncConnection * rac, RedisProcessorIf *rpi,
+            const std::vector<RedisUVEUpdate> &updates);
+
     static bool
     UVEDelete(RedisAsyncConnection * rac, RedisProcessorIf *rpi,
             const std::string &type,
@@ -50,6 +125,19 @@ public:
     static bool
     FlushUVEs(const std::string & redis_ip, unsigned short redis_port,
             const std::string & redis_password);
+
+    // Caches the scripts run by the async commands on the redis server
+    static bool LoadScripts(RedisAsyncConnection * rac);
+
+    static const RedisScript &UVEUpdateScript();
+    static const RedisScript &UVEBatchScript();
+
+    // EVALSHA command of uveupdate.lua for an update
+    static void UVEUpdateArgs(const RedisUVEUpdate &update,
+            std::vector<std::string> *args);
+    // EVALSHA command of uvebatch.lua for updates
+    static void UVEUpdateBatchArgs(const std::vector<RedisUVEUpdate> &updates,
+            std::vector<std::string> *args);
 };
 
 class RedisProcessorIf {
@@ -92,14 +92,6 @@ bool Ruleeng::rule_present(const VizMsg *vmsgp) {
 }
 
 
-void Ruleeng::remove_identifier(const pugi::xml_node &parent) {
-    for (pugi::xml_node node = parent.first_child(); node;
-         node = node.next_sibling()) {
-        node.remove_attribute("identifier");
-        remove_identifier(node);
-    }
-}
-
 static DbHandler::Var ParseNode(const pugi::xml_node& node, bool silent = false) {
     DbHandler::Var sample;
 
@@ -397,46 +389,6 @@ static bool DomTopStatWalker(const pugi::xml_node& object,
     return true;
 }
 
-/*
- * Walk the XML DOM to find keys to record this message against.
- * Write to the objectlog accordingly
- */
-static size_t DomObjectWalk(const pugi::xml_node& parent, const VizMsg *rmsg,
-        DbHandler *db, uint64_t timestamp) {
-    std::map<std::string, std::string> keymap;
-    std::map<std::string, std::string>::iterator it;
-    const char *table;
-    std::string rowkey;
-
-    for (pugi::xml_node node = parent.first_child(); node;
-         node = node.next_sibling()) {
-        table = node.attribute("key").value();
-        if (strcmp(table, "")) {
-            rowkey = std::string(node.child_value());
-            TXMLProtocol::unescapeXMLControlChars(rowkey);
-            it = keymap.find(table);
-            if (it != keymap.end()) {
-                std::string tempstr(it->second);
-                tempstr.append(":");
-                tempstr.append(rowkey);
-                keymap.erase(it);
-                keymap.insert(std::pair<std::string, std::string>(table, tempstr));
-            } else {
-                keymap.insert(std::pair<std::string, std::string>(table, rowkey));
-            }
-        }
-    }
-    for (it = keymap.begin(); it != keymap.end(); it++) {
-        db->ObjectTableInsert(it->first, it->second, 
-            timestamp, rmsg->unm, rmsg);
-    }
-    for (pugi::xml_node node = parent.first_child(); node;
-         node = node.next_sibling()) {
-        DomObjectWalk(node, rmsg, db, timestamp);
-    }
-    return keymap.size();
-}
-
 /*
  * Check if any handling is needed for the message wrt to ObjectLog
  * Looks for the 'key' annotations for the table name and inserts
@@ -456,13 +408,23 @@ void Ruleeng::handle_object_log(const pugi::xml_node& parent, const VizMsg *rmsg
     std::string node_type(header.get_NodeType());
     SandeshType::type sandesh_type(header.get_Type());
 
-    DomObjectWalk(parent, rmsg, db, timestamp);
+    const VizMsgFields &fields(rmsg->fields());
+    for (VizMsgFields::ObjectKeyList::const_iterator it =
+         fields.object_keys.begin(); it != fields.object_keys.end(); ++it) {
+        db->ObjectTableInsert(it->first, it->second, timestamp, rmsg->unm,
+            rmsg);
+    }
 
     // UVE related stats are not processed here. See handle_uve_publish.
     if (sandesh_type == SandeshType::UVE) {
         return;
     }
 
+    // Only messages with stats are walked
+    if (!fields.has_stats) {
+        return;
+    }
+
     // All stats records the "name" field as a tag.
     // If no such field is present, use the source of
     // this message  
@@ -519,37 +481,9 @@ bool Ruleeng::handle_uve_publish(const pugi::xml_node& parent,
         return false;
     }
 
-    object = object.child("data");
-    object = object.first_child();
-
-    std::string barekey;
-    const char *tempstr;
-    std::string rowkey;
-    std::string table;
-
-    bool deleted = false;
-    for (pugi::xml_node node = object.first_child(); node;
-            node = node.next_sibling()) {
-        tempstr = node.attribute("key").value();
-        if (strcmp(tempstr, "")) {
-            rowkey = std::string(node.child_value());
-            TXMLProtocol::unescapeXMLControlChars(rowkey);
-            if (!barekey.empty()) {
-                barekey.append(":");
-                barekey.append(rowkey);
-            } else {
-                table = std::string(tempstr);
-                barekey.append(rowkey);
-                
-            }
-        }
-        if (!strcmp(node.name(), "deleted")) {
-            if (!strcmp(node.child_value(), "true")) {
-                deleted = true;
-            }
-        }
-    }
-
+    const VizMsgFields &fields(rmsg->fields());
+    const std::string &table(fields.uve_table);
+    const std::string &barekey(fields.uve_barekey);
     std::string key = table + ":" + barekey;
 
     if (table.empty()) {
@@ -559,8 +493,8 @@ bool Ruleeng::handle_uve_publish(const pugi::xml_node& parent,
         return false;
     }
 
-    if (deleted) {
-        if (!osp_->UVEDelete(object.name(), source, node_type, module, 
+    if (fields.uve_deleted) {
+        if (!osp_->UVEDelete(fields.uve_name, source, node_type, module,
                              instance_id, key, seq, is_alarm)) {
             LOG(ERROR, __func__ << " Cannot Delete " << key);
             PUBLISH_UVE_DELETE_TRACE(UVETraceBuf, source, module, type, key,
@@ -570,35 +504,26 @@ bool Ruleeng::handle_uve_publish(const pugi::xml_node& parent,
                 seq, true, node_type, instance_id);
         }
         LOG(DEBUG, __func__ << " Deleted " << key);
-        osp_->UVENotif(object.name(), 
-            source, node_type, module, instance_id, table, barekey, deleted);
+        osp_->UVENotif(fields.uve_name,
+            source, node_type, module, instance_id, table, barekey, true);
         return true;
     }
 
-    for (pugi::xml_node node = object.first_child(); node;
-           node = node.next_sibling()) {
-        std::ostringstream ostr; 
-        node.print(ostr, "", pugi::format_raw | pugi::format_no_escapes);
-        std::string agg;
-        std::string atyp;
-        tempstr = node.attribute("key").value();
-        if (strcmp(tempstr, "")) {
-            continue;
-        }
-        tempstr = node.attribute("aggtype").value();
-        if (strcmp(tempstr, "")) {
-            agg = std::string(tempstr);
-        } else {
-            agg = std::string("None");
-        }
+    // The DOM is only walked for the attributes with stats
+    object = object.child("data");
+    object = object.first_child();
 
-        if (!node.attribute("tags").empty()) {
+    for (std::vector<VizMsgFields::UVEAttr>::const_iterator it =
+         fields.uve_attrs.begin(); it != fields.uve_attrs.end(); ++it) {
+        const VizMsgFields::UVEAttr &attr(*it);
+        if (attr.has_tags) {
 
             // For messages send during UVE Sync, stats must be ignored
             if (header.get_Hints() & g_sandesh_constants.SANDESH_SYNC_HINT) {
                 continue;
             }
 
+            pugi::xml_node node = object.child(attr.name.c_str());
             pugi::xml_node anode_p =
                 object.child(g_viz_constants.STAT_OBJECTID_FIELD.c_str());
            
@@ -619,25 +544,25 @@ bool Ruleeng::handle_uve_publish(const pugi::xml_node& parent,
 
         }
         
-        if (!osp_->UVEUpdate(object.name(), node.name(),
+        if (!osp_->UVEUpdate(fields.uve_name, attr.name,
                              source, node_type, module, instance_id,
-                             table, barekey, ostr.str(), seq,
-                             agg, ts,
+                             table, barekey, attr.xml, seq,
+                             attr.aggtype, ts,
                              is_alarm)) {
             LOG(ERROR, __func__ << " Message: "  << type << " : " << source <<
               ":" << node_type << ":" << module << ":" << instance_id <<
-              " Name: " << object.name() <<  " UVEUpdate Failed"); 
+              " Name: " << fields.uve_name <<  " UVEUpdate Failed"); 
             PUBLISH_UVE_UPDATE_TRACE(UVETraceBuf, source, module, type, key, 
-                node.name(), false, node_type, instance_id);
+                attr.name, false, node_type, instance_id);
         } else {
             PUBLISH_UVE_UPDATE_TRACE(UVETraceBuf, source, module, type, key,
-                node.name(), true, node_type, instance_id);
+                attr.name, true, node_type, instance_id);
         }
     }
 
     // Publish on the Kafka bus that this UVE has changed
-    osp_->UVENotif(object.name(), 
-        source, node_type, module, instance_id, table, barekey, deleted);
+    osp_->UVENotif(fields.uve_name,
+        source, node_type, module, instance_id, table, barekey, false);
     return true;
 }
 
@@ -670,8 +595,6 @@ bool Ruleeng::rule_execute(const VizMsg *vmsgp, bool uveproc, DbHandler *db) {
         static_cast<const SandeshXMLMessage *>(vmsgp->msg);
     const pugi::xml_node &parent(sxmsg->GetMessageNode());
 
-    remove_identifier(parent);
-
     handle_object_log(parent, vmsgp, db, header);
 
     if (uveproc) handle_uve_publish(parent, vmsgp, db, header);
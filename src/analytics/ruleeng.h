@@ -53,8 +53,6 @@ class Ruleeng {
 
         void handle_object_log(const pugi::xml_node& parent,
             const VizMsg *rmsg, DbHandler *db, const SandeshHeader &header);
-
-        void remove_identifier(const pugi::xml_node& parent);
 };
 
 class Builder : public Task {
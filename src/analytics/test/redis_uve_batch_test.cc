@@ -0,0 +1,396 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <stdlib.h>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "testing/gunit.h"
+#include <base/time_util.h>
+#include <base/string_util.h>
+#include "base/contrail-globals.h"
+#include "hiredis/hiredis.h"
+
+#include "../redis_processor_vizd.h"
+
+using std::map;
+using std::string;
+using std::vector;
+
+static RedisUVEUpdate Update(const string &source, const string &key,
+                             const string &attr, int32_t seq,
+                             const string &message) {
+    RedisUVEUpdate update;
+    update.type = "UveVirtualNetworkAgent";
+    update.attr = attr;
+    update.source = source;
+    update.node_type = "Compute";
+    update.module = "contrail-vrouter-agent";
+    update.instance_id = "0";
+    update.key = key;
+    update.message = message;
+    update.seq = seq;
+    update.part = seq % 15;
+    update.is_alarm = false;
+    return update;
+}
+
+class RedisUVEBatchTest : public ::testing::Test {
+};
+
+TEST_F(RedisUVEBatchTest, Coalesce) {
+    RedisUVEBatch batch;
+    EXPECT_FALSE(batch.Add(Update("a1", "ObjectVNTable:vn1", "in_bytes", 1,
+                                  "<in_bytes>1</in_bytes>")));
+    EXPECT_FALSE(batch.Add(Update("a1", "ObjectVNTable:vn1", "out_bytes", 2,
+                                  "<out_bytes>1</out_bytes>")));
+    EXPECT_FALSE(batch.Add(Update("a2", "ObjectVNTable:vn1", "in_bytes", 1,
+                                  "<in_bytes>5</in_bytes>")));
+    EXPECT_TRUE(batch.Add(Update("a1", "ObjectVNTable:vn1", "in_bytes", 3,
+                                 "<in_bytes>2</in_bytes>")));
+    RedisUVEUpdate alarm(Update("a1", "ObjectVNTable:vn1", "in_bytes", 4,
+                                "<in_bytes>3</in_bytes>"));
+    alarm.is_alarm = true;
+    EXPECT_FALSE(batch.Add(alarm));
+    EXPECT_EQ(4U, batch.size());
+
+    // The latest update of an attribute takes the place of the first one
+    vector<RedisUVEUpdate> updates;
+    batch.Swap(&updates);
+    EXPECT_TRUE(batch.empty());
+    ASSERT_EQ(4U, updates.size());
+    EXPECT_EQ("in_bytes", updates[0].attr);
+    EXPECT_EQ(3, updates[0].seq);
+    EXPECT_EQ("<in_bytes>2</in_bytes>", updates[0].message);
+    EXPECT_EQ("out_bytes", updates[1].attr);
+    EXPECT_EQ("a2", updates[2].source);
+    EXPECT_TRUE(updates[3].is_alarm);
+
+    // The batch starts over once taken
+    EXPECT_FALSE(batch.Add(Update("a1", "ObjectVNTable:vn1", "in_bytes", 5,
+                                  "<in_bytes>4</in_bytes>")));
+}
+
+TEST_F(RedisUVEBatchTest, RemoveGenerator) {
+    RedisUVEBatch batch;
+    batch.Add(Update("a1", "ObjectVNTable:vn1", "in_bytes", 1, "1"));
+    batch.Add(Update("a2", "ObjectVNTable:vn1", "in_bytes", 1, "2"));
+    batch.Add(Update("a1", "ObjectVNTable:vn2", "in_bytes", 2, "3"));
+    batch.Add(Update("a3", "ObjectVNTable:vn2", "in_bytes", 1, "4"));
+    EXPECT_EQ(2U, batch.RemoveGenerator("a1", "Compute",
+                                        "contrail-vrouter-agent", "0"));
+    EXPECT_EQ(0U, batch.RemoveGenerator("a2", "Compute",
+                                        "contrail-vrouter-agent", "1"));
+    EXPECT_TRUE(batch.Add(Update("a3", "ObjectVNTable:vn2", "in_bytes", 2,
+                                 "5")));
+
+    vector<RedisUVEUpdate> updates;
+    batch.Swap(&updates);
+    ASSERT_EQ(2U, updates.size());
+    EXPECT_EQ("2", updates[0].message);
+    EXPECT_EQ("5", updates[1].message);
+}
+
+TEST_F(RedisUVEBatchTest, Script) {
+    const unsigned char text[] = { 'a', 'b', 'c' };
+    RedisScript script(text, sizeof(text));
+    EXPECT_EQ("abc", script.text());
+    EXPECT_EQ("a9993e364706816aba3e25717850c26c9cd0d89d", script.sha());
+
+    redisReply reply = redisReply();
+    char noscript[] = "NOSCRIPT No matching script. Please use EVAL.";
+    char busy[] = "BUSY Redis is busy running a script.";
+    reply.type = REDIS_REPLY_ERROR;
+    reply.str = noscript;
+    EXPECT_TRUE(RedisScript::NoScript(&reply));
+    reply.str = busy;
+    EXPECT_FALSE(RedisScript::NoScript(&reply));
+    reply.type = REDIS_REPLY_STRING;
+    reply.str = noscript;
+    EXPECT_FALSE(RedisScript::NoScript(&reply));
+}
+
+TEST_F(RedisUVEBatchTest, Args) {
+    vector<RedisUVEUpdate> updates;
+    updates.push_back(Update("a1", "ObjectVNTable:vn1", "in_bytes", 7, "m1"));
+    updates.push_back(Update("a2", "ObjectVNTable:vn2", "out_bytes", 8,
+                             "m2"));
+    updates[1].is_alarm = true;
+
+    vector<string> args;
+    RedisProcessorExec::UVEUpdateArgs(updates[0], &args);
+    ASSERT_EQ(20U, args.size());
+    EXPECT_EQ("EVALSHA", args[0]);
+    EXPECT_EQ(RedisProcessorExec::UVEUpdateScript().sha(), args[1]);
+    EXPECT_EQ("5", args[2]);
+    EXPECT_EQ("TABLE:ObjectVNTable", args[5]);
+    EXPECT_EQ("VALUES:ObjectVNTable:vn1:a1:Compute:contrail-vrouter-agent:0:"
+              "UveVirtualNetworkAgent", args[7]);
+    EXPECT_EQ("in_bytes", args[13]);
+    EXPECT_EQ("7", args[15]);
+    EXPECT_EQ("m1", args[16]);
+
+    RedisProcessorExec::UVEUpdateBatchArgs(updates, &args);
+    ASSERT_EQ(4U + 2 * 11, args.size());
+    EXPECT_EQ(RedisProcessorExec::UVEBatchScript().sha(), args[1]);
+    EXPECT_EQ("0", args[2]);
+    EXPECT_EQ(integerToString(REDIS_DB_UVE), args[3]);
+    EXPECT_EQ("a1", args[4]);
+    EXPECT_EQ("in_bytes", args[9]);
+    EXPECT_EQ("m1", args[12]);
+    EXPECT_EQ("0", args[14]);
+    EXPECT_EQ("a2", args[15]);
+    EXPECT_EQ("1", args[25]);
+}
+
+//
+// UVE attribute updates/sec against a local redis-server, the updates are
+// pipelined on a single connection as the collector does. The benchmark
+// uses db kBenchmarkDb, which it flushes, and is skipped when no server
+// is listening on REDIS_SERVER_PORT (6379 by default).
+//
+class RedisUVEBatchBenchmark : public ::testing::Test {
+protected:
+    static const int kBenchmarkDb = 15;
+    static const size_t kGenerators = 16;
+    static const size_t kUVEs = 500;
+    static const size_t kAttrs = 8;
+    static const size_t kUpdates = 100000;
+    static const size_t kPipelineDepth = 512;
+    static const size_t kBatchSize = 256;
+    // Updates that arrive within a coalescing window
+    static const size_t kWindowUpdates = 2048;
+
+    enum Mode {
+        EVAL,
+        EVALSHA,
+        BATCH,
+        COALESCED_BATCH
+    };
+
+    virtual void SetUp() {
+        const char *port = getenv("REDIS_SERVER_PORT");
+        context_ = redisConnect("127.0.0.1", port ? atoi(port) : 6379);
+        if (context_ && context_->err) {
+            redisFree(context_);
+            context_ = NULL;
+        }
+        if (!context_) {
+            return;
+        }
+        freeReplyObject(Command("SELECT " +
+                                integerToString(kBenchmarkDb)));
+        srand(0x5eed);
+        for (size_t i = 0; i < kUpdates; i++) {
+            // A few attributes of a few UVEs change most often
+            size_t uve = (rand() % kUVEs) * (rand() % kUVEs) / kUVEs;
+            size_t attr = (rand() % kAttrs) * (rand() % kAttrs) / kAttrs;
+            std::ostringstream key, name, message;
+            key << "ObjectVNTable:default-domain:admin:vn" << uve;
+            name << "attr" << attr;
+            message << "<" << name.str() << " type=\"struct\">"
+                "<VnStats><in_bytes type=\"u64\">" << rand() <<
+                "</in_bytes><out_bytes type=\"u64\">" << rand() <<
+                "</out_bytes><in_pkts type=\"u64\">" << i <<
+                "</in_pkts></VnStats></" << name.str() << ">";
+            std::ostringstream source;
+            source << "a" << uve % kGenerators;
+            updates_.push_back(Update(source.str(), key.str(), name.str(),
+                                      i + 1, message.str()));
+        }
+    }
+
+    virtual void TearDown() {
+        if (context_) {
+            freeReplyObject(Command("FLUSHDB"));
+            redisFree(context_);
+        }
+    }
+
+    redisReply *Command(const string &cmd) {
+        return static_cast<redisReply *>(
+            redisCommand(context_, cmd.c_str()));
+    }
+
+    void Reset() {
+        freeReplyObject(Command("FLUSHDB"));
+        freeReplyObject(Command("SCRIPT FLUSH"));
+        for (size_t i = 0; i < kGenerators; i++) {
+            std::ostringstream sm;
+            sm << "a" << i << ":Compute:contrail-vrouter-agent:0";
+            freeReplyObject(Command("SADD NGENERATORS " + sm.str()));
+        }
+        pending_ = 0;
+        errors_ = 0;
+    }
+
+    // Caches the scripts as the collector does when the connection comes
+    // up
+    void LoadScripts() {
+        const RedisScript *scripts[] = {
+            &RedisProcessorExec::UVEUpdateScript(),
+            &RedisProcessorExec::UVEBatchScript()
+        };
+        for (size_t i = 0; i < 2; i++) {
+            redisReply *reply = static_cast<redisReply *>(
+                redisCommand(context_, "SCRIPT LOAD %b",
+                             scripts[i]->text().data(),
+                             scripts[i]->text().size()));
+            EXPECT_EQ(scripts[i]->sha(), string(reply->str, reply->len));
+            freeReplyObject(reply);
+        }
+    }
+
+    void Append(vector<string> *args, size_t db_arg) {
+        (*args)[db_arg] = integerToString(kBenchmarkDb);
+        vector<const char *> argv;
+        vector<size_t> argvlen;
+        for (size_t i = 0; i < args->size(); i++) {
+            argv.push_back((*args)[i].data());
+            argvlen.push_back((*args)[i].size());
+        }
+        redisAppendCommandArgv(context_, argv.size(), &argv[0],
+                               &argvlen[0]);
+        if (++pending_ == kPipelineDepth) {
+            Drain();
+        }
+    }
+
+    void Drain() {
+        for (; pending_ > 0; pending_--) {
+            void *reply;
+            ASSERT_EQ(REDIS_OK, redisGetReply(context_, &reply));
+            if (static_cast<redisReply *>(reply)->type ==
+                REDIS_REPLY_ERROR) {
+                errors_++;
+            }
+            freeReplyObject(reply);
+        }
+    }
+
+    void SendBatch(const vector<RedisUVEUpdate> &updates) {
+        if (updates.empty()) {
+            return;
+        }
+        vector<string> args;
+        RedisProcessorExec::UVEUpdateBatchArgs(updates, &args);
+        Append(&args, 3);
+    }
+
+    // Returns the updates/sec
+    uint64_t Run(Mode mode) {
+        Reset();
+        if (mode != EVAL) {
+            LoadScripts();
+        }
+        uint64_t start = ClockMonotonicUsec();
+        vector<string> args;
+        vector<RedisUVEUpdate> batch;
+        RedisUVEBatch coalesced;
+        for (size_t i = 0; i < updates_.size(); i++) {
+            switch (mode) {
+            case EVAL:
+                RedisProcessorExec::UVEUpdateArgs(updates_[i], &args);
+                args[0] = "EVAL";
+                args[1] = RedisProcessorExec::UVEUpdateScript().text();
+                Append(&args, 17);
+                break;
+            case EVALSHA:
+                RedisProcessorExec::UVEUpdateArgs(updates_[i], &args);
+                Append(&args, 17);
+                break;
+            case BATCH:
+                batch.push_back(updates_[i]);
+                if (batch.size() == kBatchSize) {
+                    SendBatch(batch);
+                    batch.clear();
+                }
+                break;
+            case COALESCED_BATCH:
+                coalesced.Add(updates_[i]);
+                if (coalesced.size() == kBatchSize ||
+                    (i + 1) % kWindowUpdates == 0) {
+                    coalesced.Swap(&batch);
+                    SendBatch(batch);
+                }
+                break;
+            }
+        }
+        if (mode == COALESCED_BATCH) {
+            coalesced.Swap(&batch);
+        }
+        SendBatch(batch);
+        Drain();
+        uint64_t usec = ClockMonotonicUsec() - start;
+        EXPECT_EQ(0U, errors_);
+        Verify();
+        return updates_.size() * 1000000ULL / (usec ? usec : 1);
+    }
+
+    // Every mode leaves the same UVEs in redis
+    void Verify() {
+        map<string, map<string, string> > values;
+        map<string, int32_t> seqs;
+        for (size_t i = 0; i < updates_.size(); i++) {
+            const RedisUVEUpdate &update(updates_[i]);
+            string sm(update.source + ":" + update.node_type + ":" +
+                      update.module + ":" + update.instance_id);
+            values["VALUES:" + update.key + ":" + sm + ":" + update.type]
+                [update.attr] = update.message;
+            seqs[update.key] = update.seq;
+        }
+        for (map<string, map<string, string> >::const_iterator it =
+             values.begin(); it != values.end(); ++it) {
+            redisReply *reply = static_cast<redisReply *>(
+                redisCommand(context_, "HGETALL %s", it->first.c_str()));
+            ASSERT_EQ(REDIS_REPLY_ARRAY, reply->type);
+            map<string, string> hash;
+            for (size_t j = 0; j + 1 < reply->elements; j += 2) {
+                hash[reply->element[j]->str] = string(
+                    reply->element[j + 1]->str, reply->element[j + 1]->len);
+            }
+            freeReplyObject(reply);
+            EXPECT_TRUE(it->second == hash) << it->first;
+        }
+        const RedisUVEUpdate &last(updates_.back());
+        redisReply *reply = static_cast<redisReply *>(
+            redisCommand(context_, "ZSCORE UVES:%s:%s:%s:%s:%s %s",
+                         last.source.c_str(), last.node_type.c_str(),
+                         last.module.c_str(), last.instance_id.c_str(),
+                         last.type.c_str(), last.key.c_str()));
+        ASSERT_EQ(REDIS_REPLY_STRING, reply->type);
+        EXPECT_EQ(seqs[last.key], atoi(reply->str));
+        freeReplyObject(reply);
+    }
+
+    redisContext *context_;
+    vector<RedisUVEUpdate> updates_;
+    size_t pending_;
+    size_t errors_;
+};
+
+const int RedisUVEBatchBenchmark::kBenchmarkDb;
+
+TEST_F(RedisUVEBatchBenchmark, UpdatesPerSec) {
+    if (!context_) {
+        std::cout << "No redis-server, skipping" << std::endl;
+        return;
+    }
+    uint64_t eval = Run(EVAL);
+    uint64_t evalsha = Run(EVALSHA);
+    uint64_t batch = Run(BATCH);
+    uint64_t coalesced = Run(COALESCED_BATCH);
+    std::cout << kUpdates << " UVE attribute updates/sec: EVAL " << eval <<
+        ", EVALSHA " << evalsha << ", batch of " << kBatchSize << " " <<
+        batch << ", coalesced batch " << coalesced << std::endl;
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    int result = RUN_ALL_TESTS();
+    return result;
+}
@@ -0,0 +1,382 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <string.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <pugixml/pugixml.hpp>
+
+#include "testing/gunit.h"
+#include <base/time_util.h>
+
+#include "../viz_msg_decoder.h"
+
+using std::string;
+using std::vector;
+
+static const int kAllFlags = VizMsgDecoder::OBJECT_KEYS |
+    VizMsgDecoder::KEYWORDS | VizMsgDecoder::UVE;
+
+//
+// The DOM walks that the rule engine did for every message, now the
+// fallback of VizMsg when the text can not be decoded. The reference for
+// the decoder.
+//
+class DomReference {
+public:
+    // Same order as rule_execute: the message is stored, and its keywords
+    // indexed, before the identifiers are removed
+    static void Process(const pugi::xml_node &message, int flags,
+                        bool store, VizMsgFields *fields) {
+        if (store) {
+            std::ostringstream ostr;
+            message.print(ostr, "", pugi::format_raw |
+                          pugi::format_no_escapes);
+            fields->xml = ostr.str();
+        }
+        VizMsgDomDecoder decoder(message, flags, fields);
+        decoder.Decode();
+    }
+};
+
+class VizMsgDecoderTest : public ::testing::Test {
+protected:
+    bool Decode(const string &xml, int flags, VizMsgFields *fields) {
+        VizMsgDecoder decoder(xml, flags, fields);
+        return decoder.Decode();
+    }
+
+    void ExpectEqual(const VizMsgFields &expected,
+                     const VizMsgFields &actual, int flags) {
+        EXPECT_TRUE(expected.object_keys == actual.object_keys);
+        EXPECT_EQ(expected.keyword_doc, actual.keyword_doc);
+        if (flags & VizMsgDecoder::OBJECT_KEYS) {
+            EXPECT_EQ(expected.has_stats, actual.has_stats);
+        }
+        EXPECT_EQ(expected.uve_name, actual.uve_name);
+        EXPECT_EQ(expected.uve_table, actual.uve_table);
+        EXPECT_EQ(expected.uve_barekey, actual.uve_barekey);
+        EXPECT_EQ(expected.uve_deleted, actual.uve_deleted);
+        ASSERT_EQ(expected.uve_attrs.size(), actual.uve_attrs.size());
+        for (size_t i = 0; i < expected.uve_attrs.size(); i++) {
+            EXPECT_EQ(expected.uve_attrs[i].name, actual.uve_attrs[i].name);
+            EXPECT_EQ(expected.uve_attrs[i].aggtype,
+                      actual.uve_attrs[i].aggtype);
+            EXPECT_EQ(expected.uve_attrs[i].has_tags,
+                      actual.uve_attrs[i].has_tags);
+            EXPECT_EQ(expected.uve_attrs[i].xml, actual.uve_attrs[i].xml);
+        }
+    }
+
+    // Message as printed by SandeshXMLMessage::ExtractMessage
+    string Print(const string &xml, pugi::xml_document *doc) {
+        doc->load_buffer(xml.c_str(), xml.size(),
+                         pugi::parse_default & ~pugi::parse_escapes);
+        std::ostringstream ostr;
+        doc->first_child().print(ostr, "", pugi::format_raw |
+                                 pugi::format_no_escapes);
+        return ostr.str();
+    }
+};
+
+TEST_F(VizMsgDecoderTest, ObjectKeys) {
+    string xml("<XmppPeerLog type=\"sandesh\">"
+        "<peer type=\"string\" identifier=\"1\" key=\"ObjectXmppPeer\">"
+        "a&amp;b</peer>"
+        "<vrf type=\"string\" identifier=\"2\" key=\"ObjectVRouter\">"
+        "vr1</vrf>"
+        "<addr type=\"string\" identifier=\"3\" key=\"ObjectXmppPeer\">"
+        "10.1.1.1</addr>"
+        "<info type=\"struct\" identifier=\"4\"><PeerInfo>"
+        "<vn type=\"string\" identifier=\"1\" key=\"ObjectVNTable\">vn1</vn>"
+        "</PeerInfo></info>"
+        "</XmppPeerLog>");
+    VizMsgFields fields;
+    EXPECT_TRUE(Decode(xml, VizMsgDecoder::OBJECT_KEYS, &fields));
+    ASSERT_EQ(3U, fields.object_keys.size());
+    EXPECT_EQ("ObjectVRouter", fields.object_keys[0].first);
+    EXPECT_EQ("vr1", fields.object_keys[0].second);
+    EXPECT_EQ("ObjectXmppPeer", fields.object_keys[1].first);
+    EXPECT_EQ("a&b:10.1.1.1", fields.object_keys[1].second);
+    EXPECT_EQ("ObjectVNTable", fields.object_keys[2].first);
+    EXPECT_EQ("vn1", fields.object_keys[2].second);
+    EXPECT_FALSE(fields.has_stats);
+    EXPECT_TRUE(fields.keyword_doc.empty());
+    EXPECT_TRUE(fields.uve_attrs.empty());
+}
+
+TEST_F(VizMsgDecoderTest, Keywords) {
+    string xml("<SysLog type=\"sandesh\">"
+        "<f1 type=\"string\" identifier=\"1\">Peer</f1>"
+        "<f2 type=\"i32\" identifier=\"2\">10</f2>"
+        "<f3 type=\"string\" identifier=\"3\"/>"
+        "<f4 type=\"string\" identifier=\"4\">up \xc3\xa9t\xc3\xa9</f4>"
+        "</SysLog>");
+    VizMsgFields fields;
+    EXPECT_TRUE(Decode(xml, VizMsgDecoder::KEYWORDS, &fields));
+    EXPECT_EQ(" Peer  up &#195;&#169;t&#195;&#169;", fields.keyword_doc);
+}
+
+TEST_F(VizMsgDecoderTest, UVE) {
+    string xml("<UveVirtualNetworkAgentTrace type=\"sandesh\">"
+        "<data type=\"struct\" identifier=\"1\"><UveVirtualNetworkAgent>"
+        "<name type=\"string\" identifier=\"1\" key=\"ObjectVNTable\">"
+        "default-domain:admin:vn1</name>"
+        "<deleted type=\"bool\" identifier=\"2\">false</deleted>"
+        "<in_tpkts type=\"u64\" identifier=\"3\" aggtype=\"counter\">"
+        "10</in_tpkts>"
+        "<in_stats type=\"list\" identifier=\"4\" tags=\".other_vn\">"
+        "<list type=\"struct\" size=\"1\"><UveInterVnStats>"
+        "<other_vn type=\"string\" identifier=\"1\">vn2</other_vn>"
+        "</UveInterVnStats></list></in_stats>"
+        "</UveVirtualNetworkAgent></data>"
+        "</UveVirtualNetworkAgentTrace>");
+    VizMsgFields fields;
+    EXPECT_TRUE(Decode(xml, VizMsgDecoder::UVE, &fields));
+    EXPECT_EQ("UveVirtualNetworkAgent", fields.uve_name);
+    EXPECT_EQ("ObjectVNTable", fields.uve_table);
+    EXPECT_EQ("default-domain:admin:vn1", fields.uve_barekey);
+    EXPECT_FALSE(fields.uve_deleted);
+    ASSERT_EQ(3U, fields.uve_attrs.size());
+    EXPECT_EQ("deleted", fields.uve_attrs[0].name);
+    EXPECT_EQ("None", fields.uve_attrs[0].aggtype);
+    EXPECT_EQ("<deleted type=\"bool\">false</deleted>",
+              fields.uve_attrs[0].xml);
+    EXPECT_EQ("counter", fields.uve_attrs[1].aggtype);
+    EXPECT_FALSE(fields.uve_attrs[1].has_tags);
+    EXPECT_EQ("in_stats", fields.uve_attrs[2].name);
+    EXPECT_TRUE(fields.uve_attrs[2].has_tags);
+    EXPECT_EQ("<in_stats type=\"list\" tags=\".other_vn\">"
+        "<list type=\"struct\" size=\"1\"><UveInterVnStats>"
+        "<other_vn type=\"string\">vn2</other_vn>"
+        "</UveInterVnStats></list></in_stats>", fields.uve_attrs[2].xml);
+
+    // Deleted UVE
+    size_t pos = xml.find(">false<");
+    xml.replace(pos, 7, ">true<");
+    VizMsgFields deleted;
+    EXPECT_TRUE(Decode(xml, VizMsgDecoder::UVE, &deleted));
+    EXPECT_TRUE(deleted.uve_deleted);
+}
+
+TEST_F(VizMsgDecoderTest, Malformed) {
+    VizMsgFields fields;
+    EXPECT_FALSE(Decode("<a><b></a>", kAllFlags, &fields));
+    EXPECT_FALSE(Decode("<a><b>", kAllFlags, &fields));
+    EXPECT_FALSE(Decode("<a b=\"c></a>", kAllFlags, &fields));
+    EXPECT_TRUE(Decode("<a><!-- <b> --><![CDATA[<c>]]></a>", kAllFlags,
+                       &fields));
+}
+
+//
+// A corpus of UVE, system log and flow log messages, each one as the
+// collector receives it. The reference is the DOM walks done before the
+// decoder, on the same DOM that the sandesh library builds.
+//
+class VizMsgDecoderBenchmark : public VizMsgDecoderTest {
+protected:
+    struct Message {
+        Message(const string &xml, int flags, bool store)
+            : xml(xml), flags(flags), store(store) {
+        }
+        string xml;
+        int flags;
+        // Flow messages are not stored in the message table
+        bool store;
+    };
+
+    static string Field(const string &name, const string &type,
+                        const string &value, int identifier,
+                        const string &annotations = "") {
+        std::ostringstream ostr;
+        ostr << "<" << name << " type=\"" << type << "\" identifier=\"" <<
+            identifier << "\"" << annotations << ">" << value << "</" <<
+            name << ">";
+        return ostr.str();
+    }
+
+    static string VnStats(int i, int count) {
+        std::ostringstream ostr;
+        ostr << "<list type=\"struct\" size=\"" << count << "\">";
+        for (int j = 0; j < count; j++) {
+            std::ostringstream vn;
+            vn << "default-domain:admin:vn" << (i + j);
+            ostr << "<UveInterVnStats>" <<
+                Field("other_vn", "string", vn.str(), 1) <<
+                Field("tpkts", "u64", "123456", 2) <<
+                Field("bytes", "u64", "98765432", 3) <<
+                "</UveInterVnStats>";
+        }
+        ostr << "</list>";
+        return ostr.str();
+    }
+
+    static string UVE(int i) {
+        std::ostringstream vn;
+        vn << "default-domain:admin:vn" << i;
+        return "<UveVirtualNetworkAgentTrace type=\"sandesh\">"
+            "<data type=\"struct\" identifier=\"1\">"
+            "<UveVirtualNetworkAgent>" +
+            Field("name", "string", vn.str(), 1, " key=\"ObjectVNTable\"") +
+            Field("deleted", "bool", "false", 2) +
+            Field("total_acl_rules", "u32", "12", 3) +
+            Field("in_tpkts", "u64", "123456", 4, " aggtype=\"counter\"") +
+            Field("out_tpkts", "u64", "654321", 5, " aggtype=\"counter\"") +
+            Field("in_stats", "list", VnStats(i, 4), 6,
+                  " aggtype=\"append\"") +
+            Field("out_stats", "list", VnStats(i, 4), 7,
+                  " aggtype=\"append\"") +
+            Field("virtualmachine_list", "list",
+                  "<list type=\"string\" size=\"2\">"
+                  "<element>vm1</element><element>vm2</element></list>",
+                  8, " aggtype=\"union\"") +
+            "</UveVirtualNetworkAgent></data>"
+            "</UveVirtualNetworkAgentTrace>";
+    }
+
+    static string SystemLog(int i) {
+        std::ostringstream peer;
+        peer << "10.1." << (i / 256) % 256 << "." << i % 256;
+        return "<XmppPeerLog type=\"sandesh\">" +
+            Field("f1", "string", "Peer", 1) +
+            Field("name", "string", peer.str(), 2,
+                  " key=\"ObjectXmppConnection\"") +
+            Field("f3", "string", "State Machine: Event", 3) +
+            Field("event", "string", "xmsm::EvXmppOpen", 4) +
+            Field("f5", "string", "state", 5) +
+            Field("state", "string", "Established", 6) +
+            Field("last_event_at", "u64", "1440000000000000", 7) +
+            "</XmppPeerLog>";
+    }
+
+    static string FlowLog(int i, int count) {
+        std::ostringstream ostr;
+        ostr << "<FlowDataIpv4Object type=\"sandesh\">"
+            "<flowdata type=\"list\" identifier=\"1\">"
+            "<list type=\"struct\" size=\"" << count << "\">";
+        for (int j = 0; j < count; j++) {
+            ostr << "<FlowDataIpv4>" <<
+                Field("flowuuid", "string",
+                      "c0ffee00-0000-4000-8000-000000000000", 1) <<
+                Field("direction_ing", "byte", "1", 2) <<
+                Field("sourcevn", "string", "default-domain:admin:vn1", 3) <<
+                Field("sourceip", "i32", "167837953", 4) <<
+                Field("destvn", "string", "default-domain:admin:vn2", 5) <<
+                Field("destip", "i32", "167838209", 6) <<
+                Field("protocol", "byte", "6", 7) <<
+                Field("sport", "i16", "33000", 8) <<
+                Field("dport", "i16", "80", 9) <<
+                Field("vrouter", "string", "a6s1", 10) <<
+                Field("setup_time", "u64", "1440000000000000", 11) <<
+                Field("bytes", "u64", "1000", 12) <<
+                Field("packets", "u64", "10", 13) <<
+                Field("diff_bytes", "u64", "100", 14) <<
+                Field("diff_packets", "u64", "1", 15) <<
+                "</FlowDataIpv4>";
+        }
+        ostr << "</list></flowdata></FlowDataIpv4Object>";
+        (void)i;
+        return ostr.str();
+    }
+
+    void Generate(int count, vector<Message> *corpus) {
+        for (int i = 0; i < count; i++) {
+            corpus->push_back(Message(UVE(i), VizMsgDecoder::OBJECT_KEYS |
+                                      VizMsgDecoder::UVE, true));
+            corpus->push_back(Message(SystemLog(i),
+                                      VizMsgDecoder::OBJECT_KEYS |
+                                      VizMsgDecoder::KEYWORDS, true));
+            corpus->push_back(Message(FlowLog(i, 8), 0, false));
+        }
+    }
+};
+
+// The decoder extracts the same fields as the DOM walks
+TEST_F(VizMsgDecoderBenchmark, Reference) {
+    vector<Message> corpus;
+    Generate(16, &corpus);
+    for (size_t i = 0; i < corpus.size(); i++) {
+        const Message &message(corpus[i]);
+        pugi::xml_document doc;
+        string xml(Print(message.xml, &doc));
+        VizMsgFields expected;
+        DomReference::Process(doc.first_child(), kAllFlags, true,
+                              &expected);
+        EXPECT_EQ(xml, expected.xml);
+        VizMsgFields actual;
+        EXPECT_TRUE(Decode(xml, kAllFlags, &actual));
+        ExpectEqual(expected, actual, kAllFlags);
+    }
+}
+
+//
+// Per message, the rule engine used to print the message for the message
+// table, walk the DOM for the keywords, the identifiers, the object keys
+// and the UVE attributes, printing each one. It now prints the message
+// once and decodes the text. Flow messages, that are only walked for the
+// flow table, are no longer walked to remove the identifiers.
+//
+TEST_F(VizMsgDecoderBenchmark, Throughput) {
+    const int kIterations = 20;
+    vector<Message> corpus;
+    Generate(1000, &corpus);
+    // The DOM walks remove the identifiers, each path has its own DOMs
+    boost::ptr_vector<pugi::xml_document> docs, decoder_docs;
+    size_t bytes = 0;
+    for (size_t i = 0; i < corpus.size(); i++) {
+        docs.push_back(new pugi::xml_document);
+        Print(corpus[i].xml, &docs.back());
+        decoder_docs.push_back(new pugi::xml_document);
+        Print(corpus[i].xml, &decoder_docs.back());
+        bytes += corpus[i].xml.size();
+    }
+
+    uint64_t start = ClockMonotonicUsec();
+    size_t dom_attrs = 0;
+    for (int n = 0; n < kIterations; n++) {
+        for (size_t i = 0; i < corpus.size(); i++) {
+            VizMsgFields fields;
+            DomReference::Process(docs[i].first_child(), corpus[i].flags,
+                                  corpus[i].store, &fields);
+            dom_attrs += fields.uve_attrs.size();
+        }
+    }
+    uint64_t dom_usec = ClockMonotonicUsec() - start;
+
+    start = ClockMonotonicUsec();
+    size_t decoder_attrs = 0;
+    for (int n = 0; n < kIterations; n++) {
+        for (size_t i = 0; i < corpus.size(); i++) {
+            if (!corpus[i].store && !corpus[i].flags) {
+                continue;
+            }
+            VizMsgFields fields;
+            std::ostringstream ostr;
+            decoder_docs[i].first_child().print(ostr, "",
+                pugi::format_raw | pugi::format_no_escapes);
+            fields.xml = ostr.str();
+            EXPECT_TRUE(Decode(fields.xml, corpus[i].flags, &fields));
+            decoder_attrs += fields.uve_attrs.size();
+        }
+    }
+    uint64_t decoder_usec = ClockMonotonicUsec() - start;
+
+    EXPECT_EQ(dom_attrs, decoder_attrs);
+    size_t messages = kIterations * corpus.size();
+    std::cout << messages << " messages (" << bytes / corpus.size() <<
+        " bytes avg): DOM walks " << dom_usec << " usec (" <<
+        messages * 1000000 / (dom_usec + 1) << " msgs/sec), decoder " <<
+        decoder_usec << " usec (" <<
+        messages * 1000000 / (decoder_usec + 1) << " msgs/sec)" <<
+        std::endl;
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    int result = RUN_ALL_TESTS();
+    return result;
+}
@@ -0,0 +1,113 @@
+--
+-- Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+--
+
+-- Applies a batch of UVE attribute updates, with the same effect as
+-- running uveupdate.lua for each of them in order.
+--
+-- ARGV[1] is the db, followed by 11 arguments per update:
+--   source, node_type, module, instance_id, type, attr, key, seq, value,
+--   part, is_alarm
+--
+-- Set members are added once per batch, and the fields of a hash are set
+-- with a single hmset. Returns the number of updates applied, updates from
+-- generators that are not in NGENERATORS are dropped.
+
+local db = tonumber(ARGV[1])
+
+redis.call('select',db)
+
+local generators = {}
+local members = {}
+local hashes = {}
+local hash_order = {}
+local zsets = {}
+local zset_order = {}
+local applied = 0
+
+local function sadd(set, member)
+    local id = set.."\n"..member
+    if members[id] == nil then
+        members[id] = true
+        redis.call('sadd', set, member)
+    end
+end
+
+local function hset(hash, field, value)
+    local fields = hashes[hash]
+    if fields == nil then
+        fields = {}
+        hashes[hash] = fields
+        hash_order[#hash_order + 1] = hash
+    end
+    fields[field] = value
+end
+
+local function zadd(zset, score, member)
+    local scores = zsets[zset]
+    if scores == nil then
+        scores = {}
+        zsets[zset] = scores
+        zset_order[#zset_order + 1] = zset
+    end
+    scores[member] = score
+end
+
+local i = 2
+while i + 10 <= #ARGV do
+    local sm = ARGV[i]..":"..ARGV[i+1]..":"..ARGV[i+2]..":"..ARGV[i+3]
+    local typ = ARGV[i+4]
+    local attr = ARGV[i+5]
+    local key = ARGV[i+6]
+    local seq = ARGV[i+7]
+    local val = ARGV[i+8]
+    local part = ARGV[i+9]
+    local is_alarm = tonumber(ARGV[i+10])
+    i = i + 11
+
+    local ism = generators[sm]
+    if ism == nil then
+        ism = redis.call('sismember', 'NGENERATORS', sm)
+        generators[sm] = ism
+    end
+
+    if ism == 1 then
+        local tbl = string.match(key, "^[^:]*")
+        local table_index = "TABLE:"
+        local origin_index = "ORIGINS:"
+        if is_alarm == 0 then
+            sadd("PART2KEY:"..part, sm..":"..typ..":"..key)
+            hset("KEY2PART:"..sm..":"..typ, key, part)
+        else
+            table_index = "ALARM_TABLE:"
+            origin_index = "ALARM_ORIGINS:"
+        end
+
+        sadd("TYPES:"..sm, typ)
+        sadd(origin_index..key, sm..":"..typ)
+        sadd(table_index..tbl, key..':'..sm..":"..typ)
+        zadd("UVES:"..sm..":"..typ, seq, key)
+        hset("VALUES:"..key..":"..sm..":"..typ, attr, val)
+        applied = applied + 1
+    end
+end
+
+for _, zset in ipairs(zset_order) do
+    local args = {}
+    for member, score in pairs(zsets[zset]) do
+        args[#args + 1] = score
+        args[#args + 1] = member
+    end
+    redis.call('zadd', zset, unpack(args))
+end
+
+for _, hash in ipairs(hash_order) do
+    local args = {}
+    for field, value in pairs(hashes[hash]) do
+        args[#args + 1] = field
+        args[#args + 1] = value
+    end
+    redis.call('hmset', hash, unpack(args))
+end
+
+return applied
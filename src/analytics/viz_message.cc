@@ -6,9 +6,44 @@
 
 #include <base/logging.h>
 #include <base/util.h>
+#include <sandesh/sandesh_constants.h>
 #include <sandesh/sandesh_message_builder.h>
 #include "collector_uve_types.h"
 
+const VizMsgFields &VizMsg::fields() const {
+    if (fields_) {
+        return *fields_;
+    }
+    const SandeshHeader &header(msg->GetHeader());
+    int flags = 0;
+    if (header.get_Hints() & g_sandesh_constants.SANDESH_KEY_HINT) {
+        flags |= VizMsgDecoder::OBJECT_KEYS;
+    }
+    if (header.get_Type() == SandeshType::SYSTEM) {
+        flags |= VizMsgDecoder::KEYWORDS;
+    }
+    if (header.get_Type() == SandeshType::UVE ||
+        header.get_Type() == SandeshType::ALARM) {
+        flags |= VizMsgDecoder::UVE;
+    }
+    fields_.reset(new VizMsgFields);
+    fields_->xml = msg->ExtractMessage();
+    VizMsgDecoder decoder(fields_->xml, flags, fields_.get());
+    if (!decoder.Decode()) {
+        LOG(ERROR, __func__ << " Message: " << msg->GetMessageType() <<
+            " : " << header.get_Source() << " Decode FAILED, walking DOM");
+        // Keep the text, drop whatever was decoded and take the fields
+        // from the DOM instead
+        VizMsgFields *fields = new VizMsgFields;
+        fields->xml.swap(fields_->xml);
+        fields_.reset(fields);
+        VizMsgDomDecoder dom_decoder(static_cast<const SandeshXMLMessage *>(
+            msg)->GetMessageNode(), flags, fields);
+        dom_decoder.Decode();
+    }
+    return *fields_;
+}
+
 RuleMsg::RuleMsg(const VizMsg* vmsgp) : 
     hdr(vmsgp->msg->GetHeader()),
     messagetype(vmsgp->msg->GetMessageType()),
@@ -6,12 +6,15 @@
 #define __VIZ_MESSAGE_H__
 
 #include <string>
+#include <boost/shared_ptr.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <boost/ptr_container/ptr_map.hpp>
 #include <pugixml/pugixml.hpp>
 
 #include <sandesh/sandesh_types.h>
 
+#include "analytics/viz_msg_decoder.h"
+
 #define VIZD_ASSERT(condition) assert((condition));
 
 class SandeshMessage;
@@ -24,9 +27,16 @@ struct VizMsg {
         unm(unm) {}
     ~VizMsg() {}
 
+    // Text of the message and the fields the collector needs from it,
+    // decoded in a single pass on first use
+    const VizMsgFields &fields() const;
+
     const SandeshMessage *msg;
     boost::uuids::uuid unm; /* uuid key for this message in the global table */
     std::string keyword_doc_;
+
+private:
+    mutable boost::shared_ptr<VizMsgFields> fields_;
 };
 
 class SandeshStats;
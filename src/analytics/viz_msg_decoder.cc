@@ -0,0 +1,462 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "analytics/viz_msg_decoder.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <sandesh/protocol/TXMLProtocol.h>
+#include "analytics/parser_util.h"
+
+using std::string;
+using std::make_pair;
+
+using namespace contrail::sandesh::protocol;
+
+static const char *kWhitespace = " \t\r\n";
+
+static bool NameIs(const string &xml, size_t begin, size_t len,
+                   const char *name) {
+    return len == strlen(name) && xml.compare(begin, len, name) == 0;
+}
+
+// Append text to the keyword document, as LineParser::MakeSane would
+static void AppendSane(const string &xml, size_t begin, size_t len,
+                       string *out) {
+    out->reserve(out->size() + len);
+    for (size_t i = begin; i < begin + len; i++) {
+        uint8_t c = xml[i];
+        if (c & 0x80) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "&#%u;", c);
+            out->append(buf);
+        } else {
+            out->push_back(c);
+        }
+    }
+}
+
+struct KeyGroupLess {
+    bool operator()(const std::pair<size_t, std::map<string, string> > &lhs,
+                    const std::pair<size_t, std::map<string, string> > &rhs)
+        const {
+        return lhs.first < rhs.first;
+    }
+};
+
+VizMsgDecoder::VizMsgDecoder(const string &xml, int flags,
+                             VizMsgFields *fields)
+    : xml_(xml), flags_(flags), fields_(fields), pos_(0), order_(0),
+      capture_pos_(string::npos), uve_data_seen_(false),
+      uve_object_seen_(false) {
+    stack_.reserve(16);
+}
+
+bool VizMsgDecoder::Decode() {
+    const size_t size = xml_.size();
+    while (pos_ < size) {
+        size_t lt = xml_.find('<', pos_);
+        if (lt == string::npos) {
+            lt = size;
+        }
+        if (lt > pos_) {
+            ParseText(pos_, lt, false);
+        }
+        pos_ = lt;
+        if (pos_ + 1 >= size) {
+            break;
+        }
+        bool success;
+        if (xml_.compare(pos_, 4, "<!--") == 0) {
+            success = SkipPast("-->");
+        } else if (xml_.compare(pos_, 9, "<![CDATA[") == 0) {
+            size_t end = xml_.find("]]>", pos_ + 9);
+            success = (end != string::npos);
+            if (success) {
+                ParseText(pos_ + 9, end, true);
+                pos_ = end + 3;
+            }
+        } else if (xml_[pos_ + 1] == '?') {
+            success = SkipPast("?>");
+        } else if (xml_[pos_ + 1] == '!') {
+            success = SkipPast(">");
+        } else if (xml_[pos_ + 1] == '/') {
+            success = ParseEndTag();
+        } else {
+            success = ParseStartTag();
+        }
+        if (!success) {
+            return false;
+        }
+    }
+    if (pos_ < size || !stack_.empty()) {
+        return false;
+    }
+
+    // Keys of the children of an element are recorded before the keys
+    // of their descendants
+    std::sort(key_groups_.begin(), key_groups_.end(), KeyGroupLess());
+    for (size_t i = 0; i < key_groups_.size(); i++) {
+        const KeyMap &keys(key_groups_[i].second);
+        for (KeyMap::const_iterator it = keys.begin(); it != keys.end();
+             ++it) {
+            fields_->object_keys.push_back(*it);
+        }
+    }
+    return true;
+}
+
+bool VizMsgDecoder::SkipPast(const char *delim) {
+    size_t end = xml_.find(delim, pos_);
+    if (end == string::npos) {
+        return false;
+    }
+    pos_ = end + strlen(delim);
+    return true;
+}
+
+//
+// Only the first non whitespace text of an element is its value, as for
+// pugi::xml_node::child_value().
+//
+void VizMsgDecoder::ParseText(size_t begin, size_t end, bool cdata) {
+    if (stack_.empty()) {
+        return;
+    }
+    Element &element(stack_.back());
+    if (element.has_text) {
+        return;
+    }
+    if (!cdata) {
+        size_t first = xml_.find_first_not_of(kWhitespace, begin);
+        if (first == string::npos || first >= end) {
+            return;
+        }
+    }
+    element.has_text = true;
+    element.text_begin = begin;
+    element.text_len = end - begin;
+    if (element.string_type) {
+        string &doc(fields_->keyword_doc);
+        if (element.keyword_pos == doc.size()) {
+            AppendSane(xml_, begin, end - begin, &doc);
+        } else {
+            // Text that follows child elements
+            string text;
+            AppendSane(xml_, begin, end - begin, &text);
+            doc.insert(element.keyword_pos, text);
+        }
+    }
+}
+
+bool VizMsgDecoder::ParseStartTag() {
+    const size_t size = xml_.size();
+    const size_t lt = pos_;
+    size_t p = xml_.find_first_of(" \t\r\n/>", lt + 1);
+    if (p == string::npos || p == lt + 1) {
+        return false;
+    }
+    Element element(lt + 1, p - lt - 1, order_++);
+
+    // Attributes, keep the position of the identifier annotation, from
+    // the whitespace before it, to leave it out of UVE attributes
+    size_t identifier_begin = string::npos;
+    size_t identifier_end = string::npos;
+    bool type_seen = false, aggtype_seen = false, key_seen = false;
+    bool self_closing;
+    while (true) {
+        size_t attr_begin = p;
+        p = xml_.find_first_not_of(kWhitespace, p);
+        if (p == string::npos) {
+            return false;
+        }
+        if (xml_[p] == '>') {
+            self_closing = false;
+            p++;
+            break;
+        }
+        if (xml_[p] == '/') {
+            if (p + 1 >= size || xml_[p + 1] != '>') {
+                return false;
+            }
+            self_closing = true;
+            p += 2;
+            break;
+        }
+        size_t eq = xml_.find('=', p);
+        if (eq == string::npos) {
+            return false;
+        }
+        size_t name_end = xml_.find_last_not_of(kWhitespace, eq - 1) + 1;
+        size_t quote = xml_.find_first_not_of(kWhitespace, eq + 1);
+        if (quote == string::npos ||
+            (xml_[quote] != '"' && xml_[quote] != '\'')) {
+            return false;
+        }
+        size_t value_end = xml_.find(xml_[quote], quote + 1);
+        if (value_end == string::npos) {
+            return false;
+        }
+        size_t name_len = name_end - p;
+        size_t value_begin = quote + 1;
+        size_t value_len = value_end - value_begin;
+        if (!key_seen && NameIs(xml_, p, name_len, "key")) {
+            key_seen = true;
+            element.key.assign(xml_, value_begin, value_len);
+        } else if (!type_seen && NameIs(xml_, p, name_len, "type")) {
+            type_seen = true;
+            element.string_type = NameIs(xml_, value_begin, value_len,
+                                         "string");
+        } else if (!aggtype_seen && NameIs(xml_, p, name_len, "aggtype")) {
+            aggtype_seen = true;
+            element.aggtype.assign(xml_, value_begin, value_len);
+        } else if (NameIs(xml_, p, name_len, "tags")) {
+            element.has_tags = true;
+        } else if (identifier_begin == string::npos &&
+                   NameIs(xml_, p, name_len, "identifier")) {
+            identifier_begin = attr_begin;
+            identifier_end = value_end + 1;
+        }
+        p = value_end + 1;
+    }
+
+    stack_.push_back(element);
+    OpenElement(stack_.size() - 1);
+    if (capture_pos_ != string::npos && identifier_begin != string::npos) {
+        capture_.append(xml_, capture_pos_, identifier_begin - capture_pos_);
+        capture_pos_ = identifier_end;
+    }
+    pos_ = p;
+    if (self_closing) {
+        CloseElement(p);
+    }
+    return true;
+}
+
+bool VizMsgDecoder::ParseEndTag() {
+    size_t name_begin = pos_ + 2;
+    size_t name_end = xml_.find_first_of(" \t\r\n>", name_begin);
+    if (name_end == string::npos || stack_.empty()) {
+        return false;
+    }
+    const Element &element(stack_.back());
+    if (name_end - name_begin != element.name_len ||
+        xml_.compare(name_begin, element.name_len, xml_,
+                     element.name_begin, element.name_len) != 0) {
+        return false;
+    }
+    size_t gt = xml_.find('>', name_end);
+    if (gt == string::npos) {
+        return false;
+    }
+    pos_ = gt + 1;
+    CloseElement(pos_);
+    return true;
+}
+
+void VizMsgDecoder::OpenElement(size_t depth) {
+    Element &element(stack_[depth]);
+    if (depth == 1 && element.has_tags) {
+        fields_->has_stats = true;
+    }
+    if (element.string_type) {
+        if (flags_ & KEYWORDS) {
+            fields_->keyword_doc.push_back(' ');
+            element.keyword_pos = fields_->keyword_doc.size();
+        } else {
+            element.string_type = false;
+        }
+    }
+    if (!(flags_ & UVE) || depth == 0) {
+        return;
+    }
+
+    // The UVE is the first struct in the data of the message
+    Role parent_role(stack_[depth - 1].role);
+    if (depth == 1) {
+        if (!uve_data_seen_ &&
+            NameIs(xml_, element.name_begin, element.name_len, "data")) {
+            uve_data_seen_ = true;
+            element.role = UVE_DATA;
+        }
+    } else if (parent_role == UVE_DATA) {
+        if (!uve_object_seen_) {
+            uve_object_seen_ = true;
+            element.role = UVE_OBJECT;
+            fields_->uve_name.assign(xml_, element.name_begin,
+                                     element.name_len);
+        }
+    } else if (parent_role == UVE_OBJECT) {
+        element.role = UVE_ATTR;
+        if (element.key.empty()) {
+            element.capture = true;
+            capture_.clear();
+            capture_pos_ = pos_;
+        }
+    }
+}
+
+void VizMsgDecoder::CloseElement(size_t end) {
+    Element &element(stack_.back());
+    Element *parent = (stack_.size() > 1) ? &stack_[stack_.size() - 2] :
+        NULL;
+
+    if ((flags_ & OBJECT_KEYS) && parent && !element.key.empty()) {
+        string value(Text(element, true));
+        KeyMap::iterator it = parent->keys.find(element.key);
+        if (it != parent->keys.end()) {
+            it->second.append(":");
+            it->second.append(value);
+        } else {
+            parent->keys.insert(make_pair(element.key, value));
+        }
+    }
+    if (!element.keys.empty()) {
+        key_groups_.push_back(make_pair(element.order, KeyMap()));
+        key_groups_.back().second.swap(element.keys);
+    }
+
+    if (element.role == UVE_ATTR) {
+        if (!element.key.empty()) {
+            string value(Text(element, true));
+            if (!fields_->uve_barekey.empty()) {
+                fields_->uve_barekey.append(":");
+                fields_->uve_barekey.append(value);
+            } else {
+                fields_->uve_table = element.key;
+                fields_->uve_barekey.append(value);
+            }
+        }
+        if (NameIs(xml_, element.name_begin, element.name_len, "deleted") &&
+            element.has_text &&
+            NameIs(xml_, element.text_begin, element.text_len, "true")) {
+            fields_->uve_deleted = true;
+        }
+        if (element.capture) {
+            capture_.append(xml_, capture_pos_, end - capture_pos_);
+            capture_pos_ = string::npos;
+            fields_->uve_attrs.push_back(VizMsgFields::UVEAttr());
+            VizMsgFields::UVEAttr &attr(fields_->uve_attrs.back());
+            attr.name.assign(xml_, element.name_begin, element.name_len);
+            attr.aggtype = element.aggtype.empty() ? "None" :
+                element.aggtype;
+            attr.has_tags = element.has_tags;
+            attr.xml.swap(capture_);
+        }
+    }
+    stack_.pop_back();
+}
+
+string VizMsgDecoder::Text(const Element &element, bool unescape) const {
+    if (!element.has_text) {
+        return string();
+    }
+    string text(xml_, element.text_begin, element.text_len);
+    if (unescape) {
+        TXMLProtocol::unescapeXMLControlChars(text);
+    }
+    return text;
+}
+
+VizMsgDomDecoder::VizMsgDomDecoder(const pugi::xml_node &message, int flags,
+                                   VizMsgFields *fields)
+    : message_(message), flags_(flags), fields_(fields) {
+}
+
+void VizMsgDomDecoder::RemoveIdentifier(const pugi::xml_node &parent) {
+    for (pugi::xml_node node = parent.first_child(); node;
+         node = node.next_sibling()) {
+        node.remove_attribute("identifier");
+        RemoveIdentifier(node);
+    }
+}
+
+void VizMsgDomDecoder::ObjectWalk(const pugi::xml_node &parent) {
+    std::map<string, string> keymap;
+    for (pugi::xml_node node = parent.first_child(); node;
+         node = node.next_sibling()) {
+        const char *table = node.attribute("key").value();
+        if (strcmp(table, "")) {
+            string rowkey(node.child_value());
+            TXMLProtocol::unescapeXMLControlChars(rowkey);
+            std::map<string, string>::iterator it = keymap.find(table);
+            if (it != keymap.end()) {
+                it->second.append(":");
+                it->second.append(rowkey);
+            } else {
+                keymap.insert(make_pair(string(table), rowkey));
+            }
+        }
+    }
+    fields_->object_keys.insert(fields_->object_keys.end(), keymap.begin(),
+                                keymap.end());
+    for (pugi::xml_node node = parent.first_child(); node;
+         node = node.next_sibling()) {
+        ObjectWalk(node);
+    }
+}
+
+void VizMsgDomDecoder::UVEWalk() {
+    pugi::xml_node object = message_.child("data").first_child();
+    fields_->uve_name = object.name();
+    for (pugi::xml_node node = object.first_child(); node;
+         node = node.next_sibling()) {
+        const char *table = node.attribute("key").value();
+        if (strcmp(table, "")) {
+            string rowkey(node.child_value());
+            TXMLProtocol::unescapeXMLControlChars(rowkey);
+            if (!fields_->uve_barekey.empty()) {
+                fields_->uve_barekey.append(":");
+                fields_->uve_barekey.append(rowkey);
+            } else {
+                fields_->uve_table = table;
+                fields_->uve_barekey.append(rowkey);
+            }
+        }
+        if (!strcmp(node.name(), "deleted") &&
+            !strcmp(node.child_value(), "true")) {
+            fields_->uve_deleted = true;
+        }
+    }
+    for (pugi::xml_node node = object.first_child(); node;
+         node = node.next_sibling()) {
+        if (strcmp(node.attribute("key").value(), "")) {
+            continue;
+        }
+        std::ostringstream ostr;
+        node.print(ostr, "", pugi::format_raw | pugi::format_no_escapes);
+        VizMsgFields::UVEAttr attr;
+        attr.name = node.name();
+        const char *agg = node.attribute("aggtype").value();
+        attr.aggtype = strcmp(agg, "") ? agg : "None";
+        attr.has_tags = !node.attribute("tags").empty();
+        attr.xml = ostr.str();
+        fields_->uve_attrs.push_back(attr);
+    }
+}
+
+// The keywords are indexed before the identifiers are removed, like the
+// message itself is stored
+void VizMsgDomDecoder::Decode() {
+    if (flags_ & VizMsgDecoder::KEYWORDS) {
+        fields_->keyword_doc = LineParser::GetXmlString(message_);
+    }
+    RemoveIdentifier(message_);
+    if (flags_ & VizMsgDecoder::OBJECT_KEYS) {
+        ObjectWalk(message_);
+    }
+    for (pugi::xml_node node = message_.first_child(); node;
+         node = node.next_sibling()) {
+        if (!node.attribute("tags").empty()) {
+            fields_->has_stats = true;
+        }
+    }
+    if (flags_ & VizMsgDecoder::UVE) {
+        UVEWalk();
+    }
+}
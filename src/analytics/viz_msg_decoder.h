@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef __VIZ_MSG_DECODER_H__
+#define __VIZ_MSG_DECODER_H__
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include <pugixml/pugixml.hpp>
+
+//
+// Fields of a sandesh XML message used by the collector, decoded from the
+// text of the message rather than by walking its DOM.
+//
+struct VizMsgFields {
+    struct UVEAttr {
+        std::string name;
+        std::string aggtype;
+        bool has_tags;
+        // Text of the attribute element, without identifier annotations
+        std::string xml;
+    };
+    typedef std::vector<std::pair<std::string, std::string> > ObjectKeyList;
+
+    VizMsgFields() : has_stats(false), uve_deleted(false) {}
+
+    // Text of the message, as stored in the message table
+    std::string xml;
+
+    // (table, key) pairs to record the message against in the object
+    // tables, keys annotated for the same table by siblings are joined
+    // with ':'
+    ObjectKeyList object_keys;
+
+    // Text of the string fields of the message, for the keyword index
+    std::string keyword_doc;
+
+    // Whether a field of the message has a tags annotation
+    bool has_stats;
+
+    // First struct in the data of a UVE, and its attributes
+    std::string uve_name;
+    std::string uve_table;
+    std::string uve_barekey;
+    bool uve_deleted;
+    std::vector<UVEAttr> uve_attrs;
+};
+
+//
+// Single pass decoder for the XML text of a sandesh message.
+//
+// The text is tokenized in place, only the values the collector needs are
+// copied out: the values of the key annotated elements, the text of string
+// fields and the UVE attributes. Element text is left escaped, as the DOM
+// is loaded without parse_escapes, keys are unescaped like the DOM walk
+// did.
+//
+class VizMsgDecoder {
+public:
+    enum Flags {
+        OBJECT_KEYS = 1 << 0,
+        KEYWORDS    = 1 << 1,
+        UVE         = 1 << 2
+    };
+
+    VizMsgDecoder(const std::string &xml, int flags, VizMsgFields *fields);
+
+    // Returns false if the text is not well formed
+    bool Decode();
+
+private:
+    enum Role {
+        NONE,
+        UVE_DATA,
+        UVE_OBJECT,
+        UVE_ATTR
+    };
+
+    typedef std::map<std::string, std::string> KeyMap;
+
+    struct Element {
+        Element(size_t name_begin, size_t name_len, size_t order)
+            : name_begin(name_begin), name_len(name_len), order(order),
+              text_begin(0), text_len(0), has_text(false),
+              string_type(false), keyword_pos(0), role(NONE),
+              capture(false), has_tags(false) {
+        }
+        size_t name_begin;
+        size_t name_len;
+        // Position of the element in document order
+        size_t order;
+        size_t text_begin;
+        size_t text_len;
+        bool has_text;
+        std::string key;
+        bool string_type;
+        // Where the text of a string field goes in the keyword document
+        size_t keyword_pos;
+        Role role;
+        bool capture;
+        bool has_tags;
+        std::string aggtype;
+        // Keys annotated on the child elements, by table
+        KeyMap keys;
+    };
+
+    bool ParseStartTag();
+    bool ParseEndTag();
+    void ParseText(size_t begin, size_t end, bool cdata);
+    bool SkipPast(const char *delim);
+    // Called on the element at depth of the stack, once its attributes
+    // are parsed
+    void OpenElement(size_t depth);
+    // Called on the element on top of the stack, pops it, end is the
+    // position past its end tag
+    void CloseElement(size_t end);
+    std::string Text(const Element &element, bool unescape) const;
+
+    const std::string &xml_;
+    int flags_;
+    VizMsgFields *fields_;
+    size_t pos_;
+    std::vector<Element> stack_;
+    size_t order_;
+
+    // Object keys by the document order of the parent element
+    std::vector<std::pair<size_t, KeyMap> > key_groups_;
+
+    // Text of the UVE attribute being captured and the position in the
+    // message up to which it has been copied, npos when not capturing
+    std::string capture_;
+    size_t capture_pos_;
+    bool uve_data_seen_;
+    bool uve_object_seen_;
+};
+
+//
+// Fills the same fields by walking the DOM of the message, the way the rule
+// engine did before VizMsgDecoder. Used when the text can not be decoded.
+// Removes the identifier annotations from the DOM.
+//
+class VizMsgDomDecoder {
+public:
+    VizMsgDomDecoder(const pugi::xml_node &message, int flags,
+                     VizMsgFields *fields);
+
+    void Decode();
+
+private:
+    static void RemoveIdentifier(const pugi::xml_node &parent);
+    void ObjectWalk(const pugi::xml_node &parent);
+    void UVEWalk();
+
+    pugi::xml_node message_;
+    int flags_;
+    VizMsgFields *fields_;
+};
+
+#endif // __VIZ_MSG_DECODER_H__
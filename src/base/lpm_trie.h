@@ -0,0 +1,311 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef LPM_TRIE_H
+#define LPM_TRIE_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+//
+// Longest prefix match index over byte strings (IPv4 and IPv6 addresses),
+// kept alongside an exact match structure such as a Patricia::Tree.
+//
+// The trie has a stride of 8 bits, a lookup reads one node per address byte.
+// Node at depth k holds the prefixes with length in (8k, 8k + 8], the root
+// also holds the prefix of length 0. Prefixes of a node are expanded into a
+// leaf value per slot and both leaves and children are compressed as in a
+// poptrie: a bitmap of 256 bits marks the slots with a child and the slots
+// where the leaf value changes, the arrays hold only the marked entries and
+// are indexed by the population count of the bitmap below the slot.
+//
+// Updates are incremental, only the node holding the prefix is re-expanded.
+// Nodes without prefixes and children are freed on remove.
+//
+template <class D>
+class LpmTrie {
+public:
+    static const uint32_t kStride = 8;
+
+    LpmTrie() : root_(new Node()), size_(0), nodes_(1) {
+    }
+
+    ~LpmTrie() {
+        Clear();
+        delete root_;
+    }
+
+    // Adds data for the prefix addr/plen, replaces data of an existing
+    // prefix. Returns true if the prefix was added
+    bool Insert(const uint8_t *addr, uint32_t plen, D *data) {
+        uint32_t depth = Depth(plen);
+        Node *node = root_;
+        for (uint32_t i = 0; i < depth; i++) {
+            Node *child = node->Child(addr[i]);
+            if (child == NULL) {
+                child = new Node();
+                node->AddChild(addr[i], child);
+                nodes_++;
+            }
+            node = child;
+        }
+
+        uint8_t rel_plen = plen - depth * kStride;
+        uint8_t bits = Mask(addr[depth], rel_plen);
+        bool added = node->AddPrefix(rel_plen, bits, data);
+        node->Expand();
+        if (added)
+            size_++;
+        return added;
+    }
+
+    // Returns true if the prefix was present
+    bool Remove(const uint8_t *addr, uint32_t plen) {
+        uint32_t depth = Depth(plen);
+        Node *path[kMaxDepth + 1];
+        Node *node = root_;
+        path[0] = node;
+        for (uint32_t i = 0; i < depth; i++) {
+            node = node->Child(addr[i]);
+            if (node == NULL)
+                return false;
+            path[i + 1] = node;
+        }
+
+        uint8_t rel_plen = plen - depth * kStride;
+        if (node->RemovePrefix(rel_plen, Mask(addr[depth], rel_plen)) == false)
+            return false;
+        node->Expand();
+        size_--;
+
+        for (uint32_t i = depth; i > 0; i--) {
+            if (path[i]->Empty() == false)
+                break;
+            path[i - 1]->RemoveChild(addr[i - 1]);
+            delete path[i];
+            nodes_--;
+        }
+        return true;
+    }
+
+    // Longest prefix with length not more than plen matching addr. Address
+    // lookups pass the full address length
+    D *Find(const uint8_t *addr, uint32_t plen) const {
+        const Node *node = root_;
+        D *best = NULL;
+        for (uint32_t depth = 0; node != NULL; depth++) {
+            uint32_t limit = plen - depth * kStride;
+            if (limit < kStride) {
+                D *data = node->FindPrefix(addr[depth], limit);
+                return data ? data : best;
+            }
+            D *data = node->Leaf(addr[depth]);
+            if (data)
+                best = data;
+            if (limit == kStride)
+                break;
+            node = node->Child(addr[depth]);
+        }
+        return best;
+    }
+
+    void Clear() {
+        Free(root_);
+        root_->Reset();
+        size_ = 0;
+        nodes_ = 1;
+    }
+
+    std::size_t Size() const { return size_; }
+    std::size_t node_count() const { return nodes_; }
+
+    // Approximate memory held by the trie
+    std::size_t MemoryUsage() const {
+        return Memory(root_);
+    }
+
+private:
+    static const uint32_t kMaxDepth = 16;
+    static const uint32_t kSlots = 1 << kStride;
+    static const uint32_t kWords = kSlots / 64;
+
+    struct Prefix {
+        Prefix(uint8_t p, uint8_t b, D *d) : plen(p), bits(b), data(d) { }
+        bool operator<(const Prefix &rhs) const {
+            if (plen != rhs.plen)
+                return plen < rhs.plen;
+            return bits < rhs.bits;
+        }
+        // Length relative to the node
+        uint8_t plen;
+        uint8_t bits;
+        D *data;
+    };
+
+    class Node {
+    public:
+        Node() {
+            Reset();
+        }
+
+        void Reset() {
+            memset(leaf_bitmap_, 0, sizeof(leaf_bitmap_));
+            memset(child_bitmap_, 0, sizeof(child_bitmap_));
+            leaves_.clear();
+            children_.clear();
+            prefixes_.clear();
+        }
+
+        D *Leaf(uint8_t slot) const {
+            if (leaves_.empty())
+                return NULL;
+            return leaves_[Rank(leaf_bitmap_, slot) - 1];
+        }
+
+        Node *Child(uint8_t slot) const {
+            if (IsSet(child_bitmap_, slot) == false)
+                return NULL;
+            return children_[Rank(child_bitmap_, slot) - 1];
+        }
+
+        void AddChild(uint8_t slot, Node *child) {
+            child_bitmap_[slot / 64] |= (1ULL << (slot % 64));
+            children_.insert(children_.begin() +
+                             Rank(child_bitmap_, slot) - 1, child);
+        }
+
+        void RemoveChild(uint8_t slot) {
+            children_.erase(children_.begin() +
+                            Rank(child_bitmap_, slot) - 1);
+            child_bitmap_[slot / 64] &= ~(1ULL << (slot % 64));
+        }
+
+        // Prefixes are kept sorted on length, shorter first
+        bool AddPrefix(uint8_t plen, uint8_t bits, D *data) {
+            Prefix prefix(plen, bits, data);
+            typename std::vector<Prefix>::iterator it =
+                std::lower_bound(prefixes_.begin(), prefixes_.end(), prefix);
+            if (it != prefixes_.end() && it->plen == plen && it->bits == bits) {
+                it->data = data;
+                return false;
+            }
+            prefixes_.insert(it, prefix);
+            return true;
+        }
+
+        bool RemovePrefix(uint8_t plen, uint8_t bits) {
+            Prefix prefix(plen, bits, NULL);
+            typename std::vector<Prefix>::iterator it =
+                std::lower_bound(prefixes_.begin(), prefixes_.end(), prefix);
+            if (it == prefixes_.end() || it->plen != plen || it->bits != bits)
+                return false;
+            prefixes_.erase(it);
+            return true;
+        }
+
+        // Longest prefix of length not more than plen covering the slot
+        D *FindPrefix(uint8_t slot, uint32_t plen) const {
+            for (typename std::vector<Prefix>::const_reverse_iterator it =
+                 prefixes_.rbegin(); it != prefixes_.rend(); ++it) {
+                if (it->plen <= plen && Mask(slot, it->plen) == it->bits)
+                    return it->data;
+            }
+            return NULL;
+        }
+
+        // Rebuilds the leaves from the prefixes, longer prefixes override
+        // the shorter ones
+        void Expand() {
+            D *slots[kSlots];
+            memset(slots, 0, sizeof(slots));
+            for (typename std::vector<Prefix>::const_iterator it =
+                 prefixes_.begin(); it != prefixes_.end(); ++it) {
+                uint32_t count = 1 << (kStride - it->plen);
+                std::fill(slots + it->bits, slots + it->bits + count,
+                          it->data);
+            }
+
+            memset(leaf_bitmap_, 0, sizeof(leaf_bitmap_));
+            leaves_.clear();
+            if (prefixes_.empty())
+                return;
+            for (uint32_t i = 0; i < kSlots; i++) {
+                if (i == 0 || slots[i] != slots[i - 1]) {
+                    leaf_bitmap_[i / 64] |= (1ULL << (i % 64));
+                    leaves_.push_back(slots[i]);
+                }
+            }
+            std::vector<D *>(leaves_).swap(leaves_);
+        }
+
+        bool Empty() const {
+            return prefixes_.empty() && children_.empty();
+        }
+
+        const std::vector<Node *> &children() const { return children_; }
+
+        std::size_t Memory() const {
+            return sizeof(Node) + leaves_.capacity() * sizeof(D *) +
+                children_.capacity() * sizeof(Node *) +
+                prefixes_.capacity() * sizeof(Prefix);
+        }
+
+    private:
+        static bool IsSet(const uint64_t *bitmap, uint8_t slot) {
+            return (bitmap[slot / 64] & (1ULL << (slot % 64))) != 0;
+        }
+
+        // Number of bits set in the bitmap up to and including slot
+        static uint32_t Rank(const uint64_t *bitmap, uint8_t slot) {
+            uint32_t word = slot / 64;
+            uint32_t count = 0;
+            for (uint32_t i = 0; i < word; i++) {
+                count += __builtin_popcountll(bitmap[i]);
+            }
+            uint32_t shift = 63 - (slot % 64);
+            return count + __builtin_popcountll(bitmap[word] << shift);
+        }
+
+        uint64_t leaf_bitmap_[kWords];
+        uint64_t child_bitmap_[kWords];
+        std::vector<D *> leaves_;
+        std::vector<Node *> children_;
+        std::vector<Prefix> prefixes_;
+    };
+
+    static uint32_t Depth(uint32_t plen) {
+        return plen ? (plen - 1) / kStride : 0;
+    }
+
+    static uint8_t Mask(uint8_t byte, uint32_t plen) {
+        if (plen == 0)
+            return 0;
+        return byte & (0xFF << (kStride - plen));
+    }
+
+    void Free(Node *node) {
+        for (typename std::vector<Node *>::const_iterator it =
+             node->children().begin(); it != node->children().end(); ++it) {
+            Free(*it);
+            delete *it;
+        }
+    }
+
+    std::size_t Memory(const Node *node) const {
+        std::size_t size = node->Memory();
+        for (typename std::vector<Node *>::const_iterator it =
+             node->children().begin(); it != node->children().end(); ++it) {
+            size += Memory(*it);
+        }
+        return size;
+    }
+
+    Node *root_;
+    std::size_t size_;
+    std::size_t nodes_;
+};
+
+#endif // LPM_TRIE_H
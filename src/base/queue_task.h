@@ -299,6 +299,33 @@ public:
         }
     }
 
+    // Enqueue a batch of entries, the runner is started once for the batch.
+    // Bounded queues and queues with water marks take the entries one by one
+    bool EnqueueBatch(const std::vector<QueueEntryT> &entries) {
+        if (bounded_ || AreWaterMarksSet()) {
+            bool ret = true;
+            for (typename std::vector<QueueEntryT>::const_iterator it =
+                 entries.begin(); it != entries.end(); ++it) {
+                if (Enqueue(*it) == false)
+                    ret = false;
+            }
+            return ret;
+        }
+
+        size_t ncount(0);
+        for (typename std::vector<QueueEntryT>::const_iterator it =
+             entries.begin(); it != entries.end(); ++it) {
+            QueueEntryT entry(*it);
+            enqueues_++;
+            ncount = AtomicIncrementQueueCount(&entry);
+            if (ncount > max_queue_len_)
+                max_queue_len_ = ncount;
+            queue_.push(entry);
+        }
+        MayBeStartRunner();
+        return ncount < size_;
+    }
+
     // Returns true if pop is successful.
     bool Dequeue(QueueEntryT *entry) {
         if (AreWaterMarksSet()) {
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "base/slab_allocator.h"
+
+#include <assert.h>
+#include <sstream>
+
+#include "base/task.h"
+
+SlabAllocator::SlabAllocator(const std::string &name, size_t object_size)
+    : name_(name),
+      object_size_((object_size + kAlignment - 1) & ~(kAlignment - 1)),
+      objects_per_slab_(0),
+      free_list_(NULL),
+      free_count_(0),
+      allocs_(0),
+      caches_(new Cache[kCacheCount]) {
+    assert(object_size_ >= sizeof(FreeObject) && object_size_ <= kSlabSize);
+    objects_per_slab_ = kSlabSize / object_size_;
+}
+
+SlabAllocator::~SlabAllocator() {
+    for (std::vector<char *>::iterator it = slabs_.begin();
+         it != slabs_.end(); ++it) {
+        delete [] *it;
+    }
+}
+
+// Cache of the running task instance, NULL if there is none
+SlabAllocator::Cache *SlabAllocator::GetCache() {
+    Task *task = Task::Running();
+    if (task == NULL || task->GetTaskInstance() < 0)
+        return NULL;
+    return &caches_[task->GetTaskInstance() % kCacheCount];
+}
+
+// Carve a new slab into objects and put them on the free list
+void SlabAllocator::AddSlab() {
+    char *slab = new char[kSlabSize];
+    slabs_.push_back(slab);
+    for (size_t idx = objects_per_slab_; idx > 0; idx--) {
+        FreeObject *object =
+            reinterpret_cast<FreeObject *>(slab + (idx - 1) * object_size_);
+        object->next = free_list_;
+        free_list_ = object;
+    }
+    free_count_ += objects_per_slab_;
+}
+
+void *SlabAllocator::AllocateShared() {
+    tbb::spin_mutex::scoped_lock lock(mutex_);
+    if (free_list_ == NULL)
+        AddSlab();
+    FreeObject *object = free_list_;
+    free_list_ = object->next;
+    free_count_--;
+    allocs_++;
+    return object;
+}
+
+void SlabAllocator::FreeShared(FreeObject *object) {
+    tbb::spin_mutex::scoped_lock lock(mutex_);
+    object->next = free_list_;
+    free_list_ = object;
+    free_count_++;
+}
+
+// Move kBatchSize objects from the shared free list to the cache
+void SlabAllocator::Refill(Cache *cache) {
+    tbb::spin_mutex::scoped_lock lock(mutex_);
+    for (size_t count = 0; count < kBatchSize; count++) {
+        if (free_list_ == NULL)
+            AddSlab();
+        FreeObject *object = free_list_;
+        free_list_ = object->next;
+        object->next = cache->free_list;
+        cache->free_list = object;
+    }
+    free_count_ -= kBatchSize;
+    cache->free_count += kBatchSize;
+}
+
+// Move kBatchSize objects from the cache back to the shared free list
+void SlabAllocator::Drain(Cache *cache) {
+    FreeObject *first = cache->free_list;
+    FreeObject *last = first;
+    for (size_t count = 1; count < kBatchSize; count++) {
+        last = last->next;
+    }
+    cache->free_list = last->next;
+    cache->free_count -= kBatchSize;
+
+    tbb::spin_mutex::scoped_lock lock(mutex_);
+    last->next = free_list_;
+    free_list_ = first;
+    free_count_ += kBatchSize;
+}
+
+void *SlabAllocator::Allocate() {
+    Cache *cache = GetCache();
+    if (cache == NULL)
+        return AllocateShared();
+
+    tbb::spin_mutex::scoped_lock lock(cache->mutex);
+    if (cache->free_list == NULL)
+        Refill(cache);
+    FreeObject *object = cache->free_list;
+    cache->free_list = object->next;
+    cache->free_count--;
+    cache->allocs++;
+    return object;
+}
+
+void SlabAllocator::Free(void *ptr) {
+    FreeObject *object = static_cast<FreeObject *>(ptr);
+    Cache *cache = GetCache();
+    if (cache == NULL) {
+        FreeShared(object);
+        return;
+    }
+
+    tbb::spin_mutex::scoped_lock lock(cache->mutex);
+    object->next = cache->free_list;
+    cache->free_list = object;
+    cache->free_count++;
+    if (cache->free_count > 2 * kBatchSize)
+        Drain(cache);
+}
+
+size_t SlabAllocator::slab_count() const {
+    tbb::spin_mutex::scoped_lock lock(mutex_);
+    return slabs_.size();
+}
+
+size_t SlabAllocator::free_count() const {
+    size_t count = 0;
+    for (size_t idx = 0; idx < kCacheCount; idx++) {
+        tbb::spin_mutex::scoped_lock lock(caches_[idx].mutex);
+        count += caches_[idx].free_count;
+    }
+    tbb::spin_mutex::scoped_lock lock(mutex_);
+    return count + free_count_;
+}
+
+// Objects not on any free list. Objects may move between the free lists
+// while they are counted, the value is approximate under concurrent use
+size_t SlabAllocator::in_use() const {
+    size_t free = free_count();
+    size_t total = slab_count() * objects_per_slab_;
+    return total > free ? total - free : 0;
+}
+
+uint64_t SlabAllocator::allocs() const {
+    uint64_t count = 0;
+    for (size_t idx = 0; idx < kCacheCount; idx++) {
+        tbb::spin_mutex::scoped_lock lock(caches_[idx].mutex);
+        count += caches_[idx].allocs;
+    }
+    tbb::spin_mutex::scoped_lock lock(mutex_);
+    return count + allocs_;
+}
+
+SlabAllocatorGroup::SlabAllocatorGroup(const std::string &name,
+                                       size_t max_size) {
+    for (size_t idx = 0; idx <= Index(max_size); idx++) {
+        size_t size = idx * SlabAllocator::kAlignment;
+        if (size < sizeof(void *)) {
+            allocators_.push_back(NULL);
+            continue;
+        }
+        std::ostringstream oss;
+        oss << name << "/" << size;
+        allocators_.push_back(new SlabAllocator(oss.str(), size));
+    }
+}
+
+SlabAllocatorGroup::~SlabAllocatorGroup() {
+    STLDeleteValues(&allocators_);
+}
+
+void *SlabAllocatorGroup::Allocate(size_t size) {
+    size_t idx = Index(size);
+    if (idx >= allocators_.size() || allocators_[idx] == NULL)
+        return ::operator new(size);
+    return allocators_[idx]->Allocate();
+}
+
+void SlabAllocatorGroup::Free(void *object, size_t size) {
+    if (object == NULL)
+        return;
+    size_t idx = Index(size);
+    if (idx >= allocators_.size() || allocators_[idx] == NULL) {
+        ::operator delete(object);
+        return;
+    }
+    allocators_[idx]->Free(object);
+}
+
+void SlabAllocatorGroup::GetAllocators(
+    std::vector<const SlabAllocator *> *list) const {
+    for (std::vector<SlabAllocator *>::const_iterator it = allocators_.begin();
+         it != allocators_.end(); ++it) {
+        if (*it != NULL && (*it)->slab_count() != 0)
+            list->push_back(*it);
+    }
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef ctrlplane_slab_allocator_h
+#define ctrlplane_slab_allocator_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <boost/scoped_array.hpp>
+#include <tbb/spin_mutex.h>
+
+#include "base/util.h"
+
+//
+// Allocator for objects of a fixed size. Objects are carved out of slabs of
+// kSlabSize bytes, which saves the per object overhead of the heap allocator.
+// Freed objects are kept on a free list for reuse, the slabs are released only
+// when the allocator is deleted.
+//
+// Tasks with an instance, e.g. the db::DBTable task of each table partition,
+// allocate from and free to a cache of their own, picked by the task
+// instance. A cache takes kBatchSize objects at a time from the shared free
+// list and gives back kBatchSize objects when it holds more than twice that,
+// so the shared lock is taken once per batch. Other callers use the shared
+// free list.
+//
+// Allocate and Free can be called concurrently from any task. The accessors
+// for the statistics take the locks.
+//
+class SlabAllocator {
+public:
+    static const size_t kSlabSize = 64 * 1024;
+    static const size_t kAlignment = sizeof(void *);
+    static const size_t kCacheCount = 32;
+    static const size_t kBatchSize = 32;
+
+    SlabAllocator(const std::string &name, size_t object_size);
+    ~SlabAllocator();
+
+    void *Allocate();
+    void Free(void *object);
+
+    const std::string &name() const { return name_; }
+    size_t object_size() const { return object_size_; }
+    size_t slab_count() const;
+    size_t in_use() const;
+    size_t free_count() const;
+    uint64_t allocs() const;
+
+    // Memory taken from the heap by the allocator.
+    size_t bytes() const { return slab_count() * kSlabSize; }
+
+private:
+    struct FreeObject {
+        FreeObject *next;
+    };
+
+    struct Cache {
+        Cache() : free_list(NULL), free_count(0), allocs(0) { }
+        tbb::spin_mutex mutex;
+        FreeObject *free_list;
+        size_t free_count;
+        uint64_t allocs;
+        // Keep the caches of different tasks on different cache lines
+        char pad[64];
+    };
+
+    Cache *GetCache();
+    void AddSlab();
+    void *AllocateShared();
+    void FreeShared(FreeObject *object);
+    void Refill(Cache *cache);
+    void Drain(Cache *cache);
+
+    std::string name_;
+    size_t object_size_;
+    size_t objects_per_slab_;
+
+    mutable tbb::spin_mutex mutex_;
+    std::vector<char *> slabs_;
+    FreeObject *free_list_;
+    size_t free_count_;
+    uint64_t allocs_;
+
+    boost::scoped_array<Cache> caches_;
+
+    DISALLOW_COPY_AND_ASSIGN(SlabAllocator);
+};
+
+//
+// Set of SlabAllocators for the object sizes of a class hierarchy, used in
+// class specific operator new and operator delete. Objects are allocated from
+// the SlabAllocator for the size rounded up to kAlignment. Objects bigger than
+// max_size are allocated from the heap.
+//
+class SlabAllocatorGroup {
+public:
+    SlabAllocatorGroup(const std::string &name, size_t max_size);
+    ~SlabAllocatorGroup();
+
+    void *Allocate(size_t size);
+    void Free(void *object, size_t size);
+
+    // Allocators that have slabs.
+    void GetAllocators(std::vector<const SlabAllocator *> *list) const;
+
+private:
+    size_t Index(size_t size) const {
+        return (size + SlabAllocator::kAlignment - 1) /
+            SlabAllocator::kAlignment;
+    }
+
+    std::vector<SlabAllocator *> allocators_;
+
+    DISALLOW_COPY_AND_ASSIGN(SlabAllocatorGroup);
+};
+
+#endif  // ctrlplane_slab_allocator_h
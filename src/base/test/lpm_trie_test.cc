@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+#include "base/lpm_trie.h"
+#include "base/patricia.h"
+#include "base/logging.h"
+#include "testing/gunit.h"
+
+class Route {
+public:
+    Route(const uint8_t *addr, int len, int addr_len) :
+        len_(len), addr_len_(addr_len) {
+        memset(addr_, 0, sizeof(addr_));
+        for (int i = 0; i < len; i++) {
+            if (addr[i / 8] & (0x80 >> (i % 8)))
+                addr_[i / 8] |= (0x80 >> (i % 8));
+        }
+    }
+
+    class RtKey {
+    public:
+        static std::size_t BitLength(const Route *route_key) {
+            return route_key->len_;
+        }
+
+        static char ByteValue(const Route *route_key, std::size_t i) {
+            return route_key->addr_[i];
+        }
+    };
+
+    bool Match(const uint8_t *addr, int len) const {
+        if (len < len_)
+            return false;
+        for (int i = 0; i < len_; i++) {
+            if ((addr[i / 8] ^ addr_[i / 8]) & (0x80 >> (i % 8)))
+                return false;
+        }
+        return true;
+    }
+
+    uint8_t addr_[16];
+    int len_;
+    int addr_len_;
+    Patricia::Node rtnode_;
+};
+
+typedef Patricia::Tree<Route, &Route::rtnode_, Route::RtKey> RouteTree;
+typedef LpmTrie<Route> RouteTrie;
+
+class LpmTrieTest : public ::testing::Test {
+public:
+    LpmTrieTest() {
+        srand(1);
+    }
+
+    ~LpmTrieTest() {
+        for (std::vector<Route *>::iterator it = routes_.begin();
+             it != routes_.end(); ++it) {
+            delete *it;
+        }
+    }
+
+    Route *Add(const uint8_t *addr, int len, int addr_len) {
+        Route *rt = new Route(addr, len, addr_len);
+        // Skip duplicate prefixes
+        Route *old = Scan(rt->addr_, len);
+        if (old && old->len_ == len) {
+            delete rt;
+            return NULL;
+        }
+        EXPECT_TRUE(trie_.Insert(rt->addr_, len, rt));
+        routes_.push_back(rt);
+        return rt;
+    }
+
+    void Remove(Route *rt) {
+        EXPECT_TRUE(trie_.Remove(rt->addr_, rt->len_));
+        routes_.erase(std::find(routes_.begin(), routes_.end(), rt));
+        delete rt;
+    }
+
+    // Longest match by a scan of all routes
+    Route *Scan(const uint8_t *addr, int len) const {
+        Route *best = NULL;
+        for (std::vector<Route *>::const_iterator it = routes_.begin();
+             it != routes_.end(); ++it) {
+            if ((*it)->Match(addr, len) && (best == NULL ||
+                                            (*it)->len_ > best->len_)) {
+                best = *it;
+            }
+        }
+        return best;
+    }
+
+    void RandomAddr(uint8_t *addr, int addr_len) {
+        // Few distinct leading bytes so that prefixes share nodes
+        addr[0] = 10 + rand() % 4;
+        for (int i = 1; i < addr_len / 8; i++) {
+            addr[i] = (i < 3) ? rand() % 8 : rand() % 256;
+        }
+    }
+
+    void Verify(int addr_len, int lookups) {
+        uint8_t addr[16];
+        for (int i = 0; i < lookups; i++) {
+            memset(addr, 0, sizeof(addr));
+            RandomAddr(addr, addr_len);
+            int len = (i % 2) ? addr_len : rand() % (addr_len + 1);
+            EXPECT_EQ(Scan(addr, len), trie_.Find(addr, len));
+        }
+    }
+
+protected:
+    std::vector<Route *> routes_;
+    RouteTrie trie_;
+};
+
+TEST_F(LpmTrieTest, Basic) {
+    uint8_t addr[4] = {1, 1, 1, 0};
+    uint8_t host[4] = {1, 1, 1, 5};
+    uint8_t other[4] = {2, 0, 0, 1};
+
+    EXPECT_TRUE(trie_.Find(host, 32) == NULL);
+    Route *def = Add(addr, 0, 32);
+    Route *net8 = Add(addr, 8, 32);
+    Route *net24 = Add(addr, 24, 32);
+    Route *net31 = Add(host, 31, 32);
+    Route *rt32 = Add(host, 32, 32);
+    EXPECT_EQ(5U, trie_.Size());
+
+    EXPECT_EQ(rt32, trie_.Find(host, 32));
+    EXPECT_EQ(net31, trie_.Find(host, 31));
+    EXPECT_EQ(net24, trie_.Find(host, 30));
+    EXPECT_EQ(net24, trie_.Find(host, 24));
+    EXPECT_EQ(net8, trie_.Find(host, 23));
+    EXPECT_EQ(net8, trie_.Find(host, 8));
+    EXPECT_EQ(def, trie_.Find(host, 7));
+    EXPECT_EQ(def, trie_.Find(host, 0));
+    EXPECT_EQ(def, trie_.Find(other, 32));
+
+    // Replace data of existing prefix
+    EXPECT_FALSE(trie_.Insert(host, 32, net31));
+    EXPECT_EQ(net31, trie_.Find(host, 32));
+    EXPECT_FALSE(trie_.Insert(host, 32, rt32));
+
+    Remove(rt32);
+    EXPECT_EQ(net31, trie_.Find(host, 32));
+    Remove(net24);
+    EXPECT_EQ(net31, trie_.Find(host, 32));
+    EXPECT_EQ(net8, trie_.Find(addr, 32));
+    Remove(net31);
+    EXPECT_EQ(net8, trie_.Find(host, 32));
+    EXPECT_FALSE(trie_.Remove(host, 32));
+    Remove(net8);
+    Remove(def);
+    EXPECT_TRUE(trie_.Find(host, 32) == NULL);
+    EXPECT_EQ(0U, trie_.Size());
+    EXPECT_EQ(1U, trie_.node_count());
+}
+
+TEST_F(LpmTrieTest, RandomV4) {
+    uint8_t addr[16];
+    for (int i = 0; i < 2000; i++) {
+        RandomAddr(addr, 32);
+        Add(addr, rand() % 33, 32);
+    }
+    Verify(32, 20000);
+
+    // Remove half of the routes
+    for (size_t count = routes_.size() / 2; count > 0; count--) {
+        Remove(routes_[rand() % routes_.size()]);
+    }
+    Verify(32, 20000);
+
+    while (routes_.size()) {
+        Remove(routes_.back());
+    }
+    EXPECT_EQ(1U, trie_.node_count());
+}
+
+TEST_F(LpmTrieTest, RandomV6) {
+    uint8_t addr[16];
+    for (int i = 0; i < 2000; i++) {
+        memset(addr, 0, sizeof(addr));
+        RandomAddr(addr, 128);
+        Add(addr, rand() % 129, 128);
+    }
+    Verify(128, 20000);
+
+    for (size_t count = routes_.size() / 2; count > 0; count--) {
+        Remove(routes_[rand() % routes_.size()]);
+    }
+    Verify(128, 20000);
+
+    while (routes_.size()) {
+        Remove(routes_.back());
+    }
+    EXPECT_EQ(1U, trie_.node_count());
+}
+
+static void ToBytes(uint32_t ip, uint8_t *addr) {
+    addr[0] = ip >> 24;
+    addr[1] = (ip >> 16) & 0xFF;
+    addr[2] = (ip >> 8) & 0xFF;
+    addr[3] = ip & 0xFF;
+}
+
+static double CpuTime() {
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+// FindLPM throughput of a 500k prefix table, prefix lengths distributed as
+// in an internet routing table with about 60% /24 prefixes
+TEST_F(LpmTrieTest, Scale) {
+    const uint32_t kPrefixes = 500 * 1000;
+    const uint32_t kLookups = 1000 * 1000;
+
+    std::vector<Route *> table;
+    std::map<std::pair<uint32_t, int>, bool> seen;
+    RouteTree tree;
+    RouteTrie trie;
+    while (table.size() < kPrefixes) {
+        uint32_t ip = ((rand() & 0xFFFF) << 16) | (rand() & 0xFFFF);
+        int r = rand() % 100;
+        int len = (r < 60) ? 24 : (r < 70) ? 22 : (r < 80) ? 23 :
+            (r < 90) ? 16 + rand() % 6 : 8 + rand() % 8;
+        ip &= (0xFFFFFFFF << (32 - len));
+        if (seen.insert(std::make_pair(std::make_pair(ip, len), true)).second
+            == false) {
+            continue;
+        }
+        uint8_t addr[4];
+        ToBytes(ip, addr);
+        Route *rt = new Route(addr, len, 32);
+        table.push_back(rt);
+        tree.Insert(rt);
+        trie.Insert(rt->addr_, len, rt);
+    }
+    EXPECT_EQ(kPrefixes, trie.Size());
+
+    std::vector<uint32_t> lookups(kLookups);
+    for (uint32_t i = 0; i < kLookups; i++) {
+        // Half of the lookups hit a route
+        if (i % 2) {
+            Route *rt = table[rand() % kPrefixes];
+            uint32_t ip = (rt->addr_[0] << 24) | (rt->addr_[1] << 16) |
+                (rt->addr_[2] << 8) | rt->addr_[3];
+            lookups[i] = ip | (rand() & (0xFFFFFFFF >> rt->len_));
+        } else {
+            lookups[i] = ((rand() & 0xFFFF) << 16) | (rand() & 0xFFFF);
+        }
+    }
+
+    uint32_t mismatch = 0;
+    double t0 = CpuTime();
+    std::vector<Route *> tree_result(kLookups);
+    for (uint32_t i = 0; i < kLookups; i++) {
+        uint8_t addr[4];
+        ToBytes(lookups[i], addr);
+        Route key(addr, 32, 32);
+        tree_result[i] = tree.LPMFind(&key);
+    }
+    double t1 = CpuTime();
+    for (uint32_t i = 0; i < kLookups; i++) {
+        uint8_t addr[4];
+        ToBytes(lookups[i], addr);
+        if (trie.Find(addr, 32) != tree_result[i])
+            mismatch++;
+    }
+    double t2 = CpuTime();
+    EXPECT_EQ(0U, mismatch);
+
+    LOG(DEBUG, "Patricia: " << kLookups / (t1 - t0) << " lookups/sec");
+    LOG(DEBUG, "LpmTrie : " << kLookups / (t2 - t1) << " lookups/sec, "
+        << trie.node_count() << " nodes " << trie.MemoryUsage() / 1024
+        << " KB");
+
+    for (std::vector<Route *>::iterator it = table.begin();
+         it != table.end(); ++it) {
+        tree.Remove(*it);
+        EXPECT_TRUE(trie.Remove((*it)->addr_, (*it)->len_));
+        delete *it;
+    }
+    EXPECT_EQ(0U, trie.Size());
+    EXPECT_EQ(1U, trie.node_count());
+}
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -308,6 +308,38 @@ TEST_F(QueueTaskTest, MaxIterationsTest) {
     EXPECT_EQ(0, work_queue_.Length());
 }
 
+TEST_F(QueueTaskTest, EnqueueBatchTest) {
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    std::vector<int> batch;
+    for (int i = 0; i < 32; i++) {
+        batch.push_back(i);
+    }
+    scheduler->Stop();
+    EXPECT_TRUE(work_queue_.EnqueueBatch(batch));
+    // Verify WorkQueue internal state, single runner for the batch
+    EXPECT_TRUE(IsWorkQueueRunning());
+    EXPECT_EQ(32, work_queue_.NumEnqueues());
+    EXPECT_EQ(32, work_queue_.Length());
+    EXPECT_EQ(32, work_queue_.max_queue_len());
+    scheduler->Start();
+    task_util::WaitForIdle(1);
+    EXPECT_EQ(32, dequeues_);
+    TaskStats *tstats = scheduler->GetTaskStats(wq_task_id_);
+    EXPECT_EQ(1, tstats->run_count_);
+
+    // Bounded queue drops entries above the size
+    WorkQueue<int> bounded_queue(wq_task_id_, -1,
+        boost::bind(&QueueTaskTest::Dequeue, this, _1), 20);
+    bounded_queue.SetBounded(true);
+    bounded_queue.SetStartRunnerFunc(boost::bind(&StartRunnerNever));
+    EXPECT_FALSE(bounded_queue.EnqueueBatch(batch));
+    EXPECT_EQ(19, bounded_queue.NumEnqueues());
+    EXPECT_EQ(13, bounded_queue.NumDrops());
+    EXPECT_EQ(19, bounded_queue.Length());
+    bounded_queue.Shutdown();
+    EXPECT_EQ(0, work_queue_.Length());
+}
+
 TEST_F(QueueTaskTest, WaterMarkTest) {
     // Setup watermarks
     WaterMarkInfo hwm1(5,
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <set>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/slab_allocator.h"
+#include "base/test/task_test_util.h"
+#include "testing/gunit.h"
+
+using std::set;
+using std::vector;
+
+class SlabAllocatorTest : public ::testing::Test {
+};
+
+// Allocates count objects and frees them, from the cache of its instance
+class SlabAllocatorTask : public Task {
+public:
+    SlabAllocatorTask(SlabAllocator *allocator, int instance, size_t count)
+        : Task(TaskScheduler::GetInstance()->GetTaskId("test::SlabAllocator"),
+               instance),
+          allocator_(allocator), count_(count) {
+    }
+    bool Run() {
+        vector<void *> objects;
+        for (size_t idx = 0; idx < count_; idx++) {
+            objects.push_back(allocator_->Allocate());
+        }
+        for (size_t idx = 0; idx < count_; idx++) {
+            allocator_->Free(objects[idx]);
+        }
+        return true;
+    }
+
+private:
+    SlabAllocator *allocator_;
+    size_t count_;
+};
+
+// Objects are carved out of a slab and recycled on free
+TEST_F(SlabAllocatorTest, AllocateFree) {
+    SlabAllocator allocator("test", 20);
+    EXPECT_EQ(24U, allocator.object_size());
+    EXPECT_EQ(0U, allocator.slab_count());
+
+    size_t per_slab = SlabAllocator::kSlabSize / allocator.object_size();
+    set<void *> objects;
+    for (size_t idx = 0; idx < per_slab; idx++) {
+        objects.insert(allocator.Allocate());
+    }
+    EXPECT_EQ(per_slab, objects.size());
+    EXPECT_EQ(1U, allocator.slab_count());
+    EXPECT_EQ(per_slab, allocator.in_use());
+    EXPECT_EQ(0U, allocator.free_count());
+
+    void *object = allocator.Allocate();
+    EXPECT_TRUE(objects.find(object) == objects.end());
+    EXPECT_EQ(2U, allocator.slab_count());
+    allocator.Free(object);
+    EXPECT_TRUE(allocator.Allocate() == object);
+    allocator.Free(object);
+
+    for (set<void *>::iterator it = objects.begin(); it != objects.end();
+         ++it) {
+        allocator.Free(*it);
+    }
+    EXPECT_EQ(0U, allocator.in_use());
+    EXPECT_EQ(2 * per_slab, allocator.free_count());
+    EXPECT_EQ(2 * SlabAllocator::kSlabSize, allocator.bytes());
+    EXPECT_EQ(per_slab + 2, allocator.allocs());
+}
+
+// Objects are allocated from the allocator for the size, from heap if the
+// size is more than the max size of the group
+TEST_F(SlabAllocatorTest, Group) {
+    SlabAllocatorGroup group("test", 128);
+    vector<const SlabAllocator *> list;
+    group.GetAllocators(&list);
+    EXPECT_EQ(0U, list.size());
+
+    void *object1 = group.Allocate(100);
+    void *object2 = group.Allocate(104);
+    void *object3 = group.Allocate(200);
+    group.GetAllocators(&list);
+    EXPECT_EQ(1U, list.size());
+    EXPECT_EQ("test/104", list[0]->name());
+    EXPECT_EQ(2U, list[0]->in_use());
+
+    group.Free(object1, 100);
+    group.Free(object2, 104);
+    group.Free(object3, 200);
+    EXPECT_EQ(0U, list[0]->in_use());
+}
+
+// Task instances allocate from their own caches, which give back all but
+// 2 * kBatchSize objects to the shared free list
+TEST_F(SlabAllocatorTest, TaskCaches) {
+    SlabAllocator allocator("test", 64);
+    const int kInstances = 8;
+    const size_t kCount = 1000;
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    for (int round = 0; round < 4; round++) {
+        for (int instance = 0; instance < kInstances; instance++) {
+            scheduler->Enqueue(
+                new SlabAllocatorTask(&allocator, instance, kCount));
+        }
+        task_util::WaitForIdle();
+    }
+
+    EXPECT_EQ(0U, allocator.in_use());
+    EXPECT_EQ(4U * kInstances * kCount, allocator.allocs());
+    size_t per_slab = SlabAllocator::kSlabSize / allocator.object_size();
+    EXPECT_EQ(allocator.slab_count() * per_slab, allocator.free_count());
+    EXPECT_LE(allocator.slab_count() * per_slab,
+              kInstances * (kCount + 2 * SlabAllocator::kBatchSize) +
+              per_slab);
+
+    // Objects held by the caches are handed out again
+    void *object = allocator.Allocate();
+    EXPECT_EQ(1U, allocator.in_use());
+    allocator.Free(object);
+    EXPECT_EQ(0U, allocator.in_use());
+}
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -224,6 +224,45 @@ bool BgpExport::Join(DBTablePartBase *root, const RibPeerSet &mjoin,
     return true;
 }
 
+//
+// Resync Processing.
+// 1. Calculate the desired attributes (UpdateInfo list) via BgpTable::Export
+//    and return them to the caller.
+// 2. Record them as advertised, without creating a RouteUpdate, for the peers
+//    that have no current or scheduled updates for the QUPDATE queue. Peers
+//    with a scheduled update after a route change get that update.
+//
+bool BgpExport::Resync(DBTablePartBase *root, const RibPeerSet &msync,
+        DBEntryBase *db_entry, UpdateInfoSList *uinfo_slist) {
+    RibOutUpdates *updates = ribout_->updates();
+    RibUpdateMonitor *monitor = updates->monitor();
+
+    // Bail if the route is already deleted.
+    if (db_entry->IsDeleted())
+        return true;
+
+    BgpRoute *route = static_cast<BgpRoute *>(db_entry);
+    bool reach = ribout_->table()->Export(ribout_, route, msync, *uinfo_slist);
+    if (!reach) {
+        return true;
+    }
+
+    RibPeerSet mcurrent, mscheduled;
+    monitor->GetPeerSetCurrentAndScheduled(db_entry, RibOutUpdates::QUPDATE,
+            &mcurrent, &mscheduled);
+    for (UpdateInfoSList::List::const_iterator iter = (*uinfo_slist)->begin();
+         iter != (*uinfo_slist)->end(); ++iter) {
+        RibPeerSet mset = iter->target;
+        mset.Reset(mcurrent);
+        mset.Reset(mscheduled);
+        if (!mset.empty()) {
+            monitor->SetPeerSetAdvertised(db_entry, iter->roattr, mset);
+        }
+    }
+
+    return true;
+}
+
 //
 // Leave Processing.
 // 1. Detect if there's no history or scheduled updates for the bitset of
@@ -12,6 +12,7 @@ class DBEntryBase;
 class DBTablePartBase;
 class RibOut;
 class RibPeerSet;
+class UpdateInfoSList;
 
 class BgpExport {
 public:
@@ -28,6 +29,12 @@ public:
     bool Refresh(DBTablePartBase *root, const RibPeerSet &mgroup,
                  DBEntryBase *db_entry);
 
+    // Mark the route as advertised to peers that still have it from a
+    // previous session instead of sending it again. The attributes that
+    // the route has for the peers are returned in uinfo_slist.
+    bool Resync(DBTablePartBase *root, const RibPeerSet &msync,
+                DBEntryBase *db_entry, UpdateInfoSList *uinfo_slist);
+
     // Cleanup the advertisement bits on update entries.
     bool Leave(DBTablePartBase *root, const RibPeerSet &mleave,
                DBEntryBase *db_entry);
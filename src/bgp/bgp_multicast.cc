@@ -51,6 +51,7 @@ McastForwarder::McastForwarder(McastSGEntry *sg_entry, ErmVpnRoute *route)
       route_(route),
       global_tree_route_(NULL),
       label_(0),
+      tree_index_(-1),
       address_(0),
       rd_(route->GetPrefix().route_distinguisher()),
       router_id_(route->GetPrefix().router_id()) {
@@ -362,6 +363,9 @@ McastSGEntry::McastSGEntry(McastManagerPartition *partition,
          level < McastTreeManager::LevelCount; ++level) {
         ForwarderSet *forwarders = new ForwarderSet;
         forwarder_sets_.push_back(forwarders);
+        tree_lists_.push_back(new McastForwarderList);
+        join_sets_.push_back(new ForwarderSet);
+        changed_sets_.push_back(new ForwarderSet);
         update_needed_.push_back(false);
     }
 }
@@ -371,6 +375,9 @@ McastSGEntry::McastSGEntry(McastManagerPartition *partition,
 //
 McastSGEntry::~McastSGEntry() {
     STLDeleteValues(&forwarder_sets_);
+    STLDeleteValues(&tree_lists_);
+    STLDeleteValues(&join_sets_);
+    STLDeleteValues(&changed_sets_);
 }
 
 //
@@ -382,11 +389,13 @@ std::string McastSGEntry::ToString() const {
 
 //
 // Add the given McastForwarder under this McastSGEntry and trigger update
-// of the distribution tree.
+// of the distribution tree. The McastForwarder gets attached to the tree
+// when the McastSGEntry is processed from the WorkQueue.
 //
 void McastSGEntry::AddForwarder(McastForwarder *forwarder) {
     uint8_t level = forwarder->level();
     forwarder_sets_[level]->insert(forwarder);
+    join_sets_[level]->insert(forwarder);
     update_needed_[level] = true;
     partition_->EnqueueSGEntry(this);
 }
@@ -398,8 +407,17 @@ void McastSGEntry::AddForwarder(McastForwarder *forwarder) {
 // Note that this method only handles the change = the caller determines that
 // there has been a change.
 //
+// The OLists of the McastForwarders linked to the given one refer to it's
+// address and label, so they need to be updated as well.
+//
 void McastSGEntry::ChangeForwarder(McastForwarder *forwarder) {
     uint8_t level = forwarder->level();
+    MarkChanged(forwarder);
+    for (McastForwarderList::const_iterator it =
+         forwarder->tree_links().begin(); it != forwarder->tree_links().end();
+         ++it) {
+        MarkChanged(*it);
+    }
     update_needed_[level] = true;
     partition_->EnqueueSGEntry(this);
 }
@@ -408,11 +426,19 @@ void McastSGEntry::ChangeForwarder(McastForwarder *forwarder) {
 // Delete the given McastForwarder from this McastSGEntry and trigger update
 // of the distribution tree.
 //
+// The McastForwarder is detached from the tree right away since the caller
+// is going to delete it. Notification of the McastForwarders that are linked
+// differently as a result is deferred till the tree gets updated.
+//
 void McastSGEntry::DeleteForwarder(McastForwarder *forwarder) {
     if (forwarder == forest_node_)
         forest_node_ = NULL;
     uint8_t level = forwarder->level();
+    if (forwarder->tree_index() >= 0)
+        DetachForwarder(forwarder);
     forwarder_sets_[level]->erase(forwarder);
+    join_sets_[level]->erase(forwarder);
+    changed_sets_[level]->erase(forwarder);
     update_needed_[level] = true;
     partition_->EnqueueSGEntry(this);
 }
@@ -551,14 +577,15 @@ void McastSGEntry::UpdateLocalTreeRoute() {
 }
 
 //
-// Update relevant [Local|Global]TreeRoutes for the McastSGEntry.
+// Update relevant [Local|Global]TreeRoutes for the McastSGEntry. Only the
+// GlobalTreeRoutes for McastForwarders that changed need to be updated.
 //
 void McastSGEntry::UpdateRoutes(uint8_t level) {
     if (level == McastTreeManager::LevelNative) {
         DeleteLocalTreeRoute();
         AddLocalTreeRoute();
     } else {
-        ForwarderSet *forwarders = forwarder_sets_[level];
+        ForwarderSet *forwarders = changed_sets_[level];
         for (ForwarderSet::iterator it = forwarders->begin();
              it != forwarders->end(); ++it) {
             (*it)->DeleteGlobalTreeRoute();
@@ -587,79 +614,227 @@ bool McastSGEntry::IsTreeBuilder(uint8_t level) {
 }
 
 //
+// Get the degree of the k-ary distribution tree at the given level.
 //
-// Update specified distribution tree for the McastSGEntry.  We traverse all
-// McastForwarders in sorted order and arrange them in breadth first fashion
-// in a k-ary tree.  Building the tree in this manner guarantees that we get
-// the same tree for a given set of forwarders, independent of the order in
-// in which they joined. This predictability is deemed to be more important
-// than other criteria such as minimizing disruption of traffic, minimizing
-// the cost/weight of the tree etc.
+int McastSGEntry::GetDegree(uint8_t level) const {
+    if (level == McastTreeManager::LevelNative) {
+        return McastTreeManager::kDegree;
+    } else {
+        return McastTreeManager::kDegree - 1;
+    }
+}
+
 //
-void McastSGEntry::UpdateTree(uint8_t level) {
-    CHECK_CONCURRENCY("db::DBTable");
+// Note that the ErmVpnRoute and GlobalTreeRoute for the McastForwarder need
+// to be updated when the distribution tree gets updated.
+//
+void McastSGEntry::MarkChanged(McastForwarder *forwarder) {
+    changed_sets_[forwarder->level()]->insert(forwarder);
+}
 
-    if (!update_needed_[level])
-        return;
-    update_needed_[level] = false;
+//
+// Link the McastForwarder at the given index in the tree to it's parent and
+// children, if any.  The McastForwarder at the index and all the linked ones
+// are marked as changed.
+//
+void McastSGEntry::LinkTreeNode(uint8_t level, int idx) {
+    McastForwarderList *tree = tree_lists_[level];
+    McastForwarder *forwarder = (*tree)[idx];
+    int degree = GetDegree(level);
+    MarkChanged(forwarder);
 
-    int degree;
-    if (level == McastTreeManager::LevelNative) {
-        degree = McastTreeManager::kDegree;
-    } else {
-        degree = McastTreeManager::kDegree - 1;
+    if (idx > 0) {
+        McastForwarder *parent_forwarder = (*tree)[(idx - 1) / degree];
+        forwarder->AddLink(parent_forwarder);
+        parent_forwarder->AddLink(forwarder);
+        MarkChanged(parent_forwarder);
     }
 
-    // First get rid of the previous distribution tree and enqueue all the
-    // associated ErmVpnRoutes for notification. Note that DBListeners will
-    // not get invoked until after this routine is done.
-    ForwarderSet *forwarders = forwarder_sets_[level];
-    for (ForwarderSet::iterator it = forwarders->begin();
-         it != forwarders->end(); ++it) {
-       (*it)->FlushLinks();
-       (*it)->ReleaseLabel();
-       partition_->GetTablePartition()->Notify((*it)->route());
+    int tree_size = tree->size();
+    for (int child_idx = idx * degree + 1;
+         child_idx <= idx * degree + degree && child_idx < tree_size;
+         ++child_idx) {
+        McastForwarder *child_forwarder = (*tree)[child_idx];
+        forwarder->AddLink(child_forwarder);
+        child_forwarder->AddLink(forwarder);
+        MarkChanged(child_forwarder);
     }
+}
 
-    // Bail if we're not the tree builder.
-    if (!IsTreeBuilder(level)) {
-        UpdateRoutes(level);
-        return;
+//
+// Remove all links to and from the given McastForwarder. McastForwarders it
+// was linked to are marked as changed.
+//
+void McastSGEntry::UnlinkTreeNode(McastForwarder *forwarder) {
+    for (McastForwarderList::const_iterator it =
+         forwarder->tree_links().begin(); it != forwarder->tree_links().end();
+         ++it) {
+        MarkChanged(*it);
     }
+    forwarder->FlushLinks();
+}
+
+//
+// Attach the given McastForwarder as the last node in the tree. Only the new
+// McastForwarder and it's parent are affected.
+//
+// Return false if we can't allocate a label for the McastForwarder.
+//
+bool McastSGEntry::AttachForwarder(McastForwarder *forwarder) {
+    assert(forwarder->tree_index() < 0);
+    forwarder->AllocateLabel();
+    if (!forwarder->label())
+        return false;
+
+    uint8_t level = forwarder->level();
+    McastForwarderList *tree = tree_lists_[level];
+    forwarder->set_tree_index(tree->size());
+    tree->push_back(forwarder);
+    LinkTreeNode(level, forwarder->tree_index());
+    return true;
+}
 
-    // Create a vector of pointers to the McastForwarders in sorted order.
-    // We do this because std::set doesn't support random access iterators.
-    // Skip if we can't allocate a label for the McastForwarder.
-    McastForwarderList vec;
-    vec.reserve(forwarders->size());
+//
+// Detach the given McastForwarder from the tree.  The hole is filled with the
+// last node in the tree so that the tree stays complete.  Only McastForwarders
+// that were linked to the given one, the last node and it's previous parent
+// are affected.
+//
+// The label of the given McastForwarder is left alone - it's released when
+// the McastForwarder is deleted or when it's label block changes.
+//
+void McastSGEntry::DetachForwarder(McastForwarder *forwarder) {
+    uint8_t level = forwarder->level();
+    McastForwarderList *tree = tree_lists_[level];
+    int idx = forwarder->tree_index();
+    assert(idx >= 0 && (*tree)[idx] == forwarder);
+
+    UnlinkTreeNode(forwarder);
+    forwarder->set_tree_index(-1);
+
+    McastForwarder *last_forwarder = tree->back();
+    tree->pop_back();
+    if (last_forwarder == forwarder)
+        return;
+
+    UnlinkTreeNode(last_forwarder);
+    (*tree)[idx] = last_forwarder;
+    last_forwarder->set_tree_index(idx);
+    LinkTreeNode(level, idx);
+}
+
+//
+// Build the specified distribution tree from scratch. We traverse all the
+// McastForwarders in sorted order and arrange them in breadth first fashion
+// in a k-ary tree.  Building the tree in this manner guarantees that we get
+// the same tree for a given set of forwarders, independent of the order in
+// in which they joined.
+//
+// McastForwarders for which we can't allocate a label are left on the join
+// set so that we try to attach them again on the next update.
+//
+void McastSGEntry::BuildTree(uint8_t level) {
+    ForwarderSet *join_forwarders = join_sets_[level];
+    join_forwarders->clear();
+
+    ForwarderSet *forwarders = forwarder_sets_[level];
+    tree_lists_[level]->reserve(forwarders->size());
     for (ForwarderSet::iterator it = forwarders->begin();
          it != forwarders->end(); ++it) {
         McastForwarder *forwarder = *it;
-        forwarder->AllocateLabel();
-        if (!forwarder->label())
-            continue;
-        vec.push_back(forwarder);
+        if (!AttachForwarder(forwarder))
+            join_forwarders->insert(forwarder);
     }
+}
 
-    // Go through each McastForwarder in the vector and link it to it's parent
-    // McastForwarder in the k-ary tree. We also add a link from the parent to
-    // the entry in question.
-    for (McastForwarderList::iterator it = vec.begin(); it != vec.end(); ++it) {
-        int idx = it - vec.begin();
-        if (idx == 0)
-            continue;
-
-        int parent_idx = (idx - 1) / degree;
-        McastForwarderList::iterator parent_it = vec.begin() + parent_idx;
-        assert(parent_it != vec.end());
+//
+// Get rid of the specified distribution tree. All McastForwarders in the tree
+// are marked as changed.
+//
+void McastSGEntry::FlushTree(uint8_t level) {
+    McastForwarderList *tree = tree_lists_[level];
+    for (McastForwarderList::iterator it = tree->begin();
+         it != tree->end(); ++it) {
         McastForwarder *forwarder = *it;
-        McastForwarder *parent_forwarder = *parent_it;
-        forwarder->AddLink(parent_forwarder);
-        parent_forwarder->AddLink(forwarder);
+        forwarder->FlushLinks();
+        forwarder->ReleaseLabel();
+        forwarder->set_tree_index(-1);
+        MarkChanged(forwarder);
+    }
+    tree->clear();
+    join_sets_[level]->clear();
+}
+
+//
+// Update specified distribution tree for the McastSGEntry.
+//
+// The tree is built from scratch if we just became the tree builder. After
+// that, McastForwarders that joined are attached to the tree one at a time
+// and the ones that left have already been detached from it. This bounds the
+// churn for a join or leave to a handful of McastForwarders, independent of
+// the size of the tree. Labels of McastForwarders that stay in the tree are
+// not changed.
+//
+// Only the ErmVpnRoutes for McastForwarders whose links or label changed are
+// enqueued for notification. Note that DBListeners will not get invoked until
+// after this routine is done.
+//
+void McastSGEntry::UpdateTree(uint8_t level) {
+    CHECK_CONCURRENCY("db::DBTable");
+
+    if (!update_needed_[level])
+        return;
+    update_needed_[level] = false;
+
+    McastForwarderList *tree = tree_lists_[level];
+    ForwarderSet *join_forwarders = join_sets_[level];
+    ForwarderSet *changed_forwarders = changed_sets_[level];
+    if (!IsTreeBuilder(level)) {
+        // Get rid of the tree if we're not the tree builder.
+        FlushTree(level);
+    } else if (tree->empty()) {
+        BuildTree(level);
+    } else {
+        // Allocate new labels for McastForwarders in the tree whose label
+        // block has changed. Detach them if we can't allocate a label and
+        // try to attach them again later.
+        McastForwarderList relabel_list;
+        for (ForwarderSet::iterator it = changed_forwarders->begin();
+             it != changed_forwarders->end(); ++it) {
+            McastForwarder *forwarder = *it;
+            if (forwarder->tree_index() >= 0 && !forwarder->label())
+                relabel_list.push_back(forwarder);
+        }
+        for (McastForwarderList::iterator it = relabel_list.begin();
+             it != relabel_list.end(); ++it) {
+            McastForwarder *forwarder = *it;
+            forwarder->AllocateLabel();
+            if (forwarder->label())
+                continue;
+            DetachForwarder(forwarder);
+            join_forwarders->insert(forwarder);
+        }
+
+        // Attach McastForwarders that joined.
+        for (ForwarderSet::iterator it = join_forwarders->begin();
+             it != join_forwarders->end(); ) {
+            McastForwarder *forwarder = *it;
+            if (AttachForwarder(forwarder)) {
+                join_forwarders->erase(it++);
+            } else {
+                ++it;
+            }
+        }
     }
 
-    // Update [Local|Global]TreeRoutes.
+    // Enqueue the ErmVpnRoutes for the changed McastForwarders and update
+    // [Local|Global]TreeRoutes.
+    for (ForwarderSet::iterator it = changed_forwarders->begin();
+         it != changed_forwarders->end(); ++it) {
+        partition_->GetTablePartition()->Notify((*it)->route());
+    }
     UpdateRoutes(level);
+    changed_forwarders->clear();
 }
 
 //
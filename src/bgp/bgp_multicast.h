@@ -72,6 +72,12 @@ typedef std::vector<McastForwarder *> McastForwarderList;
 // distribution tree. Thus the label can be stored in the McastForwarder itself
 // and does not need to be part of the link information.
 //
+// The tree_index_ is the position of the McastForwarder in the breadth first
+// layout of the k-ary distribution tree and is -1 if the McastForwarder is
+// not part of the tree. The label is allocated when the McastForwarder gets
+// attached to the tree and is retained till it's detached, so that it stays
+// stable when other McastForwarders join or leave the tree.
+//
 // If this control-node is elected as the tree builder for the (G,S), a global
 // distribution tree of all Local McastForwarders is built.  Relevant edges of
 // this global distribution tree are advertised to each control-node by adding
@@ -102,12 +108,15 @@ public:
 
     uint8_t level() const { return level_; }
     uint32_t label() const { return label_; }
+    int tree_index() const { return tree_index_; }
+    void set_tree_index(int tree_index) { tree_index_ = tree_index; }
     Ip4Address address() const { return address_; }
     std::vector<std::string> encap() const { return encap_; }
     ErmVpnRoute *route() { return route_; }
     const RouteDistinguisher &route_distinguisher() const { return rd_; }
     Ip4Address router_id() const { return router_id_; }
 
+    const McastForwarderList &tree_links() const { return tree_links_; }
     bool empty() { return tree_links_.empty(); }
 
 private:
@@ -123,6 +132,7 @@ private:
     uint8_t level_;
     LabelBlockPtr label_block_;
     uint32_t label_;
+    int tree_index_;
     Ip4Address address_;
     RouteDistinguisher rd_;
     Ip4Address router_id_;
@@ -198,6 +208,14 @@ struct McastForwarderCompare {
 // when a McastForwarder is added, changed or deleted so that the distribution
 // tree and the necessary LocalTreeRoute or GlobalTreeRoutes can be updated.
 //
+// The distribution tree at each NodeLevel is maintained incrementally. The
+// tree_lists_ keep the McastForwarders in the tree in breadth first order. A
+// McastForwarder that joins is attached as the last node of the tree and the
+// hole left by a McastForwarder that leaves is filled with the last node. The
+// join_sets_ keep McastForwarders waiting to be attached and changed_sets_
+// keep McastForwarders whose links or label changed since the last update of
+// the tree - only ErmVpnRoutes for these McastForwarders get notified.
+//
 class McastSGEntry : public DBState {
 public:
     McastSGEntry(McastManagerPartition *partition,
@@ -240,6 +258,14 @@ private:
     typedef std::set<McastForwarder *, McastForwarderCompare> ForwarderSet;
 
     bool IsTreeBuilder(uint8_t level);
+    int GetDegree(uint8_t level) const;
+    void MarkChanged(McastForwarder *forwarder);
+    void LinkTreeNode(uint8_t level, int idx);
+    void UnlinkTreeNode(McastForwarder *forwarder);
+    bool AttachForwarder(McastForwarder *forwarder);
+    void DetachForwarder(McastForwarder *forwarder);
+    void BuildTree(uint8_t level);
+    void FlushTree(uint8_t level);
     void UpdateTree(uint8_t level);
     void UpdateRoutes(uint8_t level);
 
@@ -249,6 +275,9 @@ private:
     ErmVpnRoute *local_tree_route_;
     ErmVpnRoute *tree_result_route_;
     std::vector<ForwarderSet *> forwarder_sets_;
+    std::vector<McastForwarderList *> tree_lists_;
+    std::vector<ForwarderSet *> join_sets_;
+    std::vector<ForwarderSet *> changed_sets_;
     std::vector<bool> update_needed_;
     bool on_work_queue_;
 
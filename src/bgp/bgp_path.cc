@@ -4,6 +4,7 @@
 
 #include "bgp/bgp_path.h"
 
+#include "base/slab_allocator.h"
 #include "bgp/bgp_route.h"
 
 std::string BgpPath::PathIdString(uint32_t path_id) {
@@ -33,26 +34,73 @@ std::string BgpPath::PathSourceString(PathSource source) {
 
 BgpPath::BgpPath(const IPeer *peer, uint32_t path_id, PathSource src,
                  const BgpAttrPtr ptr, uint32_t flags, uint32_t label)
-    : peer_(peer), path_id_(path_id), source_(src), attr_(ptr),
-      flags_(flags), label_(label) {
+    : peer_(peer), attr_(ptr), path_id_(path_id), label_(label),
+      source_(src), flags_(flags), route_(NULL) {
+    InitCompareKey();
 }
 
 BgpPath::BgpPath(const IPeer *peer, PathSource src, const BgpAttrPtr ptr,
         uint32_t flags, uint32_t label)
-    : peer_(peer), path_id_(0), source_(src), attr_(ptr),
-      flags_(flags), label_(label) {
+    : peer_(peer), attr_(ptr), path_id_(0), label_(label),
+      source_(src), flags_(flags), route_(NULL) {
+    InitCompareKey();
 }
 
 BgpPath::BgpPath(uint32_t path_id, PathSource src, const BgpAttrPtr ptr,
         uint32_t flags, uint32_t label)
-    : peer_(NULL), path_id_(path_id), source_(src), attr_(ptr),
-      flags_(flags), label_(label) {
+    : peer_(NULL), attr_(ptr), path_id_(path_id), label_(label),
+      source_(src), flags_(flags), route_(NULL) {
+    InitCompareKey();
 }
 
 BgpPath::BgpPath(PathSource src, const BgpAttrPtr ptr,
         uint32_t flags, uint32_t label)
-    : peer_(NULL), path_id_(0), source_(src), attr_(ptr),
-      flags_(flags), label_(label) {
+    : peer_(NULL), attr_(ptr), path_id_(0), label_(label),
+      source_(src), flags_(flags), route_(NULL) {
+    InitCompareKey();
+}
+
+//
+// Cache the leading path selection attributes in a form where smaller is
+// better. Attributes of a path do not change once it is created, so paths
+// can be ordered without walking the attributes every time.
+//
+void BgpPath::InitCompareKey() {
+    if (!attr_) {
+        pref_key_ = as_path_key_ = 0;
+        return;
+    }
+
+    // Larger local_pref and sequence_number are better.
+    pref_key_ = static_cast<uint64_t>(~attr_->local_pref()) << 32;
+    pref_key_ |= static_cast<uint32_t>(~attr_->sequence_number());
+
+    // Shorter as path and lower origin are better. The as path count of a
+    // path in an update message can't overflow the 24 bits left for it.
+    as_path_key_ = static_cast<uint32_t>(attr_->as_path_count()) << 8;
+    as_path_key_ |= static_cast<uint8_t>(attr_->origin());
+}
+
+//
+// Allocators for BgpPath and BgpSecondaryPath. The allocators are never
+// deleted since paths may be deleted after static destructors have run.
+//
+static SlabAllocatorGroup *PathAllocators() {
+    static SlabAllocatorGroup *allocators =
+        new SlabAllocatorGroup("BgpPath", sizeof(BgpSecondaryPath));
+    return allocators;
+}
+
+void *BgpPath::operator new(size_t size) {
+    return PathAllocators()->Allocate(size);
+}
+
+void BgpPath::operator delete(void *ptr, size_t size) {
+    PathAllocators()->Free(ptr, size);
+}
+
+void BgpPath::GetAllocators(std::vector<const SlabAllocator *> *list) {
+    PathAllocators()->GetAllocators(list);
 }
 
 // True is better
@@ -71,19 +119,15 @@ int BgpPath::PathCompare(const BgpPath &rhs, bool allow_ecmp) const {
     // Feasible Path first
     KEY_COMPARE(rhs.IsFeasible(), IsFeasible());
 
-    // Compare local_pref in reverse order as larger is better.
-    KEY_COMPARE(rattr->local_pref(), attr_->local_pref());
-
-    // Compare sequence_number in reverse order as larger is better.
-    KEY_COMPARE(rattr->sequence_number(), attr_->sequence_number());
+    // Compare local_pref and then sequence_number, larger is better.
+    KEY_COMPARE(pref_key_, rhs.pref_key_);
 
     // For ECMP paths, above checks should suffice
     if (allow_ecmp)
         return 0;
 
-    KEY_COMPARE(attr_->as_path_count(), rattr->as_path_count());
-
-    KEY_COMPARE(attr_->origin(), rattr->origin());
+    // Compare as path count and then origin, smaller is better.
+    KEY_COMPARE(as_path_key_, rhs.as_path_key_);
 
     // Compare med if both paths are learnt from the same neighbor as.
     if (attr_->neighbor_as() && attr_->neighbor_as() == rattr->neighbor_as())
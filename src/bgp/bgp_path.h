@@ -5,7 +5,10 @@
 #ifndef SRC_BGP_BGP_PATH_H_
 #define SRC_BGP_BGP_PATH_H_
 
+#include <boost/intrusive/list.hpp>
+
 #include <string>
+#include <vector>
 
 #include "base/util.h"
 #include "route/path.h"
@@ -14,6 +17,7 @@
 
 class BgpTable;
 class BgpRoute;
+class SlabAllocator;
 
 class BgpPath : public Path {
 public:
@@ -36,6 +40,12 @@ public:
         Local = 5,
     };
 
+    // Link in the list of paths of the peer in a table partition. Unlinks
+    // itself when the path is deleted.
+    typedef boost::intrusive::list_member_hook<
+        boost::intrusive::link_mode<boost::intrusive::auto_unlink>
+    > PeerNode;
+
     static const uint32_t INFEASIBLE_MASK = (AsPathLooped |
         NoNeighborAs | NoTunnelEncap | OriginatorIdLooped | ResolveNexthop);
 
@@ -53,6 +63,11 @@ public:
     virtual ~BgpPath() {
     }
 
+    // Paths are allocated from a SlabAllocator for each path size.
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
+    static void GetAllocators(std::vector<const SlabAllocator *> *list);
+
     RouteDistinguisher GetSourceRouteDistinguisher() const;
 
     bool IsVrfOriginated() const {
@@ -101,7 +116,7 @@ public:
     }
 
     PathSource GetSource() const {
-        return source_;
+        return static_cast<PathSource>(source_);
     }
 
     // Check if the path is stale
@@ -129,13 +144,31 @@ public:
     // Select one path over other
     int PathCompare(const BgpPath &rhs, bool allow_ecmp) const;
 
+    // Route of the path, set while it's in the path list of its peer.
+    BgpRoute *GetRoute() const { return route_; }
+
 private:
+    friend class BgpTable;
+
+    void InitCompareKey();
+
+    // Fields are ordered to avoid padding, there's a BgpPath for each path
+    // of each route.
     const IPeer *peer_;
-    const uint32_t path_id_;
-    const PathSource source_;
     const BgpAttrPtr attr_;
-    uint32_t flags_;
+    const uint32_t path_id_;
     uint32_t label_;
+
+    // Keys for local_pref, sequence_number, as path count and origin
+    // used by PathCompare.
+    uint64_t pref_key_;
+    uint32_t as_path_key_;
+
+    uint32_t source_ : 8;
+    uint32_t flags_ : 24;
+
+    PeerNode peer_node_;
+    BgpRoute *route_;
 };
 
 class BgpSecondaryPath : public BgpPath {
@@ -163,6 +163,13 @@ int PeerCloseManager::GetActionAtStart(IPeerRib *peer_rib) {
 
     if (peer_rib->IsRibOutRegistered()) {
         action |= static_cast<int>(MembershipRequest::RIBOUT_DELETE);
+
+        // Keep a snapshot of the routes advertised to peers that reported
+        // an adj-rib-out digest when they subscribed, so that the routes
+        // the peer kept need not be sent again when it comes back up
+        if (peer_rib->ribout_resync()) {
+            action |= static_cast<int>(MembershipRequest::RIBOUT_SNAPSHOT);
+        }
     }
 
     // If graceful restart timer is already running, then this is a second
@@ -245,13 +252,14 @@ void PeerCloseManager::Close() {
 // not learned again in the new session.
 
 //
-// Concurrency: Runs in the context of the DB Walker task launched by peer rib
-// membership manager
+// Concurrency: Runs in the context of the db::DBTable task for the partition,
+// launched by peer rib membership manager
 //
-// DBWalker callback routine for each of the RibIn prefix.
+// Callback routine for each of the RibIn paths of the peer in the partition.
+// Multiple paths could exist for a route in ecmp cases.
 //
-void PeerCloseManager::ProcessRibIn(DBTablePartBase *root, BgpRoute *rt,
-                                    BgpTable *table, int action_mask) {
+void PeerCloseManager::ProcessRibIn(DBTablePartBase *root, BgpTable *table,
+                                    BgpPath *path, int action_mask) {
     DBRequest::DBOperation oper;
     BgpAttrPtr attrs;
     MembershipRequest::Action  action;
@@ -264,57 +272,43 @@ void PeerCloseManager::ProcessRibIn(DBTablePartBase *root, BgpRoute *rt,
 
     if (action == MembershipRequest::INVALID) return;
 
-    // Process all paths sourced from this peer_. Multiple paths could exist
-    // in ecmp cases.
-    for (Route::PathList::iterator it = rt->GetPathList().begin(), next = it;
-         it != rt->GetPathList().end(); it = next) {
-        next++;
-
-        // Skip secondary paths.
-        if (dynamic_cast<BgpSecondaryPath *>(it.operator->())) continue;
-        BgpPath *path = static_cast<BgpPath *>(it.operator->());
-        if (path->GetPeer() != peer_) continue;
-
-        switch (action) {
-            case MembershipRequest::RIBIN_SWEEP:
-
-                // Stale paths must be deleted
-                if (!path->IsStale()) {
-                    return;
-                }
-                oper = DBRequest::DB_ENTRY_DELETE;
-                attrs = NULL;
-                break;
-
-            case MembershipRequest::RIBIN_DELETE:
-
-                // This path must be deleted. Hence attr is not required
-                oper = DBRequest::DB_ENTRY_DELETE;
-                attrs = NULL;
-                break;
-
-            case MembershipRequest::RIBIN_STALE:
-
-                // This path must be marked for staling. Update the local
-                // preference and update the route accordingly
-                oper = DBRequest::DB_ENTRY_ADD_CHANGE;
-
-                // Update attrs with maximum local preference so that this path
-                // is least preferred
-                // TODO(ananth): Check for the right local-pref value to use
-                attrs = peer_->server()->attr_db()->\
-                        ReplaceLocalPreferenceAndLocate(path->GetAttr(), 1);
-                path->SetStale();
-                break;
-
-            default:
-                return;
-        }
+    switch (action) {
+        case MembershipRequest::RIBIN_SWEEP:
 
-        // Feed the route modify/delete request to the table input process
-        table->InputCommon(root, rt, path, peer_, NULL, oper, attrs,
-            path->GetPathId(), path->GetFlags(), path->GetLabel());
+            // Stale paths must be deleted
+            if (!path->IsStale()) {
+                return;
+            }
+            oper = DBRequest::DB_ENTRY_DELETE;
+            attrs = NULL;
+            break;
+
+        case MembershipRequest::RIBIN_DELETE:
+
+            // This path must be deleted. Hence attr is not required
+            oper = DBRequest::DB_ENTRY_DELETE;
+            attrs = NULL;
+            break;
+
+        case MembershipRequest::RIBIN_STALE:
+
+            // This path must be marked for staling. Update the local
+            // preference and update the route accordingly
+            oper = DBRequest::DB_ENTRY_ADD_CHANGE;
+
+            // Update attrs with maximum local preference so that this path
+            // is least preferred
+            // TODO(ananth): Check for the right local-pref value to use
+            attrs = peer_->server()->attr_db()->\
+                    ReplaceLocalPreferenceAndLocate(path->GetAttr(), 1);
+            path->SetStale();
+            break;
+
+        default:
+            return;
     }
 
-    return;
+    // Feed the route modify/delete request to the table input process
+    table->InputCommon(root, path->GetRoute(), path, peer_, NULL, oper, attrs,
+        path->GetPathId(), path->GetFlags(), path->GetLabel());
 }
@@ -14,6 +14,7 @@
 #include "bgp/ipeer.h"
 
 class IPeerRib;
+class BgpPath;
 class BgpRoute;
 class BgpTable;
 
@@ -51,7 +52,7 @@ public:
     void SweepComplete(IPeer *ipeer, BgpTable *table);
     int GetCloseTypeForTimerCallback(IPeerRib *peer_rib);
     int GetActionAtStart(IPeerRib *peer_rib);
-    void ProcessRibIn(DBTablePartBase *root, BgpRoute *rt, BgpTable *table,
+    void ProcessRibIn(DBTablePartBase *root, BgpTable *table, BgpPath *path,
                       int action_mask);
     bool IsCloseInProgress();
 
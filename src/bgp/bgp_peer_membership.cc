@@ -7,19 +7,28 @@
 
 #include <boost/assign/list_of.hpp>
 
+#include "base/task.h"
 #include "base/task_annotations.h"
+#include "base/time_util.h"
+#include "base/timer.h"
 #include "bgp/bgp_export.h"
 #include "bgp/bgp_log.h"
 #include "bgp/bgp_peer_types.h"
 #include "bgp/bgp_ribout_updates.h"
 #include "bgp/bgp_route.h"
+#include "bgp/bgp_server.h"
+#include "bgp/bgp_update.h"
+#include "bgp/bgp_update_monitor.h"
 #include "bgp/routing-instance/routing_instance.h"
 #include "bgp/scheduling_group.h"
+#include "db/db_table_partition.h"
 
 using std::vector;
 
 int PeerRibMembershipManager::membership_task_id_ = -1;
 const int PeerRibMembershipManager::kMembershipTaskInstanceId;
+const size_t PeerRibMembershipManager::kMaxRibOutSnapshots;
+const int PeerRibMembershipManager::kDefaultRibOutSnapshotExpiry;
 
 MembershipRequest::MembershipRequest() {
     action_mask = INVALID;
@@ -51,6 +60,9 @@ std::string MembershipRequest::ActionMaskToString(Action action_mask) {
     if (action_mask & RIBOUT_DELETE) {
         action_str << "RibOutDelete, ";
     }
+    if (action_mask & RIBOUT_SNAPSHOT) {
+        action_str << "RibOutSnapshot, ";
+    }
 
     return action_str.str();
 }
@@ -63,6 +75,7 @@ std::string IPeerRibEvent::EventTypeToString(EventType event_type) {
         boost::assign::map_list_of
             (REGISTER_RIB, "RegisterRib")
             (REGISTER_RIB_COMPLETE, "RegisterRibComplete")
+            (REGISTER_RIB_RESYNC, "RegisterRibResync")
             (UNREGISTER_RIB, "UnregisterRib")
             (UNREGISTER_RIB_COMPLETE, "UnregisterRibComplete")
             (UNREGISTER_PEER, "UnregisterPeer")
@@ -81,6 +94,7 @@ IPeerRib::IPeerRib(
       ribin_registered_(false),
       ribout_registered_(false),
       stale_(false),
+      ribout_resync_(false),
       instance_id_(-1) {
     if (membership_mgr != NULL) {
         LifetimeActor *deleter = table ? table->deleter() : NULL;
@@ -163,21 +177,18 @@ void IPeerRib::RibInJoin(DBTablePartBase *root, DBEntryBase *db_entry,
 }
 
 //
-// Concurrency: Runs in the context of db-walker launched from the BGP peer
-// membership task.
+// Concurrency: Runs in the context of the db::DBTable task for the partition,
+// launched from the BGP peer membership task.
 //
-// Close RibIn of this IPeerRib for a particular prefix. Based on the action
-// we may mark the route as stale, sweep the route if it is stale or just
-// delete the route altogether.
+// Close RibIn of this IPeerRib for a particular path. Based on the action
+// we may mark the path as stale, sweep the path if it is stale or just
+// delete the path altogether.
 //
-void IPeerRib::RibInLeave(DBTablePartBase *root, DBEntryBase *db_entry,
-                          BgpTable *table,
+void IPeerRib::RibInLeave(DBTablePartBase *root, BgpPath *path,
                           MembershipRequest::Action action_mask) {
-    BgpRoute *rt = static_cast<BgpRoute *>(db_entry);
-
     if (!IsRibInRegistered()) return;
     ipeer_->peer_close()->close_manager()->
-        ProcessRibIn(root, rt, table, action_mask);
+        ProcessRibIn(root, table_, path, action_mask);
 }
 
 //
@@ -261,25 +272,40 @@ void IPeerRib::SetRibOutRegistered(bool set) {
     ribout_registered_ = set;
 }
 
+//
+// Add the peer to the RibPeerSet for the RibOut in the list.
+//
+void IPeerRib::AddRibOutPeer(RibOutPeerSetList *list) {
+    int index = ribout_->GetPeerIndex(ipeer_);
+    for (RibOutPeerSetList::iterator it = list->begin();
+         it != list->end(); ++it) {
+        if (it->first == ribout_) {
+            it->second.set(index);
+            return;
+        }
+    }
+    list->push_back(std::make_pair(ribout_, RibPeerSet()));
+    list->back().second.set(index);
+}
+
 //
 // Process RibOut creation for a particular prefix
 //
 // Concurrency: Runs in the context of db-walker launched from the BGP peer
 // membership task.
 //
+// The peer is added to the join list instead of joining the route right away,
+// so that the caller can launch one BgpExport::Join for all peers with the
+// same RibOut.
+//
 void IPeerRib::RibOutJoin(DBTablePartBase *root, DBEntryBase *db_entry,
                           BgpTable *table,
-                          MembershipRequest::Action action_mask) {
+                          MembershipRequest::Action action_mask,
+                          RibOutPeerSetList *join_list) {
     if (!(action_mask & MembershipRequest::RIBOUT_ADD)) {
         return;
     }
-
-    RibPeerSet jmask;
-
-    // TODO(ananth): For peers with the same export policy, we could combine
-    // and launch one BgpExport::Join
-    jmask.set(ribout_->GetPeerIndex(ipeer_));
-    ribout_->bgp_export()->Join(root, jmask, db_entry);
+    AddRibOutPeer(join_list);
 }
 
 //
@@ -288,17 +314,17 @@ void IPeerRib::RibOutJoin(DBTablePartBase *root, DBEntryBase *db_entry,
 // Concurrency: Runs in the context of db-walker launched from the BGP peer
 // membership task.
 //
+// The peer is added to the leave list, the caller launches one
+// BgpExport::Leave for all peers with the same RibOut.
+//
 void IPeerRib::RibOutLeave(DBTablePartBase *root, DBEntryBase *db_entry,
                            BgpTable *table,
-                           MembershipRequest::Action action_mask) {
+                           MembershipRequest::Action action_mask,
+                           RibOutPeerSetList *leave_list) {
     if (!(action_mask & MembershipRequest::RIBOUT_DELETE)) {
         return;
     }
-
-    RibPeerSet lmask;
-    lmask.set(ribout_->GetPeerIndex(ipeer_));
-
-    ribout_->bgp_export()->Leave(root, lmask, db_entry);
+    AddRibOutPeer(leave_list);
 }
 
 void IPeerRib::ManagedDelete() {
@@ -313,7 +339,9 @@ void IPeerRib::ManagedDelete() {
 // required.  Also create a WorkQueue to handle IPeerRibEvents.
 //
 PeerRibMembershipManager::PeerRibMembershipManager(BgpServer *server) :
-        server_(server), current_jobs_count_(0), total_jobs_count_(0) {
+        server_(server), current_jobs_count_(0), total_jobs_count_(0),
+        snapshot_timer_(NULL),
+        snapshot_expiry_secs_(kDefaultRibOutSnapshotExpiry) {
     if (membership_task_id_ == -1) {
         TaskScheduler *scheduler = TaskScheduler::GetInstance();
         membership_task_id_ = scheduler->GetTaskId("bgp::PeerMembership");
@@ -323,12 +351,16 @@ PeerRibMembershipManager::PeerRibMembershipManager(BgpServer *server) :
         membership_task_id_, kMembershipTaskInstanceId,
         boost::bind(&PeerRibMembershipManager::IPeerRibEventCallback, this,
                     _1));
+    snapshot_timer_ = TimerManager::CreateTimer(*server->ioservice(),
+        "RibOut Snapshot Timer", membership_task_id_,
+        kMembershipTaskInstanceId);
 }
 
 //
 // Destructor for PeerMembershipMgr. Delete the WorkQueue of IPeerRibEvents.
 //
 PeerRibMembershipManager::~PeerRibMembershipManager() {
+    TimerManager::DeleteTimer(snapshot_timer_);
     delete event_queue_;
 }
 
@@ -416,14 +448,19 @@ void PeerRibMembershipManager::Join(BgpTable *table,
 //
 // Handle RibIna and RibOut join for a particular prefix to a set of peers
 //
+// Peers with the same RibOut are joined with a single BgpExport::Join, so
+// that the route is exported once for all of them. This keeps the cost of
+// many peers registering together e.g. agents reconnecting after a control
+// node restart, close to that of a single peer.
+//
 bool PeerRibMembershipManager::RouteJoin(DBTablePartBase *root,
                                          DBEntryBase *db_entry, BgpTable *table,
                                          MembershipRequestList *request_list) {
     // Iterate through each of the peers in the request list and process RibIn
     // and RibOut for this peer
-    //
-    // TODO(ananth): RibOut can be aggregated into a single call for all peers
-    // with the same export policy
+    IPeerRib::RibOutPeerSetList join_list;
+    IPeerRib::RibOutPeerSetList resync_list;
+    int bucket = -1;
     for (MembershipRequestList::iterator iter = request_list->begin();
              iter != request_list->end(); iter++) {
         MembershipRequest *request = iter.operator->();
@@ -432,13 +469,77 @@ bool PeerRibMembershipManager::RouteJoin(DBTablePartBase *root,
 
         if (peer_rib) {
             peer_rib->RibInJoin(root, db_entry, table, request->action_mask);
-            peer_rib->RibOutJoin(root, db_entry, table, request->action_mask);
+
+            // Peers that may still have the route from their previous
+            // session are resynced instead of joined.
+            IPeerRib::RibOutPeerSetList *list = &join_list;
+            if (request->resync && request->resync->candidate_mask()) {
+                if (bucket < 0) {
+                    bucket = RibOutDigest::RouteBucket(
+                        static_cast<BgpRoute *>(db_entry));
+                }
+                if (request->resync->IsCandidate(bucket))
+                    list = &resync_list;
+            }
+            peer_rib->RibOutJoin(root, db_entry, table, request->action_mask,
+                                 list);
         }
     }
 
+    for (IPeerRib::RibOutPeerSetList::const_iterator it = join_list.begin();
+         it != join_list.end(); ++it) {
+        it->first->bgp_export()->Join(root, it->second, db_entry);
+    }
+
+    if (!resync_list.empty()) {
+        RouteJoinResync(root, db_entry, table, request_list, bucket,
+                        resync_list);
+    }
+
     return true;
 }
 
+//
+// Concurrency: Runs in the context of the db walker task triggered from
+// BGP peer membership task.
+//
+// Mark the route as advertised to the peers in the resync list, and add
+// what the route has for each of them to the digest of its current routes.
+//
+void PeerRibMembershipManager::RouteJoinResync(DBTablePartBase *root,
+        DBEntryBase *db_entry, BgpTable *table,
+        MembershipRequestList *request_list, int bucket,
+        const IPeerRib::RibOutPeerSetList &resync_list) {
+    BgpRoute *route = static_cast<BgpRoute *>(db_entry);
+    for (IPeerRib::RibOutPeerSetList::const_iterator it = resync_list.begin();
+         it != resync_list.end(); ++it) {
+        RibOut *ribout = it->first;
+        UpdateInfoSList uinfo_slist;
+        ribout->bgp_export()->Resync(root, it->second, db_entry, &uinfo_slist);
+
+        for (MembershipRequestList::iterator iter = request_list->begin();
+             iter != request_list->end(); iter++) {
+            MembershipRequest *request = iter.operator->();
+            if (!request->resync || !request->resync->IsCandidate(bucket))
+                continue;
+            IPeerRib *peer_rib = IPeerRibFind(request->ipeer, table);
+            if (!peer_rib || peer_rib->ribout() != ribout)
+                continue;
+
+            int index = ribout->GetPeerIndex(request->ipeer);
+            for (UpdateInfoSList::List::const_iterator uinfo_it =
+                 uinfo_slist->begin(); uinfo_it != uinfo_slist->end();
+                 ++uinfo_it) {
+                if (uinfo_it->target.test(index)) {
+                    request->resync->Add(root->index(), bucket,
+                        RibOutDigest::RouteHash(route, uinfo_it->roattr));
+                    break;
+                }
+            }
+        }
+    }
+}
+
 //
 // Concurrency: Runs in the context of the DB partition task.
 //
@@ -449,6 +550,94 @@ void PeerRibMembershipManager::JoinDone(DBTableBase *db,
                                         MembershipRequestList *request_list) {
     BgpTable *table = static_cast<BgpTable *>(db);
 
+    // The routes of the buckets that turn out not to be in sync with a peer
+    // that was resynced are sent with a second walk.
+    bool resync = false;
+    for (MembershipRequestList::iterator iter = request_list->begin();
+         iter != request_list->end(); iter++) {
+        if (iter->resync && iter->resync->WalkDone())
+            resync = true;
+    }
+
+    IPeerRibEvent *event =
+        new IPeerRibEvent(resync ? IPeerRibEvent::REGISTER_RIB_RESYNC :
+                          IPeerRibEvent::REGISTER_RIB_COMPLETE, NULL, table,
+                          request_list);
+    Enqueue(event);
+}
+
+//
+// Concurrency: Runs in the context of the BGP peer membership task.
+//
+// Start a walk to send the routes of the dirty buckets to the peers that
+// were resynced.
+//
+void PeerRibMembershipManager::Resync(BgpTable *table,
+                                      MembershipRequestList *request_list) {
+    DB *db = table->database();
+    DBTableWalker *walker = db->GetWalker();
+
+    walker->WalkTable(table, NULL,
+        // _1: DBTablePartition, _2: DBEntry
+        boost::bind(&PeerRibMembershipManager::RouteResync, this, _1, _2,
+                    table, request_list),
+
+        // _1: DBTablePartition
+        boost::bind(&PeerRibMembershipManager::ResyncDone, this, _1,
+                    request_list));
+}
+
+//
+// Concurrency: Runs in the context of the db walker task triggered from
+// BGP peer membership task.
+//
+// The route was marked as advertised by the join walk, but the peer does
+// not have the same routes for the bucket. Clean up the advertised state
+// and join the route again to send it.
+//
+bool PeerRibMembershipManager::RouteResync(DBTablePartBase *root,
+                                           DBEntryBase *db_entry,
+                                           BgpTable *table,
+                                           MembershipRequestList *request_list) {
+    IPeerRib::RibOutPeerSetList resync_list;
+    int bucket = -1;
+    for (MembershipRequestList::iterator iter = request_list->begin();
+             iter != request_list->end(); iter++) {
+        MembershipRequest *request = iter.operator->();
+        if (!request->resync || !request->resync->dirty_mask())
+            continue;
+        if (bucket < 0)
+            bucket = RibOutDigest::RouteBucket(
+                static_cast<BgpRoute *>(db_entry));
+        if (!request->resync->IsDirty(bucket))
+            continue;
+
+        IPeerRib *peer_rib = IPeerRibFind(request->ipeer, table);
+        if (peer_rib) {
+            peer_rib->RibOutJoin(root, db_entry, table, request->action_mask,
+                                 &resync_list);
+        }
+    }
+
+    for (IPeerRib::RibOutPeerSetList::const_iterator it = resync_list.begin();
+         it != resync_list.end(); ++it) {
+        it->first->bgp_export()->Leave(root, it->second, db_entry);
+        it->first->bgp_export()->Join(root, it->second, db_entry);
+    }
+
+    return true;
+}
+
+//
+// Concurrency: Runs in the context of the DB partition task.
+//
+// Process the table walk done notification for the walk started from the
+// Resync method.
+//
+void PeerRibMembershipManager::ResyncDone(DBTableBase *db,
+                                          MembershipRequestList *request_list) {
+    BgpTable *table = static_cast<BgpTable *>(db);
+
     IPeerRibEvent *event =
         new IPeerRibEvent(IPeerRibEvent::REGISTER_RIB_COMPLETE, NULL, table,
                           request_list);
@@ -459,8 +648,10 @@ void PeerRibMembershipManager::JoinDone(DBTableBase *db,
 // Concurrency: Runs in the context of the BGP peer membership task.
 //
 // Kick off the process to unregister the IPeer from the BgpTable. We first
-// need to do a table walk and clean up state for all routes from the IPeer.
-// We can actually unregister only after the state has been cleaned up.
+// need to do a table walk and clean up RibOut state for all routes for the
+// IPeer. RibIn of the IPeer is then cleaned up from the paths of the IPeer
+// in each table partition. We can actually unregister only after the state
+// has been cleaned up.
 //
 // In the meantime, we deactivate the IPeer in the RibOut to ensure that it
 // does not export any more routes.
@@ -468,6 +659,7 @@ void PeerRibMembershipManager::JoinDone(DBTableBase *db,
 void PeerRibMembershipManager::Leave(BgpTable *table,
                               MembershipRequestList *request_list) {
     DB *db = table->database();
+    bool ribout_delete = false;
 
     for (MembershipRequestList::iterator iter = request_list->begin();
              iter != request_list->end(); iter++) {
@@ -480,18 +672,31 @@ void PeerRibMembershipManager::Leave(BgpTable *table,
         IPeerRib *peer_rib = IPeerRibFind(request->ipeer, table);
 
         if (peer_rib) {
+            ribout_delete = true;
+
             // Ignore peer ribs which are already in close process
             if (peer_rib->IsRibOutActive()) peer_rib->DeactivateRibOut();
+
+            if (request->action_mask & MembershipRequest::RIBOUT_SNAPSHOT) {
+                request->snapshot.reset(
+                    new RibOutWalkDigest(table->PartitionCount()));
+            }
         }
     }
 
+    // RibIn only requests e.g. sweep of stale paths don't need a walk.
+    if (!ribout_delete) {
+        LeaveRibIn(table, request_list);
+        return;
+    }
+
     DBTableWalker *walker = db->GetWalker();
     walker->WalkTable(table, NULL,
         // _1: DBTablePartBase, _2: DBEntry
         boost::bind(&PeerRibMembershipManager::RouteLeave, this, _1, _2, table,
                     request_list),
         // _1: DBTableBase
-        boost::bind(&PeerRibMembershipManager::LeaveDone, this, _1,
+        boost::bind(&PeerRibMembershipManager::LeaveRibIn, this, _1,
                     request_list));
 }
 
@@ -499,12 +704,14 @@ void PeerRibMembershipManager::Leave(BgpTable *table,
 // Concurrency: Runs in the context of the db walker task triggered from
 // BGP peer membership task.
 //
-// Leave the route from RibIn and from RibOut
+// Leave the route from RibOut
 //
 bool PeerRibMembershipManager::RouteLeave(DBTablePartBase *root,
                                           DBEntryBase *db_entry,
                                           BgpTable *table,
                                           MembershipRequestList *request_list) {
+    IPeerRib::RibOutPeerSetList leave_list;
+    IPeerRib::RibOutPeerSetList snapshot_list;
     for (MembershipRequestList::iterator iter = request_list->begin();
              iter != request_list->end(); iter++) {
         MembershipRequest *request = iter.operator->();
@@ -513,12 +720,206 @@ bool PeerRibMembershipManager::RouteLeave(DBTablePartBase *root,
         if (peer_rib == NULL) {
             continue;
         }
-        peer_rib->RibOutLeave(root, db_entry, table, request->action_mask);
-        peer_rib->RibInLeave(root, db_entry, table, request->action_mask);
+        peer_rib->RibOutLeave(root, db_entry, table, request->action_mask,
+                              &leave_list);
+        if (request->snapshot) {
+            peer_rib->RibOutLeave(root, db_entry, table, request->action_mask,
+                                  &snapshot_list);
+        }
+    }
+
+    // The snapshot must be taken before the advertised state is cleaned up.
+    if (!snapshot_list.empty()) {
+        RouteSnapshot(root, db_entry, table, request_list, snapshot_list);
+    }
+
+    for (IPeerRib::RibOutPeerSetList::const_iterator it = leave_list.begin();
+         it != leave_list.end(); ++it) {
+        it->first->bgp_export()->Leave(root, it->second, db_entry);
     }
     return true;
 }
 
+//
+// Concurrency: Runs in the context of the db walker task triggered from
+// BGP peer membership task.
+//
+// Add the attributes advertised for the route to each peer that is leaving
+// with a RIBOUT_SNAPSHOT request to the digest of the peer.
+//
+void PeerRibMembershipManager::RouteSnapshot(DBTablePartBase *root,
+        DBEntryBase *db_entry, BgpTable *table,
+        MembershipRequestList *request_list,
+        const IPeerRib::RibOutPeerSetList &snapshot_list) {
+    BgpRoute *route = static_cast<BgpRoute *>(db_entry);
+    int bucket = -1;
+    for (IPeerRib::RibOutPeerSetList::const_iterator it =
+         snapshot_list.begin(); it != snapshot_list.end(); ++it) {
+        RibOut *ribout = it->first;
+        AdvertiseSList adv_slist;
+        ribout->updates()->monitor()->GetPeerSetAdvertised(db_entry,
+            it->second, &adv_slist);
+        if (adv_slist->empty())
+            continue;
+        if (bucket < 0)
+            bucket = RibOutDigest::RouteBucket(route);
+
+        for (MembershipRequestList::iterator iter = request_list->begin();
+             iter != request_list->end(); iter++) {
+            MembershipRequest *request = iter.operator->();
+            if (!request->snapshot)
+                continue;
+            IPeerRib *peer_rib = IPeerRibFind(request->ipeer, table);
+            if (!peer_rib || peer_rib->ribout() != ribout)
+                continue;
+
+            int index = ribout->GetPeerIndex(request->ipeer);
+            for (AdvertiseSList::List::const_iterator ainfo_it =
+                 adv_slist->begin(); ainfo_it != adv_slist->end();
+                 ++ainfo_it) {
+                if (ainfo_it->bitset.test(index)) {
+                    request->snapshot->Add(root->index(), bucket,
+                        RibOutDigest::RouteHash(route, ainfo_it->roattr));
+                    break;
+                }
+            }
+        }
+    }
+}
+
+//
+// Task that closes RibIn of the peers in a request list in a table partition.
+// Only the paths of the peers are visited, using the paths list kept by the
+// BgpTable for each peer in the partition. Runs in the db::DBTable task for
+// the partition, the same as the walker does, and yields after every
+// kMaxIterations paths.
+//
+// The paths of a peer are moved to a local list before they are processed,
+// so that paths added for the peer in the meantime e.g. when a path is
+// staled are not visited again.
+//
+class PeerRibMembershipManager::RibInWorker : public Task {
+public:
+    RibInWorker(PeerRibMembershipManager *manager, BgpTable *table,
+                int part_id, MembershipRequestList *request_list,
+                tbb::atomic<int> *pending)
+        : Task(TaskScheduler::GetInstance()->GetTaskId("db::DBTable"),
+               part_id),
+          manager_(manager),
+          table_(table),
+          root_(table->GetTablePartition(part_id)),
+          request_list_(request_list),
+          pending_(pending),
+          index_(0),
+          request_(NULL),
+          peer_rib_(NULL) {
+    }
+
+    virtual bool Run() {
+        CHECK_CONCURRENCY("db::DBTable");
+
+        for (int count = 0; ; ) {
+            if (path_list_.empty()) {
+                if (request_)
+                    table_->PeerPathListPurge(root_, request_->ipeer);
+                if (!NextRequest())
+                    break;
+                table_->PeerPathListTake(root_, request_->ipeer, &path_list_);
+                continue;
+            }
+
+            if (count++ == DBTablePartBase::kMaxIterations)
+                return false;
+
+            // Link the path back with the paths of the peer before it's
+            // processed, it unlinks itself if it gets deleted.
+            BgpPath *path = &path_list_.front();
+            path_list_.pop_front();
+            table_->PeerPathLink(root_, request_->ipeer, path->GetRoute(),
+                                 path);
+            peer_rib_->RibInLeave(root_, path, request_->action_mask);
+        }
+
+        // Last of the workers for the table notifies completion.
+        if (pending_->fetch_and_decrement() == 1) {
+            delete pending_;
+            manager_->LeaveDone(table_, request_list_);
+        }
+        return true;
+    }
+
+private:
+    // Move on to the next request that has a RibIn action for a peer that
+    // is registered to the table.
+    bool NextRequest() {
+        request_ = NULL;
+        peer_rib_ = NULL;
+        while (index_ < request_list_->size()) {
+            MembershipRequest *request = &request_list_->at(index_++);
+            if (!(request->action_mask & (MembershipRequest::RIBIN_STALE |
+                                          MembershipRequest::RIBIN_SWEEP |
+                                          MembershipRequest::RIBIN_DELETE))) {
+                continue;
+            }
+            IPeerRib *peer_rib = manager_->IPeerRibFind(request->ipeer, table_);
+            if (!peer_rib || !peer_rib->IsRibInRegistered())
+                continue;
+            request_ = request;
+            peer_rib_ = peer_rib;
+            return true;
+        }
+        return false;
+    }
+
+    PeerRibMembershipManager *manager_;
+    BgpTable *table_;
+    DBTablePartBase *root_;
+    MembershipRequestList *request_list_;
+    tbb::atomic<int> *pending_;
+    size_t index_;
+    MembershipRequest *request_;
+    IPeerRib *peer_rib_;
+    BgpTable::PeerPathList path_list_;
+
+    DISALLOW_COPY_AND_ASSIGN(RibInWorker);
+};
+
+//
+// Concurrency: Runs in the context of the BGP peer membership task or the
+// DB partition task that completed the RibOut walk.
+//
+// Start RibIn close for the peers in the request list in all the partitions
+// of the table.
+//
+void PeerRibMembershipManager::LeaveRibIn(DBTableBase *db,
+                                          MembershipRequestList *request_list) {
+    BgpTable *table = static_cast<BgpTable *>(db);
+
+    bool ribin_leave = false;
+    for (MembershipRequestList::iterator iter = request_list->begin();
+             iter != request_list->end(); iter++) {
+        if (iter->action_mask & (MembershipRequest::RIBIN_STALE |
+                                 MembershipRequest::RIBIN_SWEEP |
+                                 MembershipRequest::RIBIN_DELETE)) {
+            ribin_leave = true;
+            break;
+        }
+    }
+    if (!ribin_leave) {
+        LeaveDone(table, request_list);
+        return;
+    }
+
+    int count = table->PartitionCount();
+    tbb::atomic<int> *pending = new tbb::atomic<int>();
+    *pending = count;
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    for (int part_id = 0; part_id < count; ++part_id) {
+        scheduler->Enqueue(
+            new RibInWorker(this, table, part_id, request_list, pending));
+    }
+}
+
 void PeerRibMembershipManager::MembershipRequestListDebug(
     const char *function, int line, BgpTable *table,
     MembershipRequestList *request_list) {
@@ -536,10 +937,9 @@ void PeerRibMembershipManager::MembershipRequestListDebug(
 //
 // Concurrency: Runs in the context of the DB partition task.
 //
-// Process the table walk done notification from the DB infrastructure.  This
-// walk was started from the Leave method. Since the table walk is complete,
-// we can post an IPeerRib UNREGISTER_RIB event for the BGP peer membership
-// task.
+// Process the completion of RibIn and RibOut close started from the Leave
+// method. Since the table has been cleaned up, we can post an IPeerRib
+// UNREGISTER_RIB_COMPLETE event for the BGP peer membership task.
 //
 void PeerRibMembershipManager::LeaveDone(DBTableBase *db,
                                          MembershipRequestList *request_list) {
@@ -613,7 +1013,8 @@ IPeerRibEvent *PeerRibMembershipManager::ProcessRequest(
 //
 void PeerRibMembershipManager::Register(
         IPeer *ipeer, BgpTable *table, const RibExportPolicy &policy,
-        int instance_id, NotifyCompletionFn notify_completion_fn) {
+        int instance_id, NotifyCompletionFn notify_completion_fn,
+        RibOutResyncPtr resync) {
     MembershipRequest request;
 
     request.ipeer = ipeer;
@@ -622,6 +1023,7 @@ void PeerRibMembershipManager::Register(
     request.instance_id = instance_id;
     request.policy = policy;
     request.notify_completion_fn = notify_completion_fn;
+    request.resync = resync;
     current_jobs_count_++;
     total_jobs_count_++;
 
@@ -804,6 +1206,48 @@ void PeerRibMembershipManager::FillRoutingInstanceTableInfo(
         srit->set_peers(peers);
 }
 
+//
+// Concurrency: Runs in the context of the BGP peer membership task.
+//
+// Get the snapshot of the routes advertised to a peer that is down.
+//
+bool PeerRibMembershipManager::GetRibOutSnapshot(const std::string &peer_name,
+                                                 const std::string &table_name,
+                                                 RibOutDigest *digest) const {
+    RibOutSnapshotMap::const_iterator loc =
+        snapshot_map_.find(std::make_pair(peer_name, table_name));
+    if (loc == snapshot_map_.end() ||
+        IsRibOutSnapshotExpired(loc->second, UTCTimestampUsec()))
+        return false;
+    *digest = loc->second.digest;
+    return true;
+}
+
+bool PeerRibMembershipManager::IsRibOutSnapshotExpired(
+        const RibOutSnapshot &snapshot, uint64_t now) const {
+    return (now - snapshot.timestamp >=
+            static_cast<uint64_t>(snapshot_expiry_secs_) * 1000000);
+}
+
+//
+// Concurrency: Runs in the context of the BGP peer membership task.
+//
+// Purge the snapshots of peers that have not come back in time. The timer
+// is restarted as long as there are snapshots left.
+//
+bool PeerRibMembershipManager::RibOutSnapshotTimerExpired() {
+    CHECK_CONCURRENCY("bgp::PeerMembership");
+
+    uint64_t now = UTCTimestampUsec();
+    for (RibOutSnapshotMap::iterator it = snapshot_map_.begin(), next = it;
+         it != snapshot_map_.end(); it = next) {
+        ++next;
+        if (IsRibOutSnapshotExpired(it->second, now))
+            snapshot_map_.erase(it);
+    }
+    return !snapshot_map_.empty();
+}
+
 //
 // Find the IPeerRib corresponding to the given IPeer and BgpTable.
 //
@@ -993,6 +1437,22 @@ void PeerRibMembershipManager::ProcessRegisterRibEvent(BgpTable *table,
         //
         if (request->action_mask & MembershipRequest::RIBOUT_ADD) {
             peer_rib->RegisterRibOut(request->policy);
+
+            //
+            // The snapshot of the previous session of the peer is used at
+            // most once, by the first join after the peer comes back.
+            //
+            peer_rib->set_ribout_resync(request->resync.get() != NULL);
+            RibOutSnapshotMap::iterator loc = snapshot_map_.find(
+                std::make_pair(request->ipeer->ToString(), table->name()));
+            if (loc != snapshot_map_.end()) {
+                if (request->resync &&
+                    !IsRibOutSnapshotExpired(loc->second, UTCTimestampUsec())) {
+                    request->resync->SetSnapshot(loc->second.digest,
+                                                 table->PartitionCount());
+                }
+                snapshot_map_.erase(loc);
+            }
         }
 
         //
@@ -1025,6 +1485,17 @@ void PeerRibMembershipManager::ProcessRegisterRibCompleteEvent(
     delete event->request_list;
 }
 
+//
+// Concurrency: Runs in the context of the BGP peer membership task.
+//
+// The join walk for a set of peers is done, and some of the peers that were
+// resynced have buckets that are not in sync. Start the walk to send them.
+//
+void PeerRibMembershipManager::ProcessRegisterRibResyncEvent(
+    IPeerRibEvent *event) {
+    Resync(event->table, event->request_list);
+}
+
 //
 // Concurrency: Runs in the context of the BGP peer membership task.
 //
@@ -1076,6 +1547,29 @@ void PeerRibMembershipManager::ProcessUnregisterRibCompleteEvent(
         MembershipRequest *request = iter.operator->();
         IPeerRib *peer_rib = IPeerRibFind(request->ipeer, event->table);
 
+        // Keep the snapshot of the routes advertised to the peer until it
+        // comes back, and drop the snapshot of an earlier session if the
+        // peer leaves without one.
+        if (request->action_mask & MembershipRequest::RIBOUT_DELETE) {
+            std::pair<std::string, std::string> key =
+                std::make_pair(request->ipeer->ToString(),
+                               event->table->name());
+            if (request->snapshot &&
+                (snapshot_map_.size() < kMaxRibOutSnapshots ||
+                 snapshot_map_.count(key))) {
+                RibOutSnapshot &snapshot = snapshot_map_[key];
+                snapshot.digest = request->snapshot->Merge();
+                snapshot.timestamp = UTCTimestampUsec();
+                snapshot_timer_->Start(snapshot_expiry_secs_ * 1000,
+                    boost::bind(
+                        &PeerRibMembershipManager::RibOutSnapshotTimerExpired,
+                        this));
+            } else {
+                snapshot_map_.erase(key);
+            }
+            request->snapshot.reset();
+        }
+
         if (peer_rib) {
             // If there was unregister for RibOut, do some final cleanup
             // necessary
@@ -1128,6 +1622,10 @@ void PeerRibMembershipManager::IPeerRibEventCallbackUnlocked(
         ProcessRegisterRibEvent(event->table, request_list);
         break;
 
+    case IPeerRibEvent::REGISTER_RIB_RESYNC:
+        ProcessRegisterRibResyncEvent(event);
+        break;
+
     case IPeerRibEvent::REGISTER_RIB_COMPLETE:
         ProcessRegisterRibCompleteEvent(event);
 
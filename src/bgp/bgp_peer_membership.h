@@ -8,6 +8,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/lifetime.h"
@@ -15,14 +16,17 @@
 #include "base/queue_task.h"
 #include "db/db_table_walker.h"
 #include "bgp/bgp_ribout.h"
+#include "bgp/bgp_ribout_digest.h"
 #include "bgp/bgp_table.h"
 
 class IPeer;
+class BgpPath;
 class BgpServer;
 class DBTableBase;
 class PeerRibMembershipManager;
 class RibOut;
 class ShowRoutingInstanceTable;
+class Timer;
 class BgpNeighborResp;
 
 struct MembershipRequest {
@@ -37,6 +41,7 @@ public:
         RIBIN_SWEEP   = 1 << 3,
         RIBOUT_ADD    = 1 << 4,
         RIBOUT_DELETE = 1 << 5,
+        RIBOUT_SNAPSHOT = 1 << 6,
     };
 
     MembershipRequest();
@@ -52,6 +57,14 @@ public:
 
     typedef boost::function<int(IPeerRib *)> ActionGetFn;
     ActionGetFn         action_get_fn;
+
+    // Resync state of a RIBOUT_ADD request from a peer that reported the
+    // digest of the routes it kept from its previous session.
+    RibOutResyncPtr     resync;
+
+    // Digest of the routes advertised to the peer, built by the walk of a
+    // RIBOUT_SNAPSHOT request.
+    boost::shared_ptr<RibOutWalkDigest> snapshot;
 };
 
 typedef std::vector<MembershipRequest> MembershipRequestList;
@@ -67,6 +80,7 @@ struct IPeerRibEvent {
     enum EventType {
         REGISTER_RIB,
         REGISTER_RIB_COMPLETE,
+        REGISTER_RIB_RESYNC,
         UNREGISTER_RIB,
         UNREGISTER_RIB_COMPLETE,
         UNREGISTER_PEER,
@@ -109,6 +123,9 @@ private:
 //
 class IPeerRib {
 public:
+    // RibOuts and the peers in each of them that join or leave a route.
+    typedef std::vector<std::pair<RibOut *, RibPeerSet> > RibOutPeerSetList;
+
     IPeerRib(IPeer *ipeer, BgpTable *table,
              PeerRibMembershipManager *membership_mgr);
     ~IPeerRib();
@@ -117,6 +134,7 @@ public:
 
     IPeer *ipeer() { return ipeer_; }
     BgpTable *table() { return table_; }
+    RibOut *ribout() { return ribout_; }
 
     void SetStale() { stale_ = true; }
     void ResetStale() { stale_ = false; }
@@ -128,8 +146,8 @@ public:
     void SetRibInRegistered(bool set);
     void RibInJoin(DBTablePartBase *root, DBEntryBase *db_entry,
                    BgpTable *table, MembershipRequest::Action action_mask);
-    void RibInLeave(DBTablePartBase *root, DBEntryBase *db_entry,
-                    BgpTable *table, MembershipRequest::Action action_mask);
+    void RibInLeave(DBTablePartBase *root, BgpPath *path,
+                    MembershipRequest::Action action_mask);
 
     void RegisterRibOut(RibExportPolicy policy);
     void UnregisterRibOut();
@@ -139,16 +157,26 @@ public:
     void SetRibOutRegistered(bool set);
 
     void RibOutJoin(DBTablePartBase *root, DBEntryBase *db_entry,
-                    BgpTable *table, MembershipRequest::Action action_mask);
+                    BgpTable *table, MembershipRequest::Action action_mask,
+                    RibOutPeerSetList *join_list);
     void RibOutLeave(DBTablePartBase *root, DBEntryBase *db_entry,
-                     BgpTable *table, MembershipRequest::Action action_mask);
+                     BgpTable *table, MembershipRequest::Action action_mask,
+                     RibOutPeerSetList *leave_list);
 
     void ManagedDelete();
 
     int instance_id() const { return instance_id_; }
     void set_instance_id(int instance_id) { instance_id_ = instance_id; }
 
+    // Set if the peer reported an adj-rib-out digest when it registered.
+    bool ribout_resync() const { return ribout_resync_; }
+    void set_ribout_resync(bool ribout_resync) {
+        ribout_resync_ = ribout_resync;
+    }
+
 private:
+    void AddRibOutPeer(RibOutPeerSetList *list);
+
     IPeer *ipeer_;
     BgpTable *table_;
     PeerRibMembershipManager *membership_mgr_;
@@ -157,6 +185,7 @@ private:
     bool ribin_registered_;
     bool ribout_registered_;
     bool stale_;
+    bool ribout_resync_;
     int instance_id_;       // xmpp peer instance-id
     DISALLOW_COPY_AND_ASSIGN(IPeerRib);
 };
@@ -212,7 +241,8 @@ public:
 
     virtual void Register(IPeer *ipeer, BgpTable *table,
                   const RibExportPolicy &policy, int instance_id,
-                  NotifyCompletionFn notify_completion_fn = NULL);
+                  NotifyCompletionFn notify_completion_fn = NULL,
+                  RibOutResyncPtr resync = RibOutResyncPtr());
     void RegisterRibIn(IPeer *ipeer, BgpTable *table);
     virtual void Unregister(IPeer *ipeer, BgpTable *table,
                     NotifyCompletionFn notify_completion_fn = NULL);
@@ -243,25 +273,67 @@ public:
     int current_jobs_count() const { return current_jobs_count_; }
     int total_jobs_count() const { return total_jobs_count_; }
 
+    bool GetRibOutSnapshot(const std::string &peer_name,
+                           const std::string &table_name,
+                           RibOutDigest *digest) const;
+    size_t GetRibOutSnapshotCount() const { return snapshot_map_.size(); }
+
+    // Testing only
+    void set_ribout_snapshot_expiry(int expiry_secs) {
+        snapshot_expiry_secs_ = expiry_secs;
+    }
+
 private:
     friend class BgpServerUnitTest;
     friend class BgpXmppUnitTest;
     friend class PeerMembershipMgrTest;
     friend class PeerRibMembershipManagerTest;
 
+    class RibInWorker;
+
     typedef std::multimap<const BgpTable *, IPeer *> RibPeerMap;
     typedef std::multimap<const IPeer *, IPeerRib *> PeerRibMap;
 
+    // Digest of the routes advertised to a peer that is down and the time
+    // at which the peer went down.
+    struct RibOutSnapshot {
+        RibOutSnapshot() : timestamp(0) { }
+        RibOutDigest digest;
+        uint64_t timestamp;
+    };
+    typedef std::map<std::pair<std::string, std::string>, RibOutSnapshot>
+        RibOutSnapshotMap;
+
+    // Limit on the number of snapshots kept for peers that are down.
+    static const size_t kMaxRibOutSnapshots = 64 * 1024;
+
+    // Time for which the snapshot of a peer that is down is kept. This is
+    // twice the default graceful restart time.
+    static const int kDefaultRibOutSnapshotExpiry = 120;
+
     void NotifyPeerRegistration(IPeer *ipeer, BgpTable *table, bool unregister);
 
     void Join(BgpTable *table, MembershipRequestList *request_list);
     bool RouteJoin(DBTablePartBase *root, DBEntryBase *db_entry,
                    BgpTable *table, MembershipRequestList *request_list);
+    void RouteJoinResync(DBTablePartBase *root, DBEntryBase *db_entry,
+                         BgpTable *table, MembershipRequestList *request_list,
+                         int bucket,
+                         const IPeerRib::RibOutPeerSetList &resync_list);
     void JoinDone(DBTableBase *db, MembershipRequestList *request_list);
 
+    void Resync(BgpTable *table, MembershipRequestList *request_list);
+    bool RouteResync(DBTablePartBase *root, DBEntryBase *db_entry,
+                     BgpTable *table, MembershipRequestList *request_list);
+    void ResyncDone(DBTableBase *db, MembershipRequestList *request_list);
+
     void Leave(BgpTable *table, MembershipRequestList *request_list);
     bool RouteLeave(DBTablePartBase *root, DBEntryBase *db_entry,
                     BgpTable *table, MembershipRequestList *request_list);
+    void RouteSnapshot(DBTablePartBase *root, DBEntryBase *db_entry,
+                       BgpTable *table, MembershipRequestList *request_list,
+                       const IPeerRib::RibOutPeerSetList &snapshot_list);
+    void LeaveRibIn(DBTableBase *db, MembershipRequestList *request_list);
     void LeaveDone(DBTableBase *db, MembershipRequestList *request_list);
 
     IPeerRibEvent *ProcessRequest(IPeerRibEvent::EventType event_type,
@@ -275,10 +347,15 @@ private:
     void ProcessRegisterRibEvent(BgpTable *table,
                                  MembershipRequestList *request_list);
     void ProcessRegisterRibCompleteEvent(IPeerRibEvent *event);
+    void ProcessRegisterRibResyncEvent(IPeerRibEvent *event);
     void ProcessUnregisterRibEvent(BgpTable *table,
                                    MembershipRequestList *request_list);
     void ProcessUnregisterRibCompleteEvent(IPeerRibEvent *event);
 
+    bool IsRibOutSnapshotExpired(const RibOutSnapshot &snapshot,
+                                 uint64_t now) const;
+    bool RibOutSnapshotTimerExpired();
+
     IPeerRib *IPeerRibInsert(IPeer *ipeer, BgpTable *table);
     IPeerRib *IPeerRibLocate(IPeer *ipeer, BgpTable *table);
     void IPeerRibRemove(IPeerRib *peer_rib);
@@ -303,6 +380,14 @@ private:
 
     TableMembershipRequestMap register_request_map_;
     TableMembershipRequestMap unregister_request_map_;
+
+    // Digests of the routes that were advertised to XMPP peers that are
+    // down, by peer name and table name. Only accessed from the BGP peer
+    // membership task. Snapshots are purged by the snapshot timer once
+    // they expire.
+    RibOutSnapshotMap snapshot_map_;
+    Timer *snapshot_timer_;
+    int snapshot_expiry_secs_;
     tbb::mutex mutex_;
 
     boost::dynamic_bitset<> registration_bmap_;
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "bgp/bgp_ribout_digest.h"
+
+#include <stdlib.h>
+
+#include <sstream>
+
+#include "bgp/bgp_attr.h"
+#include "bgp/bgp_ribout.h"
+#include "bgp/bgp_route.h"
+
+using std::string;
+using std::vector;
+
+const int RibOutDigest::kBucketCount;
+
+static const uint64_t kFnvOffset = 0xcbf29ce484222325ULL;
+static const uint64_t kFnvPrime = 0x100000001b3ULL;
+
+//
+// FNV-1a, which gives the same value on the control node and the agent
+// regardless of the platform.
+//
+static uint64_t HashBytes(uint64_t hash, const void *data, size_t size) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for (size_t idx = 0; idx < size; ++idx) {
+        hash ^= bytes[idx];
+        hash *= kFnvPrime;
+    }
+    return hash;
+}
+
+static uint64_t HashString(uint64_t hash, const string &str) {
+    // Include the terminating nul so that adjacent strings can't run into
+    // each other.
+    return HashBytes(hash, str.c_str(), str.size() + 1);
+}
+
+static uint64_t HashUint32(uint64_t hash, uint32_t value) {
+    uint8_t bytes[4];
+    bytes[0] = value >> 24;
+    bytes[1] = value >> 16;
+    bytes[2] = value >> 8;
+    bytes[3] = value;
+    return HashBytes(hash, bytes, sizeof(bytes));
+}
+
+RibOutDigest::RibOutDigest() {
+    for (int idx = 0; idx < kBucketCount; ++idx) {
+        buckets_[idx] = 0;
+    }
+}
+
+int RibOutDigest::RouteBucket(const BgpRoute *route) {
+    uint64_t hash = HashString(kFnvOffset, route->ToString());
+    return ((hash >> 32) ^ hash) % kBucketCount;
+}
+
+//
+// Hash the prefix and the advertised attributes that are sent to XMPP peers:
+// local preference, med, the next hops with their labels and encapsulations,
+// and the extended communities that carry the security groups, the sequence
+// number, the virtual network and the load balance attributes.
+//
+// An unreachable route is not advertised and does not contribute to the
+// digest.
+//
+uint64_t RibOutDigest::RouteHash(const BgpRoute *route,
+                                 const RibOutAttr &roattr) {
+    if (!roattr.IsReachable())
+        return 0;
+
+    const BgpAttr *attr = roattr.attr();
+    uint64_t hash = HashString(kFnvOffset, route->ToString());
+    hash = HashUint32(hash, attr->local_pref());
+    hash = HashUint32(hash, attr->med());
+    for (RibOutAttr::NextHopList::const_iterator it =
+         roattr.nexthop_list().begin(); it != roattr.nexthop_list().end();
+         ++it) {
+        hash = HashString(hash, it->address().to_string());
+        hash = HashUint32(hash, it->label());
+        vector<string> encap = it->encap();
+        for (vector<string>::const_iterator encap_it = encap.begin();
+             encap_it != encap.end(); ++encap_it) {
+            hash = HashString(hash, *encap_it);
+        }
+    }
+
+    const ExtCommunity *ext_community = attr->ext_community();
+    if (ext_community) {
+        for (ExtCommunity::ExtCommunityList::const_iterator it =
+             ext_community->communities().begin();
+             it != ext_community->communities().end(); ++it) {
+            if (ExtCommunity::is_security_group(*it) ||
+                ExtCommunity::is_mac_mobility(*it) ||
+                ExtCommunity::is_origin_vn(*it) ||
+                ExtCommunity::is_load_balance(*it)) {
+                hash = HashBytes(hash, it->data(), it->size());
+            }
+        }
+    }
+    return hash;
+}
+
+void RibOutDigest::Add(const BgpRoute *route, const RibOutAttr &roattr) {
+    if (!roattr.IsReachable())
+        return;
+    Add(RouteBucket(route), RouteHash(route, roattr));
+}
+
+void RibOutDigest::Merge(const RibOutDigest &rhs) {
+    for (int idx = 0; idx < kBucketCount; ++idx) {
+        buckets_[idx] += rhs.buckets_[idx];
+    }
+}
+
+bool RibOutDigest::operator==(const RibOutDigest &rhs) const {
+    for (int idx = 0; idx < kBucketCount; ++idx) {
+        if (buckets_[idx] != rhs.buckets_[idx])
+            return false;
+    }
+    return true;
+}
+
+string RibOutDigest::ToString() const {
+    std::ostringstream out;
+    out << std::hex;
+    for (int idx = 0; idx < kBucketCount; ++idx) {
+        if (idx)
+            out << ",";
+        out << buckets_[idx];
+    }
+    return out.str();
+}
+
+//
+// Parse the digest sent by a peer. Returns false, leaving the digest
+// unchanged, unless there is a valid hex value for each bucket.
+//
+bool RibOutDigest::FromString(const string &str) {
+    uint64_t buckets[kBucketCount];
+    const char *start = str.c_str();
+    for (int idx = 0; idx < kBucketCount; ++idx) {
+        char *end;
+        buckets[idx] = strtoull(start, &end, 16);
+        if (end == start)
+            return false;
+        if (idx == kBucketCount - 1) {
+            if (*end != '\0')
+                return false;
+        } else if (*end != ',') {
+            return false;
+        }
+        start = end + 1;
+    }
+    for (int idx = 0; idx < kBucketCount; ++idx) {
+        buckets_[idx] = buckets[idx];
+    }
+    return true;
+}
+
+RibOutDigest RibOutWalkDigest::Merge() const {
+    RibOutDigest digest;
+    for (vector<RibOutDigest>::const_iterator it = part_digests_.begin();
+         it != part_digests_.end(); ++it) {
+        digest.Merge(*it);
+    }
+    return digest;
+}
+
+RibOutResync::RibOutResync(const RibOutDigest &peer_digest)
+    : peer_digest_(peer_digest), candidate_mask_(0), dirty_mask_(0) {
+}
+
+void RibOutResync::SetSnapshot(const RibOutDigest &snapshot, int part_count) {
+    candidate_mask_ = 0;
+    dirty_mask_ = 0;
+    for (int idx = 0; idx < RibOutDigest::kBucketCount; ++idx) {
+        if (snapshot.bucket(idx) == peer_digest_.bucket(idx))
+            candidate_mask_ |= 1ULL << idx;
+    }
+    current_.reset(new RibOutWalkDigest(part_count));
+}
+
+void RibOutResync::Add(int part_id, int bucket, uint64_t hash) {
+    current_->Add(part_id, bucket, hash);
+}
+
+bool RibOutResync::WalkDone() {
+    if (!current_)
+        return false;
+    RibOutDigest current = current_->Merge();
+    for (int idx = 0; idx < RibOutDigest::kBucketCount; ++idx) {
+        if (IsCandidate(idx) && current.bucket(idx) != peer_digest_.bucket(idx))
+            dirty_mask_ |= 1ULL << idx;
+    }
+    current_.reset();
+    return dirty_mask_ != 0;
+}
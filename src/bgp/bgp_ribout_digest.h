@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef SRC_BGP_BGP_RIBOUT_DIGEST_H_
+#define SRC_BGP_BGP_RIBOUT_DIGEST_H_
+
+#include <stdint.h>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <string>
+#include <vector>
+
+#include "base/util.h"
+
+class BgpRoute;
+class RibOutAttr;
+
+//
+// This class represents a digest of the routes advertised to a peer in a
+// table. The routes are spread over kBucketCount buckets by a hash of the
+// prefix, and the digest of a bucket is the sum of the hashes of the prefix
+// and advertised attributes of each route in it. The sum does not depend on
+// the order in which routes are added, so a digest can be built by a walk
+// of the table partitions in parallel.
+//
+// The digest is exchanged with XMPP peers as a string with the hex value
+// of each bucket, separated by commas.
+//
+class RibOutDigest {
+public:
+    static const int kBucketCount = 64;
+
+    RibOutDigest();
+
+    static int RouteBucket(const BgpRoute *route);
+    static uint64_t RouteHash(const BgpRoute *route, const RibOutAttr &roattr);
+
+    void Add(int bucket, uint64_t hash) { buckets_[bucket] += hash; }
+    void Add(const BgpRoute *route, const RibOutAttr &roattr);
+    void Merge(const RibOutDigest &rhs);
+    uint64_t bucket(int index) const { return buckets_[index]; }
+
+    bool operator==(const RibOutDigest &rhs) const;
+    bool operator!=(const RibOutDigest &rhs) const { return !(*this == rhs); }
+
+    std::string ToString() const;
+    bool FromString(const std::string &str);
+
+private:
+    uint64_t buckets_[kBucketCount];
+};
+
+//
+// This class builds a RibOutDigest with a table walk. Each partition adds
+// to its own digest and the digests are merged when the walk is done.
+//
+class RibOutWalkDigest {
+public:
+    explicit RibOutWalkDigest(int part_count) : part_digests_(part_count) { }
+
+    void Add(int part_id, int bucket, uint64_t hash) {
+        part_digests_[part_id].Add(bucket, hash);
+    }
+    RibOutDigest Merge() const;
+
+private:
+    std::vector<RibOutDigest> part_digests_;
+    DISALLOW_COPY_AND_ASSIGN(RibOutWalkDigest);
+};
+
+//
+// This class keeps the state to resync the routes advertised to an XMPP
+// peer in a table, when the peer subscribes again with the digest of the
+// routes it kept from its previous session.
+//
+// Buckets where the digest of the peer matches the snapshot of what was
+// advertised to the peer when its previous session went down are candidates.
+// The routes of candidate buckets are not sent to the peer by the join walk,
+// but marked as advertised and added to the digest of the current routes.
+// When the walk is done, a candidate bucket where the current digest differs
+// from the digest of the peer is dirty, and its routes are sent again by a
+// second walk. The other candidate buckets are in sync, the peer keeps the
+// routes it has for them. The routes of the remaining buckets are sent as
+// for any other join.
+//
+class RibOutResync {
+public:
+    explicit RibOutResync(const RibOutDigest &peer_digest);
+
+    const RibOutDigest &peer_digest() const { return peer_digest_; }
+
+    // Called before the join walk, with the snapshot of the routes
+    // advertised to the peer in its previous session.
+    void SetSnapshot(const RibOutDigest &snapshot, int part_count);
+
+    bool IsCandidate(int bucket) const {
+        return (candidate_mask_ & (1ULL << bucket)) != 0;
+    }
+    bool IsDirty(int bucket) const {
+        return (dirty_mask_ & (1ULL << bucket)) != 0;
+    }
+    void Add(int part_id, int bucket, uint64_t hash);
+
+    // Called when the join walk is done. Returns true if there are dirty
+    // buckets.
+    bool WalkDone();
+
+    uint64_t candidate_mask() const { return candidate_mask_; }
+    uint64_t dirty_mask() const { return dirty_mask_; }
+    uint64_t sync_mask() const { return candidate_mask_ & ~dirty_mask_; }
+
+private:
+    RibOutDigest peer_digest_;
+    boost::scoped_ptr<RibOutWalkDigest> current_;
+    uint64_t candidate_mask_;
+    uint64_t dirty_mask_;
+    DISALLOW_COPY_AND_ASSIGN(RibOutResync);
+};
+
+typedef boost::shared_ptr<RibOutResync> RibOutResyncPtr;
+
+#endif  // SRC_BGP_BGP_RIBOUT_DIGEST_H_
@@ -563,6 +563,27 @@ bool RibOutUpdates::Empty() const {
     return true;
 }
 
+bool RibOutUpdates::PeerDrained(int index) const {
+    for (int i = 0; i < RibOutUpdates::QCOUNT; ++i) {
+        UpdateQueue *queue = queue_vec_[i];
+        if (!queue->PeerDrained(index)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void RibOutUpdates::AddLockStats(RibOutLockStats *stats) const {
+    for (int i = 0; i < RibOutUpdates::QCOUNT; ++i) {
+        const UpdateQueue *queue = queue_vec_[i];
+        stats->queue_lock_count += queue->lock_count();
+        stats->queue_lock_contended += queue->lock_contended();
+    }
+    stats->monitor_lock_count += monitor_->lock_count();
+    stats->monitor_lock_contended += monitor_->lock_contended();
+    stats->entry_wait_count += monitor_->entry_wait_count();
+}
+
 bool RibOutUpdates::QueueJoin(int queue_id, int bit) {
     UpdateQueue *queue = queue_vec_[queue_id];
     return queue->Join(bit);
@@ -19,6 +19,23 @@ class UpdateQueue;
 struct UpdateInfo;
 struct UpdateMarker;
 
+//
+// Lock statistics of the UpdateQueues and the RibUpdateMonitor of one or
+// more RibOuts. The counters are only kept when lock statistics are enabled.
+//
+struct RibOutLockStats {
+    RibOutLockStats()
+        : queue_lock_count(0), queue_lock_contended(0),
+          monitor_lock_count(0), monitor_lock_contended(0),
+          entry_wait_count(0) {
+    }
+    uint64_t queue_lock_count;
+    uint64_t queue_lock_contended;
+    uint64_t monitor_lock_count;
+    uint64_t monitor_lock_contended;
+    uint64_t entry_wait_count;
+};
+
 //
 // This class is a logical abstraction of the update processing state and
 // functionality that would have otherwise been part of RibOut itself. As
@@ -58,6 +75,12 @@ public:
 
     bool Empty() const;
 
+    // Return true if the peer has seen all the updates in all the queues.
+    bool PeerDrained(int index) const;
+
+    // Add the lock statistics of the queues and the monitor.
+    void AddLockStats(RibOutLockStats *stats) const;
+
     RibUpdateMonitor *monitor() { return monitor_.get(); }
 
     UpdateQueue *queue(int queue_id) {
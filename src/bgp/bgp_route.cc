@@ -6,6 +6,7 @@
 
 
 
+#include "base/slab_allocator.h"
 #include "bgp/bgp_table.h"
 #include "bgp/extended-community/default_gateway.h"
 #include "bgp/extended-community/es_import.h"
@@ -28,6 +29,28 @@ BgpRoute::~BgpRoute() {
     assert(GetPathList().empty());
 }
 
+//
+// Allocators for routes of all families. The allocators are never deleted
+// since routes may be deleted after static destructors have run.
+//
+static SlabAllocatorGroup *RouteAllocators() {
+    static SlabAllocatorGroup *allocators =
+        new SlabAllocatorGroup("BgpRoute", BgpRoute::kMaxSlabRouteSize);
+    return allocators;
+}
+
+void *BgpRoute::operator new(size_t size) {
+    return RouteAllocators()->Allocate(size);
+}
+
+void BgpRoute::operator delete(void *ptr, size_t size) {
+    RouteAllocators()->Free(ptr, size);
+}
+
+void BgpRoute::GetAllocators(vector<const SlabAllocator *> *list) {
+    RouteAllocators()->GetAllocators(list);
+}
+
 //
 // Return the best path for this route.
 //
@@ -37,15 +60,12 @@ const BgpPath *BgpRoute::BestPath() const {
 }
 
 //
-// Insert given path and redo path selection.
+// Insert given path at its position in the sorted path list.
 //
 void BgpRoute::InsertPath(BgpPath *path) {
     assert(!IsDeleted());
-    const Path *prev_front = front();
-
-    insert(path);
 
-    Sort(&BgpTable::PathSelection, prev_front);
+    InsertSorted(path, &BgpTable::PathSelection);
 
     // Update counters.
     BgpTable *table = static_cast<BgpTable *>(get_table());
@@ -54,13 +74,10 @@ void BgpRoute::InsertPath(BgpPath *path) {
 }
 
 //
-// Delete given path and redo path selection.
+// Delete given path. Rest of the path list remains sorted.
 //
 void BgpRoute::DeletePath(BgpPath *path) {
-    const Path *prev_front = front();
-
-    remove(path);
-    Sort(&BgpTable::PathSelection, prev_front);
+    RemoveSorted(path);
 
     // Update counters.
     BgpTable *table = static_cast<BgpTable *>(get_table());
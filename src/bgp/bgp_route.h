@@ -24,6 +24,13 @@ public:
     BgpRoute();
     ~BgpRoute();
 
+    // Routes are allocated from a SlabAllocator for each route size i.e.
+    // each family.
+    static const size_t kMaxSlabRouteSize = 512;
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
+    static void GetAllocators(std::vector<const SlabAllocator *> *list);
+
     const BgpPath *BestPath() const;
 
     void InsertPath(BgpPath *path);
@@ -8,12 +8,21 @@
 #include <boost/foreach.hpp>
 #include <sandesh/request_pipeline.h>
 
+#include "base/slab_allocator.h"
+#include "bgp/bgp_attr.h"
 #include "bgp/bgp_multicast.h"
 #include "bgp/bgp_peer_internal_types.h"
 #include "bgp/bgp_session_manager.h"
+#include "bgp/ermvpn/ermvpn_route.h"
 #include "bgp/ermvpn/ermvpn_table.h"
+#include "bgp/evpn/evpn_route.h"
+#include "bgp/inet/inet_route.h"
 #include "bgp/inet/inet_table.h"
+#include "bgp/inet6/inet6_route.h"
+#include "bgp/inet6vpn/inet6vpn_route.h"
+#include "bgp/l3vpn/inetvpn_route.h"
 #include "bgp/routing-instance/peer_manager.h"
+#include "bgp/rtarget/rtarget_route.h"
 
 using namespace boost::assign;
 using namespace std;
@@ -533,6 +542,153 @@ void ShowBgpServerReq::HandleRequest() const {
     RequestPipeline rp(ps);
 }
 
+class ShowBgpMemoryHandler {
+public:
+    static size_t RouteSize(Address::Family family) {
+        switch (family) {
+        case Address::INET:
+            return sizeof(InetRoute);
+        case Address::INET6:
+            return sizeof(Inet6Route);
+        case Address::INETVPN:
+            return sizeof(InetVpnRoute);
+        case Address::INET6VPN:
+            return sizeof(Inet6VpnRoute);
+        case Address::RTARGET:
+            return sizeof(RTargetRoute);
+        case Address::EVPN:
+            return sizeof(EvpnRoute);
+        case Address::ERMVPN:
+            return sizeof(ErmVpnRoute);
+        default:
+            return sizeof(BgpRoute);
+        }
+    }
+
+    static void FillFamilies(BgpServer *server,
+                             vector<BgpMemoryFamilyInfo> *list) {
+        typedef map<Address::Family, BgpMemoryFamilyInfo> FamilyMap;
+        FamilyMap family_map;
+        RoutingInstanceMgr *rim = server->routing_instance_mgr();
+        for (RoutingInstanceMgr::const_name_iterator it = rim->name_cbegin();
+             it != rim->name_cend(); ++it) {
+            const RoutingInstance *rtinstance = it->second;
+            const RoutingInstance::RouteTableList &tables =
+                rtinstance->GetTables();
+            for (RoutingInstance::RouteTableList::const_iterator tit =
+                 tables.begin(); tit != tables.end(); ++tit) {
+                const BgpTable *table = tit->second;
+                Address::Family family = table->family();
+                BgpMemoryFamilyInfo &info = family_map[family];
+                info.set_routes(info.get_routes() + table->Size());
+                info.set_primary_paths(info.get_primary_paths() +
+                                       table->GetPrimaryPathCount());
+                info.set_secondary_paths(info.get_secondary_paths() +
+                                         table->GetSecondaryPathCount());
+            }
+        }
+
+        for (FamilyMap::iterator it = family_map.begin();
+             it != family_map.end(); ++it) {
+            BgpMemoryFamilyInfo &info = it->second;
+            info.set_family(Address::FamilyToString(it->first));
+            info.set_route_bytes(info.get_routes() * RouteSize(it->first));
+            info.set_path_bytes(
+                info.get_primary_paths() * sizeof(BgpPath) +
+                info.get_secondary_paths() * sizeof(BgpSecondaryPath));
+            list->push_back(info);
+        }
+    }
+
+    static void AddAttribute(vector<BgpMemoryAttributeInfo> *list,
+                             const string &name, size_t count, size_t size) {
+        BgpMemoryAttributeInfo info;
+        info.set_name(name);
+        info.set_count(count);
+        info.set_bytes(count * size);
+        list->push_back(info);
+    }
+
+    static void FillAttributes(BgpServer *server,
+                               vector<BgpMemoryAttributeInfo> *list) {
+        AddAttribute(list, "BgpAttr", server->attr_db()->Size(),
+                     sizeof(BgpAttr));
+        AddAttribute(list, "AsPath", server->aspath_db()->Size(),
+                     sizeof(AsPath));
+        AddAttribute(list, "Community", server->comm_db()->Size(),
+                     sizeof(Community));
+        AddAttribute(list, "ExtCommunity", server->extcomm_db()->Size(),
+                     sizeof(ExtCommunity));
+        AddAttribute(list, "OriginVnPath", server->ovnpath_db()->Size(),
+                     sizeof(OriginVnPath));
+        AddAttribute(list, "PmsiTunnel", server->pmsi_tunnel_db()->Size(),
+                     sizeof(PmsiTunnel));
+        AddAttribute(list, "EdgeDiscovery",
+                     server->edge_discovery_db()->Size(),
+                     sizeof(EdgeDiscovery));
+        AddAttribute(list, "EdgeForwarding",
+                     server->edge_forwarding_db()->Size(),
+                     sizeof(EdgeForwarding));
+        AddAttribute(list, "BgpOList", server->olist_db()->Size(),
+                     sizeof(BgpOList));
+    }
+
+    static void FillAllocators(vector<BgpMemoryAllocatorInfo> *list) {
+        vector<const SlabAllocator *> allocators;
+        BgpRoute::GetAllocators(&allocators);
+        BgpPath::GetAllocators(&allocators);
+        for (vector<const SlabAllocator *>::const_iterator it =
+             allocators.begin(); it != allocators.end(); ++it) {
+            const SlabAllocator *allocator = *it;
+            BgpMemoryAllocatorInfo info;
+            info.set_name(allocator->name());
+            info.set_object_size(allocator->object_size());
+            info.set_in_use(allocator->in_use());
+            info.set_free(allocator->free_count());
+            info.set_bytes(allocator->bytes());
+            list->push_back(info);
+        }
+    }
+
+    static bool CallbackS1(const Sandesh *sr,
+            const RequestPipeline::PipeSpec ps, int stage, int instNum,
+            RequestPipeline::InstData *data) {
+        const ShowBgpMemoryReq *req =
+            static_cast<const ShowBgpMemoryReq *>(ps.snhRequest_.get());
+        BgpSandeshContext *bsc =
+            static_cast<BgpSandeshContext *>(req->client_context());
+
+        vector<BgpMemoryFamilyInfo> families;
+        FillFamilies(bsc->bgp_server, &families);
+        vector<BgpMemoryAttributeInfo> attributes;
+        FillAttributes(bsc->bgp_server, &attributes);
+        vector<BgpMemoryAllocatorInfo> allocators;
+        FillAllocators(&allocators);
+
+        ShowBgpMemoryResp *resp = new ShowBgpMemoryResp;
+        resp->set_families(families);
+        resp->set_attributes(attributes);
+        resp->set_allocators(allocators);
+        resp->set_context(req->context());
+        resp->Response();
+        return true;
+    }
+};
+
+void ShowBgpMemoryReq::HandleRequest() const {
+    RequestPipeline::PipeSpec ps(this);
+
+    // Request pipeline has single stage to collect memory usage of routes,
+    // paths and attributes and respond to the request
+    RequestPipeline::StageSpec s1;
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    s1.taskId_ = scheduler->GetTaskId("bgp::ShowCommand");
+    s1.cbFn_ = ShowBgpMemoryHandler::CallbackS1;
+    s1.instances_.push_back(0);
+    ps.stages_ = list_of(s1);
+    RequestPipeline rp(ps);
+}
+
 BgpSandeshContext::BgpSandeshContext()
     : bgp_server(NULL),
       xmpp_peer_manager(NULL),
@@ -44,6 +44,8 @@ BgpSession::BgpSession(BgpSessionManager *session_mgr, Socket *socket)
       index_(-1),
       reader_(new BgpMessageReader(this,
               boost::bind(&BgpSession::ReceiveMsg, this, _1, _2))) {
+    SetBufferSize(kReceiveBufferSize);
+    SetMaxFreeBuffers(kReceiveFreeBuffers);
 }
 
 BgpSession::~BgpSession() {
@@ -40,6 +40,13 @@ private:
 
 class BgpSession : public TcpSession {
 public:
+    // Receive buffers are large enough to hold many UPDATE messages so that
+    // most messages are decoded in place instead of being copied.
+    static const int kReceiveBufferSize = 64 * 1024;
+    // Released receive buffers kept for reuse, a session receiving a table
+    // reads into a small ring of buffers.
+    static const size_t kReceiveFreeBuffers = 2;
+
     BgpSession(BgpSessionManager *session_mgr, Socket *socket);
     virtual ~BgpSession();
 
@@ -6,6 +6,7 @@
 
 
 #include "bgp/bgp_peer_internal_types.h"
+#include "bgp/bgp_ribout_updates.h"
 #include "bgp/bgp_table.h"
 #include "bgp/routing-instance/routing_instance.h"
 
@@ -34,6 +35,13 @@ static void FillRouteTableSummaryInfo(ShowRouteTableSummary *srts,
     srts->set_markers(markers);
     srts->set_listeners(table->GetListenerCount());
     srts->set_walkers(table->walker_count());
+    RibOutLockStats lock_stats;
+    table->GetRibOutLockStats(&lock_stats);
+    srts->set_update_queue_locks(lock_stats.queue_lock_count);
+    srts->set_update_queue_lock_contended(lock_stats.queue_lock_contended);
+    srts->set_update_monitor_locks(lock_stats.monitor_lock_count);
+    srts->set_update_monitor_lock_contended(lock_stats.monitor_lock_contended);
+    srts->set_update_monitor_entry_waits(lock_stats.entry_wait_count);
 }
 
 //
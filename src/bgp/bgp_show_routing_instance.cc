@@ -8,6 +8,7 @@
 
 #include "bgp/bgp_peer_internal_types.h"
 #include "bgp/bgp_peer_membership.h"
+#include "bgp/bgp_ribout_updates.h"
 #include "bgp/routing-instance/routing_instance.h"
 
 using std::string;
@@ -28,6 +29,13 @@ static void FillRoutingInstanceTableInfo(ShowRoutingInstanceTable *srit,
     srit->set_markers(markers);
     srit->set_listeners(table->GetListenerCount());
     srit->set_walkers(table->walker_count());
+    RibOutLockStats lock_stats;
+    table->GetRibOutLockStats(&lock_stats);
+    srit->set_update_queue_locks(lock_stats.queue_lock_count);
+    srit->set_update_queue_lock_contended(lock_stats.queue_lock_contended);
+    srit->set_update_monitor_locks(lock_stats.monitor_lock_count);
+    srit->set_update_monitor_lock_contended(lock_stats.monitor_lock_contended);
+    srit->set_update_monitor_entry_waits(lock_stats.entry_wait_count);
     srit->prefixes = table->Size();
     srit->primary_paths = table->GetPrimaryPathCount();
     srit->secondary_paths = table->GetSecondaryPathCount();
@@ -50,10 +50,14 @@ BgpTable::BgpTable(DB *db, const string &name)
     : RouteTable(db, name),
       rtinstance_(NULL),
       path_resolver_(NULL),
+      export_plans_(PartitionCount()),
+      peer_path_maps_(PartitionCount()),
       instance_delete_ref_(this, NULL) {
     primary_path_count_ = 0;
     secondary_path_count_ = 0;
     infeasible_path_count_ = 0;
+    export_plan_hits_ = 0;
+    export_plan_misses_ = 0;
 }
 
 //
@@ -64,6 +68,9 @@ BgpTable::BgpTable(DB *db, const string &name)
 BgpTable::~BgpTable() {
     assert(path_resolver_ == NULL),
     instance_delete_ref_.Reset(NULL);
+    for (size_t part_id = 0; part_id < peer_path_maps_.size(); ++part_id) {
+        STLDeleteElements(&peer_path_maps_[part_id]);
+    }
 }
 
 void BgpTable::set_routing_instance(RoutingInstance *rtinstance) {
@@ -117,24 +124,60 @@ void BgpTable::RibOutDelete(const RibExportPolicy &policy) {
     ribout_map_.erase(loc);
 }
 
-UpdateInfo *BgpTable::GetUpdateInfo(RibOut *ribout, BgpRoute *route,
-        const RibPeerSet &peerset) {
-    const BgpPath *path = route->BestPath();
+//
+// Calculate the attributes to be advertised for the route to peers in the
+// RibOut. Returns false if the route should not be advertised to the peers.
+//
+// The result depends only on the encoding, peer type and peer AS of the
+// RibOut, so it's computed once per notification of the route and shared
+// by RibOuts that differ only in affinity or cluster id. Export of routes
+// outside of a notification e.g. on join of a peer is not cached.
+//
+bool BgpTable::ExportAttr(RibOut *ribout, BgpRoute *route,
+                          RibOutAttr *roattr) {
+    DBTablePartBase *root = route->get_table_partition();
+    if (!root || root->notify_entry() != route)
+        return ComputeExportAttr(ribout, route, roattr);
+
+    CHECK_CONCURRENCY("db::DBTable");
+
+    // Plans of the previous notification in the partition are stale.
+    ExportPlanList &plan_list = export_plans_[root->index()];
+    if (plan_list.seq != root->notify_seq()) {
+        plan_list.seq = root->notify_seq();
+        plan_list.plans.clear();
+    }
 
-    // Ignore if there is no best-path.
-    if (!path)
-        return NULL;
+    RibExportPolicy policy = ribout->ExportPolicy();
+    policy.affinity = -1;
+    policy.cluster_id = 0;
+    for (std::vector<ExportPlan>::const_iterator it = plan_list.plans.begin();
+         it != plan_list.plans.end(); ++it) {
+        if (it->policy < policy || policy < it->policy)
+            continue;
+        export_plan_hits_++;
+        if (it->reach)
+            *roattr = it->roattr;
+        return it->reach;
+    }
 
-    // Don't advertise infeasible paths.
-    if (!path->IsFeasible())
-        return NULL;
+    export_plan_misses_++;
+    plan_list.plans.push_back(ExportPlan(policy));
+    ExportPlan &plan = plan_list.plans.back();
+    plan.reach = ComputeExportAttr(ribout, route, &plan.roattr);
+    if (plan.reach)
+        *roattr = plan.roattr;
+    return plan.reach;
+}
+
+bool BgpTable::ComputeExportAttr(RibOut *ribout, BgpRoute *route,
+                                 RibOutAttr *roattr) {
+    const BgpPath *path = route->BestPath();
 
     // Needs to be outside the if block so it's not destroyed prematurely.
     BgpAttrPtr attr_ptr;
     const BgpAttr *attr = path->GetAttr();
 
-    RibPeerSet new_peerset = peerset;
-
     // LocalPref, Med and AsPath manipulation is needed only if the RibOut
     // has BGP encoding. Similarly, well-known communities do not apply if
     // the encoding is not BGP.
@@ -144,12 +187,12 @@ UpdateInfo *BgpTable::GetUpdateInfo(RibOut *ribout, BgpRoute *route,
             attr->community()->communities().size()) {
             BOOST_FOREACH(uint32_t value, attr->community()->communities()) {
                 if (value == Community::NoAdvertise)
-                    return NULL;
+                    return false;
 
                 if ((ribout->peer_type() == BgpProto::EBGP) &&
                     ((value == Community::NoExport) ||
                      (value == Community::NoExportSubconfed))) {
-                    return NULL;
+                    return false;
                 }
             }
         }
@@ -158,15 +201,7 @@ UpdateInfo *BgpTable::GetUpdateInfo(RibOut *ribout, BgpRoute *route,
         if (ribout->peer_type() == BgpProto::IBGP) {
             // Split horizon check.
             if (peer && peer->PeerType() == BgpProto::IBGP)
-                return NULL;
-
-            // Handle route-target filtering.
-            if (attr->ext_community() != NULL) {
-                server()->rtarget_group_mgr()->GetRibOutInterestedPeers(
-                    ribout, attr->ext_community(), peerset, &new_peerset);
-                if (new_peerset.empty())
-                    return NULL;
-            }
+                return false;
 
             BgpAttr *clone = new BgpAttr(*attr);
 
@@ -189,15 +224,7 @@ UpdateInfo *BgpTable::GetUpdateInfo(RibOut *ribout, BgpRoute *route,
             // Sender side AS path loop check.
             if (attr->as_path() &&
                 attr->as_path()->path().AsPathLoop(ribout->peer_as())) {
-                return NULL;
-            }
-
-            // Handle route-target filtering.
-            if (attr->ext_community() != NULL) {
-                server()->rtarget_group_mgr()->GetRibOutInterestedPeers(
-                    ribout, attr->ext_community(), peerset, &new_peerset);
-                if (new_peerset.empty())
-                    return NULL;
+                return false;
             }
 
             BgpAttr *clone = new BgpAttr(*attr);
@@ -233,17 +260,49 @@ UpdateInfo *BgpTable::GetUpdateInfo(RibOut *ribout, BgpRoute *route,
         }
     }
 
+    *roattr = RibOutAttr(route, attr, ribout->IsEncodingXmpp());
+    return true;
+}
+
+UpdateInfo *BgpTable::GetUpdateInfo(RibOut *ribout, BgpRoute *route,
+        const RibPeerSet &peerset) {
+    const BgpPath *path = route->BestPath();
+
+    // Ignore if there is no best-path.
+    if (!path)
+        return NULL;
+
+    // Don't advertise infeasible paths.
+    if (!path->IsFeasible())
+        return NULL;
+
+    RibOutAttr roattr;
+    if (!ExportAttr(ribout, route, &roattr))
+        return NULL;
+
+    // Handle route-target filtering. This is specific to the peers in the
+    // RibOut, so it's not part of the shared export computation.
+    RibPeerSet new_peerset = peerset;
+    const BgpAttr *attr = path->GetAttr();
+    if (ribout->IsEncodingBgp() && attr->ext_community() != NULL) {
+        server()->rtarget_group_mgr()->GetRibOutInterestedPeers(
+            ribout, attr->ext_community(), peerset, &new_peerset);
+        if (new_peerset.empty())
+            return NULL;
+    }
+
     UpdateInfo *uinfo = new UpdateInfo;
     uinfo->target = new_peerset;
-    uinfo->roattr = RibOutAttr(route, attr, ribout->IsEncodingXmpp());
+    uinfo->roattr = roattr;
     return uinfo;
 }
 
 // Bgp Path selection..
 // Based Attribute weight
+// Paths of a BgpRoute are always BgpPaths
 bool BgpTable::PathSelection(const Path &path1, const Path &path2) {
-    const BgpPath &l_path = dynamic_cast<const BgpPath &> (path1);
-    const BgpPath &r_path = dynamic_cast<const BgpPath &> (path2);
+    const BgpPath &l_path = static_cast<const BgpPath &> (path1);
+    const BgpPath &r_path = static_cast<const BgpPath &> (path2);
 
     // Check the weight of Path
     bool res = l_path.PathCompare(r_path, false) < 0;
@@ -293,6 +352,8 @@ void BgpTable::InputCommon(DBTablePartBase *root, BgpRoute *rt, BgpPath *path,
         if (new_path->NeedsResolution())
             path_resolver_->StartPathResolution(root->index(), new_path, rt);
         rt->InsertPath(new_path);
+        if (peer)
+            PeerPathLink(root, peer, rt, new_path);
         root->Notify(rt);
         break;
     }
@@ -324,6 +385,58 @@ void BgpTable::InputCommon(DBTablePartBase *root, BgpRoute *rt, BgpPath *path,
     }
 }
 
+//
+// Add the path to the list of paths of the peer in the partition.
+//
+// Concurrency: Runs in the context of the db::DBTable task for the partition,
+// which is the only one that adds or deletes paths in the partition.
+//
+void BgpTable::PeerPathLink(DBTablePartBase *root, const IPeer *peer,
+                            BgpRoute *rt, BgpPath *path) {
+    PeerPathMap &peer_path_map = peer_path_maps_[root->index()];
+    PeerPathMap::iterator loc = peer_path_map.find(peer);
+    if (loc == peer_path_map.end()) {
+        loc = peer_path_map.insert(make_pair(peer, new PeerPathList)).first;
+    }
+    path->route_ = rt;
+    loc->second->push_back(*path);
+}
+
+//
+// Move all paths of the peer in the partition to the given list. Paths that
+// are deleted while in the list unlink themselves from it.
+//
+void BgpTable::PeerPathListTake(DBTablePartBase *root, const IPeer *peer,
+                                PeerPathList *list) {
+    PeerPathMap &peer_path_map = peer_path_maps_[root->index()];
+    PeerPathMap::iterator loc = peer_path_map.find(peer);
+    if (loc == peer_path_map.end())
+        return;
+    list->splice(list->end(), *loc->second);
+}
+
+//
+// Forget the peer in the partition if it has no paths left.
+//
+void BgpTable::PeerPathListPurge(DBTablePartBase *root, const IPeer *peer) {
+    PeerPathMap &peer_path_map = peer_path_maps_[root->index()];
+    PeerPathMap::iterator loc = peer_path_map.find(peer);
+    if (loc == peer_path_map.end() || !loc->second->empty())
+        return;
+    delete loc->second;
+    peer_path_map.erase(loc);
+}
+
+size_t BgpTable::GetPeerPathCount(const IPeer *peer) const {
+    size_t count = 0;
+    for (size_t part_id = 0; part_id < peer_path_maps_.size(); ++part_id) {
+        PeerPathMap::const_iterator loc = peer_path_maps_[part_id].find(peer);
+        if (loc != peer_path_maps_[part_id].end())
+            count += loc->second->size();
+    }
+    return count;
+}
+
 void BgpTable::Input(DBTablePartition *root, DBClient *client,
                      DBRequest *req) {
     const IPeer *peer =
@@ -501,6 +614,16 @@ size_t BgpTable::GetPendingRiboutsCount(size_t *markers) const {
     return count;
 }
 
+void BgpTable::GetRibOutLockStats(RibOutLockStats *stats) const {
+    CHECK_CONCURRENCY("bgp::ShowCommand", "bgp::Config");
+
+    BOOST_FOREACH(const RibOutMap::value_type &i, ribout_map_) {
+        const RibOut *ribout = i.second;
+        if (ribout->updates())
+            ribout->updates()->AddLockStats(stats);
+    }
+}
+
 LifetimeActor *BgpTable::deleter() {
     return deleter_.get();
 }
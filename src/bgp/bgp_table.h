@@ -5,6 +5,7 @@
 #ifndef SRC_BGP_BGP_TABLE_H_
 #define SRC_BGP_BGP_TABLE_H_
 
+#include <boost/intrusive/list.hpp>
 #include <tbb/atomic.h>
 
 #include <map>
@@ -26,12 +27,20 @@ class PathResolver;
 class Route;
 class RoutingInstance;
 class SchedulingGroupManager;
+struct RibOutLockStats;
 struct UpdateInfo;
 
 class BgpTable : public RouteTable {
 public:
     typedef std::map<RibExportPolicy, RibOut *> RibOutMap;
 
+    // Paths learnt from a peer in a table partition. Lets RibIn of a peer
+    // be closed, staled or swept without walking the table.
+    typedef boost::intrusive::member_hook<BgpPath, BgpPath::PeerNode,
+        &BgpPath::peer_node_> PeerPathMember;
+    typedef boost::intrusive::list<BgpPath, PeerPathMember,
+        boost::intrusive::constant_time_size<false> > PeerPathList;
+
     struct RequestKey : DBRequestKey {
         virtual const IPeer *GetPeer() const = 0;
     };
@@ -94,6 +103,7 @@ public:
     static bool PathSelection(const Path &path1, const Path &path2);
     UpdateInfo *GetUpdateInfo(RibOut *ribout, BgpRoute *route,
                               const RibPeerSet &peerset);
+    bool ExportAttr(RibOut *ribout, BgpRoute *route, RibOutAttr *roattr);
 
     void ManagedDelete();
     virtual void RetryDelete();
@@ -117,9 +127,17 @@ public:
                      DBRequest::DBOperation oper, BgpAttrPtr attrs,
                      uint32_t path_id, uint32_t flags, uint32_t label);
 
+    void PeerPathLink(DBTablePartBase *root, const IPeer *peer, BgpRoute *rt,
+                      BgpPath *path);
+    void PeerPathListTake(DBTablePartBase *root, const IPeer *peer,
+                          PeerPathList *list);
+    void PeerPathListPurge(DBTablePartBase *root, const IPeer *peer);
+    size_t GetPeerPathCount(const IPeer *peer) const;
+
     LifetimeActor *deleter();
     const LifetimeActor *deleter() const;
     size_t GetPendingRiboutsCount(size_t *markers) const;
+    void GetRibOutLockStats(RibOutLockStats *stats) const;
 
     void UpdatePathCount(const BgpPath *path, int count);
     const uint64_t GetPrimaryPathCount() const { return primary_path_count_; }
@@ -129,21 +147,52 @@ public:
     const uint64_t GetInfeasiblePathCount() const {
         return infeasible_path_count_;
     }
+    const uint64_t GetExportPlanHits() const { return export_plan_hits_; }
+    const uint64_t GetExportPlanMisses() const {
+        return export_plan_misses_;
+    }
 
 private:
     class DeleteActor;
     friend class BgpTableTest;
+
+    // Export result of the route being notified for RibOuts with a given
+    // export policy, with the affinity and cluster id being ignored.
+    struct ExportPlan {
+        explicit ExportPlan(const RibExportPolicy &policy)
+            : policy(policy), reach(false) {
+        }
+        RibExportPolicy policy;
+        bool reach;
+        RibOutAttr roattr;
+    };
+
+    // Export plans computed in a partition for a notification.
+    struct ExportPlanList {
+        ExportPlanList() : seq(0) { }
+        uint64_t seq;
+        std::vector<ExportPlan> plans;
+    };
+
+    typedef std::map<const IPeer *, PeerPathList *> PeerPathMap;
+
+    bool ComputeExportAttr(RibOut *ribout, BgpRoute *route,
+                           RibOutAttr *roattr);
     virtual BgpRoute *TableFind(DBTablePartition *rtp,
             const DBRequestKey *prefix) = 0;
     RoutingInstance *rtinstance_;
     PathResolver *path_resolver_;
     RibOutMap ribout_map_;
+    std::vector<ExportPlanList> export_plans_;
+    std::vector<PeerPathMap> peer_path_maps_;
 
     boost::scoped_ptr<DeleteActor> deleter_;
     LifetimeRef<BgpTable> instance_delete_ref_;
     tbb::atomic<uint64_t> primary_path_count_;
     tbb::atomic<uint64_t> secondary_path_count_;
     tbb::atomic<uint64_t> infeasible_path_count_;
+    tbb::atomic<uint64_t> export_plan_hits_;
+    tbb::atomic<uint64_t> export_plan_misses_;
 
     DISALLOW_COPY_AND_ASSIGN(BgpTable);
 };
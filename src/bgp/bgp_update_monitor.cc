@@ -28,8 +28,43 @@ RouteUpdatePtr::~RouteUpdatePtr() {
     }
 }
 
+// Zero initialized, so lock statistics are disabled until enabled at startup.
+tbb::atomic<bool> RibUpdateMonitor::lock_stats_enabled_;
+
 RibUpdateMonitor::RibUpdateMonitor(RibOut *ribout, QueueVec *queue_vec) :
         ribout_(ribout), queue_vec_(queue_vec) {
+    lock_count_ = 0;
+    lock_contended_ = 0;
+    entry_wait_count_ = 0;
+}
+
+//
+// Lock the monitor mutex. If lock statistics are enabled, count the
+// acquisitions and the ones that had to wait because the mutex was held by
+// another task.
+//
+void RibUpdateMonitor::Lock(tbb::mutex::scoped_lock *lock) {
+    if (!lock_stats_enabled_) {
+        lock->acquire(mutex_);
+        return;
+    }
+    lock_count_++;
+    if (!lock->try_acquire(mutex_)) {
+        lock_contended_++;
+        lock->acquire(mutex_);
+    }
+}
+
+void RibUpdateMonitor::Lock(tbb::interface5::unique_lock<tbb::mutex> *lock) {
+    if (!lock_stats_enabled_) {
+        lock->lock();
+        return;
+    }
+    lock_count_++;
+    if (!lock->try_lock()) {
+        lock_contended_++;
+        lock->lock();
+    }
 }
 
 //
@@ -159,7 +194,9 @@ DBState *RibUpdateMonitor::GetDBStateAndDequeue(DBEntryBase *db_entry,
     // that we still need to check for the DBState being NULL as things may
     // have changed after the check made above.
     while (true) {
-        tbb::interface5::unique_lock<tbb::mutex> toplock(mutex_);
+        tbb::interface5::unique_lock<tbb::mutex> toplock(mutex_,
+            tbb::interface5::defer_lock);
+        Lock(&toplock);
 
         // Get the DBState; bail if there's no existing state.
         DBState *dbstate =
@@ -180,6 +217,7 @@ DBState *RibUpdateMonitor::GetDBStateAndDequeue(DBEntryBase *db_entry,
             tbb::mutex::scoped_lock updatelock;
             if (!updatelock.try_acquire(rt_update->mutex_)) {
                 // wait on a conditional variable.
+                CountEntryWait();
                 cond_var_.wait(toplock);
                 continue;
             }
@@ -199,6 +237,7 @@ DBState *RibUpdateMonitor::GetDBStateAndDequeue(DBEntryBase *db_entry,
             tbb::mutex::scoped_lock updatelock;
             if (!updatelock.try_acquire(uplist->mutex_)) {
                 // wait on a conditional variable.
+                CountEntryWait();
                 cond_var_.wait(toplock);
                 continue;
             }
@@ -309,7 +348,9 @@ bool RibUpdateMonitor::GetPeerSetCurrentAndScheduled(DBEntryBase *db_entry,
     // that we still need to check for the DBState being NULL as things may
     // have changed after the check made above.
     while (true) {
-        tbb::interface5::unique_lock<tbb::mutex> toplock(mutex_);
+        tbb::interface5::unique_lock<tbb::mutex> toplock(mutex_,
+            tbb::interface5::defer_lock);
+        Lock(&toplock);
 
         // Get the DBState; bail if there's no existing state.
         DBState *dbstate = db_entry->GetState(ribout_->table(),
@@ -331,6 +372,7 @@ bool RibUpdateMonitor::GetPeerSetCurrentAndScheduled(DBEntryBase *db_entry,
             tbb::mutex::scoped_lock updatelock;
             if (!updatelock.try_acquire(rt_update->mutex_)) {
                 // wait on a conditional variable.
+                CountEntryWait();
                 cond_var_.wait(toplock);
                 continue;
             }
@@ -346,6 +388,7 @@ bool RibUpdateMonitor::GetPeerSetCurrentAndScheduled(DBEntryBase *db_entry,
             tbb::mutex::scoped_lock updatelock;
             if (!updatelock.try_acquire(uplist->mutex_)) {
                 // wait on a conditional variable.
+                CountEntryWait();
                 cond_var_.wait(toplock);
                 continue;
             }
@@ -469,7 +512,9 @@ bool RibUpdateMonitor::MergeUpdate(DBEntryBase *db_entry,
     // against race conditions which could result in an incorrect return
     // value.
     while (true) {
-        tbb::interface5::unique_lock<tbb::mutex> toplock(mutex_);
+        tbb::interface5::unique_lock<tbb::mutex> toplock(mutex_,
+            tbb::interface5::defer_lock);
+        Lock(&toplock);
         DBState *dbstate =
             db_entry->GetState(ribout_->table(), ribout_->listener_id());
 
@@ -491,6 +536,7 @@ bool RibUpdateMonitor::MergeUpdate(DBEntryBase *db_entry,
             tbb::mutex::scoped_lock updatelock;
             if (!updatelock.try_acquire(current_rt_update->mutex_)) {
                 // wait on a conditional variable.
+                CountEntryWait();
                 cond_var_.wait(toplock);
                 continue;
             }
@@ -505,6 +551,7 @@ bool RibUpdateMonitor::MergeUpdate(DBEntryBase *db_entry,
             tbb::mutex::scoped_lock updatelock;
             if (!updatelock.try_acquire(uplist->mutex_)) {
                 // wait on a conditional variable.
+                CountEntryWait();
                 cond_var_.wait(toplock);
                 continue;
             }
@@ -713,7 +760,9 @@ void RibUpdateMonitor::ClearPeerSetCurrentAndScheduled(DBEntryBase *db_entry,
     // that we still need to check for the DBState being NULL as things may
     // have changed after the check made above.
     while (true) {
-        tbb::interface5::unique_lock<tbb::mutex> toplock(mutex_);
+        tbb::interface5::unique_lock<tbb::mutex> toplock(mutex_,
+            tbb::interface5::defer_lock);
+        Lock(&toplock);
         DBState *dbstate =
             db_entry->GetState(ribout_->table(), ribout_->listener_id());
 
@@ -739,6 +788,7 @@ void RibUpdateMonitor::ClearPeerSetCurrentAndScheduled(DBEntryBase *db_entry,
                 tbb::mutex::scoped_lock updatelock;
                 if (!updatelock.try_acquire(rt_update->mutex_)) {
                     // wait on a conditional variable.
+                    CountEntryWait();
                     cond_var_.wait(toplock);
                     continue;
                 }
@@ -764,6 +814,7 @@ void RibUpdateMonitor::ClearPeerSetCurrentAndScheduled(DBEntryBase *db_entry,
             tbb::mutex::scoped_lock updatelock;
             if (!updatelock.try_acquire(uplist->mutex_)) {
                 // wait on a conditional variable.
+                CountEntryWait();
                 cond_var_.wait(toplock);
                 continue;
             }
@@ -779,6 +830,189 @@ void RibUpdateMonitor::ClearPeerSetCurrentAndScheduled(DBEntryBase *db_entry,
     assert(false);
 }
 
+//
+// Copy the AdvertiseInfos of the peers in the RibPeerSet to adv_slist, with
+// only the bits of those peers set.
+//
+void RibUpdateMonitor::AdvertiseSListCopyBits(const AdvertiseSList &history,
+        const RibPeerSet &mpeers, AdvertiseSList *adv_slist) {
+    for (AdvertiseSList::List::const_iterator iter = history->begin();
+         iter != history->end(); ++iter) {
+        RibPeerSet bits;
+        bits.BuildIntersection(iter->bitset, mpeers);
+        if (bits.empty())
+            continue;
+        AdvertiseInfo *ainfo = new AdvertiseInfo(&iter->roattr);
+        ainfo->bitset = bits;
+        (*adv_slist)->push_front(*ainfo);
+    }
+}
+
+//
+// Set the bits of the peers in the RibPeerSet in the AdvertiseInfo with the
+// RibOutAttr, creating it if needed, and reset them in all other elements.
+//
+void RibUpdateMonitor::AdvertiseSListSetBits(AdvertiseSList &adv_slist,
+        const RibOutAttr &roattr, const RibPeerSet &mset) {
+    AdvertiseInfo *ainfo = NULL;
+    for (AdvertiseSList::List::iterator iter = adv_slist->begin();
+         iter != adv_slist->end(); ) {
+        if (iter->roattr == roattr) {
+            ainfo = iter.operator->();
+            ++iter;
+            continue;
+        }
+        iter->bitset.Reset(mset);
+        if (iter->bitset.empty()) {
+            iter = adv_slist->erase_and_dispose(iter, AdvertiseInfoDisposer());
+        } else {
+            ++iter;
+        }
+    }
+
+    if (ainfo == NULL) {
+        ainfo = new AdvertiseInfo(&roattr);
+        adv_slist->push_front(*ainfo);
+    }
+    ainfo->bitset |= mset;
+}
+
+//
+// Concurrency: Called in the context of the DB partition task.
+//
+// Get the attributes currently advertised to the peers in the RibPeerSet.
+// Scheduled updates are not included since they have not been sent yet.
+//
+void RibUpdateMonitor::GetPeerSetAdvertised(DBEntryBase *db_entry,
+        const RibPeerSet &mpeers, AdvertiseSList *adv_slist) {
+    CHECK_CONCURRENCY("db::DBTable");
+
+    DBState *dbstate =
+        db_entry->GetState(ribout_->table(), ribout_->listener_id());
+    if (dbstate == NULL) {
+        return;
+    }
+
+    while (true) {
+        tbb::interface5::unique_lock<tbb::mutex> toplock(mutex_,
+            tbb::interface5::defer_lock);
+        Lock(&toplock);
+        DBState *dbstate =
+            db_entry->GetState(ribout_->table(), ribout_->listener_id());
+
+        // Handle the case where there's no DBState.
+        if (dbstate == NULL) {
+            return;
+        }
+
+        // Handle the case where it's a RouteState.
+        RouteState *rstate = dynamic_cast<RouteState *>(dbstate);
+        if (rstate != NULL) {
+            AdvertiseSListCopyBits(rstate->Advertised(), mpeers, adv_slist);
+            return;
+        }
+
+        // Handle the case where it's a RouteUpdate.
+        RouteUpdate *rt_update = dynamic_cast<RouteUpdate *>(dbstate);
+        if (rt_update != NULL) {
+            tbb::mutex::scoped_lock updatelock;
+            if (!updatelock.try_acquire(rt_update->mutex_)) {
+                // wait on a conditional variable.
+                CountEntryWait();
+                cond_var_.wait(toplock);
+                continue;
+            }
+            AdvertiseSListCopyBits(rt_update->History(), mpeers, adv_slist);
+            return;
+        }
+
+        // Handle the case where it's a UpdateList.
+        UpdateList *uplist = dynamic_cast<UpdateList *>(dbstate);
+
+        // Unknown DBState.
+        assert(uplist);
+
+        tbb::mutex::scoped_lock updatelock;
+        if (!updatelock.try_acquire(uplist->mutex_)) {
+            // wait on a conditional variable.
+            CountEntryWait();
+            cond_var_.wait(toplock);
+            continue;
+        }
+        AdvertiseSListCopyBits(uplist->History(), mpeers, adv_slist);
+        return;
+    }
+}
+
+//
+// Concurrency: Called in the context of the DB partition task.
+//
+// Record that the route has been advertised with the RibOutAttr to the peers
+// in the RibPeerSet, without enqueueing an update. Used for peers that still
+// have the route from a previous session.
+//
+// The caller must make sure that there are no current or scheduled updates
+// for the peers.
+//
+void RibUpdateMonitor::SetPeerSetAdvertised(DBEntryBase *db_entry,
+        const RibOutAttr &roattr, const RibPeerSet &mset) {
+    CHECK_CONCURRENCY("db::DBTable");
+
+    while (true) {
+        tbb::interface5::unique_lock<tbb::mutex> toplock(mutex_,
+            tbb::interface5::defer_lock);
+        Lock(&toplock);
+        DBState *dbstate =
+            db_entry->GetState(ribout_->table(), ribout_->listener_id());
+
+        // Handle the case where there's no DBState.
+        if (dbstate == NULL) {
+            RouteState *rstate = new RouteState;
+            AdvertiseSListSetBits(rstate->Advertised(), roattr, mset);
+            db_entry->SetState(ribout_->table(), ribout_->listener_id(),
+                               rstate);
+            return;
+        }
+
+        // Handle the case where it's a RouteState.
+        RouteState *rstate = dynamic_cast<RouteState *>(dbstate);
+        if (rstate != NULL) {
+            AdvertiseSListSetBits(rstate->Advertised(), roattr, mset);
+            return;
+        }
+
+        // Handle the case where it's a RouteUpdate.
+        RouteUpdate *rt_update = dynamic_cast<RouteUpdate *>(dbstate);
+        if (rt_update != NULL) {
+            tbb::mutex::scoped_lock updatelock;
+            if (!updatelock.try_acquire(rt_update->mutex_)) {
+                // wait on a conditional variable.
+                CountEntryWait();
+                cond_var_.wait(toplock);
+                continue;
+            }
+            AdvertiseSListSetBits(rt_update->History(), roattr, mset);
+            return;
+        }
+
+        // Handle the case where it's a UpdateList.
+        UpdateList *uplist = dynamic_cast<UpdateList *>(dbstate);
+
+        // Unknown DBState.
+        assert(uplist);
+
+        tbb::mutex::scoped_lock updatelock;
+        if (!updatelock.try_acquire(uplist->mutex_)) {
+            // wait on a conditional variable.
+            CountEntryWait();
+            cond_var_.wait(toplock);
+            continue;
+        }
+        AdvertiseSListSetBits(uplist->History(), roattr, mset);
+        return;
+    }
+}
+
 //
 // Concurrency: must hold the entry lock.
 //
@@ -793,7 +1027,8 @@ bool RibUpdateMonitor::EnqueueUpdate(DBEntryBase *db_entry,
     CHECK_CONCURRENCY("db::DBTable");
 
     UpdateQueue *queue = queue_vec_->at(rt_update->queue_id());
-    tbb::mutex::scoped_lock lock(mutex_);
+    tbb::mutex::scoped_lock lock;
+    Lock(&lock);
     db_entry->SetState(ribout_->table(), ribout_->listener_id(), rt_update);
     return queue->Enqueue(rt_update);
 }
@@ -831,7 +1066,8 @@ void RibUpdateMonitor::DequeueUpdate(RouteUpdate *rt_update) {
     CHECK_CONCURRENCY("bgp::SendTask");
 
     UpdateQueue *queue = queue_vec_->at(rt_update->queue_id());
-    tbb::mutex::scoped_lock lock(mutex_);
+    tbb::mutex::scoped_lock lock;
+    Lock(&lock);
     queue->Dequeue(rt_update);
 }
 
@@ -886,7 +1122,8 @@ RouteUpdatePtr RibUpdateMonitor::GetNextUpdate(int queue_id,
     CHECK_CONCURRENCY("bgp::SendTask");
 
     UpdateQueue *queue = queue_vec_->at(queue_id);
-    tbb::mutex::scoped_lock lock(mutex_);
+    tbb::mutex::scoped_lock lock;
+    Lock(&lock);
     RouteUpdate *next_rt_update = queue->NextUpdate(upentry);
     tbb::mutex *mp = DBStateMutex(next_rt_update);
     RouteUpdatePtr update(mp, next_rt_update, &mutex_, &cond_var_);
@@ -912,7 +1149,8 @@ RouteUpdatePtr RibUpdateMonitor::GetNextEntry(int queue_id,
     CHECK_CONCURRENCY("bgp::SendTask");
 
     UpdateQueue *queue = queue_vec_->at(queue_id);
-    tbb::mutex::scoped_lock lock(mutex_);
+    tbb::mutex::scoped_lock lock;
+    Lock(&lock);
     UpdateEntry *next_upentry = *next_upentry_p = queue->NextEntry(upentry);
     if (next_upentry != NULL && next_upentry->IsUpdate()) {
         RouteUpdate *rt_update = static_cast<RouteUpdate *>(next_upentry);
@@ -938,7 +1176,8 @@ RouteUpdatePtr RibUpdateMonitor::GetAttrNext(int queue_id,
     CHECK_CONCURRENCY("bgp::SendTask");
 
     UpdateQueue *queue = queue_vec_->at(queue_id);
-    tbb::mutex::scoped_lock lock(mutex_);
+    tbb::mutex::scoped_lock lock;
+    Lock(&lock);
     UpdateInfo *next_uinfo = queue->AttrNext(current_uinfo);
     RouteUpdate *rt_update = NULL;
     tbb::mutex *mp = NULL;
@@ -959,7 +1198,8 @@ RouteUpdatePtr RibUpdateMonitor::GetAttrNext(int queue_id,
 void RibUpdateMonitor::SetEntryState(DBEntryBase *db_entry, DBState *dbstate) {
     CHECK_CONCURRENCY("bgp::SendTask");
 
-    tbb::mutex::scoped_lock lock(mutex_);
+    tbb::mutex::scoped_lock lock;
+    Lock(&lock);
     db_entry->SetState(ribout_->table(), ribout_->listener_id(), dbstate);
 }
 
@@ -971,6 +1211,7 @@ void RibUpdateMonitor::SetEntryState(DBEntryBase *db_entry, DBState *dbstate) {
 void RibUpdateMonitor::ClearEntryState(DBEntryBase *db_entry) {
     CHECK_CONCURRENCY("bgp::SendTask");
 
-    tbb::mutex::scoped_lock lock(mutex_);
+    tbb::mutex::scoped_lock lock;
+    Lock(&lock);
     db_entry->ClearState(ribout_->table(), ribout_->listener_id());
 }
@@ -6,6 +6,7 @@
 #define SRC_BGP_BGP_UPDATE_MONITOR_H_
 
 #include <boost/function.hpp>
+#include <tbb/atomic.h>
 #include <tbb/mutex.h>
 
 #include <algorithm>
@@ -174,6 +175,13 @@ public:
     void ClearPeerSetCurrentAndScheduled(DBEntryBase *db_entry,
                                          const RibPeerSet &mleave);
 
+    // Get the attributes advertised to a set of peers, and record that the
+    // route has been advertised to a set of peers without sending it.
+    void GetPeerSetAdvertised(DBEntryBase *db_entry, const RibPeerSet &mpeers,
+                              AdvertiseSList *adv_slist);
+    void SetPeerSetAdvertised(DBEntryBase *db_entry, const RibOutAttr &roattr,
+                              const RibPeerSet &mset);
+
     // Used by the update dequeue process to retrieve an update.
     RouteUpdatePtr GetNextUpdate(int queue_id, UpdateEntry *upentry);
 
@@ -189,7 +197,26 @@ public:
     void SetEntryState(DBEntryBase *db_entry, DBState *dbstate);
     void ClearEntryState(DBEntryBase *db_entry);
 
+    // Number of times the monitor lock was taken, the number of those that
+    // had to wait for another task to release it and the number of times
+    // the export module waited for the dequeue process to release an entry.
+    // Only kept when lock statistics are enabled, since the counters are
+    // shared by all the tasks that take the lock.
+    static void set_lock_stats_enabled(bool enabled) {
+        lock_stats_enabled_ = enabled;
+    }
+    uint64_t lock_count() const { return lock_count_; }
+    uint64_t lock_contended() const { return lock_contended_; }
+    uint64_t entry_wait_count() const { return entry_wait_count_; }
+
 private:
+    void Lock(tbb::mutex::scoped_lock *lock);
+    void Lock(tbb::interface5::unique_lock<tbb::mutex> *lock);
+    void CountEntryWait() {
+        if (lock_stats_enabled_)
+            entry_wait_count_++;
+    }
+
     // Retrieve that mutex associated with the route state.
     tbb::mutex *DBStateMutex(RouteUpdate *rt_update);
 
@@ -229,10 +256,20 @@ private:
     bool UpdateListClearPeerSet(DBEntryBase *db_entry,
             UpdateList *uplist, const RibPeerSet &mleave);
 
+    // Helper functions for GetPeerSetAdvertised and SetPeerSetAdvertised
+    void AdvertiseSListCopyBits(const AdvertiseSList &history,
+            const RibPeerSet &mpeers, AdvertiseSList *adv_slist);
+    void AdvertiseSListSetBits(AdvertiseSList &adv_slist,
+            const RibOutAttr &roattr, const RibPeerSet &mset);
+
     tbb::mutex mutex_;      // consistency between queue and entry lock.
     tbb::interface5::condition_variable cond_var_;
     RibOut *ribout_;
     QueueVec *queue_vec_;
+    static tbb::atomic<bool> lock_stats_enabled_;
+    tbb::atomic<uint64_t> lock_count_;
+    tbb::atomic<uint64_t> lock_contended_;
+    tbb::atomic<uint64_t> entry_wait_count_;
     DISALLOW_COPY_AND_ASSIGN(RibUpdateMonitor);
 };
 
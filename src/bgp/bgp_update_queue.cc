@@ -4,12 +4,16 @@
 
 #include "bgp/bgp_update_queue.h"
 
+// Zero initialized, so lock statistics are disabled until enabled at startup.
+tbb::atomic<bool> UpdateQueue::lock_stats_enabled_;
 
 //
 // Initialize the UpdateQueue and add the tail marker to the FIFO.
 //
 UpdateQueue::UpdateQueue(int queue_id)
     : queue_id_(queue_id), marker_count_(0) {
+    lock_count_ = 0;
+    lock_contended_ = 0;
     queue_.push_back(tail_marker_);
 }
 
@@ -22,6 +26,22 @@ UpdateQueue::~UpdateQueue() {
     assert(attr_set_.empty());
 }
 
+//
+// Lock the mutex. If lock statistics are enabled, count the acquisitions and
+// the ones that had to wait because the mutex was held by another task.
+//
+void UpdateQueue::Lock(tbb::mutex::scoped_lock *lock) {
+    if (!lock_stats_enabled_) {
+        lock->acquire(mutex_);
+        return;
+    }
+    lock_count_++;
+    if (!lock->try_acquire(mutex_)) {
+        lock_contended_++;
+        lock->acquire(mutex_);
+    }
+}
+
 //
 // Enqueue the specified RouteUpdate to the UpdateQueue.  Updates both the
 // FIFO and the set container.
@@ -29,7 +49,8 @@ UpdateQueue::~UpdateQueue() {
 // Return true if the UpdateQueue had no RouteUpdates after the tail marker.
 //
 bool UpdateQueue::Enqueue(RouteUpdate *rt_update) {
-    tbb::mutex::scoped_lock lock(mutex_);
+    tbb::mutex::scoped_lock lock;
+    Lock(&lock);
     rt_update->set_tstamp_now();
 
     // Insert at the end of the FIFO. Remember if the FIFO previously had
@@ -55,7 +76,8 @@ bool UpdateQueue::Enqueue(RouteUpdate *rt_update) {
 // elements for the RouteUpdate are removed from the set container.
 //
 void UpdateQueue::Dequeue(RouteUpdate *rt_update) {
-    tbb::mutex::scoped_lock lock(mutex_);
+    tbb::mutex::scoped_lock lock;
+    Lock(&lock);
     queue_.erase(queue_.iterator_to(*rt_update));
     UpdateInfoSList &uinfo_slist = rt_update->Updates();
     for (UpdateInfoSList::List::iterator iter = uinfo_slist->begin();
@@ -72,7 +94,8 @@ void UpdateQueue::Dequeue(RouteUpdate *rt_update) {
 // Return NULL if there's no such RouteUpdate on the FIFO.
 //
 RouteUpdate *UpdateQueue::NextUpdate(UpdateEntry *current_upentry) {
-    tbb::mutex::scoped_lock lock(mutex_);
+    tbb::mutex::scoped_lock lock;
+    Lock(&lock);
     UpdatesByOrder::iterator iter = queue_.iterator_to(*current_upentry);
     while (++iter != queue_.end()) {
         UpdateEntry *upentry = iter.operator->();
@@ -91,7 +114,8 @@ RouteUpdate *UpdateQueue::NextUpdate(UpdateEntry *current_upentry) {
 // Return NULL if there's no such UpdateEntry on the FIFO.
 //
 UpdateEntry *UpdateQueue::NextEntry(UpdateEntry *current_upentry) {
-    tbb::mutex::scoped_lock lock(mutex_);
+    tbb::mutex::scoped_lock lock;
+    Lock(&lock);
     UpdatesByOrder::iterator iter = queue_.iterator_to(*current_upentry);
     if (++iter == queue_.end()) {
         return NULL;
@@ -103,7 +127,8 @@ UpdateEntry *UpdateQueue::NextEntry(UpdateEntry *current_upentry) {
 // Dequeue the specified UpdateInfo from the set container.
 //
 void UpdateQueue::AttrDequeue(UpdateInfo *current_uinfo) {
-    tbb::mutex::scoped_lock lock(mutex_);
+    tbb::mutex::scoped_lock lock;
+    Lock(&lock);
     attr_set_.erase(attr_set_.iterator_to(*current_uinfo));
 }
 
@@ -115,7 +140,8 @@ void UpdateQueue::AttrDequeue(UpdateInfo *current_uinfo) {
 // Returns NULL if there are no more updates with the same BgpAttr.
 //
 UpdateInfo *UpdateQueue::AttrNext(UpdateInfo *current_uinfo) {
-    tbb::mutex::scoped_lock lock(mutex_);
+    tbb::mutex::scoped_lock lock;
+    Lock(&lock);
     UpdatesByAttr::iterator iter = attr_set_.iterator_to(*current_uinfo);
     ++iter;
     if (iter == attr_set_.end()) {
@@ -135,7 +161,8 @@ UpdateInfo *UpdateQueue::AttrNext(UpdateInfo *current_uinfo) {
 //
 void UpdateQueue::AddMarker(UpdateMarker *marker, RouteUpdate *rt_update) {
     assert(!marker->members.empty());
-    tbb::mutex::scoped_lock lock(mutex_);
+    tbb::mutex::scoped_lock lock;
+    Lock(&lock);
     marker_count_++;
     queue_.insert(++queue_.iterator_to(*rt_update), *marker);
 
@@ -160,7 +187,8 @@ void UpdateQueue::AddMarker(UpdateMarker *marker, RouteUpdate *rt_update) {
 // the tail marker after the RouteUpdate.
 //
 void UpdateQueue::MoveMarker(UpdateMarker *marker, RouteUpdate *rt_update) {
-    tbb::mutex::scoped_lock lock(mutex_);
+    tbb::mutex::scoped_lock lock;
+    Lock(&lock);
     queue_.erase(queue_.iterator_to(*marker));
 
     UpdatesByOrder::iterator iter = queue_.iterator_to(*rt_update);
@@ -187,7 +215,8 @@ void UpdateQueue::MarkerSplit(UpdateMarker *marker, const RibPeerSet &msplit) {
     UpdateMarker *split_marker = new UpdateMarker();
     split_marker->members = msplit;
 
-    tbb::mutex::scoped_lock lock(mutex_);
+    tbb::mutex::scoped_lock lock;
+    Lock(&lock);
     marker->members.Reset(msplit);
     assert(!marker->members.empty());
     UpdatesByOrder::iterator mpos = queue_.iterator_to(*marker);
@@ -211,7 +240,8 @@ void UpdateQueue::MarkerSplit(UpdateMarker *marker, const RibPeerSet &msplit) {
 void UpdateQueue::MarkerMerge(UpdateMarker *dst_marker,
         UpdateMarker *src_marker, const RibPeerSet &bitset) {
     assert(!bitset.empty());
-    tbb::mutex::scoped_lock lock(mutex_);
+    tbb::mutex::scoped_lock lock;
+    Lock(&lock);
 
     // Set the bits in dst and update the MarkerMap.  Be sure to set the dst
     // before we reset the src since bitset maybe a reference to src->members.
@@ -237,7 +267,8 @@ void UpdateQueue::MarkerMerge(UpdateMarker *dst_marker,
 // Return the UpdateMarker for the peer specified by the bit position.
 //
 UpdateMarker *UpdateQueue::GetMarker(int bit) {
-    tbb::mutex::scoped_lock lock(mutex_);
+    tbb::mutex::scoped_lock lock;
+    Lock(&lock);
     MarkerMap::iterator loc = markers_.find(bit);
     assert(loc != markers_.end());
     return loc->second;
@@ -255,7 +286,8 @@ UpdateMarker *UpdateQueue::GetMarker(int bit) {
 // an extra one is harmless.
 //
 bool UpdateQueue::Join(int bit) {
-    tbb::mutex::scoped_lock lock(mutex_);
+    tbb::mutex::scoped_lock lock;
+    Lock(&lock);
     UpdateMarker *marker = &tail_marker_;
     marker->members.set(bit);
     markers_.insert(std::make_pair(bit, marker));
@@ -269,7 +301,8 @@ bool UpdateQueue::Join(int bit) {
 // itself if it's now empty.
 //
 void UpdateQueue::Leave(int bit) {
-    tbb::mutex::scoped_lock lock(mutex_);
+    tbb::mutex::scoped_lock lock;
+    Lock(&lock);
     MarkerMap::iterator loc = markers_.find(bit);
     assert(loc != markers_.end());
     UpdateMarker *marker = loc->second;
@@ -296,6 +329,20 @@ bool UpdateQueue::CheckInvariants() const {
 // are as no UpdateInfo elements in the set container. We don't look at the
 // FIFO since that may still have the tail marker on it.
 //
+//
+// Return true if the peer, as represented by it's bit index, has seen all
+// the updates in the UpdateQueue.  This is the case when the peer is in the
+// tail marker and the tail marker is the last entry in the queue.  A peer
+// that has not joined the UpdateQueue has nothing to see.
+//
+bool UpdateQueue::PeerDrained(int bit) const {
+    tbb::mutex::scoped_lock lock(mutex_);
+    MarkerMap::const_iterator loc = markers_.find(bit);
+    if (loc == markers_.end())
+        return true;
+    return (loc->second == &tail_marker_ && &tail_marker_ == &queue_.back());
+}
+
 bool UpdateQueue::empty() const {
     tbb::mutex::scoped_lock lock(mutex_);
     return attr_set_.empty();
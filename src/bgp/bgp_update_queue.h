@@ -5,6 +5,7 @@
 #ifndef SRC_BGP_BGP_UPDATE_QUEUE_H_
 #define SRC_BGP_BGP_UPDATE_QUEUE_H_
 
+#include <tbb/atomic.h>
 #include <tbb/mutex.h>
 
 #include <list>
@@ -67,7 +68,9 @@ struct UpdateByAttrCmp {
 // Additionally, using a mutex for the UpdateQueue is a generally good
 // design principle to follow, given that there should be no contention for
 // the mutex most of the time.  All the methods use a scoped lock to lock
-// the mutex.
+// the mutex. The queue keeps a count of lock acquisitions and of the ones
+// that had to wait, so that contention between the export tasks and the
+// update dequeue task can be measured.
 //
 // An UpdateQueue also maintains a mapping from a peer's bit position to
 // it's UpdateMarker. Note that it's possible for multiple peers to point
@@ -125,6 +128,7 @@ public:
 
     bool Join(int bit);
     void Leave(int bit);
+    bool PeerDrained(int bit) const;
 
     bool CheckInvariants() const;
 
@@ -134,11 +138,25 @@ public:
     size_t size() const;
     size_t marker_count() const;
 
+    // Lock statistics are only kept when enabled, since the counters are
+    // shared by all the tasks that take the lock.
+    static void set_lock_stats_enabled(bool enabled) {
+        lock_stats_enabled_ = enabled;
+    }
+    uint64_t lock_count() const { return lock_count_; }
+    uint64_t lock_contended() const { return lock_contended_; }
+
 private:
     friend class BgpExportTest;
     friend class RibOutUpdatesTest;
 
+    void Lock(tbb::mutex::scoped_lock *lock);
+
+    static tbb::atomic<bool> lock_stats_enabled_;
+
     mutable tbb::mutex mutex_;
+    tbb::atomic<uint64_t> lock_count_;
+    tbb::atomic<uint64_t> lock_contended_;
     int queue_id_;
     size_t marker_count_;
     UpdatesByOrder queue_;
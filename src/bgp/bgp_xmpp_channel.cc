@@ -11,9 +11,11 @@
 #include <sstream>
 
 #include "base/task_annotations.h"
+#include "base/timer.h"
 #include "bgp/bgp_factory.h"
 #include "bgp/bgp_log.h"
 #include "bgp/bgp_peer_membership.h"
+#include "bgp/bgp_ribout_updates.h"
 #include "bgp/inet/inet_table.h"
 #include "bgp/inet6/inet6_table.h"
 #include "bgp/extended-community/load_balance.h"
@@ -28,6 +30,7 @@
 #include "schema/xmpp_enet_types.h"
 #include "xml/xml_pugi.h"
 #include "xmpp/xmpp_connection.h"
+#include "xmpp/xmpp_init.h"
 #include "xmpp/xmpp_server.h"
 #include "xmpp/sandesh/xmpp_peer_info_types.h"
 
@@ -46,15 +49,20 @@ using autogen::SecurityGroupListType;
 using autogen::TunnelEncapsulationListType;
 
 using boost::system::error_code;
+using pugi::xml_document;
 using pugi::xml_node;
 using std::auto_ptr;
 using std::make_pair;
+using std::map;
 using std::numeric_limits;
+using std::ostringstream;
 using std::pair;
 using std::set;
 using std::string;
 using std::vector;
 
+const int BgpXmppChannel::kRibOutSyncInterval;
+
 //
 // Calculate med from local preference.
 // Should move agent definitions to a common location and use those here
@@ -482,6 +490,7 @@ BgpXmppChannel::BgpXmppChannel(XmppChannel *channel, BgpServer *bgp_server,
       peer_close_(new PeerClose(this)),
       peer_stats_(new PeerStats(this)),
       bgp_policy_(peer_->PeerType(), RibExportPolicy::XMPP, 0, -1, 0),
+      ribout_sync_timer_(NULL),
       manager_(manager),
       close_in_progress_(false),
       deleted_(false),
@@ -491,6 +500,10 @@ BgpXmppChannel::BgpXmppChannel(XmppChannel *channel, BgpServer *bgp_server,
             channel->connection()->GetIndex(),
             boost::bind(&BgpXmppChannel::MembershipResponseHandler, this, _1)),
       lb_mgr_(new LabelBlockManager()) {
+    ribout_sync_timer_ = TimerManager::CreateTimer(
+        *bgp_server->ioservice(), "RibOut Sync Timer",
+        TaskScheduler::GetInstance()->GetTaskId("xmpp::StateMachine"),
+        channel->connection()->GetIndex());
     channel_->RegisterReceive(peer_id_,
          boost::bind(&BgpXmppChannel::ReceiveUpdate, this, _1));
     BGP_LOG_PEER(Event, peer_.get(), SandeshLevel::SYS_INFO, BGP_LOG_FLAG_ALL,
@@ -507,6 +520,7 @@ BgpXmppChannel::~BgpXmppChannel() {
     if (manager_ && close_in_progress_)
         manager_->decrement_closing_count();
     STLDeleteElements(&defer_q_);
+    TimerManager::DeleteTimer(ribout_sync_timer_);
     assert(peer_->IsDeleted());
     BGP_LOG_PEER(Event, peer_.get(), SandeshLevel::SYS_INFO, BGP_LOG_FLAG_ALL,
         BGP_PEER_DIR_NA, "Deleted");
@@ -1713,19 +1727,29 @@ bool BgpXmppChannel::ResumeClose() {
     return true;
 }
 
-void BgpXmppChannel::RegisterTable(BgpTable *table, int instance_id) {
+void BgpXmppChannel::RegisterTable(BgpTable *table, int instance_id,
+                                   RibOutResyncPtr resync) {
     PeerRibMembershipManager *mgr = bgp_server_->membership_mgr();
     BGP_LOG_PEER(Membership, Peer(), SandeshLevel::SYS_DEBUG,
                  BGP_LOG_FLAG_ALL, BGP_PEER_DIR_NA,
                  "Subscribe to table " << table->name() <<
-                 " with id " << instance_id);
+                 " with id " << instance_id <<
+                 (resync ? " and adj-rib-out digest" : ""));
+    if (resync) {
+        ribout_resync_map_[table->name()] = resync;
+    } else {
+        ribout_resync_map_.erase(table->name());
+    }
     mgr->Register(peer_.get(), table, bgp_policy_, instance_id,
-        boost::bind(&BgpXmppChannel::MembershipRequestCallback, this, _1, _2));
+        boost::bind(&BgpXmppChannel::MembershipRequestCallback, this, _1, _2),
+        resync);
     channel_stats_.table_subscribe++;
 }
 
 void BgpXmppChannel::UnregisterTable(BgpTable *table) {
     PeerRibMembershipManager *mgr = bgp_server_->membership_mgr();
+    ribout_resync_map_.erase(table->name());
+    ribout_sync_pending_map_.erase(table->name());
     BGP_LOG_PEER(Membership, Peer(), SandeshLevel::SYS_DEBUG,
                  BGP_LOG_FLAG_ALL, BGP_PEER_DIR_NA,
                  "Unsubscribe to table " << table->name());
@@ -1805,6 +1829,7 @@ bool BgpXmppChannel::MembershipResponseHandler(string table_name) {
         IPeerRib *rib = mgr->IPeerRibFind(peer_.get(), table);
         if (rib)
             rib->set_instance_id(state.instance_id);
+        RibOutResyncDone(table);
     }
 
     for (DeferQ::iterator it = defer_q_.find(vrf_n_table);
@@ -1817,6 +1842,112 @@ bool BgpXmppChannel::MembershipResponseHandler(string table_name) {
     return true;
 }
 
+//
+// The join for a table that was subscribed with an adj-rib-out digest has
+// completed. The sync for the table must not reach the agent before the
+// routes that were sent again, so hold it until the updates for the peer
+// have been dequeued from the RibOut.
+//
+void BgpXmppChannel::RibOutResyncDone(BgpTable *table) {
+    RibOutResyncMap::iterator loc = ribout_resync_map_.find(table->name());
+    if (loc == ribout_resync_map_.end())
+        return;
+    RibOutResyncPtr resync = loc->second;
+    ribout_resync_map_.erase(loc);
+
+    if (IsRibOutDrained(table)) {
+        SendRibOutResync(table, resync);
+        return;
+    }
+    ribout_sync_pending_map_[table->name()] = resync;
+    ribout_sync_timer_->Start(kRibOutSyncInterval,
+        boost::bind(&BgpXmppChannel::RibOutResyncTimerExpired, this));
+}
+
+//
+// Return true if the peer has seen all the updates in the RibOut of the
+// table.
+//
+bool BgpXmppChannel::IsRibOutDrained(BgpTable *table) {
+    PeerRibMembershipManager *mgr = bgp_server_->membership_mgr();
+    IPeerRib *rib = mgr->IPeerRibFind(peer_.get(), table);
+    if (!rib || !rib->ribout())
+        return true;
+    RibOut *ribout = rib->ribout();
+    if (!ribout->IsRegistered(peer_.get()))
+        return true;
+    return ribout->updates()->PeerDrained(ribout->GetPeerIndex(peer_.get()));
+}
+
+//
+// Send the sync for the tables whose RibOut has been drained. The timer is
+// restarted as long as there are tables left. Tables that are gone and
+// peers that are closing don't get a sync.
+//
+bool BgpXmppChannel::RibOutResyncTimerExpired() {
+    if (peer_->IsDeleted() || close_in_progress_) {
+        ribout_sync_pending_map_.clear();
+        return false;
+    }
+
+    for (RibOutResyncMap::iterator it = ribout_sync_pending_map_.begin(),
+         next = it; it != ribout_sync_pending_map_.end(); it = next) {
+        ++next;
+        BgpTable *table = static_cast<BgpTable *>(
+            bgp_server_->database()->FindTable(it->first));
+        if (!table || table->IsDeleted()) {
+            ribout_sync_pending_map_.erase(it);
+            continue;
+        }
+        if (!IsRibOutDrained(table))
+            continue;
+        SendRibOutResync(table, it->second);
+        ribout_sync_pending_map_.erase(it);
+    }
+    return !ribout_sync_pending_map_.empty();
+}
+
+//
+// Tell the agent which buckets of the adj-rib-out digest it sent with the
+// subscribe request for the table are in sync. The agent keeps the routes
+// it has for those buckets, all the other routes of the table have been
+// sent again.
+//
+void BgpXmppChannel::SendRibOutResync(BgpTable *table,
+                                      RibOutResyncPtr resync) {
+    BGP_LOG_PEER(Membership, Peer(), SandeshLevel::SYS_DEBUG,
+                 BGP_LOG_FLAG_ALL, BGP_PEER_DIR_NA,
+                 "Resync of table " << table->name() << " completed with " <<
+                 std::hex << "candidate buckets 0x" <<
+                 resync->candidate_mask() << ", dirty buckets 0x" <<
+                 resync->dirty_mask() << std::dec);
+
+    ostringstream mask;
+    mask << std::hex << resync->sync_mask();
+    string node = string("adj-rib-out-sync/") +
+        table->routing_instance()->name();
+    string to = peer_->ToString() + "/" + XmppInit::kBgpPeer;
+
+    xml_document xdoc;
+    xml_node message = xdoc.append_child("message");
+    message.append_attribute("from") = XmppInit::kControlNodeJID;
+    message.append_attribute("to") = to.c_str();
+    xml_node event = message.append_child("event");
+    event.append_attribute("xmlns") = "http://jabber.org/protocol/pubsub";
+    xml_node items = event.append_child("items");
+    items.append_attribute("node") = node.c_str();
+    xml_node item = items.append_child("item");
+    item.append_attribute("id") =
+        Address::FamilyToString(table->family()).c_str();
+    item.append_child("sync").text().set(mask.str().c_str());
+
+    ostringstream oss;
+    xdoc.save(oss);
+    string msg = oss.str();
+    peer_->SendUpdate(reinterpret_cast<const uint8_t *>(msg.c_str()),
+                      msg.size());
+}
+
 void BgpXmppChannel::MembershipRequestCallback(IPeer *ipeer, BgpTable *table) {
     membership_response_worker_.Enqueue(table->name());
 }
@@ -1978,6 +2109,7 @@ void BgpXmppChannel::ProcessSubscriptionRequest(
         string vrf_name, const XmppStanza::XmppMessageIq *iq,
         bool add_change) {
     int instance_id = -1;
+    map<string, RibOutDigest> digests;
 
     if (add_change) {
         XmlPugi *pugi = reinterpret_cast<XmlPugi *>(iq->dom.get());
@@ -1986,6 +2118,19 @@ void BgpXmppChannel::ProcessSubscriptionRequest(
              node = node.next_sibling()) {
             if (strcmp(node.name(), "instance-id") == 0) {
                 instance_id = node.text().as_int();
+            } else if (strcmp(node.name(), "adj-rib-out-digest") == 0 &&
+                       manager_ && manager_->ribout_resync_enabled()) {
+                // Digest of the routes the agent kept for the family
+                // from its previous session
+                RibOutDigest digest;
+                if (digest.FromString(node.text().get())) {
+                    digests[node.attribute("family").value()] = digest;
+                } else {
+                    BGP_LOG_PEER(Membership, Peer(), SandeshLevel::SYS_WARN,
+                                 BGP_LOG_FLAG_ALL, BGP_PEER_DIR_NA,
+                                 "Ignoring bad adj-rib-out digest for " <<
+                                 "routing instance " << vrf_name);
+                }
             }
         }
     }
@@ -2117,7 +2262,12 @@ void BgpXmppChannel::ProcessSubscriptionRequest(
                 loc->second.pending_req = SUBSCRIBE;
                 continue;
             }
-            RegisterTable(table, instance_id);
+            RibOutResyncPtr resync;
+            map<string, RibOutDigest>::const_iterator digest_it =
+                digests.find(Address::FamilyToString(table->family()));
+            if (digest_it != digests.end())
+                resync.reset(new RibOutResync(digest_it->second));
+            RegisterTable(table, instance_id, resync);
         } else {
             if (defer_q_.count(make_pair(vrf_name, table->name()))) {
                 BGP_LOG_PEER(Membership, Peer(), SandeshLevel::SYS_DEBUG,
@@ -2221,6 +2371,7 @@ BgpXmppChannelManager::BgpXmppChannelManager(XmppServer *xmpp_server,
       asn_listener_id_(-1),
       identifier_listener_id_(-1),
       closing_count_(0) {
+    ribout_resync_enabled_ = false;
     queue_.SetEntryCallback(
             boost::bind(&BgpXmppChannelManager::IsReadyForDeletion, this));
     if (xmpp_server) {
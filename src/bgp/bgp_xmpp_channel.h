@@ -8,6 +8,7 @@
 #include <boost/function.hpp>
 #include <boost/system/error_code.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <tbb/atomic.h>
 
 #include <map>
 #include <set>
@@ -16,6 +17,7 @@
 
 #include "base/queue_task.h"
 #include "bgp/bgp_ribout.h"
+#include "bgp/bgp_ribout_digest.h"
 #include "bgp/routing-instance/routing_instance.h"
 #include "net/rd.h"
 #include "xmpp/xmpp_channel.h"
@@ -28,6 +30,7 @@ class BgpServer;
 struct DBRequest;
 class IPeer;
 class PeerCloseManager;
+class Timer;
 class XmppServer;
 class BgpXmppChannelMock;
 class BgpXmppChannelManager;
@@ -36,6 +39,10 @@ class XmppSession;
 
 class BgpXmppChannel {
 public:
+    // Interval in msec at which the RibOut queues are checked before the
+    // adj-rib-out sync is sent to the agent.
+    static const int kRibOutSyncInterval = 100;
+
     enum StatsIndex {
         RX,
         TX,
@@ -167,6 +174,11 @@ private:
     // before routing instance is actually created
     typedef std::map<std::string, int> VrfMembershipRequestMap;
 
+    // map of routing-instance table name to the resync state of a
+    // subscribe request that came with the digest of the routes the agent
+    // kept from its previous session
+    typedef std::map<std::string, RibOutResyncPtr> RibOutResyncMap;
+
     // The code assumes that multimap preserves insertion order for duplicate
     // values of same key.
     typedef std::pair<const std::string, const std::string> VrfTableName;
@@ -203,8 +215,13 @@ private:
                                     const XmppStanza::XmppMessageIq *iq,
                                     bool add_change);
 
-    void RegisterTable(BgpTable *table, int instance_id);
+    void RegisterTable(BgpTable *table, int instance_id,
+                       RibOutResyncPtr resync = RibOutResyncPtr());
     void UnregisterTable(BgpTable *table);
+    void RibOutResyncDone(BgpTable *table);
+    bool RibOutResyncTimerExpired();
+    bool IsRibOutDrained(BgpTable *table);
+    void SendRibOutResync(BgpTable *table, RibOutResyncPtr resync);
     bool MembershipResponseHandler(std::string table_name);
     void MembershipRequestCallback(IPeer *ipeer, BgpTable *table);
     void DequeueRequest(const std::string &table_name, DBRequest *request);
@@ -227,6 +244,12 @@ private:
 
     RoutingTableMembershipRequestMap routingtable_membership_request_map_;
     VrfMembershipRequestMap vrf_membership_request_map_;
+    RibOutResyncMap ribout_resync_map_;
+
+    // Resync state of tables for which the join has completed, but the
+    // updates for the peer are still in the RibOut queues.
+    RibOutResyncMap ribout_sync_pending_map_;
+    Timer *ribout_sync_timer_;
     BgpXmppChannelManager *manager_;
     bool close_in_progress_;
     bool deleted_;
@@ -299,6 +322,13 @@ public:
     BgpServer *bgp_server() { return bgp_server_; }
     XmppServer *xmpp_server() { return xmpp_server_; }
 
+    // Honor the adj-rib-out digests sent by agents with subscribe requests.
+    // Disabled by default, set at startup.
+    bool ribout_resync_enabled() const { return ribout_resync_enabled_; }
+    void set_ribout_resync_enabled(bool enabled) {
+        ribout_resync_enabled_ = enabled;
+    }
+
 protected:
     virtual BgpXmppChannel *CreateChannel(XmppChannel *channel);
 
@@ -315,6 +345,7 @@ private:
     int asn_listener_id_;
     int identifier_listener_id_;
     uint32_t closing_count_;
+    tbb::atomic<bool> ribout_resync_enabled_;
 
     DISALLOW_COPY_AND_ASSIGN(BgpXmppChannelManager);
 };
@@ -202,6 +202,9 @@ void PathResolver::RemoveResolverNexthop(ResolverNexthop *rnexthop) {
     assert(loc != nexthop_map_.end());
     nexthop_map_.erase(loc);
     nexthop_update_list_.erase(rnexthop);
+    for (int part_id = 0; part_id < DB::PartitionCount(); ++part_id) {
+        partitions_[part_id]->RemoveResolverNexthop(rnexthop);
+    }
 }
 
 //
@@ -452,6 +455,7 @@ PathResolverPartition::PathResolverPartition(int part_id,
 //
 PathResolverPartition::~PathResolverPartition() {
     assert(rpath_update_list_.empty());
+    assert(rnexthop_update_list_.empty());
     rpath_update_trigger_->Reset();
 }
 
@@ -504,12 +508,34 @@ void PathResolverPartition::StopPathResolution(const BgpPath *path) {
 // Add a ResolverPath to the update list and start Task to process the list.
 //
 void PathResolverPartition::TriggerPathResolution(ResolverPath *rpath) {
-    CHECK_CONCURRENCY("db::DBTable", "bgp::ResolverNexthop");
+    CHECK_CONCURRENCY("db::DBTable");
 
     rpath_update_list_.insert(rpath);
     rpath_update_trigger_->Set();
 }
 
+//
+// Add a ResolverNexthop to the nexthop update list and start Task to process
+// the list. The dependent ResolverPaths get added to the update list when the
+// Task runs.
+//
+void PathResolverPartition::TriggerResolverNexthop(ResolverNexthop *rnexthop) {
+    CHECK_CONCURRENCY("bgp::ResolverNexthop");
+
+    rnexthop_update_list_.insert(rnexthop);
+    rpath_update_trigger_->Set();
+}
+
+//
+// Remove a ResolverNexthop from the nexthop update list.
+// Called when the ResolverNexthop is removed from the PathResolver.
+//
+void PathResolverPartition::RemoveResolverNexthop(ResolverNexthop *rnexthop) {
+    CHECK_CONCURRENCY("bgp::Config");
+
+    rnexthop_update_list_.erase(rnexthop);
+}
+
 //
 // Create a new ResolverPath for the BgpPath.
 // The ResolverPath is inserted into the map.
@@ -548,19 +574,35 @@ ResolverPath *PathResolverPartition::RemoveResolverPath(const BgpPath *path) {
 }
 
 //
-// Handle processing of all ResolverPaths on the update list.
+// Handle processing of ResolverPaths on the update list.
+//
+// First merge the ResolverPaths that depend on ResolverNexthops on the nexthop
+// update list into the update list.  Then process up to kMaxResolverPathUpdates
+// ResolverPaths. Return false to get rescheduled if the update list is still
+// not empty.
 //
 bool PathResolverPartition::ProcessResolverPathUpdateList() {
     CHECK_CONCURRENCY("bgp::ResolverPath");
 
-    for (ResolverPathList::iterator it = rpath_update_list_.begin();
-         it != rpath_update_list_.end(); ++it) {
+    for (ResolverNexthopList::iterator it = rnexthop_update_list_.begin();
+         it != rnexthop_update_list_.end(); ++it) {
+        const ResolverNexthop *rnexthop = *it;
+        const ResolverNexthop::ResolverPathList &rpath_list =
+            rnexthop->rpath_list(part_id_);
+        rpath_update_list_.insert(rpath_list.begin(), rpath_list.end());
+    }
+    rnexthop_update_list_.clear();
+
+    int count = 0;
+    ResolverPathList::iterator it = rpath_update_list_.begin();
+    while (it != rpath_update_list_.end() && count < kMaxResolverPathUpdates) {
         ResolverPath *rpath = *it;
+        rpath_update_list_.erase(it++);
         if (rpath->UpdateResolvedPaths())
             delete rpath;
+        count++;
     }
-    rpath_update_list_.clear();
-    return true;
+    return rpath_update_list_.empty();
 }
 
 //
@@ -580,11 +622,23 @@ void PathResolverPartition::EnableResolverPathUpdateProcessing() {
 }
 
 //
-// Get size of the update list.
+// Get number of ResolverPaths pending update, including the ones that depend
+// on ResolverNexthops on the nexthop update list.
 // For testing only.
 //
 size_t PathResolverPartition::GetResolverPathUpdateListSize() const {
-    return rpath_update_list_.size();
+    if (rnexthop_update_list_.empty())
+        return rpath_update_list_.size();
+
+    ResolverPathList rpath_list = rpath_update_list_;
+    for (ResolverNexthopList::const_iterator it =
+         rnexthop_update_list_.begin(); it != rnexthop_update_list_.end();
+         ++it) {
+        const ResolverNexthop *rnexthop = *it;
+        rpath_list.insert(rnexthop->rpath_list(part_id_).begin(),
+            rnexthop->rpath_list(part_id_).end());
+    }
+    return rpath_list.size();
 }
 
 //
@@ -946,18 +1000,19 @@ void ResolverNexthop::RemoveResolverPath(int part_id, ResolverPath *rpath) {
 
 //
 // Trigger update of resolved BgpPaths for all ResolverPaths that depend on
-// the ResolverNexthop. Actual update of the resolved BgpPaths happens when
-// the PathResolverPartitions process their update lists.
+// the ResolverNexthop. The ResolverNexthop is added to the nexthop update
+// list of each PathResolverPartition that has dependent ResolverPaths. The
+// dependent ResolverPaths get added to the update list and their resolved
+// BgpPaths get updated when the PathResolverPartitions process their update
+// lists. This happens concurrently in all the partitions.
 //
-void ResolverNexthop::TriggerAllResolverPaths() const {
+void ResolverNexthop::TriggerAllResolverPaths() {
     CHECK_CONCURRENCY("bgp::ResolverNexthop");
 
     for (int part_id = 0; part_id < DB::PartitionCount(); ++part_id) {
-        for (ResolverPathList::iterator it = rpath_lists_[part_id].begin();
-             it != rpath_lists_[part_id].end(); ++it) {
-            ResolverPath *rpath = *it;
-            resolver_->GetPartition(part_id)->TriggerPathResolution(rpath);
-        }
+        if (rpath_lists_[part_id].empty())
+            continue;
+        resolver_->GetPartition(part_id)->TriggerResolverNexthop(this);
     }
 }
 
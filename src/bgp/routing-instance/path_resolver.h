@@ -61,8 +61,10 @@ class TaskTrigger;
 // after the list is processed again.
 //
 // The update list is processed in the context of bgp::ResolverNexthop Task.
-// When an entry on this list is processed all it's dependent ResolverPaths
-// are queued for re-evaluation in the PathResolverPartition.
+// When an entry on this list is processed it's queued for re-evaluation in
+// each PathResolverPartition that has dependent ResolverPaths. Work done in
+// the bgp::ResolverNexthop Task is thus proportional to the number of changed
+// ResolverNexthops, not the number of dependent ResolverPaths.
 //
 // Concurrency Notes:
 //
@@ -160,6 +162,14 @@ private:
 // ResolverPath class. The list is processed in context of bgp::ResolverPath
 // Task with the partition index as the Task instance id. This allows all the
 // PathResolverPartitions to work concurrently.
+//
+// The nexthop update list contains ResolverNexthops whose BgpRoute changed.
+// Before the update list is processed, the ResolverPaths in the partition
+// that depend on these ResolverNexthops are merged into the update list.
+// Since both lists are sets, a ResolverNexthop that changes many times or a
+// ResolverPath that's triggered via multiple means is processed only once.
+// The update list is processed in batches of kMaxResolverPathUpdates so that
+// a ResolverNexthop with a large number of dependents does not hog the CPU.
 
 // Mutual exclusion of db::DBTable and bgp::ResolverPath Tasks ensures that
 // it's safe to add/delete/update resolved BgpPaths from the bgp::ResolverPath
@@ -168,6 +178,8 @@ private:
 //
 class PathResolverPartition {
 public:
+    static const int kMaxResolverPathUpdates = 1024;
+
     PathResolverPartition(int part_id, PathResolver *resolver);
     ~PathResolverPartition();
 
@@ -176,6 +188,8 @@ public:
     void StopPathResolution(const BgpPath *path);
 
     void TriggerPathResolution(ResolverPath *rpath);
+    void TriggerResolverNexthop(ResolverNexthop *rnexthop);
+    void RemoveResolverNexthop(ResolverNexthop *rnexthop);
 
     int part_id() const { return part_id_; }
     DBTableBase::ListenerId listener_id() const {
@@ -192,6 +206,7 @@ private:
 
     typedef std::map<const BgpPath *, ResolverPath *> PathToResolverPathMap;
     typedef std::set<ResolverPath *> ResolverPathList;
+    typedef std::set<ResolverNexthop *> ResolverNexthopList;
 
     ResolverPath *CreateResolverPath(const BgpPath *path, BgpRoute *route,
         ResolverNexthop *rnexthop);
@@ -207,6 +222,7 @@ private:
     PathResolver *resolver_;
     PathToResolverPathMap rpath_map_;
     ResolverPathList rpath_update_list_;
+    ResolverNexthopList rnexthop_update_list_;
     boost::scoped_ptr<TaskTrigger> rpath_update_trigger_;
 
     DISALLOW_COPY_AND_ASSIGN(PathResolverPartition);
@@ -324,7 +340,9 @@ private:
 // the IP address being tracked, the ResolverNexthop is added to the update
 // list in the PathResolver. The PathResolver processes the entries in this
 // list in the context of the bgp::ResolverNexthop Task. The action is to
-// trigger re-evaluation of all ResolverPaths that use the ResolverNexthop.
+// trigger re-evaluation of the ResolverNexthop in each PathResolverPartition
+// with ResolverPaths that use it.  The PathResolverPartition then uses the
+// ResolverPathList for the partition to find the ResolverPaths to update.
 //
 // When the last ResolverPath in a partition using a ResolverNexthop gets
 // removed, the ResolverNexthop is added to the registration/unregistration
@@ -348,6 +366,8 @@ private:
 //
 class ResolverNexthop : public ConditionMatch {
 public:
+    typedef std::set<ResolverPath *> ResolverPathList;
+
     ResolverNexthop(PathResolver *resolver, IpAddress address);
     virtual ~ResolverNexthop();
 
@@ -357,17 +377,18 @@ public:
     void AddResolverPath(int part_id, ResolverPath *rpath);
     void RemoveResolverPath(int part_id, ResolverPath *rpath);
 
-    void TriggerAllResolverPaths() const;
+    void TriggerAllResolverPaths();
 
     IpAddress address() const { return address_; }
     const BgpRoute *route() { return route_; }
+    const ResolverPathList &rpath_list(int part_id) const {
+        return rpath_lists_[part_id];
+    }
     bool empty() const;
     bool registered() const { return registered_; }
     void set_registered() { registered_ = true; }
 
 private:
-    typedef std::set<ResolverPath *> ResolverPathList;
-
     PathResolver *resolver_;
     IpAddress address_;
     bool registered_;
@@ -8,6 +8,7 @@
 
 #include <algorithm>
 
+#include "base/task.h"
 #include "base/task_annotations.h"
 #include "bgp/bgp_log.h"
 #include "bgp/bgp_peer_membership.h"
@@ -250,13 +251,26 @@ string ServiceChain<T>::ToString() const {
     return (string("ServiceChain " ) + service_chain_addr_.to_string());
 }
 
+//
+// Set the connected route and take a snapshot of the forwarding information
+// of its ECMP paths. The part of the service chain path attributes that does
+// not depend on the original route is computed here once for all the service
+// chain routes.
+//
 template <typename T>
 void ServiceChain<T>::SetConnectedRoute(BgpRoute *connected) {
     connected_route_ = connected;
     connected_path_ids_.clear();
+    connected_paths_.clear();
     if (!connected_route_)
         return;
 
+    BgpTable *bgptable = src_table();
+    BgpServer *server = src_->server();
+    BgpAttrDB *attr_db = server->attr_db();
+    ExtCommunityDB *extcomm_db = server->extcomm_db();
+    PeerRibMembershipManager *membership_mgr = server->membership_mgr();
+
     for (Route::PathList::iterator it = connected->GetPathList().begin();
         it != connected->GetPathList().end(); ++it) {
         BgpPath *path = static_cast<BgpPath *>(it.operator->());
@@ -272,6 +286,63 @@ void ServiceChain<T>::SetConnectedRoute(BgpRoute *connected) {
         // Use nexthop attribute of connected path as path id.
         uint32_t path_id = path->GetAttr()->nexthop().to_v4().to_ulong();
         connected_path_ids_.insert(path_id);
+
+        // Skip paths with duplicate forwarding information.  This ensures
+        // that we generate only one path with any given next hop and label
+        // when there are multiple connected paths from the original source
+        // received via different peers e.g. directly via XMPP and via BGP.
+        if (connected_route_->DuplicateForwardingPath(path))
+            continue;
+
+        // Strip any RouteTargets from the connected attributes.
+        const BgpAttr *attr = path->GetAttr();
+        ExtCommunityPtr new_ext_community =
+            extcomm_db->ReplaceRTargetAndLocate(
+                attr->ext_community(), ExtCommunity::ExtCommunityList());
+        BgpAttrPtr new_attr = attr_db->ReplaceExtCommunityAndLocate(
+            attr, new_ext_community);
+
+        // Strip aspath. This is required when the connected route is
+        // learnt via BGP.
+        new_attr = attr_db->ReplaceAsPathAndLocate(new_attr.get(), AsPathPtr());
+
+        // If the connected path is learnt via XMPP, construct RD based on
+        // the id registered with source table instead of connected table.
+        // This allows chaining of multiple in-network service instances
+        // that are on the same compute node.
+        const IPeer *peer = path->GetPeer();
+        if (src_ != connected_ && peer && peer->IsXmppPeer()) {
+            int id = membership_mgr->GetRegistrationId(peer, bgptable);
+            if (id < 0)
+                continue;
+            RouteDistinguisher connected_rd = attr->source_rd();
+            if (connected_rd.Type() != RouteDistinguisher::TypeIpAddressBased)
+                continue;
+            RouteDistinguisher rd(connected_rd.GetAddress(), id);
+            new_attr = attr_db->ReplaceSourceRdAndLocate(new_attr.get(), rd);
+        }
+
+        // Replace the source rd if the connected path is a secondary path
+        // of a primary path in the l3vpn table. Use the RD of the primary.
+        if (path->IsReplicated()) {
+            const BgpSecondaryPath *spath =
+                static_cast<const BgpSecondaryPath *>(path);
+            const RoutingInstance *ri = spath->src_table()->routing_instance();
+            if (ri->IsDefaultRoutingInstance()) {
+                const VpnRouteT *vpn_route =
+                    static_cast<const VpnRouteT *>(spath->src_rt());
+                new_attr = attr_db->ReplaceSourceRdAndLocate(new_attr.get(),
+                    vpn_route->GetPrefix().route_distinguisher());
+            }
+        }
+
+        ConnectedPathInfo info;
+        info.path_id = path_id;
+        info.attr = new_attr;
+        info.flags = path->GetFlags();
+        info.label = path->GetLabel();
+        info.load_balance = LoadBalance::IsPresent(path);
+        connected_paths_.push_back(info);
     }
 }
 
@@ -325,10 +396,14 @@ void ServiceChain<T>::RemoveMatchState(BgpRoute *route,
     }
 }
 
-// RemoveServiceChainRoute
+//
+// Concurrency: bgp::ServiceChain task, or db::DBTable task for the partition
+// of the route when updated by a PartitionWorker.
+//
 template <typename T>
-void ServiceChain<T>::RemoveServiceChainRoute(PrefixT prefix, bool aggregate) {
-    CHECK_CONCURRENCY("bgp::ServiceChain");
+void ServiceChain<T>::RemoveServiceChainRoute(PrefixT prefix,
+    const ConnectedPathIdList &path_ids, bool aggregate) {
+    CHECK_CONCURRENCY("bgp::ServiceChain", "db::DBTable");
 
     BgpTable *bgptable = src_table();
     RouteT rt_key(prefix);
@@ -340,8 +415,8 @@ void ServiceChain<T>::RemoveServiceChainRoute(PrefixT prefix, bool aggregate) {
     if (!service_chain_route || service_chain_route->IsDeleted())
         return;
 
-    for (ConnectedPathIdList::const_iterator it = GetConnectedPathIds().begin();
-         it != GetConnectedPathIds().end(); ++it) {
+    for (ConnectedPathIdList::const_iterator it = path_ids.begin();
+         it != path_ids.end(); ++it) {
         uint32_t path_id = *it;
         service_chain_route->RemovePath(BgpPath::ServiceChain, NULL, path_id);
         BGP_LOG_STR(BgpMessage, SandeshLevel::SYS_DEBUG, BGP_LOG_FLAG_TRACE,
@@ -358,12 +433,19 @@ void ServiceChain<T>::RemoveServiceChainRoute(PrefixT prefix, bool aggregate) {
     }
 }
 
-// AddServiceChainRoute
+//
+// Concurrency: bgp::ServiceChain task, or db::DBTable task for the partition
+// of the route when updated by a PartitionWorker.
+//
+// Paths are built from the snapshot of the connected paths. The original
+// route, if any, is in the same partition of the destination table as the
+// service chain route is in the source table.
+//
 template <typename T>
 void ServiceChain<T>::AddServiceChainRoute(PrefixT prefix,
     const RouteT *orig_route, const ConnectedPathIdList &old_path_ids,
     bool aggregate) {
-    CHECK_CONCURRENCY("bgp::ServiceChain");
+    CHECK_CONCURRENCY("bgp::ServiceChain", "db::DBTable");
 
     BgpTable *bgptable = src_table();
     RouteT rt_key(prefix);
@@ -420,42 +502,20 @@ void ServiceChain<T>::AddServiceChainRoute(PrefixT prefix,
     CommunityPtr new_community =
         comm_db->AppendAndLocate(orig_community, Community::AcceptOwn);
     ExtCommunityDB *extcomm_db = server->extcomm_db();
-    PeerRibMembershipManager *membership_mgr = server->membership_mgr();
     OriginVnPathDB *ovnpath_db = server->ovnpath_db();
     OriginVnPathPtr new_ovnpath =
         ovnpath_db->PrependAndLocate(orig_ovnpath, origin_vn.GetExtCommunity());
 
     ConnectedPathIdList new_path_ids;
-    for (Route::PathList::iterator it =
-         connected_route()->GetPathList().begin();
-         it != connected_route()->GetPathList().end(); ++it) {
-        BgpPath *connected_path = static_cast<BgpPath *>(it.operator->());
-
-        // Infeasible paths are not considered
-        if (!connected_path->IsFeasible())
-            break;
-
-        // take snapshot of all ECMP paths
-        if (connected_route()->BestPath()->PathCompare(*connected_path, true))
-            break;
-
-        // Skip paths with duplicate forwarding information.  This ensures
-        // that we generate only one path with any given next hop and label
-        // when there are multiple connected paths from the original source
-        // received via different peers e.g. directly via XMPP and via BGP.
-        if (connected_route()->DuplicateForwardingPath(connected_path))
-            continue;
-
-        const BgpAttr *attr = connected_path->GetAttr();
+    for (typename ConnectedPathInfoList::const_iterator it =
+         connected_paths_.begin(); it != connected_paths_.end(); ++it) {
+        const ConnectedPathInfo &connected_path = *it;
+        const BgpAttr *attr = connected_path.attr.get();
         ExtCommunityPtr new_ext_community;
 
-        // Strip any RouteTargets from the connected attributes.
-        new_ext_community = extcomm_db->ReplaceRTargetAndLocate(
-            attr->ext_community(), ExtCommunity::ExtCommunityList());
-
         // Replace the SGID list with the list from the original route.
         new_ext_community = extcomm_db->ReplaceSGIDListAndLocate(
-            new_ext_community.get(), sgid_list);
+            attr->ext_community(), sgid_list);
 
         // Replace SiteOfOrigin with value from original route if any.
         if (soo.IsNull()) {
@@ -468,7 +528,7 @@ void ServiceChain<T>::AddServiceChainRoute(PrefixT prefix,
 
         // Inherit load balance attribute of orig_route if connected path
         // does not have one already.
-        if (!LoadBalance::IsPresent(connected_path) && load_balance_present) {
+        if (!connected_path.load_balance && load_balance_present) {
             new_ext_community = extcomm_db->AppendAndLocate(
                     new_ext_community.get(), load_balance.GetExtCommunity());
         }
@@ -486,43 +546,8 @@ void ServiceChain<T>::AddServiceChainRoute(PrefixT prefix,
         new_attr = attr_db->ReplaceOriginVnPathAndLocate(new_attr.get(),
             new_ovnpath);
 
-        // Strip aspath. This is required when the connected route is
-        // learnt via BGP.
-        new_attr = attr_db->ReplaceAsPathAndLocate(new_attr.get(), AsPathPtr());
-
-        // If the connected path is learnt via XMPP, construct RD based on
-        // the id registered with source table instead of connected table.
-        // This allows chaining of multiple in-network service instances
-        // that are on the same compute node.
-        const IPeer *peer = connected_path->GetPeer();
-        if (src_ != connected_ && peer && peer->IsXmppPeer()) {
-            int id = membership_mgr->GetRegistrationId(peer, bgptable);
-            if (id < 0)
-                continue;
-            RouteDistinguisher connected_rd = attr->source_rd();
-            if (connected_rd.Type() != RouteDistinguisher::TypeIpAddressBased)
-                continue;
-            RouteDistinguisher rd(connected_rd.GetAddress(), id);
-            new_attr = attr_db->ReplaceSourceRdAndLocate(new_attr.get(), rd);
-        }
-
-        // Replace the source rd if the connected path is a secondary path
-        // of a primary path in the l3vpn table. Use the RD of the primary.
-        if (connected_path->IsReplicated()) {
-            const BgpSecondaryPath *spath =
-                static_cast<const BgpSecondaryPath *>(connected_path);
-            const RoutingInstance *ri = spath->src_table()->routing_instance();
-            if (ri->IsDefaultRoutingInstance()) {
-                const VpnRouteT *vpn_route =
-                    static_cast<const VpnRouteT *>(spath->src_rt());
-                new_attr = attr_db->ReplaceSourceRdAndLocate(new_attr.get(),
-                    vpn_route->GetPrefix().route_distinguisher());
-            }
-        }
-
         // Check whether we already have a path with the associated path id.
-        uint32_t path_id =
-            connected_path->GetAttr()->nexthop().to_v4().to_ulong();
+        uint32_t path_id = connected_path.path_id;
         BgpPath *existing_path =
             service_chain_route->FindPath(BgpPath::ServiceChain, NULL,
                                           path_id);
@@ -531,7 +556,7 @@ void ServiceChain<T>::AddServiceChainRoute(PrefixT prefix,
         if (existing_path != NULL) {
             // Existing path can be reused.
             if ((new_attr.get() == existing_path->GetAttr()) &&
-                (connected_path->GetLabel() == existing_path->GetLabel())) {
+                (connected_path.label == existing_path->GetLabel())) {
                 new_path_ids.insert(path_id);
                 continue;
             }
@@ -545,7 +570,7 @@ void ServiceChain<T>::AddServiceChainRoute(PrefixT prefix,
 
         BgpPath *new_path =
             new BgpPath(path_id, BgpPath::ServiceChain, new_attr.get(),
-                        connected_path->GetFlags(), connected_path->GetLabel());
+                        connected_path.flags, connected_path.label);
         if (is_stale)
             new_path->SetStale();
 
@@ -715,7 +740,8 @@ bool ServiceChainMgr<T>::RequestHandler(ServiceChainRequestT *req) {
             assert(state);
             if (info->DeleteMoreSpecific(aggregate_match, route)) {
                 // Delete the aggregate route
-                info->RemoveServiceChainRoute(aggregate_match, true);
+                info->RemoveServiceChainRoute(
+                    aggregate_match, info->GetConnectedPathIds(), true);
             }
             info->RemoveMatchState(route, state);
             break;
@@ -736,45 +762,20 @@ bool ServiceChainMgr<T>::RequestHandler(ServiceChainRequestT *req) {
                 info->GetConnectedPathIds();
             info->SetConnectedRoute(route);
 
-            typename ServiceChainT::PrefixToRouteListMap *vnprefix_list =
-                info->prefix_to_route_list_map();
-            for (typename ServiceChainT::PrefixToRouteListMap::iterator it =
-                 vnprefix_list->begin(); it != vnprefix_list->end(); ++it) {
-                // Add aggregate route.. Or if the route exists
-                // sync the path and purge old paths
-                if (!it->second.empty())
-                    info->AddServiceChainRoute(it->first, NULL, path_ids, true);
-            }
-
-            for (typename ServiceChainT::ExtConnectRouteList::iterator it =
-                 info->ext_connecting_routes()->begin();
-                 it != info->ext_connecting_routes()->end(); ++it) {
-                // Add ServiceChain route for external connecting route
-                RouteT *ext_route = static_cast<RouteT *>(*it);
-                info->AddServiceChainRoute(
-                    ext_route->GetPrefix(), ext_route, path_ids, false);
-            }
+            // Add or sync aggregate routes and ServiceChain routes for
+            // external connecting routes, and purge old paths.
+            UpdateServiceChainRoutes(info, path_ids, false);
             break;
         }
         case ServiceChainRequestT::CONNECTED_ROUTE_DELETE: {
             assert(state);
-            // Delete ServiceChain route for aggregate.
-            typename ServiceChainT::PrefixToRouteListMap *vnprefix_list =
-                info->prefix_to_route_list_map();
-            for (typename ServiceChainT::PrefixToRouteListMap::iterator it =
-                vnprefix_list->begin(); it != vnprefix_list->end(); ++it) {
-                info->RemoveServiceChainRoute(it->first, true);
-            }
-
-            // Delete ServiceChain routes for external connecting routes.
-            for (typename ServiceChainT::ExtConnectRouteList::iterator it =
-                 info->ext_connecting_routes()->begin();
-                 it != info->ext_connecting_routes()->end(); ++it) {
-                RouteT *ext_route = static_cast<RouteT *>(*it);
-                info->RemoveServiceChainRoute(ext_route->GetPrefix(), false);
-            }
-            info->RemoveMatchState(route, state);
+            // Delete ServiceChain routes for aggregates and for external
+            // connecting routes.
+            typename ServiceChainT::ConnectedPathIdList path_ids =
+                info->GetConnectedPathIds();
             info->SetConnectedRoute(NULL);
+            UpdateServiceChainRoutes(info, path_ids, true);
+            info->RemoveMatchState(route, state);
             break;
         }
         case ServiceChainRequestT::EXT_CONNECT_ROUTE_ADD_CHG: {
@@ -795,7 +796,8 @@ bool ServiceChainMgr<T>::RequestHandler(ServiceChainRequestT *req) {
             assert(state);
             if (info->ext_connecting_routes()->erase(route)) {
                 RouteT *inet_route = dynamic_cast<RouteT *>(route);
-                info->RemoveServiceChainRoute(inet_route->GetPrefix(), false);
+                info->RemoveServiceChainRoute(inet_route->GetPrefix(),
+                    info->GetConnectedPathIds(), false);
             }
             info->RemoveMatchState(route, state);
             break;
@@ -808,27 +810,12 @@ bool ServiceChainMgr<T>::RequestHandler(ServiceChainRequestT *req) {
             if (!info->connected_route())
                 break;
 
+            // Registration ids of the peers of the connected paths may have
+            // changed, take a new snapshot of the connected route.
             typename ServiceChainT::ConnectedPathIdList path_ids =
                 info->GetConnectedPathIds();
-            typename ServiceChainT::PrefixToRouteListMap *vnprefix_list =
-                info->prefix_to_route_list_map();
-            for (typename ServiceChainT::PrefixToRouteListMap::iterator it =
-                 vnprefix_list->begin(); it != vnprefix_list->end(); ++it) {
-                // Add aggregate route.. Or if the route exists
-                // sync the path and purge old paths
-                if (!it->second.empty())
-                    info->AddServiceChainRoute(
-                        it->first, NULL, path_ids, true);
-            }
-
-            for (typename ServiceChainT::ExtConnectRouteList::iterator it =
-                 info->ext_connecting_routes()->begin();
-                 it != info->ext_connecting_routes()->end(); ++it) {
-                // Add ServiceChain route for external connecting route
-                RouteT *ext_route = static_cast<RouteT *>(*it);
-                info->AddServiceChainRoute(
-                    ext_route->GetPrefix(), ext_route, path_ids, false);
-            }
+            info->SetConnectedRoute(info->connected_route());
+            UpdateServiceChainRoutes(info, path_ids, false);
             break;
         }
         case ServiceChainRequestT::STOP_CHAIN_DONE: {
@@ -877,7 +864,156 @@ bool ServiceChainMgr<T>::RequestHandler(ServiceChainRequestT *req) {
         }
     }
     delete req;
-    return true;
+
+    // Hold the queue if a batch of updates was started.
+    return BatchDone();
+}
+
+//
+// Task that updates the service chain routes of a chain in a partition of
+// the source table, after a change to the connected route of the chain. It
+// runs in the db::DBTable task for the partition, so that the partitions are
+// updated in parallel, and yields after every kMaxIterations routes.
+//
+// The external connecting routes are in the same partition of the dest table
+// as the service chain routes are in the source table, since the tables hash
+// prefixes the same way.
+//
+template <typename T>
+class ServiceChainMgr<T>::PartitionWorker : public Task {
+public:
+    typedef typename ServiceChainT::ConnectedPathIdList ConnectedPathIdList;
+
+    PartitionWorker(ServiceChainMgr *manager, ServiceChainT *chain,
+                    int part_id, const ConnectedPathIdList &old_path_ids,
+                    bool remove)
+        : Task(TaskScheduler::GetInstance()->GetTaskId("db::DBTable"),
+               part_id),
+          manager_(manager),
+          chain_ref_(chain),
+          chain_(chain),
+          old_path_ids_(old_path_ids),
+          remove_(remove),
+          aggregate_index_(0),
+          route_index_(0) {
+    }
+
+    void AddAggregate(const PrefixT &prefix) {
+        aggregates_.push_back(prefix);
+    }
+    void AddExtConnectRoute(RouteT *route) {
+        ext_routes_.push_back(route);
+    }
+    bool empty() const {
+        return aggregates_.empty() && ext_routes_.empty();
+    }
+
+    virtual bool Run() {
+        CHECK_CONCURRENCY("db::DBTable");
+
+        for (int count = 0; count < DBTablePartBase::kMaxIterations; ++count) {
+            if (aggregate_index_ < aggregates_.size()) {
+                const PrefixT &prefix = aggregates_[aggregate_index_++];
+                if (remove_) {
+                    chain_->RemoveServiceChainRoute(prefix, old_path_ids_,
+                        true);
+                } else {
+                    chain_->AddServiceChainRoute(prefix, NULL, old_path_ids_,
+                        true);
+                }
+            } else if (route_index_ < ext_routes_.size()) {
+                RouteT *ext_route = ext_routes_[route_index_++];
+                if (remove_) {
+                    chain_->RemoveServiceChainRoute(ext_route->GetPrefix(),
+                        old_path_ids_, false);
+                } else {
+                    chain_->AddServiceChainRoute(ext_route->GetPrefix(),
+                        ext_route, old_path_ids_, false);
+                }
+            } else {
+                manager_->PartitionWorkerDone();
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    ServiceChainMgr *manager_;
+    ServiceChainPtr chain_ref_;
+    ServiceChainT *chain_;
+    ConnectedPathIdList old_path_ids_;
+    bool remove_;
+    std::vector<PrefixT> aggregates_;
+    std::vector<RouteT *> ext_routes_;
+    size_t aggregate_index_;
+    size_t route_index_;
+
+    DISALLOW_COPY_AND_ASSIGN(PartitionWorker);
+};
+
+//
+// Concurrency: bgp::ServiceChain task.
+//
+// Add, sync or remove the service chain routes for the aggregates and the
+// external connecting routes of the chain in one pass over each partition
+// of the source table. The request queue is held till all PartitionWorkers
+// are done, so that the chain doesn't change in the meantime.
+//
+template <typename T>
+void ServiceChainMgr<T>::UpdateServiceChainRoutes(ServiceChainT *chain,
+    const typename ServiceChainT::ConnectedPathIdList &old_path_ids,
+    bool remove) {
+    CHECK_CONCURRENCY("bgp::ServiceChain");
+
+    BgpTable *table = chain->src_table();
+    vector<PartitionWorker *> workers;
+    for (int part_id = 0; part_id < table->PartitionCount(); ++part_id) {
+        workers.push_back(
+            new PartitionWorker(this, chain, part_id, old_path_ids, remove));
+    }
+
+    // Aggregates without any more specific routes are only removed.
+    typename ServiceChainT::PrefixToRouteListMap *vnprefix_list =
+        chain->prefix_to_route_list_map();
+    for (typename ServiceChainT::PrefixToRouteListMap::iterator it =
+         vnprefix_list->begin(); it != vnprefix_list->end(); ++it) {
+        if (!remove && it->second.empty())
+            continue;
+        RouteT rt_key(it->first);
+        int part_id = table->GetTablePartition(&rt_key)->index();
+        workers[part_id]->AddAggregate(it->first);
+    }
+
+    for (typename ServiceChainT::ExtConnectRouteList::iterator it =
+         chain->ext_connecting_routes()->begin();
+         it != chain->ext_connecting_routes()->end(); ++it) {
+        RouteT *ext_route = static_cast<RouteT *>(*it);
+        int part_id = table->GetTablePartition(ext_route)->index();
+        workers[part_id]->AddExtConnectRoute(ext_route);
+    }
+
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    for (typename vector<PartitionWorker *>::iterator it = workers.begin();
+         it != workers.end(); ++it) {
+        if ((*it)->empty()) {
+            delete *it;
+            continue;
+        }
+        batch_workers_++;
+        scheduler->Enqueue(*it);
+    }
+}
+
+//
+// Concurrency: db::DBTable task.
+//
+// Resume the request queue when the last PartitionWorker of a batch is done.
+//
+template <typename T>
+void ServiceChainMgr<T>::PartitionWorkerDone() {
+    if (batch_workers_.fetch_and_decrement() == 1)
+        process_queue_->MayBeStartRunner();
 }
 
 template <typename T>
@@ -896,6 +1032,9 @@ ServiceChainMgr<T>::ServiceChainMgr(BgpServer *server)
     process_queue_ =
         new WorkQueue<ServiceChainRequestT *>(service_chain_task_id_, 0,
                      bind(&ServiceChainMgr::RequestHandler, this, _1));
+    process_queue_->SetStartRunnerFunc(
+        bind(&ServiceChainMgr::BatchDone, this));
+    batch_workers_ = 0;
 
     id_ = server->routing_instance_mgr()->RegisterInstanceOpCallback(
         bind(&ServiceChainMgr::RoutingInstanceCallback, this, _1, _2));
@@ -6,6 +6,7 @@
 #define SRC_BGP_ROUTING_INSTANCE_SERVICE_CHAINING_H_
 
 #include <boost/shared_ptr.hpp>
+#include <tbb/atomic.h>
 
 #include <list>
 #include <map>
@@ -15,6 +16,7 @@
 
 #include "base/lifetime.h"
 #include "base/queue_task.h"
+#include "bgp/bgp_attr.h"
 #include "bgp/bgp_condition_listener.h"
 #include "bgp/inet/inet_route.h"
 #include "bgp/inet6/inet6_route.h"
@@ -128,6 +130,19 @@ public:
     // List of path ids for the connected route
     typedef std::set<uint32_t> ConnectedPathIdList;
 
+    // Forwarding information of a connected path that is used for all the
+    // service chain routes. Taken when the connected route is set, so that
+    // service chain routes can be updated from the partition tasks without
+    // looking at the connected route.
+    struct ConnectedPathInfo {
+        uint32_t path_id;
+        BgpAttrPtr attr;
+        uint32_t flags;
+        uint32_t label;
+        bool load_balance;
+    };
+    typedef std::vector<ConnectedPathInfo> ConnectedPathInfoList;
+
     ServiceChain(ServiceChainMgrT *manager, RoutingInstance *src,
                  RoutingInstance *dest, RoutingInstance *connected,
                  const std::vector<std::string> &subnets, AddressT addr);
@@ -153,7 +168,8 @@ public:
 
     void AddServiceChainRoute(PrefixT prefix, const RouteT *orig_route,
         const ConnectedPathIdList &old_path_ids, bool aggregate);
-    void RemoveServiceChainRoute(PrefixT prefix, bool aggregate);
+    void RemoveServiceChainRoute(PrefixT prefix,
+        const ConnectedPathIdList &path_ids, bool aggregate);
 
     bool AddMoreSpecific(PrefixT aggregate, BgpRoute *more_specific);
     bool DeleteMoreSpecific(PrefixT aggregate, BgpRoute *more_specific);
@@ -207,6 +223,7 @@ private:
     RoutingInstance *dest_;
     RoutingInstance *connected_;
     ConnectedPathIdList connected_path_ids_;
+    ConnectedPathInfoList connected_paths_;
     BgpRoute *connected_route_;
     AddressT service_chain_addr_;
     PrefixToRouteListMap prefix_to_routelist_map_;
@@ -248,7 +265,9 @@ public:
     virtual size_t PendingQueueSize() const { return pending_chains_.size(); }
     virtual size_t ResolvedQueueSize() const { return chain_set_.size(); }
     virtual uint32_t GetDownServiceChainCount() const;
-    virtual bool IsQueueEmpty() const { return process_queue_->IsQueueEmpty(); }
+    virtual bool IsQueueEmpty() const {
+        return process_queue_->IsQueueEmpty() && batch_workers_ == 0;
+    }
     virtual bool IsPending(RoutingInstance *rtinstance) const;
 
     Address::Family GetFamily() const;
@@ -259,6 +278,7 @@ public:
 private:
     template <typename U> friend class ServiceChainIntegrationTest;
     template <typename U> friend class ServiceChainTest;
+    class PartitionWorker;
 
     // All service chain related actions are performed in the context
     // of this task. This task has exclusion with db::DBTable task.
@@ -273,6 +293,11 @@ private:
     typedef std::set<RoutingInstance *> PendingServiceChainList;
 
     bool RequestHandler(ServiceChainRequestT *req);
+    void UpdateServiceChainRoutes(ServiceChainT *chain,
+        const typename ServiceChainT::ConnectedPathIdList &old_path_ids,
+        bool remove);
+    void PartitionWorkerDone();
+    bool BatchDone() const { return batch_workers_ == 0; }
     void StopServiceChainDone(BgpTable *table, ConditionMatch *info);
     ServiceChainT *FindServiceChain(const std::string &instance) const;
     ServiceChainT *FindServiceChain(RoutingInstance *rtinstance) const;
@@ -298,6 +323,9 @@ private:
     // Work Queue to handle requests posted from Match function, called
     // in the context of db::DBTable task.
     // The actions are performed in the bgp::ServiceChain task context.
+    // Changes to the connected route update all the service chain routes
+    // of the chain in a batch, with a PartitionWorker for each partition
+    // of the source table. The queue is held until the batch is done.
     virtual void DisableQueue() { process_queue_->set_disable(true); }
     virtual void EnableQueue() { process_queue_->set_disable(false); }
 
@@ -307,6 +335,7 @@ private:
     BgpConditionListener *listener_;
     boost::scoped_ptr<TaskTrigger> resolve_trigger_;
     WorkQueue<ServiceChainRequestT *> *process_queue_;
+    tbb::atomic<int> batch_workers_;
     bool aggregate_host_route_;
     ServiceChainMap chain_set_;
     PendingServiceChainList pending_chains_;
@@ -324,6 +324,54 @@ protected:
         VerifyForwarderCount(tm, group_str, "0.0.0.0", count);
     }
 
+    typedef std::map<std::string, RibOutAttr> ForwarderAttrMap;
+
+    // Get the RibOutAttr advertised for each Native McastForwarder.
+    void GetForwarderAttrs(McastTreeManager *tm, string group_str,
+            ForwarderAttrMap *attr_map) {
+        ConcurrencyScope scope("db::DBTable");
+
+        boost::system::error_code ec;
+        Ip4Address group = Ip4Address::from_string(group_str.c_str(), ec);
+        Ip4Address source = Ip4Address::from_string("0.0.0.0", ec);
+        attr_map->clear();
+        for (McastTreeManager::PartitionList::iterator it =
+             tm->partitions_.begin(); it != tm->partitions_.end(); ++it) {
+            McastSGEntry *sg_entry = (*it)->FindSGEntry(group, source);
+            if (!sg_entry)
+                continue;
+            McastSGEntry::ForwarderSet *forwarders =
+                sg_entry->forwarder_sets_[McastTreeManager::LevelNative];
+            for (McastSGEntry::ForwarderSet::iterator it =
+                 forwarders->begin(); it != forwarders->end(); ++it) {
+                boost::scoped_ptr<UpdateInfo> uinfo(
+                    (*it)->GetUpdateInfo(tm->table_));
+                if (!uinfo)
+                    continue;
+                attr_map->insert(make_pair((*it)->address().to_string(),
+                                           uinfo->roattr));
+            }
+        }
+    }
+
+    // Get the number of Native McastForwarders with a RibOutAttr different
+    // from the one in the attr_map i.e. the number of routes re-advertised.
+    // The attr_map is updated with the current RibOutAttrs.
+    size_t GetChangedForwarderCount(McastTreeManager *tm, string group_str,
+            ForwarderAttrMap *attr_map) {
+        ForwarderAttrMap new_attr_map;
+        GetForwarderAttrs(tm, group_str, &new_attr_map);
+        size_t count = 0;
+        for (ForwarderAttrMap::iterator it = new_attr_map.begin();
+             it != new_attr_map.end(); ++it) {
+            ForwarderAttrMap::iterator old_it = attr_map->find(it->first);
+            if (old_it == attr_map->end() || old_it->second != it->second)
+                count++;
+        }
+        attr_map->swap(new_attr_map);
+        return count;
+    }
+
     size_t VerifyTreeUpdateCount(McastTreeManager *tm) {
         size_t total = 0;
         for (int idx = 0; idx < DB::PartitionCount(); idx++) {
@@ -677,6 +725,67 @@ TEST_F(BgpMulticastTest, TreeUpdateCompression) {
     TASK_UTIL_EXPECT_EQ(6, VerifyTreeUpdateCount(red_tm_));
 }
 
+// Measure the number of routes re-advertised when a single McastForwarder
+// leaves or joins a large tree. Labels of other McastForwarders are stable, so
+// only the McastForwarders that are linked differently should be affected.
+TEST_F(BgpMulticastTest, TreeUpdateChurn) {
+    static const int kForwarderCount = 2000;
+    static const int kIterations = 20;
+    vector<XmppPeerMock *> scale_peers;
+    for (int idx = 0; idx < kForwarderCount; idx++) {
+        std::ostringstream repr;
+        repr << "10.2." << (idx / 250) << "." << (idx % 250 + 1);
+        XmppPeerMock *peer = new XmppPeerMock(&server_, repr.str());
+        scale_peers.push_back(peer);
+        peers_.push_back(peer);
+        peer->AddRoute(red_table_, "192.168.1.255");
+    }
+    task_util::WaitForIdle();
+    VerifyForwarderCount(red_tm_, "192.168.1.255", kForwarderCount);
+
+    ForwarderAttrMap attr_map;
+    GetForwarderAttrs(red_tm_, "192.168.1.255", &attr_map);
+    EXPECT_EQ((size_t) kForwarderCount, attr_map.size());
+
+    size_t leave_max = 0, leave_total = 0;
+    size_t join_max = 0, join_total = 0;
+    for (int idx = 0; idx < kForwarderCount;
+         idx += kForwarderCount / kIterations) {
+        scale_peers[idx]->DelRoute(red_table_, "192.168.1.255");
+        task_util::WaitForIdle();
+        size_t count =
+            GetChangedForwarderCount(red_tm_, "192.168.1.255", &attr_map);
+        EXPECT_EQ((size_t) kForwarderCount - 1, attr_map.size());
+        leave_max = std::max(leave_max, count);
+        leave_total += count;
+
+        scale_peers[idx]->AddRoute(red_table_, "192.168.1.255");
+        task_util::WaitForIdle();
+        count = GetChangedForwarderCount(red_tm_, "192.168.1.255", &attr_map);
+        EXPECT_EQ((size_t) kForwarderCount, attr_map.size());
+        join_max = std::max(join_max, count);
+        join_total += count;
+    }
+    VerifyForwarderCount(red_tm_, "192.168.1.255", kForwarderCount);
+
+    // A leave affects the parent and children of the McastForwarder, the
+    // last McastForwarder that fills the hole and it's previous parent.  A
+    // join affects the new McastForwarder and it's parent.
+    EXPECT_LE(leave_max, (size_t) McastTreeManager::kDegree + 3);
+    EXPECT_LE(join_max, 2U);
+    BGP_DEBUG_UT("Routes re-advertised for " << kIterations <<
+        " leaves: max " << leave_max << " total " << leave_total);
+    BGP_DEBUG_UT("Routes re-advertised for " << kIterations <<
+        " joins: max " << join_max << " total " << join_total);
+
+    for (int idx = 0; idx < kForwarderCount; idx++) {
+        scale_peers[idx]->DelRoute(red_table_, "192.168.1.255");
+    }
+    task_util::WaitForIdle();
+    VerifyRouteCount(red_table_, 0);
+    VerifySGCount(red_tm_, 0);
+}
+
 int main(int argc, char **argv) {
     bgp_log_test::init();
     ::testing::InitGoogleTest(&argc, argv);
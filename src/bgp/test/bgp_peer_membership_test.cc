@@ -4,6 +4,7 @@
 #include <boost/uuid/random_generator.hpp>
 
 #include "base/task_annotations.h"
+#include "base/time_util.h"
 #include "control-node/control_node.h"
 #include "bgp/inet/inet_table.h"
 #include "bgp/bgp_factory.h"
@@ -23,7 +24,8 @@ public:
                 const BgpNeighborConfig *config)
        : BgpPeer(server, instance, config),
          policy_(BgpProto::IBGP, RibExportPolicy::BGP, -1, 0),
-         index_(gbl_index++) {
+         index_(gbl_index++),
+         ready_(false) {
     }
 
     virtual ~BgpTestPeer() { }
@@ -38,7 +40,8 @@ public:
         return true;
     }
 
-    virtual bool IsReady() const { return false; }
+    virtual bool IsReady() const { return ready_; }
+    void set_ready(bool ready) { ready_ = ready; }
 
     BgpProto::BgpPeerType PeerType() const {
         return BgpProto::IBGP;
@@ -52,6 +55,7 @@ public:
 private:
     RibExportPolicy policy_;
     int index_;
+    bool ready_;
 };
 
 class PeerRibMembershipManagerTest : public PeerRibMembershipManager {
@@ -64,6 +68,11 @@ public:
     void SetQueueDisable(bool disable) {
         event_queue_->set_disable(disable);
     }
+
+    void RunRibOutSnapshotTimer() {
+        ConcurrencyScope scope("bgp::PeerMembership");
+        RibOutSnapshotTimerExpired();
+    }
 };
 
 class PeerMembershipMgrTest : public ::testing::Test {
@@ -112,18 +121,7 @@ protected:
         vpn_tbl_ = rtinstance->GetTable(Address::INETVPN);
 
         for (int idx = 0; idx < 3; idx++) {
-            ostringstream out;
-            out << "A" << idx;
-            BgpNeighborConfig *config = new BgpNeighborConfig();
-            config->set_instance_name(rtinstance->name());
-            config->set_name(out.str());
-            boost::uuids::random_generator gen;
-            config->set_uuid(UuidToString(gen()));
-            BgpTestPeer *peer = static_cast<BgpTestPeer *>(
-                rtinstance->peer_manager()->PeerLocate(server(), config));
-            peers_.push_back(peer);
-            peer_configs_.push_back(config);
-            peer_names_.push_back(out.str());
+            CreatePeer();
         }
     }
 
@@ -137,6 +135,82 @@ protected:
         task_util::WaitForIdle();
     }
 
+    BgpTestPeer *CreatePeer() {
+        ConcurrencyScope scope("bgp::Config");
+        RoutingInstance *rtinstance = inet_tbl_->routing_instance();
+        ostringstream out;
+        out << "A" << peers_.size();
+        BgpNeighborConfig *config = new BgpNeighborConfig();
+        config->set_instance_name(rtinstance->name());
+        config->set_name(out.str());
+        boost::uuids::random_generator gen;
+        config->set_uuid(UuidToString(gen()));
+        BgpTestPeer *peer = static_cast<BgpTestPeer *>(
+            rtinstance->peer_manager()->PeerLocate(server(), config));
+        peers_.push_back(peer);
+        peer_configs_.push_back(config);
+        peer_names_.push_back(out.str());
+        return peer;
+    }
+
+    // Add or delete paths from the peer for count /32 prefixes from start.
+    void EnqueueRoutes(BgpTestPeer *peer, uint32_t start, int count,
+                       bool add) {
+        BgpAttrSpec attr_spec;
+        BgpAttrPtr attr = server_->attr_db()->Locate(attr_spec);
+        for (int idx = 0; idx < count; idx++) {
+            DBRequest req;
+            Ip4Prefix prefix(Ip4Address(start + idx), 32);
+            req.key.reset(new InetTable::RequestKey(prefix, peer));
+            if (add) {
+                req.oper = DBRequest::DB_ENTRY_ADD_CHANGE;
+                req.data.reset(new InetTable::RequestData(attr, 0, 0));
+            } else {
+                req.oper = DBRequest::DB_ENTRY_DELETE;
+            }
+            inet_tbl_->Enqueue(&req);
+        }
+    }
+
+    // Close action of a peer that keeps a snapshot of its adj-rib-out.
+    static int SnapshotCloseAction(IPeerRib *peer_rib) {
+        return (MembershipRequest::RIBIN_DELETE |
+                MembershipRequest::RIBOUT_DELETE |
+                MembershipRequest::RIBOUT_SNAPSHOT);
+    }
+
+    void UnregisterPeerDone(IPeer *ipeer, BgpTable *table) {
+    }
+
+    // Unregister the peer from all tables, keeping a snapshot of the routes
+    // advertised to it.
+    void SnapshotClose(BgpTestPeer *peer) {
+        server()->membership_mgr()->UnregisterPeer(peer,
+            boost::bind(&PeerMembershipMgrTest::SnapshotCloseAction, _1),
+            boost::bind(&PeerMembershipMgrTest::UnregisterPeerDone, this,
+                        _1, _2));
+    }
+
+    // Register the peer to inet with the digest of the routes it kept.
+    RibOutResyncPtr RegisterWithDigest(BgpTestPeer *peer,
+                                       const RibOutDigest &digest) {
+        RibOutResyncPtr resync(new RibOutResync(digest));
+        server()->membership_mgr()->Register(peer, inet_tbl_,
+            peer->GetRibExportPolicy(), -1, NULL, resync);
+        return resync;
+    }
+
+    bool GetSnapshot(BgpTestPeer *peer, RibOutDigest *digest) {
+        return server()->membership_mgr()->GetRibOutSnapshot(
+            peer->ToString(), inet_tbl_->name(), digest);
+    }
+
+    int RouteBucket(uint32_t addr) {
+        InetTable::RequestKey key(Ip4Prefix(Ip4Address(addr), 32), NULL);
+        BgpRoute *route = static_cast<BgpRoute *>(inet_tbl_->Find(&key));
+        return (route ? RibOutDigest::RouteBucket(route) : -1);
+    }
+
     BgpServer *server() { return server_.get(); }
     int size() { return server()->membership_mgr()->peer_rib_set_.size(); }
 
@@ -493,6 +567,361 @@ TEST_F(PeerMembershipMgrTest, PeerDeleteWithDBRequestPending) {
         server_->FindPeer(BgpConfigManager::kMasterInstance, peer_names_[0]));
 }
 
+// Paths of a peer are tracked per table partition and only the paths of
+// the peer are deleted on unregister.
+TEST_F(PeerMembershipMgrTest, PeerPathList) {
+    PeerRibMembershipManager *mgr = server()->membership_mgr();
+
+    for (int idx = 0; idx < 2; idx++) {
+        peers_[idx]->set_ready(true);
+        mgr->Register(peers_[idx], inet_tbl_,
+                      peers_[idx]->GetRibExportPolicy(), -1);
+    }
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(2, size());
+
+    EnqueueRoutes(peers_[0], 0x0a000000, 64, true);
+    EnqueueRoutes(peers_[1], 0x0a000000, 64, true);
+    EnqueueRoutes(peers_[1], 0x0b000000, 64, true);
+    task_util::WaitForIdle();
+    EXPECT_EQ(128U, inet_tbl_->Size());
+    EXPECT_EQ(64U, inet_tbl_->GetPeerPathCount(peers_[0]));
+    EXPECT_EQ(128U, inet_tbl_->GetPeerPathCount(peers_[1]));
+
+    // Paths deleted by the peer leave the list.
+    EnqueueRoutes(peers_[1], 0x0b000000, 32, false);
+    task_util::WaitForIdle();
+    EXPECT_EQ(96U, inet_tbl_->Size());
+    EXPECT_EQ(96U, inet_tbl_->GetPeerPathCount(peers_[1]));
+
+    mgr->Unregister(peers_[0], inet_tbl_);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(1, size());
+    EXPECT_EQ(0U, inet_tbl_->GetPeerPathCount(peers_[0]));
+    EXPECT_EQ(96U, inet_tbl_->GetPeerPathCount(peers_[1]));
+    EXPECT_EQ(96U, inet_tbl_->Size());
+
+    mgr->Unregister(peers_[1], inet_tbl_);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(0, size());
+    EXPECT_EQ(0U, inet_tbl_->GetPeerPathCount(peers_[1]));
+    TASK_UTIL_EXPECT_EQ(0U, inet_tbl_->Size());
+}
+
+// Simultaneous unregister of many peers with a few paths each from a table
+// with many routes from another peer. BGP_PEER_CLOSE_PEERS and
+// BGP_PEER_CLOSE_ROUTES give the number of peers and routes, e.g. 1000 and
+// 2000000.
+TEST_F(PeerMembershipMgrTest, PeerCloseScale) {
+    PeerRibMembershipManager *mgr = server()->membership_mgr();
+    int npeers = 100;
+    int nroutes = 100000;
+    const int kPeerPaths = 8;
+    if (getenv("BGP_PEER_CLOSE_PEERS"))
+        npeers = strtol(getenv("BGP_PEER_CLOSE_PEERS"), NULL, 0);
+    if (getenv("BGP_PEER_CLOSE_ROUTES"))
+        nroutes = strtol(getenv("BGP_PEER_CLOSE_ROUTES"), NULL, 0);
+
+    peers_[0]->set_ready(true);
+    mgr->Register(peers_[0], inet_tbl_, peers_[0]->GetRibExportPolicy(), -1);
+    vector<BgpTestPeer *> close_peers;
+    for (int idx = 0; idx < npeers; idx++) {
+        BgpTestPeer *peer = CreatePeer();
+        peer->set_ready(true);
+        mgr->Register(peer, inet_tbl_, peer->GetRibExportPolicy(), -1);
+        close_peers.push_back(peer);
+    }
+    task_util::WaitForIdle();
+
+    EnqueueRoutes(peers_[0], 0x0a000000, nroutes, true);
+    for (int idx = 0; idx < npeers; idx++) {
+        EnqueueRoutes(close_peers[idx], 0x0a000000 + idx * kPeerPaths,
+                      kPeerPaths, true);
+    }
+    task_util::WaitForIdle();
+    EXPECT_EQ(static_cast<size_t>(max(nroutes, npeers * kPeerPaths)),
+              inet_tbl_->Size());
+
+    uint64_t start = ClockMonotonicUsec();
+    for (int idx = 0; idx < npeers; idx++) {
+        mgr->Unregister(close_peers[idx], inet_tbl_);
+    }
+    task_util::WaitForIdle();
+    uint64_t usecs = ClockMonotonicUsec() - start;
+    TASK_UTIL_EXPECT_EQ(1, size());
+    for (int idx = 0; idx < npeers; idx++) {
+        EXPECT_EQ(0U, inet_tbl_->GetPeerPathCount(close_peers[idx]));
+    }
+    EXPECT_EQ(static_cast<size_t>(nroutes),
+              inet_tbl_->GetPeerPathCount(peers_[0]));
+
+    LOG(DEBUG, "Unregister " << npeers << " peers with " << kPeerPaths
+        << " paths each from table with " << nroutes << " routes: "
+        << usecs << " usec");
+
+    EnqueueRoutes(peers_[0], 0x0a000000, nroutes, false);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(0U, inet_tbl_->Size());
+}
+
+// Simultaneous unregister and register of many peers, as when agents
+// reconnect, to a table with routes that are advertised to all of them.
+// BGP_PEER_RECONNECT_PEERS and BGP_PEER_RECONNECT_ROUTES give the number of
+// peers and routes, e.g. 1000 and 10000.
+TEST_F(PeerMembershipMgrTest, PeerReconnectScale) {
+    PeerRibMembershipManager *mgr = server()->membership_mgr();
+    int npeers = 100;
+    int nroutes = 10000;
+    if (getenv("BGP_PEER_RECONNECT_PEERS"))
+        npeers = strtol(getenv("BGP_PEER_RECONNECT_PEERS"), NULL, 0);
+    if (getenv("BGP_PEER_RECONNECT_ROUTES"))
+        nroutes = strtol(getenv("BGP_PEER_RECONNECT_ROUTES"), NULL, 0);
+
+    vector<BgpTestPeer *> reconnect_peers;
+    for (int idx = 0; idx < npeers; idx++) {
+        BgpTestPeer *peer = CreatePeer();
+        peer->set_ready(true);
+        mgr->Register(peer, inet_tbl_, peer->GetRibExportPolicy(), -1);
+        reconnect_peers.push_back(peer);
+    }
+    EnqueueRoutes(NULL, 0x0a000000, nroutes, true);
+    task_util::WaitForIdle();
+    EXPECT_EQ(static_cast<size_t>(nroutes), inet_tbl_->Size());
+    TASK_UTIL_EXPECT_EQ(npeers, size());
+
+    uint64_t start = ClockMonotonicUsec();
+    for (int idx = 0; idx < npeers; idx++) {
+        mgr->Unregister(reconnect_peers[idx], inet_tbl_);
+    }
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(0, size());
+    for (int idx = 0; idx < npeers; idx++) {
+        BgpTestPeer *peer = reconnect_peers[idx];
+        mgr->Register(peer, inet_tbl_, peer->GetRibExportPolicy(), -1);
+    }
+    task_util::WaitForIdle();
+    uint64_t usecs = ClockMonotonicUsec() - start;
+    TASK_UTIL_EXPECT_EQ(npeers, size());
+
+    LOG(DEBUG, "Reconnect " << npeers << " peers to table with " << nroutes
+        << " routes: " << usecs << " usec");
+
+    for (int idx = 0; idx < npeers; idx++) {
+        mgr->Unregister(reconnect_peers[idx], inet_tbl_);
+    }
+    EnqueueRoutes(NULL, 0x0a000000, nroutes, false);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(0, size());
+    TASK_UTIL_EXPECT_EQ(0U, inet_tbl_->Size());
+}
+
+// A peer that registers with a digest but has no snapshot is sent all the
+// routes and has no bucket in sync.
+TEST_F(PeerMembershipMgrTest, ResyncNoSnapshot) {
+    PeerRibMembershipManager *mgr = server()->membership_mgr();
+    const int kRouteCount = 256;
+
+    peers_[0]->set_ready(true);
+    EnqueueRoutes(NULL, 0x0a000000, kRouteCount, true);
+    task_util::WaitForIdle();
+
+    RibOutResyncPtr resync = RegisterWithDigest(peers_[0], RibOutDigest());
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(1, size());
+    EXPECT_TRUE(mgr->IPeerRibFind(peers_[0], inet_tbl_)->ribout_resync());
+    EXPECT_EQ(0ULL, resync->candidate_mask());
+    EXPECT_EQ(0ULL, resync->dirty_mask());
+    EXPECT_EQ(0ULL, resync->sync_mask());
+    EXPECT_EQ(0U, mgr->GetRibOutSnapshotCount());
+
+    // The routes were advertised, so the snapshot is not empty.
+    SnapshotClose(peers_[0]);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(0, size());
+    RibOutDigest digest;
+    EXPECT_EQ(1U, mgr->GetRibOutSnapshotCount());
+    EXPECT_TRUE(GetSnapshot(peers_[0], &digest));
+    EXPECT_NE(RibOutDigest(), digest);
+
+    EnqueueRoutes(NULL, 0x0a000000, kRouteCount, false);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(0U, inet_tbl_->Size());
+}
+
+// A peer that comes back with the digest of the snapshot taken when it went
+// down has all buckets in sync. The routes are marked as advertised to the
+// peer, so the snapshot taken when it goes down again is the same.
+TEST_F(PeerMembershipMgrTest, ResyncMatchingDigest) {
+    PeerRibMembershipManager *mgr = server()->membership_mgr();
+    const int kRouteCount = 256;
+
+    peers_[0]->set_ready(true);
+    EnqueueRoutes(NULL, 0x0a000000, kRouteCount, true);
+    RegisterWithDigest(peers_[0], RibOutDigest());
+    task_util::WaitForIdle();
+    SnapshotClose(peers_[0]);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(0, size());
+    RibOutDigest digest;
+    EXPECT_TRUE(GetSnapshot(peers_[0], &digest));
+
+    RibOutResyncPtr resync = RegisterWithDigest(peers_[0], digest);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(1, size());
+    EXPECT_EQ(~0ULL, resync->candidate_mask());
+    EXPECT_EQ(0ULL, resync->dirty_mask());
+    EXPECT_EQ(~0ULL, resync->sync_mask());
+    EXPECT_EQ(0U, mgr->GetRibOutSnapshotCount());
+
+    SnapshotClose(peers_[0]);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(0, size());
+    RibOutDigest digest2;
+    EXPECT_TRUE(GetSnapshot(peers_[0], &digest2));
+    EXPECT_EQ(digest, digest2);
+
+    EnqueueRoutes(NULL, 0x0a000000, kRouteCount, false);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(0U, inet_tbl_->Size());
+}
+
+// A route that changes while the peer is down makes its bucket dirty, the
+// other buckets stay in sync.
+TEST_F(PeerMembershipMgrTest, ResyncChangedRoute) {
+    PeerRibMembershipManager *mgr = server()->membership_mgr();
+    const int kRouteCount = 256;
+
+    peers_[0]->set_ready(true);
+    EnqueueRoutes(NULL, 0x0a000000, kRouteCount, true);
+    RegisterWithDigest(peers_[0], RibOutDigest());
+    task_util::WaitForIdle();
+    SnapshotClose(peers_[0]);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(0, size());
+    RibOutDigest digest;
+    EXPECT_TRUE(GetSnapshot(peers_[0], &digest));
+
+    int bucket = RouteBucket(0x0a000000);
+    ASSERT_LE(0, bucket);
+    EnqueueRoutes(NULL, 0x0a000000, 1, false);
+    task_util::WaitForIdle();
+
+    RibOutResyncPtr resync = RegisterWithDigest(peers_[0], digest);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(1, size());
+    EXPECT_EQ(~0ULL, resync->candidate_mask());
+    EXPECT_EQ(1ULL << bucket, resync->dirty_mask());
+    EXPECT_EQ(~(1ULL << bucket), resync->sync_mask());
+
+    SnapshotClose(peers_[0]);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(0, size());
+    RibOutDigest digest2;
+    EXPECT_TRUE(GetSnapshot(peers_[0], &digest2));
+    EXPECT_NE(digest, digest2);
+
+    EnqueueRoutes(NULL, 0x0a000000, kRouteCount, false);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(0U, inet_tbl_->Size());
+}
+
+// Snapshots are not used once they expire and are purged by the timer.
+TEST_F(PeerMembershipMgrTest, ResyncSnapshotExpired) {
+    PeerRibMembershipManagerTest *mgr =
+        static_cast<PeerRibMembershipManagerTest *>(
+            server()->membership_mgr());
+    const int kRouteCount = 256;
+
+    peers_[0]->set_ready(true);
+    EnqueueRoutes(NULL, 0x0a000000, kRouteCount, true);
+    RegisterWithDigest(peers_[0], RibOutDigest());
+    task_util::WaitForIdle();
+    SnapshotClose(peers_[0]);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(0, size());
+    RibOutDigest digest;
+    EXPECT_TRUE(GetSnapshot(peers_[0], &digest));
+
+    mgr->set_ribout_snapshot_expiry(0);
+    EXPECT_FALSE(GetSnapshot(peers_[0], &digest));
+    EXPECT_EQ(1U, mgr->GetRibOutSnapshotCount());
+    mgr->RunRibOutSnapshotTimer();
+    EXPECT_EQ(0U, mgr->GetRibOutSnapshotCount());
+
+    RibOutResyncPtr resync = RegisterWithDigest(peers_[0], digest);
+    task_util::WaitForIdle();
+    EXPECT_EQ(0ULL, resync->sync_mask());
+
+    mgr->Unregister(peers_[0], inet_tbl_);
+    EnqueueRoutes(NULL, 0x0a000000, kRouteCount, false);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(0, size());
+    TASK_UTIL_EXPECT_EQ(0U, inet_tbl_->Size());
+}
+
+// Simultaneous register of many peers that come back with the digest of
+// their snapshot to a table with routes that are advertised to all of them.
+// BGP_PEER_RESYNC_PEERS and BGP_PEER_RESYNC_ROUTES give the number of peers
+// and routes, e.g. 1000 and 10000.
+TEST_F(PeerMembershipMgrTest, PeerResyncScale) {
+    PeerRibMembershipManager *mgr = server()->membership_mgr();
+    int npeers = 100;
+    int nroutes = 10000;
+    if (getenv("BGP_PEER_RESYNC_PEERS"))
+        npeers = strtol(getenv("BGP_PEER_RESYNC_PEERS"), NULL, 0);
+    if (getenv("BGP_PEER_RESYNC_ROUTES"))
+        nroutes = strtol(getenv("BGP_PEER_RESYNC_ROUTES"), NULL, 0);
+
+    vector<BgpTestPeer *> resync_peers;
+    for (int idx = 0; idx < npeers; idx++) {
+        BgpTestPeer *peer = CreatePeer();
+        peer->set_ready(true);
+        RegisterWithDigest(peer, RibOutDigest());
+        resync_peers.push_back(peer);
+    }
+    EnqueueRoutes(NULL, 0x0a000000, nroutes, true);
+    task_util::WaitForIdle();
+    EXPECT_EQ(static_cast<size_t>(nroutes), inet_tbl_->Size());
+    TASK_UTIL_EXPECT_EQ(npeers, size());
+
+    for (int idx = 0; idx < npeers; idx++) {
+        SnapshotClose(resync_peers[idx]);
+    }
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(0, size());
+    EXPECT_EQ(static_cast<size_t>(npeers), mgr->GetRibOutSnapshotCount());
+
+    vector<RibOutDigest> digests(npeers);
+    for (int idx = 0; idx < npeers; idx++) {
+        EXPECT_TRUE(GetSnapshot(resync_peers[idx], &digests[idx]));
+    }
+
+    vector<RibOutResyncPtr> resyncs;
+    uint64_t start = ClockMonotonicUsec();
+    for (int idx = 0; idx < npeers; idx++) {
+        resyncs.push_back(RegisterWithDigest(resync_peers[idx],
+                                             digests[idx]));
+    }
+    task_util::WaitForIdle();
+    uint64_t usecs = ClockMonotonicUsec() - start;
+    TASK_UTIL_EXPECT_EQ(npeers, size());
+    EXPECT_EQ(0U, mgr->GetRibOutSnapshotCount());
+    for (int idx = 0; idx < npeers; idx++) {
+        EXPECT_EQ(~0ULL, resyncs[idx]->sync_mask());
+    }
+
+    LOG(DEBUG, "Resync " << npeers << " peers to table with " << nroutes
+        << " routes: " << usecs << " usec");
+
+    for (int idx = 0; idx < npeers; idx++) {
+        mgr->Unregister(resync_peers[idx], inet_tbl_);
+    }
+    EnqueueRoutes(NULL, 0x0a000000, nroutes, false);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(0, size());
+    TASK_UTIL_EXPECT_EQ(0U, inet_tbl_->Size());
+}
+
 static void SetUp() {
     bgp_log_test::init();
     BgpServerTest::GlobalSetUp();
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "bgp/bgp_ribout_digest.h"
+
+#include "base/test/task_test_util.h"
+#include "bgp/bgp_log.h"
+#include "bgp/bgp_ribout.h"
+#include "bgp/inet/inet_route.h"
+#include "control-node/control_node.h"
+#include "testing/gunit.h"
+
+using std::string;
+
+class RibOutDigestTest : public ::testing::Test {
+protected:
+    // Digest with the given value in each bucket.
+    RibOutDigest BuildDigest(uint64_t value) {
+        RibOutDigest digest;
+        for (int idx = 0; idx < RibOutDigest::kBucketCount; ++idx) {
+            digest.Add(idx, value);
+        }
+        return digest;
+    }
+};
+
+TEST_F(RibOutDigestTest, ToFromString) {
+    RibOutDigest digest;
+    for (int idx = 0; idx < RibOutDigest::kBucketCount; ++idx) {
+        digest.Add(idx, 0xfedcba9876543210ULL * (idx + 1));
+    }
+
+    RibOutDigest parsed;
+    EXPECT_TRUE(parsed.FromString(digest.ToString()));
+    EXPECT_EQ(digest, parsed);
+    EXPECT_EQ(digest.ToString(), parsed.ToString());
+}
+
+TEST_F(RibOutDigestTest, FromStringBad) {
+    RibOutDigest digest = BuildDigest(1);
+    RibOutDigest parsed = digest;
+
+    // Too few and too many buckets.
+    string str = BuildDigest(2).ToString();
+    EXPECT_FALSE(parsed.FromString(str.substr(0, str.rfind(','))));
+    EXPECT_FALSE(parsed.FromString(str + ",2"));
+
+    // Empty bucket and bad characters.
+    EXPECT_FALSE(parsed.FromString("," + str.substr(str.find(',') + 1)));
+    EXPECT_FALSE(parsed.FromString("x" + str.substr(1)));
+    EXPECT_FALSE(parsed.FromString(""));
+
+    // The digest is left unchanged.
+    EXPECT_EQ(digest, parsed);
+}
+
+TEST_F(RibOutDigestTest, RouteBucket) {
+    InetRoute route1(Ip4Prefix::FromString("10.1.1.0/24"));
+    InetRoute route2(Ip4Prefix::FromString("10.1.1.0/24"));
+    int bucket = RibOutDigest::RouteBucket(&route1);
+    EXPECT_LE(0, bucket);
+    EXPECT_GT(RibOutDigest::kBucketCount, bucket);
+    EXPECT_EQ(bucket, RibOutDigest::RouteBucket(&route2));
+}
+
+TEST_F(RibOutDigestTest, RouteHashUnreachable) {
+    InetRoute route(Ip4Prefix::FromString("10.1.1.0/24"));
+    RibOutAttr roattr;
+    EXPECT_EQ(0ULL, RibOutDigest::RouteHash(&route, roattr));
+
+    RibOutDigest digest;
+    digest.Add(&route, roattr);
+    EXPECT_EQ(RibOutDigest(), digest);
+}
+
+// Parallel walks add to the digest of their partition.
+TEST_F(RibOutDigestTest, WalkDigest) {
+    RibOutWalkDigest walk_digest(4);
+    RibOutDigest digest;
+    for (int idx = 0; idx < RibOutDigest::kBucketCount; ++idx) {
+        walk_digest.Add(idx % 4, idx, idx + 1);
+        digest.Add(idx, idx + 1);
+    }
+    EXPECT_EQ(digest, walk_digest.Merge());
+}
+
+// Buckets where the peer digest matches the snapshot are candidates, and
+// candidates where the current routes differ from the peer digest are dirty.
+TEST_F(RibOutDigestTest, Resync) {
+    RibOutDigest peer_digest = BuildDigest(1);
+    RibOutDigest snapshot = BuildDigest(1);
+    snapshot.Add(0, 1);
+    snapshot.Add(1, 1);
+
+    RibOutResync resync(peer_digest);
+    resync.SetSnapshot(snapshot, 2);
+    EXPECT_FALSE(resync.IsCandidate(0));
+    EXPECT_FALSE(resync.IsCandidate(1));
+    EXPECT_TRUE(resync.IsCandidate(2));
+    EXPECT_EQ(~0x3ULL, resync.candidate_mask());
+
+    // The routes of bucket 2 changed, there is no route left in bucket 3.
+    for (int idx = 2; idx < RibOutDigest::kBucketCount; ++idx) {
+        if (idx == 3)
+            continue;
+        resync.Add(idx % 2, idx, idx == 2 ? 5 : 1);
+    }
+    EXPECT_TRUE(resync.WalkDone());
+    EXPECT_TRUE(resync.IsDirty(2));
+    EXPECT_TRUE(resync.IsDirty(3));
+    EXPECT_FALSE(resync.IsDirty(4));
+    EXPECT_EQ(0xcULL, resync.dirty_mask());
+    EXPECT_EQ(~0xfULL, resync.sync_mask());
+}
+
+// A peer that comes back without a snapshot has no bucket in sync.
+TEST_F(RibOutDigestTest, ResyncNoSnapshot) {
+    RibOutResync resync(BuildDigest(1));
+    EXPECT_EQ(0ULL, resync.candidate_mask());
+    EXPECT_FALSE(resync.WalkDone());
+    EXPECT_EQ(0ULL, resync.sync_mask());
+}
+
+static void SetUp() {
+    bgp_log_test::init();
+    ControlNode::SetDefaultSchedulingPolicy();
+}
+
+static void TearDown() {
+    task_util::WaitForIdle();
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    scheduler->Terminate();
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    SetUp();
+    int result = RUN_ALL_TESTS();
+    TearDown();
+    return result;
+}
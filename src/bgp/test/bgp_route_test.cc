@@ -3,6 +3,7 @@
  */
 
 
+#include "base/time_util.h"
 #include "base/test/task_test_util.h"
 #include "bgp/bgp_log.h"
 #include "bgp/inet/inet_route.h"
@@ -10,6 +11,7 @@
 
 
 using std::string;
+using std::vector;
 
 class PeerMock : public IPeer {
 public:
@@ -425,6 +427,105 @@ TEST_F(BgpRouteTest, PathCompareMed4) {
     EXPECT_EQ(-1, path2.PathCompare(path1, false));
 }
 
+//
+// Churn paths of a route with 2, 16 and 128 paths. Paths are inserted and
+// deleted incrementally by BgpRoute, the result is compared with a route
+// where the path list is sorted again on every change.
+//
+TEST_F(BgpRouteTest, PathChurn) {
+    const int path_counts[] = { 2, 16, 128 };
+    const int kChurnCount = 10000;
+    const int kLocalPrefCount = 8;
+    BgpAttrDB *db = server_.attr_db();
+
+    vector<BgpAttrPtr> attrs;
+    for (int idx = 0; idx < kLocalPrefCount; ++idx) {
+        BgpAttrSpec spec;
+        BgpAttrLocalPref local_pref(100 + idx);
+        spec.push_back(&local_pref);
+        attrs.push_back(db->Locate(spec));
+    }
+
+    for (size_t count_idx = 0;
+         count_idx < sizeof(path_counts) / sizeof(path_counts[0]);
+         ++count_idx) {
+        int count = path_counts[count_idx];
+        vector<PeerMock *> peers;
+        vector<BgpPath *> paths;
+        vector<BgpPath *> sort_paths;
+        Ip4Prefix prefix;
+        InetRoute route(prefix);
+        InetRoute sort_route(prefix);
+        for (int idx = 0; idx < count; ++idx) {
+            peers.push_back(new PeerMock(BgpProto::IBGP,
+                                         Ip4Address(0x0a010101 + idx)));
+            const BgpAttrPtr &attr = attrs[idx % kLocalPrefCount];
+            paths.push_back(
+                new BgpPath(peers[idx], BgpPath::BGP_XMPP, attr, 0, 0));
+            route.InsertPath(paths[idx]);
+            sort_paths.push_back(
+                new BgpPath(peers[idx], BgpPath::BGP_XMPP, attr, 0, 0));
+            sort_route.insert(sort_paths[idx]);
+        }
+        sort_route.Sort(&BgpTable::PathSelection, NULL);
+
+        // Replace path of a peer with one that has a different local pref.
+        uint64_t start = ClockMonotonicUsec();
+        for (int churn = 0, idx = 0; churn < kChurnCount; ++churn) {
+            idx = (idx * 7 + 3) % count;
+            const BgpAttrPtr &attr = attrs[churn % kLocalPrefCount];
+            route.DeletePath(paths[idx]);
+            paths[idx] = new BgpPath(peers[idx], BgpPath::BGP_XMPP, attr, 0, 0);
+            route.InsertPath(paths[idx]);
+        }
+        uint64_t incremental_usecs = ClockMonotonicUsec() - start;
+
+        start = ClockMonotonicUsec();
+        for (int churn = 0, idx = 0; churn < kChurnCount; ++churn) {
+            idx = (idx * 7 + 3) % count;
+            const BgpAttrPtr &attr = attrs[churn % kLocalPrefCount];
+            const Path *prev_front = sort_route.front();
+            sort_route.remove(sort_paths[idx]);
+            sort_route.Sort(&BgpTable::PathSelection, prev_front);
+            delete sort_paths[idx];
+            sort_paths[idx] =
+                new BgpPath(peers[idx], BgpPath::BGP_XMPP, attr, 0, 0);
+            prev_front = sort_route.front();
+            sort_route.insert(sort_paths[idx]);
+            sort_route.Sort(&BgpTable::PathSelection, prev_front);
+        }
+        uint64_t sort_usecs = ClockMonotonicUsec() - start;
+
+        LOG(DEBUG, count << " paths, " << kChurnCount << " changes: "
+            "incremental " << incremental_usecs << " usec, sort "
+            << sort_usecs << " usec");
+
+        // Both routes must have paths from the peers in the same order.
+        Route::PathList::const_iterator it1 = route.GetPathList().begin();
+        Route::PathList::const_iterator it2 = sort_route.GetPathList().begin();
+        const Path *prev = NULL;
+        for (; it1 != route.GetPathList().end(); ++it1, ++it2) {
+            ASSERT_TRUE(it2 != sort_route.GetPathList().end());
+            const BgpPath *path1 = static_cast<const BgpPath *>(&*it1);
+            const BgpPath *path2 = static_cast<const BgpPath *>(&*it2);
+            EXPECT_EQ(path1->GetPeer(), path2->GetPeer());
+            EXPECT_EQ(path1->GetAttr(), path2->GetAttr());
+            if (prev) {
+                EXPECT_FALSE(BgpTable::PathSelection(*it1, *prev));
+            }
+            prev = &*it1;
+        }
+        EXPECT_TRUE(it2 == sort_route.GetPathList().end());
+
+        for (int idx = 0; idx < count; ++idx) {
+            route.DeletePath(paths[idx]);
+            sort_route.remove(sort_paths[idx]);
+            delete sort_paths[idx];
+        }
+        STLDeleteValues(&peers);
+    }
+}
+
 static void SetUp() {
     bgp_log_test::init();
     ControlNode::SetDefaultSchedulingPolicy();
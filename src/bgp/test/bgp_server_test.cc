@@ -3,6 +3,7 @@
  */
 
 
+#include "base/time_util.h"
 #include "bgp/bgp_config_parser.h"
 #include "bgp/bgp_factory.h"
 #include "bgp/bgp_peer_membership.h"
@@ -2967,6 +2968,70 @@ TEST_F(BgpServerUnitTest, BasicAdvertiseWithdraw) {
     BGP_VERIFY_ROUTE_ABSENCE(table_b, &key3);
 }
 
+//
+// Benchmark for the receive path: advertise a full table from A and measure
+// the time taken for all the routes to be received and added at B.
+// Run only if BGP_FULL_TABLE_PREFIXES is set, e.g. to 100000, or to 1000000
+// for a full Internet table.
+//
+TEST_F(BgpServerUnitTest, FullTableTransfer) {
+    if (!getenv("BGP_FULL_TABLE_PREFIXES")) {
+        return;
+    }
+    int prefix_count = strtol(getenv("BGP_FULL_TABLE_PREFIXES"), NULL, 0);
+
+    SetupPeers(1, a_->session_manager()->GetPort(),
+               b_->session_manager()->GetPort(), false);
+    VerifyPeers(1);
+
+    DB *db_a = a_.get()->database();
+    InetTable *table_a = static_cast<InetTable *>(db_a->FindTable("inet.0"));
+    assert(table_a);
+    DB *db_b = b_.get()->database();
+    InetTable *table_b = static_cast<InetTable *>(db_b->FindTable("inet.0"));
+    assert(table_b);
+
+    BgpAttrSpec attr_spec;
+    BgpAttrOrigin origin(BgpAttrOrigin::IGP);
+    attr_spec.push_back(&origin);
+    AsPathSpec path_spec;
+    AsPathSpec::PathSegment *path_seg = new AsPathSpec::PathSegment;
+    path_seg->path_segment_type = AsPathSpec::PathSegment::AS_SEQUENCE;
+    path_seg->path_segment.push_back(65534);
+    path_spec.path_segments.push_back(path_seg);
+    attr_spec.push_back(&path_spec);
+    BgpAttrNextHop nexthop(0x7f00007f);
+    attr_spec.push_back(&nexthop);
+    BgpAttrLocalPref local_pref(100);
+    attr_spec.push_back(&local_pref);
+    BgpAttrPtr attr_ptr = a_.get()->attr_db()->Locate(attr_spec);
+
+    uint64_t start = ClockMonotonicUsec();
+    for (int idx = 0; idx < prefix_count; ++idx) {
+        Ip4Prefix prefix(Ip4Address(0x01000000 + (idx << 8)), 24);
+        DBRequest req;
+        req.oper = DBRequest::DB_ENTRY_ADD_CHANGE;
+        req.key.reset(new InetTable::RequestKey(prefix, NULL));
+        req.data.reset(new InetTable::RequestData(attr_ptr, 0, 0));
+        table_a->Enqueue(&req);
+    }
+    TASK_UTIL_WAIT_EQ(prefix_count, static_cast<int>(table_b->Size()),
+        1000, 600000, "Wait for full table at B");
+    uint64_t elapsed = ClockMonotonicUsec() - start;
+    BGP_DEBUG_UT("Received " << prefix_count << " prefixes in " <<
+        elapsed / 1000 << " msec");
+
+    for (int idx = 0; idx < prefix_count; ++idx) {
+        Ip4Prefix prefix(Ip4Address(0x01000000 + (idx << 8)), 24);
+        DBRequest req;
+        req.oper = DBRequest::DB_ENTRY_DELETE;
+        req.key.reset(new InetTable::RequestKey(prefix, NULL));
+        table_a->Enqueue(&req);
+    }
+    TASK_UTIL_WAIT_EQ(0, static_cast<int>(table_b->Size()),
+        1000, 600000, "Wait for full table withdrawal at B");
+}
+
 class TestEnvironment : public ::testing::Environment {
     virtual ~TestEnvironment() { }
 };
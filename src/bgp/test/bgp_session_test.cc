@@ -27,6 +27,7 @@ public:
                             size_t size) {
         BGP_DEBUG_UT("ReceiveMsg: " << size << " bytes");
         sizes.push_back(size);
+        msgs.push_back(msg);
         return true;
     }
     vector<int>::const_iterator begin() const {
@@ -35,9 +36,13 @@ public:
     vector<int>::const_iterator end() const {
         return sizes.end();
     }
+    const vector<const u_int8_t *> &msg_list() const {
+        return msgs;
+    }
 
 private:
     vector<int> sizes;
+    vector<const u_int8_t *> msgs;
 };
 
 class BgpSessionTest : public BgpSession {
@@ -247,6 +252,37 @@ TEST_F(BgpSessionUnitTest, StreamRead) {
     EXPECT_EQ(buf_list.size(), session_->release_count());
 }
 
+// Messages within a buffer are received in place, messages that span buffers
+// are copied into the same scratch buffer.
+TEST_F(BgpSessionUnitTest, InPlaceRead) {
+    uint8_t stream[4096];
+    int sizes[] = { 100, 400, 80, 110, 40 };
+    uint8_t *data = stream;
+    for (size_t i = 0; i < ARRAYLEN(sizes); i++) {
+        CreateFakeMessage(data, sizes[i]);
+        data += sizes[i];
+    }
+    int segments[] = {
+        100 + 200,      // complete msg + start of msg
+        200 + 80 + 50,  // end + complete msg + start of msg
+        60 + 40         // end + complete msg
+    };
+    data = stream;
+    for (size_t i = 0; i < ARRAYLEN(segments); i++) {
+        session_->Read(mutable_buffer(data, segments[i]));
+        data += segments[i];
+    }
+
+    const vector<const u_int8_t *> &msgs = peer_->msg_list();
+    EXPECT_EQ(ARRAYLEN(sizes), msgs.size());
+    EXPECT_TRUE(msgs[0] == stream);
+    EXPECT_TRUE(msgs[1] < stream || msgs[1] >= stream + sizeof(stream));
+    EXPECT_TRUE(msgs[2] == stream + 500);
+    EXPECT_TRUE(msgs[3] == msgs[1]);
+    EXPECT_TRUE(msgs[4] == stream + 690);
+    EXPECT_EQ(ARRAYLEN(segments), session_->release_count());
+}
+
 static void SetUp() {
     ControlNode::SetDefaultSchedulingPolicy();
 }
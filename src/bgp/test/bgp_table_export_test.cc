@@ -3,7 +3,11 @@
  */
 
 
+#include <boost/bind.hpp>
+
+#include "base/time_util.h"
 #include "bgp/bgp_factory.h"
+#include "bgp/inet/inet_table.h"
 #include "bgp/scheduling_group.h"
 #include "bgp/routing-instance/rtarget_group_mgr.h"
 #include "bgp/test/bgp_server_test_util.h"
@@ -937,6 +941,183 @@ INSTANTIATE_TEST_CASE_P(Instance, BgpTableExportParamTest5,
         ::testing::Bool(),
         ::testing::Bool()));
 
+//
+// Export of routes to RibOuts of the inet.0 table from DB notifications, the
+// same way as BgpExport does it.
+//
+// RibOuts that differ only in affinity share the export result computed for
+// a notification of the route. eBGP RibOuts with different peer AS numbers
+// each compute their own.
+//
+class BgpTableExportPlanTest : public ::testing::Test {
+protected:
+    static const int kRibOutCount = 8;
+
+    BgpTableExportPlanTest()
+        : server_(&evm_, "Local"), peer_(false), table_(NULL) {
+        server_.set_autonomous_system(200);
+        server_.set_local_autonomous_system(200);
+        peerset_.set(1);
+        exports_ = 0;
+        bad_exports_ = 0;
+    }
+
+    virtual void SetUp() {
+        DB *db = server_.database();
+        table_ = static_cast<BgpTable *>(db->FindTable("inet.0"));
+        ASSERT_TRUE(table_ != NULL);
+
+        BgpAttrSpec attr_spec;
+        BgpAttrOrigin origin(BgpAttrOrigin::IGP);
+        attr_spec.push_back(&origin);
+        BgpAttrNextHop nexthop(0x01010101);
+        attr_spec.push_back(&nexthop);
+        AsPathSpec path_spec;
+        AsPathSpec::PathSegment *path_seg = new AsPathSpec::PathSegment;
+        path_seg->path_segment_type = AsPathSpec::PathSegment::AS_SEQUENCE;
+        path_seg->path_segment.push_back(100);
+        path_spec.path_segments.push_back(path_seg);
+        attr_spec.push_back(&path_spec);
+        attr_ptr_ = server_.attr_db()->Locate(attr_spec);
+    }
+
+    virtual void TearDown() {
+        for (size_t idx = 0; idx < listeners_.size(); ++idx) {
+            table_->Unregister(listeners_[idx]);
+        }
+        for (size_t idx = 0; idx < ribouts_.size(); ++idx) {
+            table_->RibOutDelete(ribouts_[idx]->ExportPolicy());
+        }
+        attr_ptr_.reset();
+        server_.Shutdown();
+        task_util::WaitForIdle();
+    }
+
+    void CreateRibOuts(bool shared) {
+        for (int idx = 0; idx < kRibOutCount; ++idx) {
+            as_t as_number = shared ? 300 : 300 + idx;
+            RibExportPolicy policy(
+                BgpProto::EBGP, RibExportPolicy::BGP, as_number, idx, 0);
+            RibOut *ribout = table_->RibOutLocate(&mgr_, policy);
+            ribouts_.push_back(ribout);
+            listeners_.push_back(table_->Register(
+                boost::bind(&BgpTableExportPlanTest::Notify, this, ribout,
+                            _1, _2)));
+        }
+    }
+
+    void Notify(RibOut *ribout, DBTablePartBase *root, DBEntryBase *entry) {
+        BgpRoute *route = static_cast<BgpRoute *>(entry);
+        if (route->IsDeleted())
+            return;
+        UpdateInfoSList uinfo_slist;
+        if (table_->Export(ribout, route, peerset_, uinfo_slist)) {
+            exports_++;
+            const UpdateInfo &uinfo = uinfo_slist->front();
+            if (!uinfo.roattr.attr()->as_path()->path().AsLeftMostMatch(200))
+                bad_exports_++;
+        }
+    }
+
+    void EnqueueRoutes(int count, bool add) {
+        for (int idx = 0; idx < count; ++idx) {
+            DBRequest req;
+            Ip4Prefix prefix(Ip4Address(0x0a000000 + idx), 32);
+            req.key.reset(new InetTable::RequestKey(prefix, &peer_));
+            if (add) {
+                req.oper = DBRequest::DB_ENTRY_ADD_CHANGE;
+                req.data.reset(new InetTable::RequestData(attr_ptr_, 0, 0));
+            } else {
+                req.oper = DBRequest::DB_ENTRY_DELETE;
+            }
+            table_->Enqueue(&req);
+        }
+    }
+
+    EventManager evm_;
+    BgpServerTest server_;
+    SchedulingGroupManager mgr_;
+    BgpTestPeer peer_;
+    BgpTable *table_;
+    BgpAttrPtr attr_ptr_;
+    RibPeerSet peerset_;
+    std::vector<RibOut *> ribouts_;
+    std::vector<DBTableBase::ListenerId> listeners_;
+    tbb::atomic<uint64_t> exports_;
+    tbb::atomic<uint64_t> bad_exports_;
+};
+
+//
+// Export result is computed once per route for all the RibOuts.
+//
+TEST_F(BgpTableExportPlanTest, Shared) {
+    CreateRibOuts(true);
+    EnqueueRoutes(64, true);
+    task_util::WaitForIdle();
+    EXPECT_EQ(64U * kRibOutCount, exports_);
+    EXPECT_EQ(0U, bad_exports_);
+    EXPECT_EQ(64U, table_->GetExportPlanMisses());
+    EXPECT_EQ(64U * (kRibOutCount - 1), table_->GetExportPlanHits());
+
+    EnqueueRoutes(64, false);
+    task_util::WaitForIdle();
+    EXPECT_EQ(0U, table_->Size());
+}
+
+//
+// Export result is computed for each RibOut since the peer AS differs.
+//
+TEST_F(BgpTableExportPlanTest, NotShared) {
+    CreateRibOuts(false);
+    EnqueueRoutes(64, true);
+    task_util::WaitForIdle();
+    EXPECT_EQ(64U * kRibOutCount, exports_);
+    EXPECT_EQ(0U, bad_exports_);
+    EXPECT_EQ(64U * kRibOutCount, table_->GetExportPlanMisses());
+    EXPECT_EQ(0U, table_->GetExportPlanHits());
+
+    EnqueueRoutes(64, false);
+    task_util::WaitForIdle();
+    EXPECT_EQ(0U, table_->Size());
+}
+
+//
+// Time to add and export routes to RibOuts that share the export result and
+// to RibOuts that don't. BGP_EXPORT_PLAN_ROUTES gives the number of routes,
+// e.g. 1000000 for a full table.
+//
+TEST_F(BgpTableExportPlanTest, Benchmark) {
+    int count = 100000;
+    if (getenv("BGP_EXPORT_PLAN_ROUTES")) {
+        count = strtol(getenv("BGP_EXPORT_PLAN_ROUTES"), NULL, 0);
+    }
+
+    uint64_t usecs[2] = { 0, 0 };
+    for (int shared = 0; shared < 2; ++shared) {
+        CreateRibOuts(shared == 1);
+        exports_ = 0;
+        uint64_t start = ClockMonotonicUsec();
+        EnqueueRoutes(count, true);
+        task_util::WaitForIdle();
+        usecs[shared] = ClockMonotonicUsec() - start;
+        EXPECT_EQ((uint64_t) count * kRibOutCount, exports_);
+
+        EnqueueRoutes(count, false);
+        task_util::WaitForIdle();
+        EXPECT_EQ(0U, table_->Size());
+        for (size_t idx = 0; idx < listeners_.size(); ++idx) {
+            table_->Unregister(listeners_[idx]);
+            table_->RibOutDelete(ribouts_[idx]->ExportPolicy());
+        }
+        listeners_.clear();
+        ribouts_.clear();
+    }
+    EXPECT_EQ(0U, bad_exports_);
+
+    LOG(DEBUG, count << " routes, " << kRibOutCount << " RibOuts: "
+        "not shared " << usecs[0] << " usec, shared " << usecs[1] << " usec");
+}
+
 static void SetUp() {
     bgp_log_test::init();
     ControlNode::SetDefaultSchedulingPolicy();
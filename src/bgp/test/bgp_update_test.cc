@@ -3,15 +3,18 @@
  */
 
 
+#include <boost/assign/list_of.hpp>
 #include <boost/ptr_container/ptr_vector.hpp>
 #include <boost/foreach.hpp>
 
 #include <tbb/compat/condition_variable>
 
 #include "base/task_annotations.h"
+#include "base/time_util.h"
 #include "base/test/task_test_util.h"
 #include "bgp/bgp_log.h"
 #include "bgp/bgp_ribout_updates.h"
+#include "bgp/bgp_update_monitor.h"
 #include "bgp/bgp_update_queue.h"
 #include "bgp/message_builder.h"
 #include "bgp/scheduling_group.h"
@@ -140,6 +143,56 @@ static RouteUpdate *BuildWithdraw(BgpRoute *route, const RibOut &ribout) {
     return update;
 }
 
+//
+// Enqueue updates for a set of routes from a DB partition task.
+//
+class EnqueueTask : public Task {
+public:
+    EnqueueTask(int partition, RibOut *ribout,
+            const vector<InetVpnRoute *> &routes, BgpAttrPtr attr,
+            tbb::atomic<int> *done)
+        : Task(TaskScheduler::GetInstance()->GetTaskId("db::DBTable"),
+               partition),
+          ribout_(ribout), routes_(routes), attr_(attr), done_(done) {
+    }
+
+    virtual bool Run() {
+        BOOST_FOREACH(InetVpnRoute *rt, routes_) {
+            RouteUpdate *update = BuildUpdate(rt, *ribout_, attr_);
+            ribout_->updates()->Enqueue(rt, update);
+        }
+        (*done_)++;
+        return true;
+    }
+
+private:
+    RibOut *ribout_;
+    vector<InetVpnRoute *> routes_;
+    BgpAttrPtr attr_;
+    tbb::atomic<int> *done_;
+};
+
+//
+// Keep the bgp::SendTask from running until released.
+//
+class SendBlockTask : public Task {
+public:
+    SendBlockTask(tbb::atomic<bool> *running, Condition *release)
+        : Task(TaskScheduler::GetInstance()->GetTaskId("bgp::SendBlock"), 0),
+          running_(running), release_(release) {
+    }
+
+    virtual bool Run() {
+        *running_ = true;
+        release_->WaitAndClear();
+        return true;
+    }
+
+private:
+    tbb::atomic<bool> *running_;
+    Condition *release_;
+};
+
 class BgpUpdateTest : public ::testing::Test {
 protected:
     static const int kPeerCount = 2;
@@ -394,6 +447,116 @@ TEST_F(BgpUpdateTest, MultipleMarkers) {
     STLDeleteValues(&routes);
 }
 
+// Enqueue updates from 16 DB partitions into one RibOut and report the
+// contention on the monitor and queue locks. The send task is held until all
+// the updates are enqueued, so that the number of lock acquisitions for the
+// enqueues and the tail dequeue can be checked exactly.
+//
+// Each enqueue takes the monitor lock and the queue lock once. The tail
+// dequeue takes both locks once for each update to get the next update in
+// attribute order and once to dequeue it, and the queue lock once more to
+// remove it from the attribute set and the monitor lock once more to store
+// the history. The next update in FIFO order is looked up once at the start
+// and once for each message, the last lookup also moves the tail marker.
+TEST_F(BgpUpdateTest, PartitionContention) {
+    const int kPartitions = 16;
+    int count = 2000;
+    if (getenv("BGP_UPDATE_PARTITION_ROUTES")) {
+        count = strtol(getenv("BGP_UPDATE_PARTITION_ROUTES"), NULL, 0);
+    }
+    const uint64_t total = kPartitions * count;
+
+    InetVpnPrefix prefix(InetVpnPrefix::FromString("0:0:192.168.24.0/24"));
+    tbb::atomic<int> done;
+    done = 0;
+    vector<InetVpnRoute *> routes;
+    vector<EnqueueTask *> tasks;
+    for (int i = 0; i < kPartitions; i++) {
+        vector<InetVpnRoute *> partition_routes;
+        for (int j = 0; j < count; j++) {
+            partition_routes.push_back(new InetVpnRoute(prefix));
+        }
+        routes.insert(routes.end(),
+                      partition_routes.begin(), partition_routes.end());
+        tasks.push_back(new EnqueueTask(i, &tbl1_, partition_routes,
+                                        attr_[i % kAttrCount], &done));
+    }
+
+    RibUpdateMonitor::set_lock_stats_enabled(true);
+    UpdateQueue::set_lock_stats_enabled(true);
+    RibOutUpdates *updates = tbl1_.updates();
+    const RibUpdateMonitor *monitor = updates->monitor();
+    const UpdateQueue *queue = updates->queue(RibOutUpdates::QUPDATE);
+
+    tbb::atomic<bool> send_blocked;
+    send_blocked = false;
+    Condition send_release;
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    scheduler->Enqueue(new SendBlockTask(&send_blocked, &send_release));
+    TASK_UTIL_EXPECT_TRUE(send_blocked);
+
+    uint64_t start = ClockMonotonicUsec();
+    BOOST_FOREACH(EnqueueTask *task, tasks) {
+        scheduler->Enqueue(task);
+    }
+    TASK_UTIL_WAIT_EQ_NO_MSG(kPartitions, done, 1000, 60000,
+                             "Wait for enqueue tasks");
+    uint64_t enqueue_usecs = ClockMonotonicUsec() - start;
+    EXPECT_EQ(total, monitor->lock_count());
+    EXPECT_EQ(total, queue->lock_count());
+    EXPECT_EQ(total, queue->size());
+    uint64_t enqueue_monitor_contended = monitor->lock_contended();
+    uint64_t enqueue_queue_contended = queue->lock_contended();
+    EXPECT_LE(enqueue_monitor_contended, total);
+    EXPECT_LE(enqueue_queue_contended, total);
+
+    start = ClockMonotonicUsec();
+    send_release.Set();
+    task_util::WaitForIdle(60);
+    uint64_t dequeue_usecs = ClockMonotonicUsec() - start;
+
+    // Every update was dequeued and sent to all the peers.
+    TASK_UTIL_EXPECT_TRUE(updates->Empty());
+    EXPECT_EQ(0U, queue->size());
+    uint64_t messages = peers_[0].update_count();
+    EXPECT_LT(0U, messages);
+    EXPECT_GE(total, messages);
+    for (int i = 1; i < kPeerCount; i++) {
+        EXPECT_EQ(messages, static_cast<uint64_t>(peers_[i].update_count()));
+    }
+    BOOST_FOREACH(BgpRoute *route, routes) {
+        const RouteState *rs = static_cast<const RouteState *>(
+            route->GetState(tbl1_.table(), tbl1_.listener_id()));
+        ASSERT_TRUE(rs != NULL);
+        const AdvertiseSList &adv_slist = rs->Advertised();
+        ASSERT_EQ(1, adv_slist->size());
+        EXPECT_TRUE(tbl1_.PeerSet() == adv_slist->begin()->bitset);
+    }
+
+    EXPECT_EQ(total + 3 * total + messages + 1, monitor->lock_count());
+    EXPECT_EQ(total + 3 * total + messages + 2, queue->lock_count());
+    EXPECT_LE(monitor->lock_contended(), monitor->lock_count());
+    EXPECT_LE(queue->lock_contended(), queue->lock_count());
+    EXPECT_EQ(0U, monitor->entry_wait_count());
+    BGP_DEBUG_UT(total << " updates from " << kPartitions <<
+        " partitions enqueued in " << enqueue_usecs <<
+        " usec, monitor lock " << enqueue_monitor_contended << "/" << total <<
+        " contended, queue lock " << enqueue_queue_contended << "/" << total <<
+        " contended");
+    BGP_DEBUG_UT(messages << " messages sent in " << dequeue_usecs <<
+        " usec, monitor lock " << monitor->lock_contended() << "/" <<
+        monitor->lock_count() << " contended, queue lock " <<
+        queue->lock_contended() << "/" << queue->lock_count() <<
+        " contended");
+    RibUpdateMonitor::set_lock_stats_enabled(false);
+    UpdateQueue::set_lock_stats_enabled(false);
+
+    BOOST_FOREACH(BgpRoute *route, routes) {
+        DeleteRouteState(&tbl1_, route);
+    }
+    STLDeleteValues(&routes);
+}
+
 class BgpUpdate2RibTest : public BgpUpdateTest {
 protected:
     typedef BgpUpdateTest Base;
@@ -519,6 +682,13 @@ TEST_F(BgpUpdate2RibTest, WithBlock) {
 static void SetUp() {
     bgp_log_test::init();
     ControlNode::SetDefaultSchedulingPolicy();
+
+    // Used by PartitionContention to hold the send task.
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    TaskPolicy send_block_policy = boost::assign::list_of
+        (TaskExclusion(scheduler->GetTaskId("bgp::SendTask")));
+    scheduler->SetPolicy(scheduler->GetTaskId("bgp::SendBlock"),
+                         send_block_policy);
 }
 
 static void TearDown() {
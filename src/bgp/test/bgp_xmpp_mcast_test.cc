@@ -786,10 +786,11 @@ TEST_F(BgpXmppMcastMultiAgentTest, Join) {
     VerifyOListElem(agent_xb_, "blue", mroute, 1, "10.1.1.1", agent_xa_);
     VerifyOListElem(agent_xc_, "blue", mroute, 1, "10.1.1.1", agent_xa_);
 
-    // Make sure that labels have changed for all agents.
-    TASK_UTIL_EXPECT_NE(label_xa,
+    // Make sure that labels have not changed for agents a and b and that
+    // agent c got a label.
+    TASK_UTIL_EXPECT_EQ(label_xa,
         VerifyLabel(agent_xa_, "blue", mroute, 10000, 19999));
-    TASK_UTIL_EXPECT_NE(label_xb,
+    TASK_UTIL_EXPECT_EQ(label_xb,
         VerifyLabel(agent_xb_, "blue", mroute, 20000, 29999));
     TASK_UTIL_EXPECT_NE(label_xc,
         VerifyLabel(agent_xc_, "blue", mroute, 30000, 39999));
@@ -840,10 +841,11 @@ TEST_F(BgpXmppMcastMultiAgentTest, Leave) {
     VerifyOListElem(agent_xb_, "blue", mroute, 1, "10.1.1.1", agent_xa_);
     VerifyOListElem(agent_xc_, "blue", mroute, 0);
 
-    // Make sure that labels have changed for all agents.
-    TASK_UTIL_EXPECT_NE(label_xa,
+    // Make sure that labels have not changed for agents a and b and that
+    // agent c no longer has a label.
+    TASK_UTIL_EXPECT_EQ(label_xa,
         VerifyLabel(agent_xa_, "blue", mroute, 10000, 19999));
-    TASK_UTIL_EXPECT_NE(label_xb,
+    TASK_UTIL_EXPECT_EQ(label_xb,
         VerifyLabel(agent_xb_, "blue", mroute, 20000, 29999));
     TASK_UTIL_EXPECT_NE(label_xc,
         VerifyLabel(agent_xc_, "blue", mroute));
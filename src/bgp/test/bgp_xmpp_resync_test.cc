@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <sstream>
+
+#include "base/task_annotations.h"
+#include "bgp/bgp_factory.h"
+#include "bgp/bgp_peer_membership.h"
+#include "bgp/bgp_ribout_digest.h"
+#include "bgp/bgp_session_manager.h"
+#include "bgp/bgp_xmpp_channel.h"
+#include "bgp/inet/inet_table.h"
+#include "bgp/test/bgp_server_test_util.h"
+#include "bgp/xmpp_message_builder.h"
+#include "control-node/control_node.h"
+#include "control-node/test/network_agent_mock.h"
+#include "io/test/event_manager_test.h"
+#include "xmpp/xmpp_factory.h"
+
+using namespace std;
+
+static const char *config_template = "\
+<config>\
+    <bgp-router name=\'X\'>\
+        <identifier>192.168.0.1</identifier>\
+        <address>127.0.0.1</address>\
+        <port>%d</port>\
+    </bgp-router>\
+    <virtual-network name='blue'>\
+        <network-id>1</network-id>\
+    </virtual-network>\
+    <routing-instance name='blue'>\
+        <virtual-network>blue</virtual-network>\
+        <vrf-target>target:1:1</vrf-target>\
+    </routing-instance>\
+</config>\
+";
+
+static string BuildPrefix(uint32_t idx) {
+    assert(idx <= 65535);
+    string prefix = string("10.1.") +
+        integerToString(idx / 255) + "." + integerToString(idx % 255) + "/32";
+    return prefix;
+}
+
+static string BuildMask(uint64_t mask) {
+    ostringstream oss;
+    oss << hex << mask;
+    return oss.str();
+}
+
+//
+// Control Node X.
+// Agent B advertises the routes, agent A reconnects with the digest of the
+// routes it kept.
+//
+class BgpXmppResyncTest : public ::testing::Test {
+protected:
+    static const int kRouteCount = 128;
+
+    BgpXmppResyncTest() : thread_(&evm_), xs_x_(NULL) {
+    }
+
+    virtual void SetUp() {
+        bs_x_.reset(new BgpServerTest(&evm_, "X"));
+        bs_x_->session_manager()->Initialize(0);
+        xs_x_ = new XmppServer(&evm_, test::XmppDocumentMock::kControlNodeJID);
+        xs_x_->Initialize(0, false);
+        cm_x_.reset(new BgpXmppChannelManager(xs_x_, bs_x_.get()));
+        cm_x_->set_ribout_resync_enabled(true);
+
+        thread_.Start();
+        Configure();
+        task_util::WaitForIdle();
+
+        agent_a_.reset(
+            new test::NetworkAgentMock(&evm_, "agent-a", xs_x_->GetPort(),
+                "127.0.0.1", "127.0.0.1"));
+        TASK_UTIL_EXPECT_TRUE(agent_a_->IsEstablished());
+        agent_b_.reset(
+            new test::NetworkAgentMock(&evm_, "agent-b", xs_x_->GetPort(),
+                "127.0.0.2", "127.0.0.1"));
+        TASK_UTIL_EXPECT_TRUE(agent_b_->IsEstablished());
+        TASK_UTIL_EXPECT_TRUE(cm_x_->FindChannel("agent-a") != NULL);
+        peer_name_ = cm_x_->FindChannel("agent-a")->Peer()->ToString();
+
+        agent_b_->Subscribe("blue", 1);
+        for (int idx = 1; idx <= kRouteCount; ++idx) {
+            agent_b_->AddRoute("blue", BuildPrefix(idx), "192.168.1.1");
+        }
+        task_util::WaitForIdle();
+    }
+
+    virtual void TearDown() {
+        xs_x_->Shutdown();
+        task_util::WaitForIdle();
+        bs_x_->Shutdown();
+        task_util::WaitForIdle();
+        cm_x_.reset();
+
+        TcpServerManager::DeleteServer(xs_x_);
+        xs_x_ = NULL;
+
+        if (agent_a_) { agent_a_->Delete(); }
+        if (agent_b_) { agent_b_->Delete(); }
+
+        evm_.Shutdown();
+        thread_.Join();
+        task_util::WaitForIdle();
+    }
+
+    void Configure() {
+        char config[4096];
+        snprintf(config, sizeof(config), config_template,
+                 bs_x_->session_manager()->GetPort());
+        bs_x_->Configure(config);
+    }
+
+    // Subscribe agent A to blue with the digest of the routes it kept and
+    // wait for the sync.
+    void SubscribeWithDigest(const RibOutDigest &digest,
+                             test::NetworkAgentMock::RibOutSync *sync) {
+        agent_a_->SetRibOutDigest("blue", "inet", digest.ToString());
+        agent_a_->Subscribe("blue", 1);
+        TASK_UTIL_EXPECT_TRUE(agent_a_->GetRibOutSync("blue", "inet", sync));
+        task_util::WaitForIdle();
+    }
+
+    // Take agent A down and get the snapshot of the routes advertised to it.
+    void SessionDownSnapshot(RibOutDigest *digest) {
+        PeerRibMembershipManager *mgr = bs_x_->membership_mgr();
+        agent_a_->SessionDown();
+        TASK_UTIL_EXPECT_EQ(1U, mgr->GetRibOutSnapshotCount());
+        EXPECT_TRUE(mgr->GetRibOutSnapshot(peer_name_, "blue.inet.0", digest));
+    }
+
+    void SessionUp() {
+        agent_a_->SessionUp();
+        TASK_UTIL_EXPECT_TRUE(agent_a_->IsEstablished());
+    }
+
+    int RouteBucket(const string &prefix) {
+        InetTable *table = static_cast<InetTable *>(
+            bs_x_->database()->FindTable("blue.inet.0"));
+        InetTable::RequestKey key(Ip4Prefix::FromString(prefix), NULL);
+        BgpRoute *route = static_cast<BgpRoute *>(table->Find(&key));
+        return (route ? RibOutDigest::RouteBucket(route) : -1);
+    }
+
+    bool CheckRoute(const string &prefix, const string &nexthop) {
+        const autogen::ItemType *rt = agent_a_->RouteLookup("blue", prefix);
+        if (!rt)
+            return false;
+        return (rt->entry.next_hops.next_hop[0].address == nexthop);
+    }
+
+    EventManager evm_;
+    ServerThread thread_;
+    BgpServerTestPtr bs_x_;
+    XmppServer *xs_x_;
+    test::NetworkAgentMockPtr agent_a_;
+    test::NetworkAgentMockPtr agent_b_;
+    boost::scoped_ptr<BgpXmppChannelManager> cm_x_;
+    string peer_name_;
+};
+
+//
+// An agent without a snapshot gets all the routes, then a sync with no
+// bucket in sync.
+//
+TEST_F(BgpXmppResyncTest, NoSnapshot) {
+    test::NetworkAgentMock::RibOutSync sync;
+    SubscribeWithDigest(RibOutDigest(), &sync);
+    TASK_UTIL_EXPECT_EQ(kRouteCount, agent_a_->RouteCount("blue"));
+    EXPECT_EQ(BuildMask(0), sync.mask);
+    EXPECT_EQ(static_cast<uint64_t>(kRouteCount), sync.route_updates);
+    EXPECT_EQ(agent_a_->inet_route_updates(), sync.route_updates);
+}
+
+//
+// An agent that comes back with the digest of the snapshot taken when it
+// went down gets no routes and all buckets in sync.
+//
+TEST_F(BgpXmppResyncTest, MatchingDigest) {
+    test::NetworkAgentMock::RibOutSync sync;
+    SubscribeWithDigest(RibOutDigest(), &sync);
+    TASK_UTIL_EXPECT_EQ(kRouteCount, agent_a_->RouteCount("blue"));
+
+    RibOutDigest digest;
+    SessionDownSnapshot(&digest);
+    SessionUp();
+    uint64_t route_updates = agent_a_->inet_route_updates();
+    SubscribeWithDigest(digest, &sync);
+
+    EXPECT_EQ(BuildMask(~0ULL), sync.mask);
+    EXPECT_EQ(0, agent_a_->RouteCount("blue"));
+    EXPECT_EQ(route_updates, agent_a_->inet_route_updates());
+    EXPECT_EQ(0U, bs_x_->membership_mgr()->GetRibOutSnapshotCount());
+}
+
+//
+// A route that changed while the agent was down makes its bucket dirty. The
+// routes of the bucket are sent again before the sync, which has all the
+// other buckets in sync.
+//
+TEST_F(BgpXmppResyncTest, ChangedRoute) {
+    test::NetworkAgentMock::RibOutSync sync;
+    SubscribeWithDigest(RibOutDigest(), &sync);
+    TASK_UTIL_EXPECT_EQ(kRouteCount, agent_a_->RouteCount("blue"));
+
+    RibOutDigest digest;
+    SessionDownSnapshot(&digest);
+    agent_b_->AddRoute("blue", BuildPrefix(1), "192.168.1.2");
+    task_util::WaitForIdle();
+
+    int bucket = RouteBucket(BuildPrefix(1));
+    ASSERT_LE(0, bucket);
+    int bucket_count = 0;
+    for (int idx = 1; idx <= kRouteCount; ++idx) {
+        if (RouteBucket(BuildPrefix(idx)) == bucket)
+            bucket_count++;
+    }
+
+    SessionUp();
+    uint64_t route_updates = agent_a_->inet_route_updates();
+    SubscribeWithDigest(digest, &sync);
+
+    EXPECT_EQ(BuildMask(~(1ULL << bucket)), sync.mask);
+    TASK_UTIL_EXPECT_EQ(bucket_count, agent_a_->RouteCount("blue"));
+    TASK_UTIL_EXPECT_TRUE(CheckRoute(BuildPrefix(1), "192.168.1.2"));
+    EXPECT_EQ(route_updates + bucket_count, sync.route_updates);
+    EXPECT_EQ(agent_a_->inet_route_updates(), sync.route_updates);
+}
+
+//
+// Digests are ignored and no snapshot is kept when resync is disabled.
+//
+TEST_F(BgpXmppResyncTest, Disabled) {
+    cm_x_->set_ribout_resync_enabled(false);
+
+    agent_a_->SetRibOutDigest("blue", "inet", RibOutDigest().ToString());
+    agent_a_->Subscribe("blue", 1);
+    TASK_UTIL_EXPECT_EQ(kRouteCount, agent_a_->RouteCount("blue"));
+    task_util::WaitForIdle();
+    test::NetworkAgentMock::RibOutSync sync;
+    EXPECT_FALSE(agent_a_->GetRibOutSync("blue", "inet", &sync));
+
+    agent_a_->SessionDown();
+    TASK_UTIL_EXPECT_FALSE(agent_a_->IsEstablished());
+    task_util::WaitForIdle();
+    EXPECT_EQ(0U, bs_x_->membership_mgr()->GetRibOutSnapshotCount());
+}
+
+class TestEnvironment : public ::testing::Environment {
+    virtual ~TestEnvironment() { }
+    virtual void SetUp() {
+    }
+    virtual void TearDown() {
+    }
+};
+
+static void SetUp() {
+    ControlNode::SetDefaultSchedulingPolicy();
+    BgpServerTest::GlobalSetUp();
+    BgpObjectFactory::Register<StateMachine>(
+        boost::factory<StateMachineTest *>());
+    BgpObjectFactory::Register<BgpXmppMessageBuilder>(
+        boost::factory<BgpXmppMessageBuilder *>());
+    XmppObjectFactory::Register<XmppStateMachine>(
+        boost::factory<XmppStateMachineTest *>());
+}
+
+static void TearDown() {
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    scheduler->Terminate();
+}
+
+int main(int argc, char **argv) {
+    bgp_log_test::init();
+    ::testing::InitGoogleTest(&argc, argv);
+    ::testing::AddGlobalTestEnvironment(new TestEnvironment());
+    SetUp();
+    int result = RUN_ALL_TESTS();
+    TearDown();
+
+    return result;
+}
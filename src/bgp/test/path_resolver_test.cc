@@ -7,6 +7,7 @@
 #include <boost/assign/list_of.hpp>
 #include <boost/foreach.hpp>
 
+#include "base/time_util.h"
 #include "bgp/bgp_factory.h"
 #include "bgp/bgp_session_manager.h"
 #include "bgp/extended-community/load_balance.h"
@@ -1861,6 +1862,101 @@ TYPED_TEST(PathResolverTest, Shutdown3) {
     TASK_UTIL_EXPECT_EQ(0, bgp_server->routing_instance_mgr()->count());
 }
 
+//
+// Benchmark re-resolution of a large number of BGP paths that resolve over
+// kNexthopCount nexthops. BGP paths for each prefix are added by both BGP
+// peers. A change to a single nexthop should only queue the BGP paths that
+// depend on it.
+//
+// BGP_PATH_RESOLVER_PATHS gives the number of BGP paths e.g. 100000.
+//
+TYPED_TEST(PathResolverTest, ScaleNexthopUpdate) {
+    static const int kNexthopCount = 100;
+    PeerMock *bgp_peer1 = this->bgp_peer1_;
+    PeerMock *bgp_peer2 = this->bgp_peer2_;
+    PeerMock *xmpp_peer1 = this->xmpp_peer1_;
+
+    int path_count = 10000;
+    if (getenv("BGP_PATH_RESOLVER_PATHS")) {
+        path_count = strtol(getenv("BGP_PATH_RESOLVER_PATHS"), NULL, 0);
+    }
+    int prefix_count = path_count / 2;
+    ASSERT_LE(prefix_count, 65535);
+    ASSERT_GE(prefix_count, kNexthopCount);
+
+    vector<string> nexthop_list;
+    for (int idx = 1; idx <= kNexthopCount; ++idx) {
+        string nexthop = "192.168.100." + integerToString(idx);
+        nexthop_list.push_back(nexthop);
+        this->AddXmppPath(xmpp_peer1, "blue", this->BuildPrefix(nexthop, 32),
+            this->BuildNextHopAddress("172.16.1.1"), 10000);
+    }
+    task_util::WaitForIdle();
+
+    uint64_t start = ClockMonotonicUsec();
+    for (int idx = 1; idx <= prefix_count; ++idx) {
+        string nexthop =
+            this->BuildHostAddress(nexthop_list[idx % kNexthopCount]);
+        this->AddBgpPath(bgp_peer1, "blue", this->BuildPrefix(idx), nexthop);
+        this->AddBgpPath(bgp_peer2, "blue", this->BuildPrefix(idx), nexthop);
+    }
+    task_util::WaitForIdle();
+    uint64_t add_usecs = ClockMonotonicUsec() - start;
+    for (int idx = 1; idx <= prefix_count; idx += prefix_count / 10) {
+        this->VerifyPathAttributes("blue", this->BuildPrefix(idx),
+            this->BuildNextHopAddress("172.16.1.1"), 10000);
+    }
+
+    // Change a single nexthop.
+    TASK_UTIL_EXPECT_EQ(0, this->ResolverPathUpdateListSize("blue"));
+    this->DisableResolverPathUpdateProcessing("blue");
+    this->AddXmppPath(xmpp_peer1, "blue",
+        this->BuildPrefix(nexthop_list[0], 32),
+        this->BuildNextHopAddress("172.16.1.1"), 10001);
+    TASK_UTIL_EXPECT_EQ(2 * (prefix_count / kNexthopCount),
+        this->ResolverPathUpdateListSize("blue"));
+    start = ClockMonotonicUsec();
+    this->EnableResolverPathUpdateProcessing("blue");
+    task_util::WaitForIdle();
+    uint64_t single_usecs = ClockMonotonicUsec() - start;
+    TASK_UTIL_EXPECT_EQ(0, this->ResolverPathUpdateListSize("blue"));
+    for (int idx = kNexthopCount; idx <= prefix_count; idx += kNexthopCount) {
+        this->VerifyPathAttributes("blue", this->BuildPrefix(idx),
+            this->BuildNextHopAddress("172.16.1.1"), 10001);
+    }
+
+    // Change all nexthops.
+    start = ClockMonotonicUsec();
+    for (int idx = 0; idx < kNexthopCount; ++idx) {
+        this->AddXmppPath(xmpp_peer1, "blue",
+            this->BuildPrefix(nexthop_list[idx], 32),
+            this->BuildNextHopAddress("172.16.1.1"), 10002);
+    }
+    task_util::WaitForIdle();
+    uint64_t all_usecs = ClockMonotonicUsec() - start;
+    for (int idx = 1; idx <= prefix_count; idx += prefix_count / 10) {
+        this->VerifyPathAttributes("blue", this->BuildPrefix(idx),
+            this->BuildNextHopAddress("172.16.1.1"), 10002);
+    }
+
+    LOG(DEBUG, prefix_count * 2 << " paths over " << kNexthopCount <<
+        " nexthops: add " << add_usecs << " usec, update single nexthop " <<
+        single_usecs << " usec, update all nexthops " << all_usecs << " usec");
+
+    for (int idx = 1; idx <= prefix_count; ++idx) {
+        this->DeleteBgpPath(bgp_peer1, "blue", this->BuildPrefix(idx));
+        this->DeleteBgpPath(bgp_peer2, "blue", this->BuildPrefix(idx));
+    }
+    for (int idx = 0; idx < kNexthopCount; ++idx) {
+        this->DeleteXmppPath(xmpp_peer1, "blue",
+            this->BuildPrefix(nexthop_list[idx], 32));
+    }
+    task_util::WaitForIdle();
+    for (int idx = 1; idx <= prefix_count; idx += prefix_count / 10) {
+        this->VerifyRouteNoExists("blue", this->BuildPrefix(idx));
+    }
+}
+
 class TestEnvironment : public ::testing::Environment {
     virtual ~TestEnvironment() { }
 };
@@ -12,6 +12,7 @@
 #include <pugixml/pugixml.hpp>
 
 #include "base/task_annotations.h"
+#include "base/time_util.h"
 #include "base/test/task_test_util.h"
 #include "bgp/bgp_config_ifmap.h"
 #include "bgp/bgp_config_parser.h"
@@ -2538,6 +2539,75 @@ TYPED_TEST(ServiceChainTest, ExtConnectRoute) {
     this->DeleteConnectedRoute(NULL, this->BuildPrefix("1.1.2.3", 32));
 }
 
+//
+// Convergence of the ServiceChain routes for a large number of external
+// connecting routes behind one chain, when the connected route moves to
+// another nexthop and when it's deleted. The routes are updated in a batch
+// in all partitions of the source table.
+// Run only if BGP_SERVICE_CHAIN_PREFIXES gives the number of prefixes,
+// e.g. 50000.
+//
+TYPED_TEST(ServiceChainTest, ExtConnectRouteScale) {
+    if (!getenv("BGP_SERVICE_CHAIN_PREFIXES")) {
+        return;
+    }
+    int prefix_count =
+        strtoul(getenv("BGP_SERVICE_CHAIN_PREFIXES"), NULL, 0);
+
+    vector<string> instance_names = list_of("blue")("blue-i1")("red-i2")("red");
+    multimap<string, string> connections =
+        map_list_of("blue", "blue-i1") ("red-i2", "red");
+    this->NetworkConfig(instance_names, connections);
+    this->VerifyNetworkConfig(instance_names);
+
+    this->SetServiceChainInformation("blue-i1",
+        "controller/src/bgp/testdata/service_chain_1.xml");
+
+    // Add Connected
+    this->AddConnectedRoute(NULL, this->BuildPrefix("1.1.2.3", 32), 100,
+                            this->BuildNextHopAddress("2.3.4.5"));
+    int blue_count = this->RouteCount("blue");
+
+    // Add Ext connect routes
+    vector<string> prefixes;
+    for (int idx = 0; idx < prefix_count; ++idx) {
+        Ip4Address addr(0x0a000000 + idx);
+        prefixes.push_back(this->BuildPrefix(addr.to_string(), 32));
+        this->AddRoute(NULL, "red", prefixes.back(), 100);
+    }
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(blue_count + prefix_count, this->RouteCount("blue"));
+
+    // Move the connected route to another nexthop
+    uint64_t start = ClockMonotonicUsec();
+    this->AddConnectedRoute(NULL, this->BuildPrefix("1.1.2.3", 32), 100,
+                            this->BuildNextHopAddress("2.3.4.6"));
+    uint64_t move_usecs = ClockMonotonicUsec() - start;
+    TASK_UTIL_EXPECT_TRUE(this->IsServiceChainQEmpty());
+    this->VerifyRouteAttributes("blue", prefixes.front(),
+                                this->BuildNextHopAddress("2.3.4.6"), "red");
+    this->VerifyRouteAttributes("blue", prefixes.back(),
+                                this->BuildNextHopAddress("2.3.4.6"), "red");
+
+    // Delete Connected route
+    start = ClockMonotonicUsec();
+    this->DeleteConnectedRoute(NULL, this->BuildPrefix("1.1.2.3", 32));
+    uint64_t delete_usecs = ClockMonotonicUsec() - start;
+    this->VerifyRouteNoExists("blue", prefixes.front());
+    this->VerifyRouteNoExists("blue", prefixes.back());
+
+    LOG(DEBUG, prefix_count << " prefixes behind ServiceChain, connected "
+        "route move " << move_usecs << " usec, delete " << delete_usecs <<
+        " usec");
+
+    // Delete Ext connect routes
+    for (vector<string>::const_iterator it = prefixes.begin();
+         it != prefixes.end(); ++it) {
+        this->DeleteRoute(NULL, "red", *it);
+    }
+    task_util::WaitForIdle();
+}
+
 //
 // 1. Create Service Chain with 192.168.1.0/24 as vn subnet
 // 2. Add MX leaked route 10.1.1.0/24
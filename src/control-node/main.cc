@@ -23,6 +23,8 @@
 #include "bgp/bgp_xmpp_sandesh.h"
 #include "bgp/bgp_server.h"
 #include "bgp/bgp_session_manager.h"
+#include "bgp/bgp_update_monitor.h"
+#include "bgp/bgp_update_queue.h"
 #include "bgp/bgp_xmpp_channel.h"
 #include "bgp/routing-instance/routing_instance.h"
 #include "bgp/routing-instance/rtarget_group_mgr.h"
@@ -576,6 +578,11 @@ int main(int argc, char *argv[]) {
 
     ControlNode::SetTestMode(options.test_mode());
 
+    // Enable lock statistics before the servers start so they cover all the
+    // updates.
+    UpdateQueue::set_lock_stats_enabled(options.update_lock_stats());
+    RibUpdateMonitor::set_lock_stats_enabled(options.update_lock_stats());
+
     boost::scoped_ptr<BgpServer> bgp_server(new BgpServer(&evm));
     sandesh_context.set_test_mode(ControlNode::GetTestMode());
     sandesh_context.bgp_server = bgp_server.get();
@@ -609,6 +616,8 @@ int main(int argc, char *argv[]) {
     // Create BGP and IFMap channel managers.
     boost::scoped_ptr<BgpXmppChannelManager> bgp_peer_manager(
         new BgpXmppChannelManager(xmpp_server, bgp_server.get()));
+    bgp_peer_manager->set_ribout_resync_enabled(
+        options.xmpp_adj_rib_out_resync());
     sandesh_context.xmpp_peer_manager = bgp_peer_manager.get();
     IFMapChannelManager ifmap_channel_mgr(xmpp_server, &ifmap_server);
     ifmap_server.set_ifmap_channel_manager(&ifmap_channel_mgr);
@@ -117,12 +117,17 @@ void Options::Initialize(EventManager &evm,
              "Enable control-node to run in test-mode")
         ("DEFAULT.tcp_hold_time", opt::value<int>()->default_value(30),
              "Configurable TCP hold time")
+        ("DEFAULT.update_lock_stats", opt::bool_switch(&update_lock_stats_),
+             "Keep lock statistics for the BGP update queues")
 
         ("DEFAULT.xmpp_server_port",
              opt::value<uint16_t>()->default_value(default_xmpp_port),
              "XMPP listener port")
         ("DEFAULT.xmpp_auth_enable", opt::bool_switch(&xmpp_auth_enable_),
              "Enable authentication over Xmpp")
+        ("DEFAULT.xmpp_adj_rib_out_resync",
+             opt::bool_switch(&xmpp_adj_rib_out_resync_),
+             "Resync reconnecting agents using their adj-rib-out digests")
         ("DEFAULT.xmpp_server_cert",
              opt::value<string>()->default_value(
              "/etc/contrail/ssl/certs/control-node-cert.pem"),
@@ -262,8 +267,11 @@ bool Options::Process(int argc, char *argv[],
     GetOptValue<bool>(var_map, use_syslog_, "DEFAULT.use_syslog");
     GetOptValue<string>(var_map, syslog_facility_, "DEFAULT.syslog_facility");
     GetOptValue<int>(var_map, tcp_hold_time_, "DEFAULT.tcp_hold_time");
+    GetOptValue<bool>(var_map, update_lock_stats_, "DEFAULT.update_lock_stats");
     GetOptValue<uint16_t>(var_map, xmpp_port_, "DEFAULT.xmpp_server_port");
     GetOptValue<bool>(var_map, xmpp_auth_enable_, "DEFAULT.xmpp_auth_enable");
+    GetOptValue<bool>(var_map, xmpp_adj_rib_out_resync_,
+                      "DEFAULT.xmpp_adj_rib_out_resync");
     GetOptValue<string>(var_map, xmpp_server_cert_, "DEFAULT.xmpp_server_cert");
     GetOptValue<string>(var_map, xmpp_server_key_, "DEFAULT.xmpp_server_key");
     GetOptValue<uint32_t>(var_map, sandesh_ratelimit_,
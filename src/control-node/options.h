@@ -38,11 +38,15 @@ public:
     const std::string ifmap_certs_store() const { return ifmap_certs_store_; }
     const uint16_t xmpp_port() const { return xmpp_port_; }
     const bool xmpp_auth_enabled() const { return xmpp_auth_enable_; }
+    const bool xmpp_adj_rib_out_resync() const {
+        return xmpp_adj_rib_out_resync_;
+    }
     const std::string xmpp_server_cert() const { return xmpp_server_cert_; }
     const std::string xmpp_server_key() const { return xmpp_server_key_; }
     const bool test_mode() const { return test_mode_; }
     const bool collectors_configured() const { return collectors_configured_; }
     const int tcp_hold_time() const { return tcp_hold_time_; }
+    const bool update_lock_stats() const { return update_lock_stats_; }
     const uint32_t sandesh_send_rate_limit() const { return sandesh_ratelimit_; }
 
 private:
@@ -88,11 +92,13 @@ private:
     std::string ifmap_certs_store_;
     uint16_t xmpp_port_;
     bool xmpp_auth_enable_;
+    bool xmpp_adj_rib_out_resync_;
     std::string xmpp_server_cert_;
     std::string xmpp_server_key_;
     bool test_mode_;
     bool collectors_configured_;
     int tcp_hold_time_;
+    bool update_lock_stats_;
     uint32_t sandesh_ratelimit_;
     std::vector<std::string> default_collector_server_list_;
     boost::program_options::options_description config_file_options_;
@@ -118,6 +118,20 @@ public:
         xml_attribute node = items.attribute("node");
 
         std::string nodename(node.value());
+        static const std::string kRibOutSyncNode("adj-rib-out-sync/");
+        if (nodename.compare(0, kRibOutSyncNode.size(), kRibOutSyncNode) == 0) {
+            std::string network = nodename.substr(kRibOutSyncNode.size());
+            for (xml_node item = items.first_child(); item;
+                 item = item.next_sibling()) {
+                RibOutSync sync;
+                sync.mask = item.child("sync").text().get();
+                sync.route_updates = parent_->inet_route_updates_;
+                parent_->ribout_syncs_[
+                    make_pair(network, item.attribute("id").value())] = sync;
+            }
+            return;
+        }
+
         bool inet_route = false;
         bool inet6_route = false;
         bool enet_route = false;
@@ -184,6 +198,7 @@ public:
                             new autogen::ItemType());
                     if (!rt_entry->XmlParse(item))
                         continue;
+                    parent_->inet_route_updates_++;
 
                     if (parent_->skip_updates_processing()) {
                         parent_->route_mgr_->Update(network, +1);
@@ -313,8 +328,9 @@ pugi::xml_document *XmppDocumentMock::RouteMcastDeleteXmlDoc(
 
 
 pugi::xml_document *XmppDocumentMock::SubscribeXmlDoc(
-        const std::string &network, int id, string type) {
-    return SubUnsubXmlDoc(network, id, true, type);
+        const std::string &network, int id, string type,
+        const RibOutDigestMap &digests) {
+    return SubUnsubXmlDoc(network, id, true, type, digests);
 }
 
 pugi::xml_document *XmppDocumentMock::UnsubscribeXmlDoc(
@@ -334,16 +350,25 @@ xml_node XmppDocumentMock::PubSubHeader(string type) {
 }
 
 pugi::xml_document *XmppDocumentMock::SubUnsubXmlDoc(
-        const std::string &network, int id, bool sub, string type) {
+        const std::string &network, int id, bool sub, string type,
+        const RibOutDigestMap &digests) {
     xdoc_->reset();
     xml_node pubsub = PubSubHeader(type);
     xml_node subscribe = pubsub.append_child(
             sub ? "subscribe" : "unsubscribe" );
     subscribe.append_attribute("node") = network.c_str();
-    if (id >= 0) {
+    if (id >= 0 || !digests.empty()) {
         xml_node options = pubsub.append_child("options");
-        xml_node instance_id = options.append_child("instance-id");
-        instance_id.text().set(id);
+        if (id >= 0) {
+            xml_node instance_id = options.append_child("instance-id");
+            instance_id.text().set(id);
+        }
+        for (RibOutDigestMap::const_iterator it = digests.begin();
+             it != digests.end(); ++it) {
+            xml_node digest = options.append_child("adj-rib-out-digest");
+            digest.append_attribute("family") = it->first.c_str();
+            digest.text().set(it->second.c_str());
+        }
     }
     return xdoc_.get();
 }
@@ -757,6 +782,7 @@ NetworkAgentMock::NetworkAgentMock(EventManager *evm, const string &hostname,
       server_address_(server_address), local_address_(local_address),
       server_port_(server_port), skip_updates_processing_(false), down_(false),
       xmpp_auth_enabled_(xmpp_auth_enabled) {
+    inet_route_updates_ = 0;
 
     // Static initialization of NetworkAgentMock class.
     Initialize();
@@ -785,6 +811,37 @@ NetworkAgentMock::NetworkAgentMock(EventManager *evm, const string &hostname,
     down_ = false;
 }
 
+void NetworkAgentMock::SetRibOutDigest(const string &network,
+                                       const string &family,
+                                       const string &digest) {
+    tbb::mutex::scoped_lock lock(mutex_);
+    if (digest.empty()) {
+        ribout_digests_[network].erase(family);
+    } else {
+        ribout_digests_[network][family] = digest;
+    }
+}
+
+XmppDocumentMock::RibOutDigestMap NetworkAgentMock::GetRibOutDigests(
+        const string &network) const {
+    std::map<string, XmppDocumentMock::RibOutDigestMap>::const_iterator loc =
+        ribout_digests_.find(network);
+    if (loc == ribout_digests_.end())
+        return XmppDocumentMock::RibOutDigestMap();
+    return loc->second;
+}
+
+bool NetworkAgentMock::GetRibOutSync(const string &network,
+                                     const string &family, RibOutSync *sync) {
+    tbb::mutex::scoped_lock lock(mutex_);
+    std::map<pair<string, string>, RibOutSync>::const_iterator loc =
+        ribout_syncs_.find(make_pair(network, family));
+    if (loc == ribout_syncs_.end())
+        return false;
+    *sync = loc->second;
+    return true;
+}
+
 void NetworkAgentMock::DisableRead(bool disable_read) {
     XmppConnection *connection;
 
@@ -806,6 +863,7 @@ void NetworkAgentMock::ClearInstances() {
     mcast_route_mgr_->Clear();
     vrouter_mgr_->Clear();
     vm_mgr_->Clear();
+    ribout_syncs_.clear();
 }
 
 NetworkAgentMock::~NetworkAgentMock() {
@@ -1210,7 +1268,8 @@ void NetworkAgentMock::InstanceMgr<T>::Subscribe(const std::string &network,
         return;
 
     xml_document *xdoc;
-    xdoc = parent_->GetXmlHandler()->SubscribeXmlDoc(network, id, type_);
+    xdoc = parent_->GetXmlHandler()->SubscribeXmlDoc(network, id, type_,
+        parent_->GetRibOutDigests(network));
 
     AgentPeer *peer = parent_->GetAgent();
     assert(peer != NULL);
@@ -9,6 +9,7 @@
 #include <boost/shared_ptr.hpp>
 #include <map>
 #include <pugixml/pugixml.hpp>
+#include <tbb/atomic.h>
 #include <tbb/compat/condition_variable>
 #include <tbb/mutex.h>
 
@@ -209,8 +210,13 @@ public:
                                             const std::string &encap);
     pugi::xml_document *RouteMcastDeleteXmlDoc(const std::string &network, 
                                                const std::string &sg);
+    // Map of family to adj-rib-out digest sent with a subscribe request.
+    typedef std::map<std::string, std::string> RibOutDigestMap;
+
     pugi::xml_document *SubscribeXmlDoc(const std::string &network, int id,
-                                        std::string type = kNetworkServiceJID);
+                                        std::string type = kNetworkServiceJID,
+                                        const RibOutDigestMap &digests =
+                                            RibOutDigestMap());
     pugi::xml_document *UnsubscribeXmlDoc(const std::string &network, int id,
                                         std::string type = kNetworkServiceJID);
 
@@ -222,7 +228,8 @@ public:
 private:
     pugi::xml_node PubSubHeader(std::string type);
     pugi::xml_document *SubUnsubXmlDoc(
-            const std::string &network, int id, bool sub, std::string type);
+            const std::string &network, int id, bool sub, std::string type,
+            const RibOutDigestMap &digests = RibOutDigestMap());
     pugi::xml_document *Inet6RouteAddDeleteXmlDoc(const std::string &network,
             const std::string &prefix, Oper oper,
             const NextHops &nexthops = NextHops(),
@@ -270,6 +277,14 @@ public:
     typedef autogen::VirtualMachine VMEntry;
     typedef std::map<std::string, VMEntry *> VMTable;
 
+    // Adj-rib-out sync received for a network and family, and the number of
+    // inet routes received until then.
+    struct RibOutSync {
+        RibOutSync() : route_updates(0) { }
+        std::string mask;
+        uint64_t route_updates;
+    };
+
     template <typename T>
     class Instance {
     public:
@@ -461,6 +476,17 @@ public:
                        const std::string &encap = "");
     void DeleteMcastRoute(const std::string &network, const std::string &sg);
 
+    // Send the digest with subscribe requests for the network and family.
+    // An empty digest is not sent.
+    void SetRibOutDigest(const std::string &network, const std::string &family,
+                         const std::string &digest);
+    // Called with the mutex held.
+    XmppDocumentMock::RibOutDigestMap GetRibOutDigests(
+        const std::string &network) const;
+    bool GetRibOutSync(const std::string &network, const std::string &family,
+                       RibOutSync *sync);
+    uint64_t inet_route_updates() const { return inet_route_updates_; }
+
     bool IsEstablished();
     bool IsSessionEstablished();
     void ClearInstances();
@@ -518,6 +544,9 @@ private:
     int server_port_;
     bool skip_updates_processing_;
     bool down_;
+    std::map<std::string, XmppDocumentMock::RibOutDigestMap> ribout_digests_;
+    std::map<std::pair<std::string, std::string>, RibOutSync> ribout_syncs_;
+    tbb::atomic<uint64_t> inet_route_updates_;
     tbb::mutex mutex_;
     tbb::mutex work_mutex_;
 
@@ -76,6 +76,8 @@ TEST_F(OptionsTest, NoArguments) {
     EXPECT_EQ(options_.ifmap_user(), "control-node");
     EXPECT_EQ(options_.ifmap_certs_store(), "");
     EXPECT_EQ(options_.xmpp_port(), default_xmpp_port);
+    EXPECT_EQ(options_.xmpp_adj_rib_out_resync(), false);
+    EXPECT_EQ(options_.update_lock_stats(), false);
     EXPECT_EQ(options_.test_mode(), false);
     EXPECT_EQ(options_.sandesh_send_rate_limit(), 0);
 }
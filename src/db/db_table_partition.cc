@@ -43,7 +43,10 @@ bool DBTablePartBase::RunNotify() {
         DBEntryBase *entry = &change_list_.front();
         change_list_.pop_front();
 
+        notify_seq_++;
+        notify_entry_ = entry;
         parent()->RunNotify(this, entry);
+        notify_entry_ = NULL;
         entry->clear_onlist();
 
         // If the entry is marked deleted and all DBStates are removed
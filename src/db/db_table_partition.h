@@ -25,7 +25,8 @@ public:
 
 
     DBTablePartBase(DBTableBase *tbl_base, int index)
-        : parent_(tbl_base), index_(index) {
+        : parent_(tbl_base), index_(index), notify_seq_(0),
+          notify_entry_(NULL) {
     }
 
     // Input processing stage for DBRequests. Called from per-partition thread.
@@ -40,6 +41,13 @@ public:
     DBTableBase *parent() { return parent_; }
     int index() const { return index_; }
 
+    // Entry whose change notification is being run by the listeners and
+    // the sequence number of that notification. Listeners can use these
+    // to share work done for the same notification. Entry is NULL outside
+    // of RunNotify.
+    const DBEntryBase *notify_entry() const { return notify_entry_; }
+    uint64_t notify_seq() const { return notify_seq_; }
+
     virtual void Remove(DBEntryBase *) = 0;
 
     void Delete(DBEntryBase *);
@@ -59,6 +67,8 @@ private:
     DBTableBase *parent_;
     int index_;
     ChangeList change_list_;
+    uint64_t notify_seq_;
+    const DBEntryBase *notify_entry_;
     DISALLOW_COPY_AND_ASSIGN(DBTablePartBase);
 };
 
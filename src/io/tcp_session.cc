@@ -6,7 +6,6 @@
 
 #include <boost/asio.hpp>
 #include <boost/bind.hpp>
-#include <boost/scoped_array.hpp>
 #include <boost/asio/detail/socket_option.hpp>
 
 #include "base/logging.h"
@@ -59,6 +58,7 @@ TcpSession::TcpSession(
       established_(false),
       closed_(false),
       direction_(ACTIVE),
+      max_free_buffers_(0),
       writer_(new TcpMessageWriter(this)),
       name_("-") {
     refcount_ = 0;
@@ -79,15 +79,29 @@ TcpSession::~TcpSession() {
         DeleteBuffer(*iter);
     }
     buffer_queue_.clear();
+    for (BufferQueue::iterator iter = free_buffer_queue_.begin();
+         iter != free_buffer_queue_.end(); ++iter) {
+        DeleteBuffer(*iter);
+    }
+    free_buffer_queue_.clear();
 }
 
+//
+// Take a buffer released by an earlier read if one is available, so that a
+// session receiving a steady stream of data reads into a small ring of
+// buffers instead of going to the heap for every read.
+//
 mutable_buffer TcpSession::AllocateBuffer() {
-    u_int8_t *data = new u_int8_t[buffer_size_];
-    mutable_buffer buffer = mutable_buffer(data, buffer_size_);
-    {
-        tbb::mutex::scoped_lock lock(mutex_);
-        buffer_queue_.push_back(buffer);
+    tbb::mutex::scoped_lock lock(mutex_);
+    mutable_buffer buffer;
+    if (!free_buffer_queue_.empty()) {
+        buffer = free_buffer_queue_.front();
+        free_buffer_queue_.pop_front();
+    } else {
+        u_int8_t *data = new u_int8_t[buffer_size_];
+        buffer = mutable_buffer(data, buffer_size_);
     }
+    buffer_queue_.push_back(buffer);
     return buffer;
 }
 
@@ -117,7 +131,7 @@ void TcpSession::ReleaseBufferLocked(Buffer buffer) {
     for (BufferQueue::iterator iter = buffer_queue_.begin();
          iter != buffer_queue_.end(); ++iter) {
         if (BufferCmp(*iter, buffer) == 0) {
-            DeleteBuffer(*iter);
+            RecycleBufferLocked(*iter);
             buffer_queue_.erase(iter);
             return;
         }
@@ -125,6 +139,15 @@ void TcpSession::ReleaseBufferLocked(Buffer buffer) {
     assert(false);
 }
 
+void TcpSession::RecycleBufferLocked(mutable_buffer buffer) {
+    if (buffer_size(buffer) == (size_t) buffer_size_ &&
+        free_buffer_queue_.size() < max_free_buffers_) {
+        free_buffer_queue_.push_back(buffer);
+        return;
+    }
+    DeleteBuffer(buffer);
+}
+
 bool TcpSession::AsyncReadHandlerProcess(boost::asio::mutable_buffer buffer,
                                          size_t &bytes_transferred,
                                          boost::system::error_code &error) {
@@ -520,6 +543,15 @@ int TcpMessageReader::AllocBufferSize(int length) {
     return bufsize;
 }
 
+// Returns the scratch buffer, grown to hold a message of length if needed.
+uint8_t *TcpMessageReader::ScratchBuffer(int length) {
+    size_t size = max(AllocBufferSize(length), length);
+    if (scratch_.size() < size) {
+        scratch_.resize(size);
+    }
+    return &scratch_[0];
+}
+
 uint8_t *TcpMessageReader::BufferConcat(uint8_t *data, Buffer buffer,
                                         int msglength) {
     uint8_t *dst = data;
@@ -607,8 +639,8 @@ void TcpMessageReader::OnRead(Buffer buffer) {
                 queue_.push_back(buffer);
                 return;
             }
-            boost::scoped_array<uint8_t> data(new uint8_t[kHeaderLenSize]);
-            Buffer header = PullUp(data.get(), buffer, kHeaderLenSize);
+            uint8_t *data = ScratchBuffer(kHeaderLenSize);
+            Buffer header = PullUp(data, buffer, kHeaderLenSize);
             assert(TcpSession::BufferSize(header) == (size_t) kHeaderLenSize);
 
             msglength = MsgLength(header, 0);
@@ -623,12 +655,11 @@ void TcpMessageReader::OnRead(Buffer buffer) {
         }
 
         // concat the buffers into a contiguous message.
-        boost::scoped_array<uint8_t>
-            data(new uint8_t[AllocBufferSize(msglength)]);
-        BufferConcat(data.get(), buffer, msglength);
+        uint8_t *data = ScratchBuffer(msglength);
+        BufferConcat(data, buffer, msglength);
         assert(remain_ == -1);
         // Receive the message
-        bool success = callback_(data.get(), msglength);
+        bool success = callback_(data, msglength);
         if (!success)
             return;
     }
@@ -800,5 +831,20 @@ void TcpSession::GetTxSocketStats(SocketIOStats &socket_stats) const {
 }
 
 void TcpSession::SetBufferSize(int buffer_size) {
+    tbb::mutex::scoped_lock lock(mutex_);
     buffer_size_ = buffer_size;
+    for (BufferQueue::iterator iter = free_buffer_queue_.begin();
+         iter != free_buffer_queue_.end(); ++iter) {
+        DeleteBuffer(*iter);
+    }
+    free_buffer_queue_.clear();
+}
+
+void TcpSession::SetMaxFreeBuffers(size_t max_free_buffers) {
+    tbb::mutex::scoped_lock lock(mutex_);
+    max_free_buffers_ = max_free_buffers;
+    while (free_buffer_queue_.size() > max_free_buffers_) {
+        DeleteBuffer(free_buffer_queue_.back());
+        free_buffer_queue_.pop_back();
+    }
 }
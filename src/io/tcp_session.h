@@ -7,6 +7,7 @@
 
 #include <list>
 #include <deque>
+#include <vector>
 
 #include <boost/asio/buffer.hpp>
 #include <boost/asio/io_service.hpp>
@@ -74,6 +75,9 @@ public:
     virtual std::string ToString() const { return name_; }
 
     void SetBufferSize(int buffer_size);
+    // Number of released receive buffers kept for reuse by later reads.
+    // Off by default, set by session types that receive a steady stream.
+    void SetMaxFreeBuffers(size_t max_free_buffers);
 
     // Getters and setters
     virtual Socket *socket() const { return socket_.get(); }
@@ -213,6 +217,7 @@ private:
 
     void DeferWriter();
     void ReleaseBufferLocked(Buffer buffer);
+    void RecycleBufferLocked(boost::asio::mutable_buffer buffer);
     void SetEstablished(Endpoint remote, Direction dir);
 
     bool IsClosedLocked() const {
@@ -238,6 +243,8 @@ private:
     Endpoint remote_;           // Remote end-point
     Direction direction_;       // direction (active, passive)
     BufferQueue buffer_queue_;
+    BufferQueue free_buffer_queue_;
+    size_t max_free_buffers_;
     boost::system::error_code close_reason_;
     /**************** end protected by mutex_ ****************/
 
@@ -270,7 +277,10 @@ inline void intrusive_ptr_release(TcpSession *session) {
 // TcpMessageReader
 //
 // Provides base implementation of OnRead() for TcpSession assuming
-// fixed message header length
+// fixed message header length. Messages that are contiguous in a receive
+// buffer are passed to the callback in place, only messages that span
+// buffers are copied into a scratch buffer that is reused across messages.
+// The callback must not retain the message after it returns.
 //
 class TcpMessageReader {
 public:
@@ -297,10 +307,12 @@ private:
     Buffer PullUp(uint8_t *data, Buffer buffer, size_t size) const;
 
     int AllocBufferSize(int length);
+    uint8_t *ScratchBuffer(int length);
 
     TcpSession *session_;
     ReceiveCallback callback_;
     BufferQueue queue_;
+    std::vector<uint8_t> scratch_;
     int offset_;
     int remain_;
 
@@ -60,12 +60,12 @@ public:
 
     // Use this constructor if automatic index allocation is *not* needed
     KSyncEntry() : index_(kInvalidIndex), state_(INIT), seen_(false),
-    stale_(false), del_add_pending_(false) {
+    stale_(false), del_add_pending_(false), pipelined_acks_(0) {
         refcount_ = 0;
     };
     // Use this constructor if automatic index allocation is needed
     KSyncEntry(uint32_t index) : index_(index), state_(INIT), seen_(false),
-    stale_(false), del_add_pending_(false) {
+    stale_(false), del_add_pending_(false), pipelined_acks_(0) {
         refcount_ = 0;
     };
     virtual ~KSyncEntry() { assert(refcount_ == 0);};
@@ -119,6 +119,7 @@ public:
     size_t GetIndex() const {return index_;};
     KSyncState GetState() const {return state_;};
     bool del_add_pending() const {return del_add_pending_;}
+    uint32_t pipelined_acks() const {return pipelined_acks_;}
     uint32_t GetRefCount() const {return refcount_;} 
     bool Seen() const {return seen_;}
     bool stale() const {return stale_;}
@@ -135,6 +136,7 @@ public:
     bool IsActive() { return (state_ != TEMP && !IsDeleted()); }
 
     void set_del_add_pending(bool pending) {del_add_pending_ = pending;}
+    void set_pipelined_acks(uint32_t acks) {pipelined_acks_ = acks;}
 
 protected:
     void SetIndex(size_t index) {index_ = index;};
@@ -160,6 +162,10 @@ private:
     // this is set to true when Delete Add operation cannot go
     // through as entry is waiting of Ack for previous operation
     bool                del_add_pending_;
+
+    // Number of ACKs outstanding for messages superseded by a pipelined
+    // Change. These ACKs are consumed without generating an event
+    uint32_t            pipelined_acks_;
     DISALLOW_COPY_AND_ASSIGN(KSyncEntry);
 };
 
@@ -82,6 +82,19 @@ bool KSyncNetlinkEntry::Delete() {
 ///////////////////////////////////////////////////////////////////////////////
 // KSyncNetlinkDBEntry routines
 ///////////////////////////////////////////////////////////////////////////////
+// In multi-socket mode, messages are sent on the socket of DB partition for
+// the entry. An entry with messages waiting for ACK always has its DBEntry
+// set, so messages for an entry are ordered on one socket. Delete is sent
+// only after the earlier messages are acked and can go on any socket
+KSyncSock *KSyncNetlinkDBEntry::GetSock() {
+    DBEntry *entry = GetDBEntry();
+    if (KSyncSock::multi_socket() == false || entry == NULL ||
+        entry->get_table_partition() == NULL) {
+        return KSyncSock::Get(0);
+    }
+    return KSyncSock::Get(entry->get_table_partition());
+}
+
 bool KSyncNetlinkDBEntry::Add() {
     int len = MsgLen();
     char *msg = (char *)malloc(len);
@@ -91,7 +104,7 @@ bool KSyncNetlinkDBEntry::Add() {
         free(msg);
         return true;
     }
-    KSyncSock   *sock = KSyncSock::Get(0);
+    KSyncSock   *sock = GetSock();
     sock->SendAsync(this, msg_len, msg, KSyncEntry::ADD_ACK);
     return false;
 }
@@ -105,7 +118,7 @@ bool KSyncNetlinkDBEntry::Change() {
         free(msg);
         return true;
     }
-    KSyncSock   *sock = KSyncSock::Get(0);
+    KSyncSock   *sock = GetSock();
     sock->SendAsync(this, msg_len, msg, KSyncEntry::CHANGE_ACK);
     return false;
 }
@@ -119,7 +132,7 @@ bool KSyncNetlinkDBEntry::Delete() {
         free(msg);
         return true;
     }
-    KSyncSock   *sock = KSyncSock::Get(0);
+    KSyncSock   *sock = GetSock();
     sock->SendAsync(this, msg_len, msg, KSyncEntry::DEL_ACK);
     return false;
 }
@@ -9,6 +9,7 @@
 #include <tbb/atomic.h>
 
 class KSyncObject;
+class KSyncSock;
 
 // Implementation of KSyncEntry with Netlink ASIO as backend to send message
 // Use this class in cases where KSyncEntry state-machine should be controlled
@@ -66,6 +67,8 @@ public:
     bool Change();
     bool Delete();
 private:
+    // Socket to send messages of the entry on
+    KSyncSock *GetSock();
     DISALLOW_COPY_AND_ASSIGN(KSyncNetlinkDBEntry);
 };
 
@@ -29,6 +29,7 @@
 
 KSyncObject::FwdRefTree  KSyncObject::fwd_ref_tree_;
 KSyncObject::BackRefTree  KSyncObject::back_ref_tree_;
+bool KSyncObject::resolve_on_ack_;
 KSyncObjectManager *KSyncObjectManager::singleton_ = NULL;
 std::auto_ptr<KSyncEntry> KSyncObjectManager::default_defer_entry_;
 bool KSyncDebug::debug_;
@@ -40,7 +41,8 @@ void TestTriggerStaleEntryCleanupCb(KSyncObject *obj) {
 }
 
 KSyncObject::KSyncObject(const std::string &name) : need_index_(false), index_table_(),
-                         delete_scheduled_(false), stale_entry_tree_(),
+                         delete_scheduled_(false), pipelined_(false),
+                         pipelined_changes_(0), stale_entry_tree_(),
                          stale_entry_cleanup_timer_(NULL),
                          stale_entry_cleanup_intvl_(0),
                          stale_entries_per_intvl_(0) {
@@ -49,7 +51,8 @@ KSyncObject::KSyncObject(const std::string &name) : need_index_(false), index_ta
 
 KSyncObject::KSyncObject(const std::string &name, int max_index) :
                          need_index_(true), index_table_(max_index),
-                         delete_scheduled_(false), stale_entry_tree_(),
+                         delete_scheduled_(false), pipelined_(false),
+                         pipelined_changes_(0), stale_entry_tree_(),
                          stale_entry_cleanup_timer_(NULL),
                          stale_entry_cleanup_intvl_(0),
                          stale_entries_per_intvl_(0) {
@@ -439,6 +442,9 @@ bool KSyncEntry::IsResolved() {
         return false;
     if (IsDataResolved() == false)
         return false;
+    if (KSyncObject::resolve_on_ack() &&
+        (state_ == SYNC_WAIT || state_ == NEED_SYNC))
+        return false;
     return ((state_ >= IN_SYNC) && (state_ < DEL_DEFER_SYNC));
 }
 
@@ -942,7 +948,10 @@ KSyncEntry::KSyncState KSyncSM_InSync(KSyncObject *obj, KSyncEntry *entry,
 }
 
 // Entry waiting on ACK or Add or Change
-// If event is change request, move to NEED_SYNC
+// If event is change request, move to NEED_SYNC. For pipelined objects the
+// Change is sent right away when the entry is resolved, messages on the
+// socket are processed in order and the ACK for the last message sent
+// moves the entry out of SYNC_WAIT
 // If event is delete request, move to DEL_DEFER for references to drop
 KSyncEntry::KSyncState KSyncSM_SyncWait(KSyncObject *obj, KSyncEntry *entry,
                                         KSyncEntry::KSyncEvent event) {
@@ -951,6 +960,17 @@ KSyncEntry::KSyncState KSyncSM_SyncWait(KSyncObject *obj, KSyncEntry *entry,
     assert(entry->GetRefCount());
     switch (event) {
     case KSyncEntry::ADD_CHANGE_REQ:
+        // Compress further changes into NEED_SYNC once the pipeline is full
+        if (obj->pipelined() && entry->Seen() &&
+            entry->del_add_pending() == false &&
+            entry->pipelined_acks() + 1 < KSyncObject::kMaxPipelinedMsgs &&
+            entry->UnresolvedReference() == NULL) {
+            obj->pipelined_changes_++;
+            if (entry->Change() == false) {
+                entry->set_pipelined_acks(entry->pipelined_acks() + 1);
+            }
+            break;
+        }
         state = KSyncEntry::NEED_SYNC;
         break;
 
@@ -1251,6 +1271,14 @@ void KSyncObject::NotifyEvent(KSyncEntry *entry, KSyncEntry::KSyncEvent event) {
         KSYNC_TRACE(Event, this, entry->ToString(), entry->StateString(),
                     entry->EventString(event));
     }
+
+    // ACK of a message superseded by a pipelined Change. State is moved
+    // only by the ACK of the last message sent
+    if ((event == KSyncEntry::ADD_ACK || event == KSyncEntry::CHANGE_ACK) &&
+        entry->pipelined_acks()) {
+        entry->set_pipelined_acks(entry->pipelined_acks() - 1);
+        return;
+    }
     switch (entry->GetState()) {
         case KSyncEntry::INIT:
             state = KSyncSM_Init(this, entry, event);
@@ -1281,6 +1309,8 @@ void KSyncObject::NotifyEvent(KSyncEntry *entry, KSyncEntry::KSyncEvent event) {
             break;
 
         case KSyncEntry::NEED_SYNC:
+            // Resolved only on getting ACK when resolve_on_ack_ is set
+            dep_reval = resolve_on_ack_;
             state = KSyncSM_NeedSync(this, entry, event);
             break;
 
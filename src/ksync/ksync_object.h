@@ -66,6 +66,9 @@ struct KSyncBackReference {
 
 class KSyncObject {
 public:
+    // Max messages for an entry that can be waiting for ACK at a time
+    static const uint32_t kMaxPipelinedMsgs = 2;
+
     typedef boost::intrusive::member_hook<KSyncEntry,
             boost::intrusive::set_member_hook<>,
             &KSyncEntry::node_> KSyncObjectNode;
@@ -136,6 +139,15 @@ public:
     static void Shutdown();
 
     std::size_t Size() { return tree_.size(); }
+    // Pipelined objects send a Change while an earlier message for the
+    // entry is waiting for ACK, instead of holding it till the ACK arrives
+    bool pipelined() const { return pipelined_; }
+    void set_pipelined(bool pipelined) { pipelined_ = pipelined; }
+    uint64_t pipelined_changes() const { return pipelined_changes_; }
+    // When set, an entry waiting for ACK of Add or Change is not resolved
+    // and entries referring to it are written after the ACK
+    static bool resolve_on_ack() { return resolve_on_ack_; }
+    static void set_resolve_on_ack(bool resolve) { resolve_on_ack_ = resolve; }
     void set_delete_scheduled() { delete_scheduled_ = true;}
     bool delete_scheduled() { return delete_scheduled_;}
     virtual SandeshTraceBufferPtr GetKSyncTraceBuf() {return KSyncTraceBuf;}
@@ -154,6 +166,9 @@ protected:
 private:
     friend class KSyncEntry;
     friend void TestTriggerStaleEntryCleanupCb(KSyncObject *obj);
+    friend KSyncEntry::KSyncState KSyncSM_SyncWait(KSyncObject *obj,
+                                                   KSyncEntry *entry,
+                                                   KSyncEntry::KSyncEvent event);
 
     // Free indication of an KSyncElement. 
     // Removes from tree and free index if allocated earlier
@@ -174,12 +189,16 @@ private:
     static FwdRefTree  fwd_ref_tree_;
     // Back reference tree
     static BackRefTree  back_ref_tree_;
+    static bool resolve_on_ack_;
     // Does the KSyncEntry need index?
     bool need_index_;
     // Index table for KSyncObject
     KSyncIndexTable index_table_;
     // scheduled for deletion
     bool delete_scheduled_;
+    bool pipelined_;
+    // Changes sent while waiting for ACK of an earlier message
+    uint64_t pipelined_changes_;
 
     // stale entry tree
     std::set<KSyncEntry::KSyncEntryPtr> stale_entry_tree_;
@@ -47,6 +47,7 @@ typedef boost::asio::detail::socket_option::integer<SOL_SOCKET,
 int KSyncSock::vnsw_netlink_family_id_;
 AgentSandeshContext *KSyncSock::agent_sandesh_ctx_;
 std::vector<KSyncSock *> KSyncSock::sock_table_;
+bool KSyncSock::multi_socket_;
 pid_t KSyncSock::pid_;
 tbb::atomic<bool> KSyncSock::shutdown_;
 
@@ -178,10 +179,15 @@ static void DecodeSandeshMessages(char *buf, uint32_t buf_len,
 // KSyncSock routines
 /////////////////////////////////////////////////////////////////////////////
 KSyncSock::KSyncSock() :
+    async_send_queue_(NULL),
     max_bulk_msg_count_(kMaxBulkMsgCount), max_bulk_buf_size_(kMaxBulkMsgSize),
-    bulk_seq_no_(-1), tx_count_(0), err_count_(0), read_inline_(true) {
+    bulk_seq_no_(-1), tx_count_(0), err_count_(0), read_inline_(true),
+    send_task_instance_(-1), tx_msg_count_(0), tx_bulk_count_(0),
+    tx_bytes_(0), rx_msg_count_(0) {
     TaskScheduler *scheduler = TaskScheduler::GetInstance();
     uint32_t task_id = 0;
+    // Responses on all sockets are processed in task instance 0, KSync
+    // state machines are not run in parallel
     for(int i = 0; i < IoContext::MAX_WORK_QUEUES; i++) {
         task_id = scheduler->GetTaskId(IoContext::io_wq_names[i]);
         receive_work_queue[i] =
@@ -189,13 +195,6 @@ KSyncSock::KSyncSock() :
                                   boost::bind(&KSyncSock::ProcessKernelData,
                                               this, _1));
     }
-    task_id = scheduler->GetTaskId("Ksync::AsyncSend");
-    async_send_queue_ =
-        new WorkQueue<IoContext *>(task_id, 0,
-                                   boost::bind(&KSyncSock::SendAsyncImpl, this,
-                                               _1));
-    async_send_queue_->SetExitCallback
-        (boost::bind(&KSyncSock::SendTaskExit, this, _1));
     nl_client_ = (nl_client *)malloc(sizeof(nl_client));
     bzero(nl_client_, sizeof(nl_client));
     rx_buff_ = NULL;
@@ -211,9 +210,11 @@ KSyncSock::~KSyncSock() {
         rx_buff_ = NULL;
     }
 
-    assert(async_send_queue_->Length() == 0);
-    async_send_queue_->Shutdown();
-    delete async_send_queue_;
+    if (async_send_queue_) {
+        assert(async_send_queue_->Length() == 0);
+        async_send_queue_->Shutdown();
+        delete async_send_queue_;
+    }
 
     for(int i = 0; i < IoContext::MAX_WORK_QUEUES; i++) {
         receive_work_queue[i]->Shutdown();
@@ -254,8 +255,31 @@ void KSyncSock::Start(bool read_inline) {
     }
 }
 
+// Send queue is created when socket is added to the table, with the index
+// of socket as task instance. A socket shared by many partitions sends from
+// the instance of the first partition
 void KSyncSock::SetSockTableEntry(int i, KSyncSock *sock) {
     sock_table_[i] = sock;
+    if (sock->async_send_queue_ == NULL) {
+        sock->CreateSendQueue(i);
+    }
+}
+
+void KSyncSock::CreateSendQueue(int task_instance) {
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    send_task_instance_ = task_instance;
+    async_send_queue_ =
+        new WorkQueue<IoContext *>(scheduler->GetTaskId("Ksync::AsyncSend"),
+                                   task_instance,
+                                   boost::bind(&KSyncSock::SendAsyncImpl, this,
+                                               _1));
+    async_send_queue_->SetExitCallback
+        (boost::bind(&KSyncSock::SendTaskExit, this, _1));
+}
+
+void KSyncSock::set_multi_socket(bool multi_socket) {
+    multi_socket_ = multi_socket;
+    KSyncObject::set_resolve_on_ack(multi_socket);
 }
 
 void KSyncSock::SetNetlinkFamilyId(int id) {
@@ -338,6 +362,7 @@ bool KSyncSock::ProcessKernelData(char *data) {
     }
     KSyncBulkSandeshContext *bulk_context = &(it->second);
 
+    rx_msg_count_++;
     BulkDecoder(data, bulk_context);
     // Remove the IoContext only on last netlink message
     if (IsMoreData(data) == false) {
@@ -417,6 +442,9 @@ int KSyncSock::SendBulkMessage(KSyncBulkSandeshContext *bulk_context,
     KSyncBufferList iovec;
     // Get all buffers to send into single io-vector
     bulk_context->Data(&iovec);
+    tx_bulk_count_++;
+    tx_msg_count_ += bulk_msg_count_;
+    tx_bytes_ += bulk_buf_size_;
 
     if (!read_inline_) {
         AsyncSendTo(&iovec, seqno,
@@ -245,6 +245,24 @@ public:
     // Partition to KSyncSock mapping
     static KSyncSock *Get(DBTablePartBase *partition);
     static KSyncSock *Get(int partition_id);
+    static uint32_t SockCount() {return sock_table_.size();}
+
+    // In multi-socket mode KSyncDBEntries are sent on the socket of their
+    // DB partition. Sockets are not ordered with respect to each other, so
+    // an entry is taken as resolved only after kernel has acked it
+    static bool multi_socket() {return multi_socket_;}
+    static void set_multi_socket(bool multi_socket);
+
+    // Per socket stats
+    uint64_t tx_msg_count() const {return tx_msg_count_;}
+    uint64_t tx_bulk_count() const {return tx_bulk_count_;}
+    uint64_t tx_bytes() const {return tx_bytes_;}
+    uint64_t rx_msg_count() const {return rx_msg_count_;}
+    std::size_t ack_wait_count() {
+        tbb::mutex::scoped_lock lock(mutex_);
+        return wait_tree_.size();
+    }
+    int send_task_instance() const {return send_task_instance_;}
 
     static uint32_t GetPid() {return pid_;};
     static int GetNetlinkFamilyId() {return vnsw_netlink_family_id_;}
@@ -303,6 +321,7 @@ private:
 
     bool ProcessKernelData(char *data);
     bool SendAsyncImpl(IoContext *ioc);
+    void CreateSendQueue(int task_instance);
     bool SendAsyncStart() {
         tbb::mutex::scoped_lock lock(mutex_);
         return (wait_tree_.size() <= KSYNC_ACK_WAIT_THRESHOLD);
@@ -319,7 +338,16 @@ private:
     int err_count_;
     bool read_inline_;
 
+    // Send task of every socket runs in its own task instance
+    int send_task_instance_;
+    // Messages and bulk messages sent, netlink messages received
+    uint64_t tx_msg_count_;
+    uint64_t tx_bulk_count_;
+    uint64_t tx_bytes_;
+    uint64_t rx_msg_count_;
+
     static std::vector<KSyncSock *> sock_table_;
+    static bool multi_socket_;
     static pid_t pid_;
     static int vnsw_netlink_family_id_;
     static AgentSandeshContext *agent_sandesh_ctx_;
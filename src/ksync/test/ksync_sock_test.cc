@@ -0,0 +1,556 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <iostream>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/time_util.h"
+#include "testing/gunit.h"
+
+#include "db/db.h"
+#include "db/db_entry.h"
+#include "db/db_table.h"
+#include "db/db_table_partition.h"
+
+#include "ksync/ksync_index.h"
+#include "ksync/ksync_entry.h"
+#include "ksync/ksync_netlink.h"
+#include "ksync/ksync_object.h"
+#include "ksync/ksync_sock.h"
+
+#include "base/test/task_test_util.h"
+
+using namespace std;
+
+class TestObject;
+TestObject *test_object_;
+
+// Time taken by kernel to process a bulk message, the netlink send returns
+// after kernel has processed the messages
+static const uint32_t kKernelLatencyUsec = 200;
+static const int kTestMsgLen = 64;
+
+// User space stand-in for the vrouter socket. Each bulk message is taken as
+// processed in kKernelLatencyUsec and acked with success for every message
+// in it
+class KSyncSockLoopback : public KSyncSock {
+public:
+    struct Response {
+        uint32_t seqno;
+        uint32_t count;
+    };
+
+    KSyncSockLoopback() : KSyncSock() {
+        memset(&response_, 0, sizeof(response_));
+    }
+    virtual ~KSyncSockLoopback() { }
+
+    static void Init(int count) {
+        KSyncSock::Init(count);
+        for (int i = 0; i < count; i++) {
+            KSyncSock::SetSockTableEntry(i, new KSyncSockLoopback());
+        }
+    }
+
+    virtual uint32_t GetSeqno(char *data) {
+        return reinterpret_cast<Response *>(data)->seqno;
+    }
+    virtual bool IsMoreData(char *data) { return false; }
+    virtual bool Validate(char *data) { return true; }
+    virtual bool Decoder(char *data, AgentSandeshContext *ctxt) {
+        return true;
+    }
+
+    // Every message in the bulk is acked by a vr_response
+    virtual bool BulkDecoder(char *data, KSyncBulkSandeshContext *ctxt) {
+        Response *resp = reinterpret_cast<Response *>(data);
+        for (uint32_t i = 0; i < resp->count; i++) {
+            vr_response vr_resp;
+            vr_resp.set_resp_code(0);
+            ctxt->VrResponseMsgHandler(&vr_resp);
+        }
+        return ctxt->Decoder(NULL, 0, 1, false);
+    }
+
+    virtual void AsyncReceive(boost::asio::mutable_buffers_1, HandlerCb) { }
+    virtual void AsyncSendTo(KSyncBufferList *iovec, uint32_t seq_no,
+                             HandlerCb cb) {
+        SendTo(iovec, seq_no);
+    }
+    virtual std::size_t SendTo(KSyncBufferList *iovec, uint32_t seq_no) {
+        usleep(kKernelLatencyUsec);
+        response_.seqno = seq_no;
+        response_.count = iovec->size();
+        return bulk_buf_size_;
+    }
+    virtual void Receive(boost::asio::mutable_buffers_1 buf) {
+        memcpy(boost::asio::buffer_cast<char *>(buf), &response_,
+               sizeof(response_));
+    }
+
+private:
+    Response response_;
+};
+
+class TestSandeshContext : public AgentSandeshContext {
+public:
+    TestSandeshContext() : AgentSandeshContext() { }
+    virtual ~TestSandeshContext() { }
+
+    virtual void IfMsgHandler(vr_interface_req *req) { }
+    virtual void NHMsgHandler(vr_nexthop_req *req) { }
+    virtual void RouteMsgHandler(vr_route_req *req) { }
+    virtual void MplsMsgHandler(vr_mpls_req *req) { }
+    virtual int VrResponseMsgHandler(vr_response *resp) {
+        return 0;
+    }
+    virtual void MirrorMsgHandler(vr_mirror_req *req) { }
+    virtual void FlowMsgHandler(vr_flow_req *req) { }
+    virtual void VrfAssignMsgHandler(vr_vrf_assign_req *req) { }
+    virtual void VrfStatsMsgHandler(vr_vrf_stats_req *req) { }
+    virtual void DropStatsMsgHandler(vr_drop_stats_req *req) { }
+    virtual void VxLanMsgHandler(vr_vxlan_req *req) { }
+    virtual void VrouterOpsMsgHandler(vrouter_ops *req) { }
+};
+
+// Entry sent on the socket given by its id, optionally referring to another
+// entry
+class TestEntry : public KSyncEntry {
+public:
+    TestEntry(uint32_t id, TestEntry *dep) :
+        KSyncEntry(), id_(id), dep_(dep) {
+    }
+    virtual ~TestEntry() { }
+
+    virtual bool IsLess(const KSyncEntry &rhs) const {
+        const TestEntry &entry = static_cast<const TestEntry &>(rhs);
+        return id_ < entry.id_;
+    }
+    std::string ToString() const { return "Test"; }
+
+    virtual bool Add() {
+        // Referred entry must be in kernel before the entry is sent
+        if (dep_.get() && dep_->GetState() != KSyncEntry::IN_SYNC) {
+            unordered_count_++;
+        }
+        Send(KSyncEntry::ADD_ACK);
+        return false;
+    }
+    virtual bool Change() {
+        Send(KSyncEntry::CHANGE_ACK);
+        return false;
+    }
+    virtual bool Delete() {
+        Send(KSyncEntry::DEL_ACK);
+        return false;
+    }
+    KSyncObject *GetObject();
+    KSyncEntry *UnresolvedReference() {
+        if (dep_.get() == NULL || dep_->IsResolved())
+            return NULL;
+        return dep_.get();
+    }
+
+    void Send(KSyncEntry::KSyncEvent event) {
+        char *msg = (char *)malloc(kTestMsgLen);
+        memset(msg, 0, kTestMsgLen);
+        KSyncSock *sock = KSyncSock::Get(id_ % KSyncSock::SockCount());
+        sock->SendAsync(this, kTestMsgLen, msg, event);
+    }
+
+    uint32_t id() const { return id_; }
+    TestEntry *dep() const { return static_cast<TestEntry *>(dep_.get()); }
+
+    static tbb::atomic<uint32_t> unordered_count_;
+
+private:
+    uint32_t id_;
+    KSyncEntryPtr dep_;
+    DISALLOW_COPY_AND_ASSIGN(TestEntry);
+};
+tbb::atomic<uint32_t> TestEntry::unordered_count_;
+
+class TestObject : public KSyncObject {
+public:
+    TestObject() : KSyncObject("Test KSync") { }
+    virtual ~TestObject() { }
+
+    virtual KSyncEntry *Alloc(const KSyncEntry *key, uint32_t index) {
+        const TestEntry *entry = static_cast<const TestEntry *>(key);
+        return new TestEntry(entry->id(), entry->dep());
+    }
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(TestObject);
+};
+
+KSyncObject *TestEntry::GetObject() {
+    return test_object_;
+}
+
+// DB entry spread over the table partitions by its id
+class TestDBEntry : public DBEntry {
+public:
+    struct Key : public DBRequestKey {
+        explicit Key(uint32_t id) : DBRequestKey(), id_(id) { }
+        virtual ~Key() { }
+        uint32_t id_;
+    };
+
+    explicit TestDBEntry(uint32_t id) : DBEntry(), id_(id) { }
+    virtual ~TestDBEntry() { }
+
+    bool IsLess(const DBEntry &rhs) const {
+        const TestDBEntry &entry = static_cast<const TestDBEntry &>(rhs);
+        return id_ < entry.id_;
+    }
+    virtual std::string ToString() const { return "TestDB"; }
+    virtual void SetKey(const DBRequestKey *key) {
+        id_ = static_cast<const Key *>(key)->id_;
+    }
+    virtual KeyPtr GetDBRequestKey() const {
+        return DBEntryBase::KeyPtr(new Key(id_));
+    }
+
+    uint32_t id() const { return id_; }
+
+private:
+    uint32_t id_;
+    DISALLOW_COPY_AND_ASSIGN(TestDBEntry);
+};
+
+class TestDBTable : public DBTable {
+public:
+    TestDBTable(DB *db, const std::string &name) : DBTable(db, name) { }
+    virtual ~TestDBTable() { }
+
+    virtual std::auto_ptr<DBEntry> AllocEntry(const DBRequestKey *k) const {
+        const TestDBEntry::Key *key = static_cast<const TestDBEntry::Key *>(k);
+        return std::auto_ptr<DBEntry>(new TestDBEntry(key->id_));
+    }
+    virtual size_t Hash(const DBEntry *entry) const {
+        return static_cast<const TestDBEntry *>(entry)->id();
+    }
+    virtual size_t Hash(const DBRequestKey *key) const {
+        return static_cast<const TestDBEntry::Key *>(key)->id_;
+    }
+    virtual DBEntry *Add(const DBRequest *req) {
+        const TestDBEntry::Key *key =
+            static_cast<const TestDBEntry::Key *>(req->key.get());
+        return new TestDBEntry(key->id_);
+    }
+    virtual bool OnChange(DBEntry *entry, const DBRequest *req) {
+        return true;
+    }
+    virtual bool Delete(DBEntry *entry, const DBRequest *req) {
+        return true;
+    }
+
+    static DBTableBase *CreateTable(DB *db, const std::string &name) {
+        TestDBTable *table = new TestDBTable(db, name);
+        table->Init();
+        return table;
+    }
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(TestDBTable);
+};
+
+class TestNetlinkObject;
+TestNetlinkObject *test_netlink_object_;
+
+// KSync entry sent by KSyncNetlinkDBEntry on the socket it picks for the
+// partition of its DB entry
+class TestNetlinkEntry : public KSyncNetlinkDBEntry {
+public:
+    explicit TestNetlinkEntry(uint32_t id) : KSyncNetlinkDBEntry(), id_(id) { }
+    virtual ~TestNetlinkEntry() { }
+
+    virtual bool IsLess(const KSyncEntry &rhs) const {
+        const TestNetlinkEntry &entry =
+            static_cast<const TestNetlinkEntry &>(rhs);
+        return id_ < entry.id_;
+    }
+    virtual std::string ToString() const { return "TestNetlink"; }
+    virtual KSyncEntry *UnresolvedReference() { return NULL; }
+    virtual bool Sync(DBEntry *entry) { return false; }
+    KSyncDBObject *GetObject();
+
+    virtual int AddMsg(char *msg, int len) { return Msg(msg, len); }
+    virtual int ChangeMsg(char *msg, int len) { return Msg(msg, len); }
+    virtual int DeleteMsg(char *msg, int len) { return Msg(msg, len); }
+
+    uint32_t id() const { return id_; }
+
+private:
+    int Msg(char *msg, int len) {
+        memset(msg, 0, kTestMsgLen);
+        return kTestMsgLen;
+    }
+
+    uint32_t id_;
+    DISALLOW_COPY_AND_ASSIGN(TestNetlinkEntry);
+};
+
+class TestNetlinkObject : public KSyncDBObject {
+public:
+    explicit TestNetlinkObject(DBTableBase *table) :
+        KSyncDBObject("Test Netlink KSync", table) {
+    }
+    virtual ~TestNetlinkObject() { }
+
+    virtual KSyncEntry *Alloc(const KSyncEntry *key, uint32_t index) {
+        const TestNetlinkEntry *entry =
+            static_cast<const TestNetlinkEntry *>(key);
+        return new TestNetlinkEntry(entry->id());
+    }
+    virtual KSyncEntry *DBToKSyncEntry(const DBEntry *e) {
+        const TestDBEntry *entry = static_cast<const TestDBEntry *>(e);
+        return new TestNetlinkEntry(entry->id());
+    }
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(TestNetlinkObject);
+};
+
+KSyncDBObject *TestNetlinkEntry::GetObject() {
+    return test_netlink_object_;
+}
+
+class KSyncSockTest : public ::testing::Test {
+public:
+    KSyncSockTest() : db_table_(NULL) {
+    }
+
+    virtual void SetUp() {
+        TestEntry::unordered_count_ = 0;
+    }
+
+    void Init(int count, bool multi_socket) {
+        KSyncSockLoopback::Init(count);
+        KSyncSock::set_multi_socket(multi_socket);
+        KSyncSock::Start(true);
+    }
+
+    void Shutdown() {
+        KSyncSock::set_multi_socket(false);
+        KSyncSock::Shutdown();
+    }
+
+    TestEntry *Add(uint32_t id, TestEntry *dep) {
+        TestEntry key(id, dep);
+        return static_cast<TestEntry *>(test_object_->Create(&key));
+    }
+
+    // Adds count entries and waits till they are acked. Returns time taken
+    uint64_t AddEntries(uint32_t count, std::vector<TestEntry *> *entries) {
+        uint64_t start = ClockMonotonicUsec();
+        for (uint32_t i = 0; i < count; i++) {
+            entries->push_back(Add(i, NULL));
+        }
+        task_util::WaitForIdle();
+        return ClockMonotonicUsec() - start;
+    }
+
+    void DeleteEntries(std::vector<TestEntry *> *entries) {
+        for (std::vector<TestEntry *>::reverse_iterator it = entries->rbegin();
+             it != entries->rend(); ++it) {
+            test_object_->Delete(*it);
+        }
+        entries->clear();
+        task_util::WaitForIdle();
+        EXPECT_EQ(0U, test_object_->Size());
+    }
+
+    uint64_t TxMsgCount() {
+        uint64_t count = 0;
+        for (uint32_t i = 0; i < KSyncSock::SockCount(); i++) {
+            count += KSyncSock::Get(i)->tx_msg_count();
+        }
+        return count;
+    }
+
+    // Enqueue a DB request for each of the ids and wait till the KSync
+    // messages for them are acked
+    void DBRequests(TestDBTable *table, uint32_t count,
+                    DBRequest::DBOperation oper) {
+        for (uint32_t i = 0; i < count; i++) {
+            DBRequest req;
+            req.oper = oper;
+            req.key.reset(new TestDBEntry::Key(i));
+            table->Enqueue(&req);
+        }
+        task_util::WaitForIdle();
+    }
+
+    // Adds count DB entries, and returns the number of entries in each
+    // partition
+    std::vector<uint64_t> AddDBEntries(uint32_t count) {
+        db_table_ =
+            static_cast<TestDBTable *>(db_.CreateTable("db.test.ksync.0"));
+        test_netlink_object_ = new TestNetlinkObject(db_table_);
+
+        DBRequests(db_table_, count, DBRequest::DB_ENTRY_ADD_CHANGE);
+        EXPECT_EQ(count, db_table_->Size());
+        std::vector<uint64_t> partition_count(DB::PartitionCount());
+        for (uint32_t i = 0; i < count; i++) {
+            TestDBEntry key(i);
+            DBEntry *entry = db_table_->Find(&key);
+            EXPECT_TRUE(entry != NULL);
+            partition_count[entry->get_table_partition()->index()]++;
+            TestNetlinkEntry ksync_key(i);
+            KSyncEntry *ksync = test_netlink_object_->Find(&ksync_key);
+            EXPECT_TRUE(ksync != NULL);
+            EXPECT_EQ(KSyncEntry::IN_SYNC, ksync->GetState());
+        }
+        return partition_count;
+    }
+
+    void DeleteDBEntries(uint32_t count) {
+        DBRequests(db_table_, count, DBRequest::DB_ENTRY_DELETE);
+        EXPECT_EQ(0U, test_netlink_object_->Size());
+        delete test_netlink_object_;
+        test_netlink_object_ = NULL;
+        db_.RemoveTable(db_table_);
+        delete db_table_;
+        db_table_ = NULL;
+    }
+
+    DB db_;
+    TestDBTable *db_table_;
+};
+
+// Every socket sends from a task instance of its own
+TEST_F(KSyncSockTest, SendTaskInstance) {
+    Init(4, true);
+    for (uint32_t i = 0; i < KSyncSock::SockCount(); i++) {
+        EXPECT_EQ((int)i, KSyncSock::Get(i)->send_task_instance());
+    }
+
+    std::vector<TestEntry *> entries;
+    AddEntries(400, &entries);
+    for (uint32_t i = 0; i < KSyncSock::SockCount(); i++) {
+        KSyncSock *sock = KSyncSock::Get(i);
+        EXPECT_EQ(100U, sock->tx_msg_count());
+        EXPECT_EQ(sock->tx_bulk_count(), sock->rx_msg_count());
+        EXPECT_EQ(0U, sock->ack_wait_count());
+    }
+    for (std::vector<TestEntry *>::iterator it = entries.begin();
+         it != entries.end(); ++it) {
+        EXPECT_EQ(KSyncEntry::IN_SYNC, (*it)->GetState());
+    }
+    DeleteEntries(&entries);
+    EXPECT_EQ(800U, TxMsgCount());
+    Shutdown();
+}
+
+// Sockets are not ordered with respect to each other. In multi-socket mode
+// an entry referring to another entry is sent only after the referred entry
+// is acked by kernel
+TEST_F(KSyncSockTest, DependencyOrder) {
+    Init(4, true);
+    std::vector<TestEntry *> entries;
+    for (uint32_t i = 0; i < 200; i += 2) {
+        TestEntry *nh = Add(i, NULL);
+        entries.push_back(nh);
+        entries.push_back(Add(i + 1, nh));
+    }
+    task_util::WaitForIdle();
+    EXPECT_EQ(0U, TestEntry::unordered_count_);
+    for (std::vector<TestEntry *>::iterator it = entries.begin();
+         it != entries.end(); ++it) {
+        EXPECT_EQ(KSyncEntry::IN_SYNC, (*it)->GetState());
+    }
+    DeleteEntries(&entries);
+    Shutdown();
+}
+
+// In multi-socket mode, messages for a DB entry are sent on the socket of its
+// table partition
+TEST_F(KSyncSockTest, NetlinkDBEntryMultiSocket) {
+    const uint32_t kEntries = 64 * DB::PartitionCount();
+    Init(DB::PartitionCount(), true);
+    std::vector<uint64_t> partition_count = AddDBEntries(kEntries);
+    for (int i = 0; i < DB::PartitionCount(); i++) {
+        EXPECT_NE(0U, partition_count[i]);
+        EXPECT_EQ(partition_count[i], KSyncSock::Get(i)->tx_msg_count());
+    }
+
+    // Delete is sent on the socket of the partition too
+    DeleteDBEntries(kEntries);
+    for (int i = 0; i < DB::PartitionCount(); i++) {
+        EXPECT_EQ(2 * partition_count[i], KSyncSock::Get(i)->tx_msg_count());
+    }
+    Shutdown();
+}
+
+// Without multi-socket, all the messages are sent on socket 0
+TEST_F(KSyncSockTest, NetlinkDBEntrySingleSocket) {
+    const uint32_t kEntries = 64 * DB::PartitionCount();
+    Init(DB::PartitionCount(), false);
+    AddDBEntries(kEntries);
+    EXPECT_EQ(kEntries, KSyncSock::Get(0)->tx_msg_count());
+    EXPECT_EQ(kEntries, TxMsgCount());
+    DeleteDBEntries(kEntries);
+    EXPECT_EQ(2 * kEntries, KSyncSock::Get(0)->tx_msg_count());
+    EXPECT_EQ(2 * kEntries, TxMsgCount());
+    Shutdown();
+}
+
+// Time to add 20k entries on a single socket and on a socket per partition
+TEST_F(KSyncSockTest, Scale) {
+    const uint32_t kEntries = 20000;
+    const int kSockets = 4;
+    std::vector<TestEntry *> entries;
+
+    Init(kSockets, false);
+    uint64_t single = 0;
+    {
+        // All entries on socket 0 as in single socket mode
+        uint64_t start = ClockMonotonicUsec();
+        for (uint32_t i = 0; i < kEntries; i++) {
+            entries.push_back(Add(i * kSockets, NULL));
+        }
+        task_util::WaitForIdle();
+        single = ClockMonotonicUsec() - start;
+    }
+    EXPECT_EQ(kEntries, KSyncSock::Get(0)->tx_msg_count());
+    uint64_t single_bulks = KSyncSock::Get(0)->tx_bulk_count();
+    DeleteEntries(&entries);
+    Shutdown();
+
+    Init(kSockets, true);
+    uint64_t multi = AddEntries(kEntries, &entries);
+    EXPECT_EQ(kEntries, TxMsgCount());
+    for (int i = 0; i < kSockets; i++) {
+        EXPECT_EQ(kEntries / kSockets, KSyncSock::Get(i)->tx_msg_count());
+        EXPECT_EQ(0U, KSyncSock::Get(i)->ack_wait_count());
+    }
+    DeleteEntries(&entries);
+    Shutdown();
+
+    cout << "Single socket : " << kEntries << " entries " << single_bulks
+        << " bulk messages " << single << " usec" << endl;
+    cout << kSockets << " sockets     : " << kEntries << " entries "
+        << multi << " usec" << endl;
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    LoggingInit();
+
+    KSyncSock::SetAgentSandeshContext(new TestSandeshContext());
+    DB::RegisterFactory("db.test.ksync.0", &TestDBTable::CreateTable);
+    test_object_ = new TestObject();
+    KSyncObjectManager::Init();
+    int ret = RUN_ALL_TESTS();
+    task_util::WaitForIdle();
+    delete test_object_;
+    KSyncObjectManager::Shutdown();
+    return ret;
+}
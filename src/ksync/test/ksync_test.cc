@@ -2,8 +2,10 @@
  * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
  */
 
+#include <stdlib.h>
 #include <iostream>
 #include <fstream>
+#include <vector>
 
 #include "db/db.h"
 #include "db/db_table.h"
@@ -23,9 +25,13 @@
 
 using namespace std;
 class VlanTable;
+class Vlan;
 
 VlanTable *vlan_table_;
 
+// Messages sent to kernel and the ACK event each of them generates
+typedef std::vector<std::pair<Vlan *, KSyncEntry::KSyncEvent> > VlanMsgList;
+
 KSyncObjectManager *object_manager;
 
 class Vlan : public KSyncEntry {
@@ -77,9 +83,15 @@ public:
         delete_count_++;
         if (tag_ >= 0xF00 && tag_ < 0xFE0)
             return true;
+        SendMsg(KSyncEntry::DEL_ACK);
         return false;
     };
 
+    void SendMsg(KSyncEntry::KSyncEvent ack) {
+        if (msg_list_ != NULL)
+            msg_list_->push_back(std::make_pair(this, ack));
+    }
+
     bool AllowDeleteStateComp() {return all_delete_state_comp_;}
     KSyncObject *GetObject();
     KSyncEntry *UnresolvedReference() {
@@ -101,6 +113,8 @@ public:
     static uint32_t delete_count_;
     static uint32_t change_count_;
     static uint32_t free_wait_count_;
+    // When set, async operations are queued here for the test to ACK
+    static VlanMsgList *msg_list_;
 
     uint16_t tag_;
     uint16_t dep_tag_;
@@ -113,6 +127,7 @@ uint32_t Vlan::add_count_;
 uint32_t Vlan::delete_count_;
 uint32_t Vlan::change_count_;
 uint32_t Vlan::free_wait_count_;
+VlanMsgList *Vlan::msg_list_;
 
 class VlanTable : public KSyncObject {
 public:
@@ -171,6 +186,7 @@ bool Vlan::Add() {
 
     if (tag_ >= 0xF00)
         return true;
+    SendMsg(KSyncEntry::ADD_ACK);
     return false;
 }
 
@@ -185,6 +201,7 @@ bool Vlan::Change() {
 
     if (tag_ >= 0xF00)
         return true;
+    SendMsg(KSyncEntry::CHANGE_ACK);
     return false;
 };
 
@@ -1118,6 +1135,163 @@ TEST_F(TestUT, DeleteAddEvent) {
     vlan_table_->Delete(vlan2);
 }
 
+// Pipelined object sends Change while Add is waiting for ACK. ACK of the
+// superseded Add is consumed, ACK of the Change moves entry to IN_SYNC
+TEST_F(TestUT, pipelined_change) {
+    vlan_table_->set_pipelined(true);
+    Vlan *vlan1 = AddVlan(0x101, 0, KSyncEntry::SYNC_WAIT, Vlan::ADD, 0);
+    ChangeVlan(vlan1, 0, KSyncEntry::SYNC_WAIT, Vlan::CHANGE);
+    EXPECT_EQ(1U, vlan1->pipelined_acks());
+    EXPECT_EQ(1U, Vlan::change_count_);
+
+    // Pipeline is full, further changes are compressed in NEED_SYNC
+    ChangeVlan(vlan1, 0, KSyncEntry::NEED_SYNC, Vlan::CHANGE);
+    ChangeVlan(vlan1, 0, KSyncEntry::NEED_SYNC, Vlan::CHANGE);
+    EXPECT_EQ(1U, Vlan::change_count_);
+
+    vlan_table_->NetlinkAck(vlan1, KSyncEntry::ADD_ACK);
+    EXPECT_EQ(vlan1->GetState(), KSyncEntry::NEED_SYNC);
+    EXPECT_EQ(0U, vlan1->pipelined_acks());
+    vlan_table_->NetlinkAck(vlan1, KSyncEntry::CHANGE_ACK);
+    EXPECT_EQ(vlan1->GetState(), KSyncEntry::SYNC_WAIT);
+    EXPECT_EQ(2U, Vlan::change_count_);
+    vlan_table_->NetlinkAck(vlan1, KSyncEntry::CHANGE_ACK);
+    EXPECT_EQ(vlan1->GetState(), KSyncEntry::IN_SYNC);
+
+    vlan_table_->Delete(vlan1);
+    EXPECT_EQ(vlan1->GetState(), KSyncEntry::DEL_ACK_WAIT);
+    vlan_table_->NetlinkAck(vlan1, KSyncEntry::DEL_ACK);
+    EXPECT_EQ(1U, Vlan::delete_count_);
+    vlan_table_->set_pipelined(false);
+}
+
+// Delete while pipelined messages are waiting for ACK is sent after the
+// ACK of the last message
+TEST_F(TestUT, pipelined_delete) {
+    vlan_table_->set_pipelined(true);
+    Vlan *vlan1 = AddVlan(0x101, 0, KSyncEntry::SYNC_WAIT, Vlan::ADD, 0);
+    ChangeVlan(vlan1, 0, KSyncEntry::SYNC_WAIT, Vlan::CHANGE);
+    vlan_table_->Delete(vlan1);
+    EXPECT_EQ(vlan1->GetState(), KSyncEntry::DEL_DEFER_SYNC);
+
+    vlan_table_->NetlinkAck(vlan1, KSyncEntry::ADD_ACK);
+    EXPECT_EQ(vlan1->GetState(), KSyncEntry::DEL_DEFER_SYNC);
+    EXPECT_EQ(0U, Vlan::delete_count_);
+    vlan_table_->NetlinkAck(vlan1, KSyncEntry::CHANGE_ACK);
+    EXPECT_EQ(vlan1->GetState(), KSyncEntry::DEL_ACK_WAIT);
+    EXPECT_EQ(1U, Vlan::delete_count_);
+    vlan_table_->NetlinkAck(vlan1, KSyncEntry::DEL_ACK);
+    vlan_table_->set_pipelined(false);
+}
+
+// Change is not pipelined when the entry has an unresolved reference or
+// when DeleteAdd is pending
+TEST_F(TestUT, pipelined_change_deferred) {
+    vlan_table_->set_pipelined(true);
+    Vlan *vlan1 = AddVlan(0x101, 0, KSyncEntry::SYNC_WAIT, Vlan::ADD, 0);
+    // 0x102 is not created yet
+    ChangeVlan(vlan1, 0x102, KSyncEntry::NEED_SYNC, Vlan::ADD);
+    EXPECT_EQ(0U, vlan1->pipelined_acks());
+    vlan_table_->NetlinkAck(vlan1, KSyncEntry::ADD_ACK);
+    EXPECT_EQ(vlan1->GetState(), KSyncEntry::CHANGE_DEFER);
+
+    Vlan *vlan2 = AddVlan(0x102, 0, KSyncEntry::SYNC_WAIT, Vlan::ADD, 1);
+    // Dependent is written once vlan2 is sent
+    EXPECT_EQ(vlan1->GetState(), KSyncEntry::SYNC_WAIT);
+    EXPECT_EQ(1U, Vlan::change_count_);
+
+    vlan_table_->NotifyEvent(vlan2, KSyncEntry::DEL_ADD_REQ);
+    EXPECT_TRUE(vlan2->del_add_pending());
+    ChangeVlan(vlan2, 0, KSyncEntry::NEED_SYNC, Vlan::ADD);
+    EXPECT_EQ(1U, Vlan::change_count_);
+    vlan_table_->NetlinkAck(vlan2, KSyncEntry::ADD_ACK);
+    EXPECT_EQ(vlan2->GetState(), KSyncEntry::RENEW_WAIT);
+    vlan_table_->NetlinkAck(vlan2, KSyncEntry::DEL_ACK);
+    vlan_table_->NetlinkAck(vlan2, KSyncEntry::ADD_ACK);
+    EXPECT_EQ(vlan2->GetState(), KSyncEntry::IN_SYNC);
+    vlan_table_->NetlinkAck(vlan1, KSyncEntry::CHANGE_ACK);
+    EXPECT_EQ(vlan1->GetState(), KSyncEntry::IN_SYNC);
+
+    vlan_table_->Delete(vlan1);
+    vlan_table_->NetlinkAck(vlan1, KSyncEntry::DEL_ACK);
+    vlan_table_->Delete(vlan2);
+    vlan_table_->NetlinkAck(vlan2, KSyncEntry::DEL_ACK);
+    vlan_table_->set_pipelined(false);
+}
+
+// ACKs the first count messages sent, as a bulk response from kernel
+static void AckMsgs(VlanMsgList *msg_list, size_t count) {
+    VlanMsgList acks(msg_list->begin(), msg_list->begin() + count);
+    msg_list->erase(msg_list->begin(), msg_list->begin() + count);
+    for (VlanMsgList::iterator it = acks.begin(); it != acks.end(); ++it) {
+        vlan_table_->NetlinkAck(it->first, it->second);
+    }
+}
+
+// Replays a trace of changes on kReplayEntries entries. In every round a
+// quarter of the entries are changed, kernel responds to the messages sent
+// before the round at the end of the round. Returns the number of messages
+// sent and the number of times an entry was left with a change held till
+// an ACK arrives.
+static const uint32_t kReplayEntries = 128;
+static const uint32_t kReplayRounds = 1000;
+
+static void ReplayChurn(bool pipelined, uint32_t *msgs, uint32_t *waits) {
+    VlanMsgList msg_list;
+    Vlan::msg_list_ = &msg_list;
+    vlan_table_->set_pipelined(pipelined);
+    TestInit();
+
+    std::vector<Vlan *> vlans;
+    for (uint32_t i = 0; i < kReplayEntries; i++) {
+        Vlan v(0x100 + i, 0);
+        vlans.push_back(static_cast<Vlan *>(vlan_table_->Create(&v)));
+    }
+
+    srand(1);
+    *waits = 0;
+    for (uint32_t round = 0; round < kReplayRounds; round++) {
+        size_t sent = msg_list.size();
+        for (uint32_t i = 0; i < kReplayEntries / 4; i++) {
+            vlan_table_->Change(vlans[rand() % kReplayEntries]);
+        }
+        for (uint32_t i = 0; i < kReplayEntries; i++) {
+            if (vlans[i]->GetState() == KSyncEntry::NEED_SYNC)
+                (*waits)++;
+        }
+        AckMsgs(&msg_list, sent);
+    }
+    while (msg_list.empty() == false) {
+        AckMsgs(&msg_list, msg_list.size());
+    }
+    *msgs = Vlan::add_count_ + Vlan::change_count_;
+
+    for (uint32_t i = 0; i < kReplayEntries; i++) {
+        EXPECT_EQ(vlans[i]->GetState(), KSyncEntry::IN_SYNC);
+        EXPECT_EQ(0U, vlans[i]->pipelined_acks());
+        vlan_table_->Delete(vlans[i]);
+    }
+    AckMsgs(&msg_list, msg_list.size());
+    EXPECT_EQ(kReplayEntries, Vlan::delete_count_);
+
+    Vlan::msg_list_ = NULL;
+    vlan_table_->set_pipelined(false);
+}
+
+TEST_F(TestUT, pipelined_replay) {
+    uint32_t msgs, waits;
+    ReplayChurn(false, &msgs, &waits);
+    uint32_t pipelined_msgs, pipelined_waits;
+    ReplayChurn(true, &pipelined_msgs, &pipelined_waits);
+
+    // Changes are held only when more than one arrives for an entry
+    // within an ACK round trip
+    EXPECT_LT(pipelined_waits, waits / 2);
+    cout << "Non-pipelined: msgs " << msgs << " ack waits " << waits << endl;
+    cout << "Pipelined    : msgs " << pipelined_msgs << " ack waits "
+        << pipelined_waits << endl;
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     LoggingInit();
@@ -4,21 +4,16 @@
 
 #include "query.h"
 
-query_status_t DbQueryUnit::process_query()
+//
+// Row keys of the query, one per T2 time slice. Completes the column range
+// with the timestamp bounds, must be called once before reading the rows.
+//
+void DbQueryUnit::get_query_keys(std::vector<GenDb::DbDataValueVec> *keys)
 {
     AnalyticsQuery *m_query = (AnalyticsQuery *)main_query;
     uint32_t t2_start = m_query->from_time() >> g_viz_constants.RowTimeInBits;
     uint32_t t2_end = m_query->end_time() >> g_viz_constants.RowTimeInBits;
 
-    QE_TRACE(DEBUG,  " Database query for " << 
-            (t2_end - t2_start + 1) << " rows");
-    QE_TRACE(DEBUG,  " Database query for T2_start:"
-            << t2_start
-            << " T2_end:" << t2_end
-            << " cf:" << cfname
-            << " column_start size:" << cr.start_.size()
-            << " column_end size:" << cr.finish_.size());
-
     if (m_query->is_object_table_query(m_query->table()))
     {    
         GenDb::DbDataValue timestamp_start = (uint32_t)0x0;
@@ -27,11 +22,8 @@ query_status_t DbQueryUnit::process_query()
     GenDb::DbDataValue timestamp_end = (uint32_t)(0xffffffff);
     cr.finish_.push_back(timestamp_end);
 
-    std::vector<GenDb::DbDataValueVec> keys;    // vector of keys for multi-row get
-    GenDb::ColListVec mget_res;   // vector of result for each row
     for (uint32_t t2 = t2_start; t2 <= t2_end; t2++)
     {
-        GenDb::ColList result;
         GenDb::DbDataValueVec rowkey;
 
         rowkey.push_back(t2);
@@ -50,10 +42,42 @@ query_status_t DbQueryUnit::process_query()
                 rowkey.push_back(*it);
             }
         }
-        keys.push_back(rowkey);
+        keys->push_back(rowkey);
+    }
+}
+
+query_status_t DbQueryUnit::process_query()
+{
+    AnalyticsQuery *m_query = (AnalyticsQuery *)main_query;
+    uint32_t t2_start = m_query->from_time() >> g_viz_constants.RowTimeInBits;
+    uint32_t t2_end = m_query->end_time() >> g_viz_constants.RowTimeInBits;
+
+    QE_TRACE(DEBUG,  " Database query for " << 
+            (t2_end - t2_start + 1) << " rows");
+    QE_TRACE(DEBUG,  " Database query for T2_start:"
+            << t2_start
+            << " T2_end:" << t2_end
+            << " cf:" << cfname
+            << " column_start size:" << cr.start_.size()
+            << " column_end size:" << cr.finish_.size());
+
+    // Read this and the following database queries of the WHERE clause
+    // ahead, unless done with a previous one
+    if (!prefetched && !m_query->wherequery_->prefetch_db_queries(this)) {
+        QE_IO_ERROR_RETURN(0, QUERY_FAILURE);
+    }
+
+    std::vector<GenDb::DbDataValueVec> keys;    // vector of keys for multi-row get
+    GenDb::ColListVec mget_res;   // vector of result for each row
+    if (prefetched) {
+        // The rows were already read by WhereQuery
+        mget_res.transfer(mget_res.end(), prefetch_result);
+    } else {
+        get_query_keys(&keys);
     }
 
-    if (!m_query->dbif->Db_GetMultiRow(mget_res, cfname, keys, &cr)) {
+    if (!prefetched &&
+        !m_query->dbif->Db_GetMultiRow(mget_res, cfname, keys, &cr)) {
         std::stringstream tempstr;
         for (size_t i = 0; i < cr.start_.size(); i++)
             tempstr << "cr_s(" << i << "): " << cr.start_.at(i) << ", ";
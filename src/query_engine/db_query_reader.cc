@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "db_query_reader.h"
+
+#include <assert.h>
+#include <algorithm>
+#include <boost/shared_ptr.hpp>
+#include "base/task.h"
+
+using std::string;
+using std::vector;
+
+DbConnectionPool::DbConnectionPool(CreateFn create_fn,
+                                   size_t max_connections)
+    : create_fn_(create_fn),
+      max_connections_(max_connections),
+      opening_(0) {
+}
+
+DbConnectionPool::~DbConnectionPool() {
+}
+
+//
+// The connection is opened outside the lock, opening may take a while and
+// must not hold up the queries that return or take idle connections.
+//
+GenDb::GenDbIf *DbConnectionPool::Get() {
+    {
+        tbb::mutex::scoped_lock lock(mutex_);
+        if (!idle_.empty()) {
+            GenDb::GenDbIf *dbif = idle_.back();
+            idle_.pop_back();
+            return dbif;
+        }
+        if (connections_.size() + opening_ >= max_connections_) {
+            return NULL;
+        }
+        opening_++;
+    }
+
+    GenDb::GenDbIf *dbif = create_fn_();
+    tbb::mutex::scoped_lock lock(mutex_);
+    opening_--;
+    if (dbif != NULL) {
+        connections_.push_back(dbif);
+    }
+    return dbif;
+}
+
+void DbConnectionPool::Put(GenDb::GenDbIf *dbif) {
+    tbb::mutex::scoped_lock lock(mutex_);
+    idle_.push_back(dbif);
+}
+
+size_t DbConnectionPool::size() const {
+    tbb::mutex::scoped_lock lock(mutex_);
+    return connections_.size();
+}
+
+//
+// Helps the reader with a connection from the pool. Holds on to the reader,
+// since the task may only run after the reader is done.
+//
+class DbQueryReader::ReadTask : public Task {
+public:
+    explicit ReadTask(boost::shared_ptr<DbQueryReader> reader)
+        : Task(TaskScheduler::GetInstance()->GetTaskId("QE::DbRead")),
+          reader_(reader) {
+    }
+
+    virtual bool Run() {
+        reader_->ReadWithPool();
+        return true;
+    }
+
+private:
+    boost::shared_ptr<DbQueryReader> reader_;
+};
+
+DbQueryReader::DbQueryReader(GenDb::GenDbIf *dbif, DbConnectionPool *pool,
+                             size_t max_inflight, uint32_t page_size)
+    : dbif_(dbif),
+      pool_(pool),
+      max_inflight_(std::max(max_inflight, (size_t)1)),
+      page_size_(std::max(page_size, (uint32_t)2)),
+      active_(0),
+      failed_(false) {
+    reads_ = 0;
+    inflight_ = 0;
+    peak_inflight_ = 0;
+}
+
+DbQueryReader::~DbQueryReader() {
+    STLDeleteValues(&pages_);
+    for (boost::ptr_vector<Slice>::iterator it = slices_.begin();
+         it != slices_.end(); ++it) {
+        STLDeleteValues(&it->pages);
+    }
+}
+
+size_t DbQueryReader::AddSlice(const string &cfname,
+                               const GenDb::DbDataValueVec &rowkey,
+                               const GenDb::ColumnNameRange &cr) {
+    Slice *slice = new Slice;
+    slice->cfname = cfname;
+    slice->cr = cr;
+    slice->cr.count = page_size_;
+    slice->result->cfname_ = cfname;
+    slice->result->rowkey_ = rowkey;
+    slices_.push_back(slice);
+    pages_.push_back(new Page(slices_.size() - 1, 0, cr.start_, false));
+    return slices_.size() - 1;
+}
+
+void DbQueryReader::TransferResult(size_t slice, GenDb::ColListVec *out) {
+    Slice &s = slices_[slice];
+    assert(s.result != NULL);
+    out->push_back(s.result);
+    s.result = NULL;
+}
+
+//
+// Read one page of a slice. If the page is full, the read of the next page
+// is queued at the front before this page is consumed, so that another
+// reader reads ahead while this one moves the columns into the page slot
+// of the slice. Pages are assembled in order once all reads are done.
+//
+bool DbQueryReader::ReadPage(GenDb::GenDbIf *dbif, Page *page) {
+    Slice &slice = slices_[page->slice];
+    GenDb::ColumnNameRange cr;
+    cr.start_ = page->start;
+    cr.finish_ = slice.cr.finish_;
+    cr.count = page_size_;
+    vector<GenDb::DbDataValueVec> keys(1, slice.result->rowkey_);
+    GenDb::ColListVec mget_res;
+
+    uint32_t inflight = inflight_.fetch_and_increment() + 1;
+    uint32_t peak = peak_inflight_;
+    while (inflight > peak &&
+           peak_inflight_.compare_and_swap(inflight, peak) != peak) {
+        peak = peak_inflight_;
+    }
+    reads_++;
+    bool success = dbif->Db_GetMultiRow(mget_res, slice.cfname, keys, &cr);
+    inflight_--;
+    if (!success) {
+        return false;
+    }
+    if (mget_res.empty()) {
+        return true;
+    }
+
+    GenDb::NewColVec &columns = mget_res[0].columns_;
+    if (columns.size() >= page_size_) {
+        tbb::mutex::scoped_lock lock(mutex_);
+        pages_.push_front(new Page(page->slice, page->index + 1,
+                                   *columns.back().name, true));
+    }
+
+    // Transfer the columns without copying them
+    GenDb::NewColVec *page_columns = new GenDb::NewColVec;
+    GenDb::NewColVec::iterator first = columns.begin();
+    if (page->skip_first && first != columns.end()) {
+        ++first;
+    }
+    page_columns->transfer(page_columns->end(), first, columns.end(),
+                           columns);
+
+    tbb::mutex::scoped_lock lock(mutex_);
+    if (slice.pages.size() <= page->index) {
+        slice.pages.resize(page->index + 1, NULL);
+    }
+    slice.pages[page->index] = page_columns;
+    return true;
+}
+
+//
+// Read pages until the queue is empty. With wait set, also wait for the
+// pages other readers are working on, which may queue continuation pages.
+//
+void DbQueryReader::Read(GenDb::GenDbIf *dbif, bool wait) {
+    tbb::interface5::unique_lock<tbb::mutex> lock(mutex_);
+    while (true) {
+        if (!failed_ && !pages_.empty()) {
+            Page *page = pages_.front();
+            pages_.pop_front();
+            active_++;
+            lock.unlock();
+            bool success = ReadPage(dbif, page);
+            delete page;
+            lock.lock();
+            active_--;
+            if (!success) {
+                failed_ = true;
+            }
+            cond_var_.notify_all();
+            continue;
+        }
+        if (!wait || active_ == 0) {
+            break;
+        }
+        cond_var_.wait(lock);
+    }
+}
+
+void DbQueryReader::ReadWithPool() {
+    {
+        tbb::mutex::scoped_lock lock(mutex_);
+        if (failed_ || pages_.empty()) {
+            return;
+        }
+    }
+    GenDb::GenDbIf *dbif = pool_->Get();
+    if (dbif == NULL) {
+        return;
+    }
+    Read(dbif, false);
+    pool_->Put(dbif);
+}
+
+bool DbQueryReader::Run() {
+    if (slices_.empty()) {
+        return true;
+    }
+
+    // The calling task reads as well and does not depend on the helper
+    // tasks being scheduled, it only waits for the reads they started
+    if (pool_ != NULL) {
+        size_t ntasks = std::min(max_inflight_, slices_.size()) - 1;
+        TaskScheduler *scheduler = TaskScheduler::GetInstance();
+        for (size_t i = 0; i < ntasks; i++) {
+            scheduler->Enqueue(new ReadTask(shared_from_this()));
+        }
+    }
+    Read(dbif_, true);
+
+    // Assemble the pages of every slice in column order
+    for (boost::ptr_vector<Slice>::iterator it = slices_.begin();
+         it != slices_.end(); ++it) {
+        for (vector<GenDb::NewColVec *>::iterator pt = it->pages.begin();
+             pt != it->pages.end(); ++pt) {
+            if (*pt == NULL) {
+                continue;
+            }
+            it->result->columns_.transfer(it->result->columns_.end(), **pt);
+            delete *pt;
+        }
+        it->pages.clear();
+    }
+    return !failed_;
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+/*
+ * DbQueryReader reads a set of (column family, row key, column range)
+ * slices with a bounded number of reads in flight.
+ *
+ * The WHERE clause of a query expands into one DbQueryUnit per term and
+ * every DbQueryUnit into one row per T2 time slice. Instead of reading
+ * them one term at a time, WhereQuery hands a window of terms to the
+ * reader. The calling task reads on the connection of the query, and up
+ * to max_inflight - 1 "QE::DbRead" tasks help with connections taken from
+ * the DbConnectionPool of the QueryEngine, all pulling slices off a shared
+ * queue. A helper task that finds the pool empty does not read.
+ *
+ * Columns of a row are read in pages of page_size columns. As soon as a
+ * full page comes back, the read of the next page is queued ahead of
+ * the remaining slices, so that an idle reader prefetches it while the
+ * current page is being consumed.
+ */
+
+#ifndef SRC_QUERY_ENGINE_DB_QUERY_READER_H_
+#define SRC_QUERY_ENGINE_DB_QUERY_READER_H_
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/function.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <tbb/atomic.h>
+#include <tbb/mutex.h>
+#include <tbb/compat/condition_variable>
+#include "base/util.h"
+#include "gendb_if.h"
+
+//
+// Bounded set of initialized database connections, shared by all the
+// queries of the QueryEngine for parallel reads. Connections are opened
+// on demand, up to max_connections, and kept open once returned.
+//
+class DbConnectionPool {
+public:
+    // Opens and initializes a connection, NULL on failure
+    typedef boost::function<GenDb::GenDbIf *(void)> CreateFn;
+
+    DbConnectionPool(CreateFn create_fn, size_t max_connections);
+    ~DbConnectionPool();
+
+    // Returns an idle connection, or NULL if all are in use
+    GenDb::GenDbIf *Get();
+    void Put(GenDb::GenDbIf *dbif);
+
+    size_t size() const;
+    size_t max_connections() const { return max_connections_; }
+
+private:
+    CreateFn create_fn_;
+    size_t max_connections_;
+    mutable tbb::mutex mutex_;
+    // Connections being opened, counted against max_connections
+    size_t opening_;
+    boost::ptr_vector<GenDb::GenDbIf> connections_;
+    std::vector<GenDb::GenDbIf *> idle_;
+
+    DISALLOW_COPY_AND_ASSIGN(DbConnectionPool);
+};
+
+//
+// Must be owned by a boost::shared_ptr when run with a pool, the read
+// tasks keep a reference until they exit.
+//
+class DbQueryReader : public boost::enable_shared_from_this<DbQueryReader> {
+public:
+    static const size_t kMaxInflight = 4;
+    static const uint32_t kPageSize = 10000;
+
+    DbQueryReader(GenDb::GenDbIf *dbif, DbConnectionPool *pool,
+                  size_t max_inflight = kMaxInflight,
+                  uint32_t page_size = kPageSize);
+    ~DbQueryReader();
+
+    // Queue a slice, returns its index. The range count is ignored, all
+    // the columns in the range are read.
+    size_t AddSlice(const std::string &cfname,
+                    const GenDb::DbDataValueVec &rowkey,
+                    const GenDb::ColumnNameRange &cr);
+    size_t SliceCount() const { return slices_.size(); }
+
+    // Read all the slices, returns false if any read failed
+    bool Run();
+
+    // Move the row of a slice, with its columns in column order, to the
+    // end of out. Only valid once per slice, after Run.
+    void TransferResult(size_t slice, GenDb::ColListVec *out);
+
+    // Number of database reads issued and the peak number of reads that
+    // were in flight at the same time
+    uint64_t reads() const { return reads_; }
+    uint32_t max_inflight_reached() const { return peak_inflight_; }
+
+private:
+    class ReadTask;
+
+    struct Slice {
+        Slice() : result(new GenDb::ColList) {
+        }
+        ~Slice() { delete result; }
+        std::string cfname;
+        GenDb::ColumnNameRange cr;
+        // Columns of each page, indexed by page number
+        std::vector<GenDb::NewColVec *> pages;
+        GenDb::ColList *result;
+    };
+
+    struct Page {
+        Page(size_t slice, size_t index, const GenDb::DbDataValueVec &start,
+             bool skip_first)
+            : slice(slice), index(index), start(start),
+              skip_first(skip_first) {
+        }
+        size_t slice;
+        size_t index;
+        GenDb::DbDataValueVec start;
+        // The first column of a continuation page is the last column of
+        // the previous page
+        bool skip_first;
+    };
+
+    void Read(GenDb::GenDbIf *dbif, bool wait);
+    void ReadWithPool();
+    bool ReadPage(GenDb::GenDbIf *dbif, Page *page);
+
+    GenDb::GenDbIf *dbif_;
+    DbConnectionPool *pool_;
+    size_t max_inflight_;
+    uint32_t page_size_;
+
+    boost::ptr_vector<Slice> slices_;
+
+    tbb::mutex mutex_;
+    tbb::interface5::condition_variable cond_var_;
+    std::deque<Page *> pages_;
+    // Pages being read
+    size_t active_;
+    bool failed_;
+
+    tbb::atomic<uint64_t> reads_;
+    tbb::atomic<uint32_t> inflight_;
+    tbb::atomic<uint32_t> peak_inflight_;
+
+    DISALLOW_COPY_AND_ASSIGN(DbQueryReader);
+};
+
+#endif  // SRC_QUERY_ENGINE_DB_QUERY_READER_H_
@@ -7,6 +7,7 @@
 #include "rapidjson/stringbuffer.h"
 #include "rapidjson/writer.h"
 #include "query.h"
+#include "sorted_merge.h"
 
 using boost::assign::map_list_of;
 
@@ -52,6 +53,70 @@ bool PostProcessingQuery::sort_field_comparator(
     return false;
 }
 
+// compare result rows in output order, i.e. taking the sorting type
+// into account
+bool PostProcessingQuery::result_row_comparator(
+        const QEOpServerProxy::ResultRowT& lhs,
+        const QEOpServerProxy::ResultRowT& rhs) {
+    if (sorting_type == ASCENDING) {
+        return sort_field_comparator(lhs, rhs);
+    }
+    return sort_field_comparator(rhs, lhs);
+}
+
+// Returns true if the rows of a chunk are partial flow series stats, which
+// are aggregated with the rows of the other chunks in the merge.
+bool PostProcessingQuery::fs_aggregate_query() {
+    AnalyticsQuery *mquery = (AnalyticsQuery *)main_query;
+    if (mquery->table() != g_viz_constants.FLOW_SERIES_TABLE) {
+        return false;
+    }
+    switch (mquery->selectquery_->flowseries_query_type()) {
+    case SelectQuery::FS_SELECT_STATS:
+    case SelectQuery::FS_SELECT_FLOW_TUPLE_STATS:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Returns the number of rows each partial result needs to retain.
+// The limit can be pushed down into the chunks only if the rows of a chunk
+// are final, i.e. they are neither aggregated (flow series stats) nor
+// de-duplicated (flow records) with rows of the other chunks. Aggregated
+// rows get the top N applied in final_merge_processing, once the partial
+// aggregates of all the chunks are merged.
+size_t PostProcessingQuery::pushdown_limit() {
+    if (!limit || !sorted) {
+        return 0;
+    }
+    AnalyticsQuery *mquery = (AnalyticsQuery *)main_query;
+    if (mquery->table() == g_viz_constants.FLOW_TABLE) {
+        return 0;
+    }
+    if (fs_aggregate_query()) {
+        return 0;
+    }
+    return (size_t)limit;
+}
+
+// Sort the result in output order. If only the top N rows are needed,
+// a partial sort is done and the rest of the rows are dropped.
+void PostProcessingQuery::sort_result(QEOpServerProxy::BufferT *result,
+                                      size_t top_n) {
+    if (top_n && top_n < result->size()) {
+        std::partial_sort(result->begin(), result->begin() + top_n,
+            result->end(),
+            boost::bind(&PostProcessingQuery::result_row_comparator,
+                        this, _1, _2));
+        result->resize(top_n);
+        return;
+    }
+    std::sort(result->begin(), result->end(),
+              boost::bind(&PostProcessingQuery::result_row_comparator,
+                          this, _1, _2));
+}
+
 bool PostProcessingQuery::flowseries_merge_processing(
         const QEOpServerProxy::BufferT *raw_result,
         QEOpServerProxy::BufferT* merged_result, 
@@ -253,6 +318,12 @@ bool PostProcessingQuery::merge_processing(
                                        this, _1, _2));
             }
         }
+        // Only the top N rows of the accumulated result can make it to
+        // the final result
+        size_t top_n = pushdown_limit();
+        if (top_n && merged_result->size() > top_n) {
+            merged_result->resize(top_n);
+        }
     } else {
         QE_TRACE(DEBUG, "Merge_Processing: Adding inputs to output");
         QEOpServerProxy::BufferT *merged_result = &output;
@@ -353,6 +424,23 @@ const std::vector<boost::shared_ptr<QEOpServerProxy::BufferT> >& inputs,
         merge_done = true;
     }
 
+    if (!merge_done && sorted) {
+        // The result of every chunk is already sorted in output order,
+        // stream them through a k-way merge instead of re-sorting the
+        // concatenated result.
+        size_t top_n = pushdown_limit();
+        QE_TRACE(DEBUG, "K-way merge of " << inputs.size() <<
+                 " sorted vectors, limit:" << top_n);
+        SortedMerge(inputs, &output,
+                    boost::bind(&PostProcessingQuery::result_row_comparator,
+                                this, _1, _2), top_n);
+        merge_done = true;
+    } else if (sorted) {
+        // Aggregated or de-duplicated rows, only the top N rows of the
+        // merged result are sorted.
+        sort_result(&output, limit);
+    }
+
     if (!merge_done) {
         QEOpServerProxy::BufferT *merged_result = &output;
         size_t final_vector_size = 0;
@@ -370,19 +458,6 @@ const std::vector<boost::shared_ptr<QEOpServerProxy::BufferT> >& inputs,
         }
     }
 
-    if (sorted) {
-        QEOpServerProxy::BufferT *merged_result = &output;
-        if (sorting_type == ASCENDING) {
-            std::sort(merged_result->begin(), merged_result->end(),
-                      boost::bind(&PostProcessingQuery::sort_field_comparator,
-                                  this, _1, _2));
-        } else {
-            std::sort(merged_result->rbegin(), merged_result->rend(),
-                      boost::bind(&PostProcessingQuery::sort_field_comparator,
-                                  this, _1, _2));
-        }
-    }
-   
     if (limit) {
         QEOpServerProxy::BufferT *merged_result = &output;
         QE_TRACE(DEBUG, "Apply Limit [" << limit << "]");
@@ -584,17 +659,12 @@ query_status_t PostProcessingQuery::process_query() {
         *raw_result = filtered_table;
     }
 
-    // Check if the result has to be sorted
-    if (sorted) {
-        if (sorting_type == ASCENDING) {
-            std::sort(raw_result->begin(), raw_result->end(), 
-                      boost::bind(&PostProcessingQuery::sort_field_comparator, 
-                                  this, _1, _2)); 
-        } else {
-            std::sort(raw_result->rbegin(), raw_result->rend(), 
-                      boost::bind(&PostProcessingQuery::sort_field_comparator,
-                                  this, _1, _2));
-        }
+    // Check if the result has to be sorted. When the limit can be pushed
+    // down, only the top N rows of the chunk are sorted and retained.
+    // Partial flow series stats of a parallelized query are sorted only
+    // after they are aggregated in final_merge_processing.
+    if (sorted && !(fs_aggregate_query() && mquery->is_query_parallelized())) {
+        sort_result(raw_result, pushdown_limit());
     }
 
     // If the flow series query is parallelized, we should apply the limit 
@@ -879,6 +879,7 @@ AnalyticsQuery::AnalyticsQuery(std::string qid, std::map<std::string,
             boost::bind(&AnalyticsQuery::db_err_handler, this),
             cassandra_ips, cassandra_ports, "QueryEngine", true,
             cassandra_user, cassandra_password)),
+        db_pool(NULL),
         filter_qe_logs(true),
         json_api_data_(json_api_data),
         ttlmap_(ttlmap),
@@ -953,6 +954,7 @@ AnalyticsQuery::AnalyticsQuery(std::string qid, GenDb::GenDbIf *dbif,
     const TtlMap &ttlmap, int batch, int total_batches) :
     QueryUnit(NULL, this),
     dbif_(dbif),
+    db_pool(NULL),
     query_id(qid),
     json_api_data_(json_api_data),
     ttlmap_(ttlmap),
@@ -1001,6 +1003,8 @@ QueryEngine::QueryEngine(EventManager *evm,
             cassandra_user, cassandra_password)),
         qosp_(new QEOpServerProxy(evm,
             this, redis_ip, redis_port, redis_password, max_tasks)),
+        db_pool_(new DbConnectionPool(
+            boost::bind(&QueryEngine::CreateDbIf, this), max_tasks)),
         evm_(evm),
         cassandra_ports_(cassandra_ports),
         cassandra_ips_(cassandra_ips),
@@ -1146,6 +1150,44 @@ QueryEngine::QueryEngine(EventManager *evm,
 
 using std::vector;
 
+//
+// Open and initialize an additional database connection for parallel reads
+// of the WHERE clause. Returns NULL if the connection can not be
+// initialized.
+//
+GenDb::GenDbIf *QueryEngine::CreateDbIf() {
+    std::auto_ptr<GenDb::GenDbIf> db_if(GenDb::GenDbIf::GenDbIfImpl(
+        boost::bind(&QueryEngine::db_err_handler, this),
+        cassandra_ips_, cassandra_ports_, "QueryEngine", true,
+        cassandra_user_, cassandra_password_));
+    if (!db_if->Db_Init("qe::DbHandler", -1)) {
+        QE_LOG_NOQID(ERROR, "Database initialization failed");
+        return NULL;
+    }
+    if (!db_if->Db_SetTablespace(g_viz_constants.COLLECTOR_KEYSPACE)) {
+        QE_LOG_NOQID(ERROR,  ": Create/Set KEYSPACE: " <<
+           g_viz_constants.COLLECTOR_KEYSPACE << " FAILED");
+        db_if->Db_Uninit("qe::DbHandler", -1);
+        return NULL;
+    }
+    const std::vector<GenDb::NewCf> *tables[] = {
+        &vizd_tables, &vizd_flow_tables, &vizd_stat_tables
+    };
+    for (size_t i = 0; i < sizeof(tables) / sizeof(tables[0]); i++) {
+        for (std::vector<GenDb::NewCf>::const_iterator it =
+             tables[i]->begin(); it != tables[i]->end(); it++) {
+            if (!db_if->Db_UseColumnfamily(*it)) {
+                QE_LOG_NOQID(ERROR,
+                    "Database initialization:Db_UseColumnfamily failed");
+                db_if->Db_Uninit("qe::DbHandler", -1);
+                return NULL;
+            }
+        }
+    }
+    db_if->Db_SetInitDone(true);
+    return db_if.release();
+}
+
 int
 QueryEngine::QueryPrepare(QueryParams qp,
         std::vector<uint64_t> &chunk_size,
@@ -1256,6 +1298,8 @@ QueryEngine::QueryExec(void * handle, QueryParams qp, uint32_t chunk)
             cassandra_ips_, cassandra_ports_, chunk, 
             qp.maxChunks, cassandra_user_, cassandra_password_);
 
+    q->db_pool = db_pool_.get();
+
     QE_TRACE_NOQID(DEBUG, " Finished parsing and starting processing for QID " << qid << " chunk:" << chunk); 
     q->process_query(); 
 
@@ -69,6 +69,7 @@
 #include "../analytics/redis_connection.h"
 #include "base/work_pipeline.h"
 #include "gendb_if.h"
+#include "db_query_reader.h"
 #include "../analytics/viz_message.h"
 #include "json_parse.h"
 #include "QEOpServerProxy.h"
@@ -310,6 +311,12 @@ struct query_result_unit_t {
     static GenDb::GenDbIf *dbif; // just to access decode functions
 } ;
 
+// Swap without copying the info, used by the set operations
+inline void swap(query_result_unit_t &lhs, query_result_unit_t &rhs) {
+    std::swap(lhs.timestamp, rhs.timestamp);
+    lhs.info.swap(rhs.info);
+}
+
 // Different status codes of query processing
 enum query_status_t {
     QUERY_PROCESSING_NOT_STARTED = 0,
@@ -374,8 +381,10 @@ public:
     DbQueryUnit(QueryUnit *p_query, QueryUnit *m_query):
         QueryUnit(p_query, m_query) 
         { cr.count = MAX_DB_QUERY_ENTRIES; 
-            t_only_col = false; t_only_row = false;};
+            t_only_col = false; t_only_row = false; prefetched = false;};
     virtual query_status_t process_query();
+    // Row keys to read, also completes the column range
+    void get_query_keys(std::vector<GenDb::DbDataValueVec> *keys);
 
 
     // portion of column family name other than T1
@@ -389,6 +398,9 @@ public:
     GenDb::DbDataValueVec row_key_suffix;
     bool t_only_col;    // only T is in column name
     bool t_only_row;    // only T2 is in row key
+    // Rows read ahead by WhereQuery, used by process_query if set
+    bool prefetched;
+    GenDb::ColListVec prefetch_result;
 };
 
 // This class provides interface to process SET operations involved in the 
@@ -437,7 +449,12 @@ public:
     // 0 is for egress and 1 for ingress
     int32_t direction_ing;
     const std::string json_string_;
+    // Read the rows of db_query and of the database queries that follow
+    // it in processing order ahead, called by db_query before it reads
+    bool prefetch_db_queries(DbQueryUnit *db_query);
 private:
+    // Database queries of the WHERE clause, in processing order
+    std::vector<DbQueryUnit *> db_queries_;
 };
 
 typedef std::vector<std::string> final_result_row_t;
@@ -697,6 +714,10 @@ public:
     static bool flow_record_comparator(const QEOpServerProxy::ResultRowT& lhs,
                                        const QEOpServerProxy::ResultRowT& rhs);
 
+    // compare result rows in output order (honors sorting_type)
+    bool result_row_comparator(const QEOpServerProxy::ResultRowT& lhs,
+                               const QEOpServerProxy::ResultRowT& rhs);
+
     bool merge_processing(
         const QEOpServerProxy::BufferT& input, 
         QEOpServerProxy::BufferT& output);
@@ -719,6 +740,9 @@ private:
                 QEOpServerProxy::BufferT* output,
                 fcid_rrow_map_t *fcid_rrow_map = NULL);
     void fs_update_flow_count(QEOpServerProxy::ResultRowT& rrow);
+    bool fs_aggregate_query();
+    size_t pushdown_limit();
+    void sort_result(QEOpServerProxy::BufferT *result, size_t top_n);
 };
 
 class StatsQuery;
@@ -742,6 +766,8 @@ public:
     GenDb::GenDbIf *dbif;
     boost::scoped_ptr<GenDb::GenDbIf> dbif_;
     void db_err_handler() {};
+    // Connections for parallel reads of the WHERE clause, NULL if none
+    DbConnectionPool *db_pool;
     
     //Query related fields
 
@@ -931,8 +957,12 @@ public:
     void db_err_handler() {};
     TtlMap& GetTTlMap() { return ttlmap_; }
 private:
+    // Opens an additional, initialized connection for the pool
+    GenDb::GenDbIf *CreateDbIf();
+
     boost::scoped_ptr<GenDb::GenDbIf> dbif_;
     boost::scoped_ptr<QEOpServerProxy> qosp_;
+    boost::scoped_ptr<DbConnectionPool> db_pool_;
     EventManager *evm_;
     std::vector<int> cassandra_ports_;
     std::vector<std::string> cassandra_ips_;
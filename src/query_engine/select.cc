@@ -560,6 +560,7 @@ query_status_t SelectQuery::process_query() {
             stats_->LoadRow(u, it->timestamp, attribs, *mresult_);
             //loadt += UTCTimestampUsec() - thenl; 
         }
+        stats_->LoadComplete(*mresult_);
         //QE_TRACE(DEBUG, "Select ProcTime - Entries : " << query_result.size() <<
         //        " json : " << jsont << " parse : " << parset << " load : " << loadt);
 
@@ -3,6 +3,7 @@
  */
 
 #include "query.h"
+#include "sorted_set_ops.h"
 
 // for sorting and set operations
 bool query_result_unit_t::operator<(const query_result_unit_t& rhs) const
@@ -11,7 +12,7 @@ bool query_result_unit_t::operator<(const query_result_unit_t& rhs) const
     {
         GenDb::DbDataValueVec::const_iterator it = info.begin();
         GenDb::DbDataValueVec::const_iterator jt = rhs.info.begin();
-        for (; it != info.end(), jt != rhs.info.end(); it++, jt++) {
+        for (; it != info.end() && jt != rhs.info.end(); it++, jt++) {
             if (*it < *jt) {
                 return true;
             } else if (*jt < *it) {
@@ -24,6 +25,20 @@ bool query_result_unit_t::operator<(const query_result_unit_t& rhs) const
     return (timestamp < rhs.timestamp);
 }
 
+namespace {
+
+struct ResultTimestamp {
+    uint64_t operator()(const query_result_unit_t &result) const {
+        return result.timestamp;
+    }
+};
+
+typedef SortedSetOperation<query_result_unit_t, ResultTimestamp,
+        std::less<query_result_unit_t> > ResultSetOperation;
+
+}  // namespace
+
+// The results of the sub queries are consumed
 void SetOperationUnit::or_operation()
 {
     if (sub_queries.size() == 0)
@@ -32,24 +47,16 @@ void SetOperationUnit::or_operation()
         return;
     }
 
-    // with one query no need to do any operation
-    query_result = sub_queries[0]->query_result;
-
-    for (unsigned int i = 1; i < sub_queries.size(); i++)
+    ResultSetOperation set_op((ResultTimestamp()),
+                              std::less<query_result_unit_t>());
+    for (unsigned int i = 0; i < sub_queries.size(); i++)
     {
-        std::vector<query_result_unit_t> tmp_query_result;
-
-        QE_TRACE(DEBUG, "UNION between tables of sizes " << 
-                query_result.size() << " and " <<
+        QE_TRACE(DEBUG, "UNION with table of size " <<
                 sub_queries[i]->query_result.size());
-        set_union(query_result.begin(), query_result.end(),
-                sub_queries[i]->query_result.begin(), 
-                sub_queries[i]->query_result.end(),
-                std::back_inserter(tmp_query_result));
-
-        query_result = tmp_query_result;    // keep the result in output var
-        QE_TRACE(DEBUG, "Resulting size of set " << query_result.size());
+        set_op.AddInput(&sub_queries[i]->query_result);
     }
+    set_op.Union(&query_result);
+    QE_TRACE(DEBUG, "Resulting size of set " << query_result.size());
 }
 
 void SetOperationUnit::and_operation()
@@ -60,24 +67,16 @@ void SetOperationUnit::and_operation()
         return;
     }
 
-    // with one query no need to do any operation
-    query_result = sub_queries[0]->query_result;
-
-    for (unsigned int i = 1; i < sub_queries.size(); i++)
+    ResultSetOperation set_op((ResultTimestamp()),
+                              std::less<query_result_unit_t>());
+    for (unsigned int i = 0; i < sub_queries.size(); i++)
     {
-        std::vector<query_result_unit_t> tmp_query_result;
-
-        QE_TRACE(DEBUG, "INT between tables of sizes " << 
-                query_result.size() << " and " <<
+        QE_TRACE(DEBUG, "INT with table of size " <<
                 sub_queries[i]->query_result.size());
-        set_intersection(query_result.begin(), query_result.end(),
-                sub_queries[i]->query_result.begin(), 
-                sub_queries[i]->query_result.end(),
-                std::back_inserter(tmp_query_result));
-
-        query_result = tmp_query_result;    // keep the result in output var
-        QE_TRACE(DEBUG, "Resulting size of set " << query_result.size());
+        set_op.AddInput(&sub_queries[i]->query_result);
     }
+    set_op.Intersection(&query_result);
+    QE_TRACE(DEBUG, "Resulting size of set " << query_result.size());
 }
 
 
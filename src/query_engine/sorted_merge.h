@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef SRC_QUERY_ENGINE_SORTED_MERGE_H_
+#define SRC_QUERY_ENGINE_SORTED_MERGE_H_
+
+#include <stddef.h>
+#include <algorithm>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+//
+// Streaming k-way merge of result buffers that are already sorted in
+// output order (each chunk of a query sorts its own result in
+// PostProcessingQuery::process_query).
+//
+// A binary heap of per-input cursors is used, so merging K inputs with a
+// total of N rows costs O(N log K) comparisons instead of the
+// O(N log N) needed to concatenate and re-sort. If limit is non-zero the
+// merge stops as soon as limit rows have been emitted, so only the
+// top-limit rows are ever copied into the output.
+//
+// Ties are broken on the input index, which keeps the merge stable with
+// respect to the order of the inputs.
+//
+template <typename BufferT, typename Compare>
+class SortedMerger {
+public:
+    typedef typename BufferT::const_iterator const_iterator;
+
+    explicit SortedMerger(Compare comp) : comp_(comp) {
+    }
+
+    void Merge(const std::vector<boost::shared_ptr<BufferT> > &inputs,
+               BufferT *output, size_t limit) {
+        size_t total = 0;
+        heap_.clear();
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            const BufferT *input = inputs[i].get();
+            if (!input || input->empty())
+                continue;
+            total += input->size();
+            heap_.push_back(Cursor(i, input->begin(), input->end()));
+        }
+        if (limit && total > limit)
+            total = limit;
+        output->reserve(output->size() + total);
+
+        HeapCompare hcomp(comp_);
+        std::make_heap(heap_.begin(), heap_.end(), hcomp);
+        size_t count = 0;
+        while (!heap_.empty()) {
+            std::pop_heap(heap_.begin(), heap_.end(), hcomp);
+            Cursor &top = heap_.back();
+            output->push_back(*top.current);
+            if (limit && ++count >= limit)
+                break;
+            if (++top.current == top.end) {
+                heap_.pop_back();
+            } else {
+                std::push_heap(heap_.begin(), heap_.end(), hcomp);
+            }
+        }
+        heap_.clear();
+    }
+
+private:
+    struct Cursor {
+        Cursor(size_t index, const_iterator begin, const_iterator end)
+            : index(index), current(begin), end(end) {
+        }
+        size_t index;
+        const_iterator current;
+        const_iterator end;
+    };
+
+    // std heap functions keep the largest element on top, so invert the
+    // output order comparator to pop the smallest row first.
+    struct HeapCompare {
+        explicit HeapCompare(Compare &comp) : comp(comp) { }
+        bool operator()(const Cursor &lhs, const Cursor &rhs) const {
+            if (comp(*rhs.current, *lhs.current))
+                return true;
+            if (comp(*lhs.current, *rhs.current))
+                return false;
+            return lhs.index > rhs.index;
+        }
+        Compare &comp;
+    };
+
+    Compare comp_;
+    std::vector<Cursor> heap_;
+};
+
+template <typename BufferT, typename Compare>
+void SortedMerge(const std::vector<boost::shared_ptr<BufferT> > &inputs,
+                 BufferT *output, Compare comp, size_t limit) {
+    SortedMerger<BufferT, Compare> merger(comp);
+    merger.Merge(inputs, output, limit);
+}
+
+#endif  // SRC_QUERY_ENGINE_SORTED_MERGE_H_
@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef SRC_QUERY_ENGINE_SORTED_SET_OPS_H_
+#define SRC_QUERY_ENGINE_SORTED_SET_OPS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+//
+// Set operations over the sorted, duplicate free results of the terms of a
+// WHERE clause (see SetOperationUnit).
+//
+// The sort key of every input row is first copied to a flat array, so
+// that rows are compared on the key alone and the full row comparison is
+// only needed when keys are equal. For the query engine the key is the
+// timestamp and the full comparison is on the (uuid, ...) info.
+//
+// - Union is a single k-way merge of all the inputs through a heap of
+//   cursors, O(N log K), instead of K - 1 pairwise unions that copy the
+//   accumulated result each time.
+// - Intersection walks the rows of the smallest input, the candidates,
+//   and looks each one up in the other inputs, smallest first, by
+//   galloping (exponential then binary search) from the position of the
+//   previous match. Surviving candidates are tracked in a bitmap, and
+//   runs of eliminated candidates are skipped a 64-bit word at a time, so
+//   that each input only probes the candidates that are still alive.
+//
+// Rows of the output are swapped out of the inputs rather than copied,
+// the inputs are left in an unspecified state.
+//
+template <typename RowT, typename KeyFn, typename Compare>
+class SortedSetOperation {
+public:
+    typedef std::vector<RowT> RowVec;
+
+    SortedSetOperation(KeyFn key, Compare comp) : key_(key), comp_(comp) {
+    }
+
+    void AddInput(RowVec *rows) {
+        inputs_.push_back(Input(rows));
+        Input &input = inputs_.back();
+        input.keys.reserve(rows->size());
+        for (typename RowVec::const_iterator it = rows->begin();
+             it != rows->end(); ++it) {
+            input.keys.push_back(key_(*it));
+        }
+    }
+
+    void Union(RowVec *output) {
+        output->clear();
+        size_t total = 0;
+        heap_.clear();
+        for (size_t i = 0; i < inputs_.size(); ++i) {
+            if (inputs_[i].keys.empty())
+                continue;
+            total += inputs_[i].keys.size();
+            heap_.push_back(Cursor(inputs_[i].keys[0], i));
+        }
+        if (heap_.size() == 1) {
+            output->swap(*inputs_[heap_[0].input].rows);
+            return;
+        }
+        output->reserve(total);
+
+        HeapCompare hcomp(this);
+        std::make_heap(heap_.begin(), heap_.end(), hcomp);
+        while (!heap_.empty()) {
+            std::pop_heap(heap_.begin(), heap_.end(), hcomp);
+            uint64_t key = heap_.back().key;
+            Input &top = inputs_[heap_.back().input];
+            Emit(&top, top.pos, output);
+            Advance(hcomp);
+            // Drop the same row from the other inputs
+            while (!heap_.empty() && heap_.front().key == key &&
+                   Equal(inputs_[heap_.front().input], output->back())) {
+                std::pop_heap(heap_.begin(), heap_.end(), hcomp);
+                Advance(hcomp);
+            }
+        }
+    }
+
+    void Intersection(RowVec *output) {
+        output->clear();
+        if (inputs_.empty())
+            return;
+        std::vector<Input *> inputs;
+        for (size_t i = 0; i < inputs_.size(); ++i) {
+            inputs.push_back(&inputs_[i]);
+        }
+        std::sort(inputs.begin(), inputs.end(), SizeLess());
+        Input *candidates = inputs[0];
+        const size_t count = candidates->keys.size();
+        if (inputs.size() == 1) {
+            output->swap(*candidates->rows);
+            return;
+        }
+
+        // All candidates are alive to start with
+        std::vector<uint64_t> alive((count + 63) / 64, ~0ULL);
+        if (count % 64)
+            alive.back() = (1ULL << (count % 64)) - 1;
+        size_t nalive = count;
+
+        for (size_t i = 1; i < inputs.size() && nalive; ++i) {
+            Input *input = inputs[i];
+            size_t pos = 0;
+            for (size_t w = 0; w < alive.size(); ++w) {
+                uint64_t word = alive[w];
+                while (word) {
+                    size_t bit = __builtin_ctzll(word);
+                    word &= word - 1;
+                    size_t row = w * 64 + bit;
+                    const RowT &candidate = (*candidates->rows)[row];
+                    pos = Gallop(*input, pos, candidates->keys[row],
+                                 candidate);
+                    if (pos == input->keys.size() ||
+                        input->keys[pos] != candidates->keys[row] ||
+                        comp_(candidate, (*input->rows)[pos])) {
+                        alive[w] &= ~(1ULL << bit);
+                        nalive--;
+                    }
+                }
+            }
+        }
+
+        output->reserve(nalive);
+        for (size_t w = 0; w < alive.size(); ++w) {
+            uint64_t word = alive[w];
+            while (word) {
+                size_t bit = __builtin_ctzll(word);
+                word &= word - 1;
+                Emit(candidates, w * 64 + bit, output);
+            }
+        }
+    }
+
+private:
+    struct Input {
+        explicit Input(RowVec *rows) : rows(rows), pos(0) {
+        }
+        RowVec *rows;
+        std::vector<uint64_t> keys;
+        size_t pos;
+    };
+
+    struct SizeLess {
+        bool operator()(const Input *lhs, const Input *rhs) const {
+            return lhs->keys.size() < rhs->keys.size();
+        }
+    };
+
+    // Key of the current row of an input
+    struct Cursor {
+        Cursor(uint64_t key, size_t input) : key(key), input(input) {
+        }
+        uint64_t key;
+        size_t input;
+    };
+
+    // std heap functions keep the largest element on top, so invert the
+    // order to pop the input with the smallest current row first
+    struct HeapCompare {
+        explicit HeapCompare(SortedSetOperation *op) : op(op) { }
+        bool operator()(const Cursor &lhs, const Cursor &rhs) const {
+            if (lhs.key != rhs.key)
+                return rhs.key < lhs.key;
+            const Input &linput = op->inputs_[lhs.input];
+            const Input &rinput = op->inputs_[rhs.input];
+            return op->comp_((*rinput.rows)[rinput.pos],
+                             (*linput.rows)[linput.pos]);
+        }
+        SortedSetOperation *op;
+    };
+
+    // Whether the current row of input, with the same key, is row
+    bool Equal(const Input &input, const RowT &row) const {
+        const RowT &current = (*input.rows)[input.pos];
+        return !comp_(current, row) && !comp_(row, current);
+    }
+
+    // Move the cursor at the back of the heap to the next row of its input
+    void Advance(HeapCompare &hcomp) {
+        Cursor &cursor = heap_.back();
+        Input &input = inputs_[cursor.input];
+        if (++input.pos == input.keys.size()) {
+            heap_.pop_back();
+        } else {
+            cursor.key = input.keys[input.pos];
+            std::push_heap(heap_.begin(), heap_.end(), hcomp);
+        }
+    }
+
+    void Emit(Input *input, size_t pos, RowVec *output) {
+        using std::swap;
+        output->push_back(RowT());
+        swap(output->back(), (*input->rows)[pos]);
+    }
+
+    // First position at or after from whose row is not less than
+    // (key, row)
+    size_t Gallop(const Input &input, size_t from, uint64_t key,
+                  const RowT &row) const {
+        const size_t size = input.keys.size();
+        size_t lo = from;
+        size_t step = 1;
+        size_t hi = from;
+        while (hi < size && RowLess(input, hi, key, row)) {
+            lo = hi + 1;
+            hi = from + step;
+            step <<= 1;
+        }
+        if (hi > size)
+            hi = size;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (RowLess(input, mid, key, row)) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+
+    bool RowLess(const Input &input, size_t pos, uint64_t key,
+                 const RowT &row) const {
+        if (input.keys[pos] != key)
+            return input.keys[pos] < key;
+        return comp_((*input.rows)[pos], row);
+    }
+
+    KeyFn key_;
+    Compare comp_;
+    std::vector<Input> inputs_;
+    std::vector<Cursor> heap_;
+};
+
+#endif  // SRC_QUERY_ENGINE_SORTED_SET_OPS_H_
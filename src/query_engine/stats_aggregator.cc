@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "stats_aggregator.h"
+
+#include <string.h>
+#include <algorithm>
+#include <boost/uuid/uuid.hpp>
+
+#include "query.h"
+
+using std::string;
+using std::vector;
+
+StatsAggregator::StatsAggregator() : staged_rows_(0) {
+}
+
+StatsAggregator::~StatsAggregator() {
+    STLDeleteValues(&columns_);
+}
+
+size_t StatsAggregator::AddColumn(AggOper oper, const string &name) {
+    Column *column = new Column(oper, name);
+    if (oper == QEOpServerProxy::CLASS) {
+        column->type = COL_FIRST;
+    } else if (oper == QEOpServerProxy::COUNT) {
+        column->type = COL_UINT64;
+    }
+    column->present.resize(groups_.size(), 0);
+    column->u64.resize(groups_.size(), 0);
+    column->dbl.resize(groups_.size(), 0);
+    columns_.push_back(column);
+    return columns_.size() - 1;
+}
+
+//
+// Encoding of a (name, value) pair: the name and a type tag are followed by
+// the raw value. Strings are length prefixed so that the encoding of a
+// sequence of pairs is unambiguous.
+//
+void StatsAggregator::EncodeValue(const string &name, const StatVal &value,
+                                  string *key) {
+    key->append(name);
+    key->push_back('\0');
+    key->push_back(static_cast<char>(value.which()));
+    switch (value.which()) {
+    case QEOpServerProxy::STRING: {
+        const string &str = *boost::get<string>(&value);
+        uint32_t len = str.size();
+        key->append(reinterpret_cast<const char *>(&len), sizeof(len));
+        key->append(str);
+        break;
+    }
+    case QEOpServerProxy::UINT64: {
+        uint64_t val = *boost::get<uint64_t>(&value);
+        key->append(reinterpret_cast<const char *>(&val), sizeof(val));
+        break;
+    }
+    case QEOpServerProxy::DOUBLE: {
+        double val = *boost::get<double>(&value);
+        key->append(reinterpret_cast<const char *>(&val), sizeof(val));
+        break;
+    }
+    case QEOpServerProxy::UUID: {
+        const boost::uuids::uuid &val = *boost::get<boost::uuids::uuid>(&value);
+        key->append(reinterpret_cast<const char *>(val.data), val.size());
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+uint32_t StatsAggregator::FindOrAddGroup(const string &key, bool *inserted) {
+    GroupMap::const_iterator it = group_map_.find(key);
+    if (it != group_map_.end()) {
+        *inserted = false;
+        return it->second;
+    }
+    *inserted = true;
+    uint32_t group = groups_.size();
+    group_map_.insert(std::make_pair(key, group));
+    groups_.push_back(Group());
+    for (vector<Column *>::iterator it = columns_.begin();
+         it != columns_.end(); ++it) {
+        Column *column = *it;
+        column->present.push_back(0);
+        column->u64.push_back(0);
+        column->dbl.push_back(0);
+    }
+    return group;
+}
+
+void StatsAggregator::SetGroupKey(uint32_t group, const vector<StatVal> &ukey,
+                                  const StatMap &uniks) {
+    groups_[group].ukey = ukey;
+    groups_[group].uniks = uniks;
+}
+
+void StatsAggregator::SetFirst(Column *column, uint32_t group,
+                               const StatVal &value) {
+    if (column->first.size() < groups_.size()) {
+        column->first.resize(groups_.size());
+    }
+    column->first[group] = value;
+    column->present[group] = 1;
+}
+
+void StatsAggregator::AddValue(size_t col, uint32_t group, uint64_t value,
+                               bool first) {
+    Column *column = columns_[col];
+    if (column->type == COL_NONE) {
+        column->type = COL_UINT64;
+    }
+    if (column->type == COL_FIRST) {
+        if (first) {
+            SetFirst(column, group, value);
+        }
+        return;
+    }
+    QE_ASSERT(column->type == COL_UINT64);
+    if (first) {
+        column->u64[group] = value;
+        column->present[group] = 1;
+        return;
+    }
+    // The aggregate is only present if the first row of the group had it
+    if (!column->present[group]) {
+        return;
+    }
+    column->staged_group.push_back(group);
+    column->staged_u64.push_back(value);
+}
+
+void StatsAggregator::AddValue(size_t col, uint32_t group,
+                               const StatVal &value, bool first) {
+    Column *column = columns_[col];
+    switch (value.which()) {
+    case QEOpServerProxy::UINT64:
+        AddValue(col, group, *boost::get<uint64_t>(&value), first);
+        return;
+    case QEOpServerProxy::DOUBLE:
+        if (column->type == COL_NONE) {
+            column->type = COL_DOUBLE;
+        }
+        break;
+    default:
+        if (column->type == COL_NONE) {
+            column->type = COL_FIRST;
+        }
+        break;
+    }
+
+    if (column->type == COL_FIRST) {
+        if (first) {
+            SetFirst(column, group, value);
+        }
+        return;
+    }
+    QE_ASSERT(column->type == COL_DOUBLE);
+    double dval = *boost::get<double>(&value);
+    if (first) {
+        column->dbl[group] = dval;
+        column->present[group] = 1;
+        return;
+    }
+    if (!column->present[group]) {
+        return;
+    }
+    column->staged_group.push_back(group);
+    column->staged_dbl.push_back(dval);
+}
+
+void StatsAggregator::RowDone() {
+    if (++staged_rows_ >= kBatchSize) {
+        Flush();
+    }
+}
+
+// Fold the staged values of one column into its accumulators
+void StatsAggregator::FlushColumn(Column *column) {
+    const size_t count = column->staged_group.size();
+    if (count == 0) {
+        return;
+    }
+    const uint32_t *groups = &column->staged_group[0];
+
+    if (column->type == COL_UINT64) {
+        uint64_t *acc = &column->u64[0];
+        const uint64_t *vals = &column->staged_u64[0];
+        switch (column->oper) {
+        case QEOpServerProxy::SUM:
+        case QEOpServerProxy::COUNT:
+            for (size_t i = 0; i < count; i++) {
+                acc[groups[i]] += vals[i];
+            }
+            break;
+        case QEOpServerProxy::MAX:
+            for (size_t i = 0; i < count; i++) {
+                acc[groups[i]] = std::max(acc[groups[i]], vals[i]);
+            }
+            break;
+        case QEOpServerProxy::MIN:
+            for (size_t i = 0; i < count; i++) {
+                acc[groups[i]] = std::min(acc[groups[i]], vals[i]);
+            }
+            break;
+        default:
+            break;
+        }
+    } else if (column->type == COL_DOUBLE) {
+        double *acc = &column->dbl[0];
+        const double *vals = &column->staged_dbl[0];
+        switch (column->oper) {
+        case QEOpServerProxy::SUM:
+            for (size_t i = 0; i < count; i++) {
+                acc[groups[i]] += vals[i];
+            }
+            break;
+        case QEOpServerProxy::MAX:
+            for (size_t i = 0; i < count; i++) {
+                acc[groups[i]] = std::max(acc[groups[i]], vals[i]);
+            }
+            break;
+        case QEOpServerProxy::MIN:
+            for (size_t i = 0; i < count; i++) {
+                acc[groups[i]] = std::min(acc[groups[i]], vals[i]);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    column->staged_group.clear();
+    column->staged_u64.clear();
+    column->staged_dbl.clear();
+}
+
+void StatsAggregator::Flush() {
+    for (vector<Column *>::iterator it = columns_.begin();
+         it != columns_.end(); ++it) {
+        FlushColumn(*it);
+    }
+    staged_rows_ = 0;
+}
+
+void StatsAggregator::GetGroup(uint32_t group,
+        const vector<StatVal> **ukey, const StatMap **uniks,
+        QEOpServerProxy::AggRowT *arow) const {
+    *ukey = &groups_[group].ukey;
+    *uniks = &groups_[group].uniks;
+    for (vector<Column *>::const_iterator it = columns_.begin();
+         it != columns_.end(); ++it) {
+        const Column *column = *it;
+        if (!column->present[group]) {
+            continue;
+        }
+        std::pair<AggOper, string> aggkey(column->oper, column->name);
+        switch (column->type) {
+        case COL_UINT64:
+            arow->insert(std::make_pair(aggkey, column->u64[group]));
+            break;
+        case COL_DOUBLE:
+            arow->insert(std::make_pair(aggkey, column->dbl[group]));
+            break;
+        case COL_FIRST:
+            arow->insert(std::make_pair(aggkey, column->first[group]));
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void StatsAggregator::Clear() {
+    Flush();
+    groups_.clear();
+    group_map_.clear();
+    for (vector<Column *>::iterator it = columns_.begin();
+         it != columns_.end(); ++it) {
+        Column *column = *it;
+        column->present.clear();
+        column->u64.clear();
+        column->dbl.clear();
+        column->first.clear();
+    }
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+/*
+ * Typed aggregation engine used by StatsSelect.
+ *
+ * Rows are grouped with a hash table keyed by the binary encoding of their
+ * group-by (unique) values. Every aggregate column keeps its accumulators
+ * in plain per-group arrays, and the values of a batch of rows are staged
+ * in per-column arrays that are then folded into the accumulators in tight
+ * loops. boost::variant values are only materialized when the aggregated
+ * rows are handed back to the caller.
+ */
+
+#ifndef SRC_QUERY_ENGINE_STATS_AGGREGATOR_H_
+#define SRC_QUERY_ENGINE_STATS_AGGREGATOR_H_
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/unordered_map.hpp>
+#include "base/util.h"
+#include "QEOpServerProxy.h"
+
+class StatsAggregator {
+public:
+    typedef QEOpServerProxy::SubVal StatVal;
+    typedef QEOpServerProxy::AggOper AggOper;
+    typedef std::map<std::string, StatVal> StatMap;
+
+    // Staged values are folded into the accumulators every kBatchSize rows
+    static const size_t kBatchSize = 4096;
+
+    StatsAggregator();
+    ~StatsAggregator();
+
+    // Add an aggregate column, returns the column index
+    size_t AddColumn(AggOper oper, const std::string &name);
+    size_t ColumnCount() const { return columns_.size(); }
+
+    // Append the encoding of a group-by value to key
+    static void EncodeValue(const std::string &name, const StatVal &value,
+                            std::string *key);
+
+    // Returns the group index for an encoded key, adding a new group if
+    // needed. inserted is set if the group was added by this call, in
+    // which case the caller must provide the group values with
+    // SetGroupKey.
+    uint32_t FindOrAddGroup(const std::string &key, bool *inserted);
+    void SetGroupKey(uint32_t group, const std::vector<StatVal> &ukey,
+                     const StatMap &uniks);
+    size_t GroupCount() const { return groups_.size(); }
+
+    // Add a value of the row to a column of the group. first must be set
+    // for the row that created the group; the aggregate is present in the
+    // output row only if the first row of the group carried it.
+    void AddValue(size_t col, uint32_t group, const StatVal &value,
+                  bool first);
+    void AddValue(size_t col, uint32_t group, uint64_t value, bool first);
+
+    // Must be called once per row, after its values have been added
+    void RowDone();
+
+    // Fold all staged values into the accumulators
+    void Flush();
+
+    // Materialize the aggregates of a group. Flush must have been called.
+    void GetGroup(uint32_t group, const std::vector<StatVal> **ukey,
+                  const StatMap **uniks, QEOpServerProxy::AggRowT *arow) const;
+
+    // Drop all groups, the columns are retained
+    void Clear();
+
+private:
+    enum ColumnType {
+        COL_NONE,
+        COL_UINT64,
+        COL_DOUBLE,
+        // Non numeric values, or CLASS: the first value is retained
+        COL_FIRST,
+    };
+
+    struct Column {
+        Column(AggOper oper, const std::string &name)
+            : oper(oper), name(name), type(COL_NONE) {
+        }
+        AggOper oper;
+        std::string name;
+        ColumnType type;
+
+        // Per group accumulators
+        std::vector<uint8_t> present;
+        std::vector<uint64_t> u64;
+        std::vector<double> dbl;
+        std::vector<StatVal> first;
+
+        // Values staged since the last flush
+        std::vector<uint32_t> staged_group;
+        std::vector<uint64_t> staged_u64;
+        std::vector<double> staged_dbl;
+    };
+
+    struct Group {
+        std::vector<StatVal> ukey;
+        StatMap uniks;
+    };
+
+    typedef boost::unordered_map<std::string, uint32_t> GroupMap;
+
+    void SetFirst(Column *column, uint32_t group, const StatVal &value);
+    void FlushColumn(Column *column);
+
+    std::vector<Column *> columns_;
+    std::vector<Group> groups_;
+    GroupMap group_map_;
+    size_t staged_rows_;
+
+    DISALLOW_COPY_AND_ASSIGN(StatsAggregator);
+};
+
+#endif  // SRC_QUERY_ENGINE_STATS_AGGREGATOR_H_
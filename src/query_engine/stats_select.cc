@@ -4,6 +4,7 @@
 #include "viz_constants.h"
 #include "stats_select.h"
 #include "stats_query.h"
+#include "stats_aggregator.h"
 #include "query.h"
 #include <cstdlib>
 #include <boost/assign/list_of.hpp>
@@ -164,7 +165,8 @@ StatsSelect::StatsSelect(AnalyticsQuery * m_query,
 		const std::vector<std::string> & select_fields) :
 			main_query(m_query), select_fields_(select_fields),
 			ts_period_(0), isT_(false),
-                        isTC_(false), isTBC_(false), count_field_() {
+                        isTC_(false), isTBC_(false), count_field_(),
+                        agg_(new StatsAggregator()), count_agg_col_(0) {
 
     QE_ASSERT(main_query->is_stat_table_query(main_query->table()));
     status_ = false;
@@ -248,9 +250,35 @@ StatsSelect::StatsSelect(AnalyticsQuery * m_query,
         }
     }
 
+    // Set up the aggregation columns. Attributes are looked up by name
+    // once per row entry, so index the columns by attribute name.
+    for (set<string>::const_iterator it = sum_cols_.begin();
+            it != sum_cols_.end(); it++) {
+        agg_cols_[*it].push_back(agg_->AddColumn(QEOpServerProxy::SUM, *it));
+    }
+    for (set<string>::const_iterator it = max_field_.begin();
+            it != max_field_.end(); it++) {
+        agg_cols_[*it].push_back(agg_->AddColumn(QEOpServerProxy::MAX, *it));
+    }
+    for (set<string>::const_iterator it = min_field_.begin();
+            it != min_field_.end(); it++) {
+        agg_cols_[*it].push_back(agg_->AddColumn(QEOpServerProxy::MIN, *it));
+    }
+    for (set<string>::const_iterator it = class_cols_.begin();
+            it != class_cols_.end(); it++) {
+        class_agg_cols_.push_back(
+            agg_->AddColumn(QEOpServerProxy::CLASS, *it));
+    }
+    if (!count_field_.empty()) {
+        count_agg_col_ = agg_->AddColumn(QEOpServerProxy::COUNT, count_field_);
+    }
+
     status_ = true;
 }
 
+StatsSelect::~StatsSelect() {
+}
+
 void StatsSelect::SetSortOrder(const std::vector<sort_field_t>& sort_fields) {
     if (sort_fields.size()) {
         sort_cols_.clear();
@@ -391,102 +419,146 @@ std::size_t boost::hash_value(const StatsSelect::StatVal& sv) {
     return boost::hash_value(ostr.str());
 }
 
+static bool UnikEntryCmp(const std::pair<const string *,
+                                   const StatsSelect::StatVal *> &lhs,
+                         const std::pair<const string *,
+                                   const StatsSelect::StatVal *> &rhs) {
+    return *lhs.first < *rhs.first;
+}
+
 bool StatsSelect::LoadRow(boost::uuids::uuid u,
 		uint64_t timestamp, const vector<StatEntry>& row, MapBufT& output) {
 
 	if (!Status()) return false;
     uint64_t ts = 0;
 
-    // Build Uniks map
-    StatMap uniks;
+    // Collect the unique columns of the row. The synthesized columns come
+    // first so that they take precedence over row attributes of the same
+    // name.
+    StatVal uuid_val, t_val, tb_val;
+    vector<pair<const string *, const StatVal *> > unik_entries;
     set<string>::const_iterator ukit =
         unik_cols_.find(g_viz_constants.STAT_UUID_FIELD);
     if (ukit!=unik_cols_.end()) {
-        uniks.insert(make_pair(g_viz_constants.STAT_UUID_FIELD,u));
+        uuid_val = u;
+        unik_entries.push_back(make_pair(&g_viz_constants.STAT_UUID_FIELD,
+                                         &uuid_val));
     }
-    
+
     if (isT_) {
         ts = timestamp;
-        uniks.insert(make_pair(g_viz_constants.STAT_TIME_FIELD,ts)); 
+        t_val = ts;
+        unik_entries.push_back(make_pair(&g_viz_constants.STAT_TIME_FIELD,
+                                         &t_val));
     }
 
     if (ts_period_) {
         ts = timestamp - (timestamp % ts_period_);
-        uniks.insert(make_pair(g_viz_constants.STAT_TIMEBIN_FIELD,ts)); 
+        tb_val = ts;
+        unik_entries.push_back(make_pair(&g_viz_constants.STAT_TIMEBIN_FIELD,
+                                         &tb_val));
     }
 
     for (vector<StatEntry>::const_iterator it = row.begin();
             it != row.end(); it++) {
         set<string>::const_iterator uit = unik_cols_.find(it->name);
         if (uit!=unik_cols_.end()) {
-            uniks.insert(make_pair(it->name, it->value));
+            unik_entries.push_back(make_pair(&it->name, &it->value));
         }
     }
+    std::stable_sort(unik_entries.begin(), unik_entries.end(), UnikEntryCmp);
 
-    // Build sort vector
-    // Last slot is reserved for the hash
-    std::vector<StatVal> ukey(sort_cols_.size() + agg_sort_cols_.size() + 1);
-    size_t hash_slot = sort_cols_.size() + agg_sort_cols_.size();
-    uint64_t hash_val = boost::hash_range(uniks.begin(), uniks.end());
-    ukey[hash_slot] = hash_val;
-
-    for (map<string, size_t>::const_iterator st = sort_cols_.begin();
-            st!=sort_cols_.end(); st++) {
-        QE_ASSERT(uniks.find(st->first) != uniks.end());
-        ukey[st->second] = uniks.at(st->first);
+    // Encode the group key, skipping duplicate column names
+    string gkey;
+    for (size_t idx = 0; idx < unik_entries.size(); idx++) {
+        if (idx && *unik_entries[idx].first == *unik_entries[idx-1].first) {
+            continue;
+        }
+        StatsAggregator::EncodeValue(*unik_entries[idx].first,
+                                     *unik_entries[idx].second, &gkey);
     }
 
-    QEOpServerProxy::AggRowT narows;
-    for (vector<StatEntry>::const_iterator it = row.begin();
-            it != row.end(); it++) {
-        set<string>::const_iterator uit = sum_cols_.find(it->name);
-        if (uit!=sum_cols_.end()) {
-            pair<QEOpServerProxy::AggOper,string> aggkey(QEOpServerProxy::SUM,it->name);
-            narows.insert(make_pair(aggkey, it->value)); 
+    bool first = false;
+    uint32_t group = agg_->FindOrAddGroup(gkey, &first);
+    if (first) {
+        // Build Uniks map
+        StatMap uniks;
+        for (size_t idx = 0; idx < unik_entries.size(); idx++) {
+            uniks.insert(make_pair(*unik_entries[idx].first,
+                                   *unik_entries[idx].second));
         }
+
+        // Build sort vector
+        // Last slot is reserved for the hash
+        std::vector<StatVal> ukey(sort_cols_.size() + agg_sort_cols_.size() + 1);
+        size_t hash_slot = sort_cols_.size() + agg_sort_cols_.size();
+        uint64_t hash_val = boost::hash_range(uniks.begin(), uniks.end());
+        ukey[hash_slot] = hash_val;
+
+        for (map<string, size_t>::const_iterator st = sort_cols_.begin();
+                st!=sort_cols_.end(); st++) {
+            QE_ASSERT(uniks.find(st->first) != uniks.end());
+            ukey[st->second] = uniks.at(st->first);
+        }
+
+        // CLASS aggregates keep the value of the first row of the group
+        size_t cidx = 0;
+        for (std::set<std::string>::const_iterator ct = class_cols_.begin();
+                ct!=class_cols_.end(); ct++, cidx++) {
+            StatMap huniks;
+            for (vector<StatEntry>::const_iterator rit = row.begin();
+                    rit != row.end(); rit++) {
+                if (rit->name != *ct) {
+                    if (uniks.find(rit->name) != uniks.end()) {
+                        // For generating the hash, consider all attributes that 
+                        // are in the row, and that do not match the CLASS attribute,
+                        // and that are in non-aggregate attributes in the SELECT
+                        huniks[rit->name] = rit->value;
+                    }
+                }
+            }
+            uint64_t hh = boost::hash_range(huniks.begin(), huniks.end());
+            agg_->AddValue(class_agg_cols_[cidx], group, hh, true);
+        }
+        agg_->SetGroupKey(group, ukey, uniks);
     }
 
+    // Accumulate SUM/MAX/MIN attributes. Only the first occurrence of an
+    // attribute in the row is considered; the attributes already seen are
+    // tracked by their entry in agg_cols_.
+    set<const std::vector<size_t> *> seen;
     for (vector<StatEntry>::const_iterator it = row.begin();
             it != row.end(); it++) {
-        set<string>::const_iterator uit = max_field_.find(it->name);
-        if (uit!=max_field_.end()) {
-            pair<QEOpServerProxy::AggOper,string> aggkey(QEOpServerProxy::MAX,it->name);
-            narows.insert(make_pair(aggkey, it->value)); 
+        std::map<std::string, std::vector<size_t> >::const_iterator ct =
+            agg_cols_.find(it->name);
+        if (ct == agg_cols_.end()) {
+            continue;
         }
-        uit = min_field_.find(it->name);
-        if (uit!=min_field_.end()) {
-            pair<QEOpServerProxy::AggOper,string> aggkey(QEOpServerProxy::MIN,it->name);
-            narows.insert(make_pair(aggkey, it->value)); 
+        if (!seen.insert(&ct->second).second) {
+            continue;
         }
-    }
-
-    
-    for (std::set<std::string>::const_iterator ct = class_cols_.begin();
-            ct!=class_cols_.end(); ct++) {
-        pair<QEOpServerProxy::AggOper,string> aggkey(QEOpServerProxy::CLASS,*ct);
-        StatMap huniks;
-        for (vector<StatEntry>::const_iterator rit = row.begin();
-                rit != row.end(); rit++) {
-            if (rit->name != *ct) {
-                if (uniks.find(rit->name) != uniks.end()) {
-                    // For generating the hash, consider all attributes that 
-                    // are in the row, and that do not match the CLASS attribute,
-                    // and that are in non-aggregate attributes in the SELECT
-                    huniks[rit->name] = rit->value;
-                }
-            }
+        for (size_t idx = 0; idx < ct->second.size(); idx++) {
+            agg_->AddValue(ct->second[idx], group, it->value, first);
         }
-        uint64_t hh = boost::hash_range(huniks.begin(), huniks.end());
-        narows.insert(make_pair(aggkey, hh));
     }
- 
+
     if (!count_field_.empty()) {
-        pair<QEOpServerProxy::AggOper,string> aggkey(QEOpServerProxy::COUNT,count_field_);
-        narows.insert(make_pair(aggkey, (uint64_t) 1));            
+        agg_->AddValue(count_agg_col_, group, (uint64_t) 1, first);
     }
-
-    MergeFullRow(ukey, uniks, narows, output);
+    agg_->RowDone();
 
     return true;
 }
 
+void StatsSelect::LoadComplete(MapBufT& output) {
+    if (!Status()) return;
+    agg_->Flush();
+    for (uint32_t group = 0; group < agg_->GroupCount(); group++) {
+        const std::vector<StatVal> *ukey;
+        const StatMap *uniks;
+        QEOpServerProxy::AggRowT narows;
+        agg_->GetGroup(group, &ukey, &uniks, &narows);
+        MergeFullRow(*ukey, *uniks, narows, output);
+    }
+    agg_->Clear();
+}
@@ -15,12 +15,14 @@
 #include <map>
 #include <set>
 #include <utility>
+#include <boost/scoped_ptr.hpp>
 #include <boost/variant.hpp>
 #include <boost/uuid/uuid.hpp>
 #include "QEOpServerProxy.h"
 #include "query.h"
 
 class AnalyticsQuery;
+class StatsAggregator;
 
 class StatsSelect {
 public:
@@ -37,15 +39,22 @@ public:
     };
 
     StatsSelect(AnalyticsQuery * main_query, const std::vector<std::string> & select_fields);
+    ~StatsSelect();
 
     // This should be called after the post processing is over
     void SetSortOrder(const std::vector<sort_field_t>& sort_fields);
 
     // The client call this function once with every row from the where result.
     // cols that are not in the SELECT will be silently dropped.
+    // Rows are aggregated internally; they are written to output only when
+    // LoadComplete is called.
     bool LoadRow(boost::uuids::uuid u, uint64_t timestamp,
             const std::vector<StatEntry>& row, MapBufT& output);
 
+    // The client calls this function after the last LoadRow to materialize
+    // the aggregated rows into output.
+    void LoadComplete(MapBufT& output);
+
     bool Status() { return status_; }
 
     bool IsMergeNeeded() { return !isT_; }
@@ -102,5 +111,13 @@ private:
     std::set<std::string> max_field_;
     std::set<std::string> min_field_;
 
+    // Typed aggregation of the loaded rows
+    boost::scoped_ptr<StatsAggregator> agg_;
+    // Aggregation columns for SUM/MAX/MIN, indexed by attribute name
+    std::map<std::string, std::vector<size_t> > agg_cols_;
+    // Aggregation columns for CLASS, in the order of class_cols_
+    std::vector<size_t> class_agg_cols_;
+    size_t count_agg_col_;
+
 };
 #endif
@@ -0,0 +1,330 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <unistd.h>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <testing/gunit.h>
+#include <base/string_util.h>
+#include <base/time_util.h>
+#include <base/test/task_test_util.h>
+#include "../db_query_reader.h"
+
+using std::map;
+using std::string;
+using std::vector;
+
+typedef map<GenDb::DbDataValueVec, vector<uint32_t> > RowMap;
+
+//
+// Read-only column store. A read takes a fixed latency plus a per column
+// transfer time. Columns of a row are named (T1) and returned in name
+// order, honoring the column range.
+//
+class FakeGenDb : public GenDb::GenDbIf {
+public:
+    static const useconds_t kColumnUsec = 1;
+
+    FakeGenDb(boost::shared_ptr<RowMap> rows, useconds_t latency)
+        : rows_(rows), latency_(latency), fail_(false) {
+    }
+
+    virtual bool Db_Init(const string &task_id, int task_instance) {
+        return true;
+    }
+    virtual void Db_Uninit(const string &task_id, int task_instance) {}
+    virtual void Db_UninitUnlocked(const string &task_id, int task_instance) {}
+    virtual void Db_SetInitDone(bool init_done) {}
+    virtual bool Db_AddTablespace(const string &tablespace,
+                                  const string &replication_factor) {
+        return true;
+    }
+    virtual bool Db_SetTablespace(const string &tablespace) { return true; }
+    virtual bool Db_AddSetTablespace(const string &tablespace,
+                                     const string &replication_factor) {
+        return true;
+    }
+    virtual bool Db_FindTablespace(const string &tablespace) { return true; }
+    virtual bool Db_AddColumnfamily(const GenDb::NewCf &cf) { return true; }
+    virtual bool Db_UseColumnfamily(const GenDb::NewCf &cf) { return true; }
+    virtual bool Db_AddColumn(std::auto_ptr<GenDb::ColList> cl) {
+        return false;
+    }
+    virtual bool Db_AddColumnSync(std::auto_ptr<GenDb::ColList> cl) {
+        return false;
+    }
+    virtual bool Db_GetRow(GenDb::ColList &ret, const string &cfname,
+                           const GenDb::DbDataValueVec &rowkey) {
+        return false;
+    }
+
+    virtual bool Db_GetMultiRow(GenDb::ColListVec &ret, const string &cfname,
+                                const vector<GenDb::DbDataValueVec> &keys,
+                                GenDb::ColumnNameRange *cr) {
+        if (fail_) {
+            usleep(latency_);
+            return false;
+        }
+        size_t ncolumns = 0;
+        for (vector<GenDb::DbDataValueVec>::const_iterator it = keys.begin();
+             it != keys.end(); ++it) {
+            RowMap::const_iterator rt = rows_->find(*it);
+            if (rt == rows_->end()) {
+                continue;
+            }
+            GenDb::ColList *row = new GenDb::ColList;
+            row->cfname_ = cfname;
+            row->rowkey_ = *it;
+            for (vector<uint32_t>::const_iterator ct = rt->second.begin();
+                 ct != rt->second.end() && row->columns_.size() < cr->count;
+                 ++ct) {
+                GenDb::DbDataValueVec name(1, *ct);
+                if (name < cr->start_ || cr->finish_ < name) {
+                    continue;
+                }
+                row->columns_.push_back(new GenDb::NewCol(
+                    new GenDb::DbDataValueVec(name),
+                    new GenDb::DbDataValueVec(1, string("value")), 0));
+            }
+            ncolumns += row->columns_.size();
+            ret.push_back(row);
+        }
+        if (latency_) {
+            usleep(latency_ + kColumnUsec * ncolumns);
+        }
+        return true;
+    }
+
+    virtual bool Db_GetQueueStats(uint64_t *queue_count,
+                                  uint64_t *enqueues) const {
+        return false;
+    }
+    virtual void Db_SetQueueWaterMark(bool high, size_t queue_count,
+                                      DbQueueWaterMarkCb cb) {}
+    virtual void Db_ResetQueueWaterMarks() {}
+    virtual bool Db_GetStats(vector<GenDb::DbTableInfo> *vdbti,
+                             GenDb::DbErrors *dbe) {
+        return false;
+    }
+    virtual string Db_GetHost() const { return "127.0.0.1"; }
+    virtual int Db_GetPort() const { return 9160; }
+
+    void set_fail(bool fail) { fail_ = fail; }
+
+private:
+    boost::shared_ptr<RowMap> rows_;
+    useconds_t latency_;
+    bool fail_;
+};
+
+class DbQueryReaderTest : public ::testing::Test {
+public:
+    GenDb::GenDbIf *CreateDbIf() {
+        return new FakeGenDb(rows_, latency_);
+    }
+
+protected:
+    DbQueryReaderTest() : rows_(new RowMap), latency_(0) {
+    }
+
+    virtual void TearDown() {
+        task_util::WaitForIdle();
+    }
+
+    DbConnectionPool *CreatePool(size_t max_connections) {
+        return new DbConnectionPool(
+            boost::bind(&DbQueryReaderTest::CreateDbIf, this),
+            max_connections);
+    }
+
+    GenDb::DbDataValueVec RowKey(uint32_t t2, const string &term) {
+        GenDb::DbDataValueVec rowkey;
+        rowkey.push_back(t2);
+        rowkey.push_back(term);
+        return rowkey;
+    }
+
+    void AddRow(const GenDb::DbDataValueVec &rowkey, uint32_t ncolumns) {
+        vector<uint32_t> &columns = (*rows_)[rowkey];
+        for (uint32_t i = 0; i < ncolumns; i++) {
+            columns.push_back(i);
+        }
+    }
+
+    GenDb::ColumnNameRange Range(uint32_t start, uint32_t finish) {
+        GenDb::ColumnNameRange cr;
+        cr.start_.push_back(start);
+        cr.finish_.push_back(finish);
+        return cr;
+    }
+
+    boost::shared_ptr<RowMap> rows_;
+    useconds_t latency_;
+};
+
+// Rows larger than a page are read page by page and returned in order
+TEST_F(DbQueryReaderTest, Paging) {
+    AddRow(RowKey(1, "vn1"), 2500);
+    AddRow(RowKey(2, "vn1"), 1000);
+    AddRow(RowKey(3, "vn1"), 999);
+    AddRow(RowKey(1, "vn2"), 10);
+
+    FakeGenDb db(rows_, latency_);
+    boost::scoped_ptr<DbConnectionPool> pool(CreatePool(3));
+    boost::shared_ptr<DbQueryReader> reader(
+        new DbQueryReader(&db, pool.get(), 4, 1000));
+    reader->AddSlice("cf", RowKey(1, "vn1"), Range(0, 0xffffffff));
+    reader->AddSlice("cf", RowKey(2, "vn1"), Range(0, 0xffffffff));
+    reader->AddSlice("cf", RowKey(3, "vn1"), Range(0, 0xffffffff));
+    reader->AddSlice("cf", RowKey(1, "vn2"), Range(5, 0xffffffff));
+    reader->AddSlice("cf", RowKey(4, "vn2"), Range(0, 0xffffffff));
+    EXPECT_TRUE(reader->Run());
+
+    GenDb::ColListVec result;
+    for (size_t i = 0; i < reader->SliceCount(); i++) {
+        reader->TransferResult(i, &result);
+    }
+    ASSERT_EQ(5U, result.size());
+    const uint32_t expected[] = { 2500, 1000, 999, 5, 0 };
+    for (size_t i = 0; i < result.size(); i++) {
+        const GenDb::NewColVec &columns = result[i].columns_;
+        EXPECT_EQ(expected[i], columns.size());
+        uint32_t next = (i == 3) ? 5 : 0;
+        for (size_t j = 0; j < columns.size(); j++, next++) {
+            EXPECT_EQ(GenDb::DbDataValue(next), columns[j].name->at(0));
+        }
+    }
+    EXPECT_TRUE(RowKey(1, "vn2") == result[3].rowkey_);
+    // 3 pages for the first row, 2 for the second, 1 for the others
+    EXPECT_EQ(8U, reader->reads());
+    task_util::WaitForIdle();
+    EXPECT_GE(3U, pool->size());
+}
+
+TEST_F(DbQueryReaderTest, Failure) {
+    AddRow(RowKey(1, "vn1"), 10);
+    FakeGenDb db(rows_, latency_);
+    db.set_fail(true);
+    boost::shared_ptr<DbQueryReader> reader(new DbQueryReader(&db, NULL));
+    reader->AddSlice("cf", RowKey(1, "vn1"), Range(0, 0xffffffff));
+    reader->AddSlice("cf", RowKey(2, "vn1"), Range(0, 0xffffffff));
+    EXPECT_FALSE(reader->Run());
+    // The remaining reads are abandoned after the first failure
+    EXPECT_EQ(1U, reader->reads());
+}
+
+// The connections of the pool are opened once and shared by the readers
+TEST_F(DbQueryReaderTest, Pool) {
+    latency_ = 1000;
+    for (uint32_t t2 = 0; t2 < 16; t2++) {
+        AddRow(RowKey(t2, "vn1"), 10);
+    }
+    FakeGenDb db(rows_, latency_);
+    boost::scoped_ptr<DbConnectionPool> pool(CreatePool(2));
+    for (int i = 0; i < 4; i++) {
+        boost::shared_ptr<DbQueryReader> reader(
+            new DbQueryReader(&db, pool.get()));
+        for (uint32_t t2 = 0; t2 < 16; t2++) {
+            reader->AddSlice("cf", RowKey(t2, "vn1"), Range(0, 0xffffffff));
+        }
+        EXPECT_TRUE(reader->Run());
+        EXPECT_GE(3U, reader->max_inflight_reached());
+    }
+    task_util::WaitForIdle();
+    EXPECT_GE(2U, pool->size());
+
+    // With the pool exhausted only the caller reads
+    GenDb::GenDbIf *dbif1 = pool->Get();
+    GenDb::GenDbIf *dbif2 = pool->Get();
+    EXPECT_TRUE(dbif1 != NULL);
+    EXPECT_TRUE(dbif2 != NULL);
+    EXPECT_TRUE(pool->Get() == NULL);
+    boost::shared_ptr<DbQueryReader> reader(
+        new DbQueryReader(&db, pool.get()));
+    for (uint32_t t2 = 0; t2 < 16; t2++) {
+        reader->AddSlice("cf", RowKey(t2, "vn1"), Range(0, 0xffffffff));
+    }
+    EXPECT_TRUE(reader->Run());
+    EXPECT_EQ(1U, reader->max_inflight_reached());
+    task_util::WaitForIdle();
+    pool->Put(dbif1);
+    pool->Put(dbif2);
+    EXPECT_EQ(2U, pool->size());
+}
+
+//
+// A WHERE clause of 8 OR terms over a 24 hour query, 24 rows per term,
+// with 2ms of read latency and 1us per column. The sequential reader is
+// the behavior of DbQueryUnit, one multi-row read per term after the other.
+//
+TEST_F(DbQueryReaderTest, Latency) {
+    const int kTerms = 8;
+    const uint32_t kRows = 24;
+    latency_ = 2000;
+    for (int i = 0; i < kTerms; i++) {
+        for (uint32_t t2 = 0; t2 < kRows; t2++) {
+            AddRow(RowKey(t2, "vn" + integerToString(i)),
+                   2000 + 1000 * (t2 % 3));
+        }
+    }
+
+    FakeGenDb db(rows_, latency_);
+    uint64_t start = ClockMonotonicUsec();
+    size_t seq_columns = 0;
+    for (int i = 0; i < kTerms; i++) {
+        vector<GenDb::DbDataValueVec> keys;
+        for (uint32_t t2 = 0; t2 < kRows; t2++) {
+            keys.push_back(RowKey(t2, "vn" + integerToString(i)));
+        }
+        GenDb::ColumnNameRange cr = Range(0, 0xffffffff);
+        cr.count = 100000000;
+        GenDb::ColListVec result;
+        EXPECT_TRUE(db.Db_GetMultiRow(result, "cf", keys, &cr));
+        for (size_t j = 0; j < result.size(); j++) {
+            seq_columns += result[j].columns_.size();
+        }
+    }
+    uint64_t seq_usec = ClockMonotonicUsec() - start;
+
+    const size_t kInflight[] = { 1, 4, 8 };
+    for (size_t k = 0; k < sizeof(kInflight) / sizeof(kInflight[0]); k++) {
+        boost::scoped_ptr<DbConnectionPool> pool(
+            CreatePool(kInflight[k] - 1));
+        start = ClockMonotonicUsec();
+        boost::shared_ptr<DbQueryReader> reader(
+            new DbQueryReader(&db, pool.get(), kInflight[k]));
+        for (int i = 0; i < kTerms; i++) {
+            for (uint32_t t2 = 0; t2 < kRows; t2++) {
+                reader->AddSlice("cf",
+                                 RowKey(t2, "vn" + integerToString(i)),
+                                 Range(0, 0xffffffff));
+            }
+        }
+        EXPECT_TRUE(reader->Run());
+        GenDb::ColListVec result;
+        size_t columns = 0;
+        for (size_t i = 0; i < reader->SliceCount(); i++) {
+            reader->TransferResult(i, &result);
+            columns += result.back().columns_.size();
+        }
+        uint64_t usec = ClockMonotonicUsec() - start;
+        EXPECT_EQ(seq_columns, columns);
+        EXPECT_GE(kInflight[k], reader->max_inflight_reached());
+        std::cout << kTerms << " terms x " << kRows << " rows: sequential " <<
+            seq_usec << " usec, " << kInflight[k] << " in flight (" <<
+            reader->reads() << " reads) " << usec << " usec" << std::endl;
+        task_util::WaitForIdle();
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    int result = RUN_ALL_TESTS();
+    return result;
+}
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <stdlib.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "testing/gunit.h"
+#include "base/logging.h"
+#include "base/string_util.h"
+#include "base/time_util.h"
+
+#include "query.h"
+#include "analytics_query_mock.h"
+
+using ::testing::Return;
+using ::testing::AnyNumber;
+
+//
+// Top N flows by bytes, i.e. a flow series query that selects the flow
+// tuple and sum(bytes), sorted on sum(bytes) in descending order. Every
+// chunk of the query returns partial sums for the flows it has seen, and
+// the flows are spread over several chunks.
+//
+class PostProcessingTest : public ::testing::Test {
+protected:
+    typedef std::vector<boost::shared_ptr<QEOpServerProxy::BufferT> >
+        ChunkList;
+
+    PostProcessingTest() : select_query_(NULL), postprocess_(NULL) {
+    }
+
+    virtual void SetUp() {
+        EXPECT_CALL(analytics_query_mock_, table())
+            .Times(AnyNumber())
+            .WillRepeatedly(Return(g_viz_constants.FLOW_SERIES_TABLE));
+        EXPECT_CALL(analytics_query_mock_, is_object_table_query())
+            .Times(AnyNumber())
+            .WillRepeatedly(Return(false));
+        EXPECT_CALL(analytics_query_mock_, is_stat_table_query())
+            .Times(AnyNumber())
+            .WillRepeatedly(Return(false));
+        EXPECT_CALL(analytics_query_mock_, is_flow_query())
+            .Times(AnyNumber())
+            .WillRepeatedly(Return(true));
+        EXPECT_CALL(analytics_query_mock_, is_query_parallelized())
+            .Times(AnyNumber())
+            .WillRepeatedly(Return(true));
+
+        std::map<std::string, std::string> json_select;
+        json_select.insert(std::make_pair("select_fields",
+            "[\"sourceip\", \"destip\", \"protocol\", \"sum(bytes)\"]"));
+        select_query_ = new SelectQuery(&analytics_query_mock_, json_select);
+        analytics_query_mock_.selectquery_ = select_query_;
+        ASSERT_EQ(SelectQuery::FS_SELECT_FLOW_TUPLE_STATS,
+                  (int)select_query_->flowseries_query_type());
+
+        std::map<std::string, std::string> json_post;
+        postprocess_ = new PostProcessingQuery(json_post,
+                                               &analytics_query_mock_);
+        postprocess_->sorted = true;
+        postprocess_->sorting_type = DESCENDING;
+        postprocess_->sort_fields.push_back(
+            sort_field_t(SELECT_SUM_BYTES, "long"));
+    }
+
+    // Flow i has the flow class id i and sends i * 1000 + 1 bytes in every
+    // chunk it is present in. A flow is present in the chunks from
+    // i % nchunks on, which spreads the totals of the top flows apart.
+    void BuildChunks(int nchunks, int nflows, ChunkList *chunks,
+                     std::map<uint64_t, uint64_t> *totals) {
+        for (int i = 0; i < nchunks; i++) {
+            chunks->push_back(boost::shared_ptr<QEOpServerProxy::BufferT>(
+                new QEOpServerProxy::BufferT));
+        }
+        for (int i = 0; i < nflows; i++) {
+            uint64_t bytes = (uint64_t)i * 1000 + 1;
+            for (int j = i % nchunks; j < nchunks; j++) {
+                QEOpServerProxy::OutRowT row;
+                row["sourceip"] = integerToString(0x0a000000 + i);
+                row["destip"] = integerToString(0x0b000000 + i % 256);
+                row["protocol"] = "6";
+                row[SELECT_FLOW_CLASS_ID] = integerToString(i);
+                row[SELECT_SUM_BYTES] = integerToString(bytes);
+                chunks->at(j)->push_back(QEOpServerProxy::ResultRowT(row,
+                    QEOpServerProxy::MetadataT()));
+                (*totals)[i] += bytes;
+            }
+        }
+        // The rows of a chunk are in no particular order
+        for (int i = 0; i < nchunks; i++) {
+            std::random_shuffle(chunks->at(i)->begin(), chunks->at(i)->end());
+        }
+    }
+
+    // Run the post processing of every chunk, as done for each parallel
+    // instance of the query.
+    void ProcessChunks(ChunkList *chunks, ChunkList *results) {
+        for (size_t i = 0; i < chunks->size(); i++) {
+            select_query_->result_.reset(
+                new QEOpServerProxy::BufferT);
+            select_query_->result_->swap(*chunks->at(i));
+            EXPECT_EQ(QUERY_SUCCESS, postprocess_->process_query());
+            results->push_back(boost::shared_ptr<QEOpServerProxy::BufferT>(
+                postprocess_->result_.release()));
+        }
+    }
+
+    uint64_t RowBytes(const QEOpServerProxy::ResultRowT &row) {
+        uint64_t bytes = 0;
+        stringToInteger(row.first.find(SELECT_SUM_BYTES)->second, bytes);
+        return bytes;
+    }
+
+    AnalyticsQueryMock analytics_query_mock_;
+    SelectQuery *select_query_;
+    PostProcessingQuery *postprocess_;
+};
+
+// The top N is taken only after the partial sums of all the chunks are
+// aggregated.
+TEST_F(PostProcessingTest, FlowTupleStatsTopN) {
+    const int kChunks = 8;
+    const int kLimit = 10;
+    ChunkList chunks, results;
+    std::map<uint64_t, uint64_t> totals;
+    BuildChunks(kChunks, 100, &chunks, &totals);
+    std::vector<size_t> sizes;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        sizes.push_back(chunks[i]->size());
+    }
+
+    postprocess_->limit = kLimit;
+    ProcessChunks(&chunks, &results);
+
+    // The chunks keep all their partial sums
+    ASSERT_EQ(sizes.size(), results.size());
+    for (size_t i = 0; i < results.size(); i++) {
+        EXPECT_EQ(sizes[i], results[i]->size());
+    }
+
+    QEOpServerProxy::BufferT output;
+    EXPECT_TRUE(postprocess_->final_merge_processing(results, output));
+
+    std::vector<std::pair<uint64_t, uint64_t> > expected;
+    for (std::map<uint64_t, uint64_t>::const_iterator it = totals.begin();
+         it != totals.end(); ++it) {
+        expected.push_back(std::make_pair(it->second, it->first));
+    }
+    std::sort(expected.rbegin(), expected.rend());
+
+    ASSERT_EQ((size_t)kLimit, output.size());
+    for (int i = 0; i < kLimit; i++) {
+        EXPECT_EQ(expected[i].first, RowBytes(output[i]));
+        EXPECT_EQ(integerToString(expected[i].second),
+                  output[i].first[SELECT_FLOW_CLASS_ID]);
+    }
+}
+
+// Top 100 flows by bytes over 24h, with one chunk per 10 minutes. Compares
+// the previous path, which fully sorts every chunk, aggregates them and
+// fully sorts the aggregate, with the aggregation followed by a top N
+// partial sort. Run only if QE_TOP_FLOWS_BENCH_FLOWS is set.
+TEST_F(PostProcessingTest, Top100FlowsByBytes) {
+    if (!getenv("QE_TOP_FLOWS_BENCH_FLOWS")) {
+        return;
+    }
+    int nflows = strtol(getenv("QE_TOP_FLOWS_BENCH_FLOWS"), NULL, 0);
+    const int kChunks = 144;
+    const int kLimit = 100;
+    ChunkList chunks;
+    std::map<uint64_t, uint64_t> totals;
+    BuildChunks(kChunks, nflows, &chunks, &totals);
+
+    ChunkList old_chunks;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        old_chunks.push_back(boost::shared_ptr<QEOpServerProxy::BufferT>(
+            new QEOpServerProxy::BufferT(*chunks[i])));
+    }
+
+    // Previous path
+    uint64_t start = ClockMonotonicUsec();
+    for (size_t i = 0; i < old_chunks.size(); i++) {
+        std::sort(old_chunks[i]->begin(), old_chunks[i]->end(),
+            boost::bind(&PostProcessingQuery::result_row_comparator,
+                        postprocess_, _1, _2));
+    }
+    QEOpServerProxy::BufferT before;
+    postprocess_->sorted = false;
+    EXPECT_TRUE(postprocess_->final_merge_processing(old_chunks, before));
+    postprocess_->sorted = true;
+    std::sort(before.begin(), before.end(),
+        boost::bind(&PostProcessingQuery::result_row_comparator,
+                    postprocess_, _1, _2));
+    before.resize(kLimit);
+    uint64_t before_usecs = ClockMonotonicUsec() - start;
+
+    // Current path
+    postprocess_->limit = kLimit;
+    start = ClockMonotonicUsec();
+    ChunkList results;
+    ProcessChunks(&chunks, &results);
+    QEOpServerProxy::BufferT after;
+    EXPECT_TRUE(postprocess_->final_merge_processing(results, after));
+    uint64_t after_usecs = ClockMonotonicUsec() - start;
+
+    LOG(DEBUG, "Top " << kLimit << " of " << nflows << " flows over " <<
+        kChunks << " chunks: sort+aggregate+sort " << before_usecs <<
+        " usec, aggregate+top N " << after_usecs << " usec");
+
+    ASSERT_EQ((size_t)kLimit, after.size());
+    for (int i = 0; i < kLimit; i++) {
+        EXPECT_EQ(RowBytes(before[i]), RowBytes(after[i]));
+    }
+}
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <stdlib.h>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <testing/gunit.h>
+#include <base/time_util.h>
+#include <base/string_util.h>
+#include "../sorted_merge.h"
+
+using std::map;
+using std::string;
+using std::vector;
+using boost::shared_ptr;
+
+// Mirrors QEOpServerProxy::ResultRowT without pulling in the query engine
+typedef map<string, string> RowT;
+typedef vector<RowT> BufT;
+
+static const char *kTimestamp = "MessageTS";
+
+// Descending on the timestamp, the order used by a "latest N messages"
+// query
+struct TimestampDescending {
+    bool operator()(const RowT &lhs, const RowT &rhs) const {
+        uint64_t lval = 0, rval = 0;
+        stringToInteger(lhs.find(kTimestamp)->second, lval);
+        stringToInteger(rhs.find(kTimestamp)->second, rval);
+        return lval > rval;
+    }
+};
+
+struct IntDescending {
+    bool operator()(int lhs, int rhs) const { return lhs > rhs; }
+};
+
+class SortedMergeTest : public ::testing::Test {
+protected:
+    // Synthetic message table result: one chunk per time slice of a 24h
+    // query, each holding the messages of that slice. The rows of a chunk
+    // are final, so the limit is pushed down into the chunks.
+    void BuildChunks(int nchunks, int rows_per_chunk,
+                     vector<shared_ptr<BufT> > *chunks) {
+        srand(0x5eed);
+        for (int i = 0; i < nchunks; i++) {
+            shared_ptr<BufT> chunk(new BufT);
+            chunk->reserve(rows_per_chunk);
+            for (int j = 0; j < rows_per_chunk; j++) {
+                RowT row;
+                row["Source"] = "node" + integerToString(j % 64);
+                row["Messagetype"] = "FlowLogData";
+                row[kTimestamp] = integerToString(
+                    (uint64_t)rand() * 1024 + (uint64_t)rand() % 1024);
+                chunk->push_back(row);
+            }
+            chunks->push_back(chunk);
+        }
+    }
+
+    // Baseline: every chunk fully sorted, concatenated, fully re-sorted and
+    // then truncated, as done by PostProcessingQuery before the k-way merge.
+    uint64_t ConcatSort(vector<shared_ptr<BufT> > chunks, size_t limit,
+                        BufT *output) {
+        uint64_t start = ClockMonotonicUsec();
+        for (size_t i = 0; i < chunks.size(); i++) {
+            std::sort(chunks[i]->begin(), chunks[i]->end(),
+                      TimestampDescending());
+        }
+        size_t total = 0;
+        for (size_t i = 0; i < chunks.size(); i++) {
+            total += chunks[i]->size();
+        }
+        output->reserve(total);
+        for (size_t i = 0; i < chunks.size(); i++) {
+            output->insert(output->end(), chunks[i]->begin(),
+                           chunks[i]->end());
+        }
+        std::sort(output->begin(), output->end(), TimestampDescending());
+        if (output->size() > limit) {
+            output->resize(limit);
+        }
+        return ClockMonotonicUsec() - start;
+    }
+
+    // Top-N pushed into the chunks (partial sort) followed by a k-way
+    // merge that stops after N rows.
+    uint64_t TopNMerge(vector<shared_ptr<BufT> > chunks, size_t limit,
+                       BufT *output) {
+        uint64_t start = ClockMonotonicUsec();
+        for (size_t i = 0; i < chunks.size(); i++) {
+            BufT *chunk = chunks[i].get();
+            if (chunk->size() > limit) {
+                std::partial_sort(chunk->begin(), chunk->begin() + limit,
+                                  chunk->end(), TimestampDescending());
+                chunk->resize(limit);
+            } else {
+                std::sort(chunk->begin(), chunk->end(), TimestampDescending());
+            }
+        }
+        SortedMerge(chunks, output, TimestampDescending(), limit);
+        return ClockMonotonicUsec() - start;
+    }
+
+    vector<shared_ptr<BufT> > Copy(const vector<shared_ptr<BufT> > &chunks) {
+        vector<shared_ptr<BufT> > copy;
+        for (size_t i = 0; i < chunks.size(); i++) {
+            copy.push_back(shared_ptr<BufT>(new BufT(*chunks[i])));
+        }
+        return copy;
+    }
+};
+
+TEST_F(SortedMergeTest, Basic) {
+    vector<shared_ptr<vector<int> > > inputs;
+    int a[] = { 9, 7, 5, 1 };
+    int b[] = { 8, 7, 2 };
+    int c[] = { 10 };
+    inputs.push_back(shared_ptr<vector<int> >(new vector<int>(a, a + 4)));
+    inputs.push_back(shared_ptr<vector<int> >(new vector<int>()));
+    inputs.push_back(shared_ptr<vector<int> >(new vector<int>(b, b + 3)));
+    inputs.push_back(shared_ptr<vector<int> >(new vector<int>(c, c + 1)));
+
+    vector<int> output;
+    SortedMerge(inputs, &output, IntDescending(), 0);
+    int expected[] = { 10, 9, 8, 7, 7, 5, 2, 1 };
+    EXPECT_EQ(vector<int>(expected, expected + 8), output);
+}
+
+TEST_F(SortedMergeTest, Limit) {
+    vector<shared_ptr<vector<int> > > inputs;
+    for (int i = 0; i < 10; i++) {
+        shared_ptr<vector<int> > input(new vector<int>());
+        for (int j = 100; j > 0; j--) {
+            input->push_back(j * 10 + i);
+        }
+        inputs.push_back(input);
+    }
+    vector<int> output;
+    SortedMerge(inputs, &output, IntDescending(), 5);
+    int expected[] = { 1009, 1008, 1007, 1006, 1005 };
+    EXPECT_EQ(vector<int>(expected, expected + 5), output);
+}
+
+// Latest 100 messages over 24h, with one chunk per 10 minutes. Run only if
+// QE_LATEST_MESSAGES_BENCH_ROWS (rows per chunk) is set.
+TEST_F(SortedMergeTest, Latest100Messages) {
+    if (!getenv("QE_LATEST_MESSAGES_BENCH_ROWS")) {
+        return;
+    }
+    int rows = strtol(getenv("QE_LATEST_MESSAGES_BENCH_ROWS"), NULL, 0);
+    const size_t kLimit = 100;
+    vector<shared_ptr<BufT> > chunks;
+    BuildChunks(144, rows, &chunks);
+
+    BufT before, after;
+    uint64_t before_usec = ConcatSort(Copy(chunks), kLimit, &before);
+    uint64_t after_usec = TopNMerge(Copy(chunks), kLimit, &after);
+
+    std::cout << "Latest " << kLimit << " messages over " <<
+        chunks.size() << " chunks: concat+sort " << before_usec <<
+        " usec, top-N + k-way merge " << after_usec << " usec" << std::endl;
+
+    ASSERT_EQ(kLimit, before.size());
+    ASSERT_EQ(kLimit, after.size());
+    for (size_t i = 0; i < kLimit; i++) {
+        EXPECT_EQ(before[i][kTimestamp], after[i][kTimestamp]);
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    int result = RUN_ALL_TESTS();
+    return result;
+}
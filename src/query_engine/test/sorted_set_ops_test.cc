@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <stdlib.h>
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <vector>
+#include <boost/uuid/uuid.hpp>
+#include <testing/gunit.h>
+#include <base/time_util.h>
+#include "gendb/gendb_if.h"
+#include "../sorted_set_ops.h"
+
+using std::vector;
+
+// Same ordering as query_result_unit_t
+struct ResultRow {
+    ResultRow() : timestamp(0) {
+    }
+    ResultRow(uint64_t timestamp, uint32_t id) : timestamp(timestamp) {
+        boost::uuids::uuid u = boost::uuids::uuid();
+        u.data[12] = id >> 24;
+        u.data[13] = id >> 16;
+        u.data[14] = id >> 8;
+        u.data[15] = id;
+        info.push_back(u);
+    }
+    bool operator<(const ResultRow &rhs) const {
+        if (timestamp != rhs.timestamp)
+            return timestamp < rhs.timestamp;
+        return info < rhs.info;
+    }
+    bool operator==(const ResultRow &rhs) const {
+        return timestamp == rhs.timestamp && info == rhs.info;
+    }
+    uint64_t timestamp;
+    GenDb::DbDataValueVec info;
+};
+
+inline void swap(ResultRow &lhs, ResultRow &rhs) {
+    std::swap(lhs.timestamp, rhs.timestamp);
+    lhs.info.swap(rhs.info);
+}
+
+struct RowTimestamp {
+    uint64_t operator()(const ResultRow &row) const {
+        return row.timestamp;
+    }
+};
+
+typedef vector<ResultRow> RowVec;
+typedef SortedSetOperation<ResultRow, RowTimestamp, std::less<ResultRow> >
+    RowSetOperation;
+
+// The pairwise set operations that SetOperationUnit used
+static void PairwiseUnion(const vector<RowVec> &inputs, RowVec *result) {
+    *result = inputs[0];
+    for (size_t i = 1; i < inputs.size(); i++) {
+        RowVec tmp;
+        std::set_union(result->begin(), result->end(), inputs[i].begin(),
+                       inputs[i].end(), std::back_inserter(tmp));
+        *result = tmp;
+    }
+}
+
+static void PairwiseIntersection(const vector<RowVec> &inputs,
+                                 RowVec *result) {
+    *result = inputs[0];
+    for (size_t i = 1; i < inputs.size(); i++) {
+        RowVec tmp;
+        std::set_intersection(result->begin(), result->end(),
+                              inputs[i].begin(), inputs[i].end(),
+                              std::back_inserter(tmp));
+        *result = tmp;
+    }
+}
+
+static void Union(vector<RowVec> *inputs, RowVec *result) {
+    RowSetOperation set_op((RowTimestamp()), std::less<ResultRow>());
+    for (size_t i = 0; i < inputs->size(); i++) {
+        set_op.AddInput(&(*inputs)[i]);
+    }
+    set_op.Union(result);
+}
+
+static void Intersection(vector<RowVec> *inputs, RowVec *result) {
+    RowSetOperation set_op((RowTimestamp()), std::less<ResultRow>());
+    for (size_t i = 0; i < inputs->size(); i++) {
+        set_op.AddInput(&(*inputs)[i]);
+    }
+    set_op.Intersection(result);
+}
+
+class SortedSetOpsTest : public ::testing::Test {
+protected:
+    // Rows sharing a timestamp only differ in their uuid
+    RowVec Rows(const uint32_t *ids, size_t count) {
+        RowVec rows;
+        for (size_t i = 0; i < count; i++) {
+            rows.push_back(ResultRow(ids[i] / 4, ids[i]));
+        }
+        return rows;
+    }
+};
+
+TEST_F(SortedSetOpsTest, Union) {
+    const uint32_t a[] = { 1, 2, 3, 8, 20 };
+    const uint32_t b[] = { 2, 5, 8, 9 };
+    const uint32_t c[] = { 0, 20, 21 };
+    vector<RowVec> inputs;
+    inputs.push_back(Rows(a, 5));
+    inputs.push_back(Rows(b, 4));
+    inputs.push_back(RowVec());
+    inputs.push_back(Rows(c, 3));
+    RowVec expected;
+    PairwiseUnion(inputs, &expected);
+    EXPECT_EQ(9U, expected.size());
+
+    RowVec result;
+    Union(&inputs, &result);
+    EXPECT_TRUE(expected == result);
+
+    // A single non-empty input is passed through
+    inputs.clear();
+    inputs.push_back(RowVec());
+    inputs.push_back(Rows(b, 4));
+    Union(&inputs, &result);
+    EXPECT_TRUE(Rows(b, 4) == result);
+}
+
+TEST_F(SortedSetOpsTest, Intersection) {
+    const uint32_t a[] = { 1, 2, 3, 5, 8, 9, 20, 100, 200, 300 };
+    const uint32_t b[] = { 2, 5, 8, 9, 300 };
+    const uint32_t c[] = { 0, 2, 4, 8, 9, 20, 21, 300, 301 };
+    vector<RowVec> inputs;
+    inputs.push_back(Rows(a, 10));
+    inputs.push_back(Rows(b, 5));
+    inputs.push_back(Rows(c, 9));
+    RowVec expected;
+    PairwiseIntersection(inputs, &expected);
+    EXPECT_EQ(4U, expected.size());
+
+    RowVec result;
+    Intersection(&inputs, &result);
+    EXPECT_TRUE(expected == result);
+
+    inputs.push_back(RowVec());
+    Intersection(&inputs, &result);
+    EXPECT_TRUE(result.empty());
+}
+
+// More than 64 candidates, with the survivors spread over several words
+TEST_F(SortedSetOpsTest, IntersectionBitmap) {
+    vector<RowVec> inputs(3);
+    for (uint32_t i = 0; i < 1000; i++) {
+        inputs[0].push_back(ResultRow(i, i));
+        if (i % 3 == 0)
+            inputs[1].push_back(ResultRow(i, i));
+        if (i % 5 == 0 || i == 999)
+            inputs[2].push_back(ResultRow(i, i));
+    }
+    RowVec expected;
+    PairwiseIntersection(inputs, &expected);
+    RowVec result;
+    Intersection(&inputs, &result);
+    EXPECT_EQ(68U, result.size());
+    EXPECT_TRUE(expected == result);
+}
+
+//
+// 20-term OR and AND WHERE clauses over 10M flow index entries.
+//
+class SortedSetOpsBenchmark : public ::testing::Test {
+protected:
+    static const size_t kTerms = 20;
+
+    // Each term samples term_size rows out of a pool of pool_size flow
+    // samples, (timestamp, uuid) sorted
+    void Generate(size_t pool_size, size_t term_size,
+                  vector<vector<uint32_t> > *terms) {
+        srand(0x5eed);
+        terms->resize(kTerms);
+        for (size_t i = 0; i < kTerms; i++) {
+            vector<uint32_t> &term = (*terms)[i];
+            for (size_t j = 0; j < pool_size; j++) {
+                if ((size_t)rand() % pool_size < term_size)
+                    term.push_back(j);
+            }
+        }
+    }
+
+    void Build(const vector<vector<uint32_t> > &terms,
+               vector<RowVec> *inputs) {
+        inputs->clear();
+        inputs->resize(terms.size());
+        for (size_t i = 0; i < terms.size(); i++) {
+            (*inputs)[i].reserve(terms[i].size());
+            for (size_t j = 0; j < terms[i].size(); j++) {
+                // About 8 samples per timestamp
+                uint32_t id = terms[i][j];
+                (*inputs)[i].push_back(ResultRow(id / 8, id * 2654435761U));
+            }
+            std::sort((*inputs)[i].begin(), (*inputs)[i].end());
+        }
+    }
+
+    size_t Entries(const vector<vector<uint32_t> > &terms) {
+        size_t entries = 0;
+        for (size_t i = 0; i < terms.size(); i++) {
+            entries += terms[i].size();
+        }
+        return entries;
+    }
+};
+
+TEST_F(SortedSetOpsBenchmark, Or20) {
+    vector<vector<uint32_t> > terms;
+    Generate(5000000, 500000, &terms);
+    vector<RowVec> inputs;
+    Build(terms, &inputs);
+
+    uint64_t start = ClockMonotonicUsec();
+    RowVec expected;
+    PairwiseUnion(inputs, &expected);
+    uint64_t pairwise_usec = ClockMonotonicUsec() - start;
+
+    start = ClockMonotonicUsec();
+    RowVec result;
+    Union(&inputs, &result);
+    uint64_t merge_usec = ClockMonotonicUsec() - start;
+
+    std::cout << kTerms << "-term OR over " << Entries(terms) <<
+        " entries (" << result.size() << " rows): pairwise " <<
+        pairwise_usec << " usec, k-way " << merge_usec << " usec" <<
+        std::endl;
+    EXPECT_TRUE(expected == result);
+}
+
+TEST_F(SortedSetOpsBenchmark, And20) {
+    vector<vector<uint32_t> > terms;
+    Generate(520000, 500000, &terms);
+    vector<RowVec> inputs;
+    Build(terms, &inputs);
+
+    uint64_t start = ClockMonotonicUsec();
+    RowVec expected;
+    PairwiseIntersection(inputs, &expected);
+    uint64_t pairwise_usec = ClockMonotonicUsec() - start;
+
+    start = ClockMonotonicUsec();
+    RowVec result;
+    Intersection(&inputs, &result);
+    uint64_t gallop_usec = ClockMonotonicUsec() - start;
+
+    std::cout << kTerms << "-term AND over " << Entries(terms) <<
+        " entries (" << result.size() << " rows): pairwise " <<
+        pairwise_usec << " usec, galloping " << gallop_usec << " usec" <<
+        std::endl;
+    EXPECT_TRUE(expected == result);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    int result = RUN_ALL_TESTS();
+    return result;
+}
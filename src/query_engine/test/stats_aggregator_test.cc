@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <stdlib.h>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <testing/gunit.h>
+#include <base/time_util.h>
+#include <base/string_util.h>
+#include "../stats_aggregator.h"
+
+using std::make_pair;
+using std::map;
+using std::string;
+using std::vector;
+
+typedef StatsAggregator::StatVal StatVal;
+
+class StatsAggregatorTest : public ::testing::Test {
+protected:
+    uint32_t Group(const string &name, const StatVal &val, bool *first) {
+        string key;
+        StatsAggregator::EncodeValue(name, val, &key);
+        uint32_t group = agg_.FindOrAddGroup(key, first);
+        if (*first) {
+            StatsAggregator::StatMap uniks;
+            uniks.insert(make_pair(name, val));
+            agg_.SetGroupKey(group, vector<StatVal>(1, val), uniks);
+        }
+        return group;
+    }
+
+    StatVal Agg(uint32_t group, QEOpServerProxy::AggOper oper,
+                const string &name) {
+        const vector<StatVal> *ukey;
+        const StatsAggregator::StatMap *uniks;
+        QEOpServerProxy::AggRowT arow;
+        agg_.GetGroup(group, &ukey, &uniks, &arow);
+        QEOpServerProxy::AggRowT::const_iterator it =
+            arow.find(make_pair(oper, name));
+        if (it == arow.end())
+            return StatVal();
+        return it->second;
+    }
+
+    StatsAggregator agg_;
+};
+
+TEST_F(StatsAggregatorTest, Basic) {
+    size_t sum = agg_.AddColumn(QEOpServerProxy::SUM, "bytes");
+    size_t max = agg_.AddColumn(QEOpServerProxy::MAX, "bytes");
+    size_t min = agg_.AddColumn(QEOpServerProxy::MIN, "bytes");
+    size_t dsum = agg_.AddColumn(QEOpServerProxy::SUM, "cpu");
+    size_t count = agg_.AddColumn(QEOpServerProxy::COUNT, "if_stats");
+
+    for (uint64_t i = 0; i < 10000; i++) {
+        bool first;
+        uint32_t group = Group("name", string(i % 2 ? "odd" : "even"), &first);
+        agg_.AddValue(sum, group, StatVal(i), first);
+        agg_.AddValue(max, group, StatVal(i), first);
+        agg_.AddValue(min, group, StatVal(i), first);
+        agg_.AddValue(dsum, group, StatVal(0.5), first);
+        agg_.AddValue(count, group, (uint64_t)1, first);
+        agg_.RowDone();
+    }
+    agg_.Flush();
+
+    EXPECT_EQ(2U, agg_.GroupCount());
+    // group 0 is "even"
+    EXPECT_EQ(StatVal((uint64_t)24995000), Agg(0, QEOpServerProxy::SUM, "bytes"));
+    EXPECT_EQ(StatVal((uint64_t)9998), Agg(0, QEOpServerProxy::MAX, "bytes"));
+    EXPECT_EQ(StatVal((uint64_t)0), Agg(0, QEOpServerProxy::MIN, "bytes"));
+    EXPECT_EQ(StatVal(2500.0), Agg(0, QEOpServerProxy::SUM, "cpu"));
+    EXPECT_EQ(StatVal((uint64_t)5000), Agg(0, QEOpServerProxy::COUNT, "if_stats"));
+    EXPECT_EQ(StatVal((uint64_t)25000000), Agg(1, QEOpServerProxy::SUM, "bytes"));
+    EXPECT_EQ(StatVal((uint64_t)9999), Agg(1, QEOpServerProxy::MAX, "bytes"));
+    EXPECT_EQ(StatVal((uint64_t)1), Agg(1, QEOpServerProxy::MIN, "bytes"));
+
+    agg_.Clear();
+    EXPECT_EQ(0U, agg_.GroupCount());
+}
+
+// An aggregate is present in the output only if the first row of the group
+// carried the attribute
+TEST_F(StatsAggregatorTest, Presence) {
+    size_t sum = agg_.AddColumn(QEOpServerProxy::SUM, "bytes");
+    bool first;
+    uint32_t g1 = Group("name", string("a"), &first);
+    agg_.AddValue(sum, g1, StatVal((uint64_t)5), first);
+    agg_.RowDone();
+    uint32_t g2 = Group("name", string("b"), &first);
+    agg_.RowDone();
+    g2 = Group("name", string("b"), &first);
+    EXPECT_FALSE(first);
+    agg_.AddValue(sum, g2, StatVal((uint64_t)7), first);
+    agg_.RowDone();
+    g1 = Group("name", string("a"), &first);
+    agg_.AddValue(sum, g1, StatVal((uint64_t)6), first);
+    agg_.RowDone();
+    agg_.Flush();
+
+    EXPECT_EQ(StatVal((uint64_t)11), Agg(g1, QEOpServerProxy::SUM, "bytes"));
+    EXPECT_EQ(StatVal(), Agg(g2, QEOpServerProxy::SUM, "bytes"));
+}
+
+// The first value is retained for CLASS and for non-numeric values
+TEST_F(StatsAggregatorTest, First) {
+    size_t cls = agg_.AddColumn(QEOpServerProxy::CLASS, "bytes");
+    size_t sum = agg_.AddColumn(QEOpServerProxy::SUM, "name");
+    bool first;
+    for (int i = 0; i < 3; i++) {
+        uint32_t group = Group("vn", string("vn1"), &first);
+        agg_.AddValue(cls, group, (uint64_t)(100 + i), first);
+        agg_.AddValue(sum, group, StatVal(integerToString(i)), first);
+        agg_.RowDone();
+    }
+    agg_.Flush();
+    EXPECT_EQ(StatVal((uint64_t)100), Agg(0, QEOpServerProxy::CLASS, "bytes"));
+    EXPECT_EQ(StatVal(string("0")), Agg(0, QEOpServerProxy::SUM, "name"));
+}
+
+//
+// SUM/COUNT/MIN/MAX over 10M interface stat samples spread over 100k
+// groups. The baseline is the per-row boost::variant aggregation map
+// that StatsSelect used before the typed engine.
+//
+class StatsAggregatorBenchmark : public ::testing::Test {
+protected:
+    static const size_t kSamples = 10000000;
+    static const size_t kGroups = 100000;
+
+    virtual void SetUp() {
+        srand(0x5eed);
+        group_ids_.resize(kSamples);
+        bytes_.resize(kSamples);
+        for (size_t i = 0; i < kSamples; i++) {
+            group_ids_[i] = rand() % kGroups;
+            bytes_[i] = rand() % 1500;
+        }
+        names_.resize(kGroups);
+        for (size_t i = 0; i < kGroups; i++) {
+            names_[i] = StatVal("vhost0:tap" + integerToString(i));
+        }
+    }
+
+    vector<uint32_t> group_ids_;
+    vector<uint64_t> bytes_;
+    vector<StatVal> names_;
+};
+
+static void MergeVariant(QEOpServerProxy::AggRowT &arows,
+                         const QEOpServerProxy::AggRowT &narows) {
+    for (QEOpServerProxy::AggRowT::iterator jt = arows.begin();
+         jt != arows.end(); jt++) {
+        QEOpServerProxy::AggRowT::const_iterator kt = narows.find(jt->first);
+        uint64_t &sv = boost::get<uint64_t>(jt->second);
+        uint64_t nv = boost::get<uint64_t>(kt->second);
+        switch (jt->first.first) {
+        case QEOpServerProxy::SUM:
+        case QEOpServerProxy::COUNT:
+            sv += nv;
+            break;
+        case QEOpServerProxy::MAX:
+            sv = std::max(sv, nv);
+            break;
+        case QEOpServerProxy::MIN:
+            sv = std::min(sv, nv);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+TEST_F(StatsAggregatorBenchmark, InterfaceStats) {
+    const string kName("name");
+    const string kBytes("out_bytes");
+
+    uint64_t start = ClockMonotonicUsec();
+    map<vector<StatVal>, QEOpServerProxy::AggRowT> vresult;
+    for (size_t i = 0; i < kSamples; i++) {
+        vector<StatVal> ukey(1, names_[group_ids_[i]]);
+        QEOpServerProxy::AggRowT narows;
+        StatVal val(bytes_[i]);
+        narows.insert(make_pair(make_pair(QEOpServerProxy::SUM, kBytes), val));
+        narows.insert(make_pair(make_pair(QEOpServerProxy::MAX, kBytes), val));
+        narows.insert(make_pair(make_pair(QEOpServerProxy::MIN, kBytes), val));
+        narows.insert(make_pair(make_pair(QEOpServerProxy::COUNT, kName),
+                                StatVal((uint64_t)1)));
+        map<vector<StatVal>, QEOpServerProxy::AggRowT>::iterator it =
+            vresult.find(ukey);
+        if (it == vresult.end()) {
+            vresult.insert(make_pair(ukey, narows));
+        } else {
+            MergeVariant(it->second, narows);
+        }
+    }
+    uint64_t variant_usec = ClockMonotonicUsec() - start;
+
+    start = ClockMonotonicUsec();
+    StatsAggregator agg;
+    size_t sum = agg.AddColumn(QEOpServerProxy::SUM, kBytes);
+    size_t max = agg.AddColumn(QEOpServerProxy::MAX, kBytes);
+    size_t min = agg.AddColumn(QEOpServerProxy::MIN, kBytes);
+    size_t count = agg.AddColumn(QEOpServerProxy::COUNT, kName);
+    string key;
+    for (size_t i = 0; i < kSamples; i++) {
+        const StatVal &name = names_[group_ids_[i]];
+        key.clear();
+        StatsAggregator::EncodeValue(kName, name, &key);
+        bool first;
+        uint32_t group = agg.FindOrAddGroup(key, &first);
+        if (first) {
+            StatsAggregator::StatMap uniks;
+            uniks.insert(make_pair(kName, name));
+            agg.SetGroupKey(group, vector<StatVal>(1, name), uniks);
+        }
+        agg.AddValue(sum, group, bytes_[i], first);
+        agg.AddValue(max, group, bytes_[i], first);
+        agg.AddValue(min, group, bytes_[i], first);
+        agg.AddValue(count, group, (uint64_t)1, first);
+        agg.RowDone();
+    }
+    agg.Flush();
+    map<vector<StatVal>, QEOpServerProxy::AggRowT> tresult;
+    for (uint32_t group = 0; group < agg.GroupCount(); group++) {
+        const vector<StatVal> *ukey;
+        const StatsAggregator::StatMap *uniks;
+        QEOpServerProxy::AggRowT arow;
+        agg.GetGroup(group, &ukey, &uniks, &arow);
+        tresult.insert(make_pair(*ukey, arow));
+    }
+    uint64_t typed_usec = ClockMonotonicUsec() - start;
+
+    std::cout << kSamples << " samples, " << vresult.size() <<
+        " groups: variant " << variant_usec << " usec, typed " <<
+        typed_usec << " usec" << std::endl;
+    EXPECT_TRUE(vresult == tresult);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    int result = RUN_ALL_TESTS();
+    return result;
+}
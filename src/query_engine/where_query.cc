@@ -5,9 +5,11 @@
 #include <cstdlib>
 #include <limits> 
 #include "rapidjson/document.h"
+#include "base/time_util.h"
 #include "query.h"
 #include "json_parse.h"
 #include "stats_query.h"
+#include "db_query_reader.h"
 
 static std::string ToString(const rapidjson::Value& value_value) {
     std::string svalue;
@@ -958,6 +960,79 @@ WhereQuery::WhereQuery(const std::string& where_json_string, int direction,
     }
 }
 
+static void CollectDbQueries(QueryUnit *unit,
+                             std::vector<DbQueryUnit *> *db_queries) {
+    DbQueryUnit *db_query = dynamic_cast<DbQueryUnit *>(unit);
+    if (db_query) {
+        db_queries->push_back(db_query);
+        return;
+    }
+    for (size_t i = 0; i < unit->sub_queries.size(); i++) {
+        CollectDbQueries(unit->sub_queries[i], db_queries);
+    }
+}
+
+//
+// Read the rows of a window of database queries of the WHERE clause, from
+// db_query on, with several reads in flight instead of one term after the
+// other. The DbQueryUnits then only process the prefetched rows. Only one
+// window is held in memory at a time.
+//
+bool WhereQuery::prefetch_db_queries(DbQueryUnit *db_query)
+{
+    AnalyticsQuery *m_query = (AnalyticsQuery *)main_query;
+    if (db_queries_.empty()) {
+        CollectDbQueries(this, &db_queries_);
+    }
+    std::vector<DbQueryUnit *>::iterator first =
+        std::find(db_queries_.begin(), db_queries_.end(), db_query);
+    if (first == db_queries_.end()) {
+        return true;
+    }
+    std::vector<DbQueryUnit *> db_queries;
+    for (std::vector<DbQueryUnit *>::iterator it = first;
+         it != db_queries_.end() &&
+         db_queries.size() < DbQueryReader::kMaxInflight; ++it) {
+        if (!(*it)->prefetched) {
+            db_queries.push_back(*it);
+        }
+    }
+
+    boost::shared_ptr<DbQueryReader> reader(
+        new DbQueryReader(m_query->dbif, m_query->db_pool));
+    std::vector<std::pair<size_t, size_t> > slices;
+    for (size_t i = 0; i < db_queries.size(); i++) {
+        std::vector<GenDb::DbDataValueVec> keys;
+        db_queries[i]->get_query_keys(&keys);
+        size_t slice = reader->SliceCount();
+        for (size_t j = 0; j < keys.size(); j++) {
+            reader->AddSlice(db_queries[i]->cfname, keys[j],
+                             db_queries[i]->cr);
+        }
+        slices.push_back(std::make_pair(slice, keys.size()));
+    }
+
+    uint64_t start = UTCTimestampUsec();
+    bool success = reader->Run();
+    QE_TRACE(DEBUG, "Prefetched " << reader->SliceCount() << " rows for " <<
+        db_queries.size() << " database queries with " << reader->reads() <<
+        " reads, " << reader->max_inflight_reached() << " in flight, in " <<
+        (UTCTimestampUsec() - start) << " usec");
+    if (!success) {
+        QE_LOG(ERROR, "Database read of the WHERE clause failed");
+        return false;
+    }
+
+    for (size_t i = 0; i < db_queries.size(); i++) {
+        for (size_t j = 0; j < slices[i].second; j++) {
+            reader->TransferResult(slices[i].first + j,
+                                   &db_queries[i]->prefetch_result);
+        }
+        db_queries[i]->prefetched = true;
+    }
+    return true;
+}
+
 query_status_t WhereQuery::process_query()
 {
     AnalyticsQuery *m_query = (AnalyticsQuery *)main_query;
@@ -45,3 +45,30 @@ void Route::Sort(Compare compare, const Path *prev_front) {
         set_last_change_at_to_now();
     }
 }
+
+// Insert ahead of the first path that is worse than the new path, so that
+// the new path follows paths that compare equal as it would with Sort. Best
+// path is unaffected unless the new path is better than the current one.
+void Route::InsertSorted(const Path *ipath, Compare compare) {
+    Path *path = const_cast<Path *> (ipath);
+
+    path->set_time_stamp_usecs(UTCTimestampUsec());
+    PathList::iterator it = path_.begin();
+    while (it != path_.end() && !compare(*path, *it)) {
+        ++it;
+    }
+    if (it == path_.begin()) {
+        set_last_change_at_to_now();
+    }
+    path_.insert(it, *path);
+}
+
+// Removing a path keeps the rest of the list sorted. Best path changes only
+// if the best path is removed.
+void Route::RemoveSorted(const Path *ipath) {
+    bool best = (ipath == front());
+    remove(ipath);
+    if (best) {
+        set_last_change_at_to_now();
+    }
+}
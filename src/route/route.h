@@ -43,6 +43,12 @@ public:
     // Sort paths based on compare function.
     void Sort(Compare compare, const Path *prev_front);
 
+    // Insert a path at its position in path list sorted by compare function.
+    void InsertSorted(const Path *path, Compare compare);
+
+    // Remove a path from path list sorted by compare function.
+    void RemoveSorted(const Path *path);
+
     const PathList &GetPathList() const {
         return path_;
     }
@@ -294,6 +294,7 @@ void Agent::CopyConfig(AgentParam *params) {
 
     headless_agent_mode_ = params_->headless_mode();
     simulate_evpn_tor_ = params->simulate_evpn_tor();
+    xmpp_route_batch_ = params_->xmpp_route_batch();
     debug_ = params_->debug();
     test_mode_ = params_->test_mode();
     tsn_enabled_ = params_->isTsnAgent();
@@ -451,7 +452,8 @@ Agent::Agent() :
     vxlan_network_identifier_mode_(AUTOMATIC), headless_agent_mode_(false), 
     vhost_interface_(NULL),
     connection_state_(NULL), debug_(false), test_mode_(false),
-    init_done_(false), simulate_evpn_tor_(false), tsn_enabled_(false),
+    init_done_(false), simulate_evpn_tor_(false), xmpp_route_batch_(false),
+    tsn_enabled_(false),
     tor_agent_enabled_(false),
     flow_table_size_(0), ovsdb_client_(NULL), vrouter_server_ip_(0),
     vrouter_server_port_(0) {
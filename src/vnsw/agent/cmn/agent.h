@@ -794,6 +794,9 @@ public:
     bool simulate_evpn_tor() const {return simulate_evpn_tor_;}
     void set_simulate_evpn_tor(bool mode) {simulate_evpn_tor_ = mode;}
 
+    bool xmpp_route_batch() const {return xmpp_route_batch_;}
+    void set_xmpp_route_batch(bool val) {xmpp_route_batch_ = val;}
+
     bool tsn_enabled() const {return tsn_enabled_;}
     void set_tsn_enabled(bool val) {tsn_enabled_ = val;}
     bool tor_agent_enabled() const {return tor_agent_enabled_;}
@@ -1061,6 +1064,7 @@ private:
     bool test_mode_;
     bool init_done_;
     bool simulate_evpn_tor_;
+    bool xmpp_route_batch_;
     bool tsn_enabled_;
     bool tor_agent_enabled_;
 
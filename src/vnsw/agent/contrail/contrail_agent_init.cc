@@ -87,6 +87,12 @@ void ContrailAgentInit::CreateModules() {
                                     agent()->params()->flow_stats_interval(),
                                     agent()->params()->flow_cache_timeout(),
                                     uve_.get()));
+        flow_stats_collector_->set_sequential_scan
+            (agent()->params()->flow_stats_sequential_scan());
+        flow_stats_collector_->SetExportAggregation
+            (agent()->params()->flow_export_aggregation_interval(),
+             agent()->params()->flow_export_aggregation_port_bucket(),
+             agent()->params()->flow_export_aggregation_table_size());
         agent()->set_flow_stats_collector(flow_stats_collector_.get());
     }
 
@@ -183,3 +183,30 @@ void Pkt0RawInterface::InitControlInterface() {
     VrouterControlInterface::InitControlInterface();
     AsyncRead();
 }
+
+// Raw socket reads the burst in a single recvmmsg call
+uint32_t Pkt0RawInterface::ReadBurst() {
+    struct mmsghdr msgs[kMaxBurst];
+    struct iovec iov[kMaxBurst];
+    memset(msgs, 0, sizeof(msgs));
+    for (uint32_t i = 0; i < kMaxBurst; i++) {
+        iov[i].iov_base = rx_ring_[i]->data();
+        iov[i].iov_len = rx_ring_[i]->buffer_len();
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int count = recvmmsg(tap_fd_, msgs, kMaxBurst, MSG_DONTWAIT, NULL);
+    if (count < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            LOG(ERROR, "Packet Tap Error <" << errno << ": " <<
+                strerror(errno) << "> reading packets");
+        }
+        return 0;
+    }
+
+    for (int i = 0; i < count; i++) {
+        rx_ring_[i]->set_len(msgs[i].msg_len);
+    }
+    return count;
+}
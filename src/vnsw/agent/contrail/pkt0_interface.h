@@ -30,13 +30,19 @@ protected:
     void ReadHandler(const boost::system::error_code &err, std::size_t length);
     void WriteHandler(const boost::system::error_code &error,
                       std::size_t length, PacketBufferPtr pkt, uint8_t *buff);
+    void FillRxRing();
+    // Read upto kMaxBurst packets pending on the interface into buffers of
+    // the receive ring. Returns number of packets read
+    virtual uint32_t ReadBurst();
 
     std::string name_;
     int tap_fd_;
     unsigned char mac_address_[ETHER_ADDR_LEN];
     boost::asio::posix::stream_descriptor input_;
-    
-    uint8_t *read_buff_;
+
+    // Buffers for the next burst. Buffers are handed over to PktHandler
+    // and ring is refilled before the next read
+    PacketBufferPtr rx_ring_[kMaxBurst];
     PktHandler *pkt_handler_;
     DISALLOW_COPY_AND_ASSIGN(Pkt0Interface);
 };
@@ -49,6 +55,8 @@ public:
     void InitControlInterface();
 
 protected:
+    virtual uint32_t ReadBurst();
+
     DISALLOW_COPY_AND_ASSIGN(Pkt0RawInterface);
 };
 
@@ -36,14 +36,11 @@ const string Pkt0Socket::kVrouterSocketPath = Pkt0Socket::kSocketDir
 
 Pkt0Interface::Pkt0Interface(const std::string &name,
                              boost::asio::io_service *io) :
-    name_(name), tap_fd_(-1), input_(*io), read_buff_(NULL), pkt_handler_(NULL) {
+    name_(name), tap_fd_(-1), input_(*io), pkt_handler_(NULL) {
     memset(mac_address_, 0, sizeof(mac_address_));
 }
 
 Pkt0Interface::~Pkt0Interface() {
-    if (read_buff_) {
-        delete [] read_buff_;
-    }
 }
 
 void Pkt0Interface::IoShutdownControlInterface() {
@@ -61,19 +58,56 @@ void Pkt0Interface::WriteHandler(const boost::system::error_code &error,
     if (error)
         TAP_TRACE(Err,
                   "Packet Tap Error <" + error.message() + "> sending packet");
-    delete [] buff;
+    FreeAgentHdr(pkt, buff);
 }
 
 
+// Wait for packets on the interface, packets are read in a burst from
+// ReadHandler
 void Pkt0Interface::AsyncRead() {
-    read_buff_ = new uint8_t[kMaxPacketSize];
+    if (input_.non_blocking() == false) {
+        boost::system::error_code ec;
+        input_.non_blocking(true, ec);
+        assert(ec == 0);
+    }
     input_.async_read_some(
-            boost::asio::buffer(read_buff_, kMaxPacketSize),
+            boost::asio::null_buffers(),
             boost::bind(&Pkt0Interface::ReadHandler, this,
                         boost::asio::placeholders::error,
                         boost::asio::placeholders::bytes_transferred));
 }
 
+void Pkt0Interface::FillRxRing() {
+    PacketBufferManager *mgr =
+        pkt_handler()->agent()->pkt()->packet_buffer_manager();
+    for (uint32_t i = 0; i < kMaxBurst; i++) {
+        if (rx_ring_[i].get() == NULL) {
+            rx_ring_[i] = mgr->Allocate(PktHandler::RX_PACKET, kMaxPacketSize,
+                                        0);
+        }
+    }
+}
+
+uint32_t Pkt0Interface::ReadBurst() {
+    uint32_t count = 0;
+    while (count < kMaxBurst) {
+        PacketBuffer *buff = rx_ring_[count].get();
+        boost::system::error_code ec;
+        std::size_t length = input_.read_some(
+            boost::asio::buffer(buff->data(), buff->buffer_len()), ec);
+        if (ec) {
+            if (ec != boost::asio::error::would_block) {
+                TAP_TRACE(Err, "Packet Tap Error <" + ec.message() +
+                          "> reading packet");
+            }
+            break;
+        }
+        buff->set_len(length);
+        count++;
+    }
+    return count;
+}
+
 void Pkt0Interface::ReadHandler(const boost::system::error_code &error,
                               std::size_t length) {
     if (error) {
@@ -85,11 +119,15 @@ void Pkt0Interface::ReadHandler(const boost::system::error_code &error,
     }
 
     if (!error) {
-        Agent *agent = pkt_handler()->agent();
-        PacketBufferPtr pkt(agent->pkt()->packet_buffer_manager()->Allocate
-            (PktHandler::RX_PACKET, read_buff_, kMaxPacketSize, 0, length,
-             0));
-        VrouterControlInterface::Process(pkt);
+        FillRxRing();
+        uint32_t count = ReadBurst();
+        PacketBufferPtr pkt[kMaxBurst];
+        for (uint32_t i = 0; i < count; i++) {
+            pkt[i].swap(rx_ring_[i]);
+        }
+        if (count) {
+            VrouterControlInterface::ProcessBurst(pkt, count);
+        }
     }
 
     AsyncRead();
@@ -115,9 +153,6 @@ Pkt0RawInterface::Pkt0RawInterface(const std::string &name,
 }
 
 Pkt0RawInterface::~Pkt0RawInterface() {
-    if (read_buff_) {
-        delete [] read_buff_;
-    }
 }
 
 Pkt0Socket::Pkt0Socket(const std::string &name,
@@ -201,6 +236,7 @@ int Pkt0Socket::Send(uint8_t *buff, uint16_t buff_len,
                       const PacketBufferPtr &pkt) {
     if (connected_ == false) {
         //queue the data?
+        FreeAgentHdr(pkt, buff);
         return (pkt->data_len());
     }
 
@@ -243,5 +279,5 @@ void Pkt0Socket::WriteHandler(const boost::system::error_code &error,
     if (error)
         TAP_TRACE(Err,
                   "Packet Error <" + error.message() + "> sending packet");
-    delete [] buff;
+    FreeAgentHdr(pkt, buff);
 }
@@ -13,6 +13,7 @@
 #include "controller/controller_ifmap.h"
 #include "controller/controller_vrf_export.h"
 #include "controller/controller_init.h"
+#include "controller/controller_route_batch.h"
 #include "oper/operdb_init.h"
 #include "oper/vrf.h"
 #include "oper/nexthop.h"
@@ -78,9 +79,15 @@ AgentXmppChannel::AgentXmppChannel(Agent *agent,
     : channel_(NULL), xmpp_server_(xmpp_server), label_range_(label_range),
       xs_idx_(xs_idx), agent_(agent), unicast_sequence_number_(0) {
     bgp_peer_id_.reset();
+    if (agent->xmpp_route_batch()) {
+        route_batch_.reset(new ControllerRouteBatch(agent->event_manager(),
+                boost::bind(&AgentXmppChannel::SendXmppMessage, this,
+                            _1, _2)));
+    }
 }
 
 AgentXmppChannel::~AgentXmppChannel() {
+    route_batch_.reset();
     BgpPeer *bgp_peer = bgp_peer_id_.get();
     assert(bgp_peer == NULL);
     channel_->UnRegisterReceive(xmps::BGP);
@@ -94,6 +101,15 @@ void AgentXmppChannel::RegisterXmppChannel(XmppChannel *channel) {
     channel->RegisterReceive(xmps::BGP,
                               boost::bind(&AgentXmppChannel::ReceiveInternal,
                                           this, _1));
+    if (route_batch_.get()) {
+        route_batch_->SetJids(channel->FromString(),
+                              channel->ToString() + "/" + XmppInit::kBgpPeer);
+    }
+}
+
+void AgentXmppChannel::FlushRouteBatch() {
+    if (route_batch_.get())
+        route_batch_->Flush();
 }
 
 std::string AgentXmppChannel::GetBgpPeerName() const {
@@ -129,7 +145,14 @@ void AgentXmppChannel::DeCommissionBgpPeer() {
 }
 
 
+// Messages go out after the routes batched so far, to keep their order
 bool AgentXmppChannel::SendUpdate(uint8_t *msg, size_t size) {
+    if (route_batch_.get())
+        return route_batch_->Send(msg, size);
+    return SendXmppMessage(msg, size);
+}
+
+bool AgentXmppChannel::SendXmppMessage(uint8_t *msg, size_t size) {
 
     if (agent_->stats())
         agent_->stats()->incr_xmpp_out_msgs(xs_idx_);
@@ -1186,6 +1209,10 @@ void AgentXmppChannel::UnicastPeerDown(AgentXmppChannel *peer,
     // at the time of request handling.
     peer->increment_unicast_sequence_number();
 
+    // Routes batched for the channel are sent again once it is up
+    if (peer->route_batch())
+        peer->route_batch()->Clear();
+
     // Cancel timer - when second peer comes up at say 4.5 mts and
     // immediately first peer does down then there is a interval of few seconds
     // for second peer to clean up whereas he shud have had 5 mts.
@@ -1731,10 +1758,6 @@ bool AgentXmppChannel::ControllerSendV4V6UnicastRouteCommon(AgentRoute *route,
     uint8_t data_[4096];
     size_t datalen_;
 
-    //Build the DOM tree
-    auto_ptr<XmlBase> impl(XmppStanza::AllocXmppXmlImpl());
-    XmlPugi *pugi = reinterpret_cast<XmlPugi *>(impl.get());
-
     if (type == Agent::INET4_UNICAST) {
         item.entry.nlri.af = BgpAf::IPv4;
     } else {
@@ -1770,6 +1793,24 @@ bool AgentXmppChannel::ControllerSendV4V6UnicastRouteCommon(AgentRoute *route,
     item.entry.sequence_number = path_preference.sequence();
     item.entry.local_preference = path_preference.preference();
 
+    //Catering for inet4 and evpn unicast routes
+    stringstream ss_node;
+    ss_node << item.entry.nlri.af << "/"
+            << item.entry.nlri.safi << "/"
+            << route->vrf()->GetName() << "/"
+            << route->GetAddressString();
+    std::string node_id(ss_node.str());
+
+    if (route_batch_.get()) {
+        route_batch_->AddRoute(route->vrf()->GetName(), node_id, item,
+                               associate);
+        return true;
+    }
+
+    //Build the DOM tree
+    auto_ptr<XmlBase> impl(XmppStanza::AllocXmppXmlImpl());
+    XmlPugi *pugi = reinterpret_cast<XmlPugi *>(impl.get());
+
     pugi->AddNode("iq", "");
     pugi->AddAttribute("type", "set");
 
@@ -1786,14 +1827,6 @@ bool AgentXmppChannel::ControllerSendV4V6UnicastRouteCommon(AgentRoute *route,
     pugi->AddChildNode("pubsub", "");
     pugi->AddAttribute("xmlns", "http://jabber.org/protocol/pubsub");
     pugi->AddChildNode("publish", "");
-
-    //Catering for inet4 and evpn unicast routes
-    stringstream ss_node;
-    ss_node << item.entry.nlri.af << "/"
-            << item.entry.nlri.safi << "/"
-            << route->vrf()->GetName() << "/"
-            << route->GetAddressString();
-    std::string node_id(ss_node.str());
     pugi->AddAttribute("node", node_id);
     pugi->AddChildNode("item", "");
 
@@ -24,6 +24,7 @@ class VrfEntry;
 class XmlPugi;
 class PathPreference;
 class AgentPath;
+class ControllerRouteBatch;
 
 class AgentXmppChannel {
 public:
@@ -116,6 +117,9 @@ public:
     void CreateBgpPeer();
     void DeCommissionBgpPeer();
     void RegisterXmppChannel(XmppChannel *channel);
+    // Sends the unicast route exports batched so far, if batching is on
+    void FlushRouteBatch();
+    ControllerRouteBatch *route_batch() const {return route_batch_.get();}
 
     std::string GetXmppServer() { return xmpp_server_; }
     uint8_t GetXmppServerIdx() { return xs_idx_; }
@@ -149,6 +153,7 @@ protected:
 
 private:
     void ReceiveInternal(const XmppStanza::XmppMessage *msg);
+    bool SendXmppMessage(uint8_t *msg, size_t msgsize);
     void AddRoute(std::string vrf_name, IpAddress ip, uint32_t plen,
                   autogen::ItemType *item);
     void AddMulticastEvpnRoute(const std::string &vrf_name,
@@ -213,6 +218,7 @@ private:
     boost::shared_ptr<BgpPeer> bgp_peer_id_;
     Agent *agent_;
     uint64_t unicast_sequence_number_;
+    boost::scoped_ptr<ControllerRouteBatch> route_batch_;
 };
 
 #endif // __CONTROLLER_PEER_H__
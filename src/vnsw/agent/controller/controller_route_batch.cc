@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "controller/controller_route_batch.h"
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <boost/bind.hpp>
+#include <base/task.h>
+#include <base/timer.h>
+#include <io/event_manager.h>
+
+using std::string;
+using std::vector;
+
+static const char kXmlDecl[] = "<?xml version=\"1.0\"?>\n";
+static const char kPubsubNs[] = "http://jabber.org/protocol/pubsub";
+
+static void AppendEscaped(const string &value, string *buf) {
+    for (string::const_iterator it = value.begin(); it != value.end(); ++it) {
+        switch (*it) {
+        case '&':  buf->append("&amp;"); break;
+        case '<':  buf->append("&lt;"); break;
+        case '>':  buf->append("&gt;"); break;
+        case '"':  buf->append("&quot;"); break;
+        case '\'': buf->append("&apos;"); break;
+        default:   buf->push_back(*it); break;
+        }
+    }
+}
+
+static void AppendInteger(int64_t value, string *buf) {
+    char tmp[24];
+    int len = snprintf(tmp, sizeof(tmp), "%" PRId64, value);
+    buf->append(tmp, len);
+}
+
+static void AppendElement(const char *name, int64_t value, string *buf) {
+    buf->push_back('<');
+    buf->append(name);
+    buf->push_back('>');
+    AppendInteger(value, buf);
+    buf->append("</");
+    buf->append(name);
+    buf->push_back('>');
+}
+
+static void AppendElement(const char *name, const string &value,
+                          string *buf) {
+    buf->push_back('<');
+    buf->append(name);
+    buf->push_back('>');
+    AppendEscaped(value, buf);
+    buf->append("</");
+    buf->append(name);
+    buf->push_back('>');
+}
+
+ControllerRouteBatch::ControllerRouteBatch(EventManager *evm,
+                                           SendCb send_cb,
+                                           int flush_interval_msec)
+    : send_cb_(send_cb), af_(0), associate_(false), count_(0), id_(0),
+      routes_(0), batches_(0) {
+    items_.reserve(kMaxBytes);
+    flush_timer_ =
+        TimerManager::CreateTimer(*(evm->io_service()),
+                                  "Controller Route Batch Timer",
+                                  TaskScheduler::GetInstance()->
+                                  GetTaskId("Agent::ControllerXmpp"), 0);
+    flush_timer_->Start(flush_interval_msec,
+        boost::bind(&ControllerRouteBatch::FlushTimerExpired, this));
+}
+
+ControllerRouteBatch::~ControllerRouteBatch() {
+    TimerManager::DeleteTimer(flush_timer_);
+}
+
+void ControllerRouteBatch::SetJids(const string &from, const string &to) {
+    tbb::mutex::scoped_lock lock(mutex_);
+    from_ = from;
+    to_ = to;
+}
+
+void ControllerRouteBatch::EncodeItem(const autogen::ItemType &item,
+                                      string *buf) {
+    const autogen::EntryType &entry = item.entry;
+    buf->append("<item><entry><nlri>");
+    AppendElement("af", entry.nlri.af, buf);
+    AppendElement("safi", entry.nlri.safi, buf);
+    AppendElement("address", entry.nlri.address, buf);
+    buf->append("</nlri><next-hops>");
+    for (vector<autogen::NextHopType>::const_iterator it =
+         entry.next_hops.next_hop.begin();
+         it != entry.next_hops.next_hop.end(); ++it) {
+        buf->append("<next-hop>");
+        AppendElement("af", it->af, buf);
+        AppendElement("address", it->address, buf);
+        AppendElement("label", it->label, buf);
+        buf->append("<tunnel-encapsulation-list>");
+        const vector<string> &encap =
+            it->tunnel_encapsulation_list.tunnel_encapsulation;
+        for (vector<string>::const_iterator encap_it = encap.begin();
+             encap_it != encap.end(); ++encap_it) {
+            AppendElement("tunnel-encapsulation", *encap_it, buf);
+        }
+        buf->append("</tunnel-encapsulation-list></next-hop>");
+    }
+    buf->append("</next-hops>");
+    AppendElement("version", entry.version, buf);
+    AppendElement("virtual-network", entry.virtual_network, buf);
+    AppendElement("sequence-number", entry.sequence_number, buf);
+    buf->append("<security-group-list>");
+    const vector<int> &sg_list = entry.security_group_list.security_group;
+    for (vector<int>::const_iterator it = sg_list.begin();
+         it != sg_list.end(); ++it) {
+        AppendElement("security-group", *it, buf);
+    }
+    buf->append("</security-group-list>");
+    AppendElement("local-preference", entry.local_preference, buf);
+    buf->append("</entry></item>");
+}
+
+void ControllerRouteBatch::AddRoute(const string &vrf, const string &node,
+                                    const autogen::ItemType &item,
+                                    bool associate) {
+    tbb::mutex::scoped_lock lock(mutex_);
+    if (count_ && (associate != associate_ || item.entry.nlri.af != af_ ||
+                   vrf != vrf_)) {
+        FlushLocked();
+    }
+    if (count_ == 0) {
+        vrf_ = vrf;
+        node_ = node;
+        af_ = item.entry.nlri.af;
+        associate_ = associate;
+    }
+    EncodeItem(item, &items_);
+    count_++;
+    routes_++;
+    if (count_ >= kMaxItems || items_.size() >= kMaxBytes) {
+        FlushLocked();
+    }
+}
+
+void ControllerRouteBatch::AppendIqHeader(const char *id_prefix,
+                                          string *buf) {
+    buf->append(kXmlDecl);
+    buf->append("<iq type=\"set\" from=\"");
+    AppendEscaped(from_, buf);
+    buf->append("\" to=\"");
+    AppendEscaped(to_, buf);
+    buf->append("\" id=\"");
+    buf->append(id_prefix);
+    AppendInteger(id_, buf);
+    buf->append("\"><pubsub xmlns=\"");
+    buf->append(kPubsubNs);
+    buf->append("\">");
+}
+
+bool ControllerRouteBatch::FlushLocked() {
+    if (count_ == 0)
+        return true;
+
+    string msg;
+    msg.reserve(items_.size() + 512);
+    AppendIqHeader("pubsub", &msg);
+    msg.append("<publish node=\"");
+    AppendEscaped(node_, &msg);
+    msg.append("\">");
+    msg.append(items_);
+    msg.append("</publish></pubsub></iq>");
+    bool ret = send_cb_(reinterpret_cast<uint8_t *>(&msg[0]), msg.size());
+
+    msg.clear();
+    AppendIqHeader("collection", &msg);
+    msg.append("<collection node=\"");
+    AppendEscaped(vrf_, &msg);
+    msg.append(associate_ ? "\"><associate node=\"" :
+               "\"><dissociate node=\"");
+    AppendEscaped(node_, &msg);
+    msg.append("\"/></collection></pubsub></iq>");
+    ret = send_cb_(reinterpret_cast<uint8_t *>(&msg[0]), msg.size()) && ret;
+
+    id_++;
+    batches_++;
+    count_ = 0;
+    items_.clear();
+    return ret;
+}
+
+bool ControllerRouteBatch::Send(uint8_t *msg, size_t size) {
+    tbb::mutex::scoped_lock lock(mutex_);
+    FlushLocked();
+    return send_cb_(msg, size);
+}
+
+void ControllerRouteBatch::Flush() {
+    tbb::mutex::scoped_lock lock(mutex_);
+    FlushLocked();
+}
+
+void ControllerRouteBatch::Clear() {
+    tbb::mutex::scoped_lock lock(mutex_);
+    count_ = 0;
+    items_.clear();
+}
+
+size_t ControllerRouteBatch::pending() const {
+    tbb::mutex::scoped_lock lock(mutex_);
+    return count_;
+}
+
+// Runs periodically, a timer started per batch could not be restarted while
+// its handler is still running.
+bool ControllerRouteBatch::FlushTimerExpired() {
+    Flush();
+    return true;
+}
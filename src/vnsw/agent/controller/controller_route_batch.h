@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef __CONTROLLER_ROUTE_BATCH_H__
+#define __CONTROLLER_ROUTE_BATCH_H__
+
+#include <stdint.h>
+#include <string>
+#include <boost/function.hpp>
+#include <tbb/mutex.h>
+#include <xmpp_unicast_types.h>
+
+class EventManager;
+class Timer;
+
+/*
+ * Batches the inet and inet6 unicast route exports of an xmpp channel.
+ *
+ * Consecutive exports for the same VRF, address family and operation are
+ * sent as a publish iq carrying one item per route, followed by a single
+ * collection iq. The stanzas are encoded straight into a buffer instead of
+ * going through a DOM. Control node merges the collection with the publish
+ * preceding it and processes every item of that publish.
+ *
+ * A batch is sent when it reaches kMaxItems or kMaxBytes, when an export
+ * for some other VRF, family or operation is added, before any other
+ * message on the channel so that the order of messages is kept, and at the
+ * latest after kFlushIntervalMsec.
+ */
+class ControllerRouteBatch {
+public:
+    typedef boost::function<bool(uint8_t *, size_t)> SendCb;
+
+    static const size_t kMaxItems = 256;
+    static const size_t kMaxBytes = 64 * 1024;
+    static const int kFlushIntervalMsec = 20;
+
+    ControllerRouteBatch(EventManager *evm, SendCb send_cb,
+                         int flush_interval_msec = kFlushIntervalMsec);
+    ~ControllerRouteBatch();
+
+    // from and to of the iq, to includes the bgp-peer resource
+    void SetJids(const std::string &from, const std::string &to);
+
+    // node is the publish node of the route, af/safi/vrf/address
+    void AddRoute(const std::string &vrf, const std::string &node,
+                  const autogen::ItemType &item, bool associate);
+    // Sends the pending routes followed by msg
+    bool Send(uint8_t *msg, size_t size);
+    void Flush();
+    // Drops the pending routes, used when the channel goes down
+    void Clear();
+
+    size_t pending() const;
+    uint64_t routes() const { return routes_; }
+    uint64_t batches() const { return batches_; }
+
+    // Appends <item> for the route, with the element names and values of
+    // autogen::ItemType::Encode. Elements control node does not look at
+    // when left at their defaults (med, load-balance) are omitted.
+    static void EncodeItem(const autogen::ItemType &item, std::string *buf);
+
+private:
+    bool FlushLocked();
+    bool FlushTimerExpired();
+    void AppendIqHeader(const char *id_prefix, std::string *buf);
+
+    mutable tbb::mutex mutex_;
+    SendCb send_cb_;
+    Timer *flush_timer_;
+    std::string from_;
+    std::string to_;
+
+    // Pending batch
+    std::string vrf_;
+    std::string node_;
+    int af_;
+    bool associate_;
+    size_t count_;
+    std::string items_;
+
+    uint64_t id_;
+    uint64_t routes_;
+    uint64_t batches_;
+};
+
+#endif // __CONTROLLER_ROUTE_BATCH_H__
@@ -18,6 +18,7 @@
 
 #include "controller/controller_route_walker.h"
 #include "controller/controller_init.h"
+#include "controller/controller_peer.h"
 #include "controller/controller_types.h"
 #include "controller/controller_vrf_export.h"
 #include "controller/controller_export.h"
@@ -25,6 +26,9 @@
 ControllerRouteWalker::ControllerRouteWalker(Agent *agent, Peer *peer) : 
     AgentRouteWalker(agent, AgentRouteWalker::ALL), peer_(peer), 
     associate_(false), type_(NOTIFYALL) {
+    RouteWalkDoneForVrfCallback(boost::bind(
+                                &ControllerRouteWalker::RouteWalkDoneForVrf,
+                                this, _1));
 }
 
 // Takes action based on context of walk. These walks are not parallel.
@@ -272,6 +276,14 @@ bool ControllerRouteWalker::RouteStaleMarker(DBTablePartBase *partition,
 // Called when for a VRF all route table walks are complete.
 // Deletes the VRF state of that peer.
 void ControllerRouteWalker::RouteWalkDoneForVrf(VrfEntry *vrf) {
+    // Routes of the VRF batched for control node need not wait for the
+    // batch timer
+    if ((type_ == NOTIFYALL) && (peer_->GetType() == Peer::BGP_PEER)) {
+        BgpPeer *bgp_peer = static_cast<BgpPeer *>(peer_);
+        if (bgp_peer->GetBgpXmppPeer())
+            bgp_peer->GetBgpXmppPeer()->FlushRouteBatch();
+    }
+
     // Currently used only for delete peer handling
     // Deletes the state and release the listener id
     if (type_ != DELPEER)
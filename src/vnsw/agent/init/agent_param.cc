@@ -479,6 +479,22 @@ void AgentParam::ParseFlows() {
         "FLOWS.max_vm_linklocal_flows")) {
         linklocal_vm_flows_ = Agent::kDefaultMaxLinkLocalOpenFds;
     }
+    if (!GetValueFromTree<bool>(flow_stats_sequential_scan_,
+                                "FLOWS.sequential_stats_scan")) {
+        flow_stats_sequential_scan_ = false;
+    }
+    if (!GetValueFromTree<uint32_t>(flow_export_aggregation_interval_,
+                                    "FLOWS.export_aggregation_interval")) {
+        flow_export_aggregation_interval_ = 0;
+    }
+    if (!GetValueFromTree<uint16_t>(flow_export_aggregation_port_bucket_,
+                                    "FLOWS.export_aggregation_port_bucket")) {
+        flow_export_aggregation_port_bucket_ = 1;
+    }
+    if (!GetValueFromTree<uint32_t>(flow_export_aggregation_table_size_,
+                                    "FLOWS.export_aggregation_table_size")) {
+        flow_export_aggregation_table_size_ = 0;
+    }
 }
 
 void AgentParam::ParseHeadlessMode() {
@@ -521,6 +537,24 @@ void AgentParam::ParseSimulateEvpnTor() {
     }
 }
 
+void AgentParam::ParseXmppRouteBatch() {
+    if (!GetValueFromTree<bool>(xmpp_route_batch_,
+                                "DEFAULT.xmpp_route_batch")) {
+        xmpp_route_batch_ = false;
+    }
+}
+
+void AgentParam::ParseKSyncPipelined() {
+    if (!GetValueFromTree<bool>(ksync_pipelined_,
+                                "DEFAULT.ksync_pipelined")) {
+        ksync_pipelined_ = false;
+    }
+    if (!GetValueFromTree<bool>(ksync_multi_socket_,
+                                "DEFAULT.ksync_multi_socket")) {
+        ksync_multi_socket_ = false;
+    }
+}
+
 void AgentParam::ParseServiceInstance() {
     GetValueFromTree<string>(si_netns_command_,
                              "SERVICE-INSTANCE.netns_command");
@@ -684,6 +718,14 @@ void AgentParam::ParseFlowArguments
                           "FLOWS.max_system_linklocal_flows");
     GetOptValue<uint16_t>(var_map, linklocal_vm_flows_,
                           "FLOWS.max_vm_linklocal_flows");
+    GetOptValue<bool>(var_map, flow_stats_sequential_scan_,
+                      "FLOWS.sequential_stats_scan");
+    GetOptValue<uint32_t>(var_map, flow_export_aggregation_interval_,
+                          "FLOWS.export_aggregation_interval");
+    GetOptValue<uint16_t>(var_map, flow_export_aggregation_port_bucket_,
+                          "FLOWS.export_aggregation_port_bucket");
+    GetOptValue<uint32_t>(var_map, flow_export_aggregation_table_size_,
+                          "FLOWS.export_aggregation_table_size");
 }
 
 void AgentParam::ParseHeadlessModeArguments
@@ -696,6 +738,18 @@ void AgentParam::ParseDhcpRelayModeArguments
     GetOptValue<bool>(var_map, dhcp_relay_mode_, "DEFAULT.dhcp_relay_mode");
 }
 
+void AgentParam::ParseXmppRouteBatchArguments
+    (const boost::program_options::variables_map &var_map) {
+    GetOptValue<bool>(var_map, xmpp_route_batch_, "DEFAULT.xmpp_route_batch");
+}
+
+void AgentParam::ParseKSyncPipelinedArguments
+    (const boost::program_options::variables_map &var_map) {
+    GetOptValue<bool>(var_map, ksync_pipelined_, "DEFAULT.ksync_pipelined");
+    GetOptValue<bool>(var_map, ksync_multi_socket_,
+                      "DEFAULT.ksync_multi_socket");
+}
+
 void AgentParam::ParseAgentInfoArguments
     (const boost::program_options::variables_map &var_map) {
     std::string mode;
@@ -794,6 +848,8 @@ void AgentParam::InitFromConfig() {
     ParseHeadlessMode();
     ParseDhcpRelayMode();
     ParseSimulateEvpnTor();
+    ParseXmppRouteBatch();
+    ParseKSyncPipelined();
     ParseServiceInstance();
     ParseAgentInfo();
     ParseNexthopServer();
@@ -816,6 +872,8 @@ void AgentParam::InitFromArguments() {
     ParseMetadataProxyArguments(var_map_);
     ParseHeadlessModeArguments(var_map_);
     ParseDhcpRelayModeArguments(var_map_);
+    ParseXmppRouteBatchArguments(var_map_);
+    ParseKSyncPipelinedArguments(var_map_);
     ParseServiceInstanceArguments(var_map_);
     ParseAgentInfoArguments(var_map_);
     ParseNexthopServerArguments(var_map_);
@@ -1040,6 +1098,12 @@ void AgentParam::LogConfig() const {
     LOG(DEBUG, "Linklocal Max System Flows  : " << linklocal_system_flows_);
     LOG(DEBUG, "Linklocal Max Vm Flows      : " << linklocal_vm_flows_);
     LOG(DEBUG, "Flow cache timeout          : " << flow_cache_timeout_);
+    LOG(DEBUG, "Sequential Flow Stats Scan  : "
+        << flow_stats_sequential_scan_);
+    LOG(DEBUG, "Flow Export Aggregation     : "
+        << flow_export_aggregation_interval_ << " secs port bucket "
+        << flow_export_aggregation_port_bucket_ << " table size "
+        << flow_export_aggregation_table_size_);
 
     if (agent_mode_ == VROUTER_AGENT)
         LOG(DEBUG, "Agent Mode                  : Vrouter");
@@ -1053,6 +1117,9 @@ void AgentParam::LogConfig() const {
     if (simulate_evpn_tor_) {
         LOG(DEBUG, "Simulate EVPN TOR           : " << simulate_evpn_tor_);
     }
+    LOG(DEBUG, "Xmpp Route Batch            : " << xmpp_route_batch_);
+    LOG(DEBUG, "KSync Pipelined             : " << ksync_pipelined_);
+    LOG(DEBUG, "KSync Multi Socket          : " << ksync_multi_socket_);
     LOG(DEBUG, "Service instance netns cmd  : " << si_netns_command_);
     LOG(DEBUG, "Service instance docker cmd  : " << si_docker_command_);
     LOG(DEBUG, "Service instance workers    : " << si_netns_workers_);
@@ -1131,7 +1198,11 @@ AgentParam::AgentParam(Agent *agent, bool enable_flow_options,
         mgmt_ip_(), hypervisor_mode_(MODE_KVM), xen_ll_(),
         tunnel_type_(), metadata_shared_secret_(), max_vm_flows_(),
         linklocal_system_flows_(), linklocal_vm_flows_(),
-        flow_cache_timeout_(), config_file_(), program_name_(),
+        flow_cache_timeout_(), flow_stats_sequential_scan_(false),
+        flow_export_aggregation_interval_(0),
+        flow_export_aggregation_port_bucket_(1),
+        flow_export_aggregation_table_size_(0),
+        config_file_(), program_name_(),
         log_file_(), log_local_(false), log_flow_(false), log_level_(),
         log_category_(), use_syslog_(false),
         http_server_port_(), host_name_(),
@@ -1144,7 +1215,9 @@ AgentParam::AgentParam(Agent *agent, bool enable_flow_options,
         xmpp_server_cert_1_(""), xmpp_server_cert_2_(""),
         xmpp_dns_auth_enable_1_(false), xmpp_dns_auth_enable_2_(false),
         xmpp_dns_server_cert_1_(""), xmpp_dns_server_cert_2_(""),
-        simulate_evpn_tor_(false), si_netns_command_(),
+        simulate_evpn_tor_(false), xmpp_route_batch_(false),
+        ksync_pipelined_(false), ksync_multi_socket_(false),
+        si_netns_command_(),
         si_docker_command_(), si_netns_workers_(0),
         si_netns_timeout_(0), si_lb_ssl_cert_path_(),
         vmware_mode_(ESXI_NEUTRON), nexthop_server_endpoint_(),
@@ -1184,6 +1257,12 @@ AgentParam::AgentParam(Agent *agent, bool enable_flow_options,
          "Run compute-node in headless mode")
         ("DEFAULT.dhcp_relay_mode", opt::value<bool>(),
          "Enable / Disable DHCP relay of DHCP packets from virtual instance")
+        ("DEFAULT.xmpp_route_batch", opt::value<bool>(),
+         "Send route updates to control node in batches of many routes")
+        ("DEFAULT.ksync_pipelined", opt::value<bool>(),
+         "Send changes to vrouter without waiting for earlier acks")
+        ("DEFAULT.ksync_multi_socket", opt::value<bool>(),
+         "Sync DB partitions to vrouter on a socket per partition")
         ("DEFAULT.http_server_port",
          opt::value<uint16_t>()->default_value(ContrailPorts::HttpPortAgent()),
          "Sandesh HTTP listener port")
@@ -1269,6 +1348,15 @@ AgentParam::AgentParam(Agent *agent, bool enable_flow_options,
              "Maximum number of link-local flows allowed across all VMs")
             ("FLOWS.max_vm_linklocal_flows", opt::value<uint16_t>(),
              "Maximum number of link-local flows allowed per VM")
+            ("FLOWS.sequential_stats_scan", opt::value<bool>(),
+             "Read flow stats by scanning the kernel flow table sequentially")
+            ("FLOWS.export_aggregation_interval", opt::value<uint32_t>(),
+             "Export aggregates of flows every given seconds instead of "
+             "flow records, 0 disables aggregation")
+            ("FLOWS.export_aggregation_port_bucket", opt::value<uint16_t>(),
+             "Number of destination ports rolled into one aggregate")
+            ("FLOWS.export_aggregation_table_size", opt::value<uint32_t>(),
+             "Maximum number of flow aggregates held in an interval")
             ;
         options_.add(flow);
     }
@@ -108,6 +108,18 @@ public:
     uint32_t linklocal_system_flows() const { return linklocal_system_flows_; }
     uint32_t linklocal_vm_flows() const { return linklocal_vm_flows_; }
     uint32_t flow_cache_timeout() const {return flow_cache_timeout_;}
+    bool flow_stats_sequential_scan() const {
+        return flow_stats_sequential_scan_;
+    }
+    uint32_t flow_export_aggregation_interval() const {
+        return flow_export_aggregation_interval_;
+    }
+    uint16_t flow_export_aggregation_port_bucket() const {
+        return flow_export_aggregation_port_bucket_;
+    }
+    uint32_t flow_export_aggregation_table_size() const {
+        return flow_export_aggregation_table_size_;
+    }
     bool headless_mode() const {return headless_mode_;}
     bool dhcp_relay_mode() const {return dhcp_relay_mode_;}
     bool xmpp_auth_enabled_1() const {return xmpp_auth_enable_1_;}
@@ -119,6 +131,9 @@ public:
     std::string xmpp_dns_server_cert_1() const { return xmpp_dns_server_cert_1_;}
     std::string xmpp_dns_server_cert_2() const { return xmpp_dns_server_cert_2_;}
     bool simulate_evpn_tor() const {return simulate_evpn_tor_;}
+    bool xmpp_route_batch() const {return xmpp_route_batch_;}
+    bool ksync_pipelined() const {return ksync_pipelined_;}
+    bool ksync_multi_socket() const {return ksync_multi_socket_;}
     std::string si_netns_command() const {return si_netns_command_;}
     std::string si_docker_command() const {return si_docker_command_;}
     const int si_netns_workers() const {return si_netns_workers_;}
@@ -291,6 +306,8 @@ private:
     void ParseHeadlessMode();
     void ParseDhcpRelayMode();
     void ParseSimulateEvpnTor();
+    void ParseXmppRouteBatch();
+    void ParseKSyncPipelined();
     void ParseServiceInstance();
     void ParseAgentInfo();
     void ParseNexthopServer();
@@ -317,6 +334,10 @@ private:
         (const boost::program_options::variables_map &v);
     void ParseDhcpRelayModeArguments
         (const boost::program_options::variables_map &var_map);
+    void ParseXmppRouteBatchArguments
+        (const boost::program_options::variables_map &var_map);
+    void ParseKSyncPipelinedArguments
+        (const boost::program_options::variables_map &var_map);
     void ParseServiceInstanceArguments
         (const boost::program_options::variables_map &v);
     void ParseAgentInfoArguments
@@ -358,6 +379,10 @@ private:
     uint16_t linklocal_system_flows_;
     uint16_t linklocal_vm_flows_;
     uint16_t flow_cache_timeout_;
+    bool flow_stats_sequential_scan_;
+    uint32_t flow_export_aggregation_interval_;
+    uint16_t flow_export_aggregation_port_bucket_;
+    uint32_t flow_export_aggregation_table_size_;
 
     // Parameters configured from command line arguments only (for now)
     std::string config_file_;
@@ -398,6 +423,13 @@ private:
     //only for testing where MX and bare metal are simulated. VM on the
     //simulated compute node behaves as bare metal.
     bool simulate_evpn_tor_;
+    //Send unicast route exports to control node in batches of many routes
+    bool xmpp_route_batch_;
+    //Send changes of a KSync entry to vrouter while its earlier message is
+    //still waiting for ack
+    bool ksync_pipelined_;
+    //Send messages for DB entries on a KSync socket per DB partition
+    bool ksync_multi_socket_;
     std::string si_netns_command_;
     std::string si_docker_command_;
     int si_netns_workers_;
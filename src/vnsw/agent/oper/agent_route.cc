@@ -260,7 +260,7 @@ void AgentRouteTable::DeletePathFromPeer(DBTablePartBase *part,
         part->Delete(rt);
     } else {
         // Notify deletion of path. 
-        part->Notify(rt);
+        NotifyEntry(rt);
         UpdateDependants(rt);
     }
 }
@@ -469,7 +469,7 @@ void AgentRouteTable::Input(DBTablePartition *part, DBClient *client,
         if (prev_front) {
             rt->Sort(&AgentRouteTable::PathSelection, prev_front);
         }
-        part->Notify(rt);
+        NotifyEntry(rt);
         rt->UpdateDependantRoutes();
         rt->ResyncTunnelNextHop();
         UpdateDependants(rt);
@@ -757,7 +757,7 @@ void AgentRouteTable::StalePathFromPeer(DBTablePartBase *part, AgentRoute *rt,
         rt->SquashStalePaths(path);
         rt->GetPathList().sort(&AgentRouteTable::PathSelection);
         rt->Sync();
-        part->Notify(rt);
+        NotifyEntry(rt);
     }
 }
 
@@ -12,6 +12,7 @@
 
 #include <base/lifetime.h>
 #include <base/patricia.h>
+#include <base/lpm_trie.h>
 #include <base/task_annotations.h>
 
 #include <cmn/agent_cmn.h>
@@ -38,9 +38,12 @@ AgentRouteKey *InetUnicastRouteKey::Clone() const {
 /////////////////////////////////////////////////////////////////////////////
 // InetUnicastAgentRouteTable functions
 /////////////////////////////////////////////////////////////////////////////
+tbb::atomic<uint64_t> InetUnicastAgentRouteTable::route_generation_seq_;
+
 InetUnicastAgentRouteTable::InetUnicastAgentRouteTable(DB *db,
                                                        const std::string &name) :
     AgentRouteTable(db, name), walkid_(DBTableWalker::kInvalidWalkerId) {
+    BumpRouteGeneration();
 
     if (name.find("uc.route.0") != std::string::npos) {
         type_ = Agent::INET4_UNICAST;
@@ -64,19 +67,67 @@ InetUnicastAgentRouteTable::CreateTable(DB *db, const std::string &name) {
     return table;
 }
 
+// Lookups use the LPM index, Patricia tree is used for ordered walks
+static InetUnicastRouteEntry *LpmFind(
+        const InetUnicastAgentRouteTable::InetRouteLpm &lpm,
+        const IpAddress &ip, uint8_t plen) {
+    if (ip.is_v4()) {
+        Ip4Address::bytes_type bytes = ip.to_v4().to_bytes();
+        return lpm.Find(bytes.data(), plen);
+    }
+    Ip6Address::bytes_type bytes = ip.to_v6().to_bytes();
+    return lpm.Find(bytes.data(), plen);
+}
+
+void InetUnicastAgentRouteTable::ProcessAdd(AgentRoute *rt) {
+    InetUnicastRouteEntry *entry = static_cast<InetUnicastRouteEntry *>(rt);
+    tree_.Insert(entry);
+    BumpRouteGeneration();
+    if (entry->addr().is_v4()) {
+        Ip4Address::bytes_type bytes = entry->addr().to_v4().to_bytes();
+        lpm_.Insert(bytes.data(), entry->plen(), entry);
+    } else {
+        Ip6Address::bytes_type bytes = entry->addr().to_v6().to_bytes();
+        lpm_.Insert(bytes.data(), entry->plen(), entry);
+    }
+}
+
+void InetUnicastAgentRouteTable::ProcessDelete(AgentRoute *rt) {
+    InetUnicastRouteEntry *entry = static_cast<InetUnicastRouteEntry *>(rt);
+    tree_.Remove(entry);
+    BumpRouteGeneration();
+    if (entry->addr().is_v4()) {
+        Ip4Address::bytes_type bytes = entry->addr().to_v4().to_bytes();
+        lpm_.Remove(bytes.data(), entry->plen());
+    } else {
+        Ip6Address::bytes_type bytes = entry->addr().to_v6().to_bytes();
+        lpm_.Remove(bytes.data(), entry->plen());
+    }
+}
+
+void InetUnicastAgentRouteTable::BumpRouteGeneration() {
+    route_generation_ = ++route_generation_seq_;
+}
+
+// Paths of the route changed, the active path, nexthop, VN and SG list
+// cached for flow setup may be stale
+void InetUnicastAgentRouteTable::NotifyEntry(AgentRoute *entry) {
+    BumpRouteGeneration();
+    AgentRouteTable::NotifyEntry(entry);
+}
+
 InetUnicastRouteEntry *
 InetUnicastAgentRouteTable::FindLPM(const IpAddress &ip) {
-    uint32_t plen = 128;
+    uint8_t plen = 128;
     if (ip.is_v4()) {
         plen = 32;
     }
-    InetUnicastRouteEntry key(NULL, ip, plen, false);
-    return tree_.LPMFind(&key);
+    return LpmFind(lpm_, ip, plen);
 }
 
 InetUnicastRouteEntry *
 InetUnicastAgentRouteTable::FindLPM(const InetUnicastRouteEntry &rt_key) {
-    return tree_.LPMFind(&rt_key);
+    return LpmFind(lpm_, rt_key.addr(), rt_key.plen());
 }
 
 InetUnicastRouteEntry *
@@ -84,8 +135,7 @@ InetUnicastAgentRouteTable::FindResolveRoute(const Ip4Address &ip) {
     uint8_t plen = 32;
     InetUnicastRouteEntry *rt = NULL;
     do {
-        InetUnicastRouteEntry key(NULL, ip, plen, false);
-        rt = tree_.LPMFind(&key);
+        rt = LpmFind(lpm_, ip, plen);
         if (rt) {
             const NextHop *nh = rt->GetActiveNextHop();
             if (nh && nh->GetType() == NextHop::RESOLVE)
@@ -141,6 +141,8 @@ public:
     typedef Patricia::Tree<InetUnicastRouteEntry,
                            &InetUnicastRouteEntry::rtnode_,
                            InetUnicastRouteEntry::Rtkey> InetRouteTree;
+    // Longest prefix match index for lookups, kept in sync with tree_
+    typedef LpmTrie<InetUnicastRouteEntry> InetRouteLpm;
 
     InetUnicastAgentRouteTable(DB *db, const std::string &name);
     virtual ~InetUnicastAgentRouteTable() { }
@@ -159,12 +161,14 @@ public:
     virtual Agent::RouteTableType GetTableType() const {
         return type_;
     }
-    virtual void ProcessAdd(AgentRoute *rt) { 
-        tree_.Insert(static_cast<InetUnicastRouteEntry *>(rt));
-    }
-    virtual void ProcessDelete(AgentRoute *rt) { 
-        tree_.Remove(static_cast<InetUnicastRouteEntry *>(rt));
-    }
+    // Changes whenever a route is added to, deleted from or notified in the
+    // table, LPM and path results cached with an older generation are
+    // stale. Generations are unique across all tables. Written from the
+    // db::DBTable task and read from flow setup
+    uint64_t route_generation() const { return route_generation_; }
+    virtual void ProcessAdd(AgentRoute *rt);
+    virtual void ProcessDelete(AgentRoute *rt);
+    virtual void NotifyEntry(AgentRoute *entry);
     virtual AgentSandeshPtr GetAgentSandesh(const AgentSandeshArguments *args,
                                             const std::string &context);
     InetUnicastRouteEntry *FindRouteUsingKey(InetUnicastRouteEntry &key) {
@@ -314,8 +318,13 @@ public:
                             bool add_change);
 
 private:
+    void BumpRouteGeneration();
+
     Agent::RouteTableType type_;
     InetRouteTree tree_;
+    InetRouteLpm lpm_;
+    tbb::atomic<uint64_t> route_generation_;
+    static tbb::atomic<uint64_t> route_generation_seq_;
     Patricia::Node rtnode_;
     DBTableWalker::WalkId walkid_;
     DISALLOW_COPY_AND_ASSIGN(InetUnicastAgentRouteTable);
@@ -20,6 +20,8 @@ class PktHandler;
 class ControlInterface {
 public:
     static const uint32_t kMaxPacketSize = 9060;
+    // Max packets read from the interface in a burst
+    static const uint32_t kMaxBurst = 32;
 
     ControlInterface() { }
     virtual ~ControlInterface() { }
@@ -58,6 +60,13 @@ public:
         return true;
     }
 
+    // Handle a burst of control packets. AgentHdr is already decoded
+    bool ProcessBurst(const AgentHdr *hdr, const PacketBufferPtr *pkt,
+                      uint32_t count) {
+        pkt_handler_->HandleRcvPktBurst(hdr, pkt, count);
+        return true;
+    }
+
     PktHandler *pkt_handler() const { return pkt_handler_; }
 private:
     PktHandler *pkt_handler_;
@@ -294,14 +294,14 @@ void FlowEntry::InitFwdFlow(const PktFlowInfo *info, const PktInfo *pkt,
     if (info->flood_unknown_unicast) {
         set_flags(FlowEntry::UnknownUnicastFlood);
         if (info->ingress) {
-            GetSourceRouteInfo(ctrl->rt_);
+            GetSourceRouteInfo(info->route_result, ctrl->rt_);
         } else {
-            GetSourceRouteInfo(rev_ctrl->rt_);
+            GetSourceRouteInfo(info->route_result, rev_ctrl->rt_);
         }
         data_.dest_vn = data_.source_vn;
     } else {
-        GetSourceRouteInfo(ctrl->rt_);
-        GetDestRouteInfo(rev_ctrl->rt_);
+        GetSourceRouteInfo(info->route_result, ctrl->rt_);
+        GetDestRouteInfo(info->route_result, rev_ctrl->rt_);
     }
 
     data_.smac = pkt->smac;
@@ -364,9 +364,9 @@ void FlowEntry::InitRevFlow(const PktFlowInfo *info, const PktInfo *pkt,
     if (info->flood_unknown_unicast) {
         set_flags(FlowEntry::UnknownUnicastFlood);
         if (info->ingress) {
-            GetSourceRouteInfo(rev_ctrl->rt_);
+            GetSourceRouteInfo(info->route_result, rev_ctrl->rt_);
         } else {
-            GetSourceRouteInfo(ctrl->rt_);
+            GetSourceRouteInfo(info->route_result, ctrl->rt_);
         }
         //Set source VN and dest VN to be same
         //since flooding happens only for layer2 routes
@@ -375,8 +375,8 @@ void FlowEntry::InitRevFlow(const PktFlowInfo *info, const PktInfo *pkt,
         //SG to allow such traffic
         data_.dest_vn = data_.source_vn;
     } else {
-        GetSourceRouteInfo(ctrl->rt_);
-        GetDestRouteInfo(rev_ctrl->rt_);
+        GetSourceRouteInfo(info->route_result, ctrl->rt_);
+        GetDestRouteInfo(info->route_result, rev_ctrl->rt_);
     }
 
     data_.smac = pkt->dmac;
@@ -496,18 +496,22 @@ static bool ShouldDrop(uint32_t action) {
 // Get src-vn/sg-id/plen from route
 // src-vn and sg-id are used for policy lookup
 // plen is used to track the routes to use by flow_mgmt module
-void FlowEntry::GetSourceRouteInfo(const AgentRoute *rt) {
-    const AgentPath *path = NULL;
-    if (rt) {
-        path = rt->GetActivePath();
+// VN and SG of routes in the route cache result are taken from the result
+void FlowEntry::GetSourceRouteInfo(const FlowRouteResult *result,
+                                   const AgentRoute *rt) {
+    const std::string *vn = NULL;
+    const SecurityGroupList *sg_l = NULL;
+    if (result == NULL || result->GetPathInfo(rt, &vn, &sg_l) == false) {
+        FlowRouteResult::PathInfo(rt, &vn, &sg_l);
     }
-    if (path == NULL) {
+
+    if (vn == NULL) {
         data_.source_vn = FlowHandler::UnknownVn();
         data_.source_sg_id_l = default_sg_list();
         data_.source_plen = 0;
     } else {
-        data_.source_vn = path->dest_vn_name();
-        data_.source_sg_id_l = path->sg_list();
+        data_.source_vn = *vn;
+        data_.source_sg_id_l = *sg_l;
         data_.source_plen = rt->plen();
     }
 }
@@ -515,19 +519,21 @@ void FlowEntry::GetSourceRouteInfo(const AgentRoute *rt) {
 // Get dst-vn/sg-id/plen from route
 // dst-vn and sg-id are used for policy lookup
 // plen is used to track the routes to use by flow_mgmt module
-void FlowEntry::GetDestRouteInfo(const AgentRoute *rt) {
-    const AgentPath *path = NULL;
-    if (rt) {
-        path = rt->GetActivePath();
+void FlowEntry::GetDestRouteInfo(const FlowRouteResult *result,
+                                 const AgentRoute *rt) {
+    const std::string *vn = NULL;
+    const SecurityGroupList *sg_l = NULL;
+    if (result == NULL || result->GetPathInfo(rt, &vn, &sg_l) == false) {
+        FlowRouteResult::PathInfo(rt, &vn, &sg_l);
     }
 
-    if (path == NULL) {
+    if (vn == NULL) {
         data_.dest_vn = FlowHandler::UnknownVn();
         data_.dest_sg_id_l = default_sg_list();
         data_.dest_plen = 0;
     } else {
-        data_.dest_vn = path->dest_vn_name();
-        data_.dest_sg_id_l = path->sg_list();
+        data_.dest_vn = *vn;
+        data_.dest_sg_id_l = *sg_l;
         data_.dest_plen = rt->plen();
     }
 }
@@ -35,6 +35,7 @@
 class FlowTableKSyncEntry;
 class FlowEntry;
 struct FlowExportInfo;
+struct FlowRouteResult;
 
 typedef boost::intrusive_ptr<FlowEntry> FlowEntryPtr;
 
@@ -448,8 +449,10 @@ private:
     bool SetRpfNH(FlowTable *ft, const AgentRoute *rt);
     bool InitFlowCmn(const PktFlowInfo *info, const PktControlInfo *ctrl,
                      const PktControlInfo *rev_ctrl, FlowEntry *rflow);
-    void GetSourceRouteInfo(const AgentRoute *rt);
-    void GetDestRouteInfo(const AgentRoute *rt);
+    void GetSourceRouteInfo(const FlowRouteResult *result,
+                            const AgentRoute *rt);
+    void GetDestRouteInfo(const FlowRouteResult *result,
+                          const AgentRoute *rt);
     void UpdateRpf();
     VmInterfaceKey InterfaceIdToKey(Agent *agent, uint32_t id);
     const std::string InterfaceIdToVmCfgName(Agent *agent, uint32_t id);
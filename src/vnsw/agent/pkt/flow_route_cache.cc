@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <cmn/agent_cmn.h>
+#include <oper/route_common.h>
+#include <oper/vrf.h>
+#include <pkt/flow_table.h>
+#include <pkt/flow_route_cache.h>
+
+const uint32_t FlowRouteCache::kDefaultSize;
+
+/////////////////////////////////////////////////////////////////////////////
+// FlowRouteResult routines
+/////////////////////////////////////////////////////////////////////////////
+bool FlowRouteResult::GetRoute(const VrfEntry *vrf, const IpAddress &addr,
+                               const AgentRoute **rt) const {
+    if (vrf != this->vrf)
+        return false;
+
+    if (addr == src_addr) {
+        *rt = src_rt;
+        return true;
+    }
+    if (addr == dst_addr) {
+        *rt = dst_rt;
+        return true;
+    }
+    return false;
+}
+
+bool FlowRouteResult::GetPathInfo(const AgentRoute *rt, const std::string **vn,
+                                  const SecurityGroupList **sg_l) const {
+    if (rt == NULL)
+        return false;
+
+    if (rt == src_rt) {
+        *vn = src_vn;
+        *sg_l = src_sg_l;
+        return true;
+    }
+    if (rt == dst_rt) {
+        *vn = dst_vn;
+        *sg_l = dst_sg_l;
+        return true;
+    }
+    return false;
+}
+
+void FlowRouteResult::PathInfo(const AgentRoute *rt, const std::string **vn,
+                               const SecurityGroupList **sg_l) {
+    const AgentPath *path = NULL;
+    if (rt) {
+        path = rt->GetActivePath();
+    }
+    if (path == NULL) {
+        *vn = NULL;
+        *sg_l = NULL;
+        return;
+    }
+    *vn = &path->dest_vn_name();
+    *sg_l = &path->sg_list();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// FlowRouteCache routines
+/////////////////////////////////////////////////////////////////////////////
+FlowRouteCache::FlowRouteCache(uint32_t size) :
+    enabled_(true), hits_(0), misses_(0), flow_hits_(0), flow_misses_(0) {
+    uint32_t slots = 16;
+    while (slots < size && slots < (1U << 31)) {
+        slots <<= 1;
+    }
+    entries_.resize(slots);
+    result_entries_.resize(slots);
+    mask_ = slots - 1;
+}
+
+FlowRouteCache::~FlowRouteCache() {
+}
+
+InetUnicastAgentRouteTable *FlowRouteCache::GetTable(const VrfEntry *vrf,
+                                                     const IpAddress &addr) {
+    if (addr.is_v4()) {
+        return vrf->GetInet4UnicastRouteTable();
+    } else if (addr.is_v6()) {
+        return vrf->GetInet6UnicastRouteTable();
+    }
+    return NULL;
+}
+
+uint32_t FlowRouteCache::HashAddr(uint32_t hash, const IpAddress &addr) {
+    if (addr.is_v4()) {
+        hash ^= addr.to_v4().to_ulong();
+    } else {
+        Ip6Address::bytes_type bytes = addr.to_v6().to_bytes();
+        for (uint32_t i = 0; i < bytes.size(); i += 4) {
+            hash ^= ((uint32_t)bytes[i] << 24) |
+                ((uint32_t)bytes[i + 1] << 16) |
+                ((uint32_t)bytes[i + 2] << 8) | bytes[i + 3];
+        }
+    }
+    return hash;
+}
+
+// Mix the high bits in, addresses of a subnet differ in the low bits
+uint32_t FlowRouteCache::Mix(uint32_t hash) {
+    hash *= 0x9E3779B1U;
+    return (hash >> 16) ^ hash;
+}
+
+uint32_t FlowRouteCache::Hash(const InetUnicastAgentRouteTable *table,
+                              const IpAddress &addr) const {
+    uint32_t hash = (uint32_t)(reinterpret_cast<uintptr_t>(table) >> 4);
+    return Mix(HashAddr(hash, addr));
+}
+
+uint32_t FlowRouteCache::Hash(const Interface *intf,
+                              const InetUnicastAgentRouteTable *table,
+                              const IpAddress &src_addr,
+                              const IpAddress &dst_addr) const {
+    uint32_t hash = (uint32_t)(reinterpret_cast<uintptr_t>(table) >> 4);
+    hash ^= (uint32_t)(reinterpret_cast<uintptr_t>(intf) >> 4);
+    hash = Mix(HashAddr(hash, src_addr));
+    return Mix(HashAddr(hash, dst_addr));
+}
+
+AgentRoute *FlowRouteCache::LookupUcRoute(InetUnicastAgentRouteTable *table,
+                                          const IpAddress &addr) {
+    AgentRoute *rt = table->FindLPM(addr);
+    if (rt != NULL && rt->IsRPFInvalid()) {
+        return NULL;
+    }
+    return rt;
+}
+
+// The RPF check depends on the active path only, so the result of the
+// check is cached along with the route
+AgentRoute *FlowRouteCache::GetUcRoute(const VrfEntry *vrf,
+                                       const IpAddress &addr) {
+    if (enabled_ == false) {
+        return FlowEntry::GetUcRoute(vrf, addr);
+    }
+
+    InetUnicastAgentRouteTable *table = GetTable(vrf, addr);
+    if (table == NULL)
+        return NULL;
+
+    Entry &entry = entries_[Hash(table, addr) & mask_];
+    uint64_t generation = table->route_generation();
+    if (entry.table == table && entry.generation == generation &&
+        entry.addr == addr) {
+        hits_++;
+        return entry.route;
+    }
+
+    misses_++;
+    entry.table = table;
+    entry.generation = generation;
+    entry.addr = addr;
+    entry.route = LookupUcRoute(table, addr);
+    return entry.route;
+}
+
+const FlowRouteResult *FlowRouteCache::GetFlowRoutes(const Interface *intf,
+                                                     const VrfEntry *vrf,
+                                                     const IpAddress &src_addr,
+                                                     const IpAddress &dst_addr) {
+    if (enabled_ == false || vrf == NULL)
+        return NULL;
+
+    // Both routes come from the same table
+    if (src_addr.is_v4() != dst_addr.is_v4())
+        return NULL;
+    InetUnicastAgentRouteTable *table = GetTable(vrf, dst_addr);
+    if (table == NULL)
+        return NULL;
+
+    ResultEntry &entry =
+        result_entries_[Hash(intf, table, src_addr, dst_addr) & mask_];
+    uint64_t generation = table->route_generation();
+    if (entry.intf == intf && entry.table == table &&
+        entry.generation == generation && entry.result.vrf == vrf &&
+        entry.result.src_addr == src_addr &&
+        entry.result.dst_addr == dst_addr) {
+        flow_hits_++;
+        return &entry.result;
+    }
+
+    flow_misses_++;
+    entry.intf = intf;
+    entry.table = table;
+    entry.generation = generation;
+
+    FlowRouteResult &result = entry.result;
+    result = FlowRouteResult();
+    result.vrf = vrf;
+    result.src_addr = src_addr;
+    result.dst_addr = dst_addr;
+    result.src_rt = LookupUcRoute(table, src_addr);
+    result.dst_rt = LookupUcRoute(table, dst_addr);
+    FlowRouteResult::PathInfo(result.src_rt, &result.src_vn,
+                              &result.src_sg_l);
+    FlowRouteResult::PathInfo(result.dst_rt, &result.dst_vn,
+                              &result.dst_sg_l);
+    if (result.dst_rt) {
+        const AgentPath *path = result.dst_rt->GetActivePath();
+        if (path) {
+            result.dst_nh = path->ComputeNextHop(table->agent());
+        }
+    }
+    return &result;
+}
+
+void FlowRouteCache::set_enabled(bool enabled) {
+    enabled_ = enabled;
+    Clear();
+}
+
+void FlowRouteCache::Clear() {
+    for (std::vector<Entry>::iterator it = entries_.begin();
+         it != entries_.end(); ++it) {
+        *it = Entry();
+    }
+    for (std::vector<ResultEntry>::iterator it = result_entries_.begin();
+         it != result_entries_.end(); ++it) {
+        *it = ResultEntry();
+    }
+    hits_ = 0;
+    misses_ = 0;
+    flow_hits_ = 0;
+    flow_misses_ = 0;
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef __AGENT_PKT_FLOW_ROUTE_CACHE_H__
+#define __AGENT_PKT_FLOW_ROUTE_CACHE_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <base/util.h>
+#include <net/address.h>
+#include <cmn/agent.h>
+
+class AgentRoute;
+class Interface;
+class NextHop;
+class VrfEntry;
+class InetUnicastAgentRouteTable;
+
+// Route derived results of an ingress L3 flow, as computed from the source
+// and destination routes in the VRF of the ingress interface. Pointers are
+// into the active paths of the routes and are valid for the current run of
+// the flow setup task only.
+struct FlowRouteResult {
+    FlowRouteResult() :
+        vrf(NULL), src_rt(NULL), dst_rt(NULL), dst_nh(NULL), src_vn(NULL),
+        dst_vn(NULL), src_sg_l(NULL), dst_sg_l(NULL) {
+    }
+
+    // Route for addr if it is one of the addresses of the result, returns
+    // false otherwise
+    bool GetRoute(const VrfEntry *vrf, const IpAddress &addr,
+                  const AgentRoute **rt) const;
+    // VN and SG list of rt if it is one of the routes of the result,
+    // returns false otherwise
+    bool GetPathInfo(const AgentRoute *rt, const std::string **vn,
+                     const SecurityGroupList **sg_l) const;
+    // VN and SG list of the active path of rt, NULL if there is none
+    static void PathInfo(const AgentRoute *rt, const std::string **vn,
+                         const SecurityGroupList **sg_l);
+
+    const VrfEntry *vrf;
+    IpAddress src_addr;
+    IpAddress dst_addr;
+    // NULL if there is no route or the RPF check fails
+    const AgentRoute *src_rt;
+    const AgentRoute *dst_rt;
+    // Nexthop of the active path of dst_rt
+    const NextHop *dst_nh;
+    const std::string *src_vn;
+    const std::string *dst_vn;
+    const SecurityGroupList *src_sg_l;
+    const SecurityGroupList *dst_sg_l;
+};
+
+// Cache of the route lookups done in flow setup. Bursts of flows between
+// the same pair of addresses skip the LPM lookups and the decode of the
+// active paths, only the port specific ACL and flow state is computed per
+// flow.
+//
+// Two direct mapped arrays are kept:
+// - FlowRouteResult entries keyed on (ingress interface, VRF, source IP,
+//   destination IP), looked up once per ingress flow
+// - Unicast routes keyed on (route table, IP address), for the lookups in
+//   other VRFs done by NAT and VRF translation
+//
+// The cache is not invalidated explicitly. Every entry records the route
+// generation of its table, any route added to, deleted from or notified in
+// the table bumps the generation and makes its entries stale. Path, nexthop
+// and SG changes are notified on the route, so they stale the results too.
+// Route generations are unique across tables, a stale entry cannot match a
+// new table allocated at the same address.
+//
+// Routes are looked up with the same semantics as FlowEntry::GetUcRoute.
+// Must be used from the flow setup task only.
+class FlowRouteCache {
+public:
+    static const uint32_t kDefaultSize = 4096;
+
+    explicit FlowRouteCache(uint32_t size);
+    ~FlowRouteCache();
+
+    AgentRoute *GetUcRoute(const VrfEntry *vrf, const IpAddress &addr);
+    // NULL if the cache is disabled or the addresses have no route table
+    const FlowRouteResult *GetFlowRoutes(const Interface *intf,
+                                         const VrfEntry *vrf,
+                                         const IpAddress &src_addr,
+                                         const IpAddress &dst_addr);
+
+    bool enabled() const { return enabled_; }
+    void set_enabled(bool enabled);
+    void Clear();
+
+    uint32_t size() const { return entries_.size(); }
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+    uint64_t flow_hits() const { return flow_hits_; }
+    uint64_t flow_misses() const { return flow_misses_; }
+
+private:
+    struct ResultEntry {
+        ResultEntry() : intf(NULL), table(NULL), generation(0) { }
+        const Interface *intf;
+        const InetUnicastAgentRouteTable *table;
+        uint64_t generation;
+        FlowRouteResult result;
+    };
+
+    struct Entry {
+        Entry() : table(NULL), generation(0), route(NULL) { }
+        const InetUnicastAgentRouteTable *table;
+        uint64_t generation;
+        IpAddress addr;
+        AgentRoute *route;
+    };
+
+    static InetUnicastAgentRouteTable *GetTable(const VrfEntry *vrf,
+                                                const IpAddress &addr);
+    static uint32_t HashAddr(uint32_t hash, const IpAddress &addr);
+    static uint32_t Mix(uint32_t hash);
+    uint32_t Hash(const InetUnicastAgentRouteTable *table,
+                  const IpAddress &addr) const;
+    uint32_t Hash(const Interface *intf,
+                  const InetUnicastAgentRouteTable *table,
+                  const IpAddress &src_addr, const IpAddress &dst_addr) const;
+    AgentRoute *LookupUcRoute(InetUnicastAgentRouteTable *table,
+                              const IpAddress &addr);
+
+    std::vector<Entry> entries_;
+    std::vector<ResultEntry> result_entries_;
+    uint32_t mask_;
+    bool enabled_;
+    uint64_t hits_;
+    uint64_t misses_;
+    uint64_t flow_hits_;
+    uint64_t flow_misses_;
+    DISALLOW_COPY_AND_ASSIGN(FlowRouteCache);
+};
+
+#endif // __AGENT_PKT_FLOW_ROUTE_CACHE_H__
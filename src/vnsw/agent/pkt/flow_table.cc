@@ -58,7 +58,8 @@ FlowTable::FlowTable(Agent *agent) :
     flow_entry_map_(),
     linklocal_flow_count_(),
     request_queue_(agent_->task_scheduler()->GetTaskId(kTaskName), 1,
-                   boost::bind(&FlowTable::RequestHandler, this, _1)) {
+                   boost::bind(&FlowTable::RequestHandler, this, _1)),
+    route_cache_(FlowRouteCache::kDefaultSize) {
     max_vm_flows_ = (uint32_t)
         (agent->ksync()->flowtable_ksync_obj()->flow_table_entries_count() *
          agent->params()->max_vm_flows()) / 100;
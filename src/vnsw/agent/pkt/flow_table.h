@@ -35,6 +35,7 @@
 #include <pkt/pkt_init.h>
 #include <pkt/pkt_flow_info.h>
 #include <pkt/flow_entry.h>
+#include <pkt/flow_route_cache.h>
 #include <sandesh/sandesh_trace.h>
 #include <oper/vn.h>
 #include <oper/vm.h>
@@ -170,6 +171,7 @@ public:
     Agent *agent() const { return agent_; }
     size_t Size() { return flow_entry_map_.size(); }
     uint32_t linklocal_flow_count() const { return linklocal_flow_count_; }
+    FlowRouteCache *route_cache() { return &route_cache_; }
     FlowTable::FlowEntryMap::iterator begin() {
         return flow_entry_map_.begin();
     }
@@ -268,6 +270,8 @@ private:
     FlowIndexTree flow_index_tree_;
     // maintain the linklocal flow info against allocated fd, debug purpose only
     LinkLocalFlowInfoMap linklocal_flow_info_map_;
+    // Route lookups of flow setup, used from FlowHandler task only
+    FlowRouteCache route_cache_;
     tbb::mutex mutex_;
     DISALLOW_COPY_AND_ASSIGN(FlowTable);
 };
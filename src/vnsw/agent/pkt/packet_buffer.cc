@@ -2,22 +2,80 @@
  * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
  */
 #include <string>
-#include <boost/shared_ptr.hpp>
+#include <cmn/agent.h>
 #include <pkt/packet_buffer.h>
 #include <pkt/control_interface.h>
+#include <pkt/pkt_handler.h>
+#include <pkt/pkt_init.h>
+#include <pkt/pkt_types.h>
+
+// Buffers per module pool, packets trapped by vrouter use the RX_PACKET pool
+static const uint32_t kRxPoolBuffers = 1024;
+static const uint32_t kModulePoolBuffers = 256;
+
+static const char *pool_names[] = {
+    "invalid",
+    "flow",
+    "arp",
+    "dhcp",
+    "dhcpv6",
+    "dns",
+    "icmp",
+    "icmpv6",
+    "diag",
+    "icmp-error",
+    "rx-packet",
+};
+
+void intrusive_ptr_add_ref(PacketBuffer *buff) {
+    buff->refcount_.fetch_and_increment();
+}
+
+void intrusive_ptr_release(PacketBuffer *buff) {
+    if (buff->refcount_.fetch_and_decrement() != 1)
+        return;
+
+    buff->mgr_->FreeIndication(buff);
+    if (buff->pool_) {
+        buff->pool_->Free(buff);
+    } else {
+        delete buff;
+    }
+}
 
 PacketBufferManager::PacketBufferManager(PktModule *pkt_module) :
-    alloc_(0), free_(0), pkt_module_(pkt_module) {
+    pkt_module_(pkt_module) {
+    alloc_ = 0;
+    free_ = 0;
+    for (uint32_t i = 0; i < PktHandler::MAX_MODULES; i++) {
+        if (i == PktHandler::RX_PACKET) {
+            pool_list_.push_back(new PacketBufferPool
+                (this, i, ControlInterface::kMaxPacketSize, kRxPoolBuffers));
+        } else {
+            pool_list_.push_back(new PacketBufferPool
+                (this, i, PacketBuffer::kDefaultBufferLen,
+                 kModulePoolBuffers));
+        }
+    }
 }
 
 PacketBufferManager::~PacketBufferManager() {
+    STLDeleteValues(&pool_list_);
 }
 
+// Buffer is taken from the pool of module, from heap if the pool can not
+// give a buffer of len
 PacketBufferPtr PacketBufferManager::Allocate(uint32_t module, uint16_t len,
                                               uint32_t mdata) {
-    PacketBufferPtr ptr(new PacketBuffer(this, module, len, mdata));
+    PacketBuffer *buff = NULL;
+    if (module < pool_list_.size()) {
+        buff = pool_list_[module]->Allocate(len, mdata);
+    }
+    if (buff == NULL) {
+        buff = new PacketBuffer(this, module, len, mdata);
+    }
     alloc_++;
-    return ptr;
+    return PacketBufferPtr(buff);
 }
 
 PacketBufferPtr PacketBufferManager::Allocate(uint32_t module, uint8_t *buff,
@@ -31,28 +89,114 @@ PacketBufferPtr PacketBufferManager::Allocate(uint32_t module, uint8_t *buff,
     return ptr;
 }
 
+const PacketBufferPool *PacketBufferManager::pool(uint32_t module) const {
+    if (module >= pool_list_.size())
+        return NULL;
+    return pool_list_[module];
+}
+
 void PacketBufferManager::FreeIndication(PacketBuffer *pkt) {
     free_++;
 }
 
+PacketBufferPool::PacketBufferPool(PacketBufferManager *mgr, uint32_t module,
+                                   uint16_t buffer_len,
+                                   uint32_t max_buffers) :
+    mgr_(mgr), module_(module), buffer_len_(buffer_len),
+    max_buffers_(max_buffers), buffers_(0), in_use_(0), allocs_(0),
+    alloc_fails_(0) {
+}
+
+PacketBufferPool::~PacketBufferPool() {
+    STLDeleteValues(&buffer_list_);
+    for (std::vector<uint8_t *>::iterator it = slabs_.begin();
+         it != slabs_.end(); ++it) {
+        delete [] *it;
+    }
+}
+
+// Slab holds kSlabBuffers buffers, each with kHeadroom bytes ahead of it and
+// aligned to a cache line
+bool PacketBufferPool::AddSlab() {
+    if (buffers_ + kSlabBuffers > max_buffers_)
+        return false;
+
+    uint32_t stride = (PacketBuffer::kHeadroom + buffer_len_ + 63) & ~63;
+    uint8_t *slab = new uint8_t[stride * kSlabBuffers];
+    slabs_.push_back(slab);
+    for (uint32_t i = 0; i < kSlabBuffers; i++) {
+        PacketBuffer *buff = new PacketBuffer(mgr_, this, slab + i * stride,
+                                              buffer_len_);
+        buffer_list_.push_back(buff);
+        free_list_.push_back(buff);
+    }
+    buffers_ += kSlabBuffers;
+    return true;
+}
+
+PacketBuffer *PacketBufferPool::Allocate(uint16_t len, uint32_t mdata) {
+    tbb::mutex::scoped_lock lock(mutex_);
+    if (len > buffer_len_ || (free_list_.empty() && AddSlab() == false)) {
+        alloc_fails_++;
+        return NULL;
+    }
+
+    PacketBuffer *buff = free_list_.back();
+    free_list_.pop_back();
+    buff->Reset(module_, len, mdata);
+    in_use_++;
+    allocs_++;
+    return buff;
+}
+
+void PacketBufferPool::Free(PacketBuffer *buff) {
+    tbb::mutex::scoped_lock lock(mutex_);
+    free_list_.push_back(buff);
+    in_use_--;
+}
+
 PacketBuffer::PacketBuffer(PacketBufferManager *mgr, uint32_t module,
                            uint16_t len, uint32_t mdata) :
-    buffer_(new uint8_t[len]), buffer_len_(len), data_(buffer_.get()),
-    data_len_(len), module_(module), mdata_(mdata), mgr_(mgr) {
+    head_(new uint8_t[len]), buffer_(head_), buffer_len_(len), data_(buffer_),
+    data_len_(len), module_(module), mdata_(mdata), mgr_(mgr), pool_(NULL) {
+    refcount_ = 0;
+    headroom_reserved_ = false;
 }
 
 PacketBuffer::PacketBuffer(PacketBufferManager *mgr, uint32_t module,
                            uint8_t *buff, uint16_t len, uint16_t data_offset,
                            uint16_t data_len, uint32_t mdata) :
-    buffer_(buff), buffer_len_(len), data_(buffer_.get() + data_offset),
-    data_len_(data_len), module_(module), mdata_(mdata), mgr_(mgr) {
+    head_(buff), buffer_(buff), buffer_len_(len), data_(buffer_ + data_offset),
+    data_len_(data_len), module_(module), mdata_(mdata), mgr_(mgr),
+    pool_(NULL) {
+    refcount_ = 0;
+    headroom_reserved_ = false;
+}
+
+PacketBuffer::PacketBuffer(PacketBufferManager *mgr, PacketBufferPool *pool,
+                           uint8_t *head, uint16_t len) :
+    head_(head), buffer_(head + kHeadroom), buffer_len_(len), data_(buffer_),
+    data_len_(0), module_(pool->module()), mdata_(0), mgr_(mgr), pool_(pool) {
+    refcount_ = 0;
+    headroom_reserved_ = false;
 }
 
 PacketBuffer::~PacketBuffer() {
-    mgr_->FreeIndication(this);
+    if (pool_ == NULL) {
+        delete [] head_;
+    }
     data_ = NULL;
 }
 
+// Prepare a pool buffer for reuse, buffer_len is retained
+void PacketBuffer::Reset(uint32_t module, uint16_t len, uint32_t mdata) {
+    data_ = buffer_;
+    data_len_ = len;
+    module_ = module;
+    mdata_ = mdata;
+    headroom_reserved_ = false;
+}
+
 uint8_t *PacketBuffer::data() const {
     return data_;
 }
@@ -70,11 +214,56 @@ bool PacketBuffer::SetOffset(uint16_t offset) {
     return true;
 }
 
+// Move data pointer back by len bytes, the headroom must have space for it
+bool PacketBuffer::Push(uint16_t len) {
+    if (len > headroom())
+        return false;
+    data_ -= len;
+    data_len_ += len;
+    return true;
+}
+
+uint8_t *PacketBuffer::ReserveHeadroom(uint16_t len) {
+    if (len > headroom())
+        return NULL;
+    if (headroom_reserved_.compare_and_swap(true, false) != false)
+        return NULL;
+    return data_ - len;
+}
+
 // Set data_len in packet buffer
 void PacketBuffer::set_len(uint32_t len) {
-    uint32_t offset = data_ - buffer_.get();
-
     // Check if there is enough space first
-    assert((buffer_len_ - offset) >= len);
+    assert((uint32_t)((buffer_ + buffer_len_) - data_) >= len);
     data_len_ = len;
 }
+
+void PacketBufferPoolReq::HandleRequest() const {
+    PacketBufferPoolResp *resp = new PacketBufferPoolResp();
+    std::vector<PacketBufferPoolInfo> &list =
+        const_cast<std::vector<PacketBufferPoolInfo>&>
+        (resp->get_pool_list());
+
+    const PacketBufferManager *mgr =
+        Agent::GetInstance()->pkt()->packet_buffer_manager();
+    for (uint32_t i = 0; i < PktHandler::MAX_MODULES; i++) {
+        const PacketBufferPool *pool = mgr->pool(i);
+        if (pool == NULL)
+            continue;
+        PacketBufferPoolInfo info;
+        info.set_module(pool_names[i]);
+        info.set_buffer_len(pool->buffer_len());
+        info.set_max_buffers(pool->max_buffers());
+        info.set_buffers(pool->buffers());
+        info.set_in_use(pool->in_use());
+        info.set_allocs(pool->allocs());
+        info.set_alloc_fails(pool->alloc_fails());
+        list.push_back(info);
+    }
+    resp->set_alloc_count(mgr->alloc_count());
+    resp->set_free_count(mgr->free_count());
+
+    resp->set_context(context());
+    resp->set_more(false);
+    resp->Response();
+}
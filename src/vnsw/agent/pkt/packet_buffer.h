@@ -6,24 +6,34 @@
 #define vnsw_agent_pkt_packet_buffer_hpp
 
 #include <string>
+#include <vector>
 #include <stdint.h>
 #include <boost/shared_ptr.hpp>
-#include <boost/shared_array.hpp>
+#include <boost/intrusive_ptr.hpp>
+#include <tbb/atomic.h>
+#include <tbb/mutex.h>
 #include <base/util.h>
 
 class PacketBuffer;
+class PacketBufferPool;
 class PacketBufferManager;
 class AgentHdr;
 class PktHandler;
 class PktModule;
 
-typedef boost::shared_ptr<PacketBuffer> PacketBufferPtr;
+void intrusive_ptr_add_ref(PacketBuffer *buff);
+void intrusive_ptr_release(PacketBuffer *buff);
+
+typedef boost::intrusive_ptr<PacketBuffer> PacketBufferPtr;
 class PacketBuffer {
 public:
     static const uint32_t kDefaultBufferLen = 1024;
+    // Space reserved ahead of buffers allocated from a pool. Encapsulation
+    // headers can be added in place in the headroom
+    static const uint32_t kHeadroom = 64;
     virtual ~PacketBuffer();
 
-    uint8_t *buffer() const { return buffer_.get(); }
+    uint8_t *buffer() const { return buffer_; }
     uint16_t buffer_len() const { return buffer_len_; }
 
     uint8_t *data() const;
@@ -34,8 +44,25 @@ public:
 
     void set_len(uint32_t len);
     bool SetOffset(uint16_t offset);
+
+    // Space available ahead of data
+    uint16_t headroom() const { return data_ - head_; }
+    // Prepend len bytes in headroom to data
+    bool Push(uint16_t len);
+    bool InHeadroom(const uint8_t *ptr) const {
+        return (ptr >= head_ && ptr < data_);
+    }
+    // Reserve len bytes of headroom ahead of data for a header sent along
+    // with the data. Returns NULL if headroom is short or is reserved by a
+    // send in progress
+    uint8_t *ReserveHeadroom(uint16_t len);
+    void ReleaseHeadroom() { headroom_reserved_ = false; }
 private:
     friend class PacketBufferManager;
+    friend class PacketBufferPool;
+    friend void intrusive_ptr_add_ref(PacketBuffer *buff);
+    friend void intrusive_ptr_release(PacketBuffer *buff);
+
     PacketBuffer(PacketBufferManager *mgr, uint32_t module, uint16_t len,
                  uint32_t mdata);
 
@@ -44,7 +71,14 @@ private:
                  uint16_t len, uint16_t data_offset, uint16_t data_len,
                  uint32_t mdata);
 
-    boost::shared_array<uint8_t> buffer_;
+    // Create PacketBuffer over memory of a pool slab
+    PacketBuffer(PacketBufferManager *mgr, PacketBufferPool *pool,
+                 uint8_t *head, uint16_t len);
+
+    void Reset(uint32_t module, uint16_t len, uint32_t mdata);
+
+    uint8_t *head_;
+    uint8_t *buffer_;
     uint16_t buffer_len_;
 
     uint8_t *data_;
@@ -53,9 +87,55 @@ private:
     uint32_t module_;
     uint32_t mdata_;
     PacketBufferManager *mgr_;
+    // Pool owning the memory, NULL if memory is from heap
+    PacketBufferPool *pool_;
+    tbb::atomic<int> refcount_;
+    tbb::atomic<bool> headroom_reserved_;
     DISALLOW_COPY_AND_ASSIGN(PacketBuffer);
 };
 
+// Pool of fixed size buffers for a module. Buffers are allocated in slabs of
+// kSlabBuffers and recycled on free, slabs are released only when the pool
+// is deleted
+class PacketBufferPool {
+public:
+    static const uint32_t kSlabBuffers = 32;
+
+    PacketBufferPool(PacketBufferManager *mgr, uint32_t module,
+                     uint16_t buffer_len, uint32_t max_buffers);
+    ~PacketBufferPool();
+
+    // Returns NULL if len is more than buffer_len or the pool is exhausted
+    PacketBuffer *Allocate(uint16_t len, uint32_t mdata);
+    void Free(PacketBuffer *buff);
+
+    uint32_t module() const { return module_; }
+    uint16_t buffer_len() const { return buffer_len_; }
+    uint32_t max_buffers() const { return max_buffers_; }
+    uint32_t buffers() const { return buffers_; }
+    uint32_t in_use() const { return in_use_; }
+    uint64_t allocs() const { return allocs_; }
+    uint64_t alloc_fails() const { return alloc_fails_; }
+
+private:
+    bool AddSlab();
+
+    PacketBufferManager *mgr_;
+    uint32_t module_;
+    uint16_t buffer_len_;
+    uint32_t max_buffers_;
+
+    tbb::mutex mutex_;
+    std::vector<uint8_t *> slabs_;
+    std::vector<PacketBuffer *> buffer_list_;
+    std::vector<PacketBuffer *> free_list_;
+    uint32_t buffers_;
+    uint32_t in_use_;
+    uint64_t allocs_;
+    uint64_t alloc_fails_;
+    DISALLOW_COPY_AND_ASSIGN(PacketBufferPool);
+};
+
 class PacketBufferManager {
 public:
     PacketBufferManager(PktModule *pkt_module);
@@ -66,13 +146,19 @@ public:
     PacketBufferPtr Allocate(uint32_t module, uint8_t *buff, uint16_t len,
                              uint16_t data_offset, uint16_t data_len,
                              uint32_t mdata);
+
+    const PacketBufferPool *pool(uint32_t module) const;
+    uint64_t alloc_count() const { return alloc_; }
+    uint64_t free_count() const { return free_; }
 private:
     friend class PacketBuffer;
+    friend void intrusive_ptr_release(PacketBuffer *buff);
     void FreeIndication(PacketBuffer *);
 
-    uint64_t alloc_;
-    uint64_t free_;
+    tbb::atomic<uint64_t> alloc_;
+    tbb::atomic<uint64_t> free_;
     PktModule *pkt_module_;
+    std::vector<PacketBufferPool *> pool_list_;
 
     DISALLOW_COPY_AND_ASSIGN(PacketBufferManager);
 };
@@ -71,7 +71,10 @@ void PktFlowInfo::UpdateRoute(const AgentRoute **rt, const VrfEntry *vrf,
     if (*rt != NULL && (*rt)->GetTableType() != Agent::BRIDGE)
         ref_map[(*rt)->vrf_id()] = RouteToPrefixLen(*rt);
     if (l3_flow) {
-        *rt = FlowEntry::GetUcRoute(vrf, ip);
+        if (route_result == NULL ||
+            route_result->GetRoute(vrf, ip, rt) == false) {
+            *rt = flow_table->route_cache()->GetUcRoute(vrf, ip);
+        }
     } else {
         *rt = FlowEntry::GetL2Route(vrf, mac);
     }
@@ -377,11 +380,16 @@ static bool RouteToOutInfo(const AgentRoute *rt, const PktInfo *pkt,
                            PktFlowInfo *info, PktControlInfo *in,
                            PktControlInfo *out) {
     Agent *agent = static_cast<AgentRouteTable *>(rt->get_table())->agent();
-    const AgentPath *path = rt->GetActivePath();
-    if (path == NULL)
-        return false;
+    const NextHop *nh = NULL;
+    if (info->route_result && rt == info->route_result->dst_rt) {
+        nh = info->route_result->dst_nh;
+    } else {
+        const AgentPath *path = rt->GetActivePath();
+        if (path == NULL)
+            return false;
 
-    const NextHop *nh = static_cast<const NextHop *>(path->ComputeNextHop(agent));
+        nh = static_cast<const NextHop *>(path->ComputeNextHop(agent));
+    }
     if (nh == NULL)
         return false;
 
@@ -1021,6 +1029,13 @@ void PktFlowInfo::IngressProcess(const PktInfo *pkt, PktControlInfo *in,
         return;
     }
 
+    // Routes, nexthop, VN and SG of the source and destination in the VRF
+    // of the interface, shared by the flows between the same addresses
+    if (l3_flow) {
+        route_result = flow_table->route_cache()->GetFlowRoutes(in->intf_,
+                           in->vrf_, pkt->ip_saddr, pkt->ip_daddr);
+    }
+
     // We always expect route for source-ip for ingress flows.
     // If route not present, return from here so that a short flow is added
     UpdateRoute(&in->rt_, in->vrf_, pkt->ip_saddr, pkt->smac,
@@ -12,6 +12,7 @@ class VmEntry;
 class FlowTable;
 class FlowEntry;
 class AgentRoute;
+struct FlowRouteResult;
 struct PktInfo;
 struct MatchPolicy;
 
@@ -50,7 +51,7 @@ public:
         ecmp(false), in_component_nh_idx(-1), out_component_nh_idx(-1),
         trap_rev_flow(false), fip_snat(false), fip_dnat(false), snat_fip(),
         short_flow_reason(0), peer_vrouter(), tunnel_type(TunnelType::INVALID),
-        flood_unknown_unicast(false) {
+        flood_unknown_unicast(false), route_result(NULL) {
     }
 
     static bool ComputeDirection(const Interface *intf);
@@ -158,6 +159,9 @@ public:
     // flow entry obtained from flow IPC, which requires recomputation.
     FlowEntry           *flow_entry;
     bool                 flood_unknown_unicast;
+
+    // Cached routes of the ingress VRF, see FlowRouteCache
+    const FlowRouteResult *route_result;
 };
 
 #endif // __agent_pkt_flow_info_h_
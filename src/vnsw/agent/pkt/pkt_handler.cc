@@ -186,7 +186,9 @@ PktHandler::PktModuleName PktHandler::ParsePacket(const AgentHdr &hdr,
     return INVALID;
 }
 
-void PktHandler::HandleRcvPkt(const AgentHdr &hdr, const PacketBufferPtr &buff){
+// Parse a received packet. Returns NULL if packet is not for any module
+boost::shared_ptr<PktInfo> PktHandler::ParseRcvPkt(const AgentHdr &hdr,
+                                                   const PacketBufferPtr &buff){
     boost::shared_ptr<PktInfo> pkt_info(new PktInfo(buff));
     PktModuleName mod = INVALID;
     mod = ParsePacket(hdr, pkt_info.get(), pkt_info->packet_buffer()->data());
@@ -196,13 +198,40 @@ void PktHandler::HandleRcvPkt(const AgentHdr &hdr, const PacketBufferPtr &buff){
     if (mod == INVALID) {
         AddPktTrace(mod, PktTrace::In, pkt_info.get());
         agent_->stats()->incr_pkt_dropped();
+        pkt_info.reset();
+    }
+    return pkt_info;
+}
+
+void PktHandler::HandleRcvPkt(const AgentHdr &hdr, const PacketBufferPtr &buff){
+    boost::shared_ptr<PktInfo> pkt_info = ParseRcvPkt(hdr, buff);
+    if (pkt_info.get() == NULL) {
         return;
     }
 
-    Enqueue(mod, pkt_info);
+    Enqueue(pkt_info->module, pkt_info);
     return;
 }
 
+void PktHandler::HandleRcvPktBurst(const AgentHdr *hdr,
+                                   const PacketBufferPtr *buff,
+                                   uint32_t count) {
+    PktInfoList batch[MAX_MODULES];
+    for (uint32_t i = 0; i < count; i++) {
+        boost::shared_ptr<PktInfo> pkt_info = ParseRcvPkt(hdr[i], buff[i]);
+        if (pkt_info.get() == NULL) {
+            continue;
+        }
+        batch[pkt_info->module].push_back(pkt_info);
+    }
+
+    for (uint32_t mod = 0; mod < MAX_MODULES; mod++) {
+        if (batch[mod].empty() == false) {
+            EnqueueBatch((PktModuleName)mod, batch[mod]);
+        }
+    }
+}
+
 // Compute L2/L3 forwarding mode for pacekt.
 // Forwarding mode is L3 if,
 // - Packet uses L3 label
@@ -964,6 +993,12 @@ void PktHandler::Enqueue(PktModuleName module,
     return;
 }
 
+void PktHandler::EnqueueBatch(PktModuleName module, const PktInfoList &list) {
+    if (!(proto_list_.at(module)->EnqueueBatch(list))) {
+        stats_.PktQThresholdExceeded(module);
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void PktTrace::Pkt::Copy(Direction d, std::size_t l, uint8_t *msg,
                          std::size_t pkt_trace_size, const AgentHdr *hdr) {
@@ -178,6 +178,7 @@ class PktHandler {
 public:
     typedef boost::function<bool(boost::shared_ptr<PktInfo>)> RcvQueueFunc;
     typedef boost::function<void(PktTrace::Pkt &)> PktTraceCallback;
+    typedef std::vector<boost::shared_ptr<PktInfo> > PktInfoList;
 
     enum PktModuleName {
         INVALID,
@@ -225,6 +226,10 @@ public:
                      PktType::Type &pkt_type, uint8_t *pkt);
     // identify pkt type and send to the registered handler
     void HandleRcvPkt(const AgentHdr &hdr, const PacketBufferPtr &buff);
+    // Handle a burst of received packets. Packets are enqueued to the
+    // registered handlers in a batch per module
+    void HandleRcvPktBurst(const AgentHdr *hdr, const PacketBufferPtr *buff,
+                           uint32_t count);
     void SendMessage(PktModuleName mod, InterTaskMsg *msg); 
 
     bool IsGwPacket(const Interface *intf, const IpAddress &dst_ip);
@@ -249,9 +254,12 @@ public:
     Agent *agent() const { return agent_; }
     PktModule *pkt_module() const { return pkt_module_; }
     void Enqueue(PktModuleName module, boost::shared_ptr<PktInfo> pkt_info);
+    void EnqueueBatch(PktModuleName module, const PktInfoList &list);
     bool IsFlowPacket(PktInfo *pkt_info);
 
 private:
+    boost::shared_ptr<PktInfo> ParseRcvPkt(const AgentHdr &hdr,
+                                           const PacketBufferPtr &buff);
     int ParseEthernetHeader(PktInfo *pkt_info, uint8_t *pkt);
     int ParseMplsHdr(PktInfo *pkt_info, uint8_t *pkt);
     int ParseIpPacket(PktInfo *pkt_info, PktType::Type &pkt_type,
@@ -19,9 +19,9 @@
 SandeshTraceBufferPtr PacketTraceBuf(SandeshTraceBufferCreate("Packet", 1000));
 
 PktModule::PktModule(Agent *agent) 
-    : agent_(agent), control_interface_(NULL), pkt_handler_(NULL),
-    flow_table_(NULL), flow_proto_(NULL),
-    packet_buffer_manager_(new PacketBufferManager(this)) {
+    : agent_(agent), control_interface_(NULL),
+    packet_buffer_manager_(new PacketBufferManager(this)),
+    pkt_handler_(NULL), flow_table_(NULL), flow_proto_(NULL) {
 }
 
 PktModule::~PktModule() {
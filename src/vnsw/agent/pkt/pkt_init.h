@@ -45,10 +45,12 @@ public:
 private:
     Agent *agent_;
     ControlInterface *control_interface_;
+    // Declared ahead of modules holding packet buffers so that buffer pools
+    // are deleted last
+    boost::scoped_ptr<PacketBufferManager> packet_buffer_manager_;
     boost::scoped_ptr<PktHandler> pkt_handler_;
     boost::scoped_ptr<FlowTable> flow_table_;
     boost::scoped_ptr<FlowProto> flow_proto_;
-    boost::scoped_ptr<PacketBufferManager> packet_buffer_manager_;
     boost::scoped_ptr<FlowMgmtManager> flow_mgmt_manager_;
     DISALLOW_COPY_AND_ASSIGN(PktModule);
 };
@@ -53,6 +53,28 @@ bool Proto::Enqueue(boost::shared_ptr<PktInfo> msg) {
     return work_queue_.Enqueue(msg);
 }
 
+// Enqueue packets received in a burst. Work queue task is started once for
+// the batch
+bool Proto::EnqueueBatch(const PktHandler::PktInfoList &list) {
+    PktHandler::PktInfoList batch;
+    batch.reserve(list.size());
+    for (PktHandler::PktInfoList::const_iterator it = list.begin();
+         it != list.end(); ++it) {
+        if (Validate(it->get()) == false) {
+            continue;
+        }
+
+        if (free_buffer_) {
+            FreeBuffer(it->get());
+        }
+        batch.push_back(*it);
+    }
+
+    if (batch.empty())
+        return true;
+    return work_queue_.EnqueueBatch(batch);
+}
+
 // PktHandler enqueues the packet as-is without decoding based on "cmd" in
 // agent_hdr. Decode the pacekt first. Its possible that protocol handler may
 // change based on packet decode
@@ -21,6 +21,7 @@ public:
 
     virtual bool Validate(PktInfo *msg) { return true; }
     virtual bool Enqueue(boost::shared_ptr<PktInfo> msg);
+    bool EnqueueBatch(const PktHandler::PktInfoList &list);
     virtual ProtoHandler *AllocProtoHandler(boost::shared_ptr<PktInfo> info,
                                             boost::asio::io_service &io) = 0;
 
@@ -6,6 +6,8 @@
 #include "test/test_cmn_util.h"
 #include "test_pkt_util.h"
 #include "pkt/flow_proto.h"
+#include "pkt/flow_table.h"
+#include "base/time_util.h"
 
 struct PortInfo input[] = {
     {"vnet1", 1, "1.1.1.1", "00:00:01:01:01:01", 1, 1},
@@ -75,6 +77,127 @@ TEST_F(FlowTest, FlowScaling_1) {
              (count == flow_count + (int) Agent::GetInstance()->pkt()->flow_table()->Size()));
 }
 
+// Flows between the same pair of addresses find the routes in the route
+// cache, a more specific route added to the VRF is seen by new flows
+TEST_F(FlowTest, RouteCache) {
+    FlowTable *table = Agent::GetInstance()->pkt()->flow_table();
+    FlowRouteCache *cache = table->route_cache();
+    cache->Clear();
+
+    for (int i = 0; i < 10; i++) {
+        TxTcpPacket(vnet->id(), vnet_addr, "5.0.0.1", 1000 + i, 80, false);
+    }
+    client->WaitForIdle();
+    EXPECT_EQ(20U, table->Size());
+    EXPECT_GE(cache->flow_hits(), 9U);
+    uint64_t misses = cache->flow_misses();
+
+    int vrf_id = VrfGet("vrf1")->vrf_id();
+    int nh_id = vnet->flow_key_nh()->id();
+    FlowEntry *fe = FlowGet(vrf_id, vnet_addr, "5.0.0.1", 6, 1000, 80, nh_id);
+    EXPECT_TRUE(fe != NULL && fe->peer_vrouter() == "1.1.1.2");
+
+    boost::system::error_code ec;
+    Inet4TunnelRouteAdd(NULL, "vrf1",
+                        Ip4Address::from_string("5.0.0.1", ec),
+                        32, Ip4Address::from_string("1.1.1.3", ec),
+                        TunnelType::AllType(), 17, "TestVn",
+                        SecurityGroupList(), PathPreference());
+    client->WaitForIdle();
+    TxTcpPacket(vnet->id(), vnet_addr, "5.0.0.1", 2000, 80, false);
+    client->WaitForIdle();
+    EXPECT_GT(cache->flow_misses(), misses);
+    fe = FlowGet(vrf_id, vnet_addr, "5.0.0.1", 6, 2000, 80, nh_id);
+    EXPECT_TRUE(fe != NULL && fe->peer_vrouter() == "1.1.1.3");
+
+    client->EnqueueFlowFlush();
+    client->WaitForIdle();
+    InetUnicastAgentRouteTable::DeleteReq(NULL, "vrf1",
+                                 Ip4Address::from_string("5.0.0.1", ec), 32,
+                                 NULL);
+    client->WaitForIdle();
+}
+
+// A change of the path of a cached route, without any route added or
+// deleted, is seen by new flows: nexthop, VN and SG come from the new path
+TEST_F(FlowTest, RouteCachePathChange) {
+    FlowTable *table = Agent::GetInstance()->pkt()->flow_table();
+    FlowRouteCache *cache = table->route_cache();
+    cache->Clear();
+
+    TxTcpPacket(vnet->id(), vnet_addr, "5.0.0.1", 1000, 80, false);
+    TxTcpPacket(vnet->id(), vnet_addr, "5.0.0.1", 1001, 80, false);
+    client->WaitForIdle();
+    EXPECT_EQ(1U, cache->flow_hits());
+
+    int vrf_id = VrfGet("vrf1")->vrf_id();
+    int nh_id = vnet->flow_key_nh()->id();
+    FlowEntry *fe = FlowGet(vrf_id, vnet_addr, "5.0.0.1", 6, 1000, 80, nh_id);
+    EXPECT_TRUE(fe != NULL && fe->data().dest_vn == "TestVn");
+
+    SecurityGroupList sg_l;
+    sg_l.push_back(10);
+    boost::system::error_code ec;
+    Inet4TunnelRouteAdd(NULL, "vrf1",
+                        Ip4Address::from_string("5.0.0.0", ec),
+                        8, Ip4Address::from_string("1.1.1.3", ec),
+                        TunnelType::AllType(), 16, "TestVn2",
+                        sg_l, PathPreference());
+    client->WaitForIdle();
+    TxTcpPacket(vnet->id(), vnet_addr, "5.0.0.1", 1002, 80, false);
+    client->WaitForIdle();
+    EXPECT_EQ(2U, cache->flow_misses());
+    fe = FlowGet(vrf_id, vnet_addr, "5.0.0.1", 6, 1002, 80, nh_id);
+    EXPECT_TRUE(fe != NULL);
+    if (fe != NULL) {
+        EXPECT_EQ("1.1.1.3", fe->peer_vrouter());
+        EXPECT_EQ("TestVn2", fe->data().dest_vn);
+        EXPECT_TRUE(fe->data().dest_sg_id_l == sg_l);
+    }
+}
+
+// Flow setup rate with high connection churn, short lived TCP connections
+// from the VM to a few servers. Flows are set up and flushed in rounds, with
+// and without the route cache
+TEST_F(FlowTest, FlowSetupRate) {
+    FlowTable *table = Agent::GetInstance()->pkt()->flow_table();
+    FlowRouteCache *cache = table->route_cache();
+    const int kServers = 16;
+    const int kRounds = 4;
+    int count = 1000;
+    if (getenv("AGENT_FLOW_SCALE_COUNT")) {
+        count = strtoul(getenv("AGENT_FLOW_SCALE_COUNT"), NULL, 0);
+    }
+
+    uint64_t usecs[2] = {0, 0};
+    for (int mode = 0; mode < 2; mode++) {
+        cache->set_enabled(mode == 1);
+        uint16_t sport = 1024;
+        for (int round = 0; round < kRounds; round++) {
+            uint64_t start = ClockMonotonicUsec();
+            for (int i = 0; i < count; i++) {
+                Ip4Address addr(0x05000001 + (i % kServers));
+                TxTcpPacket(vnet->id(), vnet_addr, addr.to_string().c_str(),
+                            sport++, 80, false);
+            }
+            WAIT_FOR(count * 10, 1000, ((uint32_t)(count * 2) ==
+                                        table->Size()));
+            usecs[mode] += ClockMonotonicUsec() - start;
+
+            client->EnqueueFlowFlush();
+            WAIT_FOR(count * 10, 1000, (0U == table->Size()));
+        }
+    }
+    EXPECT_GT(cache->hits(), 0U);
+    cache->set_enabled(true);
+
+    int flows = count * kRounds;
+    LOG(DEBUG, "Flow setup without route cache: " << flows << " flows in "
+        << usecs[0] << " usec");
+    LOG(DEBUG, "Flow setup with route cache   : " << flows << " flows in "
+        << usecs[1] << " usec");
+}
+
 int main(int argc, char *argv[]) {
     int ret = 0;
 
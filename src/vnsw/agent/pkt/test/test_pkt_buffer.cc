@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "base/os.h"
+#include "base/time_util.h"
+#include "test/test_cmn_util.h"
+#include "pkt/packet_buffer.h"
+
+void RouterIdDepInit(Agent *agent) {
+}
+
+class PacketBufferTest : public ::testing::Test {
+public:
+    PacketBufferTest() : mgr_(NULL) {
+    }
+
+protected:
+    PacketBufferManager mgr_;
+};
+
+// Buffers are allocated from the module pool and recycled on free
+TEST_F(PacketBufferTest, PoolAlloc) {
+    uint32_t slab_buffers = PacketBufferPool::kSlabBuffers;
+    const PacketBufferPool *pool = mgr_.pool(PktHandler::ARP);
+    EXPECT_EQ(0U, pool->buffers());
+
+    PacketBufferPtr buff(mgr_.Allocate(PktHandler::ARP, 128, 0));
+    EXPECT_EQ(slab_buffers, pool->buffers());
+    EXPECT_EQ(1U, pool->in_use());
+    EXPECT_EQ(128, buff->data_len());
+    EXPECT_EQ(1024, buff->buffer_len());
+    EXPECT_EQ((uint32_t)PktHandler::ARP, buff->module());
+
+    uint8_t *data = buff->data();
+    buff.reset();
+    EXPECT_EQ(0U, pool->in_use());
+    EXPECT_EQ(1U, mgr_.free_count());
+
+    buff = mgr_.Allocate(PktHandler::ARP, 64, 0);
+    EXPECT_TRUE(buff->data() == data);
+    EXPECT_EQ(64, buff->data_len());
+    EXPECT_EQ(slab_buffers, pool->buffers());
+    EXPECT_EQ(2U, pool->allocs());
+    EXPECT_EQ(0U, pool->alloc_fails());
+}
+
+// Allocation falls back to heap when the pool is exhausted or the length is
+// more than pool buffer length
+TEST_F(PacketBufferTest, PoolExhaust) {
+    uint16_t headroom = PacketBuffer::kHeadroom;
+    const PacketBufferPool *pool = mgr_.pool(PktHandler::DHCP);
+    std::vector<PacketBufferPtr> list;
+    for (uint32_t i = 0; i < pool->max_buffers(); i++) {
+        list.push_back(mgr_.Allocate(PktHandler::DHCP, 512, 0));
+        EXPECT_EQ(headroom, list.back()->headroom());
+    }
+    EXPECT_EQ(pool->max_buffers(), pool->buffers());
+    EXPECT_EQ(pool->max_buffers(), pool->in_use());
+
+    PacketBufferPtr buff(mgr_.Allocate(PktHandler::DHCP, 512, 0));
+    EXPECT_EQ(0, buff->headroom());
+    EXPECT_EQ(1U, pool->alloc_fails());
+
+    buff = mgr_.Allocate(PktHandler::DNS, PacketBuffer::kDefaultBufferLen + 1,
+                         0);
+    EXPECT_EQ(0, buff->headroom());
+    EXPECT_EQ(1U, mgr_.pool(PktHandler::DNS)->alloc_fails());
+
+    list.clear();
+    EXPECT_EQ(0U, pool->in_use());
+    EXPECT_EQ(pool->max_buffers(), pool->buffers());
+}
+
+// Headers are added in headroom ahead of data
+TEST_F(PacketBufferTest, Headroom) {
+    uint16_t headroom = PacketBuffer::kHeadroom;
+    PacketBufferPtr buff(mgr_.Allocate(PktHandler::ICMP, 100, 0));
+    uint8_t *data = buff->data();
+    EXPECT_TRUE(buff->SetOffset(20));
+    EXPECT_EQ(headroom + 20, buff->headroom());
+
+    uint8_t *hdr = buff->ReserveHeadroom(30);
+    EXPECT_TRUE(hdr == buff->data() - 30);
+    EXPECT_TRUE(buff->InHeadroom(hdr));
+    EXPECT_TRUE(buff->ReserveHeadroom(30) == NULL);
+    buff->ReleaseHeadroom();
+    EXPECT_TRUE(buff->ReserveHeadroom(30) == hdr);
+    buff->ReleaseHeadroom();
+
+    EXPECT_TRUE(buff->Push(headroom));
+    EXPECT_TRUE(buff->data() == data - headroom + 20);
+    EXPECT_EQ(100 + headroom - 20, buff->data_len());
+    EXPECT_FALSE(buff->Push(21));
+    EXPECT_TRUE(buff->Push(20));
+    EXPECT_EQ(0, buff->headroom());
+    EXPECT_TRUE(buff->ReserveHeadroom(1) == NULL);
+    buff->set_len(buff->buffer_len() + headroom);
+
+    PacketBufferPtr heap(mgr_.Allocate(PktHandler::ICMP, new uint8_t[100],
+                                       100, 0, 100, 0));
+    EXPECT_EQ(0, heap->headroom());
+    EXPECT_TRUE(heap->ReserveHeadroom(1) == NULL);
+}
+
+// Compare allocation from pool with allocation from heap
+TEST_F(PacketBufferTest, AllocBenchmark) {
+    uint32_t count = 1000000;
+    if (getenv("AGENT_PKT_BUFFER_COUNT")) {
+        count = strtoul(getenv("AGENT_PKT_BUFFER_COUNT"), NULL, 0);
+    }
+
+    uint64_t start = ClockMonotonicUsec();
+    for (uint32_t i = 0; i < count; i++) {
+        PacketBufferPtr buff(mgr_.Allocate(PktHandler::ARP, 128, 0));
+        buff->data()[0] = i;
+    }
+    uint64_t pool_usecs = ClockMonotonicUsec() - start;
+
+    start = ClockMonotonicUsec();
+    for (uint32_t i = 0; i < count; i++) {
+        PacketBufferPtr buff(mgr_.Allocate(PktHandler::ARP, new uint8_t[128],
+                                           128, 0, 128, 0));
+        buff->data()[0] = i;
+    }
+    uint64_t heap_usecs = ClockMonotonicUsec() - start;
+
+    EXPECT_EQ(0U, mgr_.pool(PktHandler::ARP)->in_use());
+    EXPECT_EQ(mgr_.alloc_count(), mgr_.free_count());
+    LOG(DEBUG, count << " allocations, pool " << pool_usecs << " usec, heap "
+        << heap_usecs << " usec");
+}
+
+int main(int argc, char *argv[]) {
+    int ret = 0;
+
+    GETUSERARGS();
+    client = TestInit(init_file, ksync_init, true, true, true, 100*1000);
+    ret = RUN_ALL_TESTS();
+    TestShutdown();
+    delete client;
+    return ret;
+}
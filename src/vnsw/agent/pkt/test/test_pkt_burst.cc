@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "base/os.h"
+#include "base/time_util.h"
+#include "test/test_cmn_util.h"
+#include "test_pkt_util.h"
+#include "pkt/flow_table.h"
+
+struct PortInfo input[] = {
+    {"vnet1", 1, "1.1.1.1", "00:00:01:01:01:01", 1, 1},
+};
+
+void RouterIdDepInit(Agent *agent) {
+}
+
+// pcap file format, packets trapped on pkt0 are ethernet frames with the
+// agent_hdr following the outer ethernet header
+struct PcapFileHdr {
+    uint32_t magic;
+    uint16_t version_major;
+    uint16_t version_minor;
+    int32_t thiszone;
+    uint32_t sigfigs;
+    uint32_t snaplen;
+    uint32_t linktype;
+};
+
+struct PcapPktHdr {
+    uint32_t ts_sec;
+    uint32_t ts_usec;
+    uint32_t caplen;
+    uint32_t len;
+};
+
+static const uint32_t kPcapMagic = 0xa1b2c3d4;
+static const uint32_t kPcapLinkTypeEthernet = 1;
+
+class PktBurstTest : public ::testing::Test {
+public:
+    virtual void SetUp() {
+        agent_ = Agent::GetInstance();
+        CreateVmportEnv(input, 1);
+        client->WaitForIdle();
+        WAIT_FOR(10000, 1000, VmPortActive(input, 0));
+
+        vnet_ = VmInterfaceGet(1);
+        boost::system::error_code ec;
+        Inet4TunnelRouteAdd(NULL, "vrf1",
+                            Ip4Address::from_string("5.0.0.0", ec),
+                            8, Ip4Address::from_string("1.1.1.2", ec),
+                            TunnelType::AllType(), 16, "TestVn",
+                            SecurityGroupList(), PathPreference());
+        client->WaitForIdle();
+        EXPECT_EQ(0U, agent_->pkt()->flow_table()->Size());
+    }
+
+    virtual void TearDown() {
+        FlushFlows();
+        boost::system::error_code ec;
+        InetUnicastAgentRouteTable::DeleteReq(NULL, "vrf1",
+                                Ip4Address::from_string("5.0.0.0", ec), 8,
+                                NULL);
+        DeleteVmportEnv(input, 1, 1);
+        client->WaitForIdle();
+    }
+
+    void FlushFlows() {
+        FlowTable *table = agent_->pkt()->flow_table();
+        int count = table->Size();
+        client->EnqueueFlowFlush();
+        WAIT_FOR(count * 10 + 1000, 1000, (0U == table->Size()));
+        client->WaitForIdle();
+    }
+
+    // Write a pcap of flow-miss packets from vnet1, a flow per packet
+    void WritePcap(const std::string &file, uint32_t count) {
+        FILE *fp = fopen(file.c_str(), "w");
+        ASSERT_TRUE(fp != NULL);
+        PcapFileHdr hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.magic = kPcapMagic;
+        hdr.version_major = 2;
+        hdr.version_minor = 4;
+        hdr.snaplen = ControlInterface::kMaxPacketSize;
+        hdr.linktype = kPcapLinkTypeEthernet;
+        fwrite(&hdr, sizeof(hdr), 1, fp);
+
+        for (uint32_t i = 0; i < count; i++) {
+            PktGen pkt;
+            Ip4Address dip(0x05000001 + (i % 16));
+            MakeTcpPacket(&pkt, vnet_->id(), "1.1.1.1",
+                          dip.to_string().c_str(), 1024 + (i % 60000), 80,
+                          false, 1, -1);
+            PcapPktHdr pkt_hdr;
+            pkt_hdr.ts_sec = i / 1000;
+            pkt_hdr.ts_usec = (i % 1000) * 1000;
+            pkt_hdr.caplen = pkt_hdr.len = pkt.GetBuffLen();
+            fwrite(&pkt_hdr, sizeof(pkt_hdr), 1, fp);
+            fwrite(pkt.GetBuff(), pkt.GetBuffLen(), 1, fp);
+        }
+        fclose(fp);
+    }
+
+    // Read packets of a pcap file into packets_
+    bool ReadPcap(const std::string &file) {
+        FILE *fp = fopen(file.c_str(), "r");
+        if (fp == NULL)
+            return false;
+        PcapFileHdr hdr;
+        if (fread(&hdr, sizeof(hdr), 1, fp) != 1 || hdr.magic != kPcapMagic ||
+            hdr.linktype != kPcapLinkTypeEthernet) {
+            fclose(fp);
+            return false;
+        }
+
+        packets_.clear();
+        PcapPktHdr pkt_hdr;
+        while (fread(&pkt_hdr, sizeof(pkt_hdr), 1, fp) == 1) {
+            if (pkt_hdr.caplen > ControlInterface::kMaxPacketSize)
+                break;
+            std::string pkt(pkt_hdr.caplen, '\0');
+            if (fread(&pkt[0], pkt_hdr.caplen, 1, fp) != 1)
+                break;
+            packets_.push_back(pkt);
+        }
+        fclose(fp);
+        return true;
+    }
+
+    // Packet as read by pkt0 into a receive buffer
+    PacketBufferPtr RxBuffer(const std::string &pkt) {
+        PacketBufferPtr buff(agent_->pkt()->packet_buffer_manager()->Allocate
+            (PktHandler::RX_PACKET, ControlInterface::kMaxPacketSize, 0));
+        memcpy(buff->data(), pkt.data(), pkt.size());
+        buff->set_len(pkt.size());
+        return buff;
+    }
+
+    // Replay packets_ through PktHandler. Returns time taken to parse and
+    // enqueue the packets
+    uint64_t Replay(bool burst) {
+        TestPkt0Interface *pkt0 = client->agent_init()->pkt0();
+        uint64_t start = ClockMonotonicUsec();
+        if (burst == false) {
+            for (std::vector<std::string>::const_iterator it =
+                 packets_.begin(); it != packets_.end(); ++it) {
+                pkt0->Process(RxBuffer(*it));
+            }
+            return ClockMonotonicUsec() - start;
+        }
+
+        PacketBufferPtr pkt[ControlInterface::kMaxBurst];
+        uint32_t count = 0;
+        for (std::vector<std::string>::const_iterator it = packets_.begin();
+             it != packets_.end(); ++it) {
+            pkt[count++] = RxBuffer(*it);
+            if (count == ControlInterface::kMaxBurst) {
+                pkt0->ProcessBurst(pkt, count);
+                count = 0;
+            }
+        }
+        if (count) {
+            pkt0->ProcessBurst(pkt, count);
+        }
+        return ClockMonotonicUsec() - start;
+    }
+
+    uint32_t FlowRcvd() const {
+        return agent_->pkt()->pkt_handler()->GetStats().received
+            [PktHandler::FLOW];
+    }
+
+protected:
+    Agent *agent_;
+    VmInterface *vnet_;
+    std::vector<std::string> packets_;
+};
+
+// Packets of a burst are parsed and enqueued to the flow module as a batch,
+// packets with invalid agent_hdr are dropped
+TEST_F(PktBurstTest, Burst) {
+    TestPkt0Interface *pkt0 = client->agent_init()->pkt0();
+    uint32_t flow_rcvd = FlowRcvd();
+    uint32_t err_count = agent_->stats()->pkt_invalid_agent_hdr();
+
+    PacketBufferPtr pkt[ControlInterface::kMaxBurst];
+    uint32_t count = 0;
+    for (; count < 8; count++) {
+        PktGen gen;
+        MakeTcpPacket(&gen, vnet_->id(), "1.1.1.1", "5.0.0.1", 1000 + count,
+                      80, false, 1, -1);
+        pkt[count] = RxBuffer(std::string(gen.GetBuff(), gen.GetBuffLen()));
+    }
+    pkt[count++] = RxBuffer(std::string(VrouterControlInterface::kAgentHdrLen,
+                                        '\0'));
+    pkt0->ProcessBurst(pkt, count);
+    client->WaitForIdle();
+
+    EXPECT_EQ(flow_rcvd + 8, FlowRcvd());
+    EXPECT_EQ(err_count + 1, agent_->stats()->pkt_invalid_agent_hdr());
+    WAIT_FOR(1000, 1000, (16U == agent_->pkt()->flow_table()->Size()));
+    EXPECT_TRUE(FlowGet(vnet_->vrf()->vrf_id(), "1.1.1.1", "5.0.0.1", 6,
+                        1000, 80, GetFlowKeyNH(1)) != NULL);
+}
+
+// Replay a pcap of flow-miss packets one packet at a time and in bursts.
+// AGENT_PKT_REPLAY_PCAP gives a pcap captured on pkt0 to replay in place of
+// the generated one, AGENT_PKT_REPLAY_COUNT the number of generated packets
+TEST_F(PktBurstTest, Replay) {
+    uint32_t count = 10000;
+    if (getenv("AGENT_PKT_REPLAY_COUNT")) {
+        count = strtoul(getenv("AGENT_PKT_REPLAY_COUNT"), NULL, 0);
+    }
+
+    // Captured pcap may have packets for other modules and interfaces
+    bool generated = (getenv("AGENT_PKT_REPLAY_PCAP") == NULL);
+    std::string file;
+    if (generated) {
+        char tmpl[] = "/tmp/flow_miss_XXXXXX";
+        int fd = mkstemp(tmpl);
+        ASSERT_TRUE(fd >= 0);
+        close(fd);
+        file = tmpl;
+        WritePcap(file, count);
+    } else {
+        file = getenv("AGENT_PKT_REPLAY_PCAP");
+    }
+    bool read = ReadPcap(file);
+    if (generated) {
+        unlink(file.c_str());
+        EXPECT_EQ(count, packets_.size());
+    }
+    ASSERT_TRUE(read);
+
+    uint64_t rx_usecs[2] = {0, 0};
+    uint64_t usecs[2] = {0, 0};
+    for (int mode = 0; mode < 2; mode++) {
+        uint32_t flow_rcvd = FlowRcvd();
+        uint64_t start = ClockMonotonicUsec();
+        rx_usecs[mode] = Replay(mode == 1);
+        client->WaitForIdle(10);
+        usecs[mode] = ClockMonotonicUsec() - start;
+        if (generated) {
+            EXPECT_EQ(flow_rcvd + packets_.size(), FlowRcvd());
+        }
+        FlushFlows();
+    }
+
+    LOG(DEBUG, "Per packet : " << packets_.size() << " packets, parse and "
+        "enqueue " << rx_usecs[0] << " usec, total " << usecs[0] << " usec");
+    LOG(DEBUG, "Burst of " << ControlInterface::kMaxBurst << " : "
+        << packets_.size() << " packets, parse and enqueue " << rx_usecs[1]
+        << " usec, total " << usecs[1] << " usec");
+}
+
+int main(int argc, char *argv[]) {
+    int ret = 0;
+
+    GETUSERARGS();
+    client = TestInit(init_file, ksync_init, true, true, true, 100*1000);
+    ret = RUN_ALL_TESTS();
+    TestShutdown();
+    delete client;
+    return ret;
+}
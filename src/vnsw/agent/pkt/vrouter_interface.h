@@ -107,8 +107,33 @@ public:
         return ControlInterface::Process(hdr, pkt);
     }
 
+    // Handle a burst of upto kMaxBurst packets. Packets with invalid agent_hdr
+    // are dropped
+    bool ProcessBurst(const PacketBufferPtr *pkt, uint32_t count) {
+        AgentHdr hdr[kMaxBurst];
+        PacketBufferPtr valid[kMaxBurst];
+        uint32_t valid_count = 0;
+
+        assert(count <= kMaxBurst);
+        for (uint32_t i = 0; i < count; i++) {
+            int agent_hdr_len = DecodeAgentHdr(&hdr[valid_count],
+                                               pkt[i]->data(),
+                                               pkt[i]->data_len());
+            if (agent_hdr_len <= 0) {
+                continue;
+            }
+
+            pkt[i]->SetOffset(agent_hdr_len);
+            valid[valid_count++] = pkt[i];
+        }
+
+        if (valid_count == 0)
+            return false;
+        return ControlInterface::ProcessBurst(hdr, valid, valid_count);
+    }
+
     int EncodeAgentHdr(uint8_t *buff, const AgentHdr &hdr) {
-        bzero(buff, sizeof(agent_hdr));
+        bzero(buff, kAgentHdrLen);
 
         // Add outer ethernet header
         struct ether_header *eth = (struct ether_header *)buff;
@@ -127,9 +152,14 @@ public:
 
     // Transmit packet on VrouterControlInterface.
     // Format of packet after encapsulation is OUTER_ETH - AGENT_HDR - PAYLOAD
+    // Headers are built in the headroom of packet if available. Send
+    // implementations must free agent_hdr_buff only if it is not in headroom
     virtual int Send(const AgentHdr &hdr, const PacketBufferPtr &pkt) {
         uint16_t agent_hdr_len = kAgentHdrLen;
-        uint8_t *agent_hdr_buff = new uint8_t [agent_hdr_len];
+        uint8_t *agent_hdr_buff = pkt->ReserveHeadroom(agent_hdr_len);
+        if (agent_hdr_buff == NULL) {
+            agent_hdr_buff = new uint8_t [agent_hdr_len];
+        }
         EncodeAgentHdr(agent_hdr_buff, hdr);
 
         int ret = Send(agent_hdr_buff, agent_hdr_len, pkt);
@@ -141,6 +171,15 @@ public:
 
     virtual int Send(uint8_t *buff, uint16_t buf_len,
                      const PacketBufferPtr &pkt) = 0;
+
+    // Free agent_hdr buffer given to Send once packet is transmitted
+    void FreeAgentHdr(const PacketBufferPtr &pkt, uint8_t *buff) {
+        if (pkt->InHeadroom(buff)) {
+            pkt->ReleaseHeadroom();
+        } else {
+            delete [] buff;
+        }
+    }
 private:
     AgentHdr::PktCommand VrCmdToAgentCmd(uint16_t vr_cmd) {
         AgentHdr::PktCommand cmd = AgentHdr::INVALID;
@@ -3,6 +3,7 @@
  */
 
 #include "base/os.h"
+#include "base/time_util.h"
 #include "testing/gunit.h"
 
 #include <sys/socket.h>
@@ -15,6 +16,7 @@
 #include <controller/controller_init.h>
 #include <controller/controller_vrf_export.h>
 #include <pkt/pkt_init.h>
+#include <pkt/packet_buffer.h>
 #include <services/services_init.h>
 #include <vrouter/ksync/ksync_init.h>
 #include <oper/vrf.h>
@@ -316,6 +318,37 @@ TEST_F(ArpTest, ArpReqTest) {
     arp_cache_sandesh->Release();
 }
 
+// Send ARP requests in bursts and report packets/sec handled along with
+// usage of the ARP buffer pool
+TEST_F(ArpTest, ArpThroughputTest) {
+    const uint32_t count = 2048;
+    const uint32_t burst = 32;
+    ArpProto *arp_proto = Agent::GetInstance()->GetArpProto();
+    const PacketBufferPool *pool = Agent::GetInstance()->pkt()->
+        packet_buffer_manager()->pool(PktHandler::ARP);
+    uint32_t arp_req = arp_proto->GetStats().arp_req;
+    uint64_t allocs = pool->allocs();
+    uint64_t alloc_fails = pool->alloc_fails();
+
+    uint64_t start = ClockMonotonicUsec();
+    for (uint32_t i = 0; i < count; i += burst) {
+        for (uint32_t j = 0; j < burst; j++) {
+            SendArpReq(req_ifindex, 0, src_ip, target_ip);
+        }
+        WAIT_FOR(1000, 100,
+                 (arp_proto->GetStats().arp_req == arp_req + i + burst));
+    }
+    uint64_t usecs = ClockMonotonicUsec() - start;
+
+    EXPECT_EQ(alloc_fails, pool->alloc_fails());
+    LOG(DEBUG, "ARP : " << count << " requests in " << usecs << " usec, "
+        << (count * 1000000ULL / (usecs + 1)) << " packets/sec, pool allocs "
+        << (pool->allocs() - allocs) << ", in use " << pool->in_use());
+
+    usleep(175000); // wait for retry timer to expire
+    WaitForCompletion(1);
+}
+
 TEST_F(ArpTest, ArpGratuitousTest) {
     for (int i = 0; i < 2; i++) {
         SendArpReq(req_ifindex, 0, ntohl(inet_addr(GRAT_IP)), 
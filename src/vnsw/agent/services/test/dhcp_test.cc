@@ -3,6 +3,7 @@
  */
 
 #include "base/os.h"
+#include "base/time_util.h"
 #include "testing/gunit.h"
 
 #include <sys/socket.h>
@@ -16,6 +17,7 @@
 #include <controller/controller_init.h>
 #include <controller/controller_vrf_export.h>
 #include <pkt/pkt_init.h>
+#include <pkt/packet_buffer.h>
 #include <services/services_init.h>
 #include <vrouter/ksync/ksync_init.h>
 #include <oper/vrf.h>
@@ -683,6 +685,59 @@ TEST_F(DhcpTest, DhcpReqTest) {
     Agent::GetInstance()->GetDhcpProto()->ClearStats();
 }
 
+// Send DHCP discover in bursts and report packets/sec handled along with
+// usage of the DHCP buffer pool
+TEST_F(DhcpTest, DhcpThroughputTest) {
+    struct PortInfo input[] = {
+        {"vnet1", 1, "1.1.1.1", "00:00:00:01:01:01", 1, 1},
+    };
+    uint8_t options[] = {
+        DHCP_OPTION_MSG_TYPE,
+        DHCP_OPTION_HOST_NAME,
+        DHCP_OPTION_END
+    };
+    IpamInfo ipam_info[] = {
+        {"1.1.1.0", 24, "1.1.1.200", true},
+    };
+    const uint32_t count = 2048;
+    const uint32_t burst = 32;
+
+    CreateVmportEnv(input, 1, 0);
+    client->WaitForIdle();
+    AddIPAM("vn1", ipam_info, 1);
+    client->WaitForIdle();
+
+    DhcpProto *dhcp_proto = Agent::GetInstance()->GetDhcpProto();
+    const PacketBufferPool *pool = Agent::GetInstance()->pkt()->
+        packet_buffer_manager()->pool(PktHandler::DHCP);
+    dhcp_proto->ClearStats();
+    uint64_t allocs = pool->allocs();
+    uint64_t alloc_fails = pool->alloc_fails();
+
+    uint64_t start = ClockMonotonicUsec();
+    for (uint32_t i = 0; i < count; i += burst) {
+        for (uint32_t j = 0; j < burst; j++) {
+            SendDhcp(GetItfId(0), 0x8000, DHCP_DISCOVER, options, 3);
+        }
+        WAIT_FOR(1000, 100, (dhcp_proto->GetStats().offers == i + burst));
+    }
+    uint64_t usecs = ClockMonotonicUsec() - start;
+
+    EXPECT_EQ(count, dhcp_proto->GetStats().discover);
+    EXPECT_EQ(alloc_fails, pool->alloc_fails());
+    LOG(DEBUG, "DHCP : " << count << " discover in " << usecs << " usec, "
+        << (count * 1000000ULL / (usecs + 1)) << " packets/sec, pool allocs "
+        << (pool->allocs() - allocs) << ", in use " << pool->in_use());
+
+    client->Reset();
+    DelIPAM("vn1");
+    client->WaitForIdle();
+    DeleteVmportEnv(input, 1, 1, 0);
+    client->WaitForIdle();
+
+    dhcp_proto->ClearStats();
+}
+
 TEST_F(DhcpTest, DhcpOtherReqTest) {
     struct PortInfo input[] = {
         {"vnet1", 1, "1.1.1.1", "00:00:00:01:01:01", 1, 1},
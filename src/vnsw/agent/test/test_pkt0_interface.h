@@ -109,7 +109,7 @@ public:
             LOG(ERROR, "Packet Test Tap Error <" <<
                 err.message() << "> sending packet");
         }
-        delete [] buff;
+        FreeAgentHdr(pkt, buff);
     }
 
     // Send from Agent
@@ -0,0 +1,344 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "base/os.h"
+#include <sys/time.h>
+#include <base/logging.h>
+#include <io/event_manager.h>
+#include <tbb/task.h>
+#include <base/task.h>
+
+#include <boost/bind.hpp>
+#include <pugixml/pugixml.hpp>
+
+#include "cfg/cfg_init.h"
+#include "oper/operdb_init.h"
+#include "controller/controller_init.h"
+#include "controller/controller_route_batch.h"
+#include "pkt/pkt_init.h"
+#include "services/services_init.h"
+#include "vrouter/ksync/ksync_init.h"
+#include "net/bgp_af.h"
+#include "xml/xml_pugi.h"
+#include "xmpp/xmpp_init.h"
+#include "xmpp/xmpp_proto.h"
+#include "test_cmn_util.h"
+
+using namespace std;
+using namespace autogen;
+
+void RouterIdDepInit(Agent *agent) {
+}
+
+static const char kFrom[] = "agent-a";
+static const char kTo[] = "network-control@contrailsystems.com/bgp-peer";
+
+static uint64_t TimeUsec() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (tv.tv_sec * 1000000ULL) + tv.tv_usec;
+}
+
+static string RouteAddress(int i) {
+    stringstream ss;
+    ss << "10." << ((i >> 16) & 0xFF) << "." << ((i >> 8) & 0xFF) << "."
+       << (i & 0xFF);
+    return ss.str();
+}
+
+static void BuildItem(int i, ItemType *item) {
+    item->entry.nlri.af = BgpAf::IPv4;
+    item->entry.nlri.safi = BgpAf::Unicast;
+    item->entry.nlri.address = RouteAddress(i) + "/32";
+
+    NextHopType nh;
+    nh.af = BgpAf::IPv4;
+    nh.address = "192.168.1.1";
+    nh.label = 16 + (i % 1000);
+    nh.tunnel_encapsulation_list.tunnel_encapsulation.push_back("gre");
+    nh.tunnel_encapsulation_list.tunnel_encapsulation.push_back("udp");
+    item->entry.next_hops.next_hop.push_back(nh);
+    item->entry.security_group_list.security_group.push_back(8000001);
+    item->entry.version = 1;
+    item->entry.virtual_network = "default-domain:admin:vn<1>&";
+    item->entry.sequence_number = i;
+    item->entry.local_preference = 100;
+}
+
+static string NodeId(const string &vrf, int i) {
+    stringstream ss;
+    ss << BgpAf::IPv4 << "/" << BgpAf::Unicast << "/" << vrf << "/"
+       << RouteAddress(i);
+    return ss.str();
+}
+
+// Per route publish and collection, as built by
+// AgentXmppChannel::ControllerSendV4V6UnicastRouteCommon without batching
+static size_t PublishWithDom(const string &vrf, int i, const ItemType &item,
+                             uint8_t *data, size_t size,
+                             string *publish = NULL) {
+    static int id = 0;
+    auto_ptr<XmlBase> impl(XmppStanza::AllocXmppXmlImpl());
+    XmlPugi *pugi = reinterpret_cast<XmlPugi *>(impl.get());
+
+    pugi->AddNode("iq", "");
+    pugi->AddAttribute("type", "set");
+    pugi->AddAttribute("from", kFrom);
+    pugi->AddAttribute("to", kTo);
+    stringstream pubsub_id;
+    pubsub_id << "pubsub" << id;
+    pugi->AddAttribute("id", pubsub_id.str());
+    pugi->AddChildNode("pubsub", "");
+    pugi->AddAttribute("xmlns", "http://jabber.org/protocol/pubsub");
+    pugi->AddChildNode("publish", "");
+    string node_id(NodeId(vrf, i));
+    pugi->AddAttribute("node", node_id);
+    pugi->AddChildNode("item", "");
+    pugi::xml_node node = pugi->FindNode("item");
+    item.Encode(&node);
+    size_t len = XmppProto::EncodeMessage(impl.get(), data, size);
+    if (publish)
+        publish->assign(reinterpret_cast<char *>(data), len);
+
+    pugi->DeleteNode("pubsub");
+    pugi->ReadNode("iq");
+    stringstream collection_id;
+    collection_id << "collection" << id++;
+    pugi->ModifyAttribute("id", collection_id.str());
+    pugi->AddChildNode("pubsub", "");
+    pugi->AddAttribute("xmlns", "http://jabber.org/protocol/pubsub");
+    pugi->AddChildNode("collection", "");
+    pugi->AddAttribute("node", vrf);
+    pugi->AddChildNode("associate", "");
+    pugi->AddAttribute("node", node_id);
+    len += XmppProto::EncodeMessage(impl.get(), data, size);
+    return len;
+}
+
+class XmppRouteBatchTest : public ::testing::Test {
+protected:
+    XmppRouteBatchTest() : agent_(Agent::GetInstance()), bytes_(0) {
+    }
+
+    // Batches are sent by the test, unless the timer is asked for
+    virtual void SetUp() {
+        CreateBatch(3600 * 1000);
+    }
+
+    void CreateBatch(int flush_interval_msec) {
+        batch_.reset(new ControllerRouteBatch(agent_->event_manager(),
+            boost::bind(&XmppRouteBatchTest::Send, this, _1, _2),
+            flush_interval_msec));
+        batch_->SetJids(kFrom, kTo);
+    }
+
+    virtual void TearDown() {
+        batch_.reset();
+    }
+
+    bool Send(uint8_t *msg, size_t size) {
+        tbb::mutex::scoped_lock lock(mutex_);
+        bytes_ += size;
+        messages_.push_back(string(reinterpret_cast<char *>(msg), size));
+        return true;
+    }
+
+    size_t MessageCount() {
+        tbb::mutex::scoped_lock lock(mutex_);
+        return messages_.size();
+    }
+
+    // Parses a publish and the collection following it, returns the items
+    // of the publish
+    void ParsePublish(size_t index, const string &vrf, bool associate,
+                      vector<ItemType> *items) {
+        auto_ptr<XmlBase> impl(XmppStanza::AllocXmppXmlImpl());
+        XmlPugi *pugi = reinterpret_cast<XmlPugi *>(impl.get());
+        EXPECT_EQ(0, pugi->LoadDoc(messages_[index]));
+        pugi::xml_node publish = pugi->FindNode("publish");
+        ASSERT_TRUE(publish);
+        string node_id(publish.attribute("node").value());
+        for (pugi::xml_node item = publish.first_child(); item;
+             item = item.next_sibling()) {
+            EXPECT_STREQ("item", item.name());
+            ItemType parsed;
+            EXPECT_TRUE(parsed.XmlParse(item));
+            items->push_back(parsed);
+        }
+
+        impl.reset(XmppStanza::AllocXmppXmlImpl());
+        pugi = reinterpret_cast<XmlPugi *>(impl.get());
+        EXPECT_EQ(0, pugi->LoadDoc(messages_[index + 1]));
+        pugi::xml_node collection = pugi->FindNode("collection");
+        ASSERT_TRUE(collection);
+        EXPECT_EQ(vrf, collection.attribute("node").value());
+        pugi::xml_node op =
+            collection.child(associate ? "associate" : "dissociate");
+        ASSERT_TRUE(op);
+        EXPECT_EQ(node_id, op.attribute("node").value());
+    }
+
+    Agent *agent_;
+    boost::scoped_ptr<ControllerRouteBatch> batch_;
+    tbb::mutex mutex_;
+    vector<string> messages_;
+    size_t bytes_;
+};
+
+static void ExpectItemEq(const ItemType &lhs, const ItemType &rhs) {
+    EXPECT_EQ(lhs.entry.nlri.af, rhs.entry.nlri.af);
+    EXPECT_EQ(lhs.entry.nlri.safi, rhs.entry.nlri.safi);
+    EXPECT_EQ(lhs.entry.nlri.address, rhs.entry.nlri.address);
+    ASSERT_EQ(lhs.entry.next_hops.next_hop.size(),
+              rhs.entry.next_hops.next_hop.size());
+    for (size_t i = 0; i < lhs.entry.next_hops.next_hop.size(); i++) {
+        const NextHopType &l = lhs.entry.next_hops.next_hop[i];
+        const NextHopType &r = rhs.entry.next_hops.next_hop[i];
+        EXPECT_EQ(l.af, r.af);
+        EXPECT_EQ(l.address, r.address);
+        EXPECT_EQ(l.label, r.label);
+        EXPECT_TRUE(l.tunnel_encapsulation_list.tunnel_encapsulation ==
+                    r.tunnel_encapsulation_list.tunnel_encapsulation);
+    }
+    EXPECT_TRUE(lhs.entry.security_group_list.security_group ==
+                rhs.entry.security_group_list.security_group);
+    EXPECT_EQ(lhs.entry.version, rhs.entry.version);
+    EXPECT_EQ(lhs.entry.virtual_network, rhs.entry.virtual_network);
+    EXPECT_EQ(lhs.entry.sequence_number, rhs.entry.sequence_number);
+    EXPECT_EQ(lhs.entry.local_preference, rhs.entry.local_preference);
+    EXPECT_EQ(lhs.entry.med, rhs.entry.med);
+}
+
+// Items of a batch parse back the same as the items encoded with the DOM
+TEST_F(XmppRouteBatchTest, EncodeItem) {
+    for (int i = 0; i < 4; i++) {
+        ItemType item;
+        BuildItem(i, &item);
+        batch_->AddRoute("vrf1", NodeId("vrf1", 0), item, true);
+    }
+    batch_->Flush();
+    ASSERT_EQ(2U, messages_.size());
+
+    vector<ItemType> items;
+    ParsePublish(0, "vrf1", true, &items);
+    ASSERT_EQ(4U, items.size());
+
+    uint8_t data[4096];
+    for (int i = 0; i < 4; i++) {
+        ItemType item;
+        BuildItem(i, &item);
+        ExpectItemEq(item, items[i]);
+
+        string publish;
+        PublishWithDom("vrf1", i, item, data, sizeof(data), &publish);
+        auto_ptr<XmlBase> impl(XmppStanza::AllocXmppXmlImpl());
+        XmlPugi *pugi = reinterpret_cast<XmlPugi *>(impl.get());
+        EXPECT_EQ(0, pugi->LoadDoc(publish));
+        ItemType dom_item;
+        EXPECT_TRUE(dom_item.XmlParse(pugi->FindNode("item")));
+        ExpectItemEq(dom_item, items[i]);
+    }
+}
+
+// A batch is sent when the VRF or the operation changes, before any other
+// message, and when it is full
+TEST_F(XmppRouteBatchTest, Flush) {
+    ItemType item;
+    BuildItem(1, &item);
+    batch_->AddRoute("vrf1", NodeId("vrf1", 1), item, true);
+    batch_->AddRoute("vrf1", NodeId("vrf1", 1), item, true);
+    batch_->AddRoute("vrf2", NodeId("vrf2", 1), item, true);
+    batch_->AddRoute("vrf2", NodeId("vrf2", 1), item, false);
+    EXPECT_EQ(4U, MessageCount());
+
+    string subscribe("<iq type=\"set\"/>");
+    batch_->Send(reinterpret_cast<uint8_t *>(&subscribe[0]),
+                 subscribe.size());
+    ASSERT_EQ(7U, MessageCount());
+    EXPECT_EQ(0U, batch_->pending());
+    EXPECT_EQ(subscribe, messages_[6]);
+
+    vector<ItemType> items;
+    ParsePublish(0, "vrf1", true, &items);
+    EXPECT_EQ(2U, items.size());
+    items.clear();
+    ParsePublish(2, "vrf2", true, &items);
+    EXPECT_EQ(1U, items.size());
+    items.clear();
+    ParsePublish(4, "vrf2", false, &items);
+    EXPECT_EQ(1U, items.size());
+
+    messages_.clear();
+    for (size_t i = 0; i < ControllerRouteBatch::kMaxItems; i++) {
+        batch_->AddRoute("vrf1", NodeId("vrf1", i), item, true);
+    }
+    EXPECT_EQ(2U, MessageCount());
+    EXPECT_EQ(0U, batch_->pending());
+}
+
+// Pending routes go out on the batch timer
+TEST_F(XmppRouteBatchTest, FlushTimer) {
+    CreateBatch(ControllerRouteBatch::kFlushIntervalMsec);
+    ItemType item;
+    BuildItem(1, &item);
+    batch_->AddRoute("vrf1", NodeId("vrf1", 1), item, true);
+    WAIT_FOR(1000, 1000, (MessageCount() == 2));
+    EXPECT_EQ(0U, batch_->pending());
+}
+
+// Time to publish 50k routes of a VRF, one publish and collection per route
+// through the DOM against batched stanzas encoded straight to text
+TEST_F(XmppRouteBatchTest, Publish50kRoutes) {
+    const int kRoutes = 50000;
+    vector<ItemType> items(kRoutes);
+    for (int i = 0; i < kRoutes; i++) {
+        BuildItem(i, &items[i]);
+    }
+
+    uint8_t data[4096];
+    size_t dom_bytes = 0;
+    uint64_t start = TimeUsec();
+    for (int i = 0; i < kRoutes; i++) {
+        dom_bytes += PublishWithDom("vrf1", i, items[i], data, sizeof(data));
+    }
+    uint64_t dom_usec = TimeUsec() - start;
+
+    start = TimeUsec();
+    for (int i = 0; i < kRoutes; i++) {
+        batch_->AddRoute("vrf1", NodeId("vrf1", i), items[i], true);
+    }
+    batch_->Flush();
+    uint64_t batch_usec = TimeUsec() - start;
+
+    size_t batches = (kRoutes + ControllerRouteBatch::kMaxItems - 1) /
+        ControllerRouteBatch::kMaxItems;
+    EXPECT_EQ(2 * batches, MessageCount());
+    EXPECT_EQ((uint64_t)kRoutes, batch_->routes());
+
+    size_t routes = 0;
+    for (size_t i = 0; i < messages_.size(); i += 2) {
+        vector<ItemType> parsed;
+        ParsePublish(i, "vrf1", true, &parsed);
+        routes += parsed.size();
+    }
+    EXPECT_EQ((size_t)kRoutes, routes);
+
+    cout << "Publish " << kRoutes << " routes" << endl;
+    cout << "  per route dom : " << dom_usec / 1000 << " msec, "
+         << 2 * kRoutes << " messages, " << dom_bytes << " bytes" << endl;
+    cout << "  batched       : " << batch_usec / 1000 << " msec, "
+         << MessageCount() << " messages, " << bytes_ << " bytes" << endl;
+    EXPECT_LT(batch_usec, dom_usec);
+}
+
+int main(int argc, char **argv) {
+    GETUSERARGS();
+
+    client = TestInit(init_file, ksync_init);
+    int ret = RUN_ALL_TESTS();
+    client->WaitForIdle();
+    TestShutdown();
+    delete client;
+    return ret;
+}
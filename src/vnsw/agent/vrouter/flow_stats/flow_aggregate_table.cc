@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <vrouter/flow_stats/flow_aggregate_table.h>
+
+const uint32_t FlowAggregateTable::kDefaultSize;
+const uint16_t FlowAggregateTable::kDefaultPortBucket;
+
+FlowAggregateTable::FlowAggregateTable(uint32_t size, uint16_t port_bucket) :
+    port_bucket_(port_bucket ? port_bucket : 1) {
+    uint32_t slots = 16;
+    while (slots < size && slots < (1U << 31)) {
+        slots <<= 1;
+    }
+    entries_.resize(slots);
+    mask_ = slots - 1;
+    // Keep probe sequences short, fill up to 3/4 of the slots
+    max_count_ = slots - slots / 4;
+    used_.reserve(max_count_);
+}
+
+FlowAggregateTable::~FlowAggregateTable() {
+}
+
+// FNV-1a over the key fields
+uint32_t FlowAggregateTable::Hash(const std::string &source_vn,
+                                  const std::string &dest_vn,
+                                  uint8_t protocol, uint16_t dport,
+                                  bool ingress) {
+    uint32_t hash = 2166136261U;
+    for (std::string::const_iterator it = source_vn.begin();
+         it != source_vn.end(); ++it) {
+        hash = (hash ^ (uint8_t)*it) * 16777619U;
+    }
+    hash = (hash ^ 0xFF) * 16777619U;
+    for (std::string::const_iterator it = dest_vn.begin();
+         it != dest_vn.end(); ++it) {
+        hash = (hash ^ (uint8_t)*it) * 16777619U;
+    }
+    hash = (hash ^ protocol) * 16777619U;
+    hash = (hash ^ (dport & 0xFF)) * 16777619U;
+    hash = (hash ^ (dport >> 8)) * 16777619U;
+    hash = (hash ^ (ingress ? 1 : 0)) * 16777619U;
+    return hash;
+}
+
+bool FlowAggregateTable::Add(const std::string &source_vn,
+                             const std::string &dest_vn, uint8_t protocol,
+                             uint16_t dport, bool ingress, uint64_t bytes,
+                             uint64_t packets) {
+    dport = dport - (dport % port_bucket_);
+    uint32_t hash = Hash(source_vn, dest_vn, protocol, dport, ingress);
+    uint32_t idx = hash & mask_;
+    while (entries_[idx].used) {
+        Entry &entry = entries_[idx];
+        if (entry.hash == hash && entry.dport == dport &&
+            entry.protocol == protocol && entry.ingress == ingress &&
+            entry.source_vn == source_vn && entry.dest_vn == dest_vn) {
+            entry.bytes += bytes;
+            entry.packets += packets;
+            entry.flows++;
+            return true;
+        }
+        idx = (idx + 1) & mask_;
+    }
+
+    if (used_.size() >= max_count_) {
+        return false;
+    }
+    Entry &entry = entries_[idx];
+    entry.source_vn.assign(source_vn);
+    entry.dest_vn.assign(dest_vn);
+    entry.dport = dport;
+    entry.protocol = protocol;
+    entry.ingress = ingress;
+    entry.used = true;
+    entry.hash = hash;
+    entry.bytes = bytes;
+    entry.packets = packets;
+    entry.flows = 1;
+    used_.push_back(idx);
+    return true;
+}
+
+void FlowAggregateTable::Walk(Visitor visitor) const {
+    for (std::vector<uint32_t>::const_iterator it = used_.begin();
+         it != used_.end(); ++it) {
+        visitor(entries_[*it]);
+    }
+}
+
+void FlowAggregateTable::Clear() {
+    for (std::vector<uint32_t>::const_iterator it = used_.begin();
+         it != used_.end(); ++it) {
+        entries_[*it].used = false;
+    }
+    used_.clear();
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+#ifndef __AGENT_FLOW_AGGREGATE_TABLE_H__
+#define __AGENT_FLOW_AGGREGATE_TABLE_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <boost/function.hpp>
+
+// Rolls up flow stats into aggregates of (source-vn, dest-vn, protocol,
+// destination port bucket, direction) for an export interval.
+//
+// The table is an open addressed hash with a fixed number of slots
+// allocated upfront. Slots are reused across intervals, VN names are copied
+// into strings that keep their capacity, so the table does not allocate
+// once it has been warmed up. Add fails when the table is filled to its load
+// limit, the caller is expected to export and clear the table and add again.
+class FlowAggregateTable {
+public:
+    static const uint32_t kDefaultSize = 16 * 1024;
+    static const uint16_t kDefaultPortBucket = 1;
+
+    struct Entry {
+        Entry() :
+            dport(0), protocol(0), ingress(false), used(false), hash(0),
+            bytes(0), packets(0), flows(0) {
+        }
+        std::string source_vn;
+        std::string dest_vn;
+        // First port of the bucket
+        uint16_t dport;
+        uint8_t protocol;
+        bool ingress;
+        bool used;
+        uint32_t hash;
+        uint64_t bytes;
+        uint64_t packets;
+        // Flow updates rolled up into the aggregate
+        uint32_t flows;
+    };
+    typedef boost::function<void(const Entry &)> Visitor;
+
+    // size is rounded up to a power of 2, port_bucket of 0 is taken as 1
+    FlowAggregateTable(uint32_t size, uint16_t port_bucket);
+    ~FlowAggregateTable();
+
+    bool Add(const std::string &source_vn, const std::string &dest_vn,
+             uint8_t protocol, uint16_t dport, bool ingress, uint64_t bytes,
+             uint64_t packets);
+    // Visits the aggregates in the order they were created
+    void Walk(Visitor visitor) const;
+    void Clear();
+
+    uint32_t size() const { return entries_.size(); }
+    uint32_t count() const { return used_.size(); }
+    uint16_t port_bucket() const { return port_bucket_; }
+    bool empty() const { return used_.empty(); }
+
+private:
+    static uint32_t Hash(const std::string &source_vn,
+                         const std::string &dest_vn, uint8_t protocol,
+                         uint16_t dport, bool ingress);
+
+    std::vector<Entry> entries_;
+    // Indexes of used slots, walk and clear do not look at free slots
+    std::vector<uint32_t> used_;
+    uint32_t mask_;
+    uint32_t max_count_;
+    uint16_t port_bucket_;
+};
+
+#endif //  __AGENT_FLOW_AGGREGATE_TABLE_H__
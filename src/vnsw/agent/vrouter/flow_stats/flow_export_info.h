@@ -63,6 +63,10 @@ public:
     void set_tcp_flags(uint16_t tflags) {
         tcp_flags_ = tflags;
     }
+    uint64_t delete_enqueue_time() const { return delete_enqueue_time_; }
+    void set_delete_enqueue_time(uint64_t time) {
+        delete_enqueue_time_ = time;
+    }
 private:
     boost::uuids::uuid flow_uuid_;
     boost::uuids::uuid egress_uuid_; // used/applicable only for local flows
@@ -94,6 +98,8 @@ private:
     boost::uuids::uuid interface_uuid_;
     std::string drop_reason_;
     uint16_t tcp_flags_;
+    //Time the delete of the flow was enqueued, 0 if none is pending
+    uint64_t delete_enqueue_time_;
 };
 
 #endif //  __AGENT_FLOW_EXPORT_INFO_H__
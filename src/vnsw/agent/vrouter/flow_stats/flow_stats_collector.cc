@@ -47,8 +47,11 @@ FlowStatsCollector::FlowStatsCollector(boost::asio::io_service &io, int intvl,
         flow_export_count_(0), prev_flow_export_rate_compute_time_(0),
         flow_export_rate_(0), threshold_(kDefaultFlowSamplingThreshold),
         flow_export_msg_drops_(0), prev_cfg_flow_export_rate_(0),
-        msg_list_(kMaxFlowMsgsPerSend, FlowDataIpv4()), msg_index_(0) {
+        msg_list_(kMaxFlowMsgsPerSend, FlowDataIpv4()), msg_index_(0),
+        sequential_scan_(false), unmapped_walk_(false), aggregate_interval_(0),
+        aggregate_start_time_(0), aggregate_export_count_(0) {
         flow_iteration_key_.Reset();
+        unmapped_iteration_key_.Reset();
         flow_default_interval_ = intvl;
         if (flow_cache_timeout) {
             // Convert to usec
@@ -296,55 +299,133 @@ void FlowStatsCollector::FlowDeleteEnqueue(const FlowKey &key, bool rev) {
         FlowEvent(FlowTableRequest::DELETE_FLOW, NULL, key, rev);
 }
 
-bool FlowStatsCollector::Run() {
+// Marks the flow, and its reverse flow when rev_info is set, as being
+// deleted so that the scan does not enqueue their delete again
+void FlowStatsCollector::SetFlowDeletePending(FlowExportInfo *info,
+                                              FlowExportInfo *rev_info,
+                                              uint64_t curr_time) {
+    info->set_delete_enqueue_time(curr_time);
+    if (rev_info) {
+        rev_info->set_delete_enqueue_time(curr_time);
+    }
+}
+
+// A pending delete is enqueued again if the flow is still present after an
+// aging interval, in case the flow table did not delete it
+bool FlowStatsCollector::FlowDeletePending(const FlowExportInfo *info,
+                                           uint64_t curr_time) const {
+    return info->delete_enqueue_time() != 0 &&
+        curr_time - info->delete_enqueue_time() < flow_age_time_intvl_;
+}
+
+// Ages, exports or deletes the flow as per the kernel flow k_flow, NULL when
+// the kernel flow is not active. Returns true if delete of the flow is
+// enqueued, rev_info is set when the reverse flow is deleted along with it.
+bool FlowStatsCollector::EvaluateFlow(const FlowKey &key, FlowExportInfo *info,
+                                      const vr_flow_entry *k_flow,
+                                      uint64_t curr_time,
+                                      FlowExportInfo **rev_info) {
+    FlowTableKSyncObject *ksync_obj =
+        agent_uve_->agent()->ksync()->flowtable_ksync_obj();
+    uint64_t diff_bytes, diff_pkts;
+
+    *rev_info = NULL;
+    if (FlowDeletePending(info, curr_time)) {
+        return true;
+    }
+
+    // Can the flow be aged?
+    if (ShouldBeAged(info, k_flow, curr_time, key)) {
+        bool deleted = true;
+        FlowExportInfo *rev = FindFlowExportInfo(info->rev_flow_key());
+        // If reverse_flow is present, wait till both are aged
+        if (rev) {
+            const vr_flow_entry *k_flow_rev;
+            k_flow_rev = ksync_obj->GetKernelFlowEntry
+                (rev->flow_handle(), false);
+            deleted = ShouldBeAged(rev, k_flow_rev, curr_time,
+                                   info->rev_flow_key());
+        }
+        if (deleted) {
+            *rev_info = rev;
+            SetFlowDeletePending(info, rev, curr_time);
+            FlowDeleteEnqueue(key, rev != NULL? true : false);
+            return true;
+        }
+    }
+
+    if (k_flow) {
+        uint64_t k_bytes, bytes;
+        k_bytes = GetFlowStats(k_flow->fe_stats.flow_bytes_oflow,
+                               k_flow->fe_stats.flow_bytes);
+        bytes = 0x0000ffffffffffffULL & info->bytes();
+        /* Always copy udp source port even though vrouter does not change
+         * it. Vrouter many change this behavior and recompute source port
+         * whenever flow action changes. To keep agent independent of this,
+         * always copy UDP source port */
+        info->set_underlay_source_port(k_flow->fe_udp_src_port);
+        info->set_tcp_flags(k_flow->fe_tcp_flags);
+        /* Don't account for agent overflow bits while comparing change in
+         * stats */
+        if (bytes != k_bytes) {
+            uint64_t packets, k_packets;
+
+            k_packets = GetFlowStats(k_flow->fe_stats.flow_packets_oflow,
+                                     k_flow->fe_stats.flow_packets);
+            bytes = GetUpdatedFlowBytes(info, k_bytes);
+            packets = GetUpdatedFlowPackets(info, k_packets);
+            diff_bytes = bytes - info->bytes();
+            diff_pkts = packets - info->packets();
+            //Update Inter-VN stats
+            UpdateInterVnStats(info, diff_bytes, diff_pkts);
+            //Update Floating-IP stats
+            UpdateFloatingIpStats(info, diff_bytes, diff_pkts);
+            info->set_bytes(bytes);
+            info->set_packets(packets);
+            info->set_last_modified_time(curr_time);
+            ExportFlow(key, info, diff_bytes, diff_pkts);
+        } else if (!info->exported()) {
+            /* export flow (reverse) for which traffic is not seen yet. */
+            ExportFlow(key, info, 0, 0);
+        }
+    }
+
+    if ((delete_short_flow_ == true) &&
+        info->is_flags_set(FlowEntry::ShortFlow)) {
+        *rev_info = FindFlowExportInfo(info->rev_flow_key());
+        SetFlowDeletePending(info, *rev_info, curr_time);
+        FlowDeleteEnqueue(key, true);
+        return true;
+    }
+    return false;
+}
+
+// Walks flow_tree_ in key order from flow_iteration_key_, reading the
+// kernel flow of every flow at random
+void FlowStatsCollector::WalkFlowTree(uint64_t curr_time) {
     FlowEntryTree::iterator it;
     FlowExportInfo *rev_info = NULL;
     FlowExportInfo *info = NULL;
     uint32_t count = 0;
-    bool key_updation_reqd = true, deleted;
-    uint64_t diff_bytes, diff_pkts;
-    Agent *agent = agent_uve_->agent();
-    FlowTable *flow_obj = agent->pkt()->flow_table();
+    bool key_updation_reqd = true;
     FlowKey key;
 
-    run_counter_++;
-    if (!flow_tree_.size()) {
-        return true;
-    }
-    uint64_t curr_time = UTCTimestampUsec();
     it = flow_tree_.upper_bound(flow_iteration_key_);
     if (it == flow_tree_.end()) {
         it = flow_tree_.begin();
     }
-    FlowTableKSyncObject *ksync_obj = agent->ksync()->flowtable_ksync_obj();
+    FlowTableKSyncObject *ksync_obj =
+        agent_uve_->agent()->ksync()->flowtable_ksync_obj();
 
     while (it != flow_tree_.end()) {
         key = it->first;
         info = &it->second;
         it++;
-        deleted = false;
 
         flow_iteration_key_ = it->first;
         const vr_flow_entry *k_flow = ksync_obj->GetKernelFlowEntry
             (info->flow_handle(), false);
-        // Can the flow be aged?
-        if (ShouldBeAged(info, k_flow, curr_time, key)) {
-            rev_info = FindFlowExportInfo(info->rev_flow_key());
-            // If reverse_flow is present, wait till both are aged
-            if (rev_info) {
-                const vr_flow_entry *k_flow_rev;
-                k_flow_rev = ksync_obj->GetKernelFlowEntry
-                    (rev_info->flow_handle(), false);
-                if (ShouldBeAged(rev_info, k_flow_rev, curr_time,
-                                 info->rev_flow_key())) {
-                    deleted = true;
-                }
-            } else {
-                deleted = true;
-            }
-        }
-
-        if (deleted == true) {
+        if (EvaluateFlow(key, info, k_flow, curr_time, &rev_info)) {
             if (it != flow_tree_.end()) {
                 FlowKey next_flow_key = it->first;
                 FlowKey del_flow_key = info->rev_flow_key();
@@ -352,61 +433,6 @@ bool FlowStatsCollector::Run() {
                     it++;
                 }
             }
-            FlowDeleteEnqueue(key, rev_info != NULL? true : false);
-            if (rev_info) {
-                count++;
-                if (count == flow_count_per_pass_) {
-                    break;
-                }
-            }
-        }
-
-        if (deleted == false && k_flow) {
-            uint64_t k_bytes, bytes;
-            k_bytes = GetFlowStats(k_flow->fe_stats.flow_bytes_oflow,
-                                   k_flow->fe_stats.flow_bytes);
-            bytes = 0x0000ffffffffffffULL & info->bytes();
-            /* Always copy udp source port even though vrouter does not change
-             * it. Vrouter many change this behavior and recompute source port
-             * whenever flow action changes. To keep agent independent of this,
-             * always copy UDP source port */
-            info->set_underlay_source_port(k_flow->fe_udp_src_port);
-            info->set_tcp_flags(k_flow->fe_tcp_flags);
-            /* Don't account for agent overflow bits while comparing change in
-             * stats */
-            if (bytes != k_bytes) {
-                uint64_t packets, k_packets;
-
-                k_packets = GetFlowStats(k_flow->fe_stats.flow_packets_oflow,
-                                         k_flow->fe_stats.flow_packets);
-                bytes = GetUpdatedFlowBytes(info, k_bytes);
-                packets = GetUpdatedFlowPackets(info, k_packets);
-                diff_bytes = bytes - info->bytes();
-                diff_pkts = packets - info->packets();
-                //Update Inter-VN stats
-                UpdateInterVnStats(info, diff_bytes, diff_pkts);
-                //Update Floating-IP stats
-                UpdateFloatingIpStats(info, diff_bytes, diff_pkts);
-                info->set_bytes(bytes);
-                info->set_packets(packets);
-                info->set_last_modified_time(curr_time);
-                ExportFlow(key, info, diff_bytes, diff_pkts);
-            } else if (!info->exported()) {
-                /* export flow (reverse) for which traffic is not seen yet. */
-                ExportFlow(key, info, 0, 0);
-            }
-        }
-
-        if ((!deleted) && (delete_short_flow_ == true) &&
-            info->is_flags_set(FlowEntry::ShortFlow)) {
-            if (it != flow_tree_.end()) {
-                FlowKey next_flow_key =  it->first;
-                FlowKey del_flow_key = info->rev_flow_key();
-                if (next_flow_key.IsEqual(del_flow_key)) {
-                    it++;
-                }
-            }
-            FlowDeleteEnqueue(key, true);
             if (rev_info) {
                 count++;
                 if (count == flow_count_per_pass_) {
@@ -421,9 +447,6 @@ bool FlowStatsCollector::Run() {
         }
     }
 
-    //Send any pending flow export messages
-    DispatchPendingFlowMsg();
-
     if (count == flow_count_per_pass_) {
         if (it != flow_tree_.end()) {
             key_updation_reqd = false;
@@ -434,6 +457,137 @@ bool FlowStatsCollector::Run() {
     if (key_updation_reqd) {
         flow_iteration_key_.Reset();
     }
+}
+
+bool FlowStatsCollector::IsScanIndex(uint32_t idx) const {
+    return idx != FlowEntry::kInvalidFlowHandle && idx < scan_flows_.size();
+}
+
+void FlowStatsCollector::MapFlowIndex(FlowEntryTree::value_type *entry) {
+    uint32_t idx = entry->second.flow_handle();
+    if (!IsScanIndex(idx)) {
+        return;
+    }
+    scan_flows_[idx] = entry;
+    scan_.Map(idx);
+}
+
+// Index of a deleted flow may already be taken by a new flow, the slot is
+// released only if it still refers to entry
+void FlowStatsCollector::UnmapFlowIndex(FlowEntryTree::value_type *entry) {
+    uint32_t idx = entry->second.flow_handle();
+    if (!IsScanIndex(idx) || scan_flows_[idx] != entry) {
+        return;
+    }
+    scan_flows_[idx] = NULL;
+    scan_.Unmap(idx);
+}
+
+void FlowStatsCollector::InitFlowScan(uint32_t size) {
+    scan_.Reset(size);
+    std::vector<FlowEntryTree::value_type *>(size, NULL).swap(scan_flows_);
+    for (FlowEntryTree::iterator it = flow_tree_.begin();
+         it != flow_tree_.end(); ++it) {
+        MapFlowIndex(&(*it));
+    }
+}
+
+void FlowStatsCollector::ScanVisit(uint32_t idx, const vr_flow_entry *k_flow,
+                                   uint64_t curr_time) {
+    FlowEntryTree::value_type *entry = scan_flows_[idx];
+    FlowExportInfo *rev_info = NULL;
+    FlowExportInfo *info = &entry->second;
+    if (EvaluateFlow(entry->first, info, k_flow, curr_time, &rev_info)) {
+        return;
+    }
+    // Flows not exported yet are retried on every visit
+    if (info->exported()) {
+        scan_.Update(idx, k_flow, info->last_modified_time());
+    }
+}
+
+// Evaluates the flows without a valid index in the table, at most
+// flow_count_per_pass_ flow_tree_ entries per run, resuming from
+// unmapped_iteration_key_
+void FlowStatsCollector::WalkUnmappedFlows(uint64_t curr_time) {
+    FlowEntryTree::iterator it =
+        flow_tree_.upper_bound(unmapped_iteration_key_);
+    uint32_t count = 0;
+    while (it != flow_tree_.end() && count < flow_count_per_pass_) {
+        FlowExportInfo *rev_info = NULL;
+        FlowEntryTree::value_type *entry = &(*it);
+        it++;
+        count++;
+        unmapped_iteration_key_ = entry->first;
+        if (IsScanIndex(entry->second.flow_handle()) &&
+            scan_flows_[entry->second.flow_handle()] == entry) {
+            continue;
+        }
+        EvaluateFlow(entry->first, &entry->second, NULL, curr_time,
+                     &rev_info);
+    }
+    if (it == flow_tree_.end()) {
+        unmapped_walk_ = false;
+        unmapped_iteration_key_.Reset();
+    }
+}
+
+// Reads the kernel flow table in index order, a pass covers the same share
+// of the table as the tree walk covers of flow_tree_. Flows without a valid
+// index in the table are walked once the scan wraps around, with the same
+// per pass budget.
+void FlowStatsCollector::ScanFlowTable(uint64_t curr_time) {
+    FlowTableKSyncObject *ksync_obj =
+        agent_uve_->agent()->ksync()->flowtable_ksync_obj();
+    const vr_flow_entry *table = ksync_obj->flow_table();
+    uint32_t size = ksync_obj->flow_table_entries_count();
+    if (table == NULL || size == 0) {
+        WalkFlowTree(curr_time);
+        return;
+    }
+    if (scan_.size() != size) {
+        InitFlowScan(size);
+    }
+
+    if (unmapped_walk_) {
+        WalkUnmappedFlows(curr_time);
+        return;
+    }
+
+    uint64_t slots = ((uint64_t)size * flow_count_per_pass_) /
+        flow_tree_.size() + 1;
+    bool wrapped = scan_.Scan(table, std::min(slots, (uint64_t)size),
+                              curr_time, flow_age_time_intvl_,
+                              boost::bind(&FlowStatsCollector::ScanVisit,
+                                          this, _1, _2, curr_time));
+    if (wrapped && flow_tree_.size() != scan_.mapped()) {
+        unmapped_walk_ = true;
+        unmapped_iteration_key_.Reset();
+    }
+}
+
+bool FlowStatsCollector::Run() {
+    Agent *agent = agent_uve_->agent();
+    FlowTable *flow_obj = agent->pkt()->flow_table();
+
+    run_counter_++;
+    uint64_t curr_time = UTCTimestampUsec();
+    if (aggregate_table_.get() &&
+        (curr_time - aggregate_start_time_) >= aggregate_interval_) {
+        ExportAggregates(curr_time);
+        DispatchPendingFlowMsg();
+    }
+    if (!flow_tree_.size()) {
+        return true;
+    }
+    if (sequential_scan_) {
+        ScanFlowTable(curr_time);
+    } else {
+        WalkFlowTree(curr_time);
+    }
+
+    //Send any pending flow export messages
+    DispatchPendingFlowMsg();
 
     UpdateFlowThreshold(curr_time);
     /* Update the flow_timer_interval and flow_count_per_pass_ based on
@@ -632,6 +786,23 @@ void FlowStatsCollector::ExportFlow(const FlowKey &key,
         return;
     }
 
+    /* Flows with action LOG are always exported as flow records. Other flows
+     * are added to the aggregates with their exact stats, without sampling.
+     * Local flows are added in both directions, as they are exported in both
+     * directions */
+    if (aggregate_table_.get() && !info->IsActionLog()) {
+        info->set_exported(true);
+        if (info->is_flags_set(FlowEntry::LocalFlow)) {
+            AggregateFlow(key, info, true, diff_bytes, diff_pkts);
+            AggregateFlow(key, info, false, diff_bytes, diff_pkts);
+        } else {
+            AggregateFlow(key, info,
+                          info->is_flags_set(FlowEntry::IngressDir),
+                          diff_bytes, diff_pkts);
+        }
+        return;
+    }
+
     if (!info->IsActionLog() && (diff_bytes < threshold_)) {
         double probability = diff_bytes/threshold_;
         uint32_t num = rand() % threshold_;
@@ -745,6 +916,73 @@ void FlowStatsCollector::ExportFlow(const FlowKey &key,
     }
 }
 
+void FlowStatsCollector::SetExportAggregation(uint32_t interval_secs,
+                                              uint16_t port_bucket,
+                                              uint32_t table_size) {
+    if (interval_secs == 0) {
+        aggregate_table_.reset();
+        aggregate_interval_ = 0;
+        return;
+    }
+    if (table_size == 0) {
+        table_size = FlowAggregateTable::kDefaultSize;
+    }
+    aggregate_table_.reset(new FlowAggregateTable(table_size, port_bucket));
+    aggregate_interval_ = 1000000ULL * interval_secs;
+    aggregate_start_time_ = 0;
+}
+
+void FlowStatsCollector::AggregateFlow(const FlowKey &key,
+                                       const FlowExportInfo *info,
+                                       bool ingress, uint64_t diff_bytes,
+                                       uint64_t diff_pkts) {
+    if (aggregate_table_->Add(info->source_vn(), info->dest_vn(),
+                              key.protocol, key.dst_port, ingress,
+                              diff_bytes, diff_pkts)) {
+        return;
+    }
+    /* Table is full, export the aggregates so far and start a new interval */
+    ExportAggregates(UTCTimestampUsec());
+    aggregate_table_->Add(info->source_vn(), info->dest_vn(), key.protocol,
+                          key.dst_port, ingress, diff_bytes, diff_pkts);
+}
+
+/* Aggregates are exported as flow records without addresses and source
+ * port, the destination port is the first port of the bucket and the setup
+ * time is the start of the interval. Every aggregate gets a new uuid */
+void FlowStatsCollector::ExportAggregate
+    (const FlowAggregateTable::Entry &entry) {
+    FlowDataIpv4 &s_flow = msg_list_[GetFlowMsgIdx()];
+
+    s_flow.set_flowuuid(to_string(rand_gen_()));
+    s_flow.set_direction_ing(entry.ingress ? 1 : 0);
+    s_flow.set_sourcevn(entry.source_vn);
+    s_flow.set_destvn(entry.dest_vn);
+    s_flow.set_sourceip(0);
+    s_flow.set_destip(0);
+    s_flow.set_protocol(entry.protocol);
+    s_flow.set_sport(0);
+    s_flow.set_dport(entry.dport);
+    s_flow.set_bytes(entry.bytes);
+    s_flow.set_packets(entry.packets);
+    s_flow.set_diff_bytes(entry.bytes);
+    s_flow.set_diff_packets(entry.packets);
+    s_flow.set_setup_time(aggregate_start_time_);
+    EnqueueFlowMsg();
+    flow_export_count_++;
+    aggregate_export_count_++;
+}
+
+void FlowStatsCollector::ExportAggregates(uint64_t curr_time) {
+    if (aggregate_table_.get() == NULL) {
+        return;
+    }
+    aggregate_table_->Walk(boost::bind(&FlowStatsCollector::ExportAggregate,
+                                       this, _1));
+    aggregate_table_->Clear();
+    aggregate_start_time_ = curr_time;
+}
+
 void FlowStatsCollector::UpdateFlowThreshold(uint64_t curr_time) {
     bool export_rate_calculated = false;
 
@@ -894,13 +1132,16 @@ void FlowStatsCollector::NewFlow(const FlowKey &key,
 void FlowStatsCollector::AddFlow(const FlowKey &key, FlowExportInfo info) {
     FlowEntryTree::iterator it = flow_tree_.find(key);
     if (it != flow_tree_.end()) {
+        UnmapFlowIndex(&(*it));
         it->second = info;
+        MapFlowIndex(&(*it));
         return;
     }
 
     /* Invoke NewFlow only if the entry is not present in our tree */
     NewFlow(key, info);
-    flow_tree_.insert(make_pair(key, info));
+    it = flow_tree_.insert(make_pair(key, info)).first;
+    MapFlowIndex(&(*it));
 }
 
 void FlowStatsCollector::DeleteFlow(const FlowKey &key) {
@@ -908,13 +1149,16 @@ void FlowStatsCollector::DeleteFlow(const FlowKey &key) {
     if (it == flow_tree_.end())
         return;
 
+    UnmapFlowIndex(&(*it));
     flow_tree_.erase(it);
 }
 
 void FlowStatsCollector::UpdateFlowIndex(const FlowKey &key, uint32_t idx) {
-    FlowExportInfo *info = FindFlowExportInfo(key);
-    if (info) {
-        info->set_flow_handle(idx);
+    FlowEntryTree::iterator it = flow_tree_.find(key);
+    if (it != flow_tree_.end()) {
+        UnmapFlowIndex(&(*it));
+        it->second.set_flow_handle(idx);
+        MapFlowIndex(&(*it));
     }
 }
 
@@ -952,6 +1196,12 @@ void FlowStatsCollectionParamsReq::HandleRequest() const {
     FlowStatsCollectionParamsResp *resp = new FlowStatsCollectionParamsResp();
     resp->set_flow_export_rate(col->flow_export_rate());
     resp->set_sampling_threshold(col->threshold());
+    const FlowAggregateTable *table = col->aggregate_table();
+    if (table) {
+        resp->set_aggregates(table->count());
+        resp->set_aggregate_table_size(table->size());
+    }
+    resp->set_aggregate_export_count(col->aggregate_export_count());
 
     resp->set_context(context());
     resp->Response();
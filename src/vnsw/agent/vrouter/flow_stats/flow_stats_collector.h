@@ -14,6 +14,10 @@
 #include <sandesh/common/flow_types.h>
 #include <vrouter/flow_stats/flow_export_request.h>
 #include <vrouter/flow_stats/flow_export_info.h>
+#include <vrouter/flow_stats/flow_table_scan.h>
+#include <vrouter/flow_stats/flow_aggregate_table.h>
+#include <boost/scoped_ptr.hpp>
+#include <boost/uuid/random_generator.hpp>
 
 // Forward declaration
 class AgentUtXmlFlowThreshold;
@@ -82,6 +86,19 @@ public:
                                uint64_t pkts);
     void Shutdown();
     void set_delete_short_flow(bool val) { delete_short_flow_ = val; }
+    // Read the kernel flow table sequentially instead of walking flow_tree_
+    bool sequential_scan() const { return sequential_scan_; }
+    void set_sequential_scan(bool val) { sequential_scan_ = val; }
+    const FlowTableScan &scan() const { return scan_; }
+    // Export aggregates of flows every interval_secs instead of a record
+    // per flow, interval_secs of 0 exports flow records
+    void SetExportAggregation(uint32_t interval_secs, uint16_t port_bucket,
+                              uint32_t table_size);
+    const FlowAggregateTable *aggregate_table() const {
+        return aggregate_table_.get();
+    }
+    uint64_t aggregate_export_count() const { return aggregate_export_count_; }
+    void ExportAggregates(uint64_t curr_time);
     void AddEvent(FlowEntryPtr &flow);
     void DeleteEvent(const FlowKey &key);
     void SourceIpOverride(const FlowKey &key, FlowExportInfo *info,
@@ -103,6 +120,10 @@ protected:
 
 private:
     void FlowDeleteEnqueue(const FlowKey &key, bool rev);
+    void SetFlowDeletePending(FlowExportInfo *info, FlowExportInfo *rev_info,
+                              uint64_t curr_time);
+    bool FlowDeletePending(const FlowExportInfo *info,
+                           uint64_t curr_time) const;
     void EnqueueFlowMsg();
     void DispatchPendingFlowMsg();
     void GetFlowSandeshActionParams(const FlowAction &action_info,
@@ -131,6 +152,21 @@ private:
     void AddFlow(const FlowKey &key, FlowExportInfo info);
     void DeleteFlow(const FlowKey &key);
     void UpdateFlowIndex(const FlowKey &key, uint32_t idx);
+    bool EvaluateFlow(const FlowKey &key, FlowExportInfo *info,
+                      const vr_flow_entry *k_flow, uint64_t curr_time,
+                      FlowExportInfo **rev_info);
+    void WalkFlowTree(uint64_t curr_time);
+    void ScanFlowTable(uint64_t curr_time);
+    void WalkUnmappedFlows(uint64_t curr_time);
+    void ScanVisit(uint32_t idx, const vr_flow_entry *k_flow,
+                   uint64_t curr_time);
+    void InitFlowScan(uint32_t size);
+    bool IsScanIndex(uint32_t idx) const;
+    void MapFlowIndex(FlowEntryTree::value_type *entry);
+    void UnmapFlowIndex(FlowEntryTree::value_type *entry);
+    void AggregateFlow(const FlowKey &key, const FlowExportInfo *info,
+                       bool ingress, uint64_t diff_bytes, uint64_t diff_pkts);
+    void ExportAggregate(const FlowAggregateTable::Entry &entry);
 
     void UpdateFlowStats(FlowExportInfo *flow, uint64_t &diff_bytes,
                          uint64_t &diff_pkts);
@@ -157,6 +193,22 @@ private:
     uint32_t prev_cfg_flow_export_rate_;
     std::vector<FlowDataIpv4> msg_list_;
     uint8_t msg_index_;
+    bool sequential_scan_;
+    // Shadow of the kernel flow table and the flow_tree_ entry of every
+    // index, maintained as flows are added, deleted and re-indexed
+    FlowTableScan scan_;
+    std::vector<FlowEntryTree::value_type *> scan_flows_;
+    // Walk of the flows without a scan index, started when the scan wraps
+    // around and resumed from unmapped_iteration_key_ on every run
+    bool unmapped_walk_;
+    FlowKey unmapped_iteration_key_;
+    // Aggregates of the current export interval, NULL when flows are
+    // exported individually
+    boost::scoped_ptr<FlowAggregateTable> aggregate_table_;
+    uint64_t aggregate_interval_;
+    uint64_t aggregate_start_time_;
+    uint64_t aggregate_export_count_;
+    boost::uuids::random_generator rand_gen_;
     DISALLOW_COPY_AND_ASSIGN(FlowStatsCollector);
 };
 
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <algorithm>
+#include <vrouter/flow_stats/flow_table_scan.h>
+
+const uint32_t FlowTableScan::kBlockSize;
+const uint32_t FlowTableScan::kPrefetchDistance;
+
+FlowTableScan::FlowTableScan() :
+    index_(0), mapped_(0), visited_(0), skipped_(0) {
+}
+
+void FlowTableScan::Reset(uint32_t size) {
+    std::vector<SlotState>(size).swap(state_);
+    index_ = 0;
+    mapped_ = 0;
+}
+
+void FlowTableScan::Map(uint32_t idx) {
+    if (idx >= state_.size()) {
+        return;
+    }
+    SlotState &state = state_[idx];
+    if (!(state.flags & SlotState::MAPPED)) {
+        mapped_++;
+    }
+    state = SlotState();
+    state.flags = SlotState::MAPPED;
+}
+
+void FlowTableScan::Unmap(uint32_t idx) {
+    if (idx >= state_.size()) {
+        return;
+    }
+    SlotState &state = state_[idx];
+    if (state.flags & SlotState::MAPPED) {
+        mapped_--;
+    }
+    state = SlotState();
+}
+
+void FlowTableScan::Update(uint32_t idx, const vr_flow_entry *k_flow,
+                           uint64_t last_modified_time) {
+    SlotState &state = state_[idx];
+    if (k_flow) {
+        state.bytes = k_flow->fe_stats.flow_bytes;
+        state.bytes_oflow = k_flow->fe_stats.flow_bytes_oflow;
+        state.tcp_flags = k_flow->fe_tcp_flags;
+        state.udp_src_port = k_flow->fe_udp_src_port;
+    }
+    state.last_modified_secs = last_modified_time / 1000000;
+    state.flags |= SlotState::VALID;
+}
+
+// A flow needs evaluation when its stats or flags changed since it was last
+// evaluated, when its TCP flags make it a candidate for aging irrespective of
+// traffic, or when the aging interval may have elapsed. Seconds in the shadow
+// are rounded down, so aging is checked up to a second early.
+bool FlowTableScan::Unchanged(const SlotState &state,
+                              const vr_flow_entry *k_flow,
+                              uint32_t curr_secs, uint64_t age_time) const {
+    if (!(state.flags & SlotState::VALID)) {
+        return false;
+    }
+
+    uint64_t idle_secs = (uint32_t)(curr_secs - state.last_modified_secs) + 1;
+    if (idle_secs * 1000000 >= age_time) {
+        return false;
+    }
+
+    if (k_flow == NULL) {
+        return true;
+    }
+
+    if (state.bytes != k_flow->fe_stats.flow_bytes ||
+        state.bytes_oflow != k_flow->fe_stats.flow_bytes_oflow ||
+        state.tcp_flags != k_flow->fe_tcp_flags ||
+        state.udp_src_port != k_flow->fe_udp_src_port) {
+        return false;
+    }
+
+    if (k_flow->fe_tcp_flags & (VR_FLOW_TCP_HALF_CLOSE | VR_FLOW_TCP_RST)) {
+        return false;
+    }
+    if ((k_flow->fe_tcp_flags & (VR_FLOW_TCP_SYN | VR_FLOW_TCP_SYN_R)) &&
+        !(k_flow->fe_tcp_flags &
+          (VR_FLOW_TCP_ESTABLISHED | VR_FLOW_TCP_ESTABLISHED_R))) {
+        return false;
+    }
+    return true;
+}
+
+bool FlowTableScan::Scan(const vr_flow_entry *table, uint32_t count,
+                         uint64_t curr_time, uint64_t age_time,
+                         Visitor visitor) {
+    uint32_t size = state_.size();
+    if (table == NULL || size == 0) {
+        return false;
+    }
+    if (count > size) {
+        count = size;
+    }
+
+    uint32_t curr_secs = curr_time / 1000000;
+    bool wrapped = false;
+    while (count) {
+        uint32_t block = std::min(std::min(kBlockSize, size - index_), count);
+        const vr_flow_entry *k_flow = table + index_;
+        const SlotState *state = &state_[index_];
+        if (index_ + kPrefetchDistance < size) {
+            __builtin_prefetch(k_flow + kPrefetchDistance);
+            __builtin_prefetch(state + kPrefetchDistance);
+        }
+
+        // Flags of the whole block are or-ed from the shadow before looking
+        // at any slot. The loop has no branches, and blocks without a flow
+        // known to the agent are skipped without touching the kernel table.
+        uint32_t mapped = 0;
+        for (uint32_t i = 0; i < block; i++) {
+            mapped |= state[i].flags;
+        }
+
+        if (mapped & SlotState::MAPPED) {
+            for (uint32_t i = 0; i < block; i++) {
+                if (!(state[i].flags & SlotState::MAPPED)) {
+                    continue;
+                }
+                const vr_flow_entry *k = NULL;
+                if (k_flow[i].fe_flags & VR_FLOW_FLAG_ACTIVE) {
+                    k = &k_flow[i];
+                }
+                if (Unchanged(state[i], k, curr_secs, age_time)) {
+                    skipped_++;
+                    continue;
+                }
+                visited_++;
+                visitor(index_ + i, k);
+            }
+        }
+
+        index_ += block;
+        count -= block;
+        if (index_ == size) {
+            index_ = 0;
+            wrapped = true;
+        }
+    }
+    return wrapped;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+#ifndef __AGENT_FLOW_TABLE_SCAN_H__
+#define __AGENT_FLOW_TABLE_SCAN_H__
+
+#include <stdint.h>
+#include <vector>
+#include <boost/function.hpp>
+#include <vr_types.h>
+#include <vr_flow.h>
+
+// Sequential scan of the kernel flow table shared with vrouter.
+//
+// Slots are read in index order, a block of kBlockSize slots without a flow
+// known to the agent is skipped with a single test. For every slot the kernel
+// stats and flags seen when the flow was last evaluated are kept in a compact
+// shadow entry, so that a flow with no new traffic is passed over without
+// looking at its FlowExportInfo. Flows are handed to the visitor only when
+// their stats or flags changed or when they may be due for aging.
+class FlowTableScan {
+public:
+    static const uint32_t kBlockSize = 8;
+    static const uint32_t kPrefetchDistance = 16;
+
+    // Called with the index of the slot and the kernel flow, NULL if the
+    // kernel flow is not active
+    typedef boost::function<void(uint32_t, const vr_flow_entry *)> Visitor;
+
+    struct SlotState {
+        enum Flags {
+            MAPPED  = 1 << 0,
+            VALID   = 1 << 1
+        };
+        SlotState() :
+            bytes(0), bytes_oflow(0), tcp_flags(0), udp_src_port(0),
+            flags(0), last_modified_secs(0) {
+        }
+        uint32_t bytes;
+        uint16_t bytes_oflow;
+        uint16_t tcp_flags;
+        uint16_t udp_src_port;
+        uint16_t flags;
+        uint32_t last_modified_secs;
+    };
+
+    FlowTableScan();
+
+    void Reset(uint32_t size);
+    uint32_t size() const { return state_.size(); }
+    uint32_t index() const { return index_; }
+    uint32_t mapped() const { return mapped_; }
+
+    // Flow at idx is known to the agent, its slot is evaluated on the
+    // next visit
+    void Map(uint32_t idx);
+    void Unmap(uint32_t idx);
+    bool IsMapped(uint32_t idx) const {
+        return idx < state_.size() && (state_[idx].flags & SlotState::MAPPED);
+    }
+    // Records the kernel flow as seen by the last evaluation
+    void Update(uint32_t idx, const vr_flow_entry *k_flow,
+                uint64_t last_modified_time);
+
+    // Scans count slots from the current index, wrapping around at the end
+    // of the table. age_time is the flow aging interval and curr_time the
+    // current time, both in usecs. Returns true if the scan wrapped around.
+    bool Scan(const vr_flow_entry *table, uint32_t count, uint64_t curr_time,
+              uint64_t age_time, Visitor visitor);
+
+    uint64_t visited() const { return visited_; }
+    uint64_t skipped() const { return skipped_; }
+
+private:
+    bool Unchanged(const SlotState &state, const vr_flow_entry *k_flow,
+                   uint32_t curr_secs, uint64_t age_time) const;
+
+    std::vector<SlotState> state_;
+    uint32_t index_;
+    uint32_t mapped_;
+    // Slots handed to the visitor and active slots passed over
+    uint64_t visited_;
+    uint64_t skipped_;
+};
+
+#endif //  __AGENT_FLOW_TABLE_SCAN_H__
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <stdlib.h>
+#include <time.h>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/bind.hpp>
+#include <testing/gunit.h>
+#include <base/logging.h>
+#include <sandesh/common/flow_types.h>
+#include <vrouter/flow_stats/flow_aggregate_table.h>
+
+class FlowAggregateTableTest : public ::testing::Test {
+public:
+    FlowAggregateTableTest() : bytes_(0), packets_(0) { }
+
+    void Visit(const FlowAggregateTable::Entry &entry) {
+        entries_.push_back(entry);
+        bytes_ += entry.bytes;
+        packets_ += entry.packets;
+    }
+
+    void Walk(const FlowAggregateTable &table) {
+        entries_.clear();
+        bytes_ = packets_ = 0;
+        table.Walk(boost::bind(&FlowAggregateTableTest::Visit, this, _1));
+    }
+
+protected:
+    std::vector<FlowAggregateTable::Entry> entries_;
+    uint64_t bytes_;
+    uint64_t packets_;
+};
+
+TEST_F(FlowAggregateTableTest, Aggregate) {
+    FlowAggregateTable table(64, 1);
+    EXPECT_TRUE(table.Add("vn1", "vn2", 6, 80, true, 100, 1));
+    EXPECT_TRUE(table.Add("vn1", "vn2", 6, 80, true, 200, 2));
+    EXPECT_TRUE(table.Add("vn1", "vn2", 6, 80, false, 50, 1));
+    EXPECT_TRUE(table.Add("vn2", "vn1", 6, 80, true, 10, 1));
+    EXPECT_TRUE(table.Add("vn1", "vn2", 17, 80, true, 10, 1));
+    EXPECT_EQ(4U, table.count());
+
+    Walk(table);
+    EXPECT_EQ(4U, entries_.size());
+    EXPECT_EQ("vn1", entries_[0].source_vn);
+    EXPECT_EQ(300U, entries_[0].bytes);
+    EXPECT_EQ(3U, entries_[0].packets);
+    EXPECT_EQ(2U, entries_[0].flows);
+    EXPECT_EQ(370U, bytes_);
+
+    table.Clear();
+    EXPECT_TRUE(table.empty());
+    Walk(table);
+    EXPECT_EQ(0U, entries_.size());
+
+    // Slots are reused after clear
+    EXPECT_TRUE(table.Add("vn1", "vn2", 6, 80, true, 100, 1));
+    Walk(table);
+    EXPECT_EQ(1U, entries_.size());
+    EXPECT_EQ(100U, entries_[0].bytes);
+}
+
+TEST_F(FlowAggregateTableTest, PortBucket) {
+    FlowAggregateTable table(64, 1024);
+    EXPECT_EQ(1024, table.port_bucket());
+    EXPECT_TRUE(table.Add("vn1", "vn2", 6, 80, true, 100, 1));
+    EXPECT_TRUE(table.Add("vn1", "vn2", 6, 1023, true, 100, 1));
+    EXPECT_TRUE(table.Add("vn1", "vn2", 6, 1024, true, 100, 1));
+    EXPECT_TRUE(table.Add("vn1", "vn2", 6, 65535, true, 100, 1));
+    Walk(table);
+    EXPECT_EQ(3U, entries_.size());
+    EXPECT_EQ(0, entries_[0].dport);
+    EXPECT_EQ(200U, entries_[0].bytes);
+    EXPECT_EQ(1024, entries_[1].dport);
+    EXPECT_EQ(64512, entries_[2].dport);
+
+    FlowAggregateTable no_bucket(64, 0);
+    EXPECT_EQ(1, no_bucket.port_bucket());
+}
+
+TEST_F(FlowAggregateTableTest, Full) {
+    FlowAggregateTable table(10, 1);
+    EXPECT_EQ(16U, table.size());
+    uint32_t added = 0;
+    while (table.Add("vn1", "vn2", 6, added, true, 1, 1)) {
+        added++;
+    }
+    EXPECT_EQ(12U, added);
+    EXPECT_EQ(12U, table.count());
+
+    // Existing aggregates can still be updated
+    EXPECT_TRUE(table.Add("vn1", "vn2", 6, 0, true, 1, 1));
+    table.Clear();
+    EXPECT_TRUE(table.Add("vn1", "vn2", 6, 100, true, 1, 1));
+}
+
+struct TestFlow {
+    uint32_t svn;
+    uint32_t dvn;
+    uint16_t dport;
+    uint8_t protocol;
+};
+
+static double CpuTime() {
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+// 100k flows of 32 VN pairs towards 64 services, each flow updated once per
+// stats pass, 10 passes in a 60 sec export interval. Flow records are built
+// for every update and sent 16 in a message when not aggregating, while
+// aggregation builds a record per aggregate at the end of the interval.
+TEST_F(FlowAggregateTableTest, ExportRate) {
+    const uint32_t kFlows = 100 * 1000;
+    const uint32_t kVns = 8;
+    const uint32_t kServices = 64;
+    const uint32_t kPasses = 10;
+    const uint32_t kIntervalSecs = 60;
+    const uint32_t kRecordsPerMsg = 16;
+
+    std::vector<std::string> vns;
+    for (uint32_t i = 0; i < kVns; i++) {
+        std::stringstream ss;
+        ss << "default-domain:admin:vn" << i;
+        vns.push_back(ss.str());
+    }
+    std::vector<TestFlow> flows(kFlows);
+    srand(1);
+    for (uint32_t i = 0; i < kFlows; i++) {
+        flows[i].svn = rand() % kVns;
+        flows[i].dvn = (flows[i].svn + 1 + rand() % 4) % kVns;
+        uint32_t service = rand() % kServices;
+        flows[i].dport = 8000 + service;
+        flows[i].protocol = (service % 2) ? 6 : 17;
+    }
+
+    std::vector<FlowDataIpv4> msg(kRecordsPerMsg);
+    uint64_t raw_records = 0;
+    uint64_t raw_bytes = 0;
+    double t0 = CpuTime();
+    for (uint32_t pass = 0; pass < kPasses; pass++) {
+        for (uint32_t i = 0; i < kFlows; i++) {
+            FlowDataIpv4 &s_flow = msg[raw_records % kRecordsPerMsg];
+            s_flow = FlowDataIpv4();
+            s_flow.set_flowuuid("00000000-0000-0000-0000-000000000000");
+            s_flow.set_direction_ing(1);
+            s_flow.set_sourcevn(vns[flows[i].svn]);
+            s_flow.set_destvn(vns[flows[i].dvn]);
+            s_flow.set_protocol(flows[i].protocol);
+            s_flow.set_dport(flows[i].dport);
+            s_flow.set_diff_bytes(1000 + i % 100);
+            s_flow.set_diff_packets(1);
+            raw_bytes += 1000 + i % 100;
+            raw_records++;
+        }
+    }
+    double t1 = CpuTime();
+
+    FlowAggregateTable table(FlowAggregateTable::kDefaultSize, 1);
+    uint64_t agg_records = 0;
+    double t2 = CpuTime();
+    for (uint32_t pass = 0; pass < kPasses; pass++) {
+        for (uint32_t i = 0; i < kFlows; i++) {
+            EXPECT_TRUE(table.Add(vns[flows[i].svn], vns[flows[i].dvn],
+                                  flows[i].protocol, flows[i].dport, true,
+                                  1000 + i % 100, 1));
+        }
+    }
+    Walk(table);
+    for (std::vector<FlowAggregateTable::Entry>::const_iterator it =
+         entries_.begin(); it != entries_.end(); ++it) {
+        FlowDataIpv4 &s_flow = msg[agg_records % kRecordsPerMsg];
+        s_flow = FlowDataIpv4();
+        s_flow.set_flowuuid("00000000-0000-0000-0000-000000000000");
+        s_flow.set_direction_ing(1);
+        s_flow.set_sourcevn(it->source_vn);
+        s_flow.set_destvn(it->dest_vn);
+        s_flow.set_protocol(it->protocol);
+        s_flow.set_dport(it->dport);
+        s_flow.set_diff_bytes(it->bytes);
+        s_flow.set_diff_packets(it->packets);
+        agg_records++;
+    }
+    table.Clear();
+    double t3 = CpuTime();
+
+    // Totals are exact
+    EXPECT_EQ(raw_bytes, bytes_);
+    EXPECT_EQ((uint64_t)kFlows * kPasses, packets_);
+    EXPECT_LE(agg_records, (uint64_t)kVns * 4 * kServices);
+    EXPECT_GT(raw_records / agg_records, 100U);
+
+    uint64_t raw_msgs = (raw_records + kRecordsPerMsg - 1) / kRecordsPerMsg;
+    uint64_t agg_msgs = (agg_records + kRecordsPerMsg - 1) / kRecordsPerMsg;
+    LOG(DEBUG, "Flow records: " << raw_records << " records "
+        << raw_msgs / kIntervalSecs << " msgs/sec cpu " << (t1 - t0)
+        << " sec");
+    LOG(DEBUG, "Aggregates  : " << agg_records << " records "
+        << (double)agg_msgs / kIntervalSecs << " msgs/sec cpu "
+        << (t3 - t2) << " sec");
+}
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2015 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/scoped_array.hpp>
+#include <testing/gunit.h>
+#include <base/logging.h>
+#include <base/time_util.h>
+#include <vrouter/flow_stats/flow_table_scan.h>
+
+static const uint64_t kAgeTime = 180 * 1000000ULL;
+static const uint64_t kCurrTime = 1000 * 1000000ULL;
+
+class FlowTableScanTest : public ::testing::Test {
+public:
+    FlowTableScanTest() : visits_(0) { }
+
+    void Visit(uint32_t idx, const vr_flow_entry *k_flow) {
+        visits_++;
+        visited_.push_back(idx);
+        scan_.Update(idx, k_flow, kCurrTime);
+    }
+
+    void InitTable(uint32_t size) {
+        table_.reset(new vr_flow_entry[size]);
+        memset(table_.get(), 0, sizeof(vr_flow_entry) * size);
+        scan_.Reset(size);
+    }
+
+    void AddFlow(uint32_t idx, uint32_t bytes) {
+        table_[idx].fe_flags = VR_FLOW_FLAG_ACTIVE;
+        table_[idx].fe_stats.flow_bytes = bytes;
+        table_[idx].fe_stats.flow_packets = bytes / 100;
+        scan_.Map(idx);
+    }
+
+    // Scans the whole table once
+    uint64_t Sweep(uint64_t curr_time) {
+        visits_ = 0;
+        visited_.clear();
+        scan_.Scan(table_.get(), scan_.size(), curr_time, kAgeTime,
+                   boost::bind(&FlowTableScanTest::Visit, this, _1, _2));
+        return visits_;
+    }
+
+protected:
+    boost::scoped_array<vr_flow_entry> table_;
+    FlowTableScan scan_;
+    uint64_t visits_;
+    std::vector<uint32_t> visited_;
+};
+
+TEST_F(FlowTableScanTest, SkipUnchanged) {
+    InitTable(64);
+    AddFlow(3, 100);
+    AddFlow(17, 200);
+    EXPECT_EQ(2U, scan_.mapped());
+
+    // First visit of every mapped flow
+    EXPECT_EQ(2U, Sweep(kCurrTime));
+    EXPECT_EQ(3U, visited_[0]);
+    EXPECT_EQ(17U, visited_[1]);
+
+    // Nothing changed
+    EXPECT_EQ(0U, Sweep(kCurrTime));
+
+    table_[17].fe_stats.flow_bytes += 1000;
+    EXPECT_EQ(1U, Sweep(kCurrTime));
+    EXPECT_EQ(17U, visited_[0]);
+}
+
+TEST_F(FlowTableScanTest, InactiveAndUnmapped) {
+    InitTable(64);
+    AddFlow(5, 100);
+    // Active in kernel but not known to the agent
+    table_[40].fe_flags = VR_FLOW_FLAG_ACTIVE;
+    table_[40].fe_stats.flow_bytes = 500;
+    EXPECT_EQ(1U, Sweep(kCurrTime));
+
+    // Kernel flow is gone, skipped till aging is due
+    table_[5].fe_flags = 0;
+    table_[5].fe_stats.flow_bytes = 0;
+    EXPECT_EQ(0U, Sweep(kCurrTime));
+    EXPECT_EQ(1U, Sweep(kCurrTime + kAgeTime));
+    EXPECT_TRUE(visited_[0] == 5);
+
+    scan_.Unmap(5);
+    EXPECT_EQ(0U, scan_.mapped());
+    EXPECT_EQ(0U, Sweep(kCurrTime + kAgeTime));
+}
+
+TEST_F(FlowTableScanTest, AgingDue) {
+    InitTable(16);
+    AddFlow(0, 100);
+    EXPECT_EQ(1U, Sweep(kCurrTime));
+    EXPECT_EQ(0U, Sweep(kCurrTime + kAgeTime - 2000000));
+    // Checked up to a second before the aging interval elapses
+    EXPECT_EQ(1U, Sweep(kCurrTime + kAgeTime - 1000000));
+}
+
+TEST_F(FlowTableScanTest, TcpFlags) {
+    InitTable(16);
+    AddFlow(1, 100);
+    AddFlow(2, 100);
+    table_[2].fe_tcp_flags = VR_FLOW_TCP_SYN | VR_FLOW_TCP_ESTABLISHED;
+    EXPECT_EQ(2U, Sweep(kCurrTime));
+    EXPECT_EQ(0U, Sweep(kCurrTime));
+
+    // Closed flows are visited on every scan
+    table_[1].fe_tcp_flags = VR_FLOW_TCP_RST;
+    EXPECT_EQ(1U, Sweep(kCurrTime));
+    EXPECT_EQ(1U, Sweep(kCurrTime));
+
+    // As are flows with SYN not yet established
+    AddFlow(3, 100);
+    table_[3].fe_tcp_flags = VR_FLOW_TCP_SYN;
+    EXPECT_EQ(2U, Sweep(kCurrTime));
+    EXPECT_EQ(2U, Sweep(kCurrTime));
+}
+
+TEST_F(FlowTableScanTest, PartialPasses) {
+    InitTable(100);
+    for (uint32_t i = 0; i < 100; i += 10) {
+        AddFlow(i, 100);
+    }
+
+    uint32_t passes = 0;
+    bool wrapped = false;
+    visits_ = 0;
+    while (!wrapped) {
+        wrapped = scan_.Scan(table_.get(), 7, kCurrTime, kAgeTime,
+                  boost::bind(&FlowTableScanTest::Visit, this, _1, _2));
+        passes++;
+    }
+    EXPECT_EQ(15U, passes);
+    EXPECT_EQ(10U, visits_);
+    EXPECT_EQ(5U, scan_.index());
+}
+
+// Compares a pass over 1M kernel flows, 512k of them known to the agent and
+// 10% of those with new traffic, done the way the tree walk does it against
+// the sequential scan
+TEST_F(FlowTableScanTest, Scale1M) {
+    const uint32_t kTableSize = 1024 * 1024;
+    const uint32_t kFlows = kTableSize / 2;
+
+    InitTable(kTableSize);
+    srand(1);
+
+    // Flows are spread over random indexes, the tree is ordered by a key
+    // unrelated to the index as flow_tree_ is
+    std::map<uint64_t, uint32_t> tree;
+    std::vector<uint64_t> shadow(kTableSize, 0);
+    while (tree.size() < kFlows) {
+        uint32_t idx = (((uint32_t)rand() << 16) ^ rand()) % kTableSize;
+        if (scan_.IsMapped(idx)) {
+            continue;
+        }
+        uint64_t key = ((uint64_t)rand() << 32) | rand();
+        if (tree.insert(std::make_pair(key, idx)).second == false) {
+            continue;
+        }
+        AddFlow(idx, 1000);
+    }
+    Sweep(kCurrTime);
+    for (std::map<uint64_t, uint32_t>::iterator it = tree.begin();
+         it != tree.end(); ++it) {
+        shadow[it->second] = table_[it->second].fe_stats.flow_bytes;
+    }
+
+    uint32_t changed = 0;
+    for (std::map<uint64_t, uint32_t>::iterator it = tree.begin();
+         it != tree.end(); ++it) {
+        if (rand() % 10 == 0) {
+            table_[it->second].fe_stats.flow_bytes += 1500;
+            table_[it->second].fe_stats.flow_packets++;
+            changed++;
+        }
+    }
+
+    uint64_t t0 = UTCTimestampUsec();
+    uint32_t tree_changed = 0;
+    for (std::map<uint64_t, uint32_t>::iterator it = tree.begin();
+         it != tree.end(); ++it) {
+        const vr_flow_entry *k_flow = &table_[it->second];
+        if (!(k_flow->fe_flags & VR_FLOW_FLAG_ACTIVE)) {
+            continue;
+        }
+        uint64_t k_bytes = ((uint64_t)k_flow->fe_stats.flow_bytes_oflow << 32)
+            | k_flow->fe_stats.flow_bytes;
+        if ((shadow[it->second] & 0x0000ffffffffffffULL) != k_bytes) {
+            tree_changed++;
+        }
+    }
+    uint64_t t1 = UTCTimestampUsec();
+    uint64_t scan_changed = Sweep(kCurrTime);
+    uint64_t t2 = UTCTimestampUsec();
+
+    EXPECT_EQ(changed, tree_changed);
+    EXPECT_EQ(changed, scan_changed);
+    EXPECT_EQ(kFlows - changed, scan_.skipped());
+    LOG(DEBUG, "Flows " << kFlows << " changed " << changed
+        << " tree walk " << (t1 - t0) << " usec sequential scan "
+        << (t2 - t1) << " usec");
+
+    // Unchanged table, nothing is handed out
+    EXPECT_EQ(0U, Sweep(kCurrTime));
+}
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
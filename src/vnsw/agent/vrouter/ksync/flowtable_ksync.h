@@ -85,6 +85,7 @@ public:
     bool GetFlowKey(uint32_t index, FlowKey *key);
 
     uint32_t flow_table_entries_count() { return flow_table_entries_count_; }
+    const vr_flow_entry *flow_table() const { return flow_table_; }
     bool AuditProcess();
     void MapFlowMem();
     void MapFlowMemTest();
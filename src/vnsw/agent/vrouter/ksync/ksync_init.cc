@@ -24,6 +24,7 @@
 #include <db/db_table.h>
 #include <db/db_table_partition.h>
 #include <cmn/agent_cmn.h>
+#include <init/agent_param.h>
 #include <ksync/ksync_index.h>
 #include <ksync/ksync_entry.h>
 #include <ksync/ksync_object.h>
@@ -68,6 +69,14 @@ void KSync::RegisterDBClients(DB *db) {
     mirror_ksync_obj_.get()->RegisterDBClients();
     vrf_assign_ksync_obj_.get()->RegisterDBClients();
     vxlan_ksync_obj_.get()->RegisterDBClients();
+    if (agent_->params()->ksync_pipelined()) {
+        interface_ksync_obj_.get()->set_pipelined(true);
+        nh_ksync_obj_.get()->set_pipelined(true);
+        mpls_ksync_obj_.get()->set_pipelined(true);
+        mirror_ksync_obj_.get()->set_pipelined(true);
+        vrf_assign_ksync_obj_.get()->set_pipelined(true);
+        vxlan_ksync_obj_.get()->set_pipelined(true);
+    }
     agent_->set_router_id_configured(false);
     KSyncDebug::set_debug(agent_->debug());
 }
@@ -95,6 +104,7 @@ void KSync::NetlinkInit() {
     boost::asio::io_service &io = *event_mgr->io_service();
 
     KSyncSockNetlink::Init(io, DB::PartitionCount(), NETLINK_GENERIC);
+    KSyncSock::set_multi_socket(agent_->params()->ksync_multi_socket());
     KSyncSock::SetAgentSandeshContext(new KSyncSandeshContext(
                                             flowtable_ksync_obj_.get()));
     GenericNetlinkInit();
@@ -282,6 +292,30 @@ void GenericNetlinkInit() {
     return;
 }
 
+void KSyncSockStatsReq::HandleRequest() const {
+    KSyncSockStatsResp *resp = new KSyncSockStatsResp();
+    std::vector<KSyncSockStatsInfo> &list =
+        const_cast<std::vector<KSyncSockStatsInfo>&>(resp->get_sock_list());
+    for (uint32_t i = 0; i < KSyncSock::SockCount(); i++) {
+        KSyncSock *sock = KSyncSock::Get(i);
+        if (sock == NULL) {
+            continue;
+        }
+        KSyncSockStatsInfo info;
+        info.set_index(i);
+        info.set_send_task_instance(sock->send_task_instance());
+        info.set_tx_msgs(sock->tx_msg_count());
+        info.set_tx_bulk_msgs(sock->tx_bulk_count());
+        info.set_tx_bytes(sock->tx_bytes());
+        info.set_rx_msgs(sock->rx_msg_count());
+        info.set_ack_wait(sock->ack_wait_count());
+        list.push_back(info);
+    }
+    resp->set_multi_socket(KSyncSock::multi_socket());
+    resp->set_context(context());
+    resp->Response();
+}
+
 KSyncTcp::KSyncTcp(Agent *agent): KSync(agent) {
 }
 
@@ -16,6 +16,7 @@
 #include <ksync/ksync_sock.h>
 
 #include "cmn/agent.h"
+#include "init/agent_param.h"
 #include "oper/interface_common.h"
 #include "oper/nexthop.h"
 #include "oper/route_common.h"
@@ -715,6 +716,7 @@ RouteKSyncObject::RouteKSyncObject(KSync *ksync, AgentRouteTable *rt_table):
     KSyncDBObject("KSync Route"), ksync_(ksync), marked_delete_(false),
     table_delete_ref_(this, rt_table->deleter()) {
     rt_table_ = rt_table;
+    set_pipelined(ksync->agent()->params()->ksync_pipelined());
     RegisterDb(rt_table);
 }
 